@@ -0,0 +1,29 @@
+# Writes a 400-sample, 2000-variant VCF with imputation-style DS values:
+# mostly within 0.02 of a hardcall, with a few fully uncertain entries and a
+# few missing calls, so that the dosage-delta form (and its FSE stage) is used.
+BEGIN {
+  nsamp = 400; nvar = 2000;
+  seed = 4321;
+  printf "##fileformat=VCFv4.2\n##contig=<ID=1,length=100000000>\n##FORMAT=<ID=DS,Number=A,Type=Float,Description=\"Dosage\">\n#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT";
+  for (s = 0; s < nsamp; ++s) printf "\ts%d", s;
+  printf "\n";
+  for (v = 0; v < nvar; ++v) {
+    line = "1\t" (v + 1) * 100 "\tv" v "\tA\tC\t.\t.\t.\tDS";
+    for (s = 0; s < nsamp; ++s) {
+      seed = (seed * 1103515245 + 12345) % 2147483648;
+      r = seed % 1000;
+      if (r < 5) {
+        ds = ".";
+      } else if (r < 30) {
+        ds = sprintf("%.3f", (r - 5) * 0.08);
+      } else {
+        hc = (r < 500) ? 0 : ((r < 850) ? 1 : 2);
+        seed = (seed * 1103515245 + 12345) % 2147483648;
+        d = (seed % 41) * 0.0005;
+        ds = sprintf("%.4f", (hc == 2) ? 2 - d : hc + d);
+      }
+      line = line "\t" ds;
+    }
+    print line;
+  }
+}
@@ -0,0 +1,22 @@
+#!/bin/bash
+
+set -exo pipefail
+
+awk -f make_vcf.awk > tmp_data.vcf
+$1/plink2 $2 $3 --vcf tmp_data.vcf dosage=DS --out tmp_data
+
+# dosage-delta -> standard must reproduce the original .pgen exactly.
+$1/plink2 $2 $3 --pfile tmp_data --make-pgen dosage-delta --out tmp_dd
+$1/plink2 $2 $3 --pfile tmp_dd --make-pgen --out tmp_std
+diff -q tmp_data.pgen tmp_std.pgen
+test $(stat -c %s tmp_dd.pgen) -lt $(stat -c %s tmp_data.pgen)
+
+# Subset reads go through the same decoder.
+awk 'NR % 3 == 0 { print $3 }' tmp_data.pvar > extract.txt
+awk 'NR > 1 && NR % 4 { print $1 }' tmp_data.psam > keep.txt
+$1/plink2 $2 $3 --pfile tmp_data --extract extract.txt --keep keep.txt --make-pgen --out tmp_sub
+$1/plink2 $2 $3 --pfile tmp_dd --extract extract.txt --keep keep.txt --make-pgen --out tmp_dd_sub
+diff -q tmp_sub.pgen tmp_dd_sub.pgen
+$1/plink2 $2 $3 --pfile tmp_data --keep keep.txt --export A --out tmp_sub
+$1/plink2 $2 $3 --pfile tmp_dd --keep keep.txt --export A --out tmp_dd_sub
+diff -q tmp_sub.raw tmp_dd_sub.raw
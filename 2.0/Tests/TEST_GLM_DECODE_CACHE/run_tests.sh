@@ -0,0 +1,40 @@
+#!/bin/bash
+
+set -exo pipefail
+
+# B1, B2, B3 and Q1 share a missingness pattern; B4 and PHENO1 don't.  Part of
+# the data is moved to chrX so that the chrX sample subsets are exercised.
+$1/plink2 $2 $3 --dummy 400 2000 0.02 dosage-freq=0.3 --seed 3 --out tmp_dummy
+awk 'NR > 1701 { $1 = "X" } { print }' OFS='\t' tmp_dummy.pvar > tmp_data.pvar
+cp tmp_dummy.psam tmp_data.psam
+cp tmp_dummy.pgen tmp_data.pgen
+awk 'BEGIN { srand(11) }
+     NR == 1 { print "#IID\tB1\tB2\tB3\tB4\tQ1"; next }
+     { m = (NR % 9 == 0); m4 = (NR % 5 == 0)
+       b1 = m? "NA" : 1 + (rand() < 0.5); b2 = m? "NA" : 1 + (rand() < 0.4)
+       b3 = m? "NA" : 1 + (rand() < 0.3); b4 = m4? "NA" : 1 + (rand() < 0.5)
+       q1 = m? "NA" : sprintf("%.4f", rand() * 10)
+       print $1 "\t" b1 "\t" b2 "\t" b3 "\t" b4 "\t" q1 }' tmp_dummy.psam > phenos.txt
+awk 'BEGIN { srand(5) }
+     NR == 1 { print "#IID\tC1"; next }
+     { print $1 "\t" ((NR % 31 == 0)? "NA" : sprintf("%.4f", rand())) }' tmp_dummy.psam > covar.txt
+
+# --decode-cache must not change --glm output, whether or not everything fits
+# and however variants are split across threads.  ($2/$3 aren't passed to
+# these runs, since they may also set --threads.)
+for t in 1 3; do
+    $1/plink2 --pfile tmp_data --pheno phenos.txt --covar covar.txt --glm hide-covar --threads $t --out plain_t$t
+    for mib in 1 64; do
+        $1/plink2 --pfile tmp_data --pheno phenos.txt --covar covar.txt --glm hide-covar --decode-cache $mib --threads $t --out dc${mib}_t$t
+        for f in plain_t$t.*.glm.*; do
+            diff -q $f dc${mib}_${f#plain_}
+        done
+    done
+done
+# When everything fits, only the first of the four phenotypes sharing a
+# sample set decodes; B4 and PHENO1 bypass the cache.
+grep -q "^--decode-cache: 6000 hits, 2000 misses" dc64_t3.log
+
+# With no shared missingness pattern, the cache is never touched.
+$1/plink2 $2 $3 --pfile tmp_data --pheno phenos.txt --pheno-name B1 B4 --covar covar.txt --glm hide-covar --decode-cache 64 --out unique
+grep -q "^--decode-cache: 0 hits, 0 misses" unique.log
@@ -0,0 +1,38 @@
+# Writes a 60-sample, 288-variant VCF in which variants 127..143 (0-based) have
+# no missing calls, so --make-rel sees 127 missing-call variants in the first
+# 144-variant block and 144 in the second; the final partial double-missing
+# block then needs the full kDblMissingMaxBlockCt * kDblMissingBlockSize rows.
+# order=moved writes the same records with the complete variants last.
+# usage: awk -v order=orig|moved -f make_vcf.awk
+BEGIN {
+  nsamp = 60; nvar = 288;
+  seed = 12345;
+  printf "##fileformat=VCFv4.2\n##contig=<ID=1,length=100000000>\n##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT";
+  for (s = 0; s < nsamp; ++s) printf "\ts%d", s;
+  printf "\n";
+  for (v = 0; v < nvar; ++v) {
+    line = "1\t" (v + 1) * 100 "\tv" v "\tA\tC\t.\t.\t.\tGT";
+    nomiss = (v >= 127) && (v <= 143);
+    for (s = 0; s < nsamp; ++s) {
+      seed = (seed * 1103515245 + 12345) % 2147483648;
+      r = seed % 100;
+      if ((!nomiss) && ((r < 8) || (s == v % nsamp))) {
+        gt = "./.";
+      } else if (r < 45) {
+        gt = "0/0";
+      } else if (r < 80) {
+        gt = "0/1";
+      } else {
+        gt = "1/1";
+      }
+      line = line "\t" gt;
+    }
+    recs[v] = line;
+  }
+  if (order == "moved") {
+    for (v = 0; v < nvar; ++v) if ((v < 127) || (v > 143)) print recs[v];
+    for (v = 127; v <= 143; ++v) print recs[v];
+  } else {
+    for (v = 0; v < nvar; ++v) print recs[v];
+  }
+}
@@ -0,0 +1,12 @@
+#!/bin/bash
+
+set -exo pipefail
+
+awk -v order=orig -f make_vcf.awk > tmp_data.vcf
+awk -v order=moved -f make_vcf.awk > tmp_data2.vcf
+
+$1/plink2 $2 $3 --vcf tmp_data.vcf --make-rel square --out tmp_data
+$1/plink2 $2 $3 --vcf tmp_data2.vcf --make-rel square --out tmp_data2
+# Variant order only affects floating-point summation order.
+awk 'NR == FNR { for (i = 1; i <= NF; ++i) x[FNR, i] = $i; next }
+  { for (i = 1; i <= NF; ++i) { d = $i - x[FNR, i]; if ((d > 1e-5) || (d < -1e-5)) exit 1 } }' tmp_data.rel tmp_data2.rel
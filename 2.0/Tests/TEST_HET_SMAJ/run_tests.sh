@@ -0,0 +1,27 @@
+#!/bin/bash
+
+set -exo pipefail
+
+# 300 samples x 70000 variants = 5 x 2 tiles, with some missing calls.
+$1/plink2 $2 $3 --dummy 300 70000 0.02 --seed 1 --out tmp_dummy
+$1/plink2 $2 $3 --pfile tmp_dummy --make-pgen smaj-tiles --out tmp_data
+
+# --het --smaj-tiles must match plain --het, for the full sample set, a
+# clustered --keep (which skips tiles), and scattered samples with a variant
+# subset.
+$1/plink2 $2 $3 --pfile tmp_data --het --out tmp_plain
+$1/plink2 $2 $3 --pfile tmp_data --het --smaj-tiles --out tmp_smaj
+grep -q "^--het: Reading 10/10 sample-major tiles" tmp_smaj.log
+diff -q tmp_plain.het tmp_smaj.het
+
+awk 'NR > 70 && NR <= 200 { print $1 }' tmp_data.psam > keep.txt
+$1/plink2 $2 $3 --pfile tmp_data --keep keep.txt --het --out tmp_plain
+$1/plink2 $2 $3 --pfile tmp_data --keep keep.txt --het --smaj-tiles --out tmp_smaj
+grep -q "^--het: Reading 6/10 sample-major tiles" tmp_smaj.log
+diff -q tmp_plain.het tmp_smaj.het
+
+awk 'NR > 1 && NR % 3 == 2 { print $1 }' tmp_data.psam > keep.txt
+awk 'NR % 3 { print $3 }' tmp_data.pvar > extract.txt
+$1/plink2 $2 $3 --pfile tmp_data --keep keep.txt --extract extract.txt --het --out tmp_plain
+$1/plink2 $2 $3 --pfile tmp_data --keep keep.txt --extract extract.txt --het --smaj-tiles --out tmp_smaj
+diff -q tmp_plain.het tmp_smaj.het
@@ -0,0 +1,29 @@
+#!/bin/bash
+
+set -exo pipefail
+
+# 500 samples leave 29 trailing genotype bytes in the last 32-byte vector,
+# which the AVX2 subset-counting tail previously mishandled.
+$1/plink2 $2 $3 --dummy 500 3000 0.03 --seed 5 --out tmp_data
+awk 'NR == 1 { print "#IID\tCAT" } NR > 1 { c = (NR % 7 == 0)? "NONE" : substr("abc", NR % 3 + 1, 1); print $1 "\t" c }' tmp_data.psam > cats.txt
+$1/plink2 $2 $3 --pfile tmp_data --export vcf --out tmp_data
+
+# --loop-cats counts every category in one genotype pass; --keep goes through
+# the ordinary subset-counting path.  Both must agree with counts tallied
+# directly from the exported VCF.
+$1/plink2 $2 $3 --pfile tmp_data --pheno cats.txt --loop-cats CAT --freq counts --missing --hardy --out lc
+for c in a b c; do
+    awk -v c=$c '$2 == c { print $1 }' cats.txt > keep_$c.txt
+    $1/plink2 $2 $3 --pfile tmp_data --keep keep_$c.txt --freq counts --missing --hardy --out keep_$c
+    diff -q lc.$c.acount keep_$c.acount
+    diff -q lc.$c.hardy keep_$c.hardy
+    diff -q lc.$c.vmiss keep_$c.vmiss
+    awk 'NR == FNR { keep[$1] = 1; next }
+         /^#CHROM/ { for (i = 10; i <= NF; i++) { if ($i in keep) { cols[i] = 1 } } next }
+         /^#/ { next }
+         { alt_ct = 0; obs_ct = 0
+           for (i in cols) { if ($i != "./.") { split($i, g, "/"); alt_ct += g[1] + g[2]; obs_ct += 2 } }
+           print $3 "\t" alt_ct "\t" obs_ct }' keep_$c.txt tmp_data.vcf > vcf_$c.txt
+    awk 'NR > 1 { print $2 "\t" $5 "\t" $6 }' lc.$c.acount > lc_$c.txt
+    diff -q vcf_$c.txt lc_$c.txt
+done
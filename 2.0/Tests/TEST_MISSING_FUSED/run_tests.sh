@@ -0,0 +1,28 @@
+#!/bin/bash
+
+set -exo pipefail
+
+# Move part of the --dummy data to chrX and chrY, and make some sexes unknown,
+# so that the sex-specific missingness logic is exercised.
+$1/plink2 $2 $3 --dummy 300 3000 0.05 dosage-freq=0.3 --seed 2 --out tmp_dummy
+awk 'NR > 2401 && NR <= 2901 { $1 = "X" } NR > 2901 { $1 = "Y" } { print }' OFS='\t' tmp_dummy.pvar > tmp_data.pvar
+awk 'NR > 1 && NR % 5 == 0 { $2 = "NA" } { print }' OFS='\t' tmp_dummy.psam > tmp_data.psam
+cp tmp_dummy.pgen tmp_data.pgen
+
+# --missing + --freq collects sample missingness during the frequency pass;
+# --mind forces the separate sample-missingness pass.
+$1/plink2 $2 $3 --pfile tmp_data --missing --freq --out fused
+grep -q "sample missingness rates" fused.log
+$1/plink2 $2 $3 --pfile tmp_data --missing --freq --mind 0.9 --out unfused
+$1/plink2 $2 $3 --pfile tmp_data --missing --out plain
+diff -q fused.smiss unfused.smiss
+diff -q fused.smiss plain.smiss
+diff -q fused.vmiss plain.vmiss
+diff -q fused.afreq unfused.afreq
+
+# The result must not depend on how variants are split across threads.  ($2/$3
+# aren't passed to these runs, since they may also set --threads.)
+$1/plink2 --pfile tmp_data --missing --freq --threads 1 --out fused_t1
+$1/plink2 --pfile tmp_data --missing --freq --threads 3 --out fused_t3
+diff -q fused_t1.smiss fused_t3.smiss
+diff -q fused.smiss fused_t3.smiss
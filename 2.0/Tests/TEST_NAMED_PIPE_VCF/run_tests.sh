@@ -0,0 +1,21 @@
+#!/bin/bash
+
+set -exo pipefail
+
+$1/plink2 $2 $3 --dummy 33 2049 0.1 dosage-freq=0.1 --out tmp_data
+$1/plink2 $2 $3 --pfile tmp_data --export vcf vcf-dosage=DS --out tmp_data
+$1/plink2 $2 $3 --vcf tmp_data.vcf dosage=DS --out tmp_data2
+
+# The writer must still be connected when plink2 opens the pipe for real, so
+# a probing open()/close() makes this hang instead of failing.
+rm -f tmp_data.fifo
+mkfifo tmp_data.fifo
+cat tmp_data.vcf > tmp_data.fifo &
+timeout 300 $1/plink2 $2 $3 --vcf tmp_data.fifo dosage=DS --out tmp_data3
+wait
+diff -q tmp_data2.pgen tmp_data3.pgen
+diff -q tmp_data2.pvar tmp_data3.pvar
+rm -f tmp_data.fifo
+
+$1/plink2 $2 $3 --vcf <(cat tmp_data.vcf) dosage=DS --out tmp_data4
+diff -q tmp_data2.pgen tmp_data4.pgen
@@ -0,0 +1,41 @@
+# Writes a phased 1000-sample, 4500-variant VCF.  Haplotypes are mosaics of 8
+# founders with occasional switches and mutations, so the PBWT form is
+# usually smaller; a few missing calls, unphased hets, and multiallelic
+# variants exercise the other record types.  Set noise=1 to draw every
+# haplotype independently instead.
+function rnd(n) {
+  seed = (seed * 1103515245 + 12345) % 2147483648;
+  return int(seed / 65536) % n;
+}
+BEGIN {
+  nsamp = 1000; nvar = 4500; nfounder = 8;
+  seed = 2718;
+  printf "##fileformat=VCFv4.2\n##contig=<ID=1,length=100000000>\n##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT";
+  for (s = 0; s < nsamp; ++s) printf "\ts%d", s;
+  printf "\n";
+  for (h = 0; h < 2 * nsamp; ++h) src[h] = rnd(nfounder);
+  for (v = 0; v < nvar; ++v) {
+    for (f = 0; f < nfounder; ++f) fa[f] = (rnd(4) == 0);
+    multi = (rnd(100) == 0);
+    line = "1\t" (v + 1) * 100 "\tv" v "\tA\t" (multi? "C,G" : "C") "\t.\t.\t.\tGT";
+    for (s = 0; s < nsamp; ++s) {
+      for (k = 0; k < 2; ++k) {
+        h = 2 * s + k;
+        if (rnd(2000) == 0) src[h] = rnd(nfounder);
+        a[k] = noise? (rnd(4) == 0) : fa[src[h]];
+        if (rnd(5000) == 0) a[k] = 1 - a[k];
+        if (multi && a[k] && rnd(3) == 0) a[k] = 2;
+      }
+      r = rnd(1000);
+      if (r < 3) {
+        gt = "./.";
+      } else if ((r < 8) && (a[0] != a[1])) {
+        gt = a[0] "/" a[1];
+      } else {
+        gt = a[0] "|" a[1];
+      }
+      line = line "\t" gt;
+    }
+    print line;
+  }
+}
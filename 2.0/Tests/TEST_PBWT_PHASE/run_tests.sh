@@ -0,0 +1,27 @@
+#!/bin/bash
+
+set -exo pipefail
+
+awk -f make_vcf.awk > tmp_data.vcf
+$1/plink2 $2 $3 --vcf tmp_data.vcf --out tmp_data
+
+# pbwt-phase -> standard must reproduce the original .pgen exactly.
+$1/plink2 $2 $3 --pfile tmp_data --make-pgen pbwt-phase --out tmp_pbwt
+$1/plink2 $2 $3 --pfile tmp_pbwt --make-pgen --out tmp_std
+diff -q tmp_data.pgen tmp_std.pgen
+test $(stat -c %s tmp_pbwt.pgen) -lt $(stat -c %s tmp_data.pgen)
+$1/plink2 $2 $3 --pfile tmp_pbwt --validate
+
+# Subset reads start in the middle of a PBWT reset window, so they exercise
+# replay.
+awk 'NR % 7 == 3 { print $3 }' tmp_data.pvar > extract.txt
+awk 'NR > 1 && NR % 4 { print $1 }' tmp_data.psam > keep.txt
+$1/plink2 $2 $3 --pfile tmp_data --extract extract.txt --keep keep.txt --make-pgen --out tmp_sub
+$1/plink2 $2 $3 --pfile tmp_pbwt --extract extract.txt --keep keep.txt --make-pgen --out tmp_pbwt_sub
+diff -q tmp_sub.pgen tmp_pbwt_sub.pgen
+$1/plink2 $2 $3 --pfile tmp_data --extract extract.txt --export vcf --out tmp_sub
+$1/plink2 $2 $3 --pfile tmp_pbwt --extract extract.txt --export vcf --out tmp_pbwt_sub
+diff -q <(sed '/^##fileDate/ d' tmp_sub.vcf) <(sed '/^##fileDate/ d' tmp_pbwt_sub.vcf)
+$1/plink2 $2 $3 --pfile tmp_data --from v3000 --to v3100 --keep keep.txt --export vcf --out tmp_sub
+$1/plink2 $2 $3 --pfile tmp_pbwt --from v3000 --to v3100 --keep keep.txt --export vcf --out tmp_pbwt_sub
+diff -q <(sed '/^##fileDate/ d' tmp_sub.vcf) <(sed '/^##fileDate/ d' tmp_pbwt_sub.vcf)
@@ -0,0 +1,30 @@
+# Writes a 200-sample VCF with 1500 variants on each of chromosomes 1-3:
+# mostly-phased hardcalls, with DS dosages on chromosome 2 only.
+function rnd(n) {
+  seed = (seed * 1103515245 + 12345) % 2147483648;
+  return int(seed / 65536) % n;
+}
+BEGIN {
+  nsamp = 200; nvar = 1500;
+  seed = 1618;
+  printf "##fileformat=VCFv4.2\n";
+  for (c = 1; c <= 3; ++c) printf "##contig=<ID=%d,length=100000000>\n", c;
+  printf "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n##FORMAT=<ID=DS,Number=A,Type=Float,Description=\"Dosage\">\n#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT";
+  for (s = 0; s < nsamp; ++s) printf "\ts%d", s;
+  printf "\n";
+  for (c = 1; c <= 3; ++c) {
+    for (v = 0; v < nvar; ++v) {
+      freq = 1 + rnd(9);
+      line = c "\t" (v + 1) * 100 "\t" c ":" v "\tA\tC\t.\t.\t.\t" ((c == 2)? "GT:DS" : "GT");
+      for (s = 0; s < nsamp; ++s) {
+        a0 = (rnd(10) < freq); a1 = (rnd(10) < freq);
+        gt = (rnd(100) == 0)? "./." : (a0 ((rnd(20) == 0)? "/" : "|") a1);
+        if (c == 2) {
+          gt = gt ":" ((gt == "./.")? "." : sprintf("%.3f", a0 + a1 - 0.001 * rnd(200) * (a0 + a1 - 1)));
+        }
+        line = line "\t" gt;
+      }
+      print line;
+    }
+  }
+}
@@ -0,0 +1,34 @@
+#!/bin/bash
+
+set -exo pipefail
+
+awk -f make_vcf.awk > tmp_data.vcf
+$1/plink2 $2 $3 --vcf tmp_data.vcf dosage=DS --out tmp_data
+rm -f tmp_list.txt
+for chr in 1 2 3; do
+  $1/plink2 $2 $3 --pfile tmp_data --chr $chr --make-pgen --out tmp_chr$chr
+  echo tmp_chr$chr >> tmp_list.txt
+done
+
+# The per-chromosome filesets, read as one virtual fileset, must behave like
+# the original.
+$1/plink2 $2 $3 --pfile tmp_data --freq --out tmp_data
+$1/plink2 $2 $3 --pfile-list tmp_list.txt --freq --out tmp_list
+diff -q tmp_data.afreq tmp_list.afreq
+# (--make-pgen drops the all-missing QUAL and FILTER columns.)
+$1/plink2 $2 $3 --pfile tmp_data --make-pgen --out tmp_ref
+$1/plink2 $2 $3 --pfile-list tmp_list.txt --make-pgen --out tmp_list
+diff -q tmp_ref.pgen tmp_list.pgen
+diff -q tmp_ref.pvar tmp_list.pvar
+diff -q tmp_ref.psam tmp_list.psam
+
+# Subset reads, with --extract selecting variants from every member.
+awk 'NR % 5 == 2 { print $3 }' tmp_data.pvar > extract.txt
+awk 'NR > 1 && NR % 3 { print $1 }' tmp_data.psam > keep.txt
+$1/plink2 $2 $3 --pfile tmp_data --extract extract.txt --keep keep.txt --make-pgen --out tmp_sub
+$1/plink2 $2 $3 --pfile-list tmp_list.txt --extract extract.txt --keep keep.txt --make-pgen --out tmp_list_sub
+diff -q tmp_sub.pgen tmp_list_sub.pgen
+diff -q tmp_sub.pvar tmp_list_sub.pvar
+$1/plink2 $2 $3 --pfile tmp_data --keep keep.txt --freq --out tmp_sub
+$1/plink2 $2 $3 --pfile-list tmp_list.txt --keep keep.txt --freq --out tmp_list_sub
+diff -q tmp_sub.afreq tmp_list_sub.afreq
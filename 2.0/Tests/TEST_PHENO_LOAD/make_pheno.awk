@@ -0,0 +1,37 @@
+# Writes a wide phenotype file for the IID-only .psam on stdin.
+# Columns cycle through quantitative, case/control, and categorical types, so
+# that the threaded loader sees all three in every line batch.  Every 7th
+# sample is omitted, and IDs absent from the .psam are interspersed.
+BEGIN {
+  delim = "\t"
+  ncol = 64
+  srand(1)
+  header = "#IID"
+  for (c = 1; c <= ncol; c++) {
+    header = header delim "P" c
+  }
+  print header
+}
+NR > 1 && (NR % 7) {
+  if (!(NR % 11)) {
+    line = "absent" NR
+    for (c = 1; c <= ncol; c++) {
+      line = line delim "1"
+    }
+    print line
+  }
+  line = $1
+  for (c = 1; c <= ncol; c++) {
+    r = rand()
+    t = c % 3
+    if (t == 0) {
+      v = (r < 0.05) ? "NA" : sprintf("%.6g", (r - 0.5) * 100)
+    } else if (t == 1) {
+      v = (r < 0.05) ? "-9" : ((r < 0.5) ? "1" : "2")
+    } else {
+      v = (r < 0.05) ? "NONE" : ("cat" int(r * 17))
+    }
+    line = line delim v
+  }
+  print line
+}
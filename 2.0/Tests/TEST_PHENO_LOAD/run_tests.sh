@@ -0,0 +1,73 @@
+#!/bin/bash
+
+set -exo pipefail
+
+$1/plink2 $2 $3 --dummy 20000 1 --out tmp_data
+awk -f make_pheno.awk tmp_data.psam > pheno.txt
+rm -f pheno.txt.*.cache
+
+# Line batches are split across threads, so results must not depend on the
+# thread count.  ($2/$3 aren't passed to these runs, since they may also set
+# --threads.)
+$1/plink2 --pfile tmp_data --pheno pheno.txt --threads 1 --make-just-psam --out t1
+$1/plink2 --pfile tmp_data --pheno pheno.txt --threads 4 --make-just-psam --out t4
+diff -q t1.psam t4.psam
+$1/plink2 --pfile tmp_data --covar pheno.txt --threads 1 --write-covar --out c1
+$1/plink2 --pfile tmp_data --covar pheno.txt --threads 4 --write-covar --out c4
+diff -q c1.cov c4.cov
+
+# --pheno-name subset, combined with --keep
+awk 'NR > 1 && NR % 3 { print $1 }' tmp_data.psam > keep.txt
+$1/plink2 --pfile tmp_data --pheno pheno.txt --pheno-name P3-P40 --keep keep.txt --threads 1 --make-just-psam --out n1
+$1/plink2 --pfile tmp_data --pheno pheno.txt --pheno-name P3-P40 --keep keep.txt --threads 4 --make-just-psam --out n4
+diff -q n1.psam n4.psam
+
+# The earliest malformed line is reported, regardless of which thread hit it.
+awk 'NR == 15000 { $30 = "1.5x" } NR == 18000 { $5 = "12y" } { print }' OFS='\t' pheno.txt > bad.txt
+if $1/plink2 --pfile tmp_data --pheno bad.txt --threads 4 --make-just-psam --out bad; then
+    exit 1
+fi
+grep -q "Invalid numeric token '1.5x' on line 15000 of bad.txt" bad.log
+awk 'NR == 17000 { NF = 20 } { print }' OFS='\t' pheno.txt > short.txt
+if $1/plink2 --pfile tmp_data --pheno short.txt --threads 4 --make-just-psam --out short; then
+    exit 1
+fi
+grep -q "Line 17000 of short.txt has fewer tokens than expected" short.log
+
+# --pheno-cache: the first run writes the cache, later runs load it.
+$1/plink2 $2 $3 --pfile tmp_data --pheno pheno.txt --covar pheno.txt --covar-name P1-P9 --pheno-cache --write-covar --make-just-psam --out pc1
+grep -q "Cache written to pheno.txt.pheno.cache" pc1.log
+grep -q "Cache written to pheno.txt.covar.cache" pc1.log
+$1/plink2 $2 $3 --pfile tmp_data --pheno pheno.txt --covar pheno.txt --covar-name P1-P9 --pheno-cache --write-covar --make-just-psam --out pc2
+grep -q "Using pheno.txt.pheno.cache" pc2.log
+grep -q "Using pheno.txt.covar.cache" pc2.log
+$1/plink2 $2 $3 --pfile tmp_data --pheno pheno.txt --covar pheno.txt --covar-name P1-P9 --write-covar --make-just-psam --out pc0
+for i in 1 2; do
+    diff -q pc0.psam pc$i.psam
+    diff -q pc0.cov pc$i.cov
+done
+
+# A different sample filter or column selection invalidates the cache.
+$1/plink2 $2 $3 --pfile tmp_data --keep keep.txt --covar pheno.txt --covar-name P1-P5 --pheno-cache --write-covar --out pc3
+grep -q "Cache written to pheno.txt.covar.cache" pc3.log
+$1/plink2 $2 $3 --pfile tmp_data --keep keep.txt --covar pheno.txt --covar-name P1-P5 --write-covar --out pc4
+diff -q pc3.cov pc4.cov
+
+# So does a modified source file.
+awk 'NR == 2 { $2 = "7" } { print }' OFS='\t' pheno.txt > pheno2.txt
+cp pheno.txt.pheno.cache pheno2.txt.pheno.cache
+touch -d '2001-01-01' pheno2.txt
+$1/plink2 $2 $3 --pfile tmp_data --pheno pheno2.txt --pheno-cache --make-just-psam --out pc5
+grep -q "Cache written to pheno2.txt.pheno.cache" pc5.log
+$1/plink2 $2 $3 --pfile tmp_data --pheno pheno2.txt --make-just-psam --out pc6
+diff -q pc5.psam pc6.psam
+
+# A corrupted (same-size) cache with out-of-range category codes must be
+# rejected and rebuilt.  Offset: 64-byte header, "P2\0", 16-byte column
+# header, then the 2504-byte nonmiss bitarray for 20000 samples.
+$1/plink2 $2 $3 --pfile tmp_data --pheno pheno2.txt --pheno-name P2 --pheno-cache --make-just-psam --out pc7
+grep -q "Cache written to pheno2.txt.pheno.cache" pc7.log
+for i in $(seq 100); do printf '\xf0\xff\xff\x7f'; done | dd of=pheno2.txt.pheno.cache bs=1 seek=2587 conv=notrunc
+$1/plink2 $2 $3 --pfile tmp_data --pheno pheno2.txt --pheno-name P2 --pheno-cache --make-just-psam --out pc8
+grep -q "Cache written to pheno2.txt.pheno.cache" pc8.log
+diff -q pc7.psam pc8.psam
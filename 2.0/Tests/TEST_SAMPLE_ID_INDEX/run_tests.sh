@@ -0,0 +1,54 @@
+#!/bin/bash
+
+set -exo pipefail
+
+$1/plink2 $2 $3 --dummy 1000 200 0.05 --out tmp_data
+rm -f tmp_data.psam.xidx
+
+awk 'NR > 1 && NR % 3 == 0 { print $1 }' tmp_data.psam > keep.txt
+awk 'NR > 1 && NR % 7 == 0 { print $1 }' tmp_data.psam > remove.txt
+awk 'BEGIN { print "#IID\tQT\tQT2" } NR > 1 && NR % 5 != 0 { print $1"\t"(NR % 11)"\t"(NR % 13) }' tmp_data.psam > pheno.txt
+
+$1/plink2 $2 $3 --pfile tmp_data --keep keep.txt --remove remove.txt --pheno pheno.txt --make-pgen --out plain
+# first run writes the index, second run uses it
+$1/plink2 $2 $3 --pfile tmp_data --keep keep.txt --remove remove.txt --pheno pheno.txt --sample-id-index --make-pgen --out idx1
+grep -q "written to tmp_data.psam.xidx" idx1.log
+$1/plink2 $2 $3 --pfile tmp_data --keep keep.txt --remove remove.txt --pheno pheno.txt --sample-id-index --make-pgen --out idx2
+grep -q "Using tmp_data.psam.xidx" idx2.log
+for i in 1 2; do
+    diff -q plain.psam idx$i.psam
+    diff -q plain.pgen idx$i.pgen
+done
+
+# --remove before --keep's sample set, and --pheno on a subset
+$1/plink2 $2 $3 --pfile tmp_data --remove keep.txt --pheno pheno.txt --make-pgen --out plain_rm
+$1/plink2 $2 $3 --pfile tmp_data --remove keep.txt --pheno pheno.txt --sample-id-index --make-pgen --out idx_rm
+diff -q plain_rm.psam idx_rm.psam
+
+# stale index (sample IDs changed) must be detected and rebuilt
+awk 'NR == 1 { print; next } { $1 = $1"x"; print }' OFS='\t' tmp_data.psam > tmp_data_renamed.psam
+cp tmp_data.psam.xidx tmp_data_renamed.psam.xidx
+awk '{ print $1"x" }' keep.txt > keep_renamed.txt
+$1/plink2 $2 $3 --pgen tmp_data.pgen --pvar tmp_data.pvar --psam tmp_data_renamed.psam --keep keep_renamed.txt --make-pgen --out plain_renamed
+$1/plink2 $2 $3 --pgen tmp_data.pgen --pvar tmp_data.pvar --psam tmp_data_renamed.psam --keep keep_renamed.txt --sample-id-index --make-pgen --out idx_renamed
+grep -q "written to tmp_data_renamed.psam.xidx" idx_renamed.log
+diff -q plain_renamed.psam idx_renamed.psam
+
+# corrupted index (same size, out-of-range table entries) must be rejected and
+# rebuilt
+for i in $(seq 64); do printf '\xf0\xff\xff\x7f'; done | dd of=tmp_data.psam.xidx bs=1 seek=64 conv=notrunc
+$1/plink2 $2 $3 --pfile tmp_data --keep keep.txt --remove remove.txt --pheno pheno.txt --sample-id-index --make-pgen --out idx_bad
+grep -q "written to tmp_data.psam.xidx" idx_bad.log
+diff -q plain.psam idx_bad.psam
+diff -q plain.pgen idx_bad.pgen
+
+# duplicate FID/IID pairs distinguished by SID
+awk 'NR == 1 { print "#FID\tIID\tSID\tSEX\tPHENO1"; next } { print "f"(int(NR / 2) % 3)"\tp"int(NR / 2)"\ts"NR"\t"$2"\t"$3 }' tmp_data.psam > tmp_sid.psam
+awk 'NR > 1 && NR % 4 == 0 { print $1"\t"$2 }' tmp_sid.psam > remove_dup.txt
+awk 'NR == 1 || NR % 3 != 1 { print $1"\t"$2"\t"$3 }' tmp_sid.psam > keep_sid.txt
+$1/plink2 $2 $3 --pgen tmp_data.pgen --pvar tmp_data.pvar --psam tmp_sid.psam --keep keep_sid.txt --remove remove_dup.txt --make-pgen --out plain_sid
+$1/plink2 $2 $3 --pgen tmp_data.pgen --pvar tmp_data.pvar --psam tmp_sid.psam --keep keep_sid.txt --remove remove_dup.txt --sample-id-index --make-pgen --out idx_sid
+$1/plink2 $2 $3 --pgen tmp_data.pgen --pvar tmp_data.pvar --psam tmp_sid.psam --keep keep_sid.txt --remove remove_dup.txt --sample-id-index --make-pgen --out idx_sid2
+grep -q "Using tmp_sid.psam.xidx" idx_sid2.log
+diff -q plain_sid.psam idx_sid.psam
+diff -q plain_sid.psam idx_sid2.psam
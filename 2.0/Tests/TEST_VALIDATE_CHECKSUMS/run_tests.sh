@@ -0,0 +1,19 @@
+#!/bin/bash
+
+set -exo pipefail
+
+# 140000 variants = 3 vblocks.
+$1/plink2 $2 $3 --dummy 20 140000 --out tmp_data
+$1/plink2 $2 $3 --pfile tmp_data --validate write-checksums --out tmp_write
+$1/plink2 $2 $3 --pfile tmp_data --validate checksums --out tmp_check
+
+# Flip one byte in the middle of vblock 1; only that region may be reported.
+fpos=$(awk '$1 == "1" { print int(($2 + $3) / 2) }' tmp_data.pgen.xxh64)
+byte=$(od -An -tu1 -j $fpos -N1 tmp_data.pgen)
+printf "\\$(printf %o $((byte ^ 255)))" | dd of=tmp_data.pgen bs=1 seek=$fpos conv=notrunc
+if $1/plink2 $2 $3 --pfile tmp_data --validate checksums --out tmp_check; then
+  exit 1
+fi
+grep -q "^Error: 1/4 checksum regions" tmp_check.log
+sed -n '/^Error: /,$ p' tmp_check.log | grep "^  " > tmp_regions.txt
+echo "  vblock 1 (variants #65537-#131072)" | diff -q - tmp_regions.txt
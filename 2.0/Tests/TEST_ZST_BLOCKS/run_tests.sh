@@ -0,0 +1,34 @@
+#!/bin/bash
+
+set -exo pipefail
+
+# Same phased mosaic data as TEST_PBWT_PHASE; 4500 variants span two zstd
+# record groups, and the second one is partial.
+awk -f ../TEST_PBWT_PHASE/make_vcf.awk > tmp_data.vcf
+$1/plink2 $2 $3 --vcf tmp_data.vcf --out tmp_data
+
+# zst-blocks (alone, and combined with pbwt-phase) -> standard must reproduce
+# the original .pgen exactly.
+$1/plink2 $2 $3 --pfile tmp_data --make-pgen zst-blocks --out tmp_zst
+$1/plink2 $2 $3 --pfile tmp_zst --make-pgen --out tmp_std
+diff -q tmp_data.pgen tmp_std.pgen
+test $(stat -c %s tmp_zst.pgen) -lt $(stat -c %s tmp_data.pgen)
+$1/plink2 $2 $3 --pfile tmp_zst --validate
+$1/plink2 $2 $3 --pfile tmp_data --make-pgen zst-blocks pbwt-phase --out tmp_zp
+$1/plink2 $2 $3 --pfile tmp_zp --make-pgen --out tmp_std
+diff -q tmp_data.pgen tmp_std.pgen
+$1/plink2 $2 $3 --pfile tmp_zp --validate
+
+# Subset reads, including a range that starts inside the second group.
+awk 'NR % 7 == 3 { print $3 }' tmp_data.pvar > extract.txt
+awk 'NR > 1 && NR % 4 { print $1 }' tmp_data.psam > keep.txt
+$1/plink2 $2 $3 --pfile tmp_data --extract extract.txt --keep keep.txt --make-pgen --out tmp_sub
+for prefix in tmp_zst tmp_zp; do
+  $1/plink2 $2 $3 --pfile $prefix --extract extract.txt --keep keep.txt --make-pgen --out ${prefix}_sub
+  diff -q tmp_sub.pgen ${prefix}_sub.pgen
+done
+$1/plink2 $2 $3 --pfile tmp_data --from v4200 --to v4300 --keep keep.txt --export vcf --out tmp_sub
+for prefix in tmp_zst tmp_zp; do
+  $1/plink2 $2 $3 --pfile $prefix --from v4200 --to v4300 --keep keep.txt --export vcf --out ${prefix}_sub
+  diff -q <(sed '/^##fileDate/ d' tmp_sub.vcf) <(sed '/^##fileDate/ d' ${prefix}_sub.vcf)
+done
@@ -48,4 +48,69 @@ cd TEST_DOSAGE_ROUND_TRIP
 cd ..
 echo "TEST_DOSAGE_ROUND_TRIP passed."
 
+cd TEST_GRM_MISSING_BLOCK
+./run_tests.sh $d $2 $3 > TEST_GRM_MISSING_BLOCK.log
+cd ..
+echo "TEST_GRM_MISSING_BLOCK passed."
+
+cd TEST_NAMED_PIPE_VCF
+./run_tests.sh $d $2 $3 > TEST_NAMED_PIPE_VCF.log
+cd ..
+echo "TEST_NAMED_PIPE_VCF passed."
+
+cd TEST_SAMPLE_ID_INDEX
+./run_tests.sh $d $2 $3 > TEST_SAMPLE_ID_INDEX.log
+cd ..
+echo "TEST_SAMPLE_ID_INDEX passed."
+
+cd TEST_PHENO_LOAD
+./run_tests.sh $d $2 $3 > TEST_PHENO_LOAD.log
+cd ..
+echo "TEST_PHENO_LOAD passed."
+
+cd TEST_DOSAGE_DELTA
+./run_tests.sh $d $2 $3 > TEST_DOSAGE_DELTA.log
+cd ..
+echo "TEST_DOSAGE_DELTA passed."
+
+cd TEST_PBWT_PHASE
+./run_tests.sh $d $2 $3 > TEST_PBWT_PHASE.log
+cd ..
+echo "TEST_PBWT_PHASE passed."
+
+cd TEST_ZST_BLOCKS
+./run_tests.sh $d $2 $3 > TEST_ZST_BLOCKS.log
+cd ..
+echo "TEST_ZST_BLOCKS passed."
+
+cd TEST_VALIDATE_CHECKSUMS
+./run_tests.sh $d $2 $3 > TEST_VALIDATE_CHECKSUMS.log
+cd ..
+echo "TEST_VALIDATE_CHECKSUMS passed."
+
+cd TEST_PFILE_LIST
+./run_tests.sh $d $2 $3 > TEST_PFILE_LIST.log
+cd ..
+echo "TEST_PFILE_LIST passed."
+
+cd TEST_HET_SMAJ
+./run_tests.sh $d $2 $3 > TEST_HET_SMAJ.log
+cd ..
+echo "TEST_HET_SMAJ passed."
+
+cd TEST_MISSING_FUSED
+./run_tests.sh $d $2 $3 > TEST_MISSING_FUSED.log
+cd ..
+echo "TEST_MISSING_FUSED passed."
+
+cd TEST_LOOP_CATS
+./run_tests.sh $d $2 $3 > TEST_LOOP_CATS.log
+cd ..
+echo "TEST_LOOP_CATS passed."
+
+cd TEST_GLM_DECODE_CACHE
+./run_tests.sh $d $2 $3 > TEST_GLM_DECODE_CACHE.log
+cd ..
+echo "TEST_GLM_DECODE_CACHE passed."
+
 echo "All tests passed."
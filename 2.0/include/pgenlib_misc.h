@@ -76,6 +76,27 @@
 
 #include "plink2_bits.h"
 
+// Define PGENLIB_ZSTD to support reading and writing zstd-compressed variant
+// record groups (mode byte bit 2, see below).  This adds a libzstd dependency,
+// so it's off by default.
+#ifdef PGENLIB_ZSTD
+#  ifdef STATIC_ZSTD
+#    include "../zstd/lib/zstd.h"
+#  else
+#    include <zstd.h>
+#  endif
+#endif
+
+// The entropy-coding stage of dosage-delta tracks (mode byte bit 3) uses
+// zstd's FSE primitives.  Shared libzstd builds don't export them, so builds
+// that link libzstd dynamically must also compile the bundled FSE sources
+// (FSECSRC in Makefile.src); otherwise every PGENLIB_ZSTD build could write
+// files that some other PGENLIB_ZSTD build can't read.
+#ifdef PGENLIB_ZSTD
+#  define PGENLIB_FSE
+#  include "../zstd/lib/common/fse.h"
+#endif
+
 // 10000 * major + 100 * minor + patch
 // Exception to CONSTI32, since we want the preprocessor to have access to this
 // value.  Named with all caps as a consequence.
@@ -592,6 +613,22 @@ HEADER_INLINE double MultiallelicDiploidMachR2(const uint64_t* __restrict sums,
 
 CONSTI32(kPglVblockSize, 65536);
 
+// PBWT hardcall-phase state (mode 0x12) is reset at every multiple of this;
+// must be a power of 2 dividing kPglVblockSize.
+CONSTI32(kPglPbwtResetInterval, 2048);
+
+// 4-byte run list offset, 4-byte run list length, format byte
+CONSTI32(kPglPbwtTrailerByteCt, 9);
+
+// Range of log2(variants per zstd-compressed record group) (mode byte bit 2).
+// Groups never straddle a vblock boundary.
+CONSTI32(kPglZstGroupLgMin, 4);
+CONSTI32(kPglZstGroupLgMax, 16);
+
+// Dosage-delta trailer (mode byte bit 3): 4-byte coded region offset, 4-byte
+// coded region length, format byte
+CONSTI32(kPglDosageDeltaTrailerByteCt, 9);
+
 // Currently chosen so that it plus kPglFwriteBlockSize + kCacheline - 2 is
 // < 2^32, so DivUp(kPglMaxBytesPerVariant + kPglFwriteBlockSize - 1,
 // kCacheline) doesn't overflow.
@@ -613,7 +650,22 @@ FLAGSET_DEF_START()
   kfPgenGlobalHardcallPhasePresent = (1 << 3),
   kfPgenGlobalDosagePresent = (1 << 4),
   kfPgenGlobalDosagePhasePresent = (1 << 5),
-  kfPgenGlobalAllNonref = (1 << 6)
+  kfPgenGlobalAllNonref = (1 << 6),
+
+  // Mode 0x12: biallelic hardcall-phase tracks may be PBWT-coded.  Writers
+  // request it by including this in phase_dosage_gflags along with
+  // kfPgenGlobalHardcallPhasePresent.
+  kfPgenGlobalPbwtHphase = (1 << 7),
+
+  // Mode byte bit 2: variant records are stored as independently
+  // zstd-compressed groups.  Writers request it by including this in
+  // phase_dosage_gflags; requires PGENLIB_ZSTD.
+  kfPgenGlobalZstdRecords = (1 << 8),
+
+  // Mode byte bit 3: dosage tracks may store hardcall deltas instead of raw
+  // 16-bit values.  Writers request it by including this in
+  // phase_dosage_gflags along with kfPgenGlobalDosagePresent.
+  kfPgenGlobalDosageDelta = (1 << 9)
 FLAGSET_DEF_END(PgenGlobalFlags);
 
 // difflist/LD compression must not involve more than
@@ -702,9 +754,17 @@ void PglMultiallelicSparseToDenseMiss(const PgenVariant* pgvp, uint32_t sample_c
 //      0x10 = variable-type and/or variable-length records present.
 //      0x11 = mode 0x10, but with phase set information at the end of the
 //             file.
-//      0x05..0x0f and 0x12..0x7f are reserved for possible use by future
-//      versions of the PGEN specification, and 0 is off-limits (PLINK 1
-//      sample-major .bed).
+//      0x12 = mode 0x10, but biallelic hardcall-phase tracks may be
+//             PBWT-coded (see bit 4 below).
+//      0x14 = mode 0x10, but variant records are zstd-compressed in groups
+//             (see 4c).
+//      0x16 = modes 0x12 and 0x14 combined.
+//      0x18 = mode 0x10, but dosage tracks may be dosage-delta-coded (see
+//             bits 5-6 below).  0x1a, 0x1c, and 0x1e combine this with modes
+//             0x12, 0x14, and 0x16 respectively.
+//      0x05..0x0f, 0x13, 0x15, 0x17, 0x19, 0x1b, 0x1d, and 0x1f..0x7f are
+//      reserved for possible use by future versions of the PGEN
+//      specification, and 0 is off-limits (PLINK 1 sample-major .bed).
 //      0x80..0xff can be safely used by developers for their own purposes.
 //
 // 3. If not plink1-format,
@@ -749,7 +809,7 @@ void PglMultiallelicSparseToDenseMiss(const PgenVariant* pgvp, uint32_t sample_c
 //       Bits 0-5 do not apply to the fixed-length modes (currently 0x02-0x04)
 //       and should be zeroed out in that case.
 //
-// 4. If mode 0x10/0x11,
+// 4. If mode 0x10-0x1e,
 //    a. Array of 8-byte fpos values for the first variant in each vblock.
 //       (Note that this suggests a way to support in-place insertions: some
 //       unused space can be left between the vblocks.)
@@ -764,6 +824,14 @@ void PglMultiallelicSparseToDenseMiss(const PgenVariant* pgvp, uint32_t sample_c
 //       iii. if bits 4-5 of {3c} aren't 00, array of alt allele counts.
 //        iv. nonref flags info, if explicitly stored
 //      (this representation allows more efficient random access)
+//    c. If mode byte bit 2 is set, the zstd group table, ending exactly at the
+//       first variant record's fpos (so it can be located from {4a}).  This
+//       consists of a 4-byte compressed size for each group, followed by a
+//       single byte g in [4, 16]; each group contains 2^g variants (except
+//       the last may be shorter).  All fpos values and record lengths in {4a}
+//       and {4b} refer to the *uncompressed* record stream, which starts at
+//       the same fpos as the compressed stream.  Each group is a single zstd
+//       frame, so random access is still possible with group granularity.
 //    If mode 0x02-0x04, and nonref flags info explicitly stored, just that
 //    bitarray.
 //
@@ -903,6 +971,27 @@ void PglMultiallelicSparseToDenseMiss(const PgenVariant* pgvp, uint32_t sample_c
 //        subsetting).
 //        By default, entire chromosomes/contigs are assumed to be phased
 //        together.  (Todo: support contiguous phase sets.)
+//        In mode 0x12, every record with bit 4 set and bit 3 unset ends with a
+//        trailer whose last byte is 0 (1-byte trailer, track #2 stored as
+//        above) or 1 (9-byte trailer, track #2 is PBWT-coded).  In the latter
+//        case, the first 4 trailer bytes are the offset of the PBWT run list
+//        from the start of the record, and the next 4 are its byte count.
+//        PBWT-coded track #2 starts with the usual first part when
+//        phasepresent is explicit, or just a zero byte when it isn't, so het
+//        and phased-het counts can be determined the usual way; the run list
+//        follows.
+//        Samples are mapped to haplotype pairs as 0/0 -> (0, 0), 0/1 ->
+//        (0, 1) if unphased or unswapped and (1, 0) if swapped, 1/1 ->
+//        (1, 1), missing -> (0, 0).  The 2N haplotype bits are permuted by
+//        the positional Burrows-Wheeler transform ordering, and the run list
+//        is a sequence of varints storing lengths of alternating runs of 0s
+//        and 1s in permuted order, starting with a (possibly empty) 0-run;
+//        the final run is implied.  The ordering is reset to the identity
+//        permutation at every multiple of kPglPbwtResetInterval, and every
+//        such record advances it (via the usual stable partition of
+//        0-haplotypes before 1-haplotypes), with one exception: records with
+//        LD-compressed genotypes and a 1-byte trailer are skipped.  (So the
+//        ordering can always be replayed without an LD base.)
 //
 // bits 5-6:
 //   00 = no dosage data.
@@ -936,6 +1025,20 @@ void PglMultiallelicSparseToDenseMiss(const PgenVariant* pgvp, uint32_t sample_c
 //   11 = dosage bitarray.  In this case, auxiliary data track #3 contains an
 //        array of 1-bit values indicating which samples have dosages.  If the
 //        variant is multiallelic, tracks #5 and 6 are as described above.
+//   When mode byte bit 3 is set, every record with a dosage track ends with a
+//   trailer, placed before the mode 0x12 trailer if there is one.  Its last
+//   byte is 0 (1-byte trailer, track #4 stored as above), 1, or 2 (9-byte
+//   trailer, track #4 is dosage-delta-coded).  In the latter case, the first
+//   4 trailer bytes are the offset of the coded track from the start of the
+//   record, and the next 4 are its byte count.  Each dosage d is mapped to
+//   (z << 2) | h, where h = 3 and z = 0 if d is the 65535 missing value, and
+//   otherwise h is the nearest hardcall round(d / 16384) and z is the zigzag
+//   encoding of d - 16384h.  These values are stored as a varint sequence in
+//   format 1; in format 2, the coded track is a varint storing the byte count
+//   of that sequence, followed by the sequence's FSE-compressed form (zstd's
+//   FSE_compress() format).  Since imputed dosages cluster tightly around
+//   hardcalls, this is usually much smaller than 16 bits per value.
+//   Multiallelic tracks #5-6 are not affected.
 //   bgen 1.2 format no longer permits fractional missingness, so no good
 //   reason for us to support it.
 //   Considered putting *all* dosage data at the end of the file (like I will
@@ -155,7 +155,10 @@ void GenoarrbCountSubsetFreqs(const unsigned char* genoarrb, const uintptr_t* __
         cur_geno_word1 = *genoarrb_iter++;
         cur_geno_word2 = *genoarrb_iter++;
       } else {
-        const uint32_t remaining_byte_ct = NypCtToByteCt(raw_sample_ct) % kBytesPerVec;
+        // bugfix (18 Oct 2026): remainder within the trailing half-vector, not
+        // the trailing vector.  Previously, >16 trailing bytes produced
+        // garbage subset counts.
+        const uint32_t remaining_byte_ct = NypCtToByteCt(raw_sample_ct) % (kBytesPerVec / 2);
         // todo: check if this harms usual-case loop efficiency
         vechalf_idx = 1;
         if (remaining_byte_ct < kBytesPerWord) {
@@ -373,6 +376,8 @@ double BiallelicDiploidMinimac3R2(uint64_t alt1_dosage, uint64_t hap_alt1_ssq_x2
 void PreinitPgfi(PgenFileInfo* pgfip) {
   pgfip->shared_ff = nullptr;
   pgfip->block_base = nullptr;
+  pgfip->zst_dctx = nullptr;
+  pgfip->member_ct = 0;
   // we want this for proper handling of e.g. sites-only VCFs
   pgfip->nonref_flags = nullptr;
 }
@@ -389,7 +394,7 @@ uint32_t CountPgfiAllocCachelinesRequired(uint32_t raw_variant_ct) {
   return cachelines_required;
 }
 
-uint32_t CountPgrAllocCachelinesRequired(uint32_t raw_sample_ct, PgenGlobalFlags gflags, uint32_t max_allele_ct, uint32_t fread_buf_byte_ct) {
+uint32_t CountPgrAllocCachelinesRequired(uint32_t raw_sample_ct, PgenGlobalFlags gflags, uint32_t max_allele_ct, uint32_t fread_buf_byte_ct, uint32_t max_vrec_width) {
   // ldbase_raw_genovec: always needed, 2 bits per entry, up to raw_sample_ct
   // entries
   const uint32_t genovec_cacheline_req = NypCtToCachelineCt(raw_sample_ct);
@@ -438,6 +443,15 @@ uint32_t CountPgrAllocCachelinesRequired(uint32_t raw_sample_ct, PgenGlobalFlags
     if (gflags & kfPgenGlobalHardcallPhasePresent) {
       // workspace_all_hets, workspace_subset
       cachelines_required += bitvec_cacheline_req * 2;
+      if (gflags & kfPgenGlobalPbwtHphase) {
+        // pbwt_order, pbwt_order_tmp, pbwt_haps, pbwt_workspace
+        cachelines_required += 2 * Int32CtToCachelineCt(2 * S_CAST(uintptr_t, raw_sample_ct)) + genovec_cacheline_req + 3 * bitvec_cacheline_req;
+        // pbwt_fread_buf.  Unlike fread_buf, this is always counted here,
+        // since callers don't know about it and use_blockload doesn't
+        // reliably predict the PgrInit() mode (see e.g. SingleVariantLoader
+        // initialization in plink2.cc).
+        cachelines_required += DivUp(max_vrec_width, kCacheline);
+      }
     }
     if (gflags & kfPgenGlobalDosagePresent) {
       // aux track #3: usually bitarray tracking which samples have dosage info
@@ -455,6 +469,14 @@ uint32_t CountPgrAllocCachelinesRequired(uint32_t raw_sample_ct, PgenGlobalFlags
       // unphased aux track #4: 2 bytes per sample
       // cachelines_required += DivUp(2 * k1LU * raw_sample_ct, kCacheline);
 
+      if (gflags & kfPgenGlobalDosageDelta) {
+        // ddelta_vrec_buf (always counted, like pbwt_fread_buf); a coded
+        // track #4 expands to at most 2 bytes per sample
+        cachelines_required += DivUp(max_vrec_width + 2 * S_CAST(uintptr_t, raw_sample_ct), kCacheline);
+        // ddelta_varint_buf
+        cachelines_required += DivUp(3 * S_CAST(uintptr_t, raw_sample_ct), kCacheline);
+      }
+
       // may need deltalist64 workspace in multiallelic dosage case
     }
   }
@@ -467,6 +489,13 @@ PglErr PgfiInitPhase1(const char* fname, uint32_t raw_variant_ct, uint32_t raw_s
   pgfip->vrtypes = nullptr;
   pgfip->allele_idx_offsets = nullptr;
   pgfip->nonref_flags = nullptr;
+  pgfip->zst_group_fpos = nullptr;
+  pgfip->zst_dctx = nullptr;
+  pgfip->member_fnames = nullptr;
+  pgfip->member_fpos_starts = nullptr;
+  pgfip->member_record_fpos = nullptr;
+  pgfip->member_ct = 0;
+  pgfip->ff_member_idx = 0;
 
   // Caller is currently expected to reset max_allele_ct if allele_idx_offsets
   // is preloaded... need to fix this interface.
@@ -692,11 +721,33 @@ PglErr PgfiInitPhase1(const char* fname, uint32_t raw_variant_ct, uint32_t raw_s
     *pgfi_alloc_cacheline_ct_ptr = 0;
     return kPglRetSuccess;
   }
-  if (unlikely(file_type_code >= 0x11)) {
+  if (unlikely((file_type_code & 1) || (file_type_code > 0x1e))) {
     // todo: 0x11 phase sets (maybe not before 2021, though)
     snprintf(errstr_buf, kPglErrstrBufBlen, "Error: Third byte of %s does not correspond to a storage mode supported by this version of pgenlib.\n", fname);
     return kPglRetNotYetSupported;
   }
+  if (file_type_code & 4) {
+#ifdef PGENLIB_ZSTD
+    if (unlikely(use_mmap)) {
+      snprintf(errstr_buf, kPglErrstrBufBlen, "Error: %s has zstd-compressed variant records, which can't be accessed via mmap.\n", fname);
+      return kPglRetNotYetSupported;
+    }
+    pgfip->gflags |= kfPgenGlobalZstdRecords;
+#else
+    snprintf(errstr_buf, kPglErrstrBufBlen, "Error: %s has zstd-compressed variant records, but pgenlib was not compiled with zstd support.\n", fname);
+    return kPglRetNotYetSupported;
+#endif
+  }
+  if (file_type_code & 2) {
+    if (unlikely(raw_sample_ct >= 0x40000000)) {
+      snprintf(errstr_buf, kPglErrstrBufBlen, "Error: %s uses PBWT phase storage, which does not support more than 2^30 - 1 samples.\n", fname);
+      return kPglRetMalformedInput;
+    }
+    pgfip->gflags |= kfPgenGlobalPbwtHphase;
+  }
+  if (file_type_code & 8) {
+    pgfip->gflags |= kfPgenGlobalDosageDelta;
+  }
   // plink 2 binary, general-purpose
   pgfip->const_vrtype = UINT32_MAX;
   pgfip->const_vrec_width = 0;
@@ -755,6 +806,10 @@ PglErr PgfiInitPhase1(const char* fname, uint32_t raw_variant_ct, uint32_t raw_s
   }
   pgfip->const_fpos_offset += (raw_sample_ct * vrtype_and_vrec_len_bit_cost + 7) / 8 + (raw_sample_ct * alt_allele_ct_byte_ct) + (8 * vblock_ct);
   *pgfi_alloc_cacheline_ct_ptr = CountPgfiAllocCachelinesRequired(raw_variant_ct);
+  if (pgfip->gflags & kfPgenGlobalZstdRecords) {
+    // zst_group_fpos: group size isn't known yet, so assume the minimum
+    *pgfi_alloc_cacheline_ct_ptr += Int64CtToCachelineCt(DivUp(raw_variant_ct, 1U << kPglZstGroupLgMin) + 1);
+  }
   return kPglRetSuccess;
 }
 
@@ -773,6 +828,73 @@ void FillPgenReadErrstr(FILE* ff, char* errstr_buf) {
   FillPgenReadErrstrFromErrno(errstr_buf);
 }
 
+#ifdef PGENLIB_ZSTD
+// Loads the zstd group table (section 4c), which ends at var_fpos[0].
+// shared_ff must be positioned at the end of the rest of the header.
+static PglErr PgfiLoadZstGroupTable(unsigned char* loadbuf, uint32_t loadbuf_group_ct, PgenFileInfo* pgfip, char* errstr_buf) {
+  FILE* shared_ff = pgfip->shared_ff;
+  const uint32_t raw_variant_ct = pgfip->raw_variant_ct;
+  const uint64_t* var_fpos = pgfip->var_fpos;
+  const uint64_t header_end = ftello(shared_ff);
+  const uint64_t table_end = var_fpos[0] - 1;
+  if (unlikely((var_fpos[0] <= header_end) || fseeko(shared_ff, table_end, SEEK_SET))) {
+    snprintf(errstr_buf, kPglErrstrBufBlen, "Error: Invalid .pgen header.\n");
+    return kPglRetMalformedInput;
+  }
+  const uint32_t group_lg = getc_unlocked(shared_ff);
+  if (unlikely(group_lg > 255)) {
+    FillPgenReadErrstr(shared_ff, errstr_buf);
+    return kPglRetReadFail;
+  }
+  if (unlikely((group_lg < kPglZstGroupLgMin) || (group_lg > kPglZstGroupLgMax))) {
+    snprintf(errstr_buf, kPglErrstrBufBlen, "Error: Invalid .pgen zstd group size.\n");
+    return kPglRetMalformedInput;
+  }
+  const uint32_t group_ct = DivUp(raw_variant_ct, 1U << group_lg);
+  if (unlikely(table_end - header_end < group_ct * sizeof(int32_t))) {
+    snprintf(errstr_buf, kPglErrstrBufBlen, "Error: Invalid .pgen header.\n");
+    return kPglRetMalformedInput;
+  }
+  if (unlikely(fseeko(shared_ff, table_end - group_ct * sizeof(int32_t), SEEK_SET))) {
+    snprintf(errstr_buf, kPglErrstrBufBlen, "Error: .pgen read failure: %s.\n", strerror(errno));
+    return kPglRetReadFail;
+  }
+  uint64_t* group_fpos = &(pgfip->var_fpos[RoundUpPow2(raw_variant_ct + 1, kInt64PerCacheline)]);
+  uint64_t cur_fpos = var_fpos[0];
+  group_fpos[0] = cur_fpos;
+  for (uint32_t group_idx_start = 0; group_idx_start < group_ct; group_idx_start += loadbuf_group_ct) {
+    const uint32_t cur_group_ct = MINV(group_ct - group_idx_start, loadbuf_group_ct);
+    if (unlikely(!fread_unlocked(loadbuf, cur_group_ct * sizeof(int32_t), 1, shared_ff))) {
+      FillPgenReadErrstr(shared_ff, errstr_buf);
+      return kPglRetReadFail;
+    }
+    const uint32_t* group_sizes = R_CAST(const uint32_t*, loadbuf);
+    for (uint32_t uii = 0; uii != cur_group_ct; ++uii) {
+      cur_fpos += group_sizes[uii];
+      group_fpos[group_idx_start + uii + 1] = cur_fpos;
+    }
+  }
+  uint64_t max_group_width = 0;
+  for (uint32_t group_idx = 0; group_idx != group_ct; ++group_idx) {
+    const uint32_t vidx_end = MINV((group_idx + 1) << group_lg, raw_variant_ct);
+    const uint64_t cur_group_width = var_fpos[vidx_end] - var_fpos[group_idx << group_lg];
+    if (cur_group_width > max_group_width) {
+      max_group_width = cur_group_width;
+    }
+  }
+#ifndef __LP64__
+  if (unlikely(max_group_width > kMaxBytesPerIO)) {
+    snprintf(errstr_buf, kPglErrstrBufBlen, "Error: .pgen zstd groups are too large for a 32-bit build.\n");
+    return kPglRetNotYetSupported;
+  }
+#endif
+  pgfip->zst_group_fpos = group_fpos;
+  pgfip->zst_max_group_width = max_group_width;
+  pgfip->zst_group_lg = group_lg;
+  return kPglRetSuccess;
+}
+#endif
+
 static_assert(kPglMaxAltAlleleCt == 254, "Need to update PgfiInitPhase2().");
 PglErr PgfiInitPhase2(PgenHeaderCtrl header_ctrl, uint32_t allele_cts_already_loaded, uint32_t nonref_flags_already_loaded, uint32_t use_blockload, uint32_t vblock_idx_start, uint32_t vidx_end, uint32_t* max_vrec_width_ptr, PgenFileInfo* pgfip, unsigned char* pgfi_alloc, uintptr_t* pgr_alloc_cacheline_ct_ptr, char* errstr_buf) {
   // *max_vrec_width_ptr technically only needs to be set in single-variant
@@ -1124,7 +1246,21 @@ PglErr PgfiInitPhase2(PgenHeaderCtrl header_ctrl, uint32_t allele_cts_already_lo
           // vrtype_and_fpos_storage == 8.
           max_vrec_width = NypCtToByteCt(raw_sample_ct);
         }
-        *pgr_alloc_cacheline_ct_ptr = CountPgrAllocCachelinesRequired(raw_sample_ct, new_gflags, max_allele_ct, (shared_ff && (!use_blockload))? max_vrec_width : 0);
+        *pgr_alloc_cacheline_ct_ptr = CountPgrAllocCachelinesRequired(raw_sample_ct, new_gflags | (pgfip->gflags & (kfPgenGlobalPbwtHphase | kfPgenGlobalDosageDelta)), max_allele_ct, (shared_ff && (!use_blockload))? max_vrec_width : 0, max_vrec_width);
+#ifdef PGENLIB_ZSTD
+        if (pgfip->gflags & kfPgenGlobalZstdRecords) {
+          if (unlikely(vblock_idx_start || (vidx_end != raw_variant_ct))) {
+            snprintf(errstr_buf, kPglErrstrBufBlen, "Error: PgfiInitPhase2() must load the entire header of a .pgen file with zstd-compressed variant records.\n");
+            return kPglRetImproperFunctionCall;
+          }
+          PglErr reterr = PgfiLoadZstGroupTable(loadbuf, sizeof(loadbuf) / sizeof(int32_t), pgfip, errstr_buf);
+          if (unlikely(reterr)) {
+            return reterr;
+          }
+          // zst_group_buf; like pbwt_fread_buf, always counted
+          *pgr_alloc_cacheline_ct_ptr += DivUpU64(pgfip->zst_max_group_width, kCacheline);
+        }
+#endif
         *max_vrec_width_ptr = max_vrec_width;
         return kPglRetSuccess;
       }
@@ -1467,6 +1603,250 @@ PglErr PgfiInitPhase2(PgenHeaderCtrl header_ctrl, uint32_t allele_cts_already_lo
   }
 }
 
+PglErr PgfiInitMultiPhase1(const char* const* member_fnames, uint32_t member_ct, uint32_t raw_variant_ct, uint32_t raw_sample_ct, PgenHeaderCtrl* header_ctrl_ptr, PgenFileInfo* pgfip, uintptr_t* pgfi_alloc_cacheline_ct_ptr, char* errstr_buf) {
+  pgfip->var_fpos = nullptr;
+  pgfip->vrtypes = nullptr;
+  pgfip->allele_idx_offsets = nullptr;
+  pgfip->nonref_flags = nullptr;
+  pgfip->zst_group_fpos = nullptr;
+  pgfip->zst_dctx = nullptr;
+  pgfip->max_allele_ct = 2;
+  pgfip->shared_ff = nullptr;
+  pgfip->block_base = nullptr;
+  pgfip->block_offset = 1LLU << 63;
+  pgfip->member_fnames = member_fnames;
+  pgfip->member_fpos_starts = nullptr;
+  pgfip->member_record_fpos = nullptr;
+  pgfip->member_ct = member_ct;
+  pgfip->ff_member_idx = 0;
+  if (unlikely(!member_ct)) {
+    snprintf(errstr_buf, kPglErrstrBufBlen, "Error: PgfiInitMultiPhase1() member_ct parameter must be positive.\n");
+    return kPglRetImproperFunctionCall;
+  }
+  uint64_t total_variant_ct = 0;
+  uint32_t max_member_variant_ct = 0;
+  // bit n set iff some member has nonref_flags storage code n
+  uint32_t nonref_storage_seen = 0;
+  for (uint32_t member_idx = 0; member_idx != member_ct; ++member_idx) {
+    const char* fname = member_fnames[member_idx];
+    PgenFileInfo member_pgfi;
+    PreinitPgfi(&member_pgfi);
+    PgenHeaderCtrl member_header_ctrl;
+    uintptr_t member_alloc_cacheline_ct;
+    PglErr reterr = PgfiInitPhase1(fname, UINT32_MAX, UINT32_MAX, 0, &member_header_ctrl, &member_pgfi, &member_alloc_cacheline_ct, errstr_buf);
+    if (!reterr) {
+      if (unlikely(member_pgfi.const_vrtype == kPglVrtypePlink1)) {
+        snprintf(errstr_buf, kPglErrstrBufBlen, "Error: %s is a PLINK 1 .bed file, which can't be part of a multi-file .pgen fileset.\n", fname);
+        reterr = kPglRetNotYetSupported;
+      } else if (unlikely(member_pgfi.gflags & (kfPgenGlobalPbwtHphase | kfPgenGlobalZstdRecords | kfPgenGlobalDosageDelta))) {
+        snprintf(errstr_buf, kPglErrstrBufBlen, "Error: %s uses PBWT phase storage, zstd-compressed variant records, or dosage-delta coding; this is not supported in multi-file .pgen filesets yet.\n", fname);
+        reterr = kPglRetNotYetSupported;
+      } else if (member_idx && unlikely(member_pgfi.raw_sample_ct != raw_sample_ct)) {
+        snprintf(errstr_buf, kPglErrstrBufBlen, "Error: %s contains %u sample%s, while %s contains %u.\n", fname, member_pgfi.raw_sample_ct, (member_pgfi.raw_sample_ct == 1)? "" : "s", member_fnames[0], raw_sample_ct);
+        reterr = kPglRetInconsistentInput;
+      } else if (unlikely((!member_idx) && (raw_sample_ct != UINT32_MAX) && (member_pgfi.raw_sample_ct != raw_sample_ct))) {
+        snprintf(errstr_buf, kPglErrstrBufBlen, "Error: PgfiInitMultiPhase1() was called with raw_sample_ct == %u, but %s contains %u sample%s.\n", raw_sample_ct, fname, member_pgfi.raw_sample_ct, (member_pgfi.raw_sample_ct == 1)? "" : "s");
+        reterr = kPglRetInconsistentInput;
+      }
+    }
+    if (!reterr) {
+      raw_sample_ct = member_pgfi.raw_sample_ct;
+      const uint32_t member_variant_ct = member_pgfi.raw_variant_ct;
+      total_variant_ct += member_variant_ct;
+      if (member_variant_ct > max_member_variant_ct) {
+        max_member_variant_ct = member_variant_ct;
+      }
+      nonref_storage_seen |= 1U << (member_header_ctrl >> 6);
+    }
+    CleanupPgfi(&member_pgfi, &reterr);
+    if (unlikely(reterr)) {
+      return reterr;
+    }
+  }
+  if (unlikely(total_variant_ct > 0x7ffffffd)) {
+    snprintf(errstr_buf, kPglErrstrBufBlen, "Error: Multi-file .pgen fileset contains more than 2^31 - 3 variants.\n");
+    return kPglRetMalformedInput;
+  }
+  if (unlikely((raw_variant_ct != UINT32_MAX) && (raw_variant_ct != total_variant_ct))) {
+    snprintf(errstr_buf, kPglErrstrBufBlen, "Error: PgfiInitMultiPhase1() was called with raw_variant_ct == %u, but the member .pgen files contain %" PRIu64 " variant%s.\n", raw_variant_ct, total_variant_ct, (total_variant_ct == 1)? "" : "s");
+    return kPglRetInconsistentInput;
+  }
+  pgfip->raw_variant_ct = total_variant_ct;
+  pgfip->raw_sample_ct = raw_sample_ct;
+  pgfip->const_fpos_offset = 0;
+  pgfip->const_vrec_width = 0;
+  pgfip->const_vrtype = UINT32_MAX;
+  pgfip->gflags = kfPgenGlobal0;
+  if (!(nonref_storage_seen & (nonref_storage_seen - 1))) {
+    // all members agree
+    *header_ctrl_ptr = ctzu32(nonref_storage_seen) << 6;
+    if (nonref_storage_seen == 4) {
+      pgfip->gflags = kfPgenGlobalAllNonref;
+    }
+  } else if (nonref_storage_seen == 3) {
+    // mix of no-storage and all-ref
+    *header_ctrl_ptr = 64;
+  } else {
+    *header_ctrl_ptr = 192;
+  }
+  // combined vrtypes and var_fpos, member_fpos_starts, member_record_fpos,
+  // and scratch space for loading one member at a time
+  *pgfi_alloc_cacheline_ct_ptr = CountPgfiAllocCachelinesRequired(total_variant_ct) + 2 * Int64CtToCachelineCt(member_ct + 1) + CountPgfiAllocCachelinesRequired(max_member_variant_ct) + BitCtToCachelineCt(max_member_variant_ct);
+  return kPglRetSuccess;
+}
+
+PglErr PgfiInitMultiPhase2(PgenHeaderCtrl header_ctrl, uint32_t allele_cts_already_loaded, uint32_t nonref_flags_already_loaded, uint32_t use_blockload, uint32_t* max_vrec_width_ptr, PgenFileInfo* pgfip, unsigned char* pgfi_alloc, uintptr_t* pgr_alloc_cacheline_ct_ptr, char* errstr_buf) {
+  const uint32_t raw_variant_ct = pgfip->raw_variant_ct;
+  const uint32_t raw_sample_ct = pgfip->raw_sample_ct;
+  const uint32_t member_ct = pgfip->member_ct;
+  uintptr_t* allele_idx_offsets = pgfip->allele_idx_offsets;
+  if (unlikely(allele_idx_offsets && (!allele_cts_already_loaded))) {
+    snprintf(errstr_buf, kPglErrstrBufBlen, "Error: PgfiInitMultiPhase2() requires allele counts to be preloaded when pgfip->allele_idx_offsets is non-null.\n");
+    return kPglRetImproperFunctionCall;
+  }
+  uintptr_t* nonref_flags = pgfip->nonref_flags;
+  nonref_flags_already_loaded = nonref_flags_already_loaded && nonref_flags;
+  const uint32_t nonref_flags_fill = ((header_ctrl >> 6) == 3) && nonref_flags && (!nonref_flags_already_loaded);
+
+  unsigned char* vrtypes = pgfi_alloc;
+  const uintptr_t vrtypes_byte_ct = RoundUpPow2(raw_variant_ct + 1, kCacheline);
+  uint64_t* var_fpos = R_CAST(uint64_t*, &(vrtypes[vrtypes_byte_ct]));
+  unsigned char* alloc_iter = &(pgfi_alloc[CountPgfiAllocCachelinesRequired(raw_variant_ct) * kCacheline]);
+  uint64_t* member_fpos_starts = R_CAST(uint64_t*, alloc_iter);
+  alloc_iter = &(alloc_iter[Int64CtToCachelineCt(member_ct + 1) * kCacheline]);
+  uint64_t* member_record_fpos = R_CAST(uint64_t*, alloc_iter);
+  alloc_iter = &(alloc_iter[Int64CtToCachelineCt(member_ct + 1) * kCacheline]);
+  memset(&(vrtypes[raw_variant_ct]), 0, vrtypes_byte_ct - raw_variant_ct);
+
+  PgenGlobalFlags gflags = pgfip->gflags;
+  uint32_t max_vrec_width = 0;
+  uint32_t vidx_base = 0;
+  uint64_t fpos_base = 0;
+  for (uint32_t member_idx = 0; member_idx != member_ct; ++member_idx) {
+    const char* fname = pgfip->member_fnames[member_idx];
+    PgenFileInfo member_pgfi;
+    PreinitPgfi(&member_pgfi);
+    PgenHeaderCtrl member_header_ctrl;
+    uintptr_t member_alloc_cacheline_ct;
+    PglErr reterr = PgfiInitPhase1(fname, UINT32_MAX, raw_sample_ct, 0, &member_header_ctrl, &member_pgfi, &member_alloc_cacheline_ct, errstr_buf);
+    if (likely(!reterr)) {
+      const uint32_t member_variant_ct = member_pgfi.raw_variant_ct;
+      if (unlikely(member_variant_ct > raw_variant_ct - vidx_base)) {
+        snprintf(errstr_buf, kPglErrstrBufBlen, "Error: %s changed during multi-file .pgen fileset initialization.\n", fname);
+        reterr = kPglRetInconsistentInput;
+      } else {
+        if (allele_idx_offsets) {
+          member_pgfi.allele_idx_offsets = &(allele_idx_offsets[vidx_base]);
+        }
+        member_pgfi.max_allele_ct = pgfip->max_allele_ct;
+        uintptr_t* member_nonref_flags = R_CAST(uintptr_t*, alloc_iter);
+        const uint32_t member_nonref_flags_stored = ((member_header_ctrl >> 6) == 3);
+        if (nonref_flags_already_loaded) {
+          ZeroWArr(BitCtToWordCt(member_variant_ct), member_nonref_flags);
+          for (uint32_t uii = 0; uii != member_variant_ct; ++uii) {
+            AssignBit(uii, IsSet(nonref_flags, vidx_base + uii), member_nonref_flags);
+          }
+          member_pgfi.nonref_flags = member_nonref_flags;
+        } else if (member_nonref_flags_stored) {
+          member_pgfi.nonref_flags = member_nonref_flags;
+        }
+        uint32_t member_max_vrec_width;
+        uintptr_t member_pgr_alloc_cacheline_ct;
+        reterr = PgfiInitPhase2(member_header_ctrl, allele_cts_already_loaded, nonref_flags_already_loaded, 0, 0, member_variant_ct, &member_max_vrec_width, &member_pgfi, &(alloc_iter[BitCtToCachelineCt(member_variant_ct) * kCacheline]), &member_pgr_alloc_cacheline_ct, errstr_buf);
+        if (likely(!reterr)) {
+          if (nonref_flags_fill) {
+            if (member_nonref_flags_stored) {
+              for (uint32_t uii = 0; uii != member_variant_ct; ++uii) {
+                AssignBit(vidx_base + uii, IsSet(member_nonref_flags, uii), nonref_flags);
+              }
+            } else {
+              const uintptr_t fill_bit = ((member_header_ctrl >> 6) == 2);
+              for (uint32_t uii = 0; uii != member_variant_ct; ++uii) {
+                AssignBit(vidx_base + uii, fill_bit, nonref_flags);
+              }
+            }
+          }
+          if (member_pgfi.vrtypes) {
+            memcpy(&(vrtypes[vidx_base]), member_pgfi.vrtypes, member_variant_ct);
+          } else {
+            memset(&(vrtypes[vidx_base]), member_pgfi.const_vrtype, member_variant_ct);
+          }
+          const uint64_t member_fpos0 = GetPgfiFpos(&member_pgfi, 0);
+          for (uint32_t uii = 0; uii != member_variant_ct; ++uii) {
+            var_fpos[vidx_base + uii] = fpos_base + GetPgfiFpos(&member_pgfi, uii) - member_fpos0;
+          }
+          member_fpos_starts[member_idx] = fpos_base;
+          member_record_fpos[member_idx] = member_fpos0;
+          fpos_base += GetPgfiFpos(&member_pgfi, member_variant_ct) - member_fpos0;
+          vidx_base += member_variant_ct;
+          gflags |= member_pgfi.gflags & (~kfPgenGlobalAllNonref);
+          if (member_max_vrec_width > max_vrec_width) {
+            max_vrec_width = member_max_vrec_width;
+          }
+        }
+      }
+    }
+    CleanupPgfi(&member_pgfi, &reterr);
+    if (unlikely(reterr)) {
+      return reterr;
+    }
+  }
+  if (unlikely(vidx_base != raw_variant_ct)) {
+    snprintf(errstr_buf, kPglErrstrBufBlen, "Error: Member .pgen files changed during multi-file fileset initialization.\n");
+    return kPglRetInconsistentInput;
+  }
+  var_fpos[raw_variant_ct] = fpos_base;
+  member_fpos_starts[member_ct] = fpos_base;
+  member_record_fpos[member_ct] = 0;
+  pgfip->vrtypes = vrtypes;
+  pgfip->var_fpos = var_fpos;
+  pgfip->member_fpos_starts = member_fpos_starts;
+  pgfip->member_record_fpos = member_record_fpos;
+  pgfip->gflags = gflags;
+  // As with PgfiInitPhase1(), shared_ff is left open; it's moved to the first
+  // PgenReader in mode 3.
+  pgfip->shared_ff = fopen(pgfip->member_fnames[0], FOPEN_RB);
+  if (unlikely(!pgfip->shared_ff)) {
+    snprintf(errstr_buf, kPglErrstrBufBlen, "Error: Failed to open %s : %s.\n", pgfip->member_fnames[0], strerror(errno));
+    return kPglRetOpenFail;
+  }
+  pgfip->ff_member_idx = 0;
+  *pgr_alloc_cacheline_ct_ptr = CountPgrAllocCachelinesRequired(raw_sample_ct, gflags, pgfip->max_allele_ct, use_blockload? 0 : max_vrec_width, max_vrec_width);
+  *max_vrec_width_ptr = max_vrec_width;
+  return kPglRetSuccess;
+}
+
+// Seeks to the given record-stream offset.  In a multi-file fileset, *ff_ptr
+// is first switched to the appropriate member file if necessary; fip must be
+// the PgenFileInfo whose ff_member_idx tracks *ff_ptr.
+static BoolErr PgenFseek(uint64_t fpos, PgenFileInfo* fip, FILE** ff_ptr) {
+  if (!fip->member_ct) {
+    return fseeko(*ff_ptr, fpos, SEEK_SET);
+  }
+  // find the last member starting at or before fpos
+  const uint64_t* member_fpos_starts = fip->member_fpos_starts;
+  uint32_t member_idx = 0;
+  uint32_t end_idx = fip->member_ct;
+  while (end_idx - member_idx > 1) {
+    const uint32_t mid_idx = (member_idx + end_idx) / 2;
+    if (member_fpos_starts[mid_idx] <= fpos) {
+      member_idx = mid_idx;
+    } else {
+      end_idx = mid_idx;
+    }
+  }
+  if (member_idx != fip->ff_member_idx) {
+    FILE* new_ff = fopen(fip->member_fnames[member_idx], FOPEN_RB);
+    if (unlikely(!new_ff)) {
+      return 1;
+    }
+    fclose(*ff_ptr);
+    *ff_ptr = new_ff;
+    fip->ff_member_idx = member_idx;
+  }
+  return fseeko(*ff_ptr, fpos - member_fpos_starts[member_idx] + fip->member_record_fpos[member_idx], SEEK_SET);
+}
+
 uint32_t GetLdbaseVidx(const unsigned char* vrtypes, uint32_t cur_vidx) {
 #ifdef __LP64__
   const VecW* vrtypes_valias = R_CAST(const VecW*, vrtypes);
@@ -1516,6 +1896,32 @@ uint32_t GetLdbaseVidx(const unsigned char* vrtypes, uint32_t cur_vidx) {
 #endif
 }
 
+uint32_t GetMultireadStartVidx(const PgenFileInfo* pgfip, uint32_t vidx) {
+  const unsigned char* vrtypes = pgfip->vrtypes;
+  if (!vrtypes) {
+    return vidx;
+  }
+  uint32_t start_vidx = vidx;
+  if ((vrtypes[vidx] & 6) == 2) {
+    // need to start loading from LD-buddy
+    start_vidx = GetLdbaseVidx(vrtypes, vidx);
+  }
+  if (pgfip->gflags & kfPgenGlobalPbwtHphase) {
+    // PBWT state may need to be replayed from the start of the reset window
+    for (uint32_t uii = RoundDownPow2(vidx, kPglPbwtResetInterval); uii < start_vidx; ++uii) {
+      if ((vrtypes[uii] & 0x18) == 0x10) {
+        start_vidx = uii;
+        break;
+      }
+    }
+  }
+  if (pgfip->zst_group_fpos) {
+    // zstd groups can only be decompressed from the beginning
+    start_vidx = RoundDownPow2(start_vidx, 1U << pgfip->zst_group_lg);
+  }
+  return start_vidx;
+}
+
 uint64_t PgfiMultireadGetCachelineReq(const uintptr_t* variant_include, const PgenFileInfo* pgfip, uint32_t variant_ct, uint32_t block_size) {
   // if block_size < kPglVblockSize, it's ideal for it to be a power of 2 (to
   // avoid unnecessary vblock crossing), but that's not required.
@@ -1552,10 +1958,7 @@ uint64_t PgfiMultireadGetCachelineReq(const uintptr_t* variant_include, const Pg
       variant_uidx_end = 1 + FindLast1BitBefore(variant_include, variant_uidx_end);
     }
     if (var_fpos) {
-      if (pgfip->vrtypes && ((pgfip->vrtypes[variant_uidx_start] & 6) == 2)) {
-        // need to start loading from LD-buddy
-        variant_uidx_start = GetLdbaseVidx(pgfip->vrtypes, variant_uidx_start);
-      }
+      variant_uidx_start = GetMultireadStartVidx(pgfip, variant_uidx_start);
       uint64_t cur_block_byte_ct = var_fpos[variant_uidx_end] - var_fpos[variant_uidx_start];
       if (cur_block_byte_ct > max_block_byte_ct) {
         max_block_byte_ct = cur_block_byte_ct;
@@ -1578,6 +1981,75 @@ uint64_t PgfiMultireadGetCachelineReq(const uintptr_t* variant_include, const Pg
   return DivUpU64(max_block_byte_ct, kCacheline);
 }
 
+#ifdef PGENLIB_ZSTD
+// Decompresses the first dst_byte_ct bytes of the zstd group occupying
+// [fpos, fpos_end) on disk.
+static PglErr ZstLoadGroup(uint64_t fpos, uint64_t fpos_end, uintptr_t dst_byte_ct, FILE* ff, ZSTD_DCtx* dctx, unsigned char* dst) {
+  if (unlikely(fseeko(ff, fpos, SEEK_SET))) {
+    return kPglRetReadFail;
+  }
+  ZSTD_DCtx_reset(dctx, ZSTD_reset_session_only);
+  unsigned char inbuf[16384];
+  ZSTD_outBuffer zob = {dst, dst_byte_ct, 0};
+  uint64_t in_byte_ct_left = fpos_end - fpos;
+  while (zob.pos != zob.size) {
+    if (unlikely(!in_byte_ct_left)) {
+      return kPglRetMalformedInput;
+    }
+    const uintptr_t cur_in_byte_ct = MINV(in_byte_ct_left, sizeof(inbuf));
+    if (unlikely(!fread_unlocked(inbuf, cur_in_byte_ct, 1, ff))) {
+      if (feof_unlocked(ff)) {
+        errno = 0;
+      }
+      return kPglRetReadFail;
+    }
+    in_byte_ct_left -= cur_in_byte_ct;
+    ZSTD_inBuffer zib = {inbuf, cur_in_byte_ct, 0};
+    while ((zib.pos != zib.size) && (zob.pos != zob.size)) {
+      const uintptr_t decompress_retval = ZSTD_decompressStream(dctx, &zob, &zib);
+      if (unlikely(ZSTD_isError(decompress_retval) || ((!decompress_retval) && (zob.pos != zob.size)))) {
+        // corrupt data, or frame ended early
+        return kPglRetMalformedInput;
+      }
+    }
+  }
+  return kPglRetSuccess;
+}
+
+// Decompresses the zstd groups overlapping [start_vidx, end_fpos) into
+// block_base; start_vidx must be at the start of a group.
+static PglErr PgfiZstMultiread(uint32_t start_vidx, uint64_t end_fpos, PgenFileInfo* pgfip) {
+  ZSTD_DCtx* dctx = S_CAST(ZSTD_DCtx*, pgfip->zst_dctx);
+  if (!dctx) {
+    dctx = ZSTD_createDCtx();
+    if (unlikely(!dctx)) {
+      return kPglRetNomem;
+    }
+    pgfip->zst_dctx = dctx;
+  }
+  const uint64_t* var_fpos = pgfip->var_fpos;
+  const uint64_t* group_fpos = pgfip->zst_group_fpos;
+  const uint32_t raw_variant_ct = pgfip->raw_variant_ct;
+  const uint32_t group_lg = pgfip->zst_group_lg;
+  const uint64_t block_offset = pgfip->block_offset;
+  unsigned char* block_base = K_CAST(unsigned char*, pgfip->block_base);
+  uint32_t group_idx = start_vidx >> group_lg;
+  uint64_t group_start_fpos = var_fpos[start_vidx];
+  while (group_start_fpos < end_fpos) {
+    const uint32_t group_vidx_end = MINV((group_idx + 1) << group_lg, raw_variant_ct);
+    const uint64_t group_end_fpos = var_fpos[group_vidx_end];
+    const uint64_t cur_end_fpos = MINV(group_end_fpos, end_fpos);
+    PglErr reterr = ZstLoadGroup(group_fpos[group_idx], group_fpos[group_idx + 1], cur_end_fpos - group_start_fpos, pgfip->shared_ff, dctx, &(block_base[group_start_fpos - block_offset]));
+    if (unlikely(reterr)) {
+      return reterr;
+    }
+    ++group_idx;
+    group_start_fpos = group_end_fpos;
+  }
+  return kPglRetSuccess;
+}
+#endif
+
 PglErr PgfiMultiread(const uintptr_t* variant_include, uint32_t variant_uidx_start, uint32_t variant_uidx_end, uint32_t load_variant_ct, PgenFileInfo* pgfip) {
   // we could permit 0, but that encourages lots of unnecessary thread wakeups
   assert(load_variant_ct);
@@ -1585,21 +2057,18 @@ PglErr PgfiMultiread(const uintptr_t* variant_include, uint32_t variant_uidx_sta
     variant_uidx_start = AdvTo1Bit(variant_include, variant_uidx_start);
   }
   assert(variant_uidx_start < pgfip->raw_variant_ct);
-  uint64_t block_offset;
-  if (pgfip->vrtypes && ((pgfip->vrtypes[variant_uidx_start] & 6) == 2)) {
-    // need to start loading from LD-buddy
-    // assume for now that we can't skip any variants between the LD-buddy and
-    // the actual first variant; should remove this assumption later
-    block_offset = pgfip->var_fpos[GetLdbaseVidx(pgfip->vrtypes, variant_uidx_start)];
-  } else {
-    block_offset = GetPgfiFpos(pgfip, variant_uidx_start);
-  }
+  // may need to start loading from LD-buddy or PBWT reset point
+  // assume for now that we can't skip any variants between the LD-buddy and
+  // the actual first variant; should remove this assumption later
+  uint32_t next_read_start_vidx = GetMultireadStartVidx(pgfip, variant_uidx_start);
+  const uint64_t block_offset = GetPgfiFpos(pgfip, next_read_start_vidx);
   pgfip->block_offset = block_offset;
   uint64_t next_read_start_fpos = block_offset;
   // break this up into multiple freads whenever this lets us skip an entire
   // disk block
   // (possible todo: make the disk block size a parameter of this function)
   do {
+    __maybe_unused const uint32_t cur_read_start_vidx = next_read_start_vidx;
     const uint64_t cur_read_start_fpos = next_read_start_fpos;
     uint32_t cur_read_uidx_end;
     uint64_t cur_read_end_fpos;
@@ -1617,14 +2086,12 @@ PglErr PgfiMultiread(const uintptr_t* variant_include, uint32_t variant_uidx_sta
         break;
       }
       variant_uidx_start = AdvTo1Bit(variant_include, cur_read_uidx_end);
-      next_read_start_fpos = GetPgfiFpos(pgfip, variant_uidx_start);
-      if (pgfip->vrtypes && ((pgfip->vrtypes[variant_uidx_start] & 6) == 2)) {
-        const uint32_t variant_read_uidx_start = GetLdbaseVidx(pgfip->vrtypes, variant_uidx_start);
-        if (variant_read_uidx_start <= cur_read_uidx_end) {
-          continue;
-        }
-        next_read_start_fpos = pgfip->var_fpos[variant_read_uidx_start];
+      const uint32_t variant_read_uidx_start = GetMultireadStartVidx(pgfip, variant_uidx_start);
+      if (variant_read_uidx_start <= cur_read_uidx_end) {
+        continue;
       }
+      next_read_start_vidx = variant_read_uidx_start;
+      next_read_start_fpos = GetPgfiFpos(pgfip, variant_read_uidx_start);
       // bugfix: can't use do..while, since previous "continue" needs to skip
       // this check
       if (RoundDownPow2U64(cur_read_end_fpos + kDiskBlockSize + 1LLU, kDiskBlockSize) < RoundDownPow2U64(next_read_start_fpos, kDiskBlockSize)) {
@@ -1632,15 +2099,39 @@ PglErr PgfiMultiread(const uintptr_t* variant_include, uint32_t variant_uidx_sta
         break;
       }
     }
-    if (unlikely(fseeko(pgfip->shared_ff, cur_read_start_fpos, SEEK_SET))) {
-      return kPglRetReadFail;
+#ifdef PGENLIB_ZSTD
+    if (pgfip->zst_group_fpos) {
+      PglErr reterr = PgfiZstMultiread(cur_read_start_vidx, cur_read_end_fpos, pgfip);
+      if (unlikely(reterr)) {
+        return reterr;
+      }
+      continue;
     }
-    uintptr_t len = cur_read_end_fpos - cur_read_start_fpos;
-    if (unlikely(fread_checked(K_CAST(unsigned char*, &(pgfip->block_base[cur_read_start_fpos - block_offset])), len, pgfip->shared_ff))) {
-      if (feof_unlocked(pgfip->shared_ff)) {
-        errno = 0;
+#endif
+    // in a multi-file fileset, this may span several members
+    uint64_t member_read_start_fpos = cur_read_start_fpos;
+    while (1) {
+      if (unlikely(PgenFseek(member_read_start_fpos, pgfip, &(pgfip->shared_ff)))) {
+        return kPglRetReadFail;
       }
-      return kPglRetReadFail;
+      uint64_t member_read_end_fpos = cur_read_end_fpos;
+      if (pgfip->member_ct) {
+        const uint64_t member_end_fpos = pgfip->member_fpos_starts[pgfip->ff_member_idx + 1];
+        if (member_read_end_fpos > member_end_fpos) {
+          member_read_end_fpos = member_end_fpos;
+        }
+      }
+      uintptr_t len = member_read_end_fpos - member_read_start_fpos;
+      if (unlikely(fread_checked(K_CAST(unsigned char*, &(pgfip->block_base[member_read_start_fpos - block_offset])), len, pgfip->shared_ff))) {
+        if (feof_unlocked(pgfip->shared_ff)) {
+          errno = 0;
+        }
+        return kPglRetReadFail;
+      }
+      if (member_read_end_fpos == cur_read_end_fpos) {
+        break;
+      }
+      member_read_start_fpos = member_read_end_fpos;
     }
   } while (load_variant_ct);
   return kPglRetSuccess;
@@ -1650,6 +2141,7 @@ PglErr PgfiMultiread(const uintptr_t* variant_include, uint32_t variant_uidx_sta
 void PreinitPgr(PgenReader* pgr_ptr) {
   PgenReaderMain* pgrp = GetPgrp(pgr_ptr);
   pgrp->ff = nullptr;
+  pgrp->zst_dctx = nullptr;
 }
 
 PglErr PgrInit(const char* fname, uint32_t max_vrec_width, PgenFileInfo* pgfip, PgenReader* pgr_ptr, unsigned char* pgr_alloc) {
@@ -1665,12 +2157,15 @@ PglErr PgrInit(const char* fname, uint32_t max_vrec_width, PgenFileInfo* pgfip,
   //   non-null, though it isn't actually referenced during the first
   //   PgenReader initialization (instead shared_ff is moved).
   unsigned char* pgr_alloc_iter = pgr_alloc;
+  pgrp->zst_dctx = nullptr;
   if (pgfip->block_base != nullptr) {
     if (unlikely(fname != nullptr)) {
       return kPglRetImproperFunctionCall;
     }
     pgrp->ff = nullptr;  // make sure CleanupPgr() doesn't break
+    pgrp->fi = *pgfip;  // struct copy
   } else {
+    uint32_t ff_member_idx = 0;
     if (pgfip->shared_ff != nullptr) {
       if (unlikely(fname == nullptr)) {
         return kPglRetImproperFunctionCall;
@@ -1678,8 +2173,10 @@ PglErr PgrInit(const char* fname, uint32_t max_vrec_width, PgenFileInfo* pgfip,
       // move instead of close/reopen.
       pgrp->ff = pgfip->shared_ff;
       pgfip->shared_ff = nullptr;
+      ff_member_idx = pgfip->ff_member_idx;
     } else {
-      pgrp->ff = fopen(fname, FOPEN_RB);
+      // fname is ignored in the multi-file case
+      pgrp->ff = fopen(pgfip->member_ct? pgfip->member_fnames[0] : fname, FOPEN_RB);
       if (unlikely(!pgrp->ff)) {
         return kPglRetOpenFail;
       }
@@ -1692,15 +2189,30 @@ PglErr PgrInit(const char* fname, uint32_t max_vrec_width, PgenFileInfo* pgfip,
     } else {
       seek_pos = pgfip->const_fpos_offset;
     }
-    if (unlikely(fseeko(pgrp->ff, seek_pos, SEEK_SET))) {
+    pgrp->fi = *pgfip;  // struct copy
+    pgrp->fi.ff_member_idx = ff_member_idx;
+    if (unlikely(PgenFseek(seek_pos, &(pgrp->fi), &(pgrp->ff)))) {
       return kPglRetReadFail;
     }
   }
-  pgrp->fi = *pgfip;  // struct copy
+  // PgfiMultiread() decompression context isn't shared
+  pgrp->fi.zst_dctx = nullptr;
+  const uint32_t pbwt_hphase = (pgfip->gflags & (kfPgenGlobalHardcallPhasePresent | kfPgenGlobalPbwtHphase)) == (kfPgenGlobalHardcallPhasePresent | kfPgenGlobalPbwtHphase);
+  pgrp->pbwt_fread_buf = nullptr;
+  pgrp->zst_group_buf = nullptr;
+  pgrp->zst_group_idx = UINT32_MAX;
   if (fname) {
     // Mode 3 per-reader load buffer
     pgrp->fread_buf = pgr_alloc_iter;
     pgr_alloc_iter = &(pgr_alloc_iter[RoundUpPow2(max_vrec_width, kCacheline)]);
+    if (pbwt_hphase) {
+      pgrp->pbwt_fread_buf = pgr_alloc_iter;
+      pgr_alloc_iter = &(pgr_alloc_iter[RoundUpPow2(max_vrec_width, kCacheline)]);
+    }
+    if (pgfip->zst_group_fpos) {
+      pgrp->zst_group_buf = pgr_alloc_iter;
+      pgr_alloc_iter = &(pgr_alloc_iter[RoundUpPow2(pgfip->zst_max_group_width, kCacheline)]);
+    }
   }
   pgrp->fp_vidx = 0;
   pgrp->ldbase_vidx = UINT32_MAX;
@@ -1751,6 +2263,15 @@ PglErr PgrInit(const char* fname, uint32_t max_vrec_width, PgenFileInfo* pgfip,
   pgrp->workspace_imp_r2 = nullptr;
   pgrp->workspace_all_hets = nullptr;
   pgrp->workspace_subset = nullptr;
+  pgrp->pbwt_order = nullptr;
+  pgrp->pbwt_order_tmp = nullptr;
+  pgrp->pbwt_haps = nullptr;
+  pgrp->pbwt_workspace = nullptr;
+  pgrp->pbwt_next_vidx = UINT32_MAX;
+  pgrp->pbwt_prev_vidx = UINT32_MAX;
+  pgrp->pbwt_runs_byte_ct = 0;
+  pgrp->ddelta_vrec_buf = nullptr;
+  pgrp->ddelta_varint_buf = nullptr;
   const PgenGlobalFlags gflags_hphase_dosage = gflags & (kfPgenGlobalHardcallPhasePresent | kfPgenGlobalDosagePresent);
   if ((max_allele_ct > 2) || gflags_hphase_dosage) {
     pgrp->workspace_vec = R_CAST(uintptr_t*, pgr_alloc_iter);
@@ -1766,6 +2287,17 @@ PglErr PgrInit(const char* fname, uint32_t max_vrec_width, PgenFileInfo* pgfip,
       pgr_alloc_iter = &(pgr_alloc_iter[bitvec_bytes_req]);
       pgrp->workspace_subset = R_CAST(uintptr_t*, pgr_alloc_iter);
       pgr_alloc_iter = &(pgr_alloc_iter[bitvec_bytes_req]);
+      if (pbwt_hphase) {
+        const uintptr_t order_bytes_req = Int32CtToCachelineCt(2 * S_CAST(uintptr_t, raw_sample_ct)) * kCacheline;
+        pgrp->pbwt_order = R_CAST(uint32_t*, pgr_alloc_iter);
+        pgr_alloc_iter = &(pgr_alloc_iter[order_bytes_req]);
+        pgrp->pbwt_order_tmp = R_CAST(uint32_t*, pgr_alloc_iter);
+        pgr_alloc_iter = &(pgr_alloc_iter[order_bytes_req]);
+        pgrp->pbwt_haps = R_CAST(uintptr_t*, pgr_alloc_iter);
+        pgr_alloc_iter = &(pgr_alloc_iter[genovec_bytes_req]);
+        pgrp->pbwt_workspace = R_CAST(uintptr_t*, pgr_alloc_iter);
+        pgr_alloc_iter = &(pgr_alloc_iter[3 * bitvec_bytes_req]);
+      }
     }
     pgrp->workspace_dosage_present = nullptr;
     pgrp->workspace_dphase_present = nullptr;
@@ -1774,8 +2306,14 @@ PglErr PgrInit(const char* fname, uint32_t max_vrec_width, PgenFileInfo* pgfip,
       pgr_alloc_iter = &(pgr_alloc_iter[bitvec_bytes_req]);
       if (gflags & kfPgenGlobalDosagePhasePresent) {
         pgrp->workspace_dphase_present = R_CAST(uintptr_t*, pgr_alloc_iter);
+        pgr_alloc_iter = &(pgr_alloc_iter[bitvec_bytes_req]);
+      }
+      if (gflags & kfPgenGlobalDosageDelta) {
+        pgrp->ddelta_vrec_buf = pgr_alloc_iter;
+        pgr_alloc_iter = &(pgr_alloc_iter[RoundUpPow2(max_vrec_width + 2 * S_CAST(uintptr_t, raw_sample_ct), kCacheline)]);
+        pgrp->ddelta_varint_buf = pgr_alloc_iter;
+        // pgr_alloc_iter = &(pgr_alloc_iter[RoundUpPow2(3 * S_CAST(uintptr_t, raw_sample_ct), kCacheline)]);
       }
-      // pgr_alloc_iter = &(pgr_alloc_iter[bitvec_bytes_req]);
     }
   }
   return kPglRetSuccess;
@@ -2371,6 +2909,181 @@ PglErr ParseNonLdGenovecSubsetUnsafe(const unsigned char* fread_end, const uintp
   return kPglRetSuccess;
 }
 
+// In mode 0x12, biallelic hardcall-phased records end with a trailer
+// describing track #2 (see pgenlib_misc.h).  This removes it from the record,
+// and saves the relevant part in pgrp->pbwt_runs_byte_ct.
+void StripPbwtTrailer(uint32_t vidx, const unsigned char* fread_ptr, PgenReaderMain* pgrp, const unsigned char** fread_endp) {
+  pgrp->pbwt_runs_byte_ct = 0;
+  if (!(pgrp->fi.gflags & kfPgenGlobalPbwtHphase)) {
+    return;
+  }
+  // Records without hardcall phase, and non-PBWT-coded records with
+  // LD-compressed genotypes, don't change the haplotype ordering, so we can
+  // cheaply keep it current during a sequential scan.  (This must not cross a
+  // reset boundary.)
+  const uint32_t ordering_current = (pgrp->pbwt_next_vidx == vidx) && (vidx % kPglPbwtResetInterval);
+  if ((pgrp->fi.vrtypes[vidx] & 0x18) != 0x10) {
+    if (ordering_current) {
+      pgrp->pbwt_next_vidx = vidx + 1;
+    }
+    return;
+  }
+  const unsigned char* fread_end = *fread_endp;
+  if (unlikely(fread_end == fread_ptr)) {
+    pgrp->pbwt_runs_byte_ct = UINT32_MAX;
+    return;
+  }
+  const uint32_t trailer_format = fread_end[-1];
+  if (!trailer_format) {
+    *fread_endp = &(fread_end[-1]);
+    if (ordering_current && VrtypeLdCompressed(pgrp->fi.vrtypes[vidx])) {
+      pgrp->pbwt_next_vidx = vidx + 1;
+    }
+    return;
+  }
+  const uintptr_t vrec_width = fread_end - fread_ptr;
+  if (unlikely((trailer_format != 1) || (vrec_width < kPglPbwtTrailerByteCt))) {
+    pgrp->pbwt_runs_byte_ct = UINT32_MAX;
+    return;
+  }
+  const unsigned char* trailer = &(fread_end[-kPglPbwtTrailerByteCt]);
+  uint32_t runs_offset;
+  uint32_t runs_byte_ct;
+  memcpy(&runs_offset, trailer, sizeof(int32_t));
+  memcpy(&runs_byte_ct, &(trailer[sizeof(int32_t)]), sizeof(int32_t));
+  const uintptr_t body_byte_ct = vrec_width - kPglPbwtTrailerByteCt;
+  if (unlikely((!runs_byte_ct) || (runs_offset > body_byte_ct) || (runs_byte_ct > body_byte_ct - runs_offset))) {
+    pgrp->pbwt_runs_byte_ct = UINT32_MAX;
+    return;
+  }
+  pgrp->pbwt_runs_byte_ct = runs_byte_ct;
+  *fread_endp = trailer;
+}
+
+// When mode byte bit 3 is set, records with a dosage track end with a trailer
+// describing track #4 (see pgenlib_misc.h).  This removes it from the record,
+// and if track #4 is dosage-delta-coded, expands the record into
+// pgrp->ddelta_vrec_buf and points *fread_pp and *fread_endp there.  Must be
+// called after StripPbwtTrailer().  Returns 1 iff the record is malformed.
+BoolErr ApplyDdeltaTrailer(uint32_t vidx, PgenReaderMain* pgrp, const unsigned char** fread_pp, const unsigned char** fread_endp) {
+  if ((!(pgrp->fi.gflags & kfPgenGlobalDosageDelta)) || (!(pgrp->fi.vrtypes[vidx] & 0x60))) {
+    return 0;
+  }
+  const unsigned char* vrec_start = *fread_pp;
+  const unsigned char* fread_end = *fread_endp;
+  if (unlikely(fread_end == vrec_start)) {
+    return 1;
+  }
+  const uint32_t trailer_format = fread_end[-1];
+  if (!trailer_format) {
+    *fread_endp = &(fread_end[-1]);
+    return 0;
+  }
+  const uintptr_t vrec_width = fread_end - vrec_start;
+  if (unlikely((trailer_format > 2) || (vrec_width < kPglDosageDeltaTrailerByteCt))) {
+    return 1;
+  }
+  const unsigned char* trailer = &(fread_end[-kPglDosageDeltaTrailerByteCt]);
+  uint32_t coded_offset;
+  uint32_t coded_byte_ct;
+  memcpy(&coded_offset, trailer, sizeof(int32_t));
+  memcpy(&coded_byte_ct, &(trailer[sizeof(int32_t)]), sizeof(int32_t));
+  const uintptr_t body_byte_ct = vrec_width - kPglDosageDeltaTrailerByteCt;
+  if (unlikely((!coded_byte_ct) || (coded_offset > body_byte_ct) || (coded_byte_ct > body_byte_ct - coded_offset))) {
+    return 1;
+  }
+  const uint32_t raw_sample_ct = pgrp->fi.raw_sample_ct;
+  const unsigned char* coded_end = &(vrec_start[coded_offset + coded_byte_ct]);
+  const unsigned char* varint_iter = &(vrec_start[coded_offset]);
+  const unsigned char* varint_end = coded_end;
+  if (trailer_format == 2) {
+#ifdef PGENLIB_FSE
+    const uint32_t varint_byte_ct = GetVint31(coded_end, &varint_iter);
+    if (unlikely(varint_byte_ct > 3 * raw_sample_ct)) {
+      return 1;
+    }
+    unsigned char* varint_buf = pgrp->ddelta_varint_buf;
+    const size_t decoded_byte_ct = FSE_decompress(varint_buf, varint_byte_ct, varint_iter, coded_end - varint_iter);
+    if (unlikely(FSE_isError(decoded_byte_ct) || (decoded_byte_ct != varint_byte_ct))) {
+      return 1;
+    }
+    varint_iter = varint_buf;
+    varint_end = &(varint_buf[varint_byte_ct]);
+#else
+    // FSE stage not compiled in
+    return 1;
+#endif
+  }
+  unsigned char* vrec_buf = pgrp->ddelta_vrec_buf;
+  memcpy(vrec_buf, vrec_start, coded_offset);
+  unsigned char* dosage_main_iter = &(vrec_buf[coded_offset]);
+  const unsigned char* dosage_main_stop = &(dosage_main_iter[raw_sample_ct * sizeof(int16_t)]);
+  while (varint_iter != varint_end) {
+    if (unlikely(dosage_main_iter == dosage_main_stop)) {
+      return 1;
+    }
+    // GetVint31() read-past-end return value fails the range check
+    const uint32_t dcode = GetVint31(varint_end, &varint_iter);
+    const uint32_t hc = dcode & 3;
+    uint16_t cur_dosage = 65535;
+    if (hc != 3) {
+      const uint32_t zigzag = dcode >> 2;
+      const int32_t delta = S_CAST(int32_t, zigzag >> 1) ^ (-S_CAST(int32_t, zigzag & 1));
+      const int32_t dosage_i32 = S_CAST(int32_t, hc * 16384) + delta;
+      if (unlikely((dosage_i32 < 0) || (dosage_i32 > 32768))) {
+        return 1;
+      }
+      cur_dosage = dosage_i32;
+    } else if (unlikely(dcode != 3)) {
+      return 1;
+    }
+    memcpy(dosage_main_iter, &cur_dosage, sizeof(int16_t));
+    dosage_main_iter = &(dosage_main_iter[sizeof(int16_t)]);
+  }
+  const uintptr_t suffix_byte_ct = body_byte_ct - coded_offset - coded_byte_ct;
+  memcpy(dosage_main_iter, coded_end, suffix_byte_ct);
+  *fread_pp = vrec_buf;
+  *fread_endp = &(dosage_main_iter[suffix_byte_ct]);
+  return 0;
+}
+
+#ifdef PGENLIB_ZSTD
+// Per-variant fread() mode: copies the first byte_ct bytes of variant vidx's
+// record to dst, decompressing its group into pgrp->zst_group_buf first if
+// necessary.  Returns 1 on failure, with errno set to 0 if the file is
+// malformed.
+static BoolErr PgrZstReadVrec(uint32_t vidx, uintptr_t byte_ct, PgenReaderMain* pgrp, unsigned char* dst) {
+  const uint64_t* var_fpos = pgrp->fi.var_fpos;
+  const uint32_t group_lg = pgrp->fi.zst_group_lg;
+  const uint32_t group_idx = vidx >> group_lg;
+  const uint32_t group_vidx_start = group_idx << group_lg;
+  if (pgrp->zst_group_idx != group_idx) {
+    ZSTD_DCtx* dctx = S_CAST(ZSTD_DCtx*, pgrp->zst_dctx);
+    if (!dctx) {
+      dctx = ZSTD_createDCtx();
+      if (unlikely(!dctx)) {
+        errno = ENOMEM;
+        return 1;
+      }
+      pgrp->zst_dctx = dctx;
+    }
+    pgrp->zst_group_idx = UINT32_MAX;
+    const uint32_t group_vidx_end = MINV(group_vidx_start + (1U << group_lg), pgrp->fi.raw_variant_ct);
+    const uint64_t* group_fpos = pgrp->fi.zst_group_fpos;
+    const PglErr reterr = ZstLoadGroup(group_fpos[group_idx], group_fpos[group_idx + 1], var_fpos[group_vidx_end] - var_fpos[group_vidx_start], pgrp->ff, dctx, pgrp->zst_group_buf);
+    if (unlikely(reterr)) {
+      if (reterr == kPglRetMalformedInput) {
+        errno = 0;
+      }
+      return 1;
+    }
+    pgrp->zst_group_idx = group_idx;
+  }
+  memcpy(dst, &(pgrp->zst_group_buf[var_fpos[vidx] - var_fpos[group_vidx_start]]), byte_ct);
+  return 0;
+}
+#endif
+
 BoolErr InitReadPtrs(uint32_t vidx, PgenReaderMain* pgrp, const unsigned char** fread_pp, const unsigned char** fread_endp) {
   const unsigned char* block_base = pgrp->fi.block_base;
   if (block_base != nullptr) {
@@ -2382,34 +3095,303 @@ BoolErr InitReadPtrs(uint32_t vidx, PgenReaderMain* pgrp, const unsigned char**
     // still a useful hint to LdLoadNecessary()
     pgrp->fp_vidx = vidx + 1;
 
+    StripPbwtTrailer(vidx, *fread_pp, pgrp, fread_endp);
+    if (unlikely(ApplyDdeltaTrailer(vidx, pgrp, fread_pp, fread_endp))) {
+      errno = 0;
+      return 1;
+    }
     return 0;
   }
-  if (pgrp->fp_vidx != vidx) {
-    if (unlikely(fseeko(pgrp->ff, GetPgfiFpos(&(pgrp->fi), vidx), SEEK_SET))) {
+  const uintptr_t cur_vrec_width = GetPgfiVrecWidth(&(pgrp->fi), vidx);
+#ifdef PGENLIB_ZSTD
+  if (pgrp->fi.zst_group_fpos) {
+    if (unlikely(PgrZstReadVrec(vidx, cur_vrec_width, pgrp, pgrp->fread_buf))) {
       return 1;
     }
-  }
-  const uintptr_t cur_vrec_width = GetPgfiVrecWidth(&(pgrp->fi), vidx);
-#ifdef __LP64__
-  if (unlikely(fread_checked(pgrp->fread_buf, cur_vrec_width, pgrp->ff))) {
-    if (feof_unlocked(pgrp->ff)) {
-      errno = 0;
+  } else {
+#endif
+  const uint64_t fpos = GetPgfiFpos(&(pgrp->fi), vidx);
+  // sequential reads must still seek when crossing into the next member of a
+  // multi-file fileset
+  if ((pgrp->fp_vidx != vidx) || (pgrp->fi.member_ct && (fpos >= pgrp->fi.member_fpos_starts[pgrp->fi.ff_member_idx + 1]))) {
+    if (unlikely(PgenFseek(fpos, &(pgrp->fi), &(pgrp->ff)))) {
+      return 1;
+    }
+  }
+#ifdef __LP64__
+  if (unlikely(fread_checked(pgrp->fread_buf, cur_vrec_width, pgrp->ff))) {
+    if (feof_unlocked(pgrp->ff)) {
+      errno = 0;
+    }
+    return 1;
+  }
+#else
+  // cur_vrec_width < 2^31 since otherwise we error out on initialization
+  if (unlikely(!fread_unlocked(pgrp->fread_buf, cur_vrec_width, 1, pgrp->ff))) {
+    if (feof_unlocked(pgrp->ff)) {
+      errno = 0;
+    }
+    return 1;
+  }
+#endif
+#ifdef PGENLIB_ZSTD
+  }
+#endif
+  *fread_pp = pgrp->fread_buf;
+  *fread_endp = &(pgrp->fread_buf[cur_vrec_width]);
+  pgrp->fp_vidx = vidx + 1;
+  StripPbwtTrailer(vidx, pgrp->fread_buf, pgrp, fread_endp);
+  if (unlikely(ApplyDdeltaTrailer(vidx, pgrp, fread_pp, fread_endp))) {
+    errno = 0;
+    return 1;
+  }
+  return 0;
+}
+
+// Applies one PBWT run list to the haplotype ordering.  Haplotypes in 1-runs
+// are set in haps (if non-null), and the updated ordering is saved to
+// order_new (if non-null).
+BoolErr ApplyPbwtRuns(const unsigned char* runs_iter, const unsigned char* runs_end, const uint32_t* __restrict order, uint32_t hap_ct, uint32_t* __restrict order_new, uintptr_t* __restrict haps) {
+  uint32_t hap_pos = 0;
+  uint32_t zero_ct = 0;
+  uint32_t one_ct = 0;
+  uint32_t cur_bit = 0;
+  while (1) {
+    uint32_t run_end;
+    if (runs_iter != runs_end) {
+      const uint32_t run_len = GetVint31(runs_end, &runs_iter);
+      if (unlikely(run_len > hap_ct - hap_pos)) {
+        return 1;
+      }
+      run_end = hap_pos + run_len;
+    } else {
+      // final run is implied
+      run_end = hap_ct;
+    }
+    if (!cur_bit) {
+      if (order_new) {
+        memcpy(&(order_new[zero_ct]), &(order[hap_pos]), (run_end - hap_pos) * sizeof(int32_t));
+      }
+      zero_ct += run_end - hap_pos;
+    } else {
+      for (; hap_pos != run_end; ++hap_pos) {
+        const uint32_t hap_idx = order[hap_pos];
+        if (haps) {
+          SetBit(hap_idx, haps);
+        }
+        if (order_new) {
+          ++one_ct;
+          order_new[hap_ct - one_ct] = hap_idx;
+        }
+      }
+    }
+    hap_pos = run_end;
+    if (hap_pos == hap_ct) {
+      if (unlikely(runs_iter != runs_end)) {
+        return 1;
+      }
+      break;
+    }
+    cur_bit = 1 - cur_bit;
+  }
+  if (order_new) {
+    for (uint32_t uii = zero_ct, ujj = hap_ct - 1; uii < ujj; ++uii, --ujj) {
+      const uint32_t tmp = order_new[uii];
+      order_new[uii] = order_new[ujj];
+      order_new[ujj] = tmp;
+    }
+  }
+  return 0;
+}
+
+// Applies the haplotype ordering update for a record with a standard track
+// #2 and non-LD-compressed genotypes.  Clobbers pgrp->pbwt_haps.
+PglErr PbwtAdvanceStd(const unsigned char* fread_ptr, const unsigned char* fread_end, uint32_t vrtype, PgenReaderMain* pgrp) {
+  const uint32_t raw_sample_ct = pgrp->fi.raw_sample_ct;
+  const uint32_t raw_sample_ctl = BitCtToWordCt(raw_sample_ct);
+  uintptr_t* haps = pgrp->pbwt_haps;
+  PglErr reterr = ParseNonLdGenovecSubsetUnsafe(fread_end, nullptr, nullptr, raw_sample_ct, vrtype, &fread_ptr, pgrp, haps);
+  if (unlikely(reterr)) {
+    return reterr;
+  }
+  ZeroTrailingNyps(raw_sample_ct, haps);
+  const uintptr_t bitvec_word_ct = BitCtToCachelineCt(raw_sample_ct) * kWordsPerCacheline;
+  uintptr_t* all_hets = pgrp->pbwt_workspace;
+  uintptr_t* phasepresent = &(all_hets[bitvec_word_ct]);
+  uintptr_t* phaseinfo = &(phasepresent[bitvec_word_ct]);
+  PgrDetectGenoarrHets(haps, raw_sample_ct, all_hets);
+  const uint32_t het_ct = PopcountWords(all_hets, raw_sample_ctl);
+  const unsigned char* aux2_start = fread_ptr;
+  if (unlikely((!het_ct) || PtrAddCk(fread_end, 1 + (het_ct / CHAR_BIT), &fread_ptr))) {
+    return kPglRetMalformedInput;
+  }
+  if (!(aux2_start[0] & 1)) {
+    ExpandBytearr(aux2_start, all_hets, raw_sample_ctl, het_ct, 1, phaseinfo);
+  } else {
+    ExpandBytearr(aux2_start, all_hets, raw_sample_ctl, het_ct, 1, phasepresent);
+    const uint32_t phasepresent_ct = PopcountWords(phasepresent, raw_sample_ctl);
+    if (unlikely((!phasepresent_ct) || PtrCheck(fread_end, fread_ptr, DivUp(phasepresent_ct, CHAR_BIT)))) {
+      return kPglRetMalformedInput;
+    }
+    ExpandBytearr(fread_ptr, phasepresent, raw_sample_ctl, phasepresent_ct, 0, phaseinfo);
+  }
+  // same mapping as PbwtRecodeHphase() in pgenlib_write.cc
+  const uint32_t raw_sample_ctl2 = NypCtToWordCt(raw_sample_ct);
+  const Halfword* phaseinfo_alias = R_CAST(const Halfword*, phaseinfo);
+  for (uint32_t widx = 0; widx != raw_sample_ctl2; ++widx) {
+    const uintptr_t geno_word = haps[widx];
+    const uintptr_t homalt = (geno_word >> 1) & (~geno_word) & kMask5555;
+    const uintptr_t hets = Word01(geno_word);
+    const uintptr_t swapped = UnpackHalfwordToWord(phaseinfo_alias[widx]) & hets;
+    haps[widx] = (homalt * 3) | swapped | ((hets ^ swapped) << 1);
+  }
+  const uint32_t hap_ct = 2 * raw_sample_ct;
+  uint32_t* order = pgrp->pbwt_order;
+  uint32_t* order_new = pgrp->pbwt_order_tmp;
+  uint32_t zero_ct = 0;
+  uint32_t one_ct = 0;
+  for (uint32_t uii = 0; uii != hap_ct; ++uii) {
+    const uint32_t hap_idx = order[uii];
+    if (IsSet(haps, hap_idx)) {
+      ++one_ct;
+      order_new[hap_ct - one_ct] = hap_idx;
+    } else {
+      order_new[zero_ct++] = hap_idx;
+    }
+  }
+  for (uint32_t uii = zero_ct, ujj = hap_ct - 1; uii < ujj; ++uii, --ujj) {
+    const uint32_t tmp = order_new[uii];
+    order_new[uii] = order_new[ujj];
+    order_new[ujj] = tmp;
+  }
+  pgrp->pbwt_order = order_new;
+  pgrp->pbwt_order_tmp = order;
+  return kPglRetSuccess;
+}
+
+// Brings pgrp->pbwt_order up to date for decoding variant vidx.  In block-load
+// mode, this requires all records from the start of vidx's reset window to be
+// loaded; GetMultireadStartVidx() takes care of this.
+PglErr PbwtReplay(uint32_t vidx, PgenReaderMain* pgrp) {
+  const uint32_t hap_ct = 2 * pgrp->fi.raw_sample_ct;
+  const uint32_t window_vidx = RoundDownPow2(vidx, kPglPbwtResetInterval);
+  uint32_t cur_vidx = pgrp->pbwt_next_vidx;
+  if ((cur_vidx > vidx) || (cur_vidx <= window_vidx)) {
+    uint32_t* order = pgrp->pbwt_order;
+    for (uint32_t uii = 0; uii != hap_ct; ++uii) {
+      order[uii] = uii;
+    }
+    cur_vidx = window_vidx;
+  }
+  // pbwt_order_tmp is about to be clobbered
+  pgrp->pbwt_prev_vidx = UINT32_MAX;
+  const unsigned char* vrtypes = pgrp->fi.vrtypes;
+  const uint64_t* var_fpos = pgrp->fi.var_fpos;
+  const unsigned char* block_base = pgrp->fi.block_base;
+  for (; cur_vidx != vidx; ++cur_vidx) {
+    const uint32_t vrtype = vrtypes[cur_vidx];
+    if ((vrtype & 0x18) != 0x10) {
+      continue;
+    }
+    const uintptr_t vrec_width = var_fpos[cur_vidx + 1] - var_fpos[cur_vidx];
+    const unsigned char* vrec_start;
+    if (block_base != nullptr) {
+      vrec_start = &(block_base[var_fpos[cur_vidx] - pgrp->fi.block_offset]);
+    } else {
+      // the current record is usually in pgrp->fread_buf, so we use a
+      // separate buffer and force the next InitReadPtrs() call to seek
+      unsigned char* fread_buf = pgrp->pbwt_fread_buf;
+      pgrp->fp_vidx = UINT32_MAX;
+#ifdef PGENLIB_ZSTD
+      if (pgrp->fi.zst_group_fpos) {
+        if (unlikely((!vrec_width) || PgrZstReadVrec(cur_vidx, vrec_width, pgrp, fread_buf))) {
+          return kPglRetReadFail;
+        }
+      } else {
+#endif
+      if (unlikely((!vrec_width) || fseeko(pgrp->ff, var_fpos[cur_vidx], SEEK_SET) || (!fread_unlocked(fread_buf, vrec_width, 1, pgrp->ff)))) {
+        if (feof_unlocked(pgrp->ff)) {
+          errno = 0;
+        }
+        return kPglRetReadFail;
+      }
+#ifdef PGENLIB_ZSTD
+      }
+#endif
+      vrec_start = fread_buf;
+    }
+    const unsigned char* vrec_end = &(vrec_start[vrec_width]);
+    if (unlikely((!vrec_width) || (vrec_end[-1] > 1))) {
+      return kPglRetMalformedInput;
+    }
+    if (!vrec_end[-1]) {
+      if (VrtypeLdCompressed(vrtype)) {
+        continue;
+      }
+      PglErr reterr = PbwtAdvanceStd(vrec_start, &(vrec_end[-1]), vrtype, pgrp);
+      if (unlikely(reterr)) {
+        return reterr;
+      }
+      continue;
+    }
+    if (unlikely(vrec_width < kPglPbwtTrailerByteCt)) {
+      return kPglRetMalformedInput;
     }
-    return 1;
+    const unsigned char* trailer = &(vrec_end[-kPglPbwtTrailerByteCt]);
+    uint32_t runs_offset;
+    uint32_t runs_byte_ct;
+    memcpy(&runs_offset, trailer, sizeof(int32_t));
+    memcpy(&runs_byte_ct, &(trailer[sizeof(int32_t)]), sizeof(int32_t));
+    const uintptr_t body_byte_ct = vrec_width - kPglPbwtTrailerByteCt;
+    if (unlikely((!runs_byte_ct) || (runs_offset > body_byte_ct) || (runs_byte_ct > body_byte_ct - runs_offset))) {
+      return kPglRetMalformedInput;
+    }
+    const unsigned char* runs = &(vrec_start[runs_offset]);
+    uint32_t* order = pgrp->pbwt_order;
+    uint32_t* order_new = pgrp->pbwt_order_tmp;
+    if (unlikely(ApplyPbwtRuns(runs, &(runs[runs_byte_ct]), order, hap_ct, order_new, nullptr))) {
+      return kPglRetMalformedInput;
+    }
+    pgrp->pbwt_order = order_new;
+    pgrp->pbwt_order_tmp = order;
   }
-#else
-  // cur_vrec_width < 2^31 since otherwise we error out on initialization
-  if (unlikely(!fread_unlocked(pgrp->fread_buf, cur_vrec_width, 1, pgrp->ff))) {
-    if (feof_unlocked(pgrp->ff)) {
-      errno = 0;
+  pgrp->pbwt_next_vidx = vidx;
+  return kPglRetSuccess;
+}
+
+// Decodes the PBWT run list of biallelic variant vidx into pgrp->pbwt_haps
+// (2 bits per sample, first haplotype in the low bit).
+PglErr PbwtDecodeHaps(const unsigned char* runs, uint32_t runs_byte_ct, uint32_t vidx, PgenReaderMain* pgrp) {
+  const uint32_t raw_sample_ct = pgrp->fi.raw_sample_ct;
+  const uint32_t hap_ct = 2 * raw_sample_ct;
+  uintptr_t* haps = pgrp->pbwt_haps;
+  const uint32_t raw_sample_ctl2 = NypCtToWordCt(raw_sample_ct);
+  if ((vidx == pgrp->pbwt_prev_vidx) && (pgrp->pbwt_next_vidx == vidx + 1)) {
+    // already decoded once; pbwt_order_tmp has the ordering we need
+    ZeroWArr(raw_sample_ctl2, haps);
+    if (unlikely(ApplyPbwtRuns(runs, &(runs[runs_byte_ct]), pgrp->pbwt_order_tmp, hap_ct, nullptr, haps))) {
+      return kPglRetMalformedInput;
     }
-    return 1;
+    return kPglRetSuccess;
   }
-#endif
-  *fread_pp = pgrp->fread_buf;
-  *fread_endp = &(pgrp->fread_buf[cur_vrec_width]);
-  pgrp->fp_vidx = vidx + 1;
-  return 0;
+  PglErr reterr = PbwtReplay(vidx, pgrp);
+  if (unlikely(reterr)) {
+    pgrp->pbwt_next_vidx = UINT32_MAX;
+    return reterr;
+  }
+  ZeroWArr(raw_sample_ctl2, haps);
+  uint32_t* order = pgrp->pbwt_order;
+  uint32_t* order_new = pgrp->pbwt_order_tmp;
+  if (unlikely(ApplyPbwtRuns(runs, &(runs[runs_byte_ct]), order, hap_ct, order_new, haps))) {
+    // force a reset next time
+    pgrp->pbwt_next_vidx = UINT32_MAX;
+    return kPglRetMalformedInput;
+  }
+  pgrp->pbwt_order = order_new;
+  pgrp->pbwt_order_tmp = order;
+  pgrp->pbwt_prev_vidx = vidx;
+  pgrp->pbwt_next_vidx = vidx + 1;
+  return kPglRetSuccess;
 }
 
 uint32_t LdLoadNecessary(uint32_t cur_vidx, PgenReaderMain* pgrp) {
@@ -2733,14 +3715,24 @@ PglErr LdLoadMinimalSubsetIfNecessary(const uintptr_t* __restrict sample_include
     }
     pgrp->fp_vidx = ldbase_vidx + 1;
   } else {
-    if (unlikely(fseeko(pgrp->ff, pgrp->fi.var_fpos[ldbase_vidx], SEEK_SET))) {
+    const uintptr_t cur_vrec_width = pgrp->fi.var_fpos[ldbase_vidx + 1] - cur_vidx_fpos;
+    // always zero unless compiled with PGENLIB_ZSTD
+    const uint32_t zst_records = (pgrp->fi.zst_group_fpos != nullptr);
+    if ((!zst_records) && unlikely(PgenFseek(pgrp->fi.var_fpos[ldbase_vidx], &(pgrp->fi), &(pgrp->ff)))) {
       return kPglRetReadFail;
     }
-    const uintptr_t cur_vrec_width = pgrp->fi.var_fpos[ldbase_vidx + 1] - cur_vidx_fpos;
     pgrp->fp_vidx = ldbase_vidx + 1;
     if (!(ldbase_vrtype & 7)) {
       // don't actually need to fread the whole record in this case
       const uint32_t raw_sample_ct4 = NypCtToByteCt(raw_sample_ct);
+      if (zst_records) {
+#ifdef PGENLIB_ZSTD
+        if (unlikely(PgrZstReadVrec(ldbase_vidx, raw_sample_ct4, pgrp, R_CAST(unsigned char*, raw_genovec)))) {
+          return kPglRetReadFail;
+        }
+#endif
+        goto LdLoadMinimalSubsetIfNecessary_genovec_finish;
+      }
       if (unlikely(!fread_unlocked(raw_genovec, raw_sample_ct4, 1, pgrp->ff))) {
         if (feof_unlocked(pgrp->ff)) {
           errno = 0;
@@ -2753,7 +3745,13 @@ PglErr LdLoadMinimalSubsetIfNecessary(const uintptr_t* __restrict sample_include
       }
       goto LdLoadMinimalSubsetIfNecessary_genovec_finish;
     }
-    if (unlikely(!fread_unlocked(pgrp->fread_buf, cur_vrec_width, 1, pgrp->ff))) {
+    if (zst_records) {
+#ifdef PGENLIB_ZSTD
+      if (unlikely(PgrZstReadVrec(ldbase_vidx, cur_vrec_width, pgrp, pgrp->fread_buf))) {
+        return kPglRetReadFail;
+      }
+#endif
+    } else if (unlikely(!fread_unlocked(pgrp->fread_buf, cur_vrec_width, 1, pgrp->ff))) {
       if (feof_unlocked(pgrp->ff)) {
         errno = 0;
       }
@@ -3351,13 +4349,18 @@ PglErr GetBasicGenotypeCounts(const uintptr_t* __restrict sample_include, const
   }
   assert((!subsetting_required) && ((vrtype & 0x18) == 0x10));
   const uint32_t het_ct = genocounts[1];
-  const uint32_t aux2_first_part_byte_ct = 1 + (het_ct / CHAR_BIT);
-  if (PtrCheck(fread_end, fread_ptr, aux2_first_part_byte_ct)) {
+  // (mode 0x12 PBWT-coded tracks only have a single byte here when phase is
+  // always present)
+  if (PtrCheck(fread_end, fread_ptr, 1)) {
     return kPglRetMalformedInput;
   }
   const uint32_t explicit_phasepresent = fread_ptr[0] & 1;
   if (explicit_phasepresent) {
     // otherwise initial value if 0 is correct
+    const uint32_t aux2_first_part_byte_ct = 1 + (het_ct / CHAR_BIT);
+    if (PtrCheck(fread_end, fread_ptr, aux2_first_part_byte_ct)) {
+      return kPglRetMalformedInput;
+    }
     *unphased_het_ctp = het_ct + 1 - PopcountBytes(fread_ptr, aux2_first_part_byte_ct);
   }
   return kPglRetSuccess;
@@ -3373,6 +4376,26 @@ PglErr PgrGetCounts(const uintptr_t* __restrict sample_include, const uintptr_t*
   return GetBasicGenotypeCounts(sample_include, sample_include_interleaved_vec, GetSicp(pssi), sample_ct, vidx, pgrp, nullptr, genocounts);
 }
 
+PglErr PgrGetCountsMulti(const uintptr_t* __restrict subset_interleaved_vecs, const uint32_t* __restrict subset_sizes, uint32_t subset_ct, uint32_t vidx, PgenReader* pgr_ptr, uintptr_t* __restrict genovec, STD_ARRAY_PTR_DECL(uint32_t, 4, genocounts_arr)) {
+  PgenReaderMain* pgrp = GetPgrp(pgr_ptr);
+  assert(vidx < pgrp->fi.raw_variant_ct);
+  const uint32_t raw_sample_ct = pgrp->fi.raw_sample_ct;
+  PglErr reterr = ReadGenovecSubsetUnsafe(nullptr, nullptr, raw_sample_ct, vidx, pgrp, nullptr, nullptr, genovec);
+  if (unlikely(reterr)) {
+    return reterr;
+  }
+  ZeroTrailingNyps(raw_sample_ct, genovec);
+  // The raw genovec is small enough to stay cache-resident across the subset
+  // loop, so the per-subset cost is just the masked popcounts.
+  const uintptr_t mask_word_ct = BitCtToVecCt(raw_sample_ct) * kWordsPerVec;
+  const uintptr_t* mask_iter = subset_interleaved_vecs;
+  for (uint32_t subset_idx = 0; subset_idx != subset_ct; ++subset_idx) {
+    GenoarrCountSubsetFreqs(genovec, mask_iter, raw_sample_ct, subset_sizes[subset_idx], genocounts_arr[subset_idx]);
+    mask_iter = &(mask_iter[mask_word_ct]);
+  }
+  return kPglRetSuccess;
+}
+
 // Ok for nyp_vvec to be unaligned.
 uint32_t CountNypVec6(const VecW* nyp_vvec, uintptr_t nyp_word, uint32_t vec_ct) {
   assert(!(vec_ct % 6));
@@ -6624,13 +7647,68 @@ PglErr SkipAux1(const unsigned char* fread_end, const uintptr_t* __restrict raw_
   return SkipAux1b(fread_end, aux1b_mode, raw_sample_ct, allele_ct, raw_10_ct, fread_pp);
 }
 
+// Mode 0x12 counterpart of SkipAux2(), for a PBWT-coded track #2.
+PglErr SkipPbwtAux2(const unsigned char* fread_end, uint32_t het_ct, uint32_t runs_byte_ct, const unsigned char** fread_pp, uint32_t* __restrict phasepresent_ctp) {
+  const unsigned char* aux2_start = *fread_pp;
+  if (unlikely((runs_byte_ct == UINT32_MAX) || PtrCheck(fread_end, aux2_start, 1))) {
+    return kPglRetMalformedInput;
+  }
+  const uint32_t explicit_phasepresent = aux2_start[0] & 1;
+  const uint32_t aux2_first_part_byte_ct = explicit_phasepresent? (1 + (het_ct / CHAR_BIT)) : 1;
+  if (PtrAddCk(fread_end, aux2_first_part_byte_ct + S_CAST(uintptr_t, runs_byte_ct), fread_pp)) {
+    return kPglRetMalformedInput;
+  }
+  uint32_t phasepresent_ct = het_ct;
+  if (explicit_phasepresent) {
+    phasepresent_ct = PopcountBytes(aux2_start, aux2_first_part_byte_ct) - 1;
+    if (unlikely(!phasepresent_ct)) {
+      return kPglRetMalformedInput;
+    }
+  }
+  if (phasepresent_ctp) {
+    *phasepresent_ctp = phasepresent_ct;
+  }
+  return kPglRetSuccess;
+}
+
+// Assumes SkipPbwtAux2() has already succeeded on this track.  Fills
+// raw_phasepresent, and saves raw phaseinfo to pgrp->pbwt_haps (as a bitarray,
+// overwriting the decoded haplotypes).
+PglErr DecodePbwtAux2(const unsigned char* aux2_start, const uintptr_t* __restrict all_hets, uint32_t het_ct, uint32_t vidx, PgenReaderMain* pgrp, uintptr_t* __restrict raw_phasepresent) {
+  const uint32_t explicit_phasepresent = aux2_start[0] & 1;
+  const uint32_t aux2_first_part_byte_ct = explicit_phasepresent? (1 + (het_ct / CHAR_BIT)) : 1;
+  PglErr reterr = PbwtDecodeHaps(&(aux2_start[aux2_first_part_byte_ct]), pgrp->pbwt_runs_byte_ct, vidx, pgrp);
+  if (unlikely(reterr)) {
+    return reterr;
+  }
+  const uint32_t raw_sample_ct = pgrp->fi.raw_sample_ct;
+  const uint32_t raw_sample_ctl = BitCtToWordCt(raw_sample_ct);
+  if (explicit_phasepresent) {
+    ExpandBytearr(aux2_start, all_hets, raw_sample_ctl, het_ct, 1, raw_phasepresent);
+  } else {
+    memcpy(raw_phasepresent, all_hets, raw_sample_ctl * kBytesPerWord);
+  }
+  // phaseinfo bit = first haplotype's bit, since unswapped hets are encoded
+  // as 0|1
+  const uint32_t raw_sample_ctl2 = NypCtToWordCt(raw_sample_ct);
+  uintptr_t* haps = pgrp->pbwt_haps;
+  for (uint32_t widx = 0; widx != raw_sample_ctl; ++widx) {
+    uintptr_t phaseinfo_word = PackWordToHalfwordMask5555(haps[2 * widx]);
+    if (2 * widx + 1 != raw_sample_ctl2) {
+      phaseinfo_word |= S_CAST(uintptr_t, PackWordToHalfwordMask5555(haps[2 * widx + 1])) << kBitsPerWordD2;
+    }
+    haps[widx] = phaseinfo_word & raw_phasepresent[widx];
+  }
+  return kPglRetSuccess;
+}
+
 // sample_include assumed to be nullptr if no subsetting required
 // subsetted_10het should only be provided when you explicitly want to exclude
 // those phase entries
 // set phasepresent == phaseinfo == nullptr if you want to skip the entire
 // track; ok for phasepresent_ct_ptr to be nullptr too in that case
 // (also see SkipAux2() and GetPhasepresentAndSkipPhaseinfo() below)
-PglErr ParseAux2Subset(const unsigned char* fread_end, const uintptr_t* __restrict sample_include, const uintptr_t* __restrict all_hets, const uintptr_t* __restrict subsetted_10het, uint32_t raw_sample_ct, uint32_t sample_ct, const unsigned char** fread_pp, uintptr_t* __restrict phasepresent, uintptr_t* __restrict phaseinfo, uint32_t* __restrict phasepresent_ct_ptr, uintptr_t* __restrict workspace_subset) {
+PglErr ParseAux2Subset(const unsigned char* fread_end, const uintptr_t* __restrict sample_include, const uintptr_t* __restrict all_hets, const uintptr_t* __restrict subsetted_10het, uint32_t raw_sample_ct, uint32_t sample_ct, uint32_t vidx, PgenReaderMain* pgrp, const unsigned char** fread_pp, uintptr_t* __restrict phasepresent, uintptr_t* __restrict phaseinfo, uint32_t* __restrict phasepresent_ct_ptr) {
   const uint32_t raw_sample_ctl = BitCtToWordCt(raw_sample_ct);
   const uint32_t het_ct = PopcountWords(all_hets, raw_sample_ctl);
   if (unlikely(!het_ct)) {
@@ -6640,7 +7718,29 @@ PglErr ParseAux2Subset(const unsigned char* fread_end, const uintptr_t* __restri
   }
   const uint32_t sample_ctl = BitCtToWordCt(sample_ct);
   const unsigned char* aux2_start = *fread_pp;
-  if (!(aux2_start[0] & 1)) {
+  if (pgrp->pbwt_runs_byte_ct) {
+    uint32_t raw_phasepresent_ct;
+    PglErr reterr = SkipPbwtAux2(fread_end, het_ct, pgrp->pbwt_runs_byte_ct, fread_pp, &raw_phasepresent_ct);
+    if (reterr || (!phaseinfo)) {
+      return reterr;
+    }
+    uintptr_t* raw_phasepresent = sample_include? pgrp->workspace_subset : phasepresent;
+    reterr = DecodePbwtAux2(aux2_start, all_hets, het_ct, vidx, pgrp, raw_phasepresent);
+    if (unlikely(reterr)) {
+      return reterr;
+    }
+    const uintptr_t* raw_phaseinfo = pgrp->pbwt_haps;
+    if (!sample_include) {
+      memcpy(phaseinfo, raw_phaseinfo, raw_sample_ctl * kBytesPerWord);
+      if (!subsetted_10het) {
+        *phasepresent_ct_ptr = raw_phasepresent_ct;
+        return kPglRetSuccess;
+      }
+    } else {
+      CopyBitarrSubset(raw_phasepresent, sample_include, sample_ct, phasepresent);
+      CopyBitarrSubset(raw_phaseinfo, sample_include, sample_ct, phaseinfo);
+    }
+  } else if (!(aux2_start[0] & 1)) {
     // phase always present
     if (PtrAddCk(fread_end, 1 + (het_ct / CHAR_BIT), fread_pp)) {
       return kPglRetMalformedInput;
@@ -6672,7 +7772,7 @@ PglErr ParseAux2Subset(const unsigned char* fread_end, const uintptr_t* __restri
 
     // explicit phasepresent
     const uintptr_t* aux2_first_part = R_CAST(const uintptr_t*, aux2_start);
-    uintptr_t* aux2_first_part_copy = workspace_subset;
+    uintptr_t* aux2_first_part_copy = pgrp->workspace_subset;
     aux2_first_part_copy[het_ctdl] = 0;
     memcpy(aux2_first_part_copy, aux2_first_part, 1 + (het_ct / CHAR_BIT));
     const uint32_t raw_phasepresent_ct = PopcountWords(aux2_first_part_copy, het_ctdl + 1) - 1;
@@ -6707,7 +7807,10 @@ PglErr ParseAux2Subset(const unsigned char* fread_end, const uintptr_t* __restri
   return kPglRetSuccess;
 }
 
-PglErr SkipAux2(const unsigned char* fread_end, uint32_t het_ct, const unsigned char** fread_pp, uint32_t* __restrict phasepresent_ctp) {
+PglErr SkipAux2(const unsigned char* fread_end, uint32_t het_ct, const PgenReaderMain* pgrp, const unsigned char** fread_pp, uint32_t* __restrict phasepresent_ctp) {
+  if (pgrp->pbwt_runs_byte_ct) {
+    return SkipPbwtAux2(fread_end, het_ct, pgrp->pbwt_runs_byte_ct, fread_pp, phasepresent_ctp);
+  }
   const unsigned char* aux2_start = *fread_pp;
   const uint32_t aux2_first_part_byte_ct = 1 + (het_ct / CHAR_BIT);
   if (PtrAddCk(fread_end, aux2_first_part_byte_ct, fread_pp)) {
@@ -6807,7 +7910,7 @@ PglErr ReadGenovecHphaseSubsetUnsafe(const uintptr_t* __restrict sample_include,
       }
     }
   }
-  reterr = ParseAux2Subset(fread_end, subsetting_required? sample_include : nullptr, all_hets, subsetted_10het, raw_sample_ct, sample_ct, &fread_ptr, phasepresent, phaseinfo, phasepresent_ct_ptr, pgrp->workspace_subset);
+  reterr = ParseAux2Subset(fread_end, subsetting_required? sample_include : nullptr, all_hets, subsetted_10het, raw_sample_ct, sample_ct, vidx, pgrp, &fread_ptr, phasepresent, phaseinfo, phasepresent_ct_ptr);
   if (fread_pp) {
     *fread_pp = fread_ptr;
     *fread_endp = fread_end;
@@ -6844,7 +7947,7 @@ PglErr Get1MP(const uintptr_t* __restrict sample_include, const uint32_t* __rest
     return reterr;
   }
   const uint32_t raw_sample_ct = pgrp->fi.raw_sample_ct;
-  reterr = ParseAux2Subset(fread_end, (sample_ct != raw_sample_ct)? sample_include : nullptr, all_hets, subsetted_10het, raw_sample_ct, sample_ct, &fread_ptr, phasepresent, phaseinfo, phasepresent_ct_ptr, pgrp->workspace_subset);
+  reterr = ParseAux2Subset(fread_end, (sample_ct != raw_sample_ct)? sample_include : nullptr, all_hets, subsetted_10het, raw_sample_ct, sample_ct, vidx, pgrp, &fread_ptr, phasepresent, phaseinfo, phasepresent_ct_ptr);
   // bugfix (7 Sep 2018): Need to postprocess phasepresent when collapsing
   // multiple alleles.
   if (reterr || (!(*phasepresent_ct_ptr))) {
@@ -7019,7 +8122,7 @@ PglErr PgrGet2P(const uintptr_t* __restrict sample_include, PgrSampleSubsetIndex
       }
     }
   }
-  reterr = ParseAux2Subset(fread_end, sample_include, all_hets, subsetted_10het, raw_sample_ct, sample_ct, &fread_ptr, phasepresent, phaseinfo, phasepresent_ct_ptr, pgrp->workspace_subset);
+  reterr = ParseAux2Subset(fread_end, sample_include, all_hets, subsetted_10het, raw_sample_ct, sample_ct, vidx, pgrp, &fread_ptr, phasepresent, phaseinfo, phasepresent_ct_ptr);
   if (unlikely(reterr)) {
     return reterr;
   }
@@ -7062,7 +8165,7 @@ PglErr PgrGetMP(const uintptr_t* __restrict sample_include, PgrSampleSubsetIndex
     return reterr;
   }
   const uint32_t raw_sample_ct = pgrp->fi.raw_sample_ct;
-  return ParseAux2Subset(fread_end, (sample_ct != raw_sample_ct)? sample_include : nullptr, all_hets, nullptr, raw_sample_ct, sample_ct, &fread_ptr, pgvp->phasepresent, pgvp->phaseinfo, &(pgvp->phasepresent_ct), pgrp->workspace_subset);
+  return ParseAux2Subset(fread_end, (sample_ct != raw_sample_ct)? sample_include : nullptr, all_hets, nullptr, raw_sample_ct, sample_ct, vidx, pgrp, &fread_ptr, pgvp->phasepresent, pgvp->phaseinfo, &(pgvp->phasepresent_ct));
 }
 
 // ok for sample_include to be nullptr if not subsetting, though this is not
@@ -7514,13 +8617,25 @@ uint64_t U16VecSum(const uint16_t* __restrict uint16_vec, uint32_t entry_ct) {
 #endif
 }
 
-PglErr GetPhasepresentAndSkipPhaseinfo(const unsigned char* fread_end, const uintptr_t* __restrict all_hets, uint32_t raw_sample_ct, uint32_t het_ct, const unsigned char** fread_pp, uintptr_t* __restrict phasepresent, uint32_t* __restrict phasepresent_ctp) {
+PglErr GetPhasepresentAndSkipPhaseinfo(const unsigned char* fread_end, const uintptr_t* __restrict all_hets, uint32_t raw_sample_ct, uint32_t het_ct, const PgenReaderMain* pgrp, const unsigned char** fread_pp, uintptr_t* __restrict phasepresent, uint32_t* __restrict phasepresent_ctp) {
   const unsigned char* aux2_start = *fread_pp;
+  const uint32_t raw_sample_ctl = BitCtToWordCt(raw_sample_ct);
+  if (pgrp->pbwt_runs_byte_ct) {
+    PglErr reterr = SkipPbwtAux2(fread_end, het_ct, pgrp->pbwt_runs_byte_ct, fread_pp, phasepresent_ctp);
+    if (unlikely(reterr)) {
+      return reterr;
+    }
+    if (!(aux2_start[0] & 1)) {
+      memcpy(phasepresent, all_hets, raw_sample_ctl * kBytesPerWord);
+    } else {
+      ExpandBytearr(aux2_start, all_hets, raw_sample_ctl, het_ct, 1, phasepresent);
+    }
+    return kPglRetSuccess;
+  }
   const uint32_t aux2_first_part_byte_ct = 1 + (het_ct / CHAR_BIT);
   if (PtrAddCk(fread_end, aux2_first_part_byte_ct, fread_pp)) {
     return kPglRetMalformedInput;
   }
-  const uint32_t raw_sample_ctl = BitCtToWordCt(raw_sample_ct);
   if (!(aux2_start[0] & 1)) {
     memcpy(phasepresent, all_hets, raw_sample_ctl * kBytesPerWord);
     *phasepresent_ctp = het_ct;
@@ -7543,8 +8658,7 @@ PglErr GetUnphasedBiallelicHetCt(const uintptr_t* __restrict sample_include, con
   } else {
     raw_het_ct = CountNyp(raw_genoarr, kMask5555, raw_sample_ct);
   }
-  const uint32_t aux2_first_part_byte_ct = 1 + (raw_het_ct / CHAR_BIT);
-  if (PtrCheck(fread_end, fread_ptr, aux2_first_part_byte_ct)) {
+  if (PtrCheck(fread_end, fread_ptr, 1)) {
     return kPglRetMalformedInput;
   }
   const uint32_t explicit_phasepresent = fread_ptr[0] & 1;
@@ -7552,6 +8666,10 @@ PglErr GetUnphasedBiallelicHetCt(const uintptr_t* __restrict sample_include, con
     // initial value of 0 is correct
     return kPglRetSuccess;
   }
+  const uint32_t aux2_first_part_byte_ct = 1 + (raw_het_ct / CHAR_BIT);
+  if (PtrCheck(fread_end, fread_ptr, aux2_first_part_byte_ct)) {
+    return kPglRetMalformedInput;
+  }
   if (raw_het_ct == subsetted_het_ct) {
     *unphased_het_ctp = raw_het_ct + 1 - PopcountBytes(fread_ptr, aux2_first_part_byte_ct);
     return kPglRetSuccess;
@@ -7689,7 +8807,7 @@ PglErr GetBasicGenotypeCountsAndDosage16s(const uintptr_t* __restrict sample_inc
       } else if (subsetting_required) {
         raw_het_ct = CountNyp(raw_genovec, kMask5555, raw_sample_ct);
       }
-      reterr = SkipAux2(fread_end, raw_het_ct, &fread_ptr, nullptr);
+      reterr = SkipAux2(fread_end, raw_het_ct, pgrp, &fread_ptr, nullptr);
       if (unlikely(reterr)) {
         return reterr;
       }
@@ -7700,17 +8818,9 @@ PglErr GetBasicGenotypeCountsAndDosage16s(const uintptr_t* __restrict sample_inc
       if (subsetting_required) {
         raw_het_ct = PopcountWords(all_hets, raw_sample_ctl);
       }
-      const uint32_t first_half_byte_ct = 1 + (raw_het_ct / CHAR_BIT);
-      const uint32_t explicit_phasepresent = fread_ptr[0] & 1;
-      if (explicit_phasepresent) {
-        ExpandBytearr(fread_ptr, all_hets, raw_sample_ctl, raw_het_ct, 1, raw_phasepresent);
-        raw_phasepresent_ct = PopcountBytes(fread_ptr, first_half_byte_ct) - 1;
-        const uint32_t second_half_byte_ct = DivUp(raw_phasepresent_ct, CHAR_BIT);
-        fread_ptr = &(fread_ptr[first_half_byte_ct + second_half_byte_ct]);
-      } else {
-        raw_phasepresent_ct = raw_het_ct;
-        memcpy(raw_phasepresent, all_hets, raw_sample_ctl * sizeof(intptr_t));
-        fread_ptr = &(fread_ptr[first_half_byte_ct]);
+      reterr = GetPhasepresentAndSkipPhaseinfo(fread_end, all_hets, raw_sample_ct, raw_het_ct, pgrp, &fread_ptr, raw_phasepresent, &raw_phasepresent_ct);
+      if (unlikely(reterr)) {
+        return reterr;
       }
     }
   } else if (VrtypeMultiallelicHc(vrtype)) {
@@ -8729,13 +9839,13 @@ PglErr GetMultiallelicCountsAndDosage16s(const uintptr_t* __restrict sample_incl
   uint32_t extra_phased_het_ct = 0;
   if (raw_het_ct_needed) {
     if (!all_hets) {
-      reterr = SkipAux2(fread_end, raw_het_ct, &fread_ptr, is_minimac3_r2? (&extra_phased_het_ct) : nullptr);
+      reterr = SkipAux2(fread_end, raw_het_ct, pgrp, &fread_ptr, is_minimac3_r2? (&extra_phased_het_ct) : nullptr);
       if (unlikely(reterr)) {
         return reterr;
       }
     } else {
       raw_phasepresent = pgrp->workspace_subset;
-      reterr = GetPhasepresentAndSkipPhaseinfo(fread_end, all_hets, raw_sample_ct, raw_het_ct, &fread_ptr, raw_phasepresent, &extra_phased_het_ct);
+      reterr = GetPhasepresentAndSkipPhaseinfo(fread_end, all_hets, raw_sample_ct, raw_het_ct, pgrp, &fread_ptr, raw_phasepresent, &extra_phased_het_ct);
       if (unlikely(reterr)) {
         return reterr;
       }
@@ -8911,7 +10021,7 @@ PglErr PgrGetMDp(const uintptr_t* __restrict sample_include, PgrSampleSubsetInde
     }
     if (!(vrtype & 0x60)) {
       const uint32_t raw_sample_ct = pgrp->fi.raw_sample_ct;
-      return ParseAux2Subset(fread_end, (sample_ct != raw_sample_ct)? sample_include : nullptr, all_hets, nullptr, raw_sample_ct, sample_ct, &fread_ptr, pgvp->phasepresent, pgvp->phaseinfo, &(pgvp->phasepresent_ct), pgrp->workspace_subset);
+      return ParseAux2Subset(fread_end, (sample_ct != raw_sample_ct)? sample_include : nullptr, all_hets, nullptr, raw_sample_ct, sample_ct, vidx, pgrp, &fread_ptr, pgvp->phasepresent, pgvp->phaseinfo, &(pgvp->phasepresent_ct));
     }
   } else {
     // todo: ReadRawGenovec, etc.
@@ -8974,6 +10084,59 @@ uintptr_t CountAux1bHets(const AlleleCode* patch_10_vals, uintptr_t rare10_ct) {
 #endif
 }
 
+// PgrGetRaw() helper: translates a mode 0x12 PBWT-coded track #2 back to the
+// standard representation.
+PglErr GetRawPbwtHphase(const unsigned char* fread_end, const uintptr_t* __restrict genovec, uint32_t het_ct, uint32_t vidx, uint32_t save_hphase, PgenReaderMain* pgrp, const unsigned char** fread_pp, uintptr_t** loadbuf_iter_ptr) {
+  if (unlikely(!het_ct)) {
+    return kPglRetMalformedInput;
+  }
+  const unsigned char* aux2_start = *fread_pp;
+  uint32_t raw_phasepresent_ct;
+  PglErr reterr = SkipPbwtAux2(fread_end, het_ct, pgrp->pbwt_runs_byte_ct, fread_pp, &raw_phasepresent_ct);
+  if (reterr || (!save_hphase)) {
+    return reterr;
+  }
+  uintptr_t* all_hets = pgrp->workspace_all_hets;
+  PgrDetectGenoarrHets(genovec, pgrp->fi.raw_sample_ct, all_hets);
+  uintptr_t* raw_phasepresent = pgrp->workspace_subset;
+  reterr = DecodePbwtAux2(aux2_start, all_hets, het_ct, vidx, pgrp, raw_phasepresent);
+  if (unlikely(reterr)) {
+    return reterr;
+  }
+  const uintptr_t* raw_phaseinfo = pgrp->pbwt_haps;
+  const uint32_t het_ctdl = het_ct / kBitsPerWord;
+  const uint32_t explicit_phasepresent = aux2_start[0] & 1;
+  // this needs to be synced with MakePgenThread()
+  uintptr_t* phaseraw = *loadbuf_iter_ptr;
+#ifdef __LP64__
+  phaseraw[0] = explicit_phasepresent? (het_ct | (S_CAST(uint64_t, raw_phasepresent_ct) << 32)) : het_ct;
+#else
+  phaseraw[0] = het_ct;
+  phaseraw[1] = explicit_phasepresent? raw_phasepresent_ct : 0;
+#endif
+  uintptr_t* loadbuf_iter = &(phaseraw[8 / kBytesPerWord]);
+  loadbuf_iter[het_ctdl] = 0;
+  if (explicit_phasepresent) {
+    memcpy(loadbuf_iter, aux2_start, 1 + (het_ct / CHAR_BIT));
+    loadbuf_iter = &(loadbuf_iter[1 + het_ctdl]);
+    CopyBitarrSubset(raw_phaseinfo, raw_phasepresent, raw_phasepresent_ct, loadbuf_iter);
+    loadbuf_iter = &(loadbuf_iter[BitCtToWordCt(raw_phasepresent_ct)]);
+  } else {
+    // phaseinfo bits follow the initial 0 bit
+    CopyBitarrSubset(raw_phaseinfo, all_hets, het_ct, loadbuf_iter);
+    for (uint32_t widx = het_ctdl; widx; --widx) {
+      loadbuf_iter[widx] = (loadbuf_iter[widx] << 1) | (loadbuf_iter[widx - 1] >> (kBitsPerWord - 1));
+    }
+    loadbuf_iter[0] <<= 1;
+    loadbuf_iter = &(loadbuf_iter[1 + het_ctdl]);
+  }
+#ifdef __LP64__
+  VecAlignUp(&loadbuf_iter);
+#endif
+  *loadbuf_iter_ptr = loadbuf_iter;
+  return kPglRetSuccess;
+}
+
 PglErr PgrGetRaw(uint32_t vidx, PgenGlobalFlags read_gflags, PgenReader* pgr_ptr, uintptr_t** loadbuf_iter_ptr, unsigned char* loaded_vrtype_ptr) {
   PgenReaderMain* pgrp = GetPgrp(pgr_ptr);
   // currently handles multiallelic hardcalls, hardcall phase, and biallelic
@@ -9078,7 +10241,12 @@ PglErr PgrGetRaw(uint32_t vidx, PgenGlobalFlags read_gflags, PgenReader* pgr_ptr
     het_ct = CountNyp(genovec, kMask5555, raw_sample_ct);
   }
 
-  if (hphase_is_present) {
+  if (hphase_is_present && pgrp->pbwt_runs_byte_ct) {
+    reterr = GetRawPbwtHphase(fread_end, genovec, het_ct, vidx, save_hphase, pgrp, &fread_ptr, &loadbuf_iter);
+    if (unlikely(reterr)) {
+      return reterr;
+    }
+  } else if (hphase_is_present) {
     if (unlikely(!het_ct)) {
       // there shouldn't be a hphase track at all in this case
       return kPglRetMalformedInput;
@@ -9267,7 +10435,7 @@ PglErr PgrGetMissingnessD(const uintptr_t* __restrict sample_include, PgrSampleS
         CopyBitarrSubset(all_hets, sample_include, sample_ct, hets);
       }
       if (VrtypeHphase(vrtype)) {
-        reterr = SkipAux2(fread_end, PopcountWords(all_hets, raw_sample_ctl), &fread_ptr, nullptr);
+        reterr = SkipAux2(fread_end, PopcountWords(all_hets, raw_sample_ctl), pgrp, &fread_ptr, nullptr);
         if (unlikely(reterr)) {
           return reterr;
         }
@@ -9979,13 +11147,82 @@ BoolErr ValidateMultiallelicHc(const unsigned char* fread_end, const uintptr_t*
   return 0;
 }
 
-BoolErr ValidateHphase(const unsigned char* fread_end, uint32_t vidx, uint32_t het_ct, const unsigned char** fread_pp, char* errstr_buf) {
+// Checks a mode 0x12 PBWT-coded track #2, after the standard first-part
+// checks.  genovec must contain the variant's genotypes.
+BoolErr ValidatePbwtHphase(const unsigned char* fread_end, const uintptr_t* __restrict genovec, const unsigned char* vrec_start, uint32_t vidx, uint32_t het_ct, PgenReaderMain* pgrp, const unsigned char** fread_pp, char* errstr_buf) {
+  const unsigned char* aux2_start = *fread_pp;
+  const uint32_t runs_byte_ct = pgrp->pbwt_runs_byte_ct;
+  const uint32_t explicit_phasepresent = aux2_start[0] & 1;
+  if (unlikely((!explicit_phasepresent) && aux2_start[0])) {
+    snprintf(errstr_buf, kPglErrstrBufBlen, "Error: PBWT-coded hardcall phase track for (0-based) variant #%u has nonzero trailing bits.\n", vidx);
+    return 1;
+  }
+  const uint32_t aux2_first_part_byte_ct = explicit_phasepresent? (1 + (het_ct / CHAR_BIT)) : 1;
+  const unsigned char* runs = &(aux2_start[aux2_first_part_byte_ct]);
+  // run list must immediately follow the first part.  fread_end points to the
+  // start of the stripped trailer.
+  uint32_t runs_offset;
+  memcpy(&runs_offset, fread_end, sizeof(int32_t));
+  if (unlikely((S_CAST(uintptr_t, runs - vrec_start) != runs_offset) || PtrAddCk(fread_end, aux2_first_part_byte_ct + S_CAST(uintptr_t, runs_byte_ct), fread_pp))) {
+    snprintf(errstr_buf, kPglErrstrBufBlen, "Error: Invalid PBWT-coded hardcall phase track for (0-based) variant #%u.\n", vidx);
+    return 1;
+  }
+  PglErr reterr = PbwtDecodeHaps(runs, runs_byte_ct, vidx, pgrp);
+  if (unlikely(reterr)) {
+    if (reterr == kPglRetReadFail) {
+      FillPgenReadErrstrFromErrno(errstr_buf);
+    } else {
+      snprintf(errstr_buf, kPglErrstrBufBlen, "Error: Invalid PBWT run list for (0-based) variant #%u.\n", vidx);
+    }
+    return 1;
+  }
+  // haplotypes must be consistent with the genotypes; unphased hets must be
+  // encoded as 0|1.
+  const uint32_t sample_ct = pgrp->fi.raw_sample_ct;
+  const uint32_t sample_ctl2 = NypCtToWordCt(sample_ct);
+  const uintptr_t* haps = pgrp->pbwt_haps;
+  uintptr_t* phasepresent = pgrp->workspace_subset;
+  if (explicit_phasepresent) {
+    uintptr_t* all_hets = pgrp->workspace_all_hets;
+    PgrDetectGenoarrHets(genovec, sample_ct, all_hets);
+    ExpandBytearr(aux2_start, all_hets, BitCtToWordCt(sample_ct), het_ct, 1, phasepresent);
+  }
+  const Halfword* phasepresent_alias = R_CAST(const Halfword*, phasepresent);
+  for (uint32_t widx = 0; widx != sample_ctl2; ++widx) {
+    const uintptr_t geno_word = genovec[widx];
+    const uintptr_t homalt = (geno_word >> 1) & (~geno_word) & kMask5555;
+    const uintptr_t hets = Word01(geno_word);
+    const uintptr_t hap_word = haps[widx];
+    const uintptr_t hap0 = hap_word & kMask5555;
+    const uintptr_t hap1 = (hap_word >> 1) & kMask5555;
+    uintptr_t unphased_hets = 0;
+    if (explicit_phasepresent) {
+      unphased_hets = hets & (~UnpackHalfwordToWord(phasepresent_alias[widx]));
+    }
+    if (unlikely(((hap0 & hap1) != homalt) || ((hap0 ^ hap1) != hets) || (hap0 & unphased_hets))) {
+      snprintf(errstr_buf, kPglErrstrBufBlen, "Error: PBWT-coded hardcall phase track for (0-based) variant #%u is inconsistent with the genotypes.\n", vidx);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+BoolErr ValidateHphase(const unsigned char* fread_end, const uintptr_t* __restrict genovec, const unsigned char* vrec_start, uint32_t vidx, uint32_t het_ct, PgenReaderMain* pgrp, const unsigned char** fread_pp, char* errstr_buf) {
   if (unlikely(!het_ct)) {
     snprintf(errstr_buf, kPglErrstrBufBlen, "Error: Hardcall phase track present for (0-based) variant #%u, but there were no heterozygous calls.\n", vidx);
     return 1;
   }
-  const uint32_t aux2_first_part_byte_ct = 1 + (het_ct / CHAR_BIT);
   const unsigned char* aux2_first_part = *fread_pp;
+  if (pgrp->pbwt_runs_byte_ct) {
+    if (unlikely((pgrp->pbwt_runs_byte_ct == UINT32_MAX) || PtrCheck(fread_end, aux2_first_part, 1))) {
+      snprintf(errstr_buf, kPglErrstrBufBlen, "Error: Invalid PBWT-coded hardcall phase track for (0-based) variant #%u.\n", vidx);
+      return 1;
+    }
+    if (!((*aux2_first_part) & 1)) {
+      return ValidatePbwtHphase(fread_end, genovec, vrec_start, vidx, het_ct, pgrp, fread_pp, errstr_buf);
+    }
+  }
+  const uint32_t aux2_first_part_byte_ct = 1 + (het_ct / CHAR_BIT);
   if (PtrAddCk(fread_end, aux2_first_part_byte_ct, fread_pp)) {
     snprintf(errstr_buf, kPglErrstrBufBlen, "Error: Invalid hardcall phase track present for (0-based) variant #%u.\n", vidx);
     return 1;
@@ -10007,6 +11244,10 @@ BoolErr ValidateHphase(const unsigned char* fread_end, uint32_t vidx, uint32_t h
     snprintf(errstr_buf, kPglErrstrBufBlen, "Error: Hardcall phase track for (0-based) variant #%u does not have any actual phase information.\n", vidx);
     return 1;
   }
+  if (pgrp->pbwt_runs_byte_ct) {
+    *fread_pp = aux2_first_part;
+    return ValidatePbwtHphase(fread_end, genovec, vrec_start, vidx, het_ct, pgrp, fread_pp, errstr_buf);
+  }
   const uint32_t phaseinfo_byte_ct = DivUp(phasepresent_ct, CHAR_BIT);
   if (PtrAddCk(fread_end, phaseinfo_byte_ct, fread_pp)) {
     snprintf(errstr_buf, kPglErrstrBufBlen, "Error: Invalid hardcall phase track present for (0-based) variant #%u.\n", vidx);
@@ -10157,15 +11398,16 @@ PglErr ValidateDosage16(const unsigned char* fread_end, uint32_t vidx, PgenReade
   return kPglRetSuccess;
 }
 
-static_assert(kPglVblockSize == 65536, "PgrValidate() needs to have an error message updated.");
-PglErr PgrValidate(PgenReader* pgr_ptr, uintptr_t* genovec_buf, char* errstr_buf) {
+static_assert(kPglVblockSize == 65536, "PgrValidateHeader() needs to have an error message updated.");
+PglErr PgrValidateHeader(PgenReader* pgr_ptr, char* errstr_buf) {
   PgenReaderMain* pgrp = GetPgrp(pgr_ptr);
-  // Performs all validation which isn't done by pgfi_init_phase{1,2}() and
-  // PgrInit().
   const uintptr_t* allele_idx_offsets = pgrp->fi.allele_idx_offsets;
   const uint32_t variant_ct = pgrp->fi.raw_variant_ct;
-  const uint32_t sample_ct = pgrp->fi.raw_sample_ct;
   const uint32_t const_vrtype = pgrp->fi.const_vrtype;
+  if (unlikely(pgrp->fi.member_ct)) {
+    snprintf(errstr_buf, kPglErrstrBufBlen, "Error: PgrValidate() does not support multi-file .pgen filesets; validate each member separately.\n");
+    return kPglRetNotYetSupported;
+  }
   if (const_vrtype != UINT32_MAX) {
     if (unlikely(allele_idx_offsets && (allele_idx_offsets[variant_ct] != 2 * variant_ct))) {
       snprintf(errstr_buf, kPglErrstrBufBlen, "Error: .pvar file contains multiallelic variant(s), but .%s file does not.\n", (const_vrtype == kPglVrtypePlink1)? "bed" : "pgen");
@@ -10173,24 +11415,8 @@ PglErr PgrValidate(PgenReader* pgr_ptr, uintptr_t* genovec_buf, char* errstr_buf
     }
     // const uintptr_t const_vrec_width = pgrp->fi.const_vrec_width;
     if ((!const_vrtype) || (const_vrtype == kPglVrtypePlink1)) {
-      // only thing that can go wrong is nonzero trailing bits
-      const uint32_t dbl_sample_ct_mod4 = 2 * (sample_ct % 4);
-      if (!dbl_sample_ct_mod4) {
-        return kPglRetSuccess;
-      }
-      for (uint32_t vidx = 0; vidx != variant_ct; ++vidx) {
-        const unsigned char* fread_ptr;
-        const unsigned char* fread_end = nullptr;
-        if (unlikely(InitReadPtrs(vidx, pgrp, &fread_ptr, &fread_end))) {
-          FillPgenReadErrstrFromErrno(errstr_buf);
-          return kPglRetReadFail;
-        }
-        const uint32_t last_byte_in_record = fread_end[-1];
-        if (unlikely(last_byte_in_record >> dbl_sample_ct_mod4)) {
-          snprintf(errstr_buf, kPglErrstrBufBlen, "Error: Last byte of (0-based) variant #%u has nonzero trailing bits.\n", vidx);
-          return kPglRetMalformedInput;
-        }
-      }
+      // only thing that can go wrong is nonzero trailing bits, which is
+      // checked by PgrValidateRange()
       return kPglRetSuccess;
     }
     // todo: 16-bit dosage entries can't be in [32769,65534]
@@ -10223,7 +11449,10 @@ PglErr PgrValidate(PgenReader* pgr_ptr, uintptr_t* genovec_buf, char* errstr_buf
   }
 #endif
   // todo: modify this check when phase sets are implemented
-  const uint64_t expected_fsize = pgrp->fi.var_fpos[variant_ct];
+  uint64_t expected_fsize = pgrp->fi.var_fpos[variant_ct];
+  if (pgrp->fi.zst_group_fpos) {
+    expected_fsize = pgrp->fi.zst_group_fpos[DivUp(variant_ct, 1U << pgrp->fi.zst_group_lg)];
+  }
   if (unlikely(expected_fsize != fsize)) {
     snprintf(errstr_buf, kPglErrstrBufBlen, "Error: .pgen header indicates that file size should be %" PRIu64 " bytes, but actual file size is %" PRIu64 " bytes.\n", expected_fsize, fsize);
     return kPglRetMalformedInput;
@@ -10340,10 +11569,37 @@ PglErr PgrValidate(PgenReader* pgr_ptr, uintptr_t* genovec_buf, char* errstr_buf
     }
   }
 
-  // could move most of this into plink2_common and make it multithreaded, if
-  // speed is ever an issue.
+  return kPglRetSuccess;
+}
+
+PglErr PgrValidateRange(uint32_t vidx_start, uint32_t vidx_end, PgenReader* pgr_ptr, uintptr_t* genovec_buf, char* errstr_buf) {
+  PgenReaderMain* pgrp = GetPgrp(pgr_ptr);
+  const uintptr_t* allele_idx_offsets = pgrp->fi.allele_idx_offsets;
+  const uint32_t sample_ct = pgrp->fi.raw_sample_ct;
+  if (pgrp->fi.const_vrtype != UINT32_MAX) {
+    // PgrValidateHeader() has verified that this is a 2-bit format.
+    const uint32_t dbl_sample_ct_mod4 = 2 * (sample_ct % 4);
+    if (!dbl_sample_ct_mod4) {
+      return kPglRetSuccess;
+    }
+    for (uint32_t vidx = vidx_start; vidx != vidx_end; ++vidx) {
+      const unsigned char* fread_ptr;
+      const unsigned char* fread_end = nullptr;
+      if (unlikely(InitReadPtrs(vidx, pgrp, &fread_ptr, &fread_end))) {
+        FillPgenReadErrstrFromErrno(errstr_buf);
+        return kPglRetReadFail;
+      }
+      const uint32_t last_byte_in_record = fread_end[-1];
+      if (unlikely(last_byte_in_record >> dbl_sample_ct_mod4)) {
+        snprintf(errstr_buf, kPglErrstrBufBlen, "Error: Last byte of (0-based) variant #%u has nonzero trailing bits.\n", vidx);
+        return kPglRetMalformedInput;
+      }
+    }
+    return kPglRetSuccess;
+  }
+  const unsigned char* vrtypes = pgrp->fi.vrtypes;
   uint32_t allele_ct = 2;
-  for (uint32_t vidx = 0; vidx != variant_ct; ++vidx) {
+  for (uint32_t vidx = vidx_start; vidx != vidx_end; ++vidx) {
     const unsigned char* fread_ptr;
     const unsigned char* fread_end;
     if (unlikely(InitReadPtrs(vidx, pgrp, &fread_ptr, &fread_end))) {
@@ -10367,7 +11623,7 @@ PglErr PgrValidate(PgenReader* pgr_ptr, uintptr_t* genovec_buf, char* errstr_buf
     }
     // don't need genovec_buf to store main genotypes past this point.
     if (VrtypeHphase(vrtype)) {
-      if (unlikely(ValidateHphase(fread_end, vidx, het_ct, &fread_ptr, errstr_buf))) {
+      if (unlikely(ValidateHphase(fread_end, genovec_buf, fread_ptr_start, vidx, het_ct, pgrp, &fread_ptr, errstr_buf))) {
         return kPglRetMalformedInput;
       }
     }
@@ -10390,9 +11646,221 @@ PglErr PgrValidate(PgenReader* pgr_ptr, uintptr_t* genovec_buf, char* errstr_buf
   return kPglRetSuccess;
 }
 
+PglErr PgrValidate(PgenReader* pgr_ptr, uintptr_t* genovec_buf, char* errstr_buf) {
+  PglErr reterr = PgrValidateHeader(pgr_ptr, errstr_buf);
+  if (unlikely(reterr)) {
+    return reterr;
+  }
+  return PgrValidateRange(0, GetPgrp(pgr_ptr)->fi.raw_variant_ct, pgr_ptr, genovec_buf, errstr_buf);
+}
+
+uintptr_t PgrDecodeCacheSlotWordCt(uint32_t raw_sample_ct, uint32_t max_dosage_ct) {
+  uintptr_t word_ct = NypCtToAlignedWordCt(raw_sample_ct);
+  if (max_dosage_ct) {
+    word_ct += BitCtToAlignedWordCt(raw_sample_ct) + kWordsPerVec * DivUp(max_dosage_ct * sizeof(int16_t), kBytesPerVec);
+  }
+  return RoundUpPow2(word_ct, kWordsPerCacheline);
+}
+
+static uintptr_t DecodeCacheFixedCachelineCt(uint32_t raw_variant_ct, uint32_t raw_sample_ct) {
+  return Int32CtToCachelineCt(raw_variant_ct) + kPgrDecodeCacheSubsetSlotCt * BitCtToCachelineCt(raw_sample_ct);
+}
+
+uintptr_t PgrDecodeCacheCachelineReq(uint32_t raw_variant_ct, uint32_t raw_sample_ct, uint32_t max_dosage_ct, uint32_t slot_ct) {
+  // vidx_to_slot, subset_bitarrs, then per-slot sequence numbers, variant
+  // indexes, subset IDs, dosage counts, reference bytes, and payloads
+  return DecodeCacheFixedCachelineCt(raw_variant_ct, raw_sample_ct) + 4 * Int32CtToCachelineCt(slot_ct) + DivUp(slot_ct, kCacheline) + S_CAST(uint64_t, slot_ct) * (PgrDecodeCacheSlotWordCt(raw_sample_ct, max_dosage_ct) / kWordsPerCacheline);
+}
+
+uint32_t PgrDecodeCacheMaxSlotCt(uint32_t raw_variant_ct, uint32_t raw_sample_ct, uint32_t max_dosage_ct, uintptr_t byte_budget) {
+  const uintptr_t cacheline_budget = byte_budget / kCacheline;
+  const uintptr_t fixed_cacheline_ct = DecodeCacheFixedCachelineCt(raw_variant_ct, raw_sample_ct);
+  if (cacheline_budget <= fixed_cacheline_ct) {
+    return 0;
+  }
+  const uint64_t slot_byte_ct = PgrDecodeCacheSlotWordCt(raw_sample_ct, max_dosage_ct) * sizeof(intptr_t) + 4 * sizeof(int32_t) + 1;
+  uint64_t slot_ct = (S_CAST(uint64_t, cacheline_budget - fixed_cacheline_ct) * kCacheline) / slot_byte_ct;
+  // vidx_to_slot only tracks the latest entry for each variant, so more
+  // slots than this can't be used
+  if (slot_ct > raw_variant_ct) {
+    slot_ct = raw_variant_ct;
+  }
+  // correct for cacheline rounding
+  while (slot_ct && (PgrDecodeCacheCachelineReq(raw_variant_ct, raw_sample_ct, max_dosage_ct, slot_ct) > cacheline_budget)) {
+    --slot_ct;
+  }
+  return slot_ct;
+}
+
+void PgrDecodeCacheInit(uint32_t raw_variant_ct, uint32_t raw_sample_ct, uint32_t max_dosage_ct, uint32_t slot_ct, unsigned char* dcache_alloc, PgrDecodeCache* dcachep) {
+  dcachep->raw_variant_ct = raw_variant_ct;
+  dcachep->raw_sample_ct = raw_sample_ct;
+  dcachep->max_dosage_ct = max_dosage_ct;
+  dcachep->slot_ct = slot_ct;
+  dcachep->slot_word_ct = PgrDecodeCacheSlotWordCt(raw_sample_ct, max_dosage_ct);
+  unsigned char* alloc_iter = dcache_alloc;
+  dcachep->vidx_to_slot = R_CAST(uint32_t*, alloc_iter);
+  memset(dcachep->vidx_to_slot, 0xff, raw_variant_ct * sizeof(int32_t));
+  alloc_iter = &(alloc_iter[Int32CtToCachelineCt(raw_variant_ct) * kCacheline]);
+  dcachep->subset_bitarrs = R_CAST(uintptr_t*, alloc_iter);
+  alloc_iter = &(alloc_iter[kPgrDecodeCacheSubsetSlotCt * BitCtToCachelineCt(raw_sample_ct) * kCacheline]);
+  const uintptr_t slot_u32_byte_ct = Int32CtToCachelineCt(slot_ct) * kCacheline;
+  dcachep->slot_seqs = R_CAST(uint32_t*, alloc_iter);
+  ZeroU32Arr(slot_ct, dcachep->slot_seqs);
+  alloc_iter = &(alloc_iter[slot_u32_byte_ct]);
+  dcachep->slot_vidxs = R_CAST(uint32_t*, alloc_iter);
+  memset(dcachep->slot_vidxs, 0xff, slot_ct * sizeof(int32_t));
+  alloc_iter = &(alloc_iter[slot_u32_byte_ct]);
+  dcachep->slot_subset_ids = R_CAST(uint32_t*, alloc_iter);
+  alloc_iter = &(alloc_iter[slot_u32_byte_ct]);
+  dcachep->slot_dosage_cts = R_CAST(uint32_t*, alloc_iter);
+  alloc_iter = &(alloc_iter[slot_u32_byte_ct]);
+  dcachep->slot_refs = alloc_iter;
+  memset(dcachep->slot_refs, 0, slot_ct);
+  alloc_iter = &(alloc_iter[DivUp(slot_ct, kCacheline) * kCacheline]);
+  dcachep->slot_data = R_CAST(uintptr_t*, alloc_iter);
+  dcachep->clock_hand = 0;
+  for (uint32_t subset_slot_idx = 0; subset_slot_idx != kPgrDecodeCacheSubsetSlotCt; ++subset_slot_idx) {
+    dcachep->subset_sample_cts[subset_slot_idx] = 0;
+    dcachep->subset_ids[subset_slot_idx] = 0;
+  }
+  dcachep->subset_next_id = 1;
+  dcachep->subset_recycle_idx = 0;
+  dcachep->hit_ct = 0;
+  dcachep->miss_ct = 0;
+}
+
+uint32_t PgrDecodeCacheSubsetId(const uintptr_t* sample_include, uint32_t sample_ct, PgrDecodeCache* dcachep) {
+  const uint32_t raw_sample_ct = dcachep->raw_sample_ct;
+  if (sample_ct == raw_sample_ct) {
+    return 0;
+  }
+  const uintptr_t raw_sample_ctl = BitCtToWordCt(raw_sample_ct);
+  const uintptr_t subset_word_stride = BitCtToCachelineCt(raw_sample_ct) * kWordsPerCacheline;
+  for (uint32_t subset_slot_idx = 0; subset_slot_idx != kPgrDecodeCacheSubsetSlotCt; ++subset_slot_idx) {
+    if (dcachep->subset_ids[subset_slot_idx] && (dcachep->subset_sample_cts[subset_slot_idx] == sample_ct) && memequal(&(dcachep->subset_bitarrs[subset_slot_idx * subset_word_stride]), sample_include, raw_sample_ctl * sizeof(intptr_t))) {
+      return dcachep->subset_ids[subset_slot_idx];
+    }
+  }
+  const uint32_t subset_slot_idx = dcachep->subset_recycle_idx;
+  dcachep->subset_recycle_idx = (subset_slot_idx + 1) % kPgrDecodeCacheSubsetSlotCt;
+  memcpy(&(dcachep->subset_bitarrs[subset_slot_idx * subset_word_stride]), sample_include, raw_sample_ctl * sizeof(intptr_t));
+  dcachep->subset_sample_cts[subset_slot_idx] = sample_ct;
+  uint32_t subset_id = dcachep->subset_next_id++;
+  if (subset_id == UINT32_MAX) {
+    // UINT32_MAX is reserved to mean "don't cache"; wraparound could in
+    // principle resurrect a stale entry, but that requires 2^32 registrations
+    // without an intervening PgrDecodeCacheInit().
+    subset_id = 1;
+    dcachep->subset_next_id = 2;
+  }
+  dcachep->subset_ids[subset_slot_idx] = subset_id;
+  return subset_id;
+}
+
+// Returns 1 on a hit.  A slot rewritten while we were copying it out is
+// treated as a miss.
+static uint32_t DecodeCacheLookupD(uint32_t sample_ct, uint32_t vidx, uint32_t subset_id, PgrDecodeCache* dcachep, uintptr_t* __restrict genovec, uintptr_t* __restrict dosage_present, uint16_t* dosage_main, uint32_t* dosage_ct_ptr) {
+  const uint32_t slot_idx = __atomic_load_n(&(dcachep->vidx_to_slot[vidx]), __ATOMIC_ACQUIRE);
+  if (slot_idx == UINT32_MAX) {
+    return 0;
+  }
+  uint32_t* seq_ptr = &(dcachep->slot_seqs[slot_idx]);
+  const uint32_t seq = __atomic_load_n(seq_ptr, __ATOMIC_ACQUIRE);
+  if ((seq & 1) || (__atomic_load_n(&(dcachep->slot_vidxs[slot_idx]), __ATOMIC_RELAXED) != vidx) || (__atomic_load_n(&(dcachep->slot_subset_ids[slot_idx]), __ATOMIC_RELAXED) != subset_id)) {
+    return 0;
+  }
+  const uint32_t dosage_ct = __atomic_load_n(&(dcachep->slot_dosage_cts[slot_idx]), __ATOMIC_RELAXED);
+  if (dosage_ct > sample_ct) {
+    // torn read
+    return 0;
+  }
+  const uintptr_t* slot_data = &(dcachep->slot_data[slot_idx * dcachep->slot_word_ct]);
+  memcpy(genovec, slot_data, NypCtToWordCt(sample_ct) * sizeof(intptr_t));
+  if (dosage_ct) {
+    const uint32_t raw_sample_ct = dcachep->raw_sample_ct;
+    const uintptr_t* cached_dosage_present = &(slot_data[NypCtToAlignedWordCt(raw_sample_ct)]);
+    memcpy(dosage_present, cached_dosage_present, BitCtToWordCt(sample_ct) * sizeof(intptr_t));
+    memcpy(dosage_main, &(cached_dosage_present[BitCtToAlignedWordCt(raw_sample_ct)]), dosage_ct * sizeof(int16_t));
+  }
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if (__atomic_load_n(seq_ptr, __ATOMIC_RELAXED) != seq) {
+    return 0;
+  }
+  if (!dcachep->slot_refs[slot_idx]) {
+    __atomic_store_n(&(dcachep->slot_refs[slot_idx]), 1, __ATOMIC_RELAXED);
+  }
+  *dosage_ct_ptr = dosage_ct;
+  return 1;
+}
+
+static void DecodeCacheInsertD(const uintptr_t* __restrict genovec, const uintptr_t* __restrict dosage_present, const uint16_t* dosage_main, uint32_t sample_ct, uint32_t vidx, uint32_t subset_id, uint32_t dosage_ct, PgrDecodeCache* dcachep) {
+  if (dosage_ct > dcachep->max_dosage_ct) {
+    return;
+  }
+  const uint32_t slot_ct = dcachep->slot_ct;
+  // Newly inserted slots start with a clear reference bit, so a single scan
+  // through more variants than the cache can hold only displaces entries
+  // which haven't been reused.  Two sweeps are enough to clear every
+  // reference bit; if we still can't claim a slot, other threads are
+  // contending for the same ones and we just skip caching this record.
+  for (uint32_t attempt_idx = 0; attempt_idx != 2 * slot_ct; ++attempt_idx) {
+    const uint32_t slot_idx = __atomic_fetch_add(&(dcachep->clock_hand), 1, __ATOMIC_RELAXED) % slot_ct;
+    if (__atomic_load_n(&(dcachep->slot_refs[slot_idx]), __ATOMIC_RELAXED)) {
+      __atomic_store_n(&(dcachep->slot_refs[slot_idx]), 0, __ATOMIC_RELAXED);
+      continue;
+    }
+    uint32_t* seq_ptr = &(dcachep->slot_seqs[slot_idx]);
+    uint32_t seq = __atomic_load_n(seq_ptr, __ATOMIC_RELAXED);
+    if ((seq & 1) || (!__atomic_compare_exchange_n(seq_ptr, &seq, seq + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))) {
+      continue;
+    }
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    const uint32_t old_vidx = dcachep->slot_vidxs[slot_idx];
+    if (old_vidx != UINT32_MAX) {
+      uint32_t expected_slot_idx = slot_idx;
+      __atomic_compare_exchange_n(&(dcachep->vidx_to_slot[old_vidx]), &expected_slot_idx, UINT32_MAX, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    }
+    uintptr_t* slot_data = &(dcachep->slot_data[slot_idx * dcachep->slot_word_ct]);
+    memcpy(slot_data, genovec, NypCtToWordCt(sample_ct) * sizeof(intptr_t));
+    if (dosage_ct) {
+      const uint32_t raw_sample_ct = dcachep->raw_sample_ct;
+      uintptr_t* cached_dosage_present = &(slot_data[NypCtToAlignedWordCt(raw_sample_ct)]);
+      memcpy(cached_dosage_present, dosage_present, BitCtToWordCt(sample_ct) * sizeof(intptr_t));
+      memcpy(&(cached_dosage_present[BitCtToAlignedWordCt(raw_sample_ct)]), dosage_main, dosage_ct * sizeof(int16_t));
+    }
+    __atomic_store_n(&(dcachep->slot_vidxs[slot_idx]), vidx, __ATOMIC_RELAXED);
+    __atomic_store_n(&(dcachep->slot_subset_ids[slot_idx]), subset_id, __ATOMIC_RELAXED);
+    __atomic_store_n(&(dcachep->slot_dosage_cts[slot_idx]), dosage_ct, __ATOMIC_RELAXED);
+    __atomic_store_n(seq_ptr, seq + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&(dcachep->vidx_to_slot[vidx]), slot_idx, __ATOMIC_RELEASE);
+    return;
+  }
+}
+
+PglErr PgrGetDCached(const uintptr_t* __restrict sample_include, PgrSampleSubsetIndex pssi, uint32_t sample_ct, uint32_t vidx, uint32_t subset_id, PgrDecodeCache* dcachep, PgenReader* pgr_ptr, uintptr_t* __restrict genovec, uintptr_t* __restrict dosage_present, uint16_t* dosage_main, uint32_t* dosage_ct_ptr) {
+  if ((!dcachep) || (!dcachep->slot_ct) || (subset_id == UINT32_MAX)) {
+    return PgrGetD(sample_include, pssi, sample_ct, vidx, pgr_ptr, genovec, dosage_present, dosage_main, dosage_ct_ptr);
+  }
+  if (DecodeCacheLookupD(sample_ct, vidx, subset_id, dcachep, genovec, dosage_present, dosage_main, dosage_ct_ptr)) {
+    __atomic_fetch_add(&(dcachep->hit_ct), 1, __ATOMIC_RELAXED);
+    return kPglRetSuccess;
+  }
+  __atomic_fetch_add(&(dcachep->miss_ct), 1, __ATOMIC_RELAXED);
+  PglErr reterr = PgrGetD(sample_include, pssi, sample_ct, vidx, pgr_ptr, genovec, dosage_present, dosage_main, dosage_ct_ptr);
+  if (likely(!reterr)) {
+    DecodeCacheInsertD(genovec, dosage_present, dosage_main, sample_ct, vidx, subset_id, *dosage_ct_ptr, dcachep);
+  }
+  return reterr;
+}
+
 
 BoolErr CleanupPgfi(PgenFileInfo* pgfip, PglErr* reterrp) {
   // memory is the responsibility of the caller
+#ifdef PGENLIB_ZSTD
+  ZSTD_freeDCtx(S_CAST(ZSTD_DCtx*, pgfip->zst_dctx));
+  pgfip->zst_dctx = nullptr;
+#endif
   if (pgfip->shared_ff) {
     if (unlikely(fclose_null(&pgfip->shared_ff))) {
       if (*reterrp == kPglRetSuccess) {
@@ -10415,6 +11883,10 @@ BoolErr CleanupPgr(PgenReader* pgr_ptr, PglErr* reterrp) {
   if (!pgrp->ff) {
     return 0;
   }
+#ifdef PGENLIB_ZSTD
+  ZSTD_freeDCtx(S_CAST(ZSTD_DCtx*, pgrp->zst_dctx));
+  pgrp->zst_dctx = nullptr;
+#endif
   if (fclose_null(&(pgrp->ff))) {
     if (*reterrp == kPglRetSuccess) {
       *reterrp = kPglRetReadFail;
@@ -110,6 +110,31 @@ typedef struct PgenFileInfoStruct {
 
   const unsigned char* block_base;  // nullptr if using per-variant fread()
   uint64_t block_offset;  // 0 for mmap
+
+  // Zstd-compressed record groups (mode 0x14/0x16).  zst_group_fpos is
+  // nullptr if records are stored uncompressed; otherwise it has
+  // (group count + 1) entries, and group g occupies
+  //   [zst_group_fpos[g], zst_group_fpos[g+1])
+  // on disk.  var_fpos[] and block_offset refer to positions in the
+  // uncompressed record stream.  zst_dctx is lazily created by
+  // PgfiMultiread(), and freed by CleanupPgfi().
+  uint64_t* zst_group_fpos;
+  uint64_t zst_max_group_width;
+  uint32_t zst_group_lg;
+  void* zst_dctx;
+
+  // Multi-file filesets (see PgfiInitMultiPhase1()).  member_ct is zero for an
+  // ordinary single .pgen.  Otherwise, var_fpos[] and block_offset refer to
+  // the concatenation of the members' variant record sections: member m's
+  // records start at member_fpos_starts[m] in that stream, and at
+  // member_record_fpos[m] in member_fnames[m].  ff_member_idx is the member
+  // that shared_ff (or, in a PgenReader's copy, the reader's own file
+  // pointer) currently refers to.
+  const char* const* member_fnames;
+  uint64_t* member_fpos_starts;
+  uint64_t* member_record_fpos;
+  uint32_t member_ct;
+  uint32_t ff_member_idx;
 #ifndef NO_MMAP
   uint64_t file_size;
 #endif
@@ -129,6 +154,10 @@ typedef struct PgenReaderMainStruct {
   // ** per-variant fread()-only **
   FILE* ff;
   unsigned char* fread_buf;
+  // zstd record group cache; zst_group_idx is UINT32_MAX when empty
+  unsigned char* zst_group_buf;
+  void* zst_dctx;
+  uint32_t zst_group_idx;
   // ** end per-variant fread()-only **
 
   // if LD compression is present, cache the last non-LD-compressed variant
@@ -178,6 +207,31 @@ typedef struct PgenReaderMainStruct {
   uintptr_t* workspace_dosage_present;
   uintptr_t* workspace_dphase_present;
 
+  // Dosage-delta decoding (mode byte bit 3 only).  InitReadPtrs() expands
+  // records with a coded track #4 into ddelta_vrec_buf, so the rest of the
+  // reader sees a standard record.  ddelta_varint_buf holds the
+  // FSE-decompressed varint sequence.
+  unsigned char* ddelta_vrec_buf;
+  unsigned char* ddelta_varint_buf;
+
+  // PBWT hardcall-phase decoding state (mode 0x12 only).  pbwt_order is the
+  // haplotype ordering before pbwt_next_vidx (UINT32_MAX when a reset is
+  // needed), and pbwt_order_tmp is the ordering before pbwt_prev_vidx, so
+  // that a variant can be decoded repeatedly.
+  uint32_t* pbwt_order;
+  uint32_t* pbwt_order_tmp;
+  uintptr_t* pbwt_haps;
+  // all_hets, phasepresent, and phaseinfo for replaying records with a
+  // standard track #2
+  uintptr_t* pbwt_workspace;
+  unsigned char* pbwt_fread_buf;  // per-variant fread() mode only
+  uint32_t pbwt_next_vidx;
+  uint32_t pbwt_prev_vidx;
+  // Describes the record most recently loaded by InitReadPtrs(), which strips
+  // the trailer: 0 if track #2 is absent or stored the usual way, UINT32_MAX
+  // if the trailer is malformed, run list byte count otherwise.
+  uint32_t pbwt_runs_byte_ct;
+
   // phase set loading (mode 0x11) unimplemented for now; should be a sequence
   // of (sample ID, [uint32_t phase set begin, set end), [set begin, set end),
   // ...).
@@ -392,7 +446,7 @@ HEADER_INLINE void PgrSetBaseAndOffset0(unsigned char* block_base, uint32_t thre
 //   loaded during phase 2.
 //
 // Phase 2: Initialize most pointers in the PgenReader struct to appropriate
-//   positions in first_alloc.  For modes 0x10-0x11, load pgfi.var_fpos and
+//   positions in first_alloc.  For modes 0x10-0x12, load pgfi.var_fpos and
 //   pgfi.vrtypes, load/validate pgfi.allele_idx_offsets and pgfi.nonref_flags
 //   if appropriate, and initialize pgfi.gflags, pgfi.max_allele_ct, and
 //   pgfi.max_dosage_allele_ct.
@@ -430,12 +484,31 @@ void PreinitPgfi(PgenFileInfo* pgfip);
 //
 // Update (7 Jan 2018): raw_variant_ct must be in [1, 2^31 - 3], and
 //   raw_sample_ct must be in [1, 2^31 - 2].
+//
+// Files with zstd-compressed record groups require pgenlib to be compiled
+// with PGENLIB_ZSTD, and don't support mode 1.  PgfiInitPhase2() must then be
+// called with vblock_idx_start == 0 and vidx_end == raw_variant_ct.
 PglErr PgfiInitPhase1(const char* fname, uint32_t raw_variant_ct, uint32_t raw_sample_ct, uint32_t use_mmap, PgenHeaderCtrl* header_ctrl_ptr, PgenFileInfo* pgfip, uintptr_t* pgfi_alloc_cacheline_ct_ptr, char* errstr_buf);
 
 // If allele_cts_already_loaded is set, but they're present in the file,
 // they'll be validated; similarly for nonref_flags_already_loaded.
 PglErr PgfiInitPhase2(PgenHeaderCtrl header_ctrl, uint32_t allele_cts_already_loaded, uint32_t nonref_flags_already_loaded, uint32_t use_blockload, uint32_t vblock_idx_start, uint32_t vidx_end, uint32_t* max_vrec_width_ptr, PgenFileInfo* pgfip, unsigned char* pgfi_alloc, uintptr_t* pgr_alloc_cacheline_ct_ptr, char* errstr_buf);
 
+// Multi-file filesets: several .pgen files with the same samples (in the same
+// order), presented as a single file whose variants are the concatenation of
+// the members' variants.  These replace PgfiInitPhase1() and
+// PgfiInitPhase2(); everything after that works as usual, except that mmap
+// mode and PgrValidate() aren't supported.
+// * member_fnames must remain valid until CleanupPgfi() is called.
+// * Only bits 6-7 (nonref_flags storage) of the returned header_ctrl are
+//   meaningful.
+// * Members can't be PLINK 1 .bed files, and can't use PBWT phase storage or
+//   zstd-compressed record groups.
+// * If allele_idx_offsets is preloaded, allele_cts_already_loaded must be set.
+PglErr PgfiInitMultiPhase1(const char* const* member_fnames, uint32_t member_ct, uint32_t raw_variant_ct, uint32_t raw_sample_ct, PgenHeaderCtrl* header_ctrl_ptr, PgenFileInfo* pgfip, uintptr_t* pgfi_alloc_cacheline_ct_ptr, char* errstr_buf);
+
+PglErr PgfiInitMultiPhase2(PgenHeaderCtrl header_ctrl, uint32_t allele_cts_already_loaded, uint32_t nonref_flags_already_loaded, uint32_t use_blockload, uint32_t* max_vrec_width_ptr, PgenFileInfo* pgfip, unsigned char* pgfi_alloc, uintptr_t* pgr_alloc_cacheline_ct_ptr, char* errstr_buf);
+
 
 uint64_t PgfiMultireadGetCachelineReq(const uintptr_t* variant_include, const PgenFileInfo* pgfip, uint32_t variant_ct, uint32_t block_size);
 
@@ -551,6 +624,16 @@ PglErr PgrGetDifflistOrGenovec(const uintptr_t* __restrict sample_include, PgrSa
 // genocounts[0] = # hom ref, [1] = # het ref, [2] = two alts, [3] = missing
 PglErr PgrGetCounts(const uintptr_t* __restrict sample_include, const uintptr_t* __restrict sample_include_interleaved_vec, PgrSampleSubsetIndex pssi, uint32_t sample_ct, uint32_t vidx, PgenReader* pgr_ptr, STD_ARRAY_REF(uint32_t, 4) genocounts);
 
+// Equivalent to calling PgrGetCounts() once for each of subset_ct sample
+// subsets, but the variant is only decoded once.
+// * subset_interleaved_vecs is the concatenation of subset_ct
+//   FillInterleavedMaskVec() outputs, each BitCtToVecCt(raw_sample_ct) vectors
+//   long.
+// * subset_sizes[k] must be the popcount of the kth subset.
+// * genovec must have space for raw_sample_ct entries.
+// * genocounts_arr[k] is filled with the kth subset's counts.
+PglErr PgrGetCountsMulti(const uintptr_t* __restrict subset_interleaved_vecs, const uint32_t* __restrict subset_sizes, uint32_t subset_ct, uint32_t vidx, PgenReader* pgr_ptr, uintptr_t* __restrict genovec, STD_ARRAY_PTR_DECL(uint32_t, 4, genocounts_arr));
+
 // genocounts[0] = # of hardcalls with two copies of specified allele
 // genocounts[1] = # of hardcalls with exactly one copy of specified allele
 // genocounts[2] = # of hardcalls with no copies
@@ -678,8 +761,20 @@ PglErr PgrGetMDp(const uintptr_t* __restrict sample_include, PgrSampleSubsetInde
 // to maximize parallelism
 PglErr PgrGetRaw(uint32_t vidx, PgenGlobalFlags read_gflags, PgenReader* pgr_ptr, uintptr_t** loadbuf_iter_ptr, unsigned char* loaded_vrtype_ptr);
 
+// Performs all validation which isn't done by PgfiInitPhase{1,2}() and
+// PgrInit().
 PglErr PgrValidate(PgenReader* pgr_ptr, uintptr_t* genovec_buf, char* errstr_buf);
 
+// PgrValidate() is equivalent to PgrValidateHeader(), followed by
+// PgrValidateRange() on all variants.  The range calls can be spread across
+// threads, with one PgenReader per thread.
+// * PgrValidateHeader() must succeed before any PgrValidateRange() call.
+// * vidx_start must be zero or a multiple of kPglVblockSize.  (It's fine to
+//   make several calls on consecutive ranges with the same PgenReader.)
+PglErr PgrValidateHeader(PgenReader* pgr_ptr, char* errstr_buf);
+
+PglErr PgrValidateRange(uint32_t vidx_start, uint32_t vidx_end, PgenReader* pgr_ptr, uintptr_t* genovec_buf, char* errstr_buf);
+
 // missingness bit is set iff hardcall is not present (even if dosage info *is*
 // present)
 PglErr PgrGetMissingness(const uintptr_t* __restrict sample_include, PgrSampleSubsetIndex pssi, uint32_t sample_ct, uint32_t vidx, PgenReader* pgr_ptr, uintptr_t* __restrict missingness, uintptr_t* __restrict genovec_buf);
@@ -689,6 +784,74 @@ PglErr PgrGetMissingness(const uintptr_t* __restrict sample_include, PgrSampleSu
 // missingness_dosage must be vector-aligned
 PglErr PgrGetMissingnessD(const uintptr_t* __restrict sample_include, PgrSampleSubsetIndex pssi, uint32_t sample_ct, uint32_t vidx, PgenReader* pgr_ptr, uintptr_t* __restrict missingness_hc, uintptr_t* __restrict missingness_dosage, uintptr_t* __restrict hets, uintptr_t* __restrict genovec_buf);
 
+// Bounded cache of PgrGetD() results, keyed by (vidx, sample-subset ID), which
+// can be shared by any number of PgenReaders/threads.  Intended for workloads
+// which decode the same variants repeatedly (e.g. one --glm pass per
+// phenotype over a small region).
+// * Lookups are lock-free: each slot carries a sequence number which is odd
+//   while the slot is being rewritten, and readers retry-by-missing if it
+//   changes under them.
+// * Eviction is CLOCK (a cheap LRU approximation): lookups set a reference
+//   bit, and the insertion hand clears reference bits until it finds an
+//   unreferenced slot.
+// * Subset IDs are obtained from PgrDecodeCacheSubsetId(), which must not be
+//   called concurrently with anything else touching the cache.  ID 0 always
+//   denotes the unsubsetted sample set.  The registry only remembers the last
+//   kPgrDecodeCacheSubsetSlotCt subsets; when an old one is recycled, it gets
+//   a fresh ID, so stale entries just stop matching.
+// * The per-variant index only points at the most recently inserted entry, so
+//   alternating between two subsets on the same variants won't hit.
+// * Records with more than max_dosage_ct dosages are not cached.
+CONSTI32(kPgrDecodeCacheSubsetSlotCt, 8);
+
+typedef struct PgrDecodeCacheStruct {
+  NONCOPYABLE(PgrDecodeCacheStruct);
+  uint32_t raw_variant_ct;
+  uint32_t raw_sample_ct;
+  uint32_t max_dosage_ct;
+  uint32_t slot_ct;
+  uintptr_t slot_word_ct;
+
+  // UINT32_MAX when the variant isn't cached
+  uint32_t* vidx_to_slot;
+
+  uint32_t* slot_seqs;
+  uint32_t* slot_vidxs;
+  uint32_t* slot_subset_ids;
+  uint32_t* slot_dosage_cts;
+  unsigned char* slot_refs;
+  uintptr_t* slot_data;
+  uint32_t clock_hand;
+
+  uintptr_t* subset_bitarrs;
+  uint32_t subset_sample_cts[kPgrDecodeCacheSubsetSlotCt];
+  uint32_t subset_ids[kPgrDecodeCacheSubsetSlotCt];
+  uint32_t subset_next_id;
+  uint32_t subset_recycle_idx;
+
+  uint64_t hit_ct;
+  uint64_t miss_ct;
+} PgrDecodeCache;
+
+uintptr_t PgrDecodeCacheSlotWordCt(uint32_t raw_sample_ct, uint32_t max_dosage_ct);
+
+uintptr_t PgrDecodeCacheCachelineReq(uint32_t raw_variant_ct, uint32_t raw_sample_ct, uint32_t max_dosage_ct, uint32_t slot_ct);
+
+// Returns the largest slot count whose PgrDecodeCacheCachelineReq() fits in
+// byte_budget, or 0 if not even one slot fits.
+uint32_t PgrDecodeCacheMaxSlotCt(uint32_t raw_variant_ct, uint32_t raw_sample_ct, uint32_t max_dosage_ct, uintptr_t byte_budget);
+
+// dcache_alloc must be cacheline-aligned, with the size returned by
+// PgrDecodeCacheCachelineReq().
+void PgrDecodeCacheInit(uint32_t raw_variant_ct, uint32_t raw_sample_ct, uint32_t max_dosage_ct, uint32_t slot_ct, unsigned char* dcache_alloc, PgrDecodeCache* dcachep);
+
+// sample_include is ignored when sample_ct == raw_sample_ct.
+uint32_t PgrDecodeCacheSubsetId(const uintptr_t* sample_include, uint32_t sample_ct, PgrDecodeCache* dcachep);
+
+// Same contract as PgrGetD(), with results served from/added to dcachep.
+// dcachep may be nullptr, in which case this is just PgrGetD().
+PglErr PgrGetDCached(const uintptr_t* __restrict sample_include, PgrSampleSubsetIndex pssi, uint32_t sample_ct, uint32_t vidx, uint32_t subset_id, PgrDecodeCache* dcachep, PgenReader* pgr_ptr, uintptr_t* __restrict genovec, uintptr_t* __restrict dosage_present, uint16_t* dosage_main, uint32_t* dosage_ct_ptr);
+
 
 // error-return iff reterr was success and was changed to kPglRetReadFail (i.e.
 // an error message should be printed).
@@ -48,6 +48,19 @@ void PreinitSpgw(STPgenWriter* spgwp) {
   *GetPgenOutfilep(spgwp) = nullptr;
 }
 
+// Largest group size for which the group's biallelic-hardcall-only
+// uncompressed size doesn't exceed 1 MiB, within [kPglZstGroupLgMin,
+// kPglZstGroupLgMax].  This bounds both the reader's group buffer and the
+// amount of decompression required for a single random access.
+static uint32_t GetZstGroupLg(uint32_t sample_ct) {
+  const uint64_t biallelic_vrec_len = NypCtToByteCt(sample_ct);
+  uint32_t group_lg = kPglZstGroupLgMax;
+  while ((group_lg > kPglZstGroupLgMin) && ((biallelic_vrec_len << group_lg) > (1 << 20))) {
+    --group_lg;
+  }
+  return group_lg;
+}
+
 PglErr PwcInitPhase1(const char* __restrict fname, const uintptr_t* __restrict allele_idx_offsets, uintptr_t* explicit_nonref_flags, uint32_t variant_ct, uint32_t sample_ct, PgenGlobalFlags phase_dosage_gflags, uint32_t nonref_flags_storage, uint32_t vrec_len_byte_ct, PgenWriterCommon* pwcp, FILE** pgen_outfile_ptr) {
   pwcp->allele_idx_offsets = allele_idx_offsets;
   pwcp->explicit_nonref_flags = nullptr;
@@ -59,7 +72,28 @@ PglErr PwcInitPhase1(const char* __restrict fname, const uintptr_t* __restrict a
   }
   pwcp->variant_ct = variant_ct;
   pwcp->sample_ct = sample_ct;
+  pwcp->zst_cctx = nullptr;
+  pwcp->zst_group_lg = 0;
+  const uint32_t zst_records = (phase_dosage_gflags / kfPgenGlobalZstdRecords) & 1;
+  phase_dosage_gflags &= ~kfPgenGlobalZstdRecords;
+#ifndef PGENLIB_ZSTD
+  if (unlikely(zst_records)) {
+    return kPglRetNotYetSupported;
+  }
+#endif
+  if ((phase_dosage_gflags & kfPgenGlobalPbwtHphase) && ((!(phase_dosage_gflags & kfPgenGlobalHardcallPhasePresent)) || (sample_ct >= 0x40000000))) {
+    // run lengths must fit in a vint31
+    phase_dosage_gflags &= ~kfPgenGlobalPbwtHphase;
+  }
+  if (!(phase_dosage_gflags & kfPgenGlobalDosagePresent)) {
+    phase_dosage_gflags &= ~kfPgenGlobalDosageDelta;
+  }
   pwcp->phase_dosage_gflags = phase_dosage_gflags;
+  pwcp->pbwt_order = nullptr;
+  pwcp->pbwt_window_vidx = UINT32_MAX;
+  pwcp->pbwt_runs_byte_ct = 0;
+  pwcp->ddelta_buf = nullptr;
+  pwcp->ddelta_byte_ct = 0;
 #ifndef NDEBUG
   pwcp->vblock_fpos = nullptr;
   pwcp->vrec_len_buf = nullptr;
@@ -71,6 +105,7 @@ PglErr PwcInitPhase1(const char* __restrict fname, const uintptr_t* __restrict a
   pwcp->ldbase_genovec = nullptr;
   pwcp->ldbase_raregeno = nullptr;
   pwcp->ldbase_difflist_sample_ids = nullptr;
+  pwcp->zst_group_sizes = nullptr;
 #endif
   pwcp->vidx = 0;
 
@@ -79,7 +114,22 @@ PglErr PwcInitPhase1(const char* __restrict fname, const uintptr_t* __restrict a
   if (unlikely(!pgen_outfile)) {
     return kPglRetOpenFail;
   }
-  fwrite_unlocked("l\x1b\x10", 3, 1, pgen_outfile);
+  uint32_t zst_group_ct = 0;
+#ifdef PGENLIB_ZSTD
+  if (zst_records) {
+    pwcp->zst_cctx = ZSTD_createCCtx();
+    if (unlikely(!pwcp->zst_cctx)) {
+      return kPglRetNomem;
+    }
+    pwcp->zst_group_lg = GetZstGroupLg(sample_ct);
+    pwcp->zst_group_idx = 0;
+    pwcp->zst_frame_byte_ct = 0;
+    zst_group_ct = DivUp(variant_ct, 1U << pwcp->zst_group_lg);
+  }
+#endif
+  const char mode_byte = 0x10 + 2 * ((phase_dosage_gflags / kfPgenGlobalPbwtHphase) & 1) + 4 * zst_records + 8 * ((phase_dosage_gflags / kfPgenGlobalDosageDelta) & 1);
+  fwrite_unlocked("l\x1b", 2, 1, pgen_outfile);
+  putc_unlocked(mode_byte, pgen_outfile);
   fwrite_unlocked(&(pwcp->variant_ct), sizeof(int32_t), 1, pgen_outfile);
   fwrite_unlocked(&(pwcp->sample_ct), sizeof(int32_t), 1, pgen_outfile);
 
@@ -98,6 +148,10 @@ PglErr PwcInitPhase1(const char* __restrict fname, const uintptr_t* __restrict a
   if (nonref_flags_storage == 3) {
     header_bytes_left += DivUp(variant_ct, CHAR_BIT);
   }
+  if (zst_group_ct) {
+    // 4-byte compressed group sizes, group size log2 byte
+    header_bytes_left += zst_group_ct * sizeof(int32_t) + 1;
+  }
 
   // this should be the position of the first variant
   pwcp->vblock_fpos_offset = 12 + header_bytes_left;
@@ -119,6 +173,27 @@ PglErr PwcInitPhase1(const char* __restrict fname, const uintptr_t* __restrict a
   return kPglRetSuccess;
 }
 
+static uint32_t CountPbwtCachelinesRequired(uint32_t sample_ct, PgenGlobalFlags phase_dosage_gflags) {
+  if ((!(phase_dosage_gflags & kfPgenGlobalPbwtHphase)) || (!(phase_dosage_gflags & kfPgenGlobalHardcallPhasePresent))) {
+    return 0;
+  }
+  // pbwt_order, pbwt_order_tmp, pbwt_haps
+  uint32_t cachelines_required = 2 * Int32CtToCachelineCt(2 * S_CAST(uintptr_t, sample_ct)) + NypCtToCachelineCt(sample_ct);
+  // pbwt_runs_buf: never needs to be larger than a standard track #2, plus
+  // one vint of slack
+  cachelines_required += NypCtToCachelineCt(sample_ct) + 1;
+  return cachelines_required;
+}
+
+static uint32_t CountDdeltaCachelinesRequired(uint32_t sample_ct, PgenGlobalFlags phase_dosage_gflags) {
+  if ((phase_dosage_gflags & (kfPgenGlobalDosagePresent | kfPgenGlobalDosageDelta)) != (kfPgenGlobalDosagePresent | kfPgenGlobalDosageDelta)) {
+    return 0;
+  }
+  // ddelta_buf: up to 3 bytes per varint, and the FSE-compressed form is only
+  // used when it's smaller than that
+  return DivUp(6 * S_CAST(uintptr_t, sample_ct), kCacheline);
+}
+
 uint32_t CountSpgwAllocCachelinesRequired(uint32_t variant_ct, uint32_t sample_ct, PgenGlobalFlags phase_dosage_gflags, uint32_t max_vrec_len) {
   // vblock_fpos
   const uint32_t vblock_ct = DivUp(variant_ct, kPglVblockSize);
@@ -131,12 +206,17 @@ uint32_t CountSpgwAllocCachelinesRequired(uint32_t variant_ct, uint32_t sample_c
   cachelines_required += DivUp((variant_ct - 1) * vrec_len_byte_ct + sizeof(int32_t), kCacheline);
 
   // vrtype_buf
-  if (phase_dosage_gflags) {
+  if (phase_dosage_gflags & (~kfPgenGlobalZstdRecords)) {
     cachelines_required += DivUp(variant_ct, kCacheline);
   } else {
     cachelines_required += DivUp(variant_ct, kCacheline * 2);
   }
 
+  // zst_group_sizes
+  if (phase_dosage_gflags & kfPgenGlobalZstdRecords) {
+    cachelines_required += Int32CtToCachelineCt(DivUp(variant_ct, 1U << GetZstGroupLg(sample_ct)));
+  }
+
   // genovec_hets_buf, genovec_invert_buf, ldbase_genovec
   cachelines_required += 3 * NypCtToCachelineCt(sample_ct);
 
@@ -147,6 +227,9 @@ uint32_t CountSpgwAllocCachelinesRequired(uint32_t variant_ct, uint32_t sample_c
   // ldbase_difflist_sample_ids
   cachelines_required += 1 + (max_difflist_len / kInt32PerCacheline);
 
+  cachelines_required += CountPbwtCachelinesRequired(sample_ct, phase_dosage_gflags);
+  cachelines_required += CountDdeltaCachelinesRequired(sample_ct, phase_dosage_gflags);
+
   // fwrite_buf
   // + (5 + sizeof(AlleleCode)) * kPglDifflistGroupSize to avoid buffer
   // overflow in middle of difflist writing
@@ -190,6 +273,9 @@ PglErr SpgwInitPhase1(const char* __restrict fname, const uintptr_t* __restrict
   if (phase_dosage_gflags & kfPgenGlobalHardcallPhasePresent) {
     // phasepresent, phaseinfo
     max_vrec_len += 2 * DivUp(sample_ct, CHAR_BIT);
+    if (phase_dosage_gflags & kfPgenGlobalPbwtHphase) {
+      max_vrec_len += kPglPbwtTrailerByteCt;
+    }
   }
   if (phase_dosage_gflags & kfPgenGlobalDosagePresent) {
     const uint32_t dphase_gflag = (phase_dosage_gflags / kfPgenGlobalDosagePhasePresent) & 1;
@@ -197,6 +283,9 @@ PglErr SpgwInitPhase1(const char* __restrict fname, const uintptr_t* __restrict
     max_vrec_len += (1 + dphase_gflag) * DivUp(sample_ct, 8);
     // aux4, aux8
     max_vrec_len += (2 + 2 * dphase_gflag) * S_CAST(uint64_t, sample_ct);
+    if (phase_dosage_gflags & kfPgenGlobalDosageDelta) {
+      max_vrec_len += kPglDosageDeltaTrailerByteCt;
+    }
     // todo: multiallelic dosage
   }
 #ifdef __LP64__
@@ -229,12 +318,17 @@ void MpgwInitPhase1(const uintptr_t* __restrict allele_idx_offsets, uint32_t var
   uint32_t alloc_base_cacheline_ct = Int64CtToCachelineCt(vblock_ct);
 
   // vrtype_buf
-  if (phase_dosage_gflags) {
+  if (phase_dosage_gflags & (~kfPgenGlobalZstdRecords)) {
     alloc_base_cacheline_ct += DivUp(variant_ct, kCacheline);
   } else {
     alloc_base_cacheline_ct += DivUp(variant_ct, kCacheline * 2);
   }
 
+  // zst_group_sizes
+  if (phase_dosage_gflags & kfPgenGlobalZstdRecords) {
+    alloc_base_cacheline_ct += Int32CtToCachelineCt(DivUp(variant_ct, 1U << GetZstGroupLg(sample_ct)));
+  }
+
   // pwcs
   uint64_t alloc_per_thread_cacheline_ct = DivUp(sizeof(PgenWriterCommon), kCacheline);
 
@@ -250,14 +344,23 @@ void MpgwInitPhase1(const uintptr_t* __restrict allele_idx_offsets, uint32_t var
   // ldbase_difflist_sample_ids
   alloc_per_thread_cacheline_ct += 1 + (max_difflist_len / kInt32PerCacheline);
 
+  alloc_per_thread_cacheline_ct += CountPbwtCachelinesRequired(sample_ct, phase_dosage_gflags);
+  alloc_per_thread_cacheline_ct += CountDdeltaCachelinesRequired(sample_ct, phase_dosage_gflags);
+
   uint64_t max_vrec_len = NypCtToByteCt(sample_ct);
   if (phase_dosage_gflags & kfPgenGlobalHardcallPhasePresent) {
     max_vrec_len += 2 * DivUp(sample_ct, CHAR_BIT);
+    if (phase_dosage_gflags & kfPgenGlobalPbwtHphase) {
+      max_vrec_len += kPglPbwtTrailerByteCt;
+    }
   }
   const uint32_t dosage_gflag = (phase_dosage_gflags / kfPgenGlobalDosagePresent) & 1;
   const uint32_t dosage_phase_gflag = (phase_dosage_gflags / kfPgenGlobalDosagePhasePresent) & 1;
   if (dosage_gflag) {
     max_vrec_len += ((1 + dosage_phase_gflag) * DivUp(sample_ct, CHAR_BIT)) + (2 + 2 * dosage_phase_gflag) * S_CAST(uint64_t, sample_ct);
+    if (phase_dosage_gflags & kfPgenGlobalDosageDelta) {
+      max_vrec_len += kPglDosageDeltaTrailerByteCt;
+    }
   }
   const uint32_t max_vblock_size = MINV(variant_ct, kPglVblockSize);
   // max_vrec_len is a uint64_t
@@ -411,6 +514,12 @@ void PwcInitPhase2(uintptr_t fwrite_cacheline_ct, uint32_t thread_ct, PgenWriter
   memset(pwcs[0]->vrtype_buf, 0, vrtype_buf_bytes);
   alloc_iter = &(alloc_iter[vrtype_buf_bytes]);
 
+  const uint32_t zst_group_lg = pwcs[0]->zst_group_lg;
+  if (zst_group_lg) {
+    pwcs[0]->zst_group_sizes = R_CAST(uint32_t*, alloc_iter);
+    alloc_iter = &(alloc_iter[Int32CtToCachelineCt(DivUp(variant_ct, 1U << zst_group_lg)) * kCacheline]);
+  }
+
   const uint32_t sample_ct = pwcs[0]->sample_ct;
   const uint32_t genovec_byte_alloc = NypCtToCachelineCt(sample_ct) * kCacheline;
   const uint32_t max_difflist_len = 2 * (sample_ct / kPglMaxDifflistLenDivisor);
@@ -419,6 +528,7 @@ void PwcInitPhase2(uintptr_t fwrite_cacheline_ct, uint32_t thread_ct, PgenWriter
       pwcs[tidx]->vblock_fpos = pwcs[0]->vblock_fpos;
       pwcs[tidx]->vrec_len_buf = pwcs[0]->vrec_len_buf;
       pwcs[tidx]->vrtype_buf = pwcs[0]->vrtype_buf;
+      pwcs[tidx]->zst_group_sizes = pwcs[0]->zst_group_sizes;
     }
     pwcs[tidx]->genovec_hets_buf = R_CAST(uintptr_t*, alloc_iter);
     alloc_iter = &(alloc_iter[genovec_byte_alloc]);
@@ -432,6 +542,22 @@ void PwcInitPhase2(uintptr_t fwrite_cacheline_ct, uint32_t thread_ct, PgenWriter
     pwcs[tidx]->ldbase_difflist_sample_ids = R_CAST(uint32_t*, alloc_iter);
     alloc_iter = &(alloc_iter[(1 + (max_difflist_len / kInt32PerCacheline)) * kCacheline]);
 
+    if (phase_dosage_gflags & kfPgenGlobalPbwtHphase) {
+      const uintptr_t order_byte_alloc = Int32CtToCachelineCt(2 * S_CAST(uintptr_t, sample_ct)) * kCacheline;
+      pwcs[tidx]->pbwt_order = R_CAST(uint32_t*, alloc_iter);
+      alloc_iter = &(alloc_iter[order_byte_alloc]);
+      pwcs[tidx]->pbwt_order_tmp = R_CAST(uint32_t*, alloc_iter);
+      alloc_iter = &(alloc_iter[order_byte_alloc]);
+      pwcs[tidx]->pbwt_haps = R_CAST(uintptr_t*, alloc_iter);
+      alloc_iter = &(alloc_iter[genovec_byte_alloc]);
+      pwcs[tidx]->pbwt_runs_buf = alloc_iter;
+      alloc_iter = &(alloc_iter[genovec_byte_alloc + kCacheline]);
+    }
+    if (phase_dosage_gflags & kfPgenGlobalDosageDelta) {
+      pwcs[tidx]->ddelta_buf = alloc_iter;
+      alloc_iter = &(alloc_iter[DivUp(6 * S_CAST(uintptr_t, sample_ct), kCacheline) * kCacheline]);
+    }
+
     pwcs[tidx]->fwrite_buf = alloc_iter;
     pwcs[tidx]->fwrite_bufp = alloc_iter;
     alloc_iter = &(alloc_iter[fwrite_cacheline_ct * kCacheline]);
@@ -458,6 +584,7 @@ PglErr MpgwInitPhase2(const char* __restrict fname, const uintptr_t* __restrict
   for (uint32_t tidx = 1; tidx != thread_ct; ++tidx) {
     *(mpgwp->pwcs[tidx]) = *(mpgwp->pwcs[0]);
     mpgwp->pwcs[tidx]->vidx = tidx * kPglVblockSize;
+    mpgwp->pwcs[tidx]->zst_cctx = nullptr;
   }
   PwcInitPhase2(vblock_cacheline_ct, thread_ct, mpgwp->pwcs, &(mpgw_alloc[thread_ct * pwc_byte_ct]));
   return kPglRetSuccess;
@@ -933,8 +1060,59 @@ void PwcAppendBiallelicGenovec(const uintptr_t* __restrict genovec, PgenWriterCo
   }
 }
 
+#ifdef PGENLIB_ZSTD
+// Compresses byte_ct bytes into the current group's frame, and closes the
+// frame if end_frame is set.
+static BoolErr ZstWriteGroupBytes(const unsigned char* buf, uintptr_t byte_ct, uint32_t end_frame, PgenWriterCommon* pwcp, FILE* pgen_outfile) {
+  ZSTD_CCtx* cctx = S_CAST(ZSTD_CCtx*, pwcp->zst_cctx);
+  ZSTD_inBuffer zib = {buf, byte_ct, 0};
+  const ZSTD_EndDirective end_op = end_frame? ZSTD_e_end : ZSTD_e_continue;
+  unsigned char outbuf[16384];
+  while (1) {
+    ZSTD_outBuffer zob = {outbuf, sizeof(outbuf), 0};
+    const uintptr_t bytes_left = ZSTD_compressStream2(cctx, &zob, &zib, end_op);
+    if (unlikely(ZSTD_isError(bytes_left))) {
+      return 1;
+    }
+    if (zob.pos) {
+      if (unlikely(fwrite_checked(outbuf, zob.pos, pgen_outfile))) {
+        return 1;
+      }
+      pwcp->zst_frame_byte_ct += zob.pos;
+    }
+    if (end_frame? (!bytes_left) : (zib.pos == zib.size)) {
+      break;
+    }
+  }
+  if (end_frame) {
+    if (unlikely(pwcp->zst_frame_byte_ct > UINT32_MAX)) {
+      return 1;
+    }
+    pwcp->zst_group_sizes[pwcp->zst_group_idx] = pwcp->zst_frame_byte_ct;
+    pwcp->zst_group_idx += 1;
+    pwcp->zst_frame_byte_ct = 0;
+  }
+  return 0;
+}
+#endif
+
 BoolErr SpgwFlush(STPgenWriter* spgwp) {
   PgenWriterCommon* pwcp = GetPwcp(spgwp);
+#ifdef PGENLIB_ZSTD
+  if (pwcp->zst_group_lg) {
+    // close the group's frame as soon as its last record has been appended
+    const uint32_t end_frame = ((pwcp->vidx >> pwcp->zst_group_lg) != pwcp->zst_group_idx) && (pwcp->vidx != pwcp->variant_ct);
+    if (end_frame || (pwcp->fwrite_bufp >= &(pwcp->fwrite_buf[kPglFwriteBlockSize]))) {
+      const uintptr_t cur_byte_ct = pwcp->fwrite_bufp - pwcp->fwrite_buf;
+      if (unlikely(ZstWriteGroupBytes(pwcp->fwrite_buf, cur_byte_ct, end_frame, pwcp, *GetPgenOutfilep(spgwp)))) {
+        return 1;
+      }
+      pwcp->vblock_fpos_offset += cur_byte_ct;
+      pwcp->fwrite_bufp = pwcp->fwrite_buf;
+    }
+    return 0;
+  }
+#endif
   if (pwcp->fwrite_bufp >= &(pwcp->fwrite_buf[kPglFwriteBlockSize])) {
     const uintptr_t cur_byte_ct = pwcp->fwrite_bufp - pwcp->fwrite_buf;
     FILE** pgen_outfilep = GetPgenOutfilep(spgwp);
@@ -2026,10 +2204,154 @@ BoolErr AppendHphase(const uintptr_t* __restrict genoarr_hets, const uintptr_t*
   return 0;
 }
 
+// Replaces the just-appended track #2 (starting at aux2_start) with its
+// PBWT-coded form when that's smaller, including the larger trailer; see
+// pgenlib_misc.h.  Only called for records without an aux1 track, so hets are
+// always ref/alt1.
+void PbwtRecodeHphase(const uintptr_t* __restrict genovec, const uintptr_t* __restrict phasepresent, const uintptr_t* __restrict phaseinfo, const unsigned char* vrec_start, uint32_t vidx, uint32_t het_ct, uint32_t phasepresent_ct, uint32_t ld_compressed, unsigned char* aux2_start, PgenWriterCommon* pwcp, uint32_t* vrec_len_ptr) {
+  pwcp->pbwt_runs_byte_ct = 0;
+  const uint32_t sample_ct = pwcp->sample_ct;
+  const uint32_t hap_ct = 2 * sample_ct;
+  uint32_t* order = pwcp->pbwt_order;
+  const uint32_t window_vidx = RoundDownPow2(vidx, kPglPbwtResetInterval);
+  if (pwcp->pbwt_window_vidx != window_vidx) {
+    for (uint32_t uii = 0; uii != hap_ct; ++uii) {
+      order[uii] = uii;
+    }
+    pwcp->pbwt_window_vidx = window_vidx;
+  }
+  const uintptr_t std_aux2_byte_ct = pwcp->fwrite_bufp - aux2_start;
+  const uint32_t explicit_phasepresent = (het_ct != phasepresent_ct);
+  const uint32_t first_part_byte_ct = explicit_phasepresent? (1 + (het_ct / CHAR_BIT)) : 1;
+  // PBWT-coded total must be smaller than std_aux2_byte_ct + 1.
+  uintptr_t runs_byte_ct_limit = 0;
+  if (std_aux2_byte_ct > first_part_byte_ct + kPglPbwtTrailerByteCt - 1) {
+    runs_byte_ct_limit = std_aux2_byte_ct + 1 - kPglPbwtTrailerByteCt - first_part_byte_ct;
+  } else if (ld_compressed) {
+    // ordering won't change
+    return;
+  }
+
+  // hap0 = alt on first haplotype, hap1 = alt on second haplotype; unphased
+  // hets are treated as unswapped, and missing calls as hom ref.
+  const uint32_t sample_ctl2 = NypCtToWordCt(sample_ct);
+  uintptr_t* haps = pwcp->pbwt_haps;
+  const Halfword* phasepresent_alias = R_CAST(const Halfword*, phasepresent);
+  const Halfword* phaseinfo_alias = R_CAST(const Halfword*, phaseinfo);
+  for (uint32_t widx = 0; widx != sample_ctl2; ++widx) {
+    const uintptr_t geno_word = genovec[widx];
+    const uintptr_t homalt = (geno_word >> 1) & (~geno_word) & kMask5555;
+    const uintptr_t hets = Word01(geno_word);
+    uintptr_t swapped = 0;
+    if (hets) {
+      uint32_t swapped_hw = phaseinfo_alias[widx];
+      if (explicit_phasepresent) {
+        swapped_hw &= phasepresent_alias[widx];
+      }
+      swapped = UnpackHalfwordToWord(swapped_hw) & hets;
+    }
+    haps[widx] = (homalt * 3) | swapped | ((hets ^ swapped) << 1);
+  }
+
+  // Stable partition of the current ordering, emitting run lengths as we go.
+  // 1-haplotypes are written backwards from the end and then reversed.
+  // Unless the genotypes are LD-compressed, the ordering is updated even if
+  // the run list ends up too long.
+  uint32_t* order_new = pwcp->pbwt_order_tmp;
+  unsigned char* runs_start = pwcp->pbwt_runs_buf;
+  unsigned char* runs_iter = runs_start;
+  unsigned char* runs_stop = &(runs_start[runs_byte_ct_limit]);
+  uint32_t zero_ct = 0;
+  uint32_t one_ct = 0;
+  uintptr_t cur_bit = 0;
+  uint32_t run_len = 0;
+  for (uint32_t uii = 0; uii != hap_ct; ++uii) {
+    const uint32_t hap_idx = order[uii];
+    const uintptr_t cur_hap = (haps[hap_idx / kBitsPerWord] >> (hap_idx % kBitsPerWord)) & 1;
+    if (cur_hap != cur_bit) {
+      if (runs_iter != runs_stop) {
+        runs_iter = Vint32Append(run_len, runs_iter);
+        if (runs_iter >= runs_stop) {
+          if (ld_compressed) {
+            return;
+          }
+          runs_iter = runs_stop;
+        }
+      }
+      cur_bit = cur_hap;
+      run_len = 0;
+    }
+    ++run_len;
+    if (cur_hap) {
+      ++one_ct;
+      order_new[hap_ct - one_ct] = hap_idx;
+    } else {
+      order_new[zero_ct++] = hap_idx;
+    }
+  }
+  for (uint32_t uii = zero_ct, ujj = hap_ct - 1; uii < ujj; ++uii, --ujj) {
+    const uint32_t tmp = order_new[uii];
+    order_new[uii] = order_new[ujj];
+    order_new[ujj] = tmp;
+  }
+  pwcp->pbwt_order = order_new;
+  pwcp->pbwt_order_tmp = order;
+  if (runs_iter == runs_stop) {
+    return;
+  }
+
+  const uint32_t runs_byte_ct = runs_iter - runs_start;
+  if (!explicit_phasepresent) {
+    aux2_start[0] = 0;
+  }
+  unsigned char* runs_dst = &(aux2_start[first_part_byte_ct]);
+  memcpy(runs_dst, runs_start, runs_byte_ct);
+  pwcp->fwrite_bufp = &(runs_dst[runs_byte_ct]);
+  *vrec_len_ptr -= std_aux2_byte_ct - first_part_byte_ct - runs_byte_ct;
+  pwcp->pbwt_runs_offset = runs_dst - vrec_start;
+  pwcp->pbwt_runs_byte_ct = runs_byte_ct;
+}
+
+BoolErr AppendPbwtTrailer(PgenWriterCommon* pwcp, uint32_t* vrec_len_ptr) {
+  const uint32_t runs_byte_ct = pwcp->pbwt_runs_byte_ct;
+  if (!runs_byte_ct) {
+    if (unlikely(CheckedVrecLenIncr(1, vrec_len_ptr))) {
+      return 1;
+    }
+    *(pwcp->fwrite_bufp)++ = 0;
+    return 0;
+  }
+  if (unlikely(CheckedVrecLenIncr(kPglPbwtTrailerByteCt, vrec_len_ptr))) {
+    return 1;
+  }
+  unsigned char* fwrite_bufp = memcpyua(pwcp->fwrite_bufp, &(pwcp->pbwt_runs_offset), sizeof(int32_t));
+  fwrite_bufp = memcpyua(fwrite_bufp, &runs_byte_ct, sizeof(int32_t));
+  *fwrite_bufp++ = 1;
+  pwcp->fwrite_bufp = fwrite_bufp;
+  pwcp->pbwt_runs_byte_ct = 0;
+  return 0;
+}
+
+// AppendHphase() for records without an aux1 track; also PBWT-codes track #2
+// when appropriate.  If pwcp->pbwt_order is non-null, AppendPbwtTrailer() must
+// be called after the dosage tracks.
+BoolErr AppendBiallelicHphase(const uintptr_t* __restrict genovec, const uintptr_t* __restrict phasepresent, const uintptr_t* __restrict phaseinfo, const unsigned char* vrec_start, uint32_t vidx, uint32_t het_ct, uint32_t phasepresent_ct, PgenWriterCommon* pwcp, unsigned char* vrtype_ptr, uint32_t* vrec_len_ptr) {
+  unsigned char* aux2_start = pwcp->fwrite_bufp;
+  if (unlikely(AppendHphase(genovec, phasepresent, phaseinfo, het_ct, phasepresent_ct, pwcp, vrtype_ptr, vrec_len_ptr))) {
+    return 1;
+  }
+  if (pwcp->pbwt_order) {
+    const uint32_t ld_compressed = ((*vrtype_ptr) & 6) == 2;
+    PbwtRecodeHphase(genovec, phasepresent, phaseinfo, vrec_start, vidx, het_ct, phasepresent_ct, ld_compressed, aux2_start, pwcp, vrec_len_ptr);
+  }
+  return 0;
+}
+
 void PwcAppendBiallelicGenovecHphase(const uintptr_t* __restrict genovec, const uintptr_t* __restrict phasepresent, const uintptr_t* __restrict phaseinfo, PgenWriterCommon* pwcp) {
   // assumes phase_dosage_gflags is nonzero
   const uint32_t vidx = pwcp->vidx;
   unsigned char* vrtype_dest = &(R_CAST(unsigned char*, pwcp->vrtype_buf)[vidx]);
+  const unsigned char* vrec_start = pwcp->fwrite_bufp;
   uint32_t het_ct;
   uint32_t vrec_len = PwcAppendBiallelicGenovecMain(genovec, vidx, pwcp, &het_ct, nullptr, vrtype_dest);
   const uintptr_t vrec_len_byte_ct = pwcp->vrec_len_byte_ct;
@@ -2039,13 +2361,17 @@ void PwcAppendBiallelicGenovecHphase(const uintptr_t* __restrict genovec, const
   unsigned char* vrec_len_dest = &(pwcp->vrec_len_buf[vidx * vrec_len_byte_ct]);
   const uint32_t phasepresent_ct = phasepresent? PopcountWords(phasepresent, sample_ctl) : het_ct;
   if (phasepresent_ct) {
-    AppendHphase(genovec, phasepresent, phaseinfo, het_ct, phasepresent_ct, pwcp, vrtype_dest, &vrec_len);
+    AppendBiallelicHphase(genovec, phasepresent, phaseinfo, vrec_start, vidx, het_ct, phasepresent_ct, pwcp, vrtype_dest, &vrec_len);
+    if (pwcp->pbwt_order) {
+      AppendPbwtTrailer(pwcp, &vrec_len);
+    }
   }
   SubU32Store(vrec_len, vrec_len_byte_ct, vrec_len_dest);
 }
 
 BoolErr PwcAppendMultiallelicGenovecHphase(const uintptr_t* __restrict genovec, const uintptr_t* __restrict patch_01_set, const AlleleCode* __restrict patch_01_vals, const uintptr_t* __restrict patch_10_set, const AlleleCode* __restrict patch_10_vals, const uintptr_t* __restrict phasepresent, const uintptr_t* __restrict phaseinfo, uint32_t patch_01_ct, uint32_t patch_10_ct, PgenWriterCommon* pwcp) {
   const uint32_t vidx = pwcp->vidx;
+  const unsigned char* vrec_start = pwcp->fwrite_bufp;
   const uintptr_t* genovec_hets;
   unsigned char vrtype;
   uint32_t het_ct;
@@ -2059,8 +2385,20 @@ BoolErr PwcAppendMultiallelicGenovecHphase(const uintptr_t* __restrict genovec,
   unsigned char* vrtype_dest = &(R_CAST(unsigned char*, pwcp->vrtype_buf)[vidx]);
   *vrtype_dest = vrtype;
   if (phasepresent_ct) {
-    if (unlikely(AppendHphase(genovec_hets, phasepresent, phaseinfo, het_ct, phasepresent_ct, pwcp, vrtype_dest, &vrec_len))) {
-      return 1;
+    if (vrtype & 8) {
+      if (unlikely(AppendHphase(genovec_hets, phasepresent, phaseinfo, het_ct, phasepresent_ct, pwcp, vrtype_dest, &vrec_len))) {
+        return 1;
+      }
+    } else {
+      // no aux1 track, so this is stored like a biallelic record
+      if (unlikely(AppendBiallelicHphase(genovec, phasepresent, phaseinfo, vrec_start, vidx, het_ct, phasepresent_ct, pwcp, vrtype_dest, &vrec_len))) {
+        return 1;
+      }
+      if (pwcp->pbwt_order) {
+        if (unlikely(AppendPbwtTrailer(pwcp, &vrec_len))) {
+          return 1;
+        }
+      }
     }
   }
   pwcp->vidx += 1;
@@ -2069,6 +2407,59 @@ BoolErr PwcAppendMultiallelicGenovecHphase(const uintptr_t* __restrict genovec,
   return 0;
 }
 
+// Builds the dosage-delta-coded form of track #4 in pwcp->ddelta_buf, saving
+// its start in *coded_startp and its format in pwcp->ddelta_format; see
+// pgenlib_misc.h.  Returns its byte count if that's smaller than the standard
+// track #4 (after accounting for the larger trailer), zero otherwise.
+uint32_t DdeltaEncode(const uint16_t* dosage_main, uint32_t dosage_ct, PgenWriterCommon* pwcp, const unsigned char** coded_startp) {
+  const uintptr_t std_byte_ct = dosage_ct * sizeof(int16_t);
+  if (std_byte_ct <= kPglDosageDeltaTrailerByteCt - 1) {
+    return 0;
+  }
+  const uintptr_t byte_ct_limit = std_byte_ct + 1 - kPglDosageDeltaTrailerByteCt;
+  unsigned char* varint_start = pwcp->ddelta_buf;
+  unsigned char* varint_iter = varint_start;
+  for (uint32_t uii = 0; uii != dosage_ct; ++uii) {
+    const uint32_t cur_dosage = dosage_main[uii];
+    uint32_t dcode = 3;
+    if (cur_dosage != 65535) {
+      if (unlikely(cur_dosage > 32768)) {
+        // let validation catch this
+        return 0;
+      }
+      const uint32_t hc = (cur_dosage + 8192) / 16384;
+      const int32_t delta = S_CAST(int32_t, cur_dosage) - S_CAST(int32_t, hc * 16384);
+      dcode = (((S_CAST(uint32_t, delta) << 1) ^ S_CAST(uint32_t, delta >> 31)) << 2) | hc;
+    }
+    varint_iter = Vint32Append(dcode, varint_iter);
+  }
+  const uintptr_t varint_byte_ct = varint_iter - varint_start;
+  pwcp->ddelta_format = 1;
+  *coded_startp = varint_start;
+  uintptr_t coded_byte_ct = varint_byte_ct;
+#ifdef PGENLIB_FSE
+  // FSE_compress() returns 0 for incompressible input and 1 for a single
+  // repeated byte; we just fall back on the varint sequence in both cases.
+  // Output that wouldn't be smaller than the varint sequence or the standard
+  // track is an error (dstSize_tooSmall).
+  unsigned char* fse_start = Vint32Append(varint_byte_ct, varint_iter);
+  const uintptr_t fse_header_byte_ct = fse_start - varint_iter;
+  const uintptr_t fse_byte_ct_limit = MINV(varint_byte_ct, byte_ct_limit);
+  if (fse_byte_ct_limit > fse_header_byte_ct + 1) {
+    const size_t fse_byte_ct = FSE_compress(fse_start, fse_byte_ct_limit - fse_header_byte_ct - 1, varint_start, varint_byte_ct);
+    if ((!FSE_isError(fse_byte_ct)) && (fse_byte_ct > 1)) {
+      pwcp->ddelta_format = 2;
+      *coded_startp = varint_iter;
+      coded_byte_ct = fse_header_byte_ct + fse_byte_ct;
+    }
+  }
+#endif
+  if (coded_byte_ct >= byte_ct_limit) {
+    return 0;
+  }
+  return coded_byte_ct;
+}
+
 // ok if dosage_present trailing bits set
 BoolErr AppendDosage16(const uintptr_t* __restrict dosage_present, const uint16_t* dosage_main, uint32_t dosage_ct, uint32_t dphase_ct, PgenWriterCommon* pwcp, unsigned char* vrtype_ptr, uint32_t* vrec_len_ptr) {
   const uint32_t sample_ct = pwcp->sample_ct;
@@ -2094,6 +2485,19 @@ BoolErr AppendDosage16(const uintptr_t* __restrict dosage_present, const uint16_
     pwcp->fwrite_bufp = memcpyua(pwcp->fwrite_bufp, dosage_present, sample_ctb);
     *vrtype_ptr += 0x60;
   }
+  if (pwcp->ddelta_buf) {
+    const unsigned char* coded_start;
+    const uint32_t coded_byte_ct = DdeltaEncode(dosage_main, dosage_ct, pwcp, &coded_start);
+    if (coded_byte_ct) {
+      pwcp->ddelta_offset = *vrec_len_ptr;
+      if (unlikely(CheckedVrecLenIncr(coded_byte_ct, vrec_len_ptr))) {
+        return 1;
+      }
+      pwcp->fwrite_bufp = memcpyua(pwcp->fwrite_bufp, coded_start, coded_byte_ct);
+      pwcp->ddelta_byte_ct = coded_byte_ct;
+      return 0;
+    }
+  }
   if (unlikely(CheckedVrecLenIncr(dosage_ct * sizeof(int16_t), vrec_len_ptr))) {
     return 1;
   }
@@ -2101,6 +2505,28 @@ BoolErr AppendDosage16(const uintptr_t* __restrict dosage_present, const uint16_
   return 0;
 }
 
+// Must be called after the dosage tracks of every record with dosage data when
+// pwcp->ddelta_buf is non-null, before AppendPbwtTrailer().
+BoolErr AppendDdeltaTrailer(PgenWriterCommon* pwcp, uint32_t* vrec_len_ptr) {
+  const uint32_t coded_byte_ct = pwcp->ddelta_byte_ct;
+  if (!coded_byte_ct) {
+    if (unlikely(CheckedVrecLenIncr(1, vrec_len_ptr))) {
+      return 1;
+    }
+    *(pwcp->fwrite_bufp)++ = 0;
+    return 0;
+  }
+  if (unlikely(CheckedVrecLenIncr(kPglDosageDeltaTrailerByteCt, vrec_len_ptr))) {
+    return 1;
+  }
+  unsigned char* fwrite_bufp = memcpyua(pwcp->fwrite_bufp, &(pwcp->ddelta_offset), sizeof(int32_t));
+  fwrite_bufp = memcpyua(fwrite_bufp, &coded_byte_ct, sizeof(int32_t));
+  *fwrite_bufp++ = pwcp->ddelta_format;
+  pwcp->fwrite_bufp = fwrite_bufp;
+  pwcp->ddelta_byte_ct = 0;
+  return 0;
+}
+
 // ok if dosage_present trailing bits set
 BoolErr PwcAppendBiallelicGenovecDosage16(const uintptr_t* __restrict genovec, const uintptr_t* __restrict dosage_present, const uint16_t* dosage_main, uint32_t dosage_ct, PgenWriterCommon* pwcp) {
   // safe to call this even when entire file has no phase/dosage info
@@ -2114,6 +2540,11 @@ BoolErr PwcAppendBiallelicGenovecDosage16(const uintptr_t* __restrict genovec, c
     if (unlikely(AppendDosage16(dosage_present, dosage_main, dosage_ct, 0, pwcp, &vrtype, &vrec_len))) {
       return 1;
     }
+    if (pwcp->ddelta_buf) {
+      if (unlikely(AppendDdeltaTrailer(pwcp, &vrec_len))) {
+        return 1;
+      }
+    }
   }
   SubU32Store(vrec_len, vrec_len_byte_ct, vrec_len_dest);
   if (!pwcp->phase_dosage_gflags) {
@@ -2133,6 +2564,7 @@ BoolErr PwcAppendBiallelicGenovecHphaseDosage16(const uintptr_t* __restrict geno
   // get rid of the latter
   const uint32_t vidx = pwcp->vidx;
   unsigned char* vrtype_dest = &(R_CAST(unsigned char*, pwcp->vrtype_buf)[vidx]);
+  const unsigned char* vrec_start = pwcp->fwrite_bufp;
   uint32_t het_ct;
   uint32_t vrec_len = PwcAppendBiallelicGenovecMain(genovec, vidx, pwcp, &het_ct, nullptr, vrtype_dest);
   const uintptr_t vrec_len_byte_ct = pwcp->vrec_len_byte_ct;
@@ -2142,12 +2574,22 @@ BoolErr PwcAppendBiallelicGenovecHphaseDosage16(const uintptr_t* __restrict geno
   unsigned char* vrec_len_dest = &(pwcp->vrec_len_buf[vidx * vrec_len_byte_ct]);
   const uint32_t phasepresent_ct = phasepresent? PopcountWords(phasepresent, sample_ctl) : het_ct;
   if (phasepresent_ct) {
-    AppendHphase(genovec, phasepresent, phaseinfo, het_ct, phasepresent_ct, pwcp, vrtype_dest, &vrec_len);
+    AppendBiallelicHphase(genovec, phasepresent, phaseinfo, vrec_start, vidx, het_ct, phasepresent_ct, pwcp, vrtype_dest, &vrec_len);
   }
   if (dosage_ct) {
     if (unlikely(AppendDosage16(dosage_present, dosage_main, dosage_ct, 0, pwcp, vrtype_dest, &vrec_len))) {
       return 1;
     }
+    if (pwcp->ddelta_buf) {
+      if (unlikely(AppendDdeltaTrailer(pwcp, &vrec_len))) {
+        return 1;
+      }
+    }
+  }
+  if (phasepresent_ct && pwcp->pbwt_order) {
+    if (unlikely(AppendPbwtTrailer(pwcp, &vrec_len))) {
+      return 1;
+    }
   }
   SubU32Store(vrec_len, vrec_len_byte_ct, vrec_len_dest);
   return 0;
@@ -2179,6 +2621,7 @@ BoolErr PwcAppendBiallelicGenovecDphase16(const uintptr_t* __restrict genovec, c
   // vrtype_dest needs to be replaced
   const uint32_t vidx = pwcp->vidx;
   unsigned char* vrtype_dest = &(R_CAST(unsigned char*, pwcp->vrtype_buf)[vidx]);
+  const unsigned char* vrec_start = pwcp->fwrite_bufp;
   uint32_t het_ct;
   uint32_t vrec_len = PwcAppendBiallelicGenovecMain(genovec, vidx, pwcp, &het_ct, nullptr, vrtype_dest);
   const uintptr_t vrec_len_byte_ct = pwcp->vrec_len_byte_ct;
@@ -2188,7 +2631,7 @@ BoolErr PwcAppendBiallelicGenovecDphase16(const uintptr_t* __restrict genovec, c
   unsigned char* vrec_len_dest = &(pwcp->vrec_len_buf[vidx * vrec_len_byte_ct]);
   const uint32_t phasepresent_ct = phasepresent? PopcountWords(phasepresent, sample_ctl) : het_ct;
   if (phasepresent_ct) {
-    AppendHphase(genovec, phasepresent, phaseinfo, het_ct, phasepresent_ct, pwcp, vrtype_dest, &vrec_len);
+    AppendBiallelicHphase(genovec, phasepresent, phaseinfo, vrec_start, vidx, het_ct, phasepresent_ct, pwcp, vrtype_dest, &vrec_len);
   }
   if (dosage_ct) {
     if (unlikely(AppendDosage16(dosage_present, dosage_main, dosage_ct, dphase_ct, pwcp, vrtype_dest, &vrec_len))) {
@@ -2199,6 +2642,16 @@ BoolErr PwcAppendBiallelicGenovecDphase16(const uintptr_t* __restrict genovec, c
         return 1;
       }
     }
+    if (pwcp->ddelta_buf) {
+      if (unlikely(AppendDdeltaTrailer(pwcp, &vrec_len))) {
+        return 1;
+      }
+    }
+  }
+  if (phasepresent_ct && pwcp->pbwt_order) {
+    if (unlikely(AppendPbwtTrailer(pwcp, &vrec_len))) {
+      return 1;
+    }
   }
   SubU32Store(vrec_len, vrec_len_byte_ct, vrec_len_dest);
   return 0;
@@ -2226,6 +2679,17 @@ PglErr PwcFinish(PgenWriterCommon* pwcp, FILE** pgen_outfile_ptr) {
   for (; ; vrec_len_buf_iter = &(vrec_len_buf_iter[vrec_iter_incr])) {
     if (vrec_len_buf_iter >= vrec_len_buf_last) {
       if (vrec_len_buf_iter > vrec_len_buf_last) {
+#ifdef PGENLIB_ZSTD
+        if (pwcp->zst_group_lg) {
+          // 4c: zstd group table
+          const uint32_t zst_group_ct = pwcp->zst_group_idx;
+          assert(zst_group_ct == DivUp(variant_ct, 1U << pwcp->zst_group_lg));
+          fwrite_unlocked(pwcp->zst_group_sizes, zst_group_ct * sizeof(int32_t), 1, pgen_outfile);
+          putc_unlocked(pwcp->zst_group_lg, pgen_outfile);
+          ZSTD_freeCCtx(S_CAST(ZSTD_CCtx*, pwcp->zst_cctx));
+          pwcp->zst_cctx = nullptr;
+        }
+#endif
         return fclose_null(pgen_outfile_ptr)? kPglRetWriteFail : kPglRetSuccess;
       }
       const uint32_t vblock_size = ModNz(variant_ct, kPglVblockSize);
@@ -2258,6 +2722,14 @@ PglErr PwcFinish(PgenWriterCommon* pwcp, FILE** pgen_outfile_ptr) {
 PglErr SpgwFinish(STPgenWriter* spgwp) {
   PgenWriterCommon* pwcp = GetPwcp(spgwp);
   FILE** pgen_outfilep = GetPgenOutfilep(spgwp);
+#ifdef PGENLIB_ZSTD
+  if (pwcp->zst_group_lg) {
+    if (unlikely(ZstWriteGroupBytes(pwcp->fwrite_buf, pwcp->fwrite_bufp - pwcp->fwrite_buf, 1, pwcp, *pgen_outfilep))) {
+      return kPglRetWriteFail;
+    }
+    return PwcFinish(pwcp, pgen_outfilep);
+  }
+#endif
   if (unlikely(fwrite_checked(pwcp->fwrite_buf, pwcp->fwrite_bufp - pwcp->fwrite_buf, *pgen_outfilep))) {
     return kPglRetWriteFail;
   }
@@ -2276,18 +2748,48 @@ PglErr MpgwFlush(MTPgenWriter* mpgwp) {
   uint64_t* vblock_fpos = pwcp->vblock_fpos;
   FILE* pgen_outfile = mpgwp->pgen_outfile;
   const uint32_t vidx_incr = (thread_ct - 1) * kPglVblockSize;
-  uint64_t cur_vblock_fpos = ftello(pgen_outfile);
+  const uint32_t zst_group_lg = pwcp->zst_group_lg;
+  // in zstd mode, the header refers to uncompressed-stream positions, which we
+  // track in pwcs[0]->vblock_fpos_offset
+  uint64_t cur_vblock_fpos = zst_group_lg? pwcp->vblock_fpos_offset : S_CAST(uint64_t, ftello(pgen_outfile));
   for (uint32_t tidx = 0; tidx != thread_ct; ++tidx) {
     vblock_fpos[(vidx / kPglVblockSize) + tidx] = cur_vblock_fpos;
     PgenWriterCommon* cur_pwcp = mpgwp->pwcs[tidx];
     uintptr_t cur_vblock_byte_ct = cur_pwcp->fwrite_bufp - cur_pwcp->fwrite_buf;
-    if (unlikely(fwrite_checked(cur_pwcp->fwrite_buf, cur_vblock_byte_ct, pgen_outfile))) {
-      return kPglRetWriteFail;
+#ifdef PGENLIB_ZSTD
+    if (zst_group_lg) {
+      // groups never cross a vblock boundary, so each thread's buffer can be
+      // split into groups using the record lengths
+      const unsigned char* vrec_len_buf = pwcp->vrec_len_buf;
+      const uintptr_t vrec_len_byte_ct = pwcp->vrec_len_byte_ct;
+      const unsigned char* group_start = cur_pwcp->fwrite_buf;
+      uint32_t cur_vidx = vidx + tidx * kPglVblockSize;
+      const uint32_t cur_vblock_end = MINV(cur_vidx + kPglVblockSize, variant_ct);
+      while (cur_vidx != cur_vblock_end) {
+        const uint32_t group_end = MINV(cur_vidx + (1U << zst_group_lg), cur_vblock_end);
+        uintptr_t group_byte_ct = 0;
+        for (; cur_vidx != group_end; ++cur_vidx) {
+          group_byte_ct += SubU32Load(&(vrec_len_buf[cur_vidx * vrec_len_byte_ct]), vrec_len_byte_ct);
+        }
+        if (unlikely(ZstWriteGroupBytes(group_start, group_byte_ct, 1, pwcp, pgen_outfile))) {
+          return kPglRetWriteFail;
+        }
+        group_start = &(group_start[group_byte_ct]);
+      }
+      assert(group_start == cur_pwcp->fwrite_bufp);
+    } else {
+#endif
+      if (unlikely(fwrite_checked(cur_pwcp->fwrite_buf, cur_vblock_byte_ct, pgen_outfile))) {
+        return kPglRetWriteFail;
+      }
+#ifdef PGENLIB_ZSTD
     }
+#endif
     cur_pwcp->vidx += vidx_incr;
     cur_pwcp->fwrite_bufp = cur_pwcp->fwrite_buf;
     cur_vblock_fpos += cur_vblock_byte_ct;
   }
+  pwcp->vblock_fpos_offset = cur_vblock_fpos;
   if (!is_last_flush) {
     return kPglRetSuccess;
   }
@@ -2302,6 +2804,11 @@ BoolErr CleanupSpgw(STPgenWriter* spgwp, PglErr* reterrp) {
   if (!(*pgen_outfilep)) {
     return 0;
   }
+#ifdef PGENLIB_ZSTD
+  PgenWriterCommon* pwcp = GetPwcp(spgwp);
+  ZSTD_freeCCtx(S_CAST(ZSTD_CCtx*, pwcp->zst_cctx));
+  pwcp->zst_cctx = nullptr;
+#endif
   if (!fclose_null(pgen_outfilep)) {
     return 0;
   }
@@ -2316,6 +2823,10 @@ BoolErr CleanupMpgw(MTPgenWriter* mpgwp, PglErr* reterrp) {
   if ((!mpgwp) || (!mpgwp->pgen_outfile)) {
     return 0;
   }
+#ifdef PGENLIB_ZSTD
+  ZSTD_freeCCtx(S_CAST(ZSTD_CCtx*, mpgwp->pwcs[0]->zst_cctx));
+  mpgwp->pwcs[0]->zst_cctx = nullptr;
+#endif
   if (!fclose_null(&(mpgwp->pgen_outfile))) {
     return 0;
   }
@@ -47,7 +47,8 @@ typedef struct PgenWriterCommonStruct {
 
   STD_ARRAY_DECL(uint32_t, 4, ldbase_genocounts);
 
-  // should match ftello() return value in singlethreaded case, but be set to
+  // should match ftello() return value in singlethreaded case (or the
+  // uncompressed-stream position when zstd groups are enabled), but be set to
   // zero in multithreaded case
   uint64_t vblock_fpos_offset;
 
@@ -71,6 +72,38 @@ typedef struct PgenWriterCommonStruct {
   // I'll cache this for now
   uintptr_t vrec_len_byte_ct;
 
+  // PBWT hardcall-phase coding (mode 0x12); pbwt_order == nullptr iff
+  // disabled.  The orderings hold 2 * sample_ct entries, and pbwt_haps holds
+  // 2 * sample_ct bits.
+  uint32_t* pbwt_order;
+  uint32_t* pbwt_order_tmp;
+  uintptr_t* pbwt_haps;
+  unsigned char* pbwt_runs_buf;
+  uint32_t pbwt_window_vidx;
+  // describes the current record's track #2; pbwt_runs_byte_ct == 0 if it's
+  // stored the usual way
+  uint32_t pbwt_runs_offset;
+  uint32_t pbwt_runs_byte_ct;
+
+  // zstd-compressed record groups (mode byte bit 2); zst_group_lg == 0 iff
+  // disabled.  zst_group_sizes is shared by all threads, but only pwcs[0]
+  // ever compresses in the multithreaded case.
+  uint32_t* zst_group_sizes;
+  void* zst_cctx;
+  uint64_t zst_frame_byte_ct;
+  uint32_t zst_group_idx;
+  uint32_t zst_group_lg;
+
+  // Dosage-delta coding (mode byte bit 3); ddelta_buf == nullptr iff
+  // disabled.  ddelta_buf holds the varint sequence (up to 3 bytes per
+  // sample), followed by room for its FSE-compressed form.
+  unsigned char* ddelta_buf;
+  // describes the current record's track #4; ddelta_byte_ct == 0 if it's
+  // stored the usual way
+  uint32_t ddelta_offset;
+  uint32_t ddelta_byte_ct;
+  uint32_t ddelta_format;
+
   uint32_t vidx;
 } PgenWriterCommon;
 
@@ -131,6 +164,12 @@ void PreinitSpgw(STPgenWriter* spgwp);
 // phase_dosage_gflags zero vs. nonzero is most important: this determines size
 // of header.  Otherwise, setting more flags than necessary just increases
 // memory requirements.
+// kfPgenGlobalPbwtHphase is ignored unless kfPgenGlobalHardcallPhasePresent is
+// also set, or if sample_ct >= 2^30.
+// kfPgenGlobalZstdRecords requests zstd-compressed record groups; this returns
+// kPglRetNotYetSupported if pgenlib wasn't compiled with PGENLIB_ZSTD.
+// kfPgenGlobalDosageDelta is ignored unless kfPgenGlobalDosagePresent is also
+// set.  The FSE stage is only used in PGENLIB_ZSTD builds (see PGENLIB_FSE).
 //
 // nonref_flags_storage values:
 //   0 = no info stored
@@ -41,6 +41,10 @@ static_assert(kBgzfRawMtStreamRetargetCode > kMaxBgzfCompressedBlockSize, "kBgzf
 
 CONSTI32(kBgzfRawMtStreamMaxCapacity, 0x7fffffc0);
 
+// Number of consecutive joins where decompression was already finished before
+// BgzfReadJoinAndRespawn() sheds a decompressor thread.
+CONSTI32(kBgzfDecompressAheadStreakMax, 4);
+
 // This function usually repeatedly joins and respawns the reader and
 // decompressor worker threads, until *dst_iterp reaches dst_end or we've hit
 // EOF.  In the EOF case, *dst_iterp is set to 1 past the last read byte;
@@ -65,14 +69,30 @@ PglErr BgzfReadJoinAndRespawn(unsigned char* dst_end, BgzfRawMtDecompressStream*
     dst_iter = *dst_iterp;
   }
   unsigned char* next_target;
+  const uint32_t decompress_thread_ct = GetThreadCtTg(tgp) - 1;
   do {
-    JoinThreads(tgp);
-
-    // 1. Check for decompression and read errors.
     const uint32_t next_producer_parity = bgzfp->consumer_parity;
     const uint32_t prev_producer_parity = 1 - next_producer_parity;
     BgzfMtReadBody* bodyp = &bgzfp->body;
     BgzfMtReadCommWithD* cwd = bodyp->cwd[prev_producer_parity];
+    // 0. Check whether we're about to wait on the decompressors, and tune the
+    //    number of active decompressor threads accordingly.
+    if (__atomic_load_n(&cwd->finished_ct, __ATOMIC_ACQUIRE) == decompress_thread_ct) {
+      if (++bgzfp->decompress_ahead_streak == kBgzfDecompressAheadStreakMax) {
+        bgzfp->decompress_ahead_streak = 0;
+        if (bgzfp->active_decompress_ct > 1) {
+          --bgzfp->active_decompress_ct;
+        }
+      }
+    } else {
+      bgzfp->decompress_ahead_streak = 0;
+      if (bgzfp->active_decompress_ct < decompress_thread_ct) {
+        ++bgzfp->active_decompress_ct;
+      }
+    }
+    JoinThreads(tgp);
+
+    // 1. Check for decompression and read errors.
     if (unlikely(cwd->invalid_bgzf)) {
       goto BgzfReadJoinAndRespawn_ret_INVALID_BGZF;
     }
@@ -117,11 +137,12 @@ PglErr BgzfReadJoinAndRespawn(unsigned char* dst_end, BgzfRawMtDecompressStream*
       next_target = nullptr;
     } else {
       // 4. Determine block boundaries in in[remaining_start, remaining_end),
-      //    and mark a multiple-of-decompress_thread_ct blocks for concurrent
+      //    and mark a multiple-of-active_decompress_ct blocks for concurrent
       //    decompression, taking advantage of any remaining dst space.  (If
       //    there's no dst space left, the overflow buffer still lets us
-      //    decompress the next decompress_thread_ct blocks in the background.)
-      const uint32_t decompress_thread_ct = GetThreadCtTg(tgp) - 1;
+      //    decompress the next active_decompress_ct blocks in the background.)
+      //    Any remaining decompressor threads are given nothing to do.
+      const uint32_t active_decompress_ct = bgzfp->active_decompress_ct;
       // We actually iterate through the blocks twice.  The first iteration
       // counts the number of blocks that target_capacity allows for, and the
       // second iteration fills next_cwd->{in_offsets, out_offsets}.
@@ -133,7 +154,7 @@ PglErr BgzfReadJoinAndRespawn(unsigned char* dst_end, BgzfRawMtDecompressStream*
       uint32_t n_eof_blocks = 0;
       while (write_offset <= target_capacity) {
         uint32_t uii = 0;
-        for (; uii != decompress_thread_ct; ++uii) {
+        for (; uii != active_decompress_ct; ++uii) {
           const uint32_t n_inbytes = in_end - in_iter;
           if (n_inbytes <= 25) {
             if (unlikely(remaining_end_is_eof && n_inbytes)) {
@@ -165,7 +186,7 @@ PglErr BgzfReadJoinAndRespawn(unsigned char* dst_end, BgzfRawMtDecompressStream*
           in_iter = &(in_iter[bsize_minus1 + 1]);
           write_offset += out_size;
         }
-        if (uii != decompress_thread_ct) {
+        if (uii != active_decompress_ct) {
           if (remaining_end_is_eof && (in_iter == in_end)) {
             n_eof_blocks = uii;
           }
@@ -182,7 +203,7 @@ PglErr BgzfReadJoinAndRespawn(unsigned char* dst_end, BgzfRawMtDecompressStream*
       next_cwd->target_capacity = target_capacity;
       uint32_t* in_offsets = next_cwd->in_offsets;
       uint32_t* out_offsets = next_cwd->out_offsets;
-      for (uint32_t out_tidx = 0; out_tidx != decompress_thread_ct; ++out_tidx) {
+      for (uint32_t out_tidx = 0; out_tidx != active_decompress_ct; ++out_tidx) {
         in_offsets[out_tidx] = in_iter - in;
         out_offsets[out_tidx] = write_offset;
         const uint32_t nblocks = n_blocks_per_thread + (n_eof_blocks > out_tidx);
@@ -195,7 +216,12 @@ PglErr BgzfReadJoinAndRespawn(unsigned char* dst_end, BgzfRawMtDecompressStream*
         }
       }
       const uint32_t locked_end = in_iter - in;
+      for (uint32_t out_tidx = active_decompress_ct; out_tidx != decompress_thread_ct; ++out_tidx) {
+        in_offsets[out_tidx] = locked_end;
+        out_offsets[out_tidx] = write_offset;
+      }
       in_offsets[decompress_thread_ct] = locked_end;
+      next_cwd->finished_ct = 0;
 
       BgzfMtReadCommWithR* next_cwr = bodyp->cwr[next_producer_parity];
       next_cwr->locked_start = remaining_start;
@@ -245,11 +271,12 @@ THREAD_FUNC_DECL BgzfRawMtStreamThread(void* raw_arg) {
     // (especially when the input file isn't in cache) that we don't want the
     // consumer thread to block on it.
     FILE* ff = bodyp->ff;
-    // in[] has space for kDecompressChunkSize bytes.
+    // in[] has space for in_capacity bytes.
     // The current buffer-usage logic assumes that thresh1 <= 1/3 of the buffer
     // size, and thresh2 >= 2/3.
+    const uint32_t in_capacity = bodyp->in_capacity;
     const uint32_t thresh1 = (GetThreadCtTg(&context->tg) - 1) * (26 + kMaxBgzfCompressedBlockSize);
-    const uint32_t thresh2 = kDecompressChunkSize - thresh1;
+    const uint32_t thresh2 = in_capacity - thresh1;
     uint32_t remaining_read_start = bodyp->initial_compressed_byte_ct;
     uint32_t is_eof = 0;
     do {
@@ -263,9 +290,9 @@ THREAD_FUNC_DECL BgzfRawMtStreamThread(void* raw_arg) {
       // 1. locked_start <= locked_end < thresh1 (always true on function
       //    entry)  Try to load up to &(in[thresh2]).
       // 2. locked_start < thresh1 <= locked_end <= thresh2.  Try to load up to
-      //    &(in[kDecompressChunkSize]) (the end of the buffer).
+      //    &(in[in_capacity]) (the end of the buffer).
       // 3. thresh1 <= locked_start <= thresh2 < locked_end.  Copy
-      //    [locked_end, kDecompressChunkSize) back to the beginning of the
+      //    [locked_end, in_capacity) back to the beginning of the
       //    buffer, and try to load up to &(in[prev_start_offset]).
       // We also have the following special case:
       // 4. locked_start == kBgzfRawMtStreamRetargetCode indicates that the
@@ -283,7 +310,7 @@ THREAD_FUNC_DECL BgzfRawMtStreamThread(void* raw_arg) {
         remaining_end = thresh2;
       } else if (locked_end <= thresh2) {
         // state 2
-        remaining_end = kDecompressChunkSize;
+        remaining_end = in_capacity;
       } else {
         // state 3
         remaining_read_start -= locked_end;
@@ -346,6 +373,7 @@ THREAD_FUNC_DECL BgzfRawMtStreamThread(void* raw_arg) {
         in_offset += in_size + 26;
         out_offset = out_offset_end;
       }
+      __atomic_fetch_add(&cwd->finished_ct, 1, __ATOMIC_RELEASE);
       parity = 1 - parity;
     } while (!THREAD_BLOCK_FINISH(arg));
   }
@@ -371,14 +399,25 @@ PglErr BgzfRawMtStreamInit(const char* header, uint32_t decompress_thread_ct, FI
       }
       goto BgzfRawMtStreamInit_ret_NOMEM;
     }
+    const uint32_t in_capacity = BgzfMtChunkSize(decompress_thread_ct);
+    bodyp->in_capacity = in_capacity;
     if (bgzf_st_ptr) {
+      if (in_capacity > kDecompressChunkSize) {
+        unsigned char* new_in = S_CAST(unsigned char*, realloc(bgzf_st_ptr->in, in_capacity));
+        if (unlikely(!new_in)) {
+          free(bgzf_st_ptr->in);
+          libdeflate_free_decompressor(bgzf_st_ptr->ldc);
+          goto BgzfRawMtStreamInit_ret_NOMEM;
+        }
+        bgzf_st_ptr->in = new_in;
+      }
       bodyp->in = bgzf_st_ptr->in;
       const uint32_t in_pos = bgzf_st_ptr->in_pos;
       const uint32_t initial_compressed_byte_ct = bgzf_st_ptr->in_size - in_pos;
       memmove(bodyp->in, &(bodyp->in[in_pos]), initial_compressed_byte_ct);
       bodyp->initial_compressed_byte_ct = initial_compressed_byte_ct;
     } else {
-      bodyp->in = S_CAST(unsigned char*, malloc(kDecompressChunkSize));
+      bodyp->in = S_CAST(unsigned char*, malloc(in_capacity));
       if (unlikely(!bodyp->in)) {
         goto BgzfRawMtStreamInit_ret_NOMEM;
       }
@@ -427,7 +466,10 @@ PglErr BgzfRawMtStreamInit(const char* header, uint32_t decompress_thread_ct, FI
       bodyp->cwd[parity]->target = nullptr;
       ZeroU32Arr(kMaxBgzfDecompressThreads + 1, bodyp->cwd[parity]->in_offsets);
       // out_offsets doesn't matter when in_offsets is zeroed
+      bodyp->cwd[parity]->finished_ct = 0;
     }
+    bgzfp->active_decompress_ct = decompress_thread_ct;
+    bgzfp->decompress_ahead_streak = 0;
 
     SetThreadFuncAndData(BgzfRawMtStreamThread, bgzfp, tgp);
     if (unlikely(SpawnThreads(tgp))) {
@@ -502,6 +544,7 @@ PglErr BgzfRawMtStreamRetarget(const char* header, BgzfRawMtDecompressStream* bg
     bodyp->cwd[parity]->target_capacity = 0;
     bodyp->cwd[parity]->target = nullptr;
     ZeroU32Arr(kMaxBgzfDecompressThreads + 1, bodyp->cwd[parity]->in_offsets);
+    bodyp->cwd[parity]->finished_ct = 0;
     // bugfix (3 Oct 2019): forgot this
     bgzfp->overflow_start[parity] = 0;
     bgzfp->overflow_end[parity] = 0;
@@ -527,12 +570,14 @@ PglErr BgzfRawMtStreamRetarget(const char* header, BgzfRawMtDecompressStream* bg
 }
 
 void CleanupBgzfRawMtStream(BgzfRawMtDecompressStream* bgzfp) {
-  uint32_t decompress_thread_ct = GetThreadCtTg(&bgzfp->tg);
-  if (decompress_thread_ct) {
-    --decompress_thread_ct;
+  BgzfMtReadBody* bodyp = &bgzfp->body;
+  // The thread count is only meaningful once BgzfRawMtStreamInit() has gotten
+  // far enough to allocate in[]; the decompressors are allocated after that.
+  uint32_t decompress_thread_ct = 0;
+  if (bodyp->in) {
+    decompress_thread_ct = GetThreadCtTg(&bgzfp->tg) - 1;
   }
   CleanupThreads(&bgzfp->tg);
-  BgzfMtReadBody* bodyp = &bgzfp->body;
   for (uint32_t tidx = 0; tidx < decompress_thread_ct; ++tidx) {
     if (bodyp->ldcs[tidx]) {
       libdeflate_free_decompressor(bodyp->ldcs[tidx]);
@@ -548,6 +593,126 @@ void CleanupBgzfRawMtStream(BgzfRawMtDecompressStream* bgzfp) {
   }
 }
 
+void PreinitBgzfBlockReader(BgzfBlockReader* bbrp) {
+  bbrp->ff = nullptr;
+  bbrp->ldc = nullptr;
+  bbrp->in = nullptr;
+}
+
+PglErr BgzfFindBlockStart(FILE* ff, uint64_t fpos_min, uint64_t fpos_end, uint64_t* block_fpos_ptr) {
+  if (fpos_min >= fpos_end) {
+    *block_fpos_ptr = fpos_end;
+    return kPglRetSuccess;
+  }
+  // A block must start in the first kMaxBgzfCompressedBlockSize bytes, and we
+  // also need to see the header of the block after it.
+  const uint32_t window_size = 2 * kMaxBgzfCompressedBlockSize + 16;
+  unsigned char* buf = S_CAST(unsigned char*, malloc(window_size));
+  if (unlikely(!buf)) {
+    return kPglRetNomem;
+  }
+  PglErr reterr = kPglRetSuccess;
+  {
+    if (unlikely(fseeko(ff, fpos_min, SEEK_SET))) {
+      goto BgzfFindBlockStart_ret_READ_FAIL;
+    }
+    const uint32_t nbytes = fread_unlocked(buf, 1, window_size, ff);
+    if (unlikely(ferror_unlocked(ff))) {
+      goto BgzfFindBlockStart_ret_READ_FAIL;
+    }
+    const uint64_t bytes_left = fpos_end - fpos_min;
+    const uint32_t search_end = MINV(nbytes, kMaxBgzfCompressedBlockSize);
+    for (uint32_t offset = 0; offset + 18 <= search_end; ++offset) {
+      if (!IsBgzfHeader(&(buf[offset]))) {
+        continue;
+      }
+      const uint32_t bsize = (*R_CAST(uint16_t*, &(buf[offset + 16]))) + 1;
+      if (bsize < 26) {
+        continue;
+      }
+      const uint32_t next_offset = offset + bsize;
+      if ((next_offset == bytes_left) || ((next_offset + 16 <= nbytes) && IsBgzfHeader(&(buf[next_offset])))) {
+        *block_fpos_ptr = fpos_min + offset;
+        goto BgzfFindBlockStart_ret_1;
+      }
+    }
+    if (unlikely(nbytes > kMaxBgzfCompressedBlockSize)) {
+      reterr = kPglRetDecompressFail;
+      goto BgzfFindBlockStart_ret_1;
+    }
+    *block_fpos_ptr = fpos_end;
+  }
+  while (0) {
+  BgzfFindBlockStart_ret_READ_FAIL:
+    reterr = kPglRetReadFail;
+    break;
+  }
+ BgzfFindBlockStart_ret_1:
+  free(buf);
+  return reterr;
+}
+
+PglErr BgzfBlockReaderOpen(const char* fname, uint64_t fpos, uint64_t fpos_end, BgzfBlockReader* bbrp) {
+  bbrp->ff = fopen(fname, FOPEN_RB);
+  if (unlikely(!bbrp->ff)) {
+    return kPglRetOpenFail;
+  }
+  if (unlikely(fseeko(bbrp->ff, fpos, SEEK_SET))) {
+    return kPglRetReadFail;
+  }
+  bbrp->in = S_CAST(unsigned char*, malloc(kMaxBgzfCompressedBlockSize));
+  if (unlikely(!bbrp->in)) {
+    return kPglRetNomem;
+  }
+  bbrp->ldc = libdeflate_alloc_decompressor();
+  if (unlikely(!bbrp->ldc)) {
+    return kPglRetNomem;
+  }
+  bbrp->fpos = fpos;
+  bbrp->fpos_end = fpos_end;
+  return kPglRetSuccess;
+}
+
+PglErr BgzfBlockReaderNext(BgzfBlockReader* bbrp, unsigned char* dst, uint32_t* out_size_ptr) {
+  if (bbrp->fpos >= bbrp->fpos_end) {
+    return kPglRetEof;
+  }
+  unsigned char* in = bbrp->in;
+  FILE* ff = bbrp->ff;
+  if (unlikely(!fread_unlocked(in, 18, 1, ff))) {
+    return ferror_unlocked(ff)? kPglRetReadFail : kPglRetDecompressFail;
+  }
+  const uint32_t bsize = (*R_CAST(uint16_t*, &(in[16]))) + 1;
+  if (unlikely((!IsBgzfHeader(in)) || (bsize < 26) || (bbrp->fpos + bsize > bbrp->fpos_end))) {
+    return kPglRetDecompressFail;
+  }
+  if (unlikely(!fread_unlocked(&(in[18]), bsize - 18, 1, ff))) {
+    return ferror_unlocked(ff)? kPglRetReadFail : kPglRetDecompressFail;
+  }
+  const uint32_t out_size = *R_CAST(uint32_t*, &(in[bsize - 4]));
+  if (unlikely((out_size > kMaxBgzfDecompressedBlockSize) || libdeflate_deflate_decompress(bbrp->ldc, &(in[18]), bsize - 26, dst, out_size, nullptr))) {
+    return kPglRetDecompressFail;
+  }
+  bbrp->fpos += bsize;
+  *out_size_ptr = out_size;
+  return kPglRetSuccess;
+}
+
+void CleanupBgzfBlockReader(BgzfBlockReader* bbrp) {
+  if (bbrp->ldc) {
+    libdeflate_free_decompressor(bbrp->ldc);
+    bbrp->ldc = nullptr;
+  }
+  if (bbrp->in) {
+    free(bbrp->in);
+    bbrp->in = nullptr;
+  }
+  if (bbrp->ff) {
+    fclose(bbrp->ff);
+    bbrp->ff = nullptr;
+  }
+}
+
 
 void PreinitBgzfCompressStream(BgzfCompressStream* cstream_ptr) {
   BgzfCompressStreamMain* bgzfp = GetBgzfp(cstream_ptr);
@@ -59,9 +59,12 @@ CONSTI32(kDecompressChunkSize, 1048576);
 static_assert(!(kDecompressChunkSize % kCacheline), "kDecompressChunkSize must be a multiple of kCacheline.");
 static_assert(kDecompressChunkSize >= kMaxMediumLine, "kDecompressChunkSize too small.");
 
-CONSTI32(kMaxBgzfDecompressThreads, 5);
+// The multithreaded reader's read-ahead window is kDecompressChunkSize bytes
+// when there are few enough decompressor threads, and grows with the thread
+// count beyond that; see BgzfMtChunkSize().
+CONSTI32(kMaxBgzfDecompressThreads, 16);
 CONSTI32(kMaxBgzfCompressedBlockSize, 65536);
-static_assert(kMaxBgzfDecompressThreads * 3 * kMaxBgzfCompressedBlockSize < kDecompressChunkSize, "kMaxBgzfDecompressThreads too large relative to kDecompressChunkSize.");
+static_assert(kMaxBgzfDecompressThreads * 3 * (26 + kMaxBgzfCompressedBlockSize) < 0x7fffffff, "kMaxBgzfDecompressThreads too large.");
 CONSTI32(kMaxBgzfDecompressedBlockSize, 65536);
 static_assert((kMaxBgzfDecompressedBlockSize % kCacheline) == 0, "kMaxBgzfDecompressedBlockSize is assumed to be a cacheline multiple.");
 
@@ -103,6 +106,11 @@ typedef struct BgzfMtReadCommWithDStruct {
   unsigned char* target;
   uint32_t in_offsets[kMaxBgzfDecompressThreads + 1];
   uint32_t out_offsets[kMaxBgzfDecompressThreads];
+
+  // Decompressors -> consumer.  Number of decompressor threads that have
+  // finished their share of this round; lets the consumer check, without
+  // blocking, whether it's about to wait on decompression.
+  uint32_t finished_ct;
 } BgzfMtReadCommWithD;
 
 typedef struct BgzfMtReadBodyStruct {
@@ -117,6 +125,8 @@ typedef struct BgzfMtReadBodyStruct {
   FILE* ff;
 
   unsigned char* in;
+  // Size of in[]; see BgzfMtChunkSize().
+  uint32_t in_capacity;
 
   BgzfMtReadCommWithR* cwr[2];
   BgzfMtReadCommWithD* cwd[2];
@@ -140,10 +150,25 @@ typedef struct BgzfRawMtDecompressStreamStruct {
   uint32_t overflow_end[2];
   uint32_t consumer_parity;
   uint32_t eof;
+
+  // Number of decompressor threads currently handed work.  This starts at the
+  // full thread count, and is adjusted after every join: it's incremented
+  // when the consumer has to wait on decompression, and decremented after a
+  // run of joins where decompression was already done, so a slow consumer
+  // doesn't keep idle cores spinning on read-ahead it can't use.
+  uint32_t active_decompress_ct;
+  uint32_t decompress_ahead_streak;
 } BgzfRawMtDecompressStream;
 
 extern const char kShortErrInvalidBgzf[];
 
+// Read-ahead window must be at least 3x the largest possible set of in-flight
+// compressed blocks.
+HEADER_INLINE uint32_t BgzfMtChunkSize(uint32_t decompress_thread_ct) {
+  const uint32_t min_size = RoundUpPow2(3 * decompress_thread_ct * (26 + kMaxBgzfCompressedBlockSize), kCacheline);
+  return MAXV(min_size, kDecompressChunkSize);
+}
+
 void PreinitBgzfRawMtStream(BgzfRawMtDecompressStream* bgzfp);
 
 // Two modes:
@@ -152,7 +177,9 @@ void PreinitBgzfRawMtStream(BgzfRawMtDecompressStream* bgzfp);
 // - Move-construction: ff is assumed to point to &(bgzf_st_ptr->in[in_size]).
 //   header must be nullptr.
 // decompress_thread_ct must be positive.  It is automatically reduced to
-// kMaxBgzfDecompressThreads if necessary.
+// kMaxBgzfDecompressThreads if necessary.  In the move-construction case,
+// bgzf_st_ptr->in is reallocated if BgzfMtChunkSize() exceeds
+// kDecompressChunkSize.
 PglErr BgzfRawMtStreamInit(const char* header, uint32_t decompress_thread_ct, FILE* ff, BgzfRawDecompressStream* bgzf_st_ptr, BgzfRawMtDecompressStream* bgzfp, const char** errmsgp);
 
 PglErr BgzfRawMtStreamRead(unsigned char* dst_end, BgzfRawMtDecompressStream* bgzfp, unsigned char** dst_iterp, const char** errmsgp);
@@ -166,6 +193,38 @@ HEADER_INLINE PglErr BgzfRawMtStreamRewind(BgzfRawMtDecompressStream* bgzfp, con
 void CleanupBgzfRawMtStream(BgzfRawMtDecompressStream* bgzfp);
 
 
+// Single-threaded sequential reader starting from an arbitrary BGZF block.
+// Several of these can decompress different parts of the same file at once.
+typedef struct BgzfBlockReaderStruct {
+  NONCOPYABLE(BgzfBlockReaderStruct);
+  FILE* ff;
+  struct libdeflate_decompressor* ldc;
+  unsigned char* in;
+  // Position of the next block.  Callers may read this to determine which
+  // byte range a block came from.
+  uint64_t fpos;
+  uint64_t fpos_end;
+} BgzfBlockReader;
+
+void PreinitBgzfBlockReader(BgzfBlockReader* bbrp);
+
+// Scans forward from fpos_min for the first BGZF block start, which is
+// confirmed by checking that another block (or fpos_end) immediately follows
+// the candidate.  Sets *block_fpos_ptr to fpos_end if there is no such block.
+// ff position is unspecified afterward.
+PglErr BgzfFindBlockStart(FILE* ff, uint64_t fpos_min, uint64_t fpos_end, uint64_t* block_fpos_ptr);
+
+// fpos must be the start of a block; fpos_end is usually the file size.
+PglErr BgzfBlockReaderOpen(const char* fname, uint64_t fpos, uint64_t fpos_end, BgzfBlockReader* bbrp);
+
+// dst must have space for kMaxBgzfDecompressedBlockSize bytes.  Returns
+// kPglRetEof once fpos_end is reached, and kPglRetDecompressFail on a
+// malformed block.
+PglErr BgzfBlockReaderNext(BgzfBlockReader* bbrp, unsigned char* dst, uint32_t* out_size_ptr);
+
+void CleanupBgzfBlockReader(BgzfBlockReader* bbrp);
+
+
 // Compression strategy:
 // - We have N compression-job memory slots, where N is the smallest power of 2
 //   >= 4 * compressor_thread_ct.  (This could be adjusted and/or separately
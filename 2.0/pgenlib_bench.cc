@@ -0,0 +1,565 @@
+// This file is part of PLINK 2.00, copyright (C) 2005-2020 Shaun Purcell,
+// Christopher Chang.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// Encode/decode throughput benchmark for pgenlib.  One synthetic .pgen is
+// generated per record-type profile (in the spirit of --dummy), timing the
+// single-threaded writer along the way; each file is then read back with
+// PgrGet(), PgrGetCounts(), PgrGetDp(), and PgrGetMissingness() under several
+// sample-subset densities.
+//
+// Results go to stdout as a tab-delimited table (header line starts with
+// '#'), so they can be diffed across builds.  The fastest of the requested
+// number of passes is reported.  Byte throughput is relative to the on-disk
+// size of the variant records.
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+#include "include/pgenlib_read.h"
+#include "include/pgenlib_write.h"
+
+namespace plink2 {
+
+ENUM_U31_DEF_START()
+  kBenchProfileDense,
+  kBenchProfileSparse,
+  kBenchProfileLd,
+  kBenchProfileMultiallelic,
+  kBenchProfilePhased,
+  kBenchProfileDosage,
+  kBenchProfileCt
+ENUM_U31_DEF_END(BenchProfile);
+
+static const char kBenchProfileNames[kBenchProfileCt][16] = {"dense", "sparse", "ld", "multiallelic", "phased", "dosage"};
+
+// Writer routine exercised by each profile.
+static const char kBenchWriteOpNames[kBenchProfileCt][40] = {"PwcAppendBiallelicGenovec", "PwcAppendBiallelicGenovec", "PwcAppendBiallelicGenovec", "PwcAppendMultiallelicSparse", "PwcAppendBiallelicGenovecHphase", "PwcAppendBiallelicGenovecDosage16"};
+
+ENUM_U31_DEF_START()
+  kBenchOpGet,
+  kBenchOpGetCounts,
+  kBenchOpGetDp,
+  kBenchOpGetMissingness,
+  kBenchOpCt
+ENUM_U31_DEF_END(BenchOp);
+
+static const char kBenchOpNames[kBenchOpCt][20] = {"PgrGet", "PgrGetCounts", "PgrGetDp", "PgrGetMissingness"};
+
+// Percentage of samples included in each read pass.
+CONSTI32(kBenchSubsetCt, 4);
+static const uint32_t kBenchSubsetPcts[kBenchSubsetCt] = {100, 50, 10, 1};
+
+// Cumulative genotype thresholds (out of 65536) for hom-ref, het, and hom-alt;
+// the remainder is missing.
+static const uint32_t kBenchDenseThresholds[3] = {23593, 55050, 64880};
+static const uint32_t kBenchSparseThresholds[3] = {65365, 65496, 65503};
+
+static inline uint64_t Xorshift64(uint64_t* state_ptr) {
+  uint64_t xx = *state_ptr;
+  xx ^= xx << 13;
+  xx ^= xx >> 7;
+  xx ^= xx << 17;
+  *state_ptr = xx;
+  return xx;
+}
+
+static inline uint32_t RandU16(uint64_t* state_ptr) {
+  return Xorshift64(state_ptr) >> 48;
+}
+
+static inline uintptr_t DrawGeno(const uint32_t* thresholds, uint32_t rand16) {
+  return (rand16 >= thresholds[0]) + (rand16 >= thresholds[1]) + (rand16 >= thresholds[2]);
+}
+
+static void FillRandomGenovec(const uint32_t* thresholds, uint32_t sample_ct, uint64_t* state_ptr, uintptr_t* genovec) {
+  const uint32_t word_ct = NypCtToWordCt(sample_ct);
+  for (uint32_t widx = 0; widx != word_ct; ++widx) {
+    uintptr_t cur_word = 0;
+    for (uint32_t uii = 0; uii != kBitsPerWordD2; uii += 4) {
+      const uint64_t rand64 = Xorshift64(state_ptr);
+      for (uint32_t ujj = 0; ujj != 4; ++ujj) {
+        cur_word |= DrawGeno(thresholds, (rand64 >> (16 * ujj)) & 65535) << (2 * (uii + ujj));
+      }
+    }
+    genovec[widx] = cur_word;
+  }
+  ZeroTrailingNyps(sample_ct, genovec);
+}
+
+// All sizes are vector multiples.
+static inline void* BenchAllocRaw(uintptr_t blen, unsigned char** alloc_iterp) {
+  void* alloc_ptr = *alloc_iterp;
+  *alloc_iterp += blen;
+  return alloc_ptr;
+}
+
+typedef struct BenchBufsStruct {
+  NONCOPYABLE(BenchBufsStruct);
+  uint32_t sample_ct;
+  uint32_t variant_ct;
+  uint32_t iter_ct;
+
+  // generator/writer side
+  uintptr_t* genovec;
+  uintptr_t* patch_01_set;
+  AlleleCode* patch_01_vals;
+  uintptr_t* patch_10_set;
+  AlleleCode* patch_10_vals;
+  uintptr_t* phasepresent;
+  uintptr_t* phaseinfo;
+  uintptr_t* dosage_present;
+  uint16_t* dosage_main;
+  uintptr_t* allele_idx_offsets;
+
+  // reader side
+  uintptr_t* sample_include;
+  uint32_t* sample_include_cumulative_popcounts;
+  uintptr_t* sample_include_interleaved_vec;
+  uintptr_t* missingness;
+  PgenVariant pgv;
+} BenchBufs;
+
+// Fills in one variant's worth of synthetic data, and appends it.  Returns
+// the time spent inside the writer.
+static double GenerateVariant(BenchProfile profile, uint32_t vidx, uint64_t* state_ptr, BenchBufs* bufsp, STPgenWriter* spgwp, PglErr* reterrp) {
+  const uint32_t sample_ct = bufsp->sample_ct;
+  uintptr_t* genovec = bufsp->genovec;
+  uint32_t patch_01_ct = 0;
+  uint32_t patch_10_ct = 0;
+  uint32_t dosage_ct = 0;
+  if (profile == kBenchProfileSparse) {
+    FillRandomGenovec(kBenchSparseThresholds, sample_ct, state_ptr, genovec);
+  } else if ((profile == kBenchProfileLd) && (vidx % 64)) {
+    // Previous variant with ~1% of genotypes redrawn.
+    const uint32_t redraw_ct = 1 + sample_ct / 100;
+    for (uint32_t uii = 0; uii != redraw_ct; ++uii) {
+      const uint64_t rand64 = Xorshift64(state_ptr);
+      const uint32_t sample_idx = (rand64 & 0xffffffffU) % sample_ct;
+      AssignNyparrEntry(sample_idx, DrawGeno(kBenchDenseThresholds, rand64 >> 48), genovec);
+    }
+  } else if (profile == kBenchProfileMultiallelic) {
+    // Each allele is 0 (p=.6), 1 (p=.25), or 2 (p=.15); 1% missing.
+    const uint32_t sample_ctl = BitCtToWordCt(sample_ct);
+    ZeroWArr(NypCtToWordCt(sample_ct), genovec);
+    ZeroWArr(sample_ctl, bufsp->patch_01_set);
+    ZeroWArr(sample_ctl, bufsp->patch_10_set);
+    AlleleCode* patch_01_vals = bufsp->patch_01_vals;
+    AlleleCode* patch_10_vals = bufsp->patch_10_vals;
+    for (uint32_t sample_idx = 0; sample_idx != sample_ct; ++sample_idx) {
+      const uint64_t rand64 = Xorshift64(state_ptr);
+      if ((rand64 & 65535) < 655) {
+        AssignNyparrEntry(sample_idx, 3, genovec);
+        continue;
+      }
+      const uint32_t r1 = (rand64 >> 16) & 65535;
+      const uint32_t r2 = (rand64 >> 32) & 65535;
+      uint32_t ac1 = (r1 >= 39322) + (r1 >= 55706);
+      uint32_t ac2 = (r2 >= 39322) + (r2 >= 55706);
+      if (ac1 > ac2) {
+        const uint32_t tmp = ac1;
+        ac1 = ac2;
+        ac2 = tmp;
+      }
+      if (!ac2) {
+        continue;
+      }
+      if (!ac1) {
+        AssignNyparrEntry(sample_idx, 1, genovec);
+        if (ac2 == 2) {
+          SetBit(sample_idx, bufsp->patch_01_set);
+          patch_01_vals[patch_01_ct++] = 2;
+        }
+        continue;
+      }
+      AssignNyparrEntry(sample_idx, 2, genovec);
+      if (ac2 == 2) {
+        SetBit(sample_idx, bufsp->patch_10_set);
+        patch_10_vals[2 * patch_10_ct] = ac1;
+        patch_10_vals[2 * patch_10_ct + 1] = 2;
+        ++patch_10_ct;
+      }
+    }
+  } else {
+    FillRandomGenovec(kBenchDenseThresholds, sample_ct, state_ptr, genovec);
+    if (profile == kBenchProfilePhased) {
+      // ~7/8 of hets phased.
+      Halfword* phasepresent_alias = R_CAST(Halfword*, bufsp->phasepresent);
+      const uint32_t word_ct = NypCtToWordCt(sample_ct);
+      for (uint32_t widx = 0; widx != word_ct; ++widx) {
+        phasepresent_alias[widx] = Pack01ToHalfword(genovec[widx]);
+      }
+      if (word_ct % 2) {
+        phasepresent_alias[word_ct] = 0;
+      }
+      uintptr_t* phasepresent = bufsp->phasepresent;
+      uintptr_t* phaseinfo = bufsp->phaseinfo;
+      const uint32_t sample_ctl = BitCtToWordCt(sample_ct);
+      for (uint32_t widx = 0; widx != sample_ctl; ++widx) {
+        const uintptr_t rand1 = Xorshift64(state_ptr);
+        const uintptr_t rand2 = Xorshift64(state_ptr);
+        phasepresent[widx] &= ~(rand1 & (rand1 >> 1) & rand2);
+        phaseinfo[widx] = phasepresent[widx] & (rand2 >> 2);
+      }
+    } else if (profile == kBenchProfileDosage) {
+      // ~10% of samples get a dosage instead of a hardcall.
+      ZeroWArr(BitCtToWordCt(sample_ct), bufsp->dosage_present);
+      uint16_t* dosage_main = bufsp->dosage_main;
+      for (uint32_t sample_idx = 0; sample_idx != sample_ct; ++sample_idx) {
+        const uint64_t rand64 = Xorshift64(state_ptr);
+        if ((rand64 & 65535) < 6554) {
+          SetBit(sample_idx, bufsp->dosage_present);
+          AssignNyparrEntry(sample_idx, 3, genovec);
+          dosage_main[dosage_ct++] = ((rand64 >> 16) & 65535) % 32769;
+        }
+      }
+    }
+  }
+  const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+  PglErr reterr;
+  if (profile == kBenchProfileMultiallelic) {
+    reterr = SpgwAppendMultiallelicSparse(genovec, bufsp->patch_01_set, bufsp->patch_01_vals, bufsp->patch_10_set, bufsp->patch_10_vals, patch_01_ct, patch_10_ct, spgwp);
+  } else if (profile == kBenchProfilePhased) {
+    reterr = SpgwAppendBiallelicGenovecHphase(genovec, bufsp->phasepresent, bufsp->phaseinfo, spgwp);
+  } else if (profile == kBenchProfileDosage) {
+    reterr = SpgwAppendBiallelicGenovecDosage16(genovec, bufsp->dosage_present, bufsp->dosage_main, dosage_ct, spgwp);
+  } else {
+    reterr = SpgwAppendBiallelicGenovec(genovec, spgwp);
+  }
+  const std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
+  *reterrp = reterr;
+  return std::chrono::duration<double>(end_time - start_time).count();
+}
+
+static PglErr WriteBenchPgen(const char* fname, BenchProfile profile, BenchBufs* bufsp, double* elapsed_ptr) {
+  const uint32_t variant_ct = bufsp->variant_ct;
+  unsigned char* spgw_alloc = nullptr;
+  STPgenWriter spgw;
+  PreinitSpgw(&spgw);
+  PglErr reterr = kPglRetSuccess;
+  {
+    PgenGlobalFlags gflags = kfPgenGlobal0;
+    if (profile == kBenchProfilePhased) {
+      gflags = kfPgenGlobalHardcallPhasePresent;
+    } else if (profile == kBenchProfileDosage) {
+      gflags = kfPgenGlobalDosagePresent;
+    }
+    const uintptr_t* allele_idx_offsets = (profile == kBenchProfileMultiallelic)? bufsp->allele_idx_offsets : nullptr;
+    uintptr_t alloc_cacheline_ct;
+    uint32_t max_vrec_len;
+    reterr = SpgwInitPhase1(fname, allele_idx_offsets, nullptr, variant_ct, bufsp->sample_ct, gflags, 1, &spgw, &alloc_cacheline_ct, &max_vrec_len);
+    if (reterr) {
+      if (reterr == kPglRetOpenFail) {
+        fprintf(stderr, "Error: Failed to open %s.\n", fname);
+      }
+      goto WriteBenchPgen_ret_1;
+    }
+    if (cachealigned_malloc(alloc_cacheline_ct * kCacheline, &spgw_alloc)) {
+      goto WriteBenchPgen_ret_NOMEM;
+    }
+    SpgwInitPhase2(max_vrec_len, &spgw, spgw_alloc);
+    uint64_t rng_state = 0x9e3779b97f4a7c15LLU + profile;
+    double elapsed = 0.0;
+    for (uint32_t vidx = 0; vidx != variant_ct; ++vidx) {
+      elapsed += GenerateVariant(profile, vidx, &rng_state, bufsp, &spgw, &reterr);
+      if (reterr) {
+        fprintf(stderr, "Error: %s append failed on variant %u.\n", kBenchWriteOpNames[profile], vidx);
+        goto WriteBenchPgen_ret_1;
+      }
+    }
+    const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    reterr = SpgwFinish(&spgw);
+    if (reterr) {
+      fprintf(stderr, "Error: Failed to finish writing %s.\n", fname);
+      goto WriteBenchPgen_ret_1;
+    }
+    const std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
+    *elapsed_ptr = elapsed + std::chrono::duration<double>(end_time - start_time).count();
+  }
+  while (0) {
+  WriteBenchPgen_ret_NOMEM:
+    fputs("Error: Out of memory.\n", stderr);
+    reterr = kPglRetNomem;
+    break;
+  }
+ WriteBenchPgen_ret_1:
+  CleanupSpgw(&spgw, &reterr);
+  aligned_free_cond(spgw_alloc);
+  return reterr;
+}
+
+static void FillBenchSubset(uint32_t pct, uint64_t* state_ptr, BenchBufs* bufsp, uint32_t* subset_ct_ptr) {
+  const uint32_t sample_ct = bufsp->sample_ct;
+  uintptr_t* sample_include = bufsp->sample_include;
+  const uint32_t sample_ctv = BitCtToVecCt(sample_ct);
+  ZeroWArr(sample_ctv * kWordsPerVec, sample_include);
+  if (pct == 100) {
+    SetAllBits(sample_ct, sample_include);
+  } else {
+    const uint32_t threshold = (65536 * pct) / 100;
+    for (uint32_t sample_idx = 0; sample_idx != sample_ct; ++sample_idx) {
+      if (RandU16(state_ptr) < threshold) {
+        SetBit(sample_idx, sample_include);
+      }
+    }
+    if (AllWordsAreZero(sample_include, BitCtToWordCt(sample_ct))) {
+      SetBit(0, sample_include);
+    }
+  }
+  FillCumulativePopcounts(sample_include, 1 + (sample_ct / kBitsPerWord), bufsp->sample_include_cumulative_popcounts);
+  FillInterleavedMaskVec(sample_include, sample_ctv, bufsp->sample_include_interleaved_vec);
+  *subset_ct_ptr = PopcountWords(sample_include, BitCtToWordCt(sample_ct));
+}
+
+// Returns elapsed time in seconds.
+static double RunReadBench(BenchOp op, uint32_t subset_ct, PgrSampleSubsetIndex pssi, BenchBufs* bufsp, PgenReader* pgrp, PglErr* reterrp) {
+  const uint32_t variant_ct = bufsp->variant_ct;
+  const uintptr_t* sample_include = bufsp->sample_include;
+  PgenVariant* pgvp = &bufsp->pgv;
+  PglErr reterr = kPglRetSuccess;
+  const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+  for (uint32_t vidx = 0; vidx != variant_ct; ++vidx) {
+    if (op == kBenchOpGet) {
+      reterr = PgrGet(sample_include, pssi, subset_ct, vidx, pgrp, pgvp->genovec);
+    } else if (op == kBenchOpGetCounts) {
+      STD_ARRAY_DECL(uint32_t, 4, genocounts);
+      reterr = PgrGetCounts(sample_include, bufsp->sample_include_interleaved_vec, pssi, subset_ct, vidx, pgrp, genocounts);
+    } else if (op == kBenchOpGetDp) {
+      reterr = PgrGetDp(sample_include, pssi, subset_ct, vidx, pgrp, pgvp);
+    } else {
+      reterr = PgrGetMissingness(sample_include, pssi, subset_ct, vidx, pgrp, bufsp->missingness, pgvp->genovec);
+    }
+    if (reterr) {
+      break;
+    }
+  }
+  const std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
+  *reterrp = reterr;
+  return std::chrono::duration<double>(end_time - start_time).count();
+}
+
+static void PrintBenchRow(const char* profile_name, const char* op_name, uint32_t subset_pct, uint32_t variant_ct, uint64_t byte_ct, double elapsed) {
+  // Guard against a zero-resolution clock on tiny inputs.
+  if (elapsed < 1e-9) {
+    elapsed = 1e-9;
+  }
+  printf("%s\t%s\t%u\t%u\t%" PRIu64 "\t%.6f\t%.1f\t%.4f\n", profile_name, op_name, subset_pct, variant_ct, byte_ct, elapsed, variant_ct / elapsed, S_CAST(double, byte_ct) / (elapsed * 1e9));
+}
+
+// Also validates the file, and reports the write timing (since record sizes
+// aren't known before the index is loaded).
+static PglErr ReadBenchPgen(const char* fname, BenchProfile profile, double write_elapsed, BenchBufs* bufsp) {
+  const uint32_t variant_ct = bufsp->variant_ct;
+  unsigned char* pgfi_alloc = nullptr;
+  unsigned char* pgr_alloc = nullptr;
+  PgenFileInfo pgfi;
+  PgenReader pgr;
+  PreinitPgfi(&pgfi);
+  PreinitPgr(&pgr);
+  PglErr reterr = kPglRetSuccess;
+  {
+    char errstr_buf[kPglErrstrBufBlen];
+    PgenHeaderCtrl header_ctrl;
+    uintptr_t cur_alloc_cacheline_ct;
+    reterr = PgfiInitPhase1(fname, variant_ct, bufsp->sample_ct, 0, &header_ctrl, &pgfi, &cur_alloc_cacheline_ct, errstr_buf);
+    if (reterr) {
+      fputs(errstr_buf, stderr);
+      goto ReadBenchPgen_ret_1;
+    }
+    if (cachealigned_malloc(cur_alloc_cacheline_ct * kCacheline, &pgfi_alloc)) {
+      goto ReadBenchPgen_ret_NOMEM;
+    }
+    const uint32_t allele_cts_already_loaded = (profile == kBenchProfileMultiallelic);
+    if (allele_cts_already_loaded) {
+      pgfi.allele_idx_offsets = bufsp->allele_idx_offsets;
+      pgfi.max_allele_ct = 3;
+    }
+    uint32_t max_vrec_width;
+    reterr = PgfiInitPhase2(header_ctrl, allele_cts_already_loaded, 0, 0, 0, variant_ct, &max_vrec_width, &pgfi, pgfi_alloc, &cur_alloc_cacheline_ct, errstr_buf);
+    if (reterr) {
+      fputs(errstr_buf, stderr);
+      goto ReadBenchPgen_ret_1;
+    }
+    if (cachealigned_malloc(cur_alloc_cacheline_ct * kCacheline, &pgr_alloc)) {
+      goto ReadBenchPgen_ret_NOMEM;
+    }
+    reterr = PgrInit(fname, max_vrec_width, &pgfi, &pgr, pgr_alloc);
+    if (reterr) {
+      fprintf(stderr, "Error: Failed to open %s.\n", fname);
+      goto ReadBenchPgen_ret_1;
+    }
+    reterr = PgrValidate(&pgr, bufsp->pgv.genovec, errstr_buf);
+    if (reterr) {
+      fputs(errstr_buf, stderr);
+      goto ReadBenchPgen_ret_1;
+    }
+    const uint64_t record_byte_ct = GetPgfiFpos(&pgfi, variant_ct) - GetPgfiFpos(&pgfi, 0);
+    PrintBenchRow(kBenchProfileNames[profile], kBenchWriteOpNames[profile], 100, variant_ct, record_byte_ct, write_elapsed);
+    uint64_t rng_state = 0x2545f4914f6cdd1dLLU;
+    for (uint32_t subset_idx = 0; subset_idx != kBenchSubsetCt; ++subset_idx) {
+      const uint32_t subset_pct = kBenchSubsetPcts[subset_idx];
+      uint32_t subset_ct;
+      FillBenchSubset(subset_pct, &rng_state, bufsp, &subset_ct);
+      PgrSampleSubsetIndex pssi;
+      PgrSetSampleSubsetIndex(bufsp->sample_include_cumulative_popcounts, &pgr, &pssi);
+      for (uint32_t op_idx = 0; op_idx != kBenchOpCt; ++op_idx) {
+        const BenchOp op = S_CAST(BenchOp, op_idx);
+        double best_elapsed = 0.0;
+        for (uint32_t iter_idx = 0; iter_idx != bufsp->iter_ct; ++iter_idx) {
+          const double elapsed = RunReadBench(op, subset_ct, pssi, bufsp, &pgr, &reterr);
+          if (reterr) {
+            fprintf(stderr, "Error: %s failed on %s.\n", kBenchOpNames[op], fname);
+            goto ReadBenchPgen_ret_1;
+          }
+          if ((!iter_idx) || (elapsed < best_elapsed)) {
+            best_elapsed = elapsed;
+          }
+        }
+        PrintBenchRow(kBenchProfileNames[profile], kBenchOpNames[op], subset_pct, variant_ct, record_byte_ct, best_elapsed);
+      }
+    }
+  }
+  while (0) {
+  ReadBenchPgen_ret_NOMEM:
+    fputs("Error: Out of memory.\n", stderr);
+    reterr = kPglRetNomem;
+    break;
+  }
+ ReadBenchPgen_ret_1:
+  CleanupPgr(&pgr, &reterr);
+  if (pgfi.allele_idx_offsets == bufsp->allele_idx_offsets) {
+    // owned by bufs
+    pgfi.allele_idx_offsets = nullptr;
+  }
+  CleanupPgfi(&pgfi, &reterr);
+  aligned_free_cond(pgfi_alloc);
+  aligned_free_cond(pgr_alloc);
+  return reterr;
+}
+
+}  // namespace plink2
+
+int32_t main(int32_t argc, char** argv) {
+#ifdef __cplusplus
+  using namespace plink2;
+#endif
+  PglErr reterr = kPglRetSuccess;
+  unsigned char* bench_alloc = nullptr;
+  char* fname = nullptr;
+  BenchBufs bufs;
+  {
+    if ((argc < 4) || (argc > 5)) {
+      fputs(
+"Usage:\n"
+"pgenlib_bench [scratch prefix] [sample ct] [variant ct] {pass ct}\n"
+"Writes <scratch prefix>.<profile>.pgen for each of the dense, sparse, ld,\n"
+"multiallelic, phased, and dosage profiles, reads each back under several\n"
+"sample-subset densities, and reports encode/decode throughput as a\n"
+"tab-delimited table.  The scratch files are deleted on exit.  pass ct\n"
+"defaults to 3.\n"
+            , stdout);
+      reterr = kPglRetSkipped;
+      goto main_ret_1;
+    }
+    uint32_t sample_ct;
+    uint32_t variant_ct;
+    uint32_t iter_ct = 3;
+    if (ScanPosintDefcap(argv[2], &sample_ct) || (sample_ct > (1U << 24)) || ScanPosintDefcap(argv[3], &variant_ct) || (variant_ct > (1U << 28)) || ((argc == 5) && ScanPosintDefcap(argv[4], &iter_ct))) {
+      fputs("Error: Invalid pgenlib_bench parameter.\n", stderr);
+      reterr = kPglRetInvalidCmdline;
+      goto main_ret_1;
+    }
+    const uint32_t prefix_slen = strlen(argv[1]);
+    if (prefix_slen > kPglFnamesize - 32) {
+      fputs("Error: pgenlib_bench scratch prefix too long.\n", stderr);
+      reterr = kPglRetInvalidCmdline;
+      goto main_ret_1;
+    }
+    bufs.sample_ct = sample_ct;
+    bufs.variant_ct = variant_ct;
+    bufs.iter_ct = iter_ct;
+
+    // Carve all fixed-size buffers out of a single allocation.
+    const uintptr_t genovec_blen = NypCtToVecCt(sample_ct) * kBytesPerVec;
+    const uintptr_t bitarr_blen = BitCtToVecCt(sample_ct) * kBytesPerVec;
+    const uintptr_t allele_code_blen = RoundUpPow2(2 * sample_ct * sizeof(AlleleCode), kBytesPerVec);
+    const uintptr_t dosage_blen = RoundUpPow2(sample_ct * sizeof(int16_t), kBytesPerVec);
+    const uintptr_t cumulative_popcounts_blen = RoundUpPow2((1 + (sample_ct / kBitsPerWord)) * sizeof(int32_t), kBytesPerVec);
+    const uintptr_t allele_idx_offsets_blen = RoundUpPow2((S_CAST(uintptr_t, variant_ct) + 1) * sizeof(intptr_t), kBytesPerVec);
+    const uintptr_t total_blen = 2 * genovec_blen + 12 * bitarr_blen + 2 * allele_code_blen + 3 * dosage_blen + cumulative_popcounts_blen + allele_idx_offsets_blen + kPglFnamesize;
+    if (cachealigned_malloc(total_blen, &bench_alloc)) {
+      goto main_ret_NOMEM;
+    }
+    unsigned char* alloc_iter = bench_alloc;
+    bufs.genovec = S_CAST(uintptr_t*, BenchAllocRaw(genovec_blen, &alloc_iter));
+    bufs.patch_01_set = S_CAST(uintptr_t*, BenchAllocRaw(bitarr_blen, &alloc_iter));
+    bufs.patch_01_vals = S_CAST(AlleleCode*, BenchAllocRaw(allele_code_blen, &alloc_iter));
+    bufs.patch_10_set = S_CAST(uintptr_t*, BenchAllocRaw(bitarr_blen, &alloc_iter));
+    bufs.patch_10_vals = S_CAST(AlleleCode*, BenchAllocRaw(allele_code_blen, &alloc_iter));
+    bufs.phasepresent = S_CAST(uintptr_t*, BenchAllocRaw(bitarr_blen, &alloc_iter));
+    bufs.phaseinfo = S_CAST(uintptr_t*, BenchAllocRaw(bitarr_blen, &alloc_iter));
+    bufs.dosage_present = S_CAST(uintptr_t*, BenchAllocRaw(bitarr_blen, &alloc_iter));
+    bufs.dosage_main = S_CAST(uint16_t*, BenchAllocRaw(dosage_blen, &alloc_iter));
+    bufs.allele_idx_offsets = S_CAST(uintptr_t*, BenchAllocRaw(allele_idx_offsets_blen, &alloc_iter));
+    bufs.sample_include = S_CAST(uintptr_t*, BenchAllocRaw(bitarr_blen, &alloc_iter));
+    bufs.sample_include_cumulative_popcounts = S_CAST(uint32_t*, BenchAllocRaw(cumulative_popcounts_blen, &alloc_iter));
+    bufs.sample_include_interleaved_vec = S_CAST(uintptr_t*, BenchAllocRaw(bitarr_blen, &alloc_iter));
+    bufs.missingness = S_CAST(uintptr_t*, BenchAllocRaw(bitarr_blen, &alloc_iter));
+    PreinitPgv(&bufs.pgv);
+    bufs.pgv.genovec = S_CAST(uintptr_t*, BenchAllocRaw(genovec_blen, &alloc_iter));
+    bufs.pgv.phasepresent = S_CAST(uintptr_t*, BenchAllocRaw(bitarr_blen, &alloc_iter));
+    bufs.pgv.phaseinfo = S_CAST(uintptr_t*, BenchAllocRaw(bitarr_blen, &alloc_iter));
+    bufs.pgv.dosage_present = S_CAST(uintptr_t*, BenchAllocRaw(bitarr_blen, &alloc_iter));
+    bufs.pgv.dosage_main = S_CAST(uint16_t*, BenchAllocRaw(dosage_blen, &alloc_iter));
+    bufs.pgv.dphase_present = S_CAST(uintptr_t*, BenchAllocRaw(bitarr_blen, &alloc_iter));
+    bufs.pgv.dphase_delta = S_CAST(int16_t*, BenchAllocRaw(dosage_blen, &alloc_iter));
+    fname = S_CAST(char*, BenchAllocRaw(kPglFnamesize, &alloc_iter));
+    for (uintptr_t vidx = 0; vidx <= variant_ct; ++vidx) {
+      bufs.allele_idx_offsets[vidx] = 3 * vidx;
+    }
+
+    printf("# pgenlib_bench: %u samples, %u variants, best of %u pass%s\n", sample_ct, variant_ct, iter_ct, (iter_ct == 1)? "" : "es");
+    printf("#PROFILE\tOP\tSUBSET_PCT\tVARIANT_CT\tRECORD_BYTES\tSECONDS\tVARIANTS_PER_S\tGB_PER_S\n");
+    char* fname_suffix = memcpya(fname, argv[1], prefix_slen);
+    *fname_suffix++ = '.';
+    for (uint32_t profile_idx = 0; profile_idx != kBenchProfileCt; ++profile_idx) {
+      const BenchProfile profile = S_CAST(BenchProfile, profile_idx);
+      snprintf(fname_suffix, 32, "%s.pgen", kBenchProfileNames[profile]);
+      double write_elapsed = 0.0;
+      reterr = WriteBenchPgen(fname, profile, &bufs, &write_elapsed);
+      if (reterr) {
+        remove(fname);
+        goto main_ret_1;
+      }
+      reterr = ReadBenchPgen(fname, profile, write_elapsed, &bufs);
+      remove(fname);
+      if (reterr) {
+        goto main_ret_1;
+      }
+      fflush(stdout);
+    }
+  }
+  while (0) {
+  main_ret_NOMEM:
+    fputs("Error: Out of memory.\n", stderr);
+    reterr = kPglRetNomem;
+    break;
+  }
+ main_ret_1:
+  aligned_free_cond(bench_alloc);
+  return S_CAST(int32_t, reterr);
+}
@@ -30,6 +30,7 @@
 #include "plink2_pvar.h"
 #include "plink2_random.h"
 #include "plink2_set.h"
+#include "plink2_simd.h"
 
 #include <time.h>  // time()
 #include <unistd.h>  // unlink()
@@ -292,6 +293,7 @@ typedef struct Plink2CmdlineStruct {
 
   Command1Flags command_flags1;
   PvarPsamFlags pvar_psam_flags;
+  ValidateFlags validate_flags;
   SortFlags sample_sort_flags;
   SortFlags sort_vars_flags;
   GrmFlags grm_flags;
@@ -378,6 +380,11 @@ typedef struct Plink2CmdlineStruct {
   uint32_t filter_min_allele_ct;
   uint32_t filter_max_allele_ct;
   uint32_t bed_border_bp;
+  uint32_t pfile_list_vzs;
+  uint32_t king_prefilter_variant_ct;
+  uint32_t king_prefilter_max_carrier_ct;
+  uint32_t king_prefilter_min_shared_ct;
+  uint32_t decode_cache_mib;
 
   char* var_filter_exceptions_flattened;
   char* varid_template_str;
@@ -390,6 +397,7 @@ typedef struct Plink2CmdlineStruct {
   char* varid_exclude_snp;
   char* pheno_fname;
   char* covar_fname;
+  char* pfile_list_fname;
   char* extract_fnames;
   char* extract_intersect_fnames;
   char* exclude_fnames;
@@ -422,6 +430,7 @@ typedef struct Plink2CmdlineStruct {
   char* loop_cats_phenoname;
   char* fa_fname;
   char* king_table_subset_fname;
+  char* king_cutoff_table_fname;
   char* require_info_flattened;
   char* require_no_info_flattened;
   char* keep_col_match_fname;
@@ -439,8 +448,8 @@ typedef struct Plink2CmdlineStruct {
 } Plink2Cmdline;
 
 // er, probably time to just always initialize this...
-uint32_t SingleVariantLoaderIsNeeded(const char* king_cutoff_fprefix, Command1Flags command_flags1, MakePlink2Flags make_plink2_flags, RmDupMode rmdup_mode, double hwe_thresh) {
-  return (command_flags1 & (kfCommand1Exportf | kfCommand1MakeKing | kfCommand1GenoCounts | kfCommand1LdPrune | kfCommand1Validate | kfCommand1Pca | kfCommand1MakeRel | kfCommand1Glm | kfCommand1Score | kfCommand1Ld | kfCommand1Hardy | kfCommand1Sdiff)) || ((command_flags1 & kfCommand1MakePlink2) && (make_plink2_flags & kfMakePgen)) || ((command_flags1 & kfCommand1KingCutoff) && (!king_cutoff_fprefix)) || (rmdup_mode != kRmDup0) || (hwe_thresh != 0.0);
+uint32_t SingleVariantLoaderIsNeeded(uint32_t king_cutoff_precomputed, Command1Flags command_flags1, MakePlink2Flags make_plink2_flags, RmDupMode rmdup_mode, double hwe_thresh) {
+  return (command_flags1 & (kfCommand1Exportf | kfCommand1MakeKing | kfCommand1GenoCounts | kfCommand1LdPrune | kfCommand1Validate | kfCommand1Pca | kfCommand1MakeRel | kfCommand1Glm | kfCommand1Score | kfCommand1Ld | kfCommand1Hardy | kfCommand1Sdiff)) || ((command_flags1 & kfCommand1MakePlink2) && (make_plink2_flags & kfMakePgen)) || ((command_flags1 & kfCommand1KingCutoff) && (!king_cutoff_precomputed)) || (rmdup_mode != kRmDup0) || (hwe_thresh != 0.0);
 }
 
 
@@ -516,6 +525,16 @@ uint32_t VariantMissingDosageCtsAreNeeded(Command1Flags command_flags1, MiscFlag
   return ((command_flags1 & kfCommand1GenotypingRate) && (misc_flags & kfMiscGenotypingRateDosage)) || ((command_flags1 & kfCommand1MissingReport) && (!(missing_rpt_flags & kfMissingRptSampleOnly)) && (missing_rpt_flags & (kfMissingRptVcolNmissDosage | kfMissingRptVcolFmissDosage))) || ((geno_thresh != 1.0) && (misc_flags & kfMiscGenoDosage));
 }
 
+// The --missing sample report's counts normally require their own pass over
+// the .pgen, since --mind must be applied before anything else looks at the
+// genotypes.  Without --mind (or --loop-cats, which reruns the later passes
+// per category), they can instead be collected during the
+// LoadAlleleAndGenoCounts() pass, provided that pass is guaranteed to happen
+// with the same variant set; variant-missingness counts force this.
+uint32_t SampleMissingCtsAreFusable(Command1Flags command_flags1, MiscFlags misc_flags, double geno_thresh, double mind_thresh, MissingRptFlags missing_rpt_flags, const char* loop_cats_phenoname) {
+  return (mind_thresh == 1.0) && (!loop_cats_phenoname) && (VariantMissingHcCtsAreNeeded(command_flags1, misc_flags, geno_thresh, missing_rpt_flags) || VariantMissingDosageCtsAreNeeded(command_flags1, misc_flags, geno_thresh, missing_rpt_flags));
+}
+
 // can simplify --geno-counts all-biallelic case, but let's first make sure the
 // general case works for multiallelic variants
 uint32_t RawGenoCtsAreNeeded(Command1Flags command_flags1, MiscFlags misc_flags, double hwe_thresh) {
@@ -689,12 +708,46 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
   PglErr reterr = kPglRetSuccess;
   PgenFileInfo pgfi;
   PgenReader simple_pgr;
+  XidIndex xid_index;
   PreinitPgfi(&pgfi);
   PreinitPgr(&simple_pgr);
+  PreinitXidIndex(&xid_index);
   {
+    uint32_t pfile_member_ct = 0;
+    const char** pgen_member_fnames = nullptr;
+    const char** pvar_member_fnames = nullptr;
+    if (pcp->pfile_list_fname) {
+      reterr = LoadPfileList(pcp->pfile_list_fname, pcp->pfile_list_vzs, psamname, pvarname, &pfile_member_ct, &pgen_member_fnames, &pvar_member_fnames);
+      if (unlikely(reterr)) {
+        goto Plink2Core_ret_1;
+      }
+      logprintfww("--pfile-list: %u filesets listed in %s.\n", pfile_member_ct, pcp->pfile_list_fname);
+      if ((make_plink2_flags & (kfMakeBed | kfMakePgen)) || (pcp->exportf_info.flags & kfExportfIndMajorBed)) {
+        // Renaming inputs isn't an option here, so just refuse to clobber
+        // them.
+        for (uint32_t member_idx = 0; member_idx != pfile_member_ct; ++member_idx) {
+          const char* member_pgenname = pgen_member_fnames[member_idx];
+#ifdef _WIN32
+          const uint32_t fname_slen = GetFullPathName(member_pgenname, kPglFnamesize, g_textbuf, nullptr);
+          if (unlikely((!fname_slen) || (fname_slen > kPglFnamesize)))
+#else
+          if (unlikely(!realpath(member_pgenname, g_textbuf)))
+#endif
+          {
+            logerrprintfww(kErrprintfFopen, member_pgenname, strerror(errno));
+            goto Plink2Core_ret_OPEN_FAIL;
+          }
+          snprintf(outname_end, kMaxOutfnameExtBlen, ".pgen");
+          if (unlikely(RealpathIdentical(outname, g_textbuf, &(g_textbuf[kPglFnamesize + 64])))) {
+            logerrprintfww("Error: --out prefix matches --pfile-list member %s.\n", member_pgenname);
+            goto Plink2Core_ret_INCONSISTENT_INPUT;
+          }
+        }
+      }
+    }
     // this predicate will need to exclude --merge-list special case later
     uint32_t pvar_renamed = 0;
-    if ((make_plink2_flags & (kfMakeBed | kfMakePgen)) || (pcp->exportf_info.flags & kfExportfIndMajorBed)) {
+    if ((!pfile_member_ct) && ((make_plink2_flags & (kfMakeBed | kfMakePgen)) || (pcp->exportf_info.flags & kfExportfIndMajorBed))) {
       uint32_t fname_slen;
 #ifdef _WIN32
       fname_slen = GetFullPathName(pgenname, kPglFnamesize, g_textbuf, nullptr);
@@ -822,6 +875,15 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
         const uint32_t unknown_sex_ct = sample_ct - known_sex_ct;
         logprintfww("%u sample%s (%u female%s, %u male%s, %u ambiguous; %u founder%s) loaded from %s.\n", sample_ct, (sample_ct == 1)? "" : "s", female_ct, (female_ct == 1)? "" : "s", male_ct, (male_ct == 1)? "" : "s", unknown_sex_ct, founder_ct, (founder_ct == 1)? "" : "s", psamname);
       }
+      if (pcp->misc_flags & kfMiscSampleIdIndex) {
+        reterr = XidIndexLoadOrCreate(psamname, &pii.sii, raw_sample_ct, pcp->max_thread_ct, &xid_index);
+        if (reterr) {
+          if (unlikely(reterr != kPglRetSkipped)) {
+            goto Plink2Core_ret_1;
+          }
+          reterr = kPglRetSuccess;
+        }
+      }
     }
 
     uint32_t max_variant_id_slen = 1;
@@ -864,7 +926,7 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
       const uint32_t xheader_needed = (pcp->exportf_info.flags & (kfExportfVcf | kfExportfBcf))? 1 : 0;
       const uint32_t qualfilter_needed = xheader_needed || ((pcp->rmdup_mode != kRmDup0) && (pcp->rmdup_mode <= kRmDupExcludeMismatch));
 
-      reterr = LoadPvar(pvarname, pcp->var_filter_exceptions_flattened, pcp->varid_template_str, pcp->varid_multi_template_str, pcp->varid_multi_nonsnp_template_str, pcp->missing_varid_match, pcp->require_info_flattened, pcp->require_no_info_flattened, &(pcp->extract_if_info_expr), &(pcp->exclude_if_info_expr), pcp->misc_flags, pcp->pvar_psam_flags, xheader_needed, qualfilter_needed, pcp->var_min_qual, pcp->splitpar_bound1, pcp->splitpar_bound2, pcp->new_variant_id_max_allele_slen, (pcp->filter_flags / kfFilterSnpsOnly) & 3, !(pcp->dependency_flags & kfFilterNoSplitChr), pcp->filter_min_allele_ct, pcp->filter_max_allele_ct, pcp->max_thread_ct, cip, &max_variant_id_slen, &info_reload_slen, &vpos_sortstatus, &xheader, &variant_include, &variant_bps, &variant_ids_mutable, &allele_idx_offsets, K_CAST(const char***, &allele_storage_mutable), &pvar_qual_present, &pvar_quals, &pvar_filter_present, &pvar_filter_npass, &pvar_filter_storage_mutable, &nonref_flags, &variant_cms, &chr_idxs, &raw_variant_ct, &variant_ct, &max_allele_ct, &max_allele_slen, &xheader_blen, &info_flags, &max_filter_slen);
+      reterr = LoadPvar(pvarname, pfile_member_ct? (&(pvar_member_fnames[1])) : nullptr, pcp->var_filter_exceptions_flattened, pcp->varid_template_str, pcp->varid_multi_template_str, pcp->varid_multi_nonsnp_template_str, pcp->missing_varid_match, pcp->require_info_flattened, pcp->require_no_info_flattened, &(pcp->extract_if_info_expr), &(pcp->exclude_if_info_expr), pcp->misc_flags, pcp->pvar_psam_flags, xheader_needed, qualfilter_needed, pcp->var_min_qual, pcp->splitpar_bound1, pcp->splitpar_bound2, pcp->new_variant_id_max_allele_slen, (pcp->filter_flags / kfFilterSnpsOnly) & 3, !(pcp->dependency_flags & kfFilterNoSplitChr), pcp->filter_min_allele_ct, pcp->filter_max_allele_ct, pcp->max_thread_ct, cip, &max_variant_id_slen, &info_reload_slen, &vpos_sortstatus, &xheader, &variant_include, &variant_bps, &variant_ids_mutable, &allele_idx_offsets, K_CAST(const char***, &allele_storage_mutable), &pvar_qual_present, &pvar_quals, &pvar_filter_present, &pvar_filter_npass, &pvar_filter_storage_mutable, &nonref_flags, &variant_cms, &chr_idxs, &raw_variant_ct, &variant_ct, &max_allele_ct, &max_allele_slen, &xheader_blen, &info_flags, &max_filter_slen);
       if (unlikely(reterr)) {
         goto Plink2Core_ret_1;
       }
@@ -878,10 +940,16 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
         goto Plink2Core_ret_MALFORMED_INPUT;
       }
       pvar_filter_storage = TO_CONSTCPCONSTP(pvar_filter_storage_mutable);
+      const char* variant_src_fname = pfile_member_ct? pcp->pfile_list_fname : pvarname;
       if (variant_ct == raw_variant_ct) {
-        logprintfww("%u variant%s loaded from %s.\n", variant_ct, (variant_ct == 1)? "" : "s", pvarname);
+        logprintfww("%u variant%s loaded from %s.\n", variant_ct, (variant_ct == 1)? "" : "s", variant_src_fname);
       } else {
-        logprintfww("%u out of %u variant%s loaded from %s.\n", variant_ct, raw_variant_ct, (raw_variant_ct == 1)? "" : "s", pvarname);
+        logprintfww("%u out of %u variant%s loaded from %s.\n", variant_ct, raw_variant_ct, (raw_variant_ct == 1)? "" : "s", variant_src_fname);
+      }
+      if (unlikely(pfile_member_ct && info_reload_slen)) {
+        // INFO is reloaded from a single .pvar file.
+        logerrputs("Error: --pfile-list does not currently support commands which need to reload\nthe .pvar INFO column (e.g. --make-pgen, --export vcf).\n");
+        goto Plink2Core_ret_INCONSISTENT_INPUT;
       }
       if (info_reload_slen && (make_plink2_flags & (kfMakeBim | kfMakePvar)) && (!pvar_renamed)) {
         // need to be careful with .pvar in this case
@@ -952,6 +1020,15 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
       PgenHeaderCtrl header_ctrl;
       uintptr_t cur_alloc_cacheline_ct;
       while (1) {
+        if (pfile_member_ct) {
+          reterr = PgfiInitMultiPhase1(pgen_member_fnames, pfile_member_ct, raw_variant_ct, raw_sample_ct, &header_ctrl, &pgfi, &cur_alloc_cacheline_ct, g_logbuf);
+          if (unlikely(reterr)) {
+            WordWrapB(0);
+            logerrputsb();
+            goto Plink2Core_ret_1;
+          }
+          break;
+        }
         reterr = PgfiInitPhase1(pgenname, raw_variant_ct, raw_sample_ct, 0, &header_ctrl, &pgfi, &cur_alloc_cacheline_ct, g_logbuf);
         if (!reterr) {
           break;
@@ -965,7 +1042,7 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
         }
         char* pgenname_end = memcpya(pgenname, outname, outname_end - outname);
         pgenname_end = strcpya_k(pgenname_end, ".pgen");
-        const uint32_t no_vmaj_ext = (pcp->command_flags1 & kfCommand1MakePlink2) && (!pcp->filter_flags) && ((make_plink2_flags & (kfMakePgen | (kfMakePgenFormatBase * 3))) == kfMakePgen);
+        const uint32_t no_vmaj_ext = (pcp->command_flags1 & kfCommand1MakePlink2) && (!pcp->filter_flags) && ((make_plink2_flags & (kfMakePgen | (kfMakePgenFormatBase * 3) | kfMakePgenZstBlocks | kfMakePgenSmajTiles | kfMakePgenDosageDelta)) == kfMakePgen);
         if (no_vmaj_ext) {
           *pgenname_end = '\0';
           make_plink2_flags &= ~kfMakePgen;
@@ -998,7 +1075,11 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
       // only practical effect of setting use_blockload to zero here is that
       // pgr_alloc_cacheline_ct is overestimated by
       // DivUp(max_vrec_width, kCacheline).
-      reterr = PgfiInitPhase2(header_ctrl, 1, nonref_flags_already_loaded, 1, 0, raw_variant_ct, &max_vrec_width, &pgfi, pgfi_alloc, &pgr_alloc_cacheline_ct, g_logbuf);
+      if (pfile_member_ct) {
+        reterr = PgfiInitMultiPhase2(header_ctrl, 1, nonref_flags_already_loaded, 1, &max_vrec_width, &pgfi, pgfi_alloc, &pgr_alloc_cacheline_ct, g_logbuf);
+      } else {
+        reterr = PgfiInitPhase2(header_ctrl, 1, nonref_flags_already_loaded, 1, 0, raw_variant_ct, &max_vrec_width, &pgfi, pgfi_alloc, &pgr_alloc_cacheline_ct, g_logbuf);
+      }
       if (unlikely(reterr)) {
         WordWrapB(0);
         logerrputsb();
@@ -1027,7 +1108,7 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
 
         pgfi.gflags &= ~kfPgenGlobalAllNonref;
       }
-      if (SingleVariantLoaderIsNeeded(king_cutoff_fprefix, pcp->command_flags1, make_plink2_flags, pcp->rmdup_mode, pcp->hwe_thresh)) {
+      if (SingleVariantLoaderIsNeeded(king_cutoff_fprefix || pcp->king_cutoff_table_fname, pcp->command_flags1, make_plink2_flags, pcp->rmdup_mode, pcp->hwe_thresh)) {
         // ugly kludge, probably want to add pgenlib_internal support for this
         // hybrid use pattern
         FILE* shared_ff_copy = pgfi.shared_ff;
@@ -1049,24 +1130,13 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
         pgfi.shared_ff = shared_ff_copy;
         // todo: make this execute after --pmerge
         if (pcp->command_flags1 & kfCommand1Validate) {
-          uintptr_t* genovec_buf;
-          if (unlikely(bigstack_alloc_w(NypCtToWordCt(raw_sample_ct), &genovec_buf))) {
-            goto Plink2Core_ret_NOMEM;
-          }
-          logprintfww5("Validating %s... ", pgenname);
-          fflush(stdout);
-          reterr = PgrValidate(&simple_pgr, genovec_buf, g_logbuf);
+          reterr = ValidatePgen(pgenname, pcp->validate_flags, max_vrec_width, pgr_alloc_cacheline_ct, pcp->max_thread_ct, &pgfi, &simple_pgr);
           if (unlikely(reterr)) {
-            logputs("\n");
-            WordWrapB(0);
-            logerrputsb();
             goto Plink2Core_ret_1;
           }
-          logputs("done.\n");
           if (pcp->command_flags1 == kfCommand1Validate) {
             goto Plink2Core_ret_1;
           }
-          BigstackReset(genovec_buf);
         }
       }
       // any functions using blockload must perform its own PgrInit(), etc.
@@ -1087,7 +1157,7 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
       pgfi.nonref_flags = nonref_flags;
     }
     if (pcp->pheno_fname) {
-      reterr = LoadPhenos(pcp->pheno_fname, &(pcp->pheno_range_list), sample_include, pii.sii.sample_ids, raw_sample_ct, sample_ct, pii.sii.max_sample_id_blen, pcp->missing_pheno, (pcp->misc_flags / kfMiscAffection01) & 1, (pcp->misc_flags / kfMiscPhenoIidOnly) & 1, (pcp->misc_flags / kfMiscPhenoColNums) & 1, pcp->max_thread_ct, &pheno_cols, &pheno_names, &pheno_ct, &max_pheno_name_blen);
+      reterr = LoadPhenos(pcp->pheno_fname, &(pcp->pheno_range_list), sample_include, &pii.sii, &xid_index, raw_sample_ct, sample_ct, pcp->missing_pheno, (pcp->misc_flags / kfMiscAffection01) & 1, (pcp->misc_flags / kfMiscPhenoIidOnly) & 1, (pcp->misc_flags / kfMiscPhenoColNums) & 1, (pcp->misc_flags / kfMiscPhenoCache) & 1, pcp->max_thread_ct, &pheno_cols, &pheno_names, &pheno_ct, &max_pheno_name_blen);
       if (unlikely(reterr)) {
         goto Plink2Core_ret_1;
       }
@@ -1328,6 +1398,7 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
     uint32_t* sample_missing_dosage_cts = nullptr;
     uint32_t* sample_missing_hc_cts = nullptr;
     uint32_t* sample_hethap_cts = nullptr;
+    uint32_t sample_missing_cts_deferred = 0;
     uintptr_t max_covar_name_blen = 0;
     if (psamname[0]) {
       // xid_mode may vary between these operations in a single run, and
@@ -1341,6 +1412,8 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
           if (unlikely(reterr)) {
             goto Plink2Core_ret_1;
           }
+          // index no longer matches the sample IDs
+          CleanupXidIndex(&xid_index);
         }
       } else {
         if (pcp->update_parental_ids_fname) {
@@ -1362,25 +1435,25 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
         }
       }
       if (pcp->keepfam_fnames) {
-        reterr = KeepOrRemove(pcp->keepfam_fnames, &pii.sii, raw_sample_ct, kfKeepFam, sample_include, &sample_ct);
+        reterr = KeepOrRemove(pcp->keepfam_fnames, &pii.sii, &xid_index, raw_sample_ct, kfKeepFam, pcp->max_thread_ct, sample_include, &sample_ct);
         if (unlikely(reterr)) {
           goto Plink2Core_ret_1;
         }
       }
       if (pcp->keep_fnames) {
-        reterr = KeepOrRemove(pcp->keep_fnames, &pii.sii, raw_sample_ct, kfKeep0, sample_include, &sample_ct);
+        reterr = KeepOrRemove(pcp->keep_fnames, &pii.sii, &xid_index, raw_sample_ct, kfKeep0, pcp->max_thread_ct, sample_include, &sample_ct);
         if (unlikely(reterr)) {
           goto Plink2Core_ret_1;
         }
       }
       if (pcp->removefam_fnames) {
-        reterr = KeepOrRemove(pcp->removefam_fnames, &pii.sii, raw_sample_ct, kfKeepRemove | kfKeepFam, sample_include, &sample_ct);
+        reterr = KeepOrRemove(pcp->removefam_fnames, &pii.sii, &xid_index, raw_sample_ct, kfKeepRemove | kfKeepFam, pcp->max_thread_ct, sample_include, &sample_ct);
         if (unlikely(reterr)) {
           goto Plink2Core_ret_1;
         }
       }
       if (pcp->remove_fnames) {
-        reterr = KeepOrRemove(pcp->remove_fnames, &pii.sii, raw_sample_ct, kfKeepRemove, sample_include, &sample_ct);
+        reterr = KeepOrRemove(pcp->remove_fnames, &pii.sii, &xid_index, raw_sample_ct, kfKeepRemove, pcp->max_thread_ct, sample_include, &sample_ct);
         if (unlikely(reterr)) {
           goto Plink2Core_ret_1;
         }
@@ -1455,11 +1528,14 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
             sample_missing_dosage_cts = sample_missing_hc_cts;
           }
         }
-        // could avoid this call and make LoadAlleleAndGenoCounts() do
-        // double duty with --missing?
-        reterr = LoadSampleMissingCts(sex_male, variant_include, cip, raw_variant_ct, variant_ct, raw_sample_ct, pcp->max_thread_ct, pgr_alloc_cacheline_ct, &pgfi, sample_missing_hc_cts, (pgfi.gflags & kfPgenGlobalDosagePresent)? sample_missing_dosage_cts : nullptr, sample_hethap_cts);
-        if (unlikely(reterr)) {
-          goto Plink2Core_ret_1;
+        if (SampleMissingCtsAreFusable(pcp->command_flags1, pcp->misc_flags, pcp->geno_thresh, pcp->mind_thresh, pcp->missing_rpt_flags, pcp->loop_cats_phenoname)) {
+          // filled by LoadAlleleAndGenoCounts() below
+          sample_missing_cts_deferred = 1;
+        } else {
+          reterr = LoadSampleMissingCts(sex_male, variant_include, cip, raw_variant_ct, variant_ct, raw_sample_ct, pcp->max_thread_ct, pgr_alloc_cacheline_ct, &pgfi, sample_missing_hc_cts, (pgfi.gflags & kfPgenGlobalDosagePresent)? sample_missing_dosage_cts : nullptr, sample_hethap_cts);
+          if (unlikely(reterr)) {
+            goto Plink2Core_ret_1;
+          }
         }
         if (pcp->mind_thresh < 1.0) {
           uint32_t variant_ct_y = 0;
@@ -1480,7 +1556,7 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
       }
       if (pcp->covar_fname || pcp->covar_range_list.name_ct) {
         const char* cur_covar_fname = pcp->covar_fname? pcp->covar_fname : (pcp->pheno_fname? pcp->pheno_fname : psamname);
-        reterr = LoadPhenos(cur_covar_fname, &(pcp->covar_range_list), sample_include, pii.sii.sample_ids, raw_sample_ct, sample_ct, pii.sii.max_sample_id_blen, pcp->missing_pheno, 2, (pcp->misc_flags / kfMiscCovarIidOnly) & 1, (pcp->misc_flags / kfMiscCovarColNums) & 1, pcp->max_thread_ct, &covar_cols, &covar_names, &covar_ct, &max_covar_name_blen);
+        reterr = LoadPhenos(cur_covar_fname, &(pcp->covar_range_list), sample_include, &pii.sii, &xid_index, raw_sample_ct, sample_ct, pcp->missing_pheno, 2, (pcp->misc_flags / kfMiscCovarIidOnly) & 1, (pcp->misc_flags / kfMiscCovarColNums) & 1, (pcp->misc_flags / kfMiscPhenoCache) & 1, pcp->max_thread_ct, &covar_cols, &covar_names, &covar_ct, &max_covar_name_blen);
         if (unlikely(reterr)) {
           goto Plink2Core_ret_1;
         }
@@ -1694,6 +1770,16 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
       *outname_end = '.';
     }
     const uintptr_t raw_allele_ct = allele_idx_offsets? allele_idx_offsets[raw_variant_ct] : (2 * raw_variant_ct);
+    // When the counts are simple enough, compute them for all --loop-cats
+    // categories in a single .pgen pass, instead of one pass per category.
+    LoopCatsGenoCounts loop_cats_geno_counts;
+    loop_cats_geno_counts.geno_cts = nullptr;
+    if ((loop_cats_ct > 1) && pgenname[0] && (pcp->command_flags1 & (kfCommand1AlleleFreq | kfCommand1MissingReport | kfCommand1GenoCounts | kfCommand1Hardy)) && (!(make_plink2_flags & kfMakePlink2TrimAlts)) && (!(pcp->freq_rpt_flags & (kfAlleleFreqColMinimac3R2 | kfAlleleFreqColMachR2))) && (pcp->minimac3_r2_max == 0.0) && (pcp->mach_r2_max == 0.0) && LoopCatsGenoCountsAreFusable(variant_include, cip, allele_idx_offsets, &pgfi)) {
+      reterr = LoadLoopCatsGenoCounts(loop_cats_sample_include_backup, loop_cats_founder_info_backup, loop_cats_pheno_col, loop_cats_cat_include, variant_include, raw_sample_ct, loop_cats_sample_ct, loop_cats_ct, raw_variant_ct, variant_ct, pcp->max_thread_ct, pgr_alloc_cacheline_ct, &pgfi, &loop_cats_geno_counts);
+      if (unlikely(reterr)) {
+        goto Plink2Core_ret_1;
+      }
+    }
     unsigned char* bigstack_mark_varfilter = g_bigstack_base;
     unsigned char* bigstack_end_mark_varfilter = g_bigstack_end;
     for (uint32_t loop_cats_idx = 0; loop_cats_idx != loop_cats_ct; ++loop_cats_idx) {
@@ -1951,9 +2037,13 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
           // hardcall-missing-count slot... and it's NOT fine to pass in
           // nullptrs for both missing-count arrays...
           const uint32_t dosageless_file = !(pgfi.gflags & kfPgenGlobalDosagePresent);
-          reterr = LoadAlleleAndGenoCounts(sample_include, founder_info, sex_nm, sex_male, regular_freqcounts_needed? variant_include : variant_afreqcalc, cip, allele_idx_offsets, raw_sample_ct, sample_ct, founder_ct, male_ct, nosex_ct, raw_variant_ct, regular_freqcounts_needed? variant_ct : afreqcalc_variant_ct, first_hap_uidx, is_minimac3_r2, pcp->max_thread_ct, pgr_alloc_cacheline_ct, &pgfi, allele_presents, allele_ddosages, founder_allele_ddosages, ((!variant_missing_hc_cts) && dosageless_file)? variant_missing_dosage_cts : variant_missing_hc_cts, dosageless_file? nullptr : variant_missing_dosage_cts, variant_hethap_cts, raw_geno_cts, founder_raw_geno_cts, x_male_geno_cts, founder_x_male_geno_cts, x_nosex_geno_cts, founder_x_nosex_geno_cts, imp_r2_vals);
-          if (unlikely(reterr)) {
-            goto Plink2Core_ret_1;
+          if (loop_cats_geno_counts.geno_cts) {
+            FillLoopCatGenoCounts(variant_include, regular_freqcounts_needed? variant_include : variant_afreqcalc, &loop_cats_geno_counts, loop_cats_idx, sample_ct, first_hap_uidx, allele_ddosages, founder_allele_ddosages, ((!variant_missing_hc_cts) && dosageless_file)? variant_missing_dosage_cts : variant_missing_hc_cts, dosageless_file? nullptr : variant_missing_dosage_cts, variant_hethap_cts, raw_geno_cts, founder_raw_geno_cts);
+          } else {
+            reterr = LoadAlleleAndGenoCounts(sample_include, founder_info, sex_nm, sex_male, regular_freqcounts_needed? variant_include : variant_afreqcalc, cip, allele_idx_offsets, raw_sample_ct, sample_ct, founder_ct, male_ct, nosex_ct, raw_variant_ct, regular_freqcounts_needed? variant_ct : afreqcalc_variant_ct, first_hap_uidx, is_minimac3_r2, pcp->max_thread_ct, pgr_alloc_cacheline_ct, &pgfi, allele_presents, allele_ddosages, founder_allele_ddosages, ((!variant_missing_hc_cts) && dosageless_file)? variant_missing_dosage_cts : variant_missing_hc_cts, dosageless_file? nullptr : variant_missing_dosage_cts, variant_hethap_cts, raw_geno_cts, founder_raw_geno_cts, x_male_geno_cts, founder_x_male_geno_cts, x_nosex_geno_cts, founder_x_nosex_geno_cts, imp_r2_vals, sample_missing_cts_deferred? sample_missing_hc_cts : nullptr, (sample_missing_cts_deferred && (pgfi.gflags & kfPgenGlobalDosagePresent))? sample_missing_dosage_cts : nullptr, sample_hethap_cts);
+            if (unlikely(reterr)) {
+              goto Plink2Core_ret_1;
+            }
           }
           if (pcp->command_flags1 & kfCommand1GenotypingRate) {
             // possible todo: also report this opportunistically
@@ -2186,18 +2276,19 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
             rel_check = 1;
           }
         }
-        if (pcp->king_table_subset_fname || rel_check) {
-          // command-line parser currently guarantees --king-table-subset and
-          // "--make-king-table rel-check" aren't used with --king-cutoff or
-          // --make-king
-          // probable todo: --king-cutoff-table which can use .kin0 as input
-          reterr = CalcKingTableSubset(sample_include, &pii.sii, variant_include, cip, pcp->king_table_subset_fname, raw_sample_ct, sample_ct, raw_variant_ct, variant_ct, pcp->king_table_filter, pcp->king_table_subset_thresh, rel_check, pcp->king_flags, pcp->parallel_idx, pcp->parallel_tot, pcp->max_thread_ct, &simple_pgr, outname, outname_end);
+        if (pcp->king_table_subset_fname || rel_check || pcp->king_prefilter_variant_ct) {
+          // command-line parser currently guarantees --king-table-subset,
+          // --king-table-prefilter, and "--make-king-table rel-check" aren't
+          // used with --king-cutoff or --make-king
+          reterr = CalcKingTableSubset(sample_include, &pii.sii, variant_include, cip, pcp->king_table_subset_fname, raw_sample_ct, sample_ct, raw_variant_ct, variant_ct, pcp->king_table_filter, pcp->king_table_subset_thresh, rel_check, pcp->king_prefilter_variant_ct, pcp->king_prefilter_max_carrier_ct, pcp->king_prefilter_min_shared_ct, pcp->king_flags, pcp->parallel_idx, pcp->parallel_tot, pcp->max_thread_ct, &simple_pgr, outname, outname_end);
           if (unlikely(reterr)) {
             goto Plink2Core_ret_1;
           }
         } else {
           if (king_cutoff_fprefix) {
             reterr = KingCutoffBatch(&pii.sii, raw_sample_ct, pcp->king_cutoff, sample_include, king_cutoff_fprefix, &sample_ct);
+          } else if (pcp->king_cutoff_table_fname) {
+            reterr = KingCutoffTable(&pii.sii, pcp->king_cutoff_table_fname, raw_sample_ct, pcp->king_cutoff, pcp->max_thread_ct, sample_include, &sample_ct);
           } else {
             reterr = CalcKing(&pii.sii, variant_include, cip, raw_sample_ct, sample_ct, raw_variant_ct, variant_ct, pcp->king_cutoff, pcp->king_table_filter, pcp->king_flags, pcp->parallel_idx, pcp->parallel_tot, pcp->max_thread_ct, pgr_alloc_cacheline_ct, &pgfi, &simple_pgr, sample_include, &sample_ct, outname, outname_end);
           }
@@ -2219,7 +2310,7 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
             }
             BigstackReset(prev_sample_include);
             outname_end[13] = '\0';
-            logprintfww("--king-cutoff: Excluded sample ID%s written to %sout.id , and %u remaining sample ID%s written to %sin.id .\n", (removed_sample_ct == 1)? "" : "s", outname, sample_ct, (sample_ct == 1)? "" : "s", outname);
+            logprintfww("--king-cutoff%s: Excluded sample ID%s written to %sout.id , and %u remaining sample ID%s written to %sin.id .\n", pcp->king_cutoff_table_fname? "-table" : "", (removed_sample_ct == 1)? "" : "s", outname, sample_ct, (sample_ct == 1)? "" : "s", outname);
             UpdateSampleSubsets(sample_include, raw_sample_ct, sample_ct, founder_info, &founder_ct, sex_nm, sex_male, &male_ct, &nosex_ct);
           }
         }
@@ -2527,6 +2618,10 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
         }
 
         if (pcp->command_flags1 & kfCommand1MakePlink2) {
+          if (unlikely((make_plink2_flags & kfMakePgenSmajTiles) && (pcp->hard_call_thresh != UINT32_MAX) && (pgfi.gflags & kfPgenGlobalDosagePresent))) {
+            logerrputs("Error: --make-[b]pgen 'smaj-tiles' cannot currently be used with\n--hard-call-threshold on a dataset with dosages.\n");
+            goto Plink2Core_ret_INVALID_CMDLINE;
+          }
           // todo: unsorted case (--update-chr, etc.)
           if (pcp->sort_vars_flags != kfSort0) {
             reterr = MakePlink2Vsort(sample_include, &pii, sex_nm, sex_male, pheno_cols, pheno_names, new_sample_idx_to_old, variant_include, cip, variant_bps, variant_ids, allele_idx_offsets, allele_storage, allele_presents, refalt1_select, pvar_qual_present, pvar_quals, pvar_filter_present, pvar_filter_npass, pvar_filter_storage, info_reload_slen? pvarname : nullptr, variant_cms, chr_idxs, xheader_blen, info_flags, raw_sample_ct, sample_ct, pheno_ct, max_pheno_name_blen, raw_variant_ct, variant_ct, max_allele_ct, max_allele_slen, max_filter_slen, info_reload_slen, pcp->max_thread_ct, pcp->hard_call_thresh, pcp->dosage_erase_thresh, make_plink2_flags, (pcp->sort_vars_flags == kfSortNatural), pcp->pvar_psam_flags, xheader, &simple_pgr, outname, outname_end);
@@ -2541,6 +2636,12 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
           }
           // no BigstackReset needed here, since allele_presents only needed
           // if 'trim-alts', and later operations are prohibited in that case
+          if (make_plink2_flags & kfMakePgenSmajTiles) {
+            reterr = WriteSmajTiles(sample_include, variant_include, refalt1_select, raw_sample_ct, sample_ct, raw_variant_ct, variant_ct, pcp->max_thread_ct, pgr_alloc_cacheline_ct, &pgfi, outname, outname_end);
+            if (unlikely(reterr)) {
+              goto Plink2Core_ret_1;
+            }
+          }
         }
 
         if (pcp->command_flags1 & kfCommand1Exportf) {
@@ -2586,7 +2687,7 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
       }
 
       if (pcp->command_flags1 & kfCommand1Het) {
-        reterr = HetReport(sample_include, &pii.sii, variant_include, cip, allele_idx_offsets, allele_freqs, founder_info, raw_sample_ct, sample_ct, founder_ct, raw_variant_ct, variant_ct, max_allele_ct, pcp->het_flags, pcp->max_thread_ct, pgr_alloc_cacheline_ct, &pgfi, outname, outname_end);
+        reterr = HetReport(sample_include, &pii.sii, variant_include, cip, allele_idx_offsets, allele_freqs, founder_info, raw_sample_ct, sample_ct, founder_ct, raw_variant_ct, variant_ct, max_allele_ct, pcp->het_flags, pcp->max_thread_ct, pgr_alloc_cacheline_ct, &pgfi, (pcp->misc_flags & kfMiscSmajTiles)? pgenname : nullptr, outname, outname_end);
         if (unlikely(reterr)) {
           goto Plink2Core_ret_1;
         }
@@ -2611,10 +2712,32 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
           logerrputs("Error: --glm + local-pos-cols= requires a sorted .pvar/.bim.  Retry this\ncommand after using --make-pgen/--make-bed + --sort-vars to sort your data.\n");
           goto Plink2Core_ret_INCONSISTENT_INPUT;
         }
-        reterr = GlmMain(sample_include, &pii.sii, sex_nm, sex_male, pheno_cols, pheno_names, covar_cols, covar_names, variant_include, cip, variant_bps, variant_ids, allele_idx_offsets, maj_alleles, allele_storage, &(pcp->glm_info), &(pcp->adjust_info), &(pcp->aperm), pcp->glm_local_covar_fname, pcp->glm_local_pvar_fname, pcp->glm_local_psam_fname, raw_sample_ct, sample_ct, pheno_ct, max_pheno_name_blen, covar_ct, max_covar_name_blen, raw_variant_ct, variant_ct, max_variant_id_slen, max_allele_slen, pcp->xchr_model, pcp->ci_size, pcp->vif_thresh, pcp->ln_pfilter, pcp->output_min_ln, pcp->max_thread_ct, pgr_alloc_cacheline_ct, &pgfi, &simple_pgr, outname, outname_end);
+        // Allocated last, so that earlier commands get the full workspace.
+        PgrDecodeCache dcache;
+        PgrDecodeCache* dcachep = nullptr;
+        if (pcp->decode_cache_mib) {
+          const uint32_t max_dosage_ct = (pgfi.gflags & kfPgenGlobalDosagePresent)? raw_sample_ct : 0;
+          const uintptr_t byte_budget = MINV(pcp->decode_cache_mib * S_CAST(uint64_t, 1048576), bigstack_left() / 2);
+          const uint32_t slot_ct = PgrDecodeCacheMaxSlotCt(raw_variant_ct, raw_sample_ct, max_dosage_ct, byte_budget);
+          if (!slot_ct) {
+            logerrputs("Warning: Insufficient memory for --decode-cache; ignoring it.\n");
+          } else {
+            unsigned char* dcache_alloc;
+            if (unlikely(bigstack_alloc_uc(PgrDecodeCacheCachelineReq(raw_variant_ct, raw_sample_ct, max_dosage_ct, slot_ct) * kCacheline, &dcache_alloc))) {
+              goto Plink2Core_ret_NOMEM;
+            }
+            PgrDecodeCacheInit(raw_variant_ct, raw_sample_ct, max_dosage_ct, slot_ct, dcache_alloc, &dcache);
+            dcachep = &dcache;
+            logprintf("--decode-cache: Room for %u decoded variant%s.\n", slot_ct, (slot_ct == 1)? "" : "s");
+          }
+        }
+        reterr = GlmMain(sample_include, &pii.sii, sex_nm, sex_male, pheno_cols, pheno_names, covar_cols, covar_names, variant_include, cip, variant_bps, variant_ids, allele_idx_offsets, maj_alleles, allele_storage, &(pcp->glm_info), &(pcp->adjust_info), &(pcp->aperm), pcp->glm_local_covar_fname, pcp->glm_local_pvar_fname, pcp->glm_local_psam_fname, raw_sample_ct, sample_ct, pheno_ct, max_pheno_name_blen, covar_ct, max_covar_name_blen, raw_variant_ct, variant_ct, max_variant_id_slen, max_allele_slen, pcp->xchr_model, pcp->ci_size, pcp->vif_thresh, pcp->ln_pfilter, pcp->output_min_ln, pcp->max_thread_ct, pgr_alloc_cacheline_ct, &pgfi, dcachep, &simple_pgr, outname, outname_end);
         if (unlikely(reterr)) {
           goto Plink2Core_ret_1;
         }
+        if (dcachep) {
+          logprintf("--decode-cache: %" PRIu64 " hit%s, %" PRIu64 " miss%s.\n", dcachep->hit_ct, (dcachep->hit_ct == 1)? "" : "s", dcachep->miss_ct, (dcachep->miss_ct == 1)? "" : "es");
+        }
       }
     }
   }
@@ -2639,6 +2762,7 @@ PglErr Plink2Core(const Plink2Cmdline* pcp, MakePlink2Flags make_plink2_flags, c
     break;
   }
  Plink2Core_ret_1:
+  CleanupXidIndex(&xid_index);
   if (loop_cats_pheno_col) {
     // Current implementation requires this to happen before CleanupPhenoCols()
     // on pheno_cols/covar_cols, since loop_cats_pheno_col actually points to
@@ -3139,6 +3263,7 @@ int main(int argc, char** argv) {
   pc.varid_exclude_snp = nullptr;
   pc.pheno_fname = nullptr;
   pc.covar_fname = nullptr;
+  pc.pfile_list_fname = nullptr;
   pc.sample_sort_fname = nullptr;
   pc.keep_fnames = nullptr;
   pc.keepfam_fnames = nullptr;
@@ -3171,6 +3296,7 @@ int main(int argc, char** argv) {
   pc.loop_cats_phenoname = nullptr;
   pc.fa_fname = nullptr;
   pc.king_table_subset_fname = nullptr;
+  pc.king_cutoff_table_fname = nullptr;
   pc.require_info_flattened = nullptr;
   pc.require_no_info_flattened = nullptr;
   pc.keep_col_match_fname = nullptr;
@@ -3486,6 +3612,7 @@ int main(int argc, char** argv) {
     // uint64_t command_flags2 = 0;
     pc.misc_flags = kfMisc0;
     pc.pvar_psam_flags = kfPvarPsam0;
+    pc.validate_flags = kfValidate0;
     pc.sample_sort_flags = kfSort0;
     pc.sort_vars_flags = kfSort0;
     pc.grm_flags = kfGrm0;
@@ -3497,6 +3624,10 @@ int main(int argc, char** argv) {
     pc.king_flags = kfKing0;
     pc.king_cutoff = -1;
     pc.king_table_filter = -DBL_MAX;
+    pc.king_prefilter_variant_ct = 0;
+    pc.king_prefilter_max_carrier_ct = 0;
+    pc.king_prefilter_min_shared_ct = 0;
+    pc.decode_cache_mib = 0;
     pc.freq_rpt_flags = kfAlleleFreq0;
     pc.missing_rpt_flags = kfMissingRpt0;
     pc.geno_counts_flags = kfGenoCounts0;
@@ -3563,6 +3694,7 @@ int main(int argc, char** argv) {
     pc.filter_min_allele_ct = 0;
     pc.filter_max_allele_ct = UINT32_MAX;
     pc.bed_border_bp = 0;
+    pc.pfile_list_vzs = 0;
     double import_dosage_certainty = 0.0;
     int32_t vcf_min_gq = -1;
     int32_t vcf_min_dp = -1;
@@ -3584,6 +3716,7 @@ int main(int argc, char** argv) {
     uint32_t permit_multiple_inclusion_filters = 0;
     uint32_t memory_require = 0;
     uint32_t randmem = 0;
+    uint32_t bcf_subset = 0;
     GenDummyInfo gendummy_info;
     InitGenDummy(&gendummy_info);
     Plink1DosageInfo plink1_dosage_info;
@@ -3998,6 +4131,9 @@ int main(int argc, char** argv) {
           }
           memcpy(pgenname, cur_modif, slen + 1);
           xload = kfXloadBcf;
+        } else if (strequal_k_unsafe(flagname_p2, "cf-subset")) {
+          bcf_subset = 1;
+          goto main_param_zero;
         } else if (strequal_k_unsafe(flagname_p2, "gen")) {
           if (unlikely(load_params || xload)) {
             goto main_ret_INVALID_CMDLINE_INPUT_CONFLICT;
@@ -4356,6 +4492,15 @@ int main(int argc, char** argv) {
         } else if (strequal_k_unsafe(flagname_p2, "ebug")) {
           g_debug_on = 1;
           goto main_param_zero;
+        } else if (strequal_k_unsafe(flagname_p2, "ecode-cache")) {
+          if (unlikely(EnforceParamCtRange(argvk[arg_idx], param_ct, 1, 1))) {
+            goto main_ret_INVALID_CMDLINE_2A;
+          }
+          const char* cur_modif = argvk[arg_idx + 1];
+          if (unlikely(ScanPosintDefcapx(cur_modif, &pc.decode_cache_mib))) {
+            snprintf(g_logbuf, kLogbufSize, "Error: Invalid --decode-cache argument '%s'.\n", cur_modif);
+            goto main_ret_INVALID_CMDLINE_WWA;
+          }
         } else if (strequal_k_unsafe(flagname_p2, "ata")) {
           if (unlikely(load_params || (xload & (~kfXloadOxBgen)))) {
             goto main_ret_INVALID_CMDLINE_INPUT_CONFLICT;
@@ -6046,6 +6191,25 @@ int main(int argc, char** argv) {
             goto main_ret_INVALID_CMDLINE_WWA;
           }
           pc.command_flags1 |= kfCommand1KingCutoff;
+        } else if (strequal_k_unsafe(flagname_p2, "ing-cutoff-table")) {
+          if (unlikely(pc.king_cutoff != -1)) {
+            logerrputs("Error: --king-cutoff-table cannot be used with --king-cutoff.\n");
+            goto main_ret_INVALID_CMDLINE_A;
+          }
+          if (unlikely(EnforceParamCtRange(argvk[arg_idx], param_ct, 2, 2))) {
+            goto main_ret_INVALID_CMDLINE_2A;
+          }
+          reterr = AllocFname(argvk[arg_idx + 1], flagname_p, 0, &pc.king_cutoff_table_fname);
+          if (unlikely(reterr)) {
+            goto main_ret_1;
+          }
+          const char* cur_modif = argvk[arg_idx + 2];
+          if (unlikely((!ScantokDouble(cur_modif, &pc.king_cutoff)) || (pc.king_cutoff < 0.0) || (pc.king_cutoff >= 0.5))) {
+            snprintf(g_logbuf, kLogbufSize, "Error: Invalid --king-cutoff-table threshold '%s'.\n", cur_modif);
+            goto main_ret_INVALID_CMDLINE_WWA;
+          }
+          pc.command_flags1 |= kfCommand1KingCutoff;
+          pc.dependency_flags |= kfFilterPsamReq;
         } else if (strequal_k_unsafe(flagname_p2, "ing-table-filter")) {
           if (unlikely(EnforceParamCtRange(argvk[arg_idx], param_ct, 1, 1))) {
             goto main_ret_INVALID_CMDLINE_2A;
@@ -6055,9 +6219,45 @@ int main(int argc, char** argv) {
             snprintf(g_logbuf, kLogbufSize, "Error: Invalid --king-table-filter argument '%s'.\n", cur_modif);
             goto main_ret_INVALID_CMDLINE_WWA;
           }
+        } else if (strequal_k_unsafe(flagname_p2, "ing-table-prefilter")) {
+          if (unlikely(pc.king_cutoff != -1)) {
+            logerrprintf("Error: --king-table-prefilter cannot be used with --king-cutoff%s.\n", pc.king_cutoff_table_fname? "-table" : "");
+            goto main_ret_INVALID_CMDLINE_A;
+          }
+          if (unlikely(EnforceParamCtRange(argvk[arg_idx], param_ct, 0, 3))) {
+            goto main_ret_INVALID_CMDLINE_2A;
+          }
+          pc.king_prefilter_variant_ct = 20000;
+          pc.king_prefilter_max_carrier_ct = 32;
+          pc.king_prefilter_min_shared_ct = 2;
+          if (param_ct >= 1) {
+            const char* cur_modif = argvk[arg_idx + 1];
+            if (unlikely(ScanPosintDefcapx(cur_modif, &pc.king_prefilter_variant_ct))) {
+              snprintf(g_logbuf, kLogbufSize, "Error: Invalid --king-table-prefilter variant count '%s'.\n", cur_modif);
+              goto main_ret_INVALID_CMDLINE_WWA;
+            }
+            if (param_ct >= 2) {
+              cur_modif = argvk[arg_idx + 2];
+              if (unlikely(ScanPosintCapped(cur_modif, 65535, &pc.king_prefilter_max_carrier_ct) || (pc.king_prefilter_max_carrier_ct < 2))) {
+                snprintf(g_logbuf, kLogbufSize, "Error: Invalid --king-table-prefilter carrier-count limit '%s'.\n", cur_modif);
+                goto main_ret_INVALID_CMDLINE_WWA;
+              }
+              if (param_ct == 3) {
+                cur_modif = argvk[arg_idx + 3];
+                if (unlikely(ScanPosintDefcapx(cur_modif, &pc.king_prefilter_min_shared_ct))) {
+                  snprintf(g_logbuf, kLogbufSize, "Error: Invalid --king-table-prefilter shared-allele threshold '%s'.\n", cur_modif);
+                  goto main_ret_INVALID_CMDLINE_WWA;
+                }
+              }
+            }
+          }
         } else if (strequal_k_unsafe(flagname_p2, "ing-table-subset")) {
           if (unlikely(pc.king_cutoff != -1)) {
-            logerrputs("Error: --king-table-subset cannot be used with --king-cutoff.\n");
+            logerrprintf("Error: --king-table-subset cannot be used with --king-cutoff%s.\n", pc.king_cutoff_table_fname? "-table" : "");
+            goto main_ret_INVALID_CMDLINE_A;
+          }
+          if (unlikely(pc.king_prefilter_variant_ct)) {
+            logerrputs("Error: --king-table-subset cannot be used with --king-table-prefilter.\n");
             goto main_ret_INVALID_CMDLINE_A;
           }
           if (unlikely(EnforceParamCtRange(argvk[arg_idx], param_ct, 1, 2))) {
@@ -6353,7 +6553,7 @@ int main(int argc, char** argv) {
             logerrputs("Error: --make-bpgen cannot be used with --keep-autoconv.\n");
             goto main_ret_INVALID_CMDLINE_A;
           }
-          if (unlikely(EnforceParamCtRange(argvk[arg_idx], param_ct, 0, 7))) {
+          if (unlikely(EnforceParamCtRange(argvk[arg_idx], param_ct, 0, 10))) {
             goto main_ret_INVALID_CMDLINE_2A;
           }
           uint32_t varid_semicolon = 0;
@@ -6420,6 +6620,14 @@ int main(int argc, char** argv) {
               make_plink2_flags |= kfMakePgenEraseDosage;
             } else if (strequal_k(cur_modif, "fill-missing-from-dosage", cur_modif_slen)) {
               make_plink2_flags |= kfMakePgenFillMissingFromDosage;
+            } else if (strequal_k(cur_modif, "pbwt-phase", cur_modif_slen)) {
+              make_plink2_flags |= kfMakePgenPbwtPhase;
+            } else if (strequal_k(cur_modif, "zst-blocks", cur_modif_slen)) {
+              make_plink2_flags |= kfMakePgenZstBlocks;
+            } else if (strequal_k(cur_modif, "smaj-tiles", cur_modif_slen)) {
+              make_plink2_flags |= kfMakePgenSmajTiles;
+            } else if (strequal_k(cur_modif, "dosage-delta", cur_modif_slen)) {
+              make_plink2_flags |= kfMakePgenDosageDelta;
             } else {
               snprintf(g_logbuf, kLogbufSize, "Error: Invalid --make-bpgen argument '%s'.\n", cur_modif);
               goto main_ret_INVALID_CMDLINE_WWA;
@@ -6429,6 +6637,21 @@ int main(int argc, char** argv) {
             logerrputs("Error: --make-bpgen 'trim-alts' and 'erase-alt2+' modifiers cannot be used\ntogether.\n");
             goto main_ret_INVALID_CMDLINE_A;
           }
+          if (make_plink2_flags & kfMakePgenZstBlocks) {
+#ifdef PGENLIB_ZSTD
+            if (unlikely(make_plink2_flags & (kfMakePgenFormatBase * 3))) {
+              logerrputs("Error: --make-bpgen 'zst-blocks' and 'format=' modifiers cannot be used\ntogether.\n");
+              goto main_ret_INVALID_CMDLINE_A;
+            }
+#else
+            logerrputs("Error: --make-bpgen 'zst-blocks' requires a build with zstd .pgen support.\n");
+            goto main_ret_INVALID_CMDLINE_A;
+#endif
+          }
+          if (unlikely((make_plink2_flags & kfMakePgenDosageDelta) && (make_plink2_flags & (kfMakePgenFormatBase * 3)))) {
+            logerrputs("Error: --make-bpgen 'dosage-delta' and 'format=' modifiers cannot be used\ntogether.\n");
+            goto main_ret_INVALID_CMDLINE_A;
+          }
           if (varid_semicolon) {
             if (unlikely((make_plink2_flags & kfMakePlink2VaridDup) || (varid_semicolon & (varid_semicolon - 1)))) {
               logerrputs("Error: --make-bpgen 'varid-split', 'varid-split-dup', 'varid-dup', and\n'varid-join' modifiers are mutually exclusive.\n");
@@ -6471,7 +6694,7 @@ int main(int argc, char** argv) {
             logerrputs("Error: --make-pgen cannot be used with --keep-autoconv.\n");
             goto main_ret_INVALID_CMDLINE_A;
           }
-          if (unlikely(EnforceParamCtRange(argvk[arg_idx], param_ct, 0, 9))) {
+          if (unlikely(EnforceParamCtRange(argvk[arg_idx], param_ct, 0, 12))) {
             goto main_ret_INVALID_CMDLINE_A;
           }
           uint32_t explicit_pvar_cols = 0;
@@ -6553,6 +6776,14 @@ int main(int argc, char** argv) {
               make_plink2_flags |= kfMakePgenEraseDosage;
             } else if (strequal_k(cur_modif, "fill-missing-from-dosage", cur_modif_slen)) {
               make_plink2_flags |= kfMakePgenFillMissingFromDosage;
+            } else if (strequal_k(cur_modif, "pbwt-phase", cur_modif_slen)) {
+              make_plink2_flags |= kfMakePgenPbwtPhase;
+            } else if (strequal_k(cur_modif, "zst-blocks", cur_modif_slen)) {
+              make_plink2_flags |= kfMakePgenZstBlocks;
+            } else if (strequal_k(cur_modif, "smaj-tiles", cur_modif_slen)) {
+              make_plink2_flags |= kfMakePgenSmajTiles;
+            } else if (strequal_k(cur_modif, "dosage-delta", cur_modif_slen)) {
+              make_plink2_flags |= kfMakePgenDosageDelta;
             } else if (likely(StrStartsWith0(cur_modif, "psam-cols=", cur_modif_slen))) {
               if (unlikely(explicit_psam_cols)) {
                 logerrputs("Error: Multiple --make-pgen psam-cols= modifiers.\n");
@@ -6572,6 +6803,21 @@ int main(int argc, char** argv) {
             logerrputs("Error: --make-pgen 'trim-alts' and 'erase-alt2+' modifiers cannot be used\ntogether.\n");
             goto main_ret_INVALID_CMDLINE_A;
           }
+          if (make_plink2_flags & kfMakePgenZstBlocks) {
+#ifdef PGENLIB_ZSTD
+            if (unlikely(make_plink2_flags & (kfMakePgenFormatBase * 3))) {
+              logerrputs("Error: --make-pgen 'zst-blocks' and 'format=' modifiers cannot be used\ntogether.\n");
+              goto main_ret_INVALID_CMDLINE_A;
+            }
+#else
+            logerrputs("Error: --make-pgen 'zst-blocks' requires a build with zstd .pgen support.\n");
+            goto main_ret_INVALID_CMDLINE_A;
+#endif
+          }
+          if (unlikely((make_plink2_flags & kfMakePgenDosageDelta) && (make_plink2_flags & (kfMakePgenFormatBase * 3)))) {
+            logerrputs("Error: --make-pgen 'dosage-delta' and 'format=' modifiers cannot be used\ntogether.\n");
+            goto main_ret_INVALID_CMDLINE_A;
+          }
           if (varid_semicolon) {
             if (unlikely((make_plink2_flags & kfMakePlink2VaridDup) || (varid_semicolon & (varid_semicolon - 1)))) {
               logerrputs("Error: --make-pgen 'varid-split', 'varid-split-dup', 'varid-dup', and\n'varid-join' modifiers are mutually exclusive.\n");
@@ -6704,9 +6950,15 @@ int main(int argc, char** argv) {
           if (unlikely(king_cutoff_fprefix)) {
             logerrputs("Error: --make-king cannot be used with a --king-cutoff input fileset.\n");
             goto main_ret_INVALID_CMDLINE_A;
+          } else if (unlikely(pc.king_cutoff_table_fname)) {
+            logerrputs("Error: --make-king cannot be used with --king-cutoff-table.\n");
+            goto main_ret_INVALID_CMDLINE_A;
           } else if (unlikely(pc.king_table_subset_fname)) {
             logerrputs("Error: --make-king cannot be used with --king-table-subset.\n");
             goto main_ret_INVALID_CMDLINE_A;
+          } else if (unlikely(pc.king_prefilter_variant_ct)) {
+            logerrputs("Error: --make-king cannot be used with --king-table-prefilter.\n");
+            goto main_ret_INVALID_CMDLINE_A;
           }
           if (unlikely(EnforceParamCtRange(argvk[arg_idx], param_ct, 0, 2))) {
             goto main_ret_INVALID_CMDLINE_2A;
@@ -6772,6 +7024,10 @@ int main(int argc, char** argv) {
             logerrputs("Error: --make-king-table cannot be used with a --king-cutoff input fileset.\n");
             goto main_ret_INVALID_CMDLINE_A;
           }
+          if (unlikely(pc.king_cutoff_table_fname)) {
+            logerrputs("Error: --make-king-table cannot be used with --king-cutoff-table.\n");
+            goto main_ret_INVALID_CMDLINE_A;
+          }
           if (unlikely(EnforceParamCtRange(argvk[arg_idx], param_ct, 0, 4))) {
             goto main_ret_INVALID_CMDLINE_2A;
           }
@@ -6784,7 +7040,11 @@ int main(int argc, char** argv) {
               pc.king_flags |= kfKingCounts;
             } else if (strequal_k(cur_modif, "rel-check", cur_modif_slen)) {
               if (unlikely(pc.king_cutoff != -1)) {
-                logerrputs("Error: --make-king-table 'rel-check' modifier cannot be used with\n--king-cutoff.\n");
+                logerrprintf("Error: --make-king-table 'rel-check' modifier cannot be used with\n--king-cutoff%s.\n", pc.king_cutoff_table_fname? "-table" : "");
+                goto main_ret_INVALID_CMDLINE;
+              }
+              if (unlikely(pc.king_prefilter_variant_ct)) {
+                logerrputs("Error: --make-king-table 'rel-check' modifier cannot be used with\n--king-table-prefilter.\n");
                 goto main_ret_INVALID_CMDLINE;
               }
               pc.king_flags |= kfKingRelCheck;
@@ -7779,6 +8039,36 @@ int main(int argc, char** argv) {
             snprintf(pvarname_end, 5, ".zst");
           }
           load_params |= kfLoadParamsPfileAll;
+        } else if (strequal_k_unsafe(flagname_p2, "file-list")) {
+          if (unlikely(load_params || xload)) {
+            goto main_ret_INVALID_CMDLINE_INPUT_CONFLICT;
+          }
+          if (unlikely(EnforceParamCtRange(argvk[arg_idx], param_ct, 1, 2))) {
+            goto main_ret_INVALID_CMDLINE_2A;
+          }
+          uint32_t fname_idx = 1;
+          if (param_ct == 2) {
+            if (unlikely(CheckExtraParam(&(argvk[arg_idx]), "vzs", &fname_idx))) {
+              goto main_ret_INVALID_CMDLINE_A;
+            }
+            pc.pfile_list_vzs = 1;
+          }
+          const char* list_fname = argvk[arg_idx + fname_idx];
+          const uint32_t slen = strlen(list_fname);
+          if (unlikely(slen > (kPglFnamesize - 11))) {
+            logerrputs("Error: --pfile-list argument too long.\n");
+            goto main_ret_OPEN_FAIL;
+          }
+          reterr = AllocFname(list_fname, flagname_p, 0, &pc.pfile_list_fname);
+          if (unlikely(reterr)) {
+            goto main_ret_1;
+          }
+          // Real filenames are filled in by LoadPfileList(); these just need
+          // to be nonempty until then.
+          memcpy(pgenname, list_fname, slen + 1);
+          memcpy(psamname, list_fname, slen + 1);
+          memcpy(pvarname, list_fname, slen + 1);
+          load_params |= kfLoadParamsPfileAll;
         } else if (strequal_k_unsafe(flagname_p2, "gen")) {
           if (unlikely(xload)) {
             goto main_ret_INVALID_CMDLINE_INPUT_CONFLICT;
@@ -7840,6 +8130,9 @@ int main(int argc, char** argv) {
             goto main_ret_1;
           }
           pc.dependency_flags |= kfFilterPsamReq;
+        } else if (strequal_k_unsafe(flagname_p2, "heno-cache")) {
+          pc.misc_flags |= kfMiscPhenoCache;
+          goto main_param_zero;
         } else if (strequal_k_unsafe(flagname_p2, "heno-col-nums")) {
           if (unlikely(!pc.pheno_fname)) {
             logerrputs("Error: --pheno-col-nums must be used with --pheno.\n");
@@ -7870,7 +8163,7 @@ int main(int argc, char** argv) {
             goto main_ret_INVALID_CMDLINE_A;
           }
           if (unlikely((pc.king_cutoff != -1) && (!king_cutoff_fprefix))) {
-            logerrputs("Error: --parallel cannot be used with --king-cutoff.\n");
+            logerrprintf("Error: --parallel cannot be used with --king-cutoff%s.\n", pc.king_cutoff_table_fname? "-table" : "");
             goto main_ret_INVALID_CMDLINE_A;
           }
           if (unlikely(pc.grm_flags & kfGrmMatrixSq)) {
@@ -8980,9 +9273,15 @@ int main(int argc, char** argv) {
           }
           pc.command_flags1 |= kfCommand1SampleCounts;
           pc.dependency_flags |= kfFilterAllReq;
+        } else if (strequal_k_unsafe(flagname_p2, "ample-id-index")) {
+          pc.misc_flags |= kfMiscSampleIdIndex;
+          goto main_param_zero;
         } else if (strequal_k_unsafe(flagname_p2, "trict-sid0")) {
           pc.misc_flags |= kfMiscStrictSid0;
           goto main_param_zero;
+        } else if (strequal_k_unsafe(flagname_p2, "maj-tiles")) {
+          pc.misc_flags |= kfMiscSmajTiles;
+          goto main_param_zero;
         } else if (unlikely(!strequal_k_unsafe(flagname_p2, "ilent"))) {
           goto main_ret_INVALID_CMDLINE_UNRECOGNIZED;
         }
@@ -9413,6 +9712,13 @@ int main(int argc, char** argv) {
           }
           import_flags |= kfImportVcfRequireGt;
           goto main_param_zero;
+        } else if (strequal_k_unsafe(flagname_p2, "cf-spool")) {
+          if (unlikely(!(xload & kfXloadVcf))) {
+            logerrputs("Error: --vcf-spool must be used with --vcf.\n");
+            goto main_ret_INVALID_CMDLINE;
+          }
+          import_flags |= kfImportVcfSpool;
+          goto main_param_zero;
         } else if (strequal_k_unsafe(flagname_p2, "if")) {
           if (unlikely(!(pc.command_flags1 & kfCommand1Glm))) {
             logerrputs("Error: --vif must be used with --glm/--epistasis.\n");
@@ -9519,9 +9825,23 @@ int main(int argc, char** argv) {
             goto main_ret_1;
           }
         } else if (likely(strequal_k_unsafe(flagname_p2, "alidate"))) {
+          if (unlikely(EnforceParamCtRange(argvk[arg_idx], param_ct, 0, 1))) {
+            goto main_ret_INVALID_CMDLINE_2A;
+          }
+          if (param_ct) {
+            const char* cur_modif = argvk[arg_idx + 1];
+            const uint32_t cur_modif_slen = strlen(cur_modif);
+            if (strequal_k(cur_modif, "write-checksums", cur_modif_slen)) {
+              pc.validate_flags = kfValidateChecksumWrite;
+            } else if (likely(strequal_k(cur_modif, "checksums", cur_modif_slen))) {
+              pc.validate_flags = kfValidateChecksumCheck;
+            } else {
+              snprintf(g_logbuf, kLogbufSize, "Error: Invalid --validate argument '%s'.\n", cur_modif);
+              goto main_ret_INVALID_CMDLINE_WWA;
+            }
+          }
           pc.command_flags1 |= kfCommand1Validate;
           pc.dependency_flags |= kfFilterAllReq;
-          goto main_param_zero;
         } else {
           goto main_ret_INVALID_CMDLINE_UNRECOGNIZED;
         }
@@ -9696,6 +10016,32 @@ int main(int argc, char** argv) {
     if (!outname_end) {
       outname_end = &(outname[6]);
     }
+    if (bcf_subset) {
+      if (unlikely(xload != kfXloadBcf)) {
+        logerrputs("Error: --bcf-subset requires --bcf.\n");
+        goto main_ret_INVALID_CMDLINE_A;
+      }
+      // --bcf-subset never decodes genotypes or builds a variant table, so
+      // only a few filters are meaningful.
+      static const char kBcfSubsetCompatibleFlags[] = "autosome\0autosome-par\0allow-extra-chr\0bcf\0bcf-subset\0chr\0chr-set\0exclude\0extract\0keep\0memory\0not-chr\0out\0remove\0silent\0threads\0";
+      for (uint32_t flag_idx = 0; flag_idx != flag_ct; ++flag_idx) {
+        const char* cur_flagname = &(pcm.flag_buf[flag_idx * kMaxFlagBlen]);
+        const char* compatible_iter = kBcfSubsetCompatibleFlags;
+        for (; *compatible_iter; compatible_iter = &(strnul(compatible_iter)[1])) {
+          if (!strcmp(cur_flagname, compatible_iter)) {
+            break;
+          }
+        }
+        if (unlikely(!(*compatible_iter))) {
+          snprintf(g_logbuf, kLogbufSize, "Error: --%s cannot be used with --bcf-subset.\n", cur_flagname);
+          goto main_ret_INVALID_CMDLINE_WWA;
+        }
+      }
+      if (unlikely(pc.filter_flags & (kfFilterExtractBed0 | kfFilterExtractBed1 | kfFilterExcludeBed0 | kfFilterExcludeBed1))) {
+        logerrputs("Error: --bcf-subset does not support --extract/--exclude range mode.\n");
+        goto main_ret_INVALID_CMDLINE_A;
+      }
+    }
 
     pc.dependency_flags |= pc.filter_flags;
     const uint32_t skip_main = (!pc.command_flags1) && (!(xload & (kfXloadVcf | kfXloadBcf | kfXloadOxBgen | kfXloadOxHaps | kfXloadOxSample | kfXloadPlink1Dosage | kfXloadGenDummy)));
@@ -9728,6 +10074,10 @@ int main(int argc, char** argv) {
       logerrputs("Error: When the 'multiallelics=', 'trim-alts', and/or 'erase-...' modifier is\npresent, --make-bed/--make-[b]pgen cannot be combined with other commands.\n(Other filters are fine.)\n");
       goto main_ret_INVALID_CMDLINE;
     }
+    if (unlikely((make_plink2_flags & kfMakePgenSmajTiles) && ((pc.sort_vars_flags != kfSort0) || (pc.sample_sort_flags & (kfSortNatural | kfSortAscii | kfSortFile)) || (make_plink2_flags & (kfMakePlink2MMask | kfMakePlink2TrimAlts | kfMakePlink2EraseAlt2Plus | kfMakePlink2SetHhMissing | kfMakePlink2SetMixedMtMissing | kfMakePgenFillMissingFromDosage))))) {
+      logerrputs("Error: --make-[b]pgen 'smaj-tiles' cannot currently be used with --sort-vars,\n--indiv-sort, --set-hh-missing, --set-mixed-mt-missing, or the\n'multiallelics=', 'trim-alts', 'erase-alt2+', and 'fill-missing-from-dosage'\nmodifiers.\n");
+      goto main_ret_INVALID_CMDLINE_A;
+    }
     if (make_plink2_flags & kfMakePlink2MMask) {
       if (unlikely((pc.misc_flags & kfMiscMajRef) || pc.ref_allele_flag || pc.alt1_allele_flag || (pc.fa_flags & kfFaRefFrom))) {
         logerrputs("Error: --make-bed/--make-[b]pgen 'multiallelics=' cannot be used with\n'trim-alts'.\n");
@@ -9866,6 +10216,9 @@ int main(int argc, char** argv) {
       // sufficiently busy to justify only 1 compute thread.)
       logprintf("Using %s%u compute thread%s.\n", (pc.max_thread_ct > 1)? "up to " : "", pc.max_thread_ct, (pc.max_thread_ct == 1)? "" : "s");
     }
+    const SimdTier simd_tier = InitSimdDispatch();
+    snprintf(g_logbuf, kLogbufSize, "Popcount kernels: %s.\n", SimdTierName(simd_tier));
+    logputs_silent(g_logbuf);
     if (randmem) {
       reterr = RandomizeBigstack(pc.max_thread_ct, &main_sfmt);
       if (unlikely(reterr)) {
@@ -9887,6 +10240,10 @@ int main(int argc, char** argv) {
       }
     }
 
+    if (unlikely(pc.pfile_list_fname && (pc.command_flags1 & (kfCommand1Validate | kfCommand1PgenInfo)))) {
+      logerrputs("Error: --validate and --pgen-info cannot be used with --pfile-list.  Run them on\neach fileset separately.\n");
+      goto main_ret_INVALID_CMDLINE_A;
+    }
     // nonstandard cases (CNV, etc.) here
     if ((pc.command_flags1 == kfCommand1PgenInfo) && (load_params != kfLoadParamsPfileAll) && (!xload)) {
       // special case: don't require .psam/.pvar file
@@ -9895,6 +10252,8 @@ int main(int argc, char** argv) {
         goto main_ret_INVALID_CMDLINE;
       }
       reterr = PgenInfoStandalone(pgenname);
+    } else if (bcf_subset) {
+      reterr = BcfSubset(pgenname, pc.keep_fnames, pc.remove_fnames, pc.extract_fnames, pc.exclude_fnames, pc.misc_flags, pc.max_thread_ct, outname, outname_end, &chr_info);
     } else {
       if (unlikely(pc.dependency_flags && (!pc.command_flags1))) {
         logerrputs("Error: Basic file conversions do not support regular filter or transform\noperations.  Rerun your command with --make-bed/--make-[b]pgen.\n");
@@ -10136,6 +10495,7 @@ int main(int argc, char** argv) {
   free_cond(pc.require_no_info_flattened);
   free_cond(pc.require_info_flattened);
   free_cond(pc.king_table_subset_fname);
+  free_cond(pc.king_cutoff_table_fname);
   free_cond(pc.fa_fname);
   free_cond(pc.loop_cats_phenoname);
   free_cond(pc.covar_quantnorm_flattened);
@@ -10167,6 +10527,7 @@ int main(int argc, char** argv) {
   free_cond(pc.extract_intersect_fnames);
   free_cond(pc.extract_fnames);
   free_cond(pc.sample_sort_fname);
+  free_cond(pc.pfile_list_fname);
   free_cond(pc.covar_fname);
   free_cond(pc.pheno_fname);
   free_cond(pc.varid_exclude_snp);
@@ -22,8 +22,8 @@
 #  include <sys/sysctl.h>
 #endif
 
-#include <sys/types.h>  // open()
-#include <sys/stat.h>  // open()
+#include <sys/types.h>  // stat()
+#include <sys/stat.h>  // stat()
 #include <fcntl.h>  // open()
 #include <time.h>  // time(), ctime()
 #include <unistd.h>  // getcwd(), gethostname(), sysconf(), fstat()
@@ -111,20 +111,15 @@ void logerrputsb() {
 }
 
 PglErr ForceNonFifo(const char* fname) {
-  int32_t file_handle = open(fname, O_RDONLY);
-  if (unlikely(file_handle < 0)) {
-    return kPglRetOpenFail;
-  }
+  // stat() instead of open() + fstat(): opening and closing a named pipe would
+  // disconnect its writer, so a later real open() would block forever.
   struct stat statbuf;
-  if (unlikely(fstat(file_handle, &statbuf) < 0)) {
-    close(file_handle);
+  if (unlikely(stat(fname, &statbuf) < 0)) {
     return kPglRetOpenFail;
   }
   if (unlikely(S_ISFIFO(statbuf.st_mode))) {
-    close(file_handle);
     return kPglRetRewindFail;
   }
-  close(file_handle);
   return kPglRetSuccess;
 }
 
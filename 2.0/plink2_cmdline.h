@@ -236,7 +236,8 @@ HEADER_INLINE void DPrintf(const char* fmt, ...) {
 }
 
 // Returns kPglRetOpenFail if file doesn't exist, or kPglRetRewindFail if file
-// is process-substitution/named-pipe.  Does not print an error message.
+// is process-substitution/named-pipe.  Does not print an error message, and
+// does not open the file.
 PglErr ForceNonFifo(const char* fname);
 
 BoolErr fopen_checked(const char* fname, const char* mode, FILE** target_ptr);
@@ -17,6 +17,20 @@
 
 #include "plink2_common.h"
 
+// Only XXH64 is needed, for --validate checksums; private mode keeps this
+// independent of whether zstd is linked statically.
+#define XXH_PRIVATE_API
+#include "zstd/lib/common/xxhash.h"
+
+#ifdef _WIN32
+#  include <process.h>  // getpid()
+#else
+#  include <unistd.h>  // getpid()
+#endif
+#ifndef NO_MMAP
+#  include <sys/mman.h>  // mmap()
+#endif
+
 #ifdef __cplusplus
 namespace plink2 {
 #endif
@@ -1026,6 +1040,424 @@ BoolErr SortedXidboxReadMultifind(const char* __restrict sorted_xidbox, uintptr_
   return 0;
 }
 
+PglErr XidHtableInitAlloc(const uintptr_t* sample_include, const SampleIdInfo* siip, const XidIndex* xidxp, uint32_t raw_sample_ct, uint32_t sample_ct, uint32_t allow_dups, XidMode xid_mode, uint32_t max_thread_ct, XidHtable* xid_htable_ptr) {
+  const uint32_t sid_table = (xid_mode / kfXidModeFlagSid) & 1;
+  if (xidxp && xidxp->base && xidxp->htables[sid_table] && (allow_dups || (!xidxp->dup_cts[sid_table]))) {
+    // The index's tables cover all raw samples.
+    const char** xids;
+    if (unlikely(bigstack_alloc_kcp(raw_sample_ct, &xids))) {
+      return kPglRetNomem;
+    }
+    const char* xids_base;
+    uintptr_t max_xid_blen;
+    if (!sid_table) {
+      xids_base = siip->sample_ids;
+      max_xid_blen = siip->max_sample_id_blen;
+    } else {
+      uintptr_t* all_samples;
+      char* sample_augids;
+      if (unlikely(
+              bigstack_alloc_w(BitCtToWordCt(raw_sample_ct), &all_samples))) {
+        return kPglRetNomem;
+      }
+      SetAllBits(raw_sample_ct, all_samples);
+      if (unlikely(AugidInitAlloc(all_samples, siip, raw_sample_ct, nullptr, &sample_augids, &max_xid_blen))) {
+        return kPglRetNomem;
+      }
+      xids_base = sample_augids;
+    }
+    for (uint32_t sample_uidx = 0; sample_uidx != raw_sample_ct; ++sample_uidx) {
+      xids[sample_uidx] = &(xids_base[sample_uidx * max_xid_blen]);
+    }
+    const uint32_t htable_size = xidxp->htable_sizes[sid_table];
+    xid_htable_ptr->xids = xids;
+    xid_htable_ptr->htable = xidxp->htables[sid_table];
+    xid_htable_ptr->htable_dup_base = &(xidxp->htables[sid_table][RoundUpPow2(htable_size, kInt32PerCacheline)]);
+    xid_htable_ptr->subset_mask = (sample_ct == raw_sample_ct)? nullptr : sample_include;
+    xid_htable_ptr->max_xid_blen = max_xid_blen;
+    xid_htable_ptr->htable_size = htable_size;
+    return kPglRetSuccess;
+  }
+  const char** xids;
+  if (unlikely(bigstack_alloc_kcp(raw_sample_ct, &xids))) {
+    return kPglRetNomem;
+  }
+  uintptr_t max_xid_blen;
+  if (!sid_table) {
+    // two fields; point directly into sample_ids
+    const char* sample_ids = siip->sample_ids;
+    max_xid_blen = siip->max_sample_id_blen;
+    uintptr_t sample_uidx_base = 0;
+    uintptr_t cur_bits = sample_include[0];
+    for (uint32_t sample_idx = 0; sample_idx != sample_ct; ++sample_idx) {
+      const uintptr_t sample_uidx = BitIter1(sample_include, &sample_uidx_base, &cur_bits);
+      xids[sample_uidx] = &(sample_ids[sample_uidx * max_xid_blen]);
+    }
+  } else {
+    // three fields
+    char* sample_augids;
+    if (unlikely(AugidInitAlloc(sample_include, siip, sample_ct, nullptr, &sample_augids, &max_xid_blen))) {
+      return kPglRetNomem;
+    }
+    uintptr_t sample_uidx_base = 0;
+    uintptr_t cur_bits = sample_include[0];
+    for (uint32_t sample_idx = 0; sample_idx != sample_ct; ++sample_idx) {
+      const uintptr_t sample_uidx = BitIter1(sample_include, &sample_uidx_base, &cur_bits);
+      xids[sample_uidx] = &(sample_augids[sample_idx * max_xid_blen]);
+    }
+  }
+  uint32_t* htable;
+  uint32_t* htable_dup_base;
+  uint32_t htable_size;
+  uint32_t dup_ct = 0;
+  PglErr reterr = AllocAndPopulateIdHtableMt(sample_include, xids, sample_ct, 0, max_thread_ct, &htable, &htable_dup_base, &htable_size, &dup_ct);
+  if (unlikely(reterr)) {
+    return reterr;
+  }
+  if ((!allow_dups) && dup_ct) {
+    // report the first duplicate in file order
+    uintptr_t sample_uidx_base = 0;
+    uintptr_t cur_bits = sample_include[0];
+    while (1) {
+      const uintptr_t sample_uidx = BitIter1(sample_include, &sample_uidx_base, &cur_bits);
+      const char* cur_xid = xids[sample_uidx];
+      const uint32_t cur_slen = strlen(cur_xid);
+      uint32_t cur_llidx;
+      VariantIdDupHtableFind(cur_xid, xids, htable, htable_dup_base, cur_slen, htable_size, cur_slen, &cur_llidx);
+      if (cur_llidx != UINT32_MAX) {
+        strcpy(g_textbuf, cur_xid);
+        TabsToSpaces(g_textbuf);
+        logerrprintfww("Error: Duplicate ID '%s'.\n", g_textbuf);
+        return kPglRetMalformedInput;
+      }
+    }
+  }
+  xid_htable_ptr->xids = xids;
+  xid_htable_ptr->htable = htable;
+  xid_htable_ptr->htable_dup_base = htable_dup_base;
+  xid_htable_ptr->subset_mask = nullptr;
+  xid_htable_ptr->max_xid_blen = max_xid_blen;
+  xid_htable_ptr->htable_size = htable_size;
+  return kPglRetSuccess;
+}
+
+void PreinitXidIndex(XidIndex* xidxp) {
+  xidxp->base = nullptr;
+  xidxp->byte_ct = 0;
+  xidxp->htables[0] = nullptr;
+  xidxp->htables[1] = nullptr;
+  xidxp->is_mmapped = 0;
+}
+
+uint64_t SampleIdsXxh64(const SampleIdInfo* siip, uint32_t raw_sample_ct) {
+  const char* sample_ids = siip->sample_ids;
+  const char* sids = siip->sids;
+  const uintptr_t max_sample_id_blen = siip->max_sample_id_blen;
+  const uintptr_t max_sid_blen = siip->max_sid_blen;
+  XXH64_state_t xxh_state;
+  XXH64_reset(&xxh_state, 0);
+  for (uint32_t sample_uidx = 0; sample_uidx != raw_sample_ct; ++sample_uidx) {
+    const char* cur_sample_id = &(sample_ids[sample_uidx * max_sample_id_blen]);
+    XXH64_update(&xxh_state, cur_sample_id, strlen(cur_sample_id) + 1);
+    if (sids) {
+      const char* cur_sid = &(sids[sample_uidx * max_sid_blen]);
+      XXH64_update(&xxh_state, cur_sid, strlen(cur_sid) + 1);
+    }
+  }
+  return XXH64_digest(&xxh_state);
+}
+
+// Returns kPglRetSkipped if the file is absent, unreadable, or stale.
+BoolErr MapFileReadonly(const char* fname, unsigned char** base_ptr, uintptr_t* byte_ct_ptr, uint32_t* is_mmapped_ptr) {
+  FILE* ff = fopen(fname, FOPEN_RB);
+  if (!ff) {
+    return 1;
+  }
+  BoolErr ret_boolerr = 1;
+  if (!fseeko(ff, 0, SEEK_END)) {
+    const int64_t fsize = ftello(ff);
+    if (fsize > 0) {
+#ifdef NO_MMAP
+      unsigned char* base = S_CAST(unsigned char*, malloc(fsize));
+      if (base) {
+        rewind(ff);
+        if (!fread_checked(base, fsize, ff)) {
+          *base_ptr = base;
+          *byte_ct_ptr = fsize;
+          *is_mmapped_ptr = 0;
+          ret_boolerr = 0;
+        } else {
+          free(base);
+        }
+      }
+#else
+      void* mapped = mmap(0, fsize, PROT_READ, MAP_SHARED, fileno(ff), 0);
+      if (mapped != MAP_FAILED) {
+        *base_ptr = S_CAST(unsigned char*, mapped);
+        *byte_ct_ptr = fsize;
+        *is_mmapped_ptr = 1;
+        ret_boolerr = 0;
+      }
+#endif
+    }
+  }
+  fclose(ff);
+  return ret_boolerr;
+}
+
+void UnmapFileReadonly(unsigned char* base, uintptr_t byte_ct, uint32_t is_mmapped) {
+#ifndef NO_MMAP
+  if (is_mmapped) {
+    munmap(base, byte_ct);
+    return;
+  }
+#endif
+  free(base);
+}
+
+BoolErr TmpFnameInit(const char* fname, char* tmp_fname) {
+  const uint32_t fname_slen = strlen(fname);
+  if (unlikely(fname_slen + 16 > kPglFnamesize)) {
+    return 1;
+  }
+  snprintf(memcpya(tmp_fname, fname, fname_slen), 16, ".tmp%u", S_CAST(uint32_t, getpid()));
+  return 0;
+}
+
+// Entries of a mapped .xidx table are used directly as xids[] indexes, so
+// they must be range-checked.  Empty slots must remain (otherwise a failed
+// lookup would never terminate), and dup-chain links always point to an
+// earlier entry.
+BoolErr XidIndexTableIsInvalid(const uint32_t* htable, uint32_t htable_size, uint32_t dup_ct, uint32_t raw_sample_ct) {
+  uint32_t filled_ct = 0;
+  for (uint32_t hashval = 0; hashval != htable_size; ++hashval) {
+    const uint32_t cur_htable_entry = htable[hashval];
+    if (cur_htable_entry == UINT32_MAX) {
+      continue;
+    }
+    if (cur_htable_entry >> 31) {
+      if ((cur_htable_entry & 0x7fffffff) >= dup_ct) {
+        return 1;
+      }
+    } else if (cur_htable_entry >= raw_sample_ct) {
+      return 1;
+    }
+    ++filled_ct;
+  }
+  if (filled_ct >= htable_size) {
+    return 1;
+  }
+  const uint32_t* htable_dup_base = &(htable[RoundUpPow2(htable_size, kInt32PerCacheline)]);
+  for (uint32_t llidx = 0; llidx != 2 * dup_ct; llidx += 2) {
+    const uint32_t next_llidx = htable_dup_base[llidx + 1];
+    if ((htable_dup_base[llidx] >= raw_sample_ct) || ((next_llidx != UINT32_MAX) && ((next_llidx >= llidx) || (next_llidx % 2)))) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// Returns kPglRetSkipped if the file is absent, unreadable, stale, or
+// malformed.
+PglErr XidIndexMap(const char* fname, uint32_t raw_sample_ct, uint32_t sid_table_present, uint64_t id_hash, XidIndex* xidxp) {
+  if (MapFileReadonly(fname, &(xidxp->base), &(xidxp->byte_ct), &(xidxp->is_mmapped))) {
+    return kPglRetSkipped;
+  }
+  const unsigned char* header = xidxp->base;
+  uint32_t stored_sample_ct;
+  uint64_t stored_id_hash;
+  if (xidxp->byte_ct < S_CAST(uintptr_t, kXidIndexHeaderByteCt)) {
+    goto XidIndexMap_ret_SKIPPED;
+  }
+  memcpy(&stored_sample_ct, &(header[4]), sizeof(int32_t));
+  memcpy(&stored_id_hash, &(header[8]), sizeof(int64_t));
+  if ((!memequal_k(header, "l\x1b\x41", 3)) || (header[3] != sid_table_present) || (stored_sample_ct != raw_sample_ct) || (stored_id_hash != id_hash)) {
+    goto XidIndexMap_ret_SKIPPED;
+  }
+  {
+    const uint32_t table_ct = 1 + sid_table_present;
+    uint64_t table_fposs[2];
+    uint64_t expected_fsize = kXidIndexHeaderByteCt;
+    for (uint32_t table_idx = 0; table_idx != table_ct; ++table_idx) {
+      const unsigned char* table_header = &(header[16 + 16 * table_idx]);
+      uint32_t htable_size;
+      uint64_t table_byte_ct;
+      memcpy(&htable_size, table_header, sizeof(int32_t));
+      memcpy(&(xidxp->dup_cts[table_idx]), &(table_header[4]), sizeof(int32_t));
+      memcpy(&table_byte_ct, &(table_header[8]), sizeof(int64_t));
+      if ((htable_size <= raw_sample_ct) || (xidxp->dup_cts[table_idx] > raw_sample_ct) || (table_byte_ct < (RoundUpPow2(htable_size, kInt32PerCacheline) + 2 * S_CAST(uint64_t, xidxp->dup_cts[table_idx])) * sizeof(int32_t))) {
+        goto XidIndexMap_ret_SKIPPED;
+      }
+      xidxp->htable_sizes[table_idx] = htable_size;
+      table_fposs[table_idx] = expected_fsize;
+      expected_fsize += RoundUpPow2(table_byte_ct, kXidIndexHeaderByteCt);
+    }
+    if (xidxp->byte_ct != expected_fsize) {
+      goto XidIndexMap_ret_SKIPPED;
+    }
+    for (uint32_t table_idx = 0; table_idx != table_ct; ++table_idx) {
+      const uint32_t* htable = R_CAST(const uint32_t*, &(xidxp->base[table_fposs[table_idx]]));
+      if (XidIndexTableIsInvalid(htable, xidxp->htable_sizes[table_idx], xidxp->dup_cts[table_idx], raw_sample_ct)) {
+        goto XidIndexMap_ret_SKIPPED;
+      }
+      xidxp->htables[table_idx] = htable;
+    }
+  }
+  return kPglRetSuccess;
+ XidIndexMap_ret_SKIPPED:
+  CleanupXidIndex(xidxp);
+  return kPglRetSkipped;
+}
+
+PglErr XidIndexWrite(const char* fname, const SampleIdInfo* siip, uint32_t raw_sample_ct, uint64_t id_hash, uint32_t max_thread_ct) {
+  unsigned char* bigstack_mark = g_bigstack_base;
+  FILE* outfile = nullptr;
+  char tmp_fname[kPglFnamesize];
+  tmp_fname[0] = '\0';
+  PglErr reterr = kPglRetSuccess;
+  {
+    uintptr_t* all_samples;
+    const char** xids;
+    if (unlikely(
+            bigstack_alloc_w(BitCtToWordCt(raw_sample_ct), &all_samples) ||
+            bigstack_alloc_kcp(raw_sample_ct, &xids))) {
+      goto XidIndexWrite_ret_NOMEM;
+    }
+    SetAllBits(raw_sample_ct, all_samples);
+    const uint32_t sid_table_present = (siip->sids != nullptr);
+    const uint32_t table_ct = 1 + sid_table_present;
+    unsigned char header[kXidIndexHeaderByteCt];
+    memset(header, 0, kXidIndexHeaderByteCt);
+    memcpy(header, "l\x1b\x41", 3);
+    header[3] = sid_table_present;
+    memcpy(&(header[4]), &raw_sample_ct, sizeof(int32_t));
+    memcpy(&(header[8]), &id_hash, sizeof(int64_t));
+    const unsigned char* table_starts[2];
+    uint64_t table_byte_cts[2];
+    for (uint32_t table_idx = 0; table_idx != table_ct; ++table_idx) {
+      const char* xids_base = siip->sample_ids;
+      uintptr_t max_xid_blen = siip->max_sample_id_blen;
+      if (table_idx) {
+        char* sample_augids;
+        if (unlikely(AugidInitAlloc(all_samples, siip, raw_sample_ct, nullptr, &sample_augids, &max_xid_blen))) {
+          goto XidIndexWrite_ret_NOMEM;
+        }
+        xids_base = sample_augids;
+      }
+      for (uint32_t sample_uidx = 0; sample_uidx != raw_sample_ct; ++sample_uidx) {
+        xids[sample_uidx] = &(xids_base[sample_uidx * max_xid_blen]);
+      }
+      uint32_t* htable;
+      uint32_t* htable_dup_base;
+      uint32_t htable_size;
+      uint32_t dup_ct = 0;
+      reterr = AllocAndPopulateIdHtableMt(all_samples, xids, raw_sample_ct, 0, max_thread_ct, &htable, &htable_dup_base, &htable_size, &dup_ct);
+      if (unlikely(reterr)) {
+        goto XidIndexWrite_ret_1;
+      }
+      // htable_dup_base[] entries end at the current bottom of bigstack.
+      table_starts[table_idx] = R_CAST(unsigned char*, htable);
+      table_byte_cts[table_idx] = g_bigstack_base - table_starts[table_idx];
+      unsigned char* table_header = &(header[16 + 16 * table_idx]);
+      memcpy(table_header, &htable_size, sizeof(int32_t));
+      memcpy(&(table_header[4]), &dup_ct, sizeof(int32_t));
+      memcpy(&(table_header[8]), &(table_byte_cts[table_idx]), sizeof(int64_t));
+    }
+    // Write to a temporary file and rename it, so that concurrent jobs never
+    // see (or have mapped) a partially written index.
+    if (unlikely(TmpFnameInit(fname, tmp_fname))) {
+      goto XidIndexWrite_ret_OPEN_FAIL;
+    }
+    outfile = fopen(tmp_fname, FOPEN_WB);
+    if (!outfile) {
+      tmp_fname[0] = '\0';
+      goto XidIndexWrite_ret_OPEN_FAIL;
+    }
+    if (fwrite_checked(header, kXidIndexHeaderByteCt, outfile)) {
+      goto XidIndexWrite_ret_OPEN_FAIL;
+    }
+    for (uint32_t table_idx = 0; table_idx != table_ct; ++table_idx) {
+      const uint64_t table_byte_ct = table_byte_cts[table_idx];
+      if (fwrite_checked(table_starts[table_idx], table_byte_ct, outfile)) {
+        goto XidIndexWrite_ret_OPEN_FAIL;
+      }
+      const uint32_t pad_byte_ct = RoundUpPow2(table_byte_ct, kXidIndexHeaderByteCt) - table_byte_ct;
+      if (pad_byte_ct) {
+        memset(header, 0, pad_byte_ct);
+        if (fwrite_checked(header, pad_byte_ct, outfile)) {
+          goto XidIndexWrite_ret_OPEN_FAIL;
+        }
+      }
+    }
+    if (fclose_null(&outfile) || rename(tmp_fname, fname)) {
+      goto XidIndexWrite_ret_OPEN_FAIL;
+    }
+    tmp_fname[0] = '\0';
+  }
+  while (0) {
+  XidIndexWrite_ret_NOMEM:
+    reterr = kPglRetNomem;
+    break;
+  XidIndexWrite_ret_OPEN_FAIL:
+    // caller prints a warning and proceeds without the index
+    reterr = kPglRetOpenFail;
+    break;
+  }
+ XidIndexWrite_ret_1:
+  fclose_cond(outfile);
+  if (tmp_fname[0]) {
+    remove(tmp_fname);
+  }
+  BigstackReset(bigstack_mark);
+  return reterr;
+}
+
+PglErr XidIndexLoadOrCreate(const char* psamname, const SampleIdInfo* siip, uint32_t raw_sample_ct, uint32_t max_thread_ct, XidIndex* xidxp) {
+  char fname[kPglFnamesize];
+  const uint32_t psamname_slen = strlen(psamname);
+  if (unlikely(psamname_slen + 6 > kPglFnamesize)) {
+    logerrputs("Warning: --sample-id-index filename too long; ignoring.\n");
+    return kPglRetSkipped;
+  }
+  snprintf(memcpya(fname, psamname, psamname_slen), 6, ".xidx");
+  const uint32_t sid_table_present = (siip->sids != nullptr);
+  const uint64_t id_hash = SampleIdsXxh64(siip, raw_sample_ct);
+  PglErr reterr = XidIndexMap(fname, raw_sample_ct, sid_table_present, id_hash, xidxp);
+  if (reterr != kPglRetSkipped) {
+    if (!reterr) {
+      logprintfww("--sample-id-index: Using %s .\n", fname);
+    }
+    return reterr;
+  }
+  reterr = XidIndexWrite(fname, siip, raw_sample_ct, id_hash, max_thread_ct);
+  if (reterr) {
+    if (reterr == kPglRetOpenFail) {
+      logerrprintfww("Warning: Failed to write %s ; ignoring --sample-id-index.\n", fname);
+      reterr = kPglRetSkipped;
+    }
+    return reterr;
+  }
+  reterr = XidIndexMap(fname, raw_sample_ct, sid_table_present, id_hash, xidxp);
+  if (reterr) {
+    if (reterr == kPglRetSkipped) {
+      logerrprintfww("Warning: Failed to read %s ; ignoring --sample-id-index.\n", fname);
+    }
+    return reterr;
+  }
+  logprintfww("--sample-id-index: Index written to %s .\n", fname);
+  return kPglRetSuccess;
+}
+
+void CleanupXidIndex(XidIndex* xidxp) {
+  if (xidxp->base) {
+    UnmapFileReadonly(xidxp->base, xidxp->byte_ct, xidxp->is_mmapped);
+    xidxp->base = nullptr;
+  }
+  xidxp->htables[0] = nullptr;
+  xidxp->htables[1] = nullptr;
+  xidxp->is_mmapped = 0;
+}
+
 PglErr LoadXidHeader(const char* flag_name, XidHeaderFlags xid_header_flags, uintptr_t* line_idx_ptr, TextStream* txsp, XidMode* xid_mode_ptr, char** line_startp, char** line_iterp) {
   // possible todo: support comma delimiter
   uintptr_t line_idx = *line_idx_ptr;
@@ -2943,6 +3375,443 @@ PglErr PgenMtLoadInit(const uintptr_t* variant_include, uint32_t sample_ct, uint
   return kPglRetSuccess;
 }
 
+// Checksum region 0 is everything before the first variant record; region
+// (vblock_idx + 1) covers that vblock's records.  For zstd-compressed .pgen
+// files, the compressed bytes are hashed.
+static uint64_t GetVblockFpos(const PgenFileInfo* pgfip, uint32_t vidx) {
+  if (pgfip->zst_group_fpos) {
+    return pgfip->zst_group_fpos[DivUp(vidx, 1U << pgfip->zst_group_lg)];
+  }
+  return GetPgfiFpos(pgfip, vidx);
+}
+
+static char* hex64toa(uint64_t ullii, char* start) {
+  for (uint32_t shift = 60; ; shift -= 4) {
+    const uint32_t nybble = (ullii >> shift) & 15;
+    *start++ = nybble + ((nybble < 10)? '0' : ('a' - 10));
+    if (!shift) {
+      return start;
+    }
+  }
+}
+
+// Exactly 16 hex digits.  Returns nullptr on failure.
+static const char* ScanHex64(const char* str_iter, uint64_t* valp) {
+  uint64_t val = 0;
+  for (uint32_t uii = 0; uii != 16; ++uii) {
+    const uint32_t cc = ctou32(str_iter[uii]);
+    uint32_t nybble = cc - 48;
+    if (nybble >= 10) {
+      nybble = (cc | 0x20) - 87;
+      if ((nybble < 10) || (nybble > 15)) {
+        return nullptr;
+      }
+    }
+    val = (val << 4) | nybble;
+  }
+  *valp = val;
+  return &(str_iter[16]);
+}
+
+static char* AppendValidateRegionPrefix(const uint64_t* region_fpos, uint32_t region_idx, char* write_iter) {
+  if (!region_idx) {
+    write_iter = strcpya_k(write_iter, "header");
+  } else {
+    write_iter = u32toa(region_idx - 1, write_iter);
+  }
+  *write_iter++ = '\t';
+  write_iter = i64toa(region_fpos[region_idx], write_iter);
+  *write_iter++ = '\t';
+  write_iter = i64toa(region_fpos[region_idx + 1], write_iter);
+  *write_iter++ = '\t';
+  return write_iter;
+}
+
+CONSTI32(kValidateHashBlen, 1 << 20);
+
+typedef struct ValidatePgenCtxStruct {
+  const char* pgenname;
+  uint32_t variant_ct;
+  uint32_t vblock_ct;
+
+  PgenReader** pgr_ptrs;  // nullptr if only checksumming
+  uintptr_t** genovec_bufs;
+
+  const uint64_t* region_fpos;  // nullptr if not checksumming
+  unsigned char** hash_bufs;
+  uint64_t* region_hashes;
+
+  char** errstr_bufs;
+  PglErr* reterrs;
+} ValidatePgenCtx;
+
+THREAD_FUNC_DECL ValidatePgenThread(void* raw_arg) {
+  ThreadGroupFuncArg* arg = S_CAST(ThreadGroupFuncArg*, raw_arg);
+  const uint32_t tidx = arg->tidx;
+  ValidatePgenCtx* ctx = S_CAST(ValidatePgenCtx*, arg->sharedp->context);
+
+  const uint32_t thread_ct = GetThreadCt(arg->sharedp);
+  const uint32_t vblock_ct = ctx->vblock_ct;
+  const uint32_t vblock_start = (S_CAST(uint64_t, vblock_ct) * tidx) / thread_ct;
+  const uint32_t vblock_end = (S_CAST(uint64_t, vblock_ct) * (tidx + 1)) / thread_ct;
+  char* errstr_buf = ctx->errstr_bufs[tidx];
+  FILE* hash_ff = nullptr;
+  PglErr reterr = kPglRetSuccess;
+  if (ctx->pgr_ptrs) {
+    const uint32_t vidx_end = MINV(vblock_end * kPglVblockSize, ctx->variant_ct);
+    reterr = PgrValidateRange(vblock_start * kPglVblockSize, vidx_end, ctx->pgr_ptrs[tidx], ctx->genovec_bufs[tidx], errstr_buf);
+    if (unlikely(reterr)) {
+      goto ValidatePgenThread_ret;
+    }
+  }
+  if (ctx->region_fpos) {
+    const char* pgenname = ctx->pgenname;
+    hash_ff = fopen(pgenname, FOPEN_RB);
+    if (unlikely(!hash_ff)) {
+      snprintf(errstr_buf, kPglErrstrBufBlen, kErrprintfFopen, pgenname, strerror(errno));
+      reterr = kPglRetOpenFail;
+      goto ValidatePgenThread_ret;
+    }
+    const uint64_t* region_fpos = ctx->region_fpos;
+    unsigned char* hash_buf = ctx->hash_bufs[tidx];
+    uint64_t* region_hashes = ctx->region_hashes;
+    // thread 0 also hashes the header
+    const uint32_t region_start = tidx? (vblock_start + 1) : 0;
+    uint64_t fpos = region_fpos[region_start];
+    if (unlikely(fseeko(hash_ff, fpos, SEEK_SET))) {
+      goto ValidatePgenThread_ret_READ_FAIL;
+    }
+    XXH64_state_t xxh_state;
+    for (uint32_t region_idx = region_start; region_idx <= vblock_end; ++region_idx) {
+      XXH64_reset(&xxh_state, 0);
+      const uint64_t region_end = region_fpos[region_idx + 1];
+      while (fpos != region_end) {
+        const uintptr_t cur_blen = MINV(region_end - fpos, kValidateHashBlen);
+        if (unlikely(!fread_unlocked(hash_buf, cur_blen, 1, hash_ff))) {
+          goto ValidatePgenThread_ret_READ_FAIL;
+        }
+        XXH64_update(&xxh_state, hash_buf, cur_blen);
+        fpos += cur_blen;
+      }
+      region_hashes[region_idx] = XXH64_digest(&xxh_state);
+    }
+  }
+  while (0) {
+  ValidatePgenThread_ret_READ_FAIL:
+    snprintf(errstr_buf, kPglErrstrBufBlen, kErrprintfFread, ctx->pgenname, rstrerror(errno));
+    reterr = kPglRetReadFail;
+    break;
+  }
+ ValidatePgenThread_ret:
+  if (hash_ff) {
+    fclose(hash_ff);
+  }
+  ctx->reterrs[tidx] = reterr;
+  THREAD_RETURN;
+}
+
+PglErr ValidatePgen(const char* pgenname, ValidateFlags flags, uint32_t max_vrec_width, uintptr_t pgr_alloc_cacheline_ct, uint32_t max_thread_ct, PgenFileInfo* pgfip, PgenReader* simple_pgrp) {
+  unsigned char* bigstack_mark = g_bigstack_base;
+  FILE* pgen_ff = nullptr;
+  FILE* outfile = nullptr;
+  char* sidecar_fname = nullptr;
+  PgenReader** pgr_ptrs = nullptr;
+  uint32_t calc_thread_ct = 0;
+  uintptr_t line_idx = 0;
+  PglErr reterr = kPglRetSuccess;
+  ThreadGroup tg;
+  PreinitThreads(&tg);
+  textFILE sidecar_txf;
+  PreinitTextFile(&sidecar_txf);
+  {
+    const uint32_t variant_ct = pgfip->raw_variant_ct;
+    const uint32_t vblock_ct = DivUp(variant_ct, kPglVblockSize);
+    const uint32_t check_only = (flags / kfValidateChecksumCheck) & 1;
+    const uint32_t checksum = (flags & (kfValidateChecksumWrite | kfValidateChecksumCheck)) != 0;
+    if (check_only) {
+      logprintfww5("Verifying checksums of %s... ", pgenname);
+    } else {
+      logprintfww5("Validating %s... ", pgenname);
+    }
+    fflush(stdout);
+    if (!check_only) {
+      reterr = PgrValidateHeader(simple_pgrp, g_logbuf);
+      if (unlikely(reterr)) {
+        goto ValidatePgen_ret_PGEN_ERRSTR;
+      }
+    }
+    uint64_t* region_fpos = nullptr;
+    uint64_t* region_hashes = nullptr;
+    if (checksum) {
+      const uint32_t pgenname_slen = strlen(pgenname);
+      if (unlikely(bigstack_alloc_u64(vblock_ct + 2, &region_fpos) ||
+                   bigstack_alloc_u64(vblock_ct + 1, &region_hashes) ||
+                   bigstack_alloc_c(pgenname_slen + 7, &sidecar_fname))) {
+        goto ValidatePgen_ret_NOMEM;
+      }
+      region_fpos[0] = 0;
+      for (uint32_t vblock_idx = 0; vblock_idx != vblock_ct; ++vblock_idx) {
+        region_fpos[vblock_idx + 1] = GetVblockFpos(pgfip, vblock_idx * kPglVblockSize);
+      }
+      region_fpos[vblock_ct + 1] = GetVblockFpos(pgfip, variant_ct);
+      snprintf(memcpya(sidecar_fname, pgenname, pgenname_slen), 7, ".xxh64");
+    }
+    uint64_t* expected_hashes = nullptr;
+    if (check_only) {
+      // Bytes past the last record aren't covered by any region.
+      pgen_ff = fopen(pgenname, FOPEN_RB);
+      if (unlikely(!pgen_ff)) {
+        logputs("\n");
+        logerrprintfww(kErrprintfFopen, pgenname, strerror(errno));
+        goto ValidatePgen_ret_OPEN_FAIL;
+      }
+      if (unlikely(fseeko(pgen_ff, 0, SEEK_END))) {
+        goto ValidatePgen_ret_PGEN_READ_FAIL;
+      }
+      const uint64_t fsize = ftello(pgen_ff);
+      fclose_null(&pgen_ff);
+      if (unlikely(fsize != region_fpos[vblock_ct + 1])) {
+        logputs("\n");
+        logerrprintfww("Error: %s has size %" PRIu64 ", but its variant records end at byte %" PRIu64 ".\n", pgenname, fsize, region_fpos[vblock_ct + 1]);
+        goto ValidatePgen_ret_MALFORMED_INPUT;
+      }
+      if (unlikely(bigstack_alloc_u64(vblock_ct + 1, &expected_hashes))) {
+        goto ValidatePgen_ret_NOMEM;
+      }
+      reterr = TextFileOpen(sidecar_fname, &sidecar_txf);
+      if (unlikely(reterr)) {
+        goto ValidatePgen_ret_TFILE_FAIL;
+      }
+      ++line_idx;
+      char* line_start = TextFileGet(&sidecar_txf);
+      if (unlikely((!line_start) || (!StrStartsWithUnsafe(line_start, "#REGION\t")))) {
+        if (TextFileErrcode2(&sidecar_txf, &reterr)) {
+          goto ValidatePgen_ret_TFILE_FAIL;
+        }
+        logputs("\n");
+        logerrprintfww("Error: %s is not a --validate checksum file.\n", sidecar_fname);
+        goto ValidatePgen_ret_MALFORMED_INPUT;
+      }
+      for (uint32_t region_idx = 0; region_idx <= vblock_ct; ++region_idx) {
+        ++line_idx;
+        line_start = TextFileGet(&sidecar_txf);
+        if (unlikely(!line_start)) {
+          if (TextFileErrcode2(&sidecar_txf, &reterr)) {
+            goto ValidatePgen_ret_TFILE_FAIL;
+          }
+          logputs("\n");
+          logerrprintfww("Error: %s has fewer regions than %s.\n", sidecar_fname, pgenname);
+          goto ValidatePgen_ret_INCONSISTENT_INPUT;
+        }
+        const uint32_t prefix_slen = AppendValidateRegionPrefix(region_fpos, region_idx, g_textbuf) - g_textbuf;
+        if (unlikely(!memequal(line_start, g_textbuf, prefix_slen))) {
+          logputs("\n");
+          logerrprintfww("Error: Line %" PRIuPTR " of %s does not match the record layout of %s. (Was the .pgen rewritten after the checksums were generated?)\n", line_idx, sidecar_fname, pgenname);
+          goto ValidatePgen_ret_INCONSISTENT_INPUT;
+        }
+        const char* hex_end = ScanHex64(&(line_start[prefix_slen]), &(expected_hashes[region_idx]));
+        if (unlikely((!hex_end) || (!IsEolnKns(*hex_end)))) {
+          logputs("\n");
+          logerrprintfww("Error: Invalid checksum on line %" PRIuPTR " of %s.\n", line_idx, sidecar_fname);
+          goto ValidatePgen_ret_MALFORMED_INPUT;
+        }
+      }
+      ++line_idx;
+      if (unlikely(TextFileGet(&sidecar_txf))) {
+        logputs("\n");
+        logerrprintfww("Error: %s has more regions than %s.\n", sidecar_fname, pgenname);
+        goto ValidatePgen_ret_INCONSISTENT_INPUT;
+      }
+      if (unlikely(TextFileErrcode2(&sidecar_txf, &reterr))) {
+        goto ValidatePgen_ret_TFILE_FAIL;
+      }
+      if (unlikely(CleanupTextFile(&sidecar_txf, &reterr))) {
+        logputs("\n");
+        logerrprintfww(kErrprintfFread, sidecar_fname, strerror(errno));
+        goto ValidatePgen_ret_1;
+      }
+    }
+
+    calc_thread_ct = MINV(max_thread_ct, vblock_ct);
+    if (!calc_thread_ct) {
+      calc_thread_ct = 1;
+    }
+    ValidatePgenCtx ctx;
+    ctx.pgenname = pgenname;
+    ctx.variant_ct = variant_ct;
+    ctx.vblock_ct = vblock_ct;
+    ctx.pgr_ptrs = nullptr;
+    ctx.genovec_bufs = nullptr;
+    ctx.region_fpos = region_fpos;
+    ctx.hash_bufs = nullptr;
+    ctx.region_hashes = region_hashes;
+    if (unlikely(bigstack_alloc_cp(calc_thread_ct, &ctx.errstr_bufs) ||
+                 BIGSTACK_ALLOC_X(PglErr, calc_thread_ct, &ctx.reterrs))) {
+      goto ValidatePgen_ret_NOMEM;
+    }
+    for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
+      if (unlikely(bigstack_alloc_c(kPglErrstrBufBlen, &(ctx.errstr_bufs[tidx])))) {
+        goto ValidatePgen_ret_NOMEM;
+      }
+    }
+    if (checksum) {
+      if (unlikely(bigstack_alloc_ucp(calc_thread_ct, &ctx.hash_bufs))) {
+        goto ValidatePgen_ret_NOMEM;
+      }
+      for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
+        if (unlikely(bigstack_alloc_uc(kValidateHashBlen, &(ctx.hash_bufs[tidx])))) {
+          goto ValidatePgen_ret_NOMEM;
+        }
+      }
+    }
+    if (!check_only) {
+      const uint32_t raw_sample_ct = pgfip->raw_sample_ct;
+      const uintptr_t pgr_alloc = (pgr_alloc_cacheline_ct + DivUp(max_vrec_width, kCacheline)) * kCacheline;
+      if (unlikely(bigstack_alloc_wp(calc_thread_ct, &ctx.genovec_bufs) ||
+                   BIGSTACK_ALLOC_X(PgenReader*, calc_thread_ct, &pgr_ptrs))) {
+        goto ValidatePgen_ret_NOMEM;
+      }
+      for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
+        if (unlikely(BIGSTACK_ALLOC_X(PgenReader, 1, &(pgr_ptrs[tidx])))) {
+          calc_thread_ct = tidx;
+          goto ValidatePgen_ret_NOMEM;
+        }
+        PreinitPgr(pgr_ptrs[tidx]);
+      }
+      // One FILE* per thread; see the comment on SingleVariantLoaderIsNeeded()
+      // in plink2.cc.
+      FILE* shared_ff_copy = pgfip->shared_ff;
+      pgfip->shared_ff = nullptr;
+      for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
+        unsigned char* cur_pgr_alloc;
+        if (unlikely(bigstack_alloc_w(NypCtToWordCt(raw_sample_ct), &(ctx.genovec_bufs[tidx])) ||
+                     bigstack_alloc_uc(pgr_alloc, &cur_pgr_alloc))) {
+          pgfip->shared_ff = shared_ff_copy;
+          goto ValidatePgen_ret_NOMEM;
+        }
+        reterr = PgrInit(pgenname, max_vrec_width, pgfip, pgr_ptrs[tidx], cur_pgr_alloc);
+        if (unlikely(reterr)) {
+          pgfip->shared_ff = shared_ff_copy;
+          logputs("\n");
+          if (reterr == kPglRetOpenFail) {
+            logerrprintfww(kErrprintfFopen, pgenname, strerror(errno));
+          } else {
+            logerrprintfww(kErrprintfFread, pgenname, rstrerror(errno));
+          }
+          goto ValidatePgen_ret_1;
+        }
+      }
+      pgfip->shared_ff = shared_ff_copy;
+      ctx.pgr_ptrs = pgr_ptrs;
+    }
+    if (unlikely(SetThreadCt(calc_thread_ct, &tg))) {
+      goto ValidatePgen_ret_NOMEM;
+    }
+    SetThreadFuncAndData(ValidatePgenThread, &ctx, &tg);
+    DeclareLastThreadBlock(&tg);
+    if (unlikely(SpawnThreads(&tg))) {
+      goto ValidatePgen_ret_THREAD_CREATE_FAIL;
+    }
+    JoinThreads(&tg);
+    for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
+      reterr = ctx.reterrs[tidx];
+      if (unlikely(reterr)) {
+        strcpy(g_logbuf, ctx.errstr_bufs[tidx]);
+        goto ValidatePgen_ret_PGEN_ERRSTR;
+      }
+    }
+    if (check_only) {
+      uint32_t mismatch_ct = 0;
+      for (uint32_t region_idx = 0; region_idx <= vblock_ct; ++region_idx) {
+        mismatch_ct += (region_hashes[region_idx] != expected_hashes[region_idx]);
+      }
+      if (unlikely(mismatch_ct)) {
+        logputs("\n");
+        logerrprintfww("Error: %u/%u checksum regions of %s don't match %s:\n", mismatch_ct, vblock_ct + 1, pgenname, sidecar_fname);
+        for (uint32_t region_idx = 0; region_idx <= vblock_ct; ++region_idx) {
+          if (region_hashes[region_idx] == expected_hashes[region_idx]) {
+            continue;
+          }
+          if (!region_idx) {
+            logerrputs("  header\n");
+          } else {
+            const uint32_t vidx_start = (region_idx - 1) * kPglVblockSize;
+            const uint32_t vidx_last = MINV(vidx_start + kPglVblockSize, variant_ct) - 1;
+            logerrprintf("  vblock %u (variants #%u-#%u)\n", region_idx - 1, vidx_start + 1, vidx_last + 1);
+          }
+        }
+        goto ValidatePgen_ret_MALFORMED_INPUT;
+      }
+    }
+    logputs("done.\n");
+    if (flags & kfValidateChecksumWrite) {
+      if (unlikely(fopen_checked(sidecar_fname, FOPEN_WB, &outfile))) {
+        goto ValidatePgen_ret_OPEN_FAIL;
+      }
+      char* write_iter = strcpya_k(g_textbuf, "#REGION\tSTART\tEND\tXXH64" EOLN_STR);
+      char* textbuf_flush = &(g_textbuf[kMaxMediumLine]);
+      for (uint32_t region_idx = 0; region_idx <= vblock_ct; ++region_idx) {
+        write_iter = AppendValidateRegionPrefix(region_fpos, region_idx, write_iter);
+        write_iter = hex64toa(region_hashes[region_idx], write_iter);
+        AppendBinaryEoln(&write_iter);
+        if (unlikely(fwrite_ck(textbuf_flush, outfile, &write_iter))) {
+          goto ValidatePgen_ret_WRITE_FAIL;
+        }
+      }
+      if (unlikely(fclose_flush_null(textbuf_flush, write_iter, &outfile))) {
+        goto ValidatePgen_ret_WRITE_FAIL;
+      }
+      logprintfww("Checksums written to %s .\n", sidecar_fname);
+    }
+  }
+  while (0) {
+  ValidatePgen_ret_NOMEM:
+    reterr = kPglRetNomem;
+    break;
+  ValidatePgen_ret_OPEN_FAIL:
+    reterr = kPglRetOpenFail;
+    break;
+  ValidatePgen_ret_PGEN_READ_FAIL:
+    logputs("\n");
+    logerrprintfww(kErrprintfFread, pgenname, rstrerror(errno));
+    reterr = kPglRetReadFail;
+    break;
+  ValidatePgen_ret_TFILE_FAIL:
+    logputs("\n");
+    TextFileErrPrint(sidecar_fname, &sidecar_txf);
+    break;
+  ValidatePgen_ret_WRITE_FAIL:
+    reterr = kPglRetWriteFail;
+    break;
+  ValidatePgen_ret_PGEN_ERRSTR:
+    logputs("\n");
+    WordWrapB(0);
+    logerrputsb();
+    break;
+  ValidatePgen_ret_MALFORMED_INPUT:
+    reterr = kPglRetMalformedInput;
+    break;
+  ValidatePgen_ret_INCONSISTENT_INPUT:
+    reterr = kPglRetInconsistentInput;
+    break;
+  ValidatePgen_ret_THREAD_CREATE_FAIL:
+    reterr = kPglRetThreadCreateFail;
+    break;
+  }
+ ValidatePgen_ret_1:
+  CleanupThreads(&tg);
+  if (pgr_ptrs) {
+    for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
+      CleanupPgr(pgr_ptrs[tidx], &reterr);
+    }
+  }
+  CleanupTextFile(&sidecar_txf, &reterr);
+  fclose_cond(pgen_ff);
+  fclose_cond(outfile);
+  BigstackReset(bigstack_mark);
+  return reterr;
+}
+
 uint32_t MultireadNonempty(const uintptr_t* variant_include, const ThreadGroup* tgp, uint32_t raw_variant_ct, uint32_t read_block_size, PgenFileInfo* pgfip, uint32_t* read_block_idxp, PglErr* reterrp) {
   if (IsLastBlock(tgp)) {
     return 0;
@@ -3154,6 +4023,121 @@ char* PrintMultiallelicHcAsHaploidDs(uint32_t hc1, uint32_t hc2, uint32_t allele
   return &(start[-1]);
 }
 
+void PreinitSmajTiles(SmajTileInfo* stip) {
+  stip->ff = nullptr;
+  stip->tile_fpos = nullptr;
+}
+
+BoolErr GetFileSize(const char* fname, uint64_t* fsize_ptr) {
+  FILE* ff = fopen(fname, FOPEN_RB);
+  if (unlikely(!ff)) {
+    return 1;
+  }
+  if (unlikely(fseeko(ff, 0, SEEK_END))) {
+    fclose(ff);
+    return 1;
+  }
+  const int64_t fsize = ftello(ff);
+  fclose(ff);
+  if (unlikely(fsize < 0)) {
+    return 1;
+  }
+  *fsize_ptr = fsize;
+  return 0;
+}
+
+PglErr SmajTilesOpen(const char* pgenname, uint32_t raw_sample_ct, uint32_t raw_variant_ct, SmajTileInfo* stip) {
+  unsigned char* bigstack_mark = g_bigstack_base;
+  PglErr reterr = kPglRetSuccess;
+  {
+    char fname[kPglFnamesize];
+    const uint32_t pgenname_slen = strlen(pgenname);
+    if (unlikely(pgenname_slen + 6 > kPglFnamesize)) {
+      logerrputs("Warning: --smaj-tiles filename too long; ignoring.\n");
+      goto SmajTilesOpen_ret_SKIPPED;
+    }
+    snprintf(memcpya(fname, pgenname, pgenname_slen), 6, ".smaj");
+    stip->ff = fopen(fname, FOPEN_RB);
+    if (!stip->ff) {
+      logerrprintfww("Warning: %s not found; ignoring --smaj-tiles.\n", fname);
+      goto SmajTilesOpen_ret_SKIPPED;
+    }
+    unsigned char header[kSmajTileHeaderByteCt];
+    if (unlikely(fread_checked(header, kSmajTileHeaderByteCt, stip->ff))) {
+      goto SmajTilesOpen_ret_READ_FAIL;
+    }
+    uint32_t sample_ct;
+    uint32_t variant_ct;
+    uint32_t tile_sample_ct;
+    uint32_t tile_variant_ct;
+    uint64_t pgen_fsize;
+    memcpy(&sample_ct, &(header[3]), sizeof(int32_t));
+    memcpy(&variant_ct, &(header[7]), sizeof(int32_t));
+    memcpy(&tile_sample_ct, &(header[11]), sizeof(int32_t));
+    memcpy(&tile_variant_ct, &(header[15]), sizeof(int32_t));
+    memcpy(&pgen_fsize, &(header[19]), sizeof(int64_t));
+    if (unlikely(memcmp(header, "l\x1b\x40", 3) || (tile_sample_ct != kSmajTileSampleCt) || (tile_variant_ct != kSmajTileVariantCt))) {
+      logerrprintfww("Warning: %s is not a sample-major tile file written by this version of " PROG_NAME_STR "; ignoring --smaj-tiles.\n", fname);
+      goto SmajTilesOpen_ret_SKIPPED;
+    }
+    uint64_t cur_pgen_fsize;
+    if (unlikely(GetFileSize(pgenname, &cur_pgen_fsize))) {
+      goto SmajTilesOpen_ret_READ_FAIL;
+    }
+    if ((sample_ct != raw_sample_ct) || (variant_ct != raw_variant_ct) || (pgen_fsize != cur_pgen_fsize)) {
+      logerrprintfww("Warning: %s does not match %s; ignoring --smaj-tiles.\n", fname, pgenname);
+      goto SmajTilesOpen_ret_SKIPPED;
+    }
+    stip->sample_ct = sample_ct;
+    stip->variant_ct = variant_ct;
+    stip->sblock_ct = DivUp(sample_ct, kSmajTileSampleCt);
+    stip->vblock_ct = DivUp(variant_ct, kSmajTileVariantCt);
+    const uintptr_t tile_ct = S_CAST(uintptr_t, stip->sblock_ct) * stip->vblock_ct;
+    if (unlikely(bigstack_alloc_u64(tile_ct + 1, &stip->tile_fpos))) {
+      goto SmajTilesOpen_ret_NOMEM;
+    }
+    if (unlikely(fread_checked(stip->tile_fpos, (tile_ct + 1) * sizeof(int64_t), stip->ff))) {
+      goto SmajTilesOpen_ret_READ_FAIL;
+    }
+    uint64_t prev_fpos = kSmajTileHeaderByteCt + (tile_ct + 1) * sizeof(int64_t);
+    for (uintptr_t tile_idx = 0; tile_idx <= tile_ct; ++tile_idx) {
+      const uint64_t cur_fpos = stip->tile_fpos[tile_idx];
+      if (unlikely(cur_fpos < prev_fpos)) {
+        logerrprintfww("Error: Malformed %s .\n", fname);
+        goto SmajTilesOpen_ret_MALFORMED_INPUT;
+      }
+      prev_fpos = cur_fpos;
+    }
+  }
+  while (0) {
+  SmajTilesOpen_ret_NOMEM:
+    reterr = kPglRetNomem;
+    break;
+  SmajTilesOpen_ret_READ_FAIL:
+    logerrprintfww(kErrprintfFread, ".smaj file", rstrerror(errno));
+    reterr = kPglRetReadFail;
+    break;
+  SmajTilesOpen_ret_MALFORMED_INPUT:
+    reterr = kPglRetMalformedInput;
+    break;
+  SmajTilesOpen_ret_SKIPPED:
+    reterr = kPglRetSkipped;
+    break;
+  }
+  if (reterr) {
+    fclose_cond(stip->ff);
+    stip->ff = nullptr;
+    stip->tile_fpos = nullptr;
+    BigstackReset(bigstack_mark);
+  }
+  return reterr;
+}
+
+void CleanupSmajTiles(SmajTileInfo* stip) {
+  fclose_cond(stip->ff);
+  stip->ff = nullptr;
+}
+
 const char g_vft_names[3][18] = {"extract", "extract-intersect", "exclude"};
 
 #ifdef __cplusplus
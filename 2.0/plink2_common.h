@@ -138,7 +138,10 @@ FLAGSET64_DEF_START()
   kfMiscIidSid = (1LLU << 40),
   kfMiscPhenoIidOnly = (1LLU << 41),
   kfMiscCovarIidOnly = (1LLU << 42),
-  kfMiscAllowBadLd = (1LLU << 43)
+  kfMiscAllowBadLd = (1LLU << 43),
+  kfMiscSmajTiles = (1LLU << 44),
+  kfMiscSampleIdIndex = (1LLU << 45),
+  kfMiscPhenoCache = (1LLU << 46)
 FLAGSET64_DEF_END(MiscFlags);
 
 FLAGSET64_DEF_START()
@@ -226,6 +229,12 @@ FLAGSET_DEF_START()
   kfPsamColAll = ((kfPsamColPhenos * 2) - kfPsamColMaybefid)
 FLAGSET_DEF_END(PvarPsamFlags);
 
+FLAGSET_DEF_START()
+  kfValidate0,
+  kfValidateChecksumWrite = (1 << 0),
+  kfValidateChecksumCheck = (1 << 1)
+FLAGSET_DEF_END(ValidateFlags);
+
 FLAGSET_DEF_START()
   kfSampleId0,
   kfSampleIdFidPresent = (1 << 0),
@@ -539,6 +548,106 @@ HEADER_INLINE BoolErr SortedXidboxReadFind(const char* __restrict sorted_xidbox,
 // sample_uidx conversions.)
 BoolErr SortedXidboxReadMultifind(const char* __restrict sorted_xidbox, uintptr_t max_xid_blen, uintptr_t xid_ct, uint32_t comma_delim, XidMode xid_mode, const char** read_pp, uint32_t* __restrict xid_idx_start_ptr, uint32_t* __restrict xid_idx_end_ptr, char* __restrict idbuf);
 
+// Hash table alternative to the sorted xidbox, for exact-match lookups.
+// Construction is linear-time and multithreaded (no sort), which matters for
+// biobank-scale sample counts.  Duplicate IDs are retained when allow_dups is
+// set, so an FID/IID pair can map to several FID/IID/SID samples; iterate over
+// them via htable_dup_base as in VariantIdDupHtableFind().
+typedef struct XidHtableStruct {
+  const char** xids;  // indexed by sample_uidx
+  const uint32_t* htable;
+  const uint32_t* htable_dup_base;
+  // nullptr unless the table covers samples outside sample_include (i.e. it
+  // came from a --sample-id-index file); matches are then restricted to this
+  // set.
+  const uintptr_t* subset_mask;
+  uintptr_t max_xid_blen;
+  uint32_t htable_size;
+} XidHtable;
+
+// Sample ID index file (<.psam/.fam filename>.xidx), written and used by
+// --sample-id-index.  It holds XidHtable hash tables over all samples in the
+// file, so that later runs can skip hash table construction.  Layout:
+//   3-byte magic "l\x1b\x41"
+//   1 byte: 1 if the FID/IID/SID table is present, 0 otherwise
+//   uint32 raw_sample_ct
+//   uint64 XXH64 of the FID/IID (and SID, if present) strings
+//   for each table (FID/IID, then FID/IID/SID): uint32 htable_size,
+//     uint32 dup_ct, uint64 table byte count
+//   table contents (htable, then htable_dup_base), each starting at a
+//     kXidIndexHeaderByteCt-aligned offset
+// Native byte order.  Staleness is detected by comparing sample count and ID
+// hash against the loaded sample IDs; table entries are range-checked when the
+// file is mapped, and a malformed file is rebuilt.
+CONSTI32(kXidIndexHeaderByteCt, 64);
+
+typedef struct XidIndexStruct {
+  NONCOPYABLE(XidIndexStruct);
+  unsigned char* base;
+  uintptr_t byte_ct;
+  const uint32_t* htables[2];
+  uint32_t htable_sizes[2];
+  uint32_t dup_cts[2];
+  uint32_t is_mmapped;
+} XidIndex;
+
+void PreinitXidIndex(XidIndex* xidxp);
+
+// Maps <psamname>.xidx, first (re)writing it if it's absent or doesn't match
+// siip.  Returns kPglRetSkipped (after printing a warning) if the index can't
+// be written or read; the in-memory hash tables are then used as usual.
+PglErr XidIndexLoadOrCreate(const char* psamname, const SampleIdInfo* siip, uint32_t raw_sample_ct, uint32_t max_thread_ct, XidIndex* xidxp);
+
+void CleanupXidIndex(XidIndex* xidxp);
+
+// XXH64 of all sample IDs (and SIDs, if present), for detecting stale
+// sidecar files.
+uint64_t SampleIdsXxh64(const SampleIdInfo* siip, uint32_t raw_sample_ct);
+
+// Maps fname read-only, or reads it into a malloc'd buffer when mmap() isn't
+// available.  Returns 1 if the file is absent, empty, or unreadable.
+BoolErr MapFileReadonly(const char* fname, unsigned char** base_ptr, uintptr_t* byte_ct_ptr, uint32_t* is_mmapped_ptr);
+
+void UnmapFileReadonly(unsigned char* base, uintptr_t byte_ct, uint32_t is_mmapped);
+
+// Sidecar files are written to tmp_fname and then renamed to fname, so other
+// jobs never map a partially written file.  Returns 1 if fname is too long.
+BoolErr TmpFnameInit(const char* fname, char* tmp_fname);
+
+// Allocates on bottom of bigstack.  xidxp may be nullptr; if it isn't, and it
+// has a suitable table, no hash table is constructed.
+PglErr XidHtableInitAlloc(const uintptr_t* sample_include, const SampleIdInfo* siip, const XidIndex* xidxp, uint32_t raw_sample_ct, uint32_t sample_ct, uint32_t allow_dups, XidMode xid_mode, uint32_t max_thread_ct, XidHtable* xid_htable_ptr);
+
+// Same return-value semantics as SortedXidboxReadFind().  *llidx_ptr is set to
+// UINT32_MAX if the ID is unique, otherwise it's the position in
+// htable_dup_base[] of the {sample_uidx, next_llidx} entry to continue from.
+HEADER_INLINE BoolErr XidHtableReadFind(const XidHtable* xid_htable_ptr, uint32_t comma_delim, XidMode xid_mode, const char** read_pp, uint32_t* sample_uidx_ptr, uint32_t* llidx_ptr, char* __restrict idbuf) {
+  const uintptr_t max_xid_blen = xid_htable_ptr->max_xid_blen;
+  const uint32_t slen_final = XidRead(max_xid_blen, comma_delim, xid_mode, read_pp, idbuf);
+  if (!slen_final) {
+    return 1;
+  }
+  uint32_t sample_uidx = VariantIdDupHtableFind(idbuf, xid_htable_ptr->xids, xid_htable_ptr->htable, xid_htable_ptr->htable_dup_base, slen_final, xid_htable_ptr->htable_size, max_xid_blen - 1, llidx_ptr);
+  if (sample_uidx == UINT32_MAX) {
+    return 1;
+  }
+  const uintptr_t* subset_mask = xid_htable_ptr->subset_mask;
+  if (subset_mask) {
+    // skip to the first match in the subset
+    uint32_t llidx = *llidx_ptr;
+    while (!IsSet(subset_mask, sample_uidx)) {
+      if (llidx == UINT32_MAX) {
+        return 1;
+      }
+      sample_uidx = xid_htable_ptr->htable_dup_base[llidx];
+      llidx = xid_htable_ptr->htable_dup_base[llidx + 1];
+    }
+    *llidx_ptr = llidx;
+  }
+  *sample_uidx_ptr = sample_uidx;
+  return 0;
+}
+
 FLAGSET_DEF_START()
   kfXidHeader0,
 
@@ -1033,6 +1142,15 @@ uintptr_t GetMhcWordCt(uintptr_t sample_ct);
 // only possible error is kPglRetNomem for now
 PglErr PgenMtLoadInit(const uintptr_t* variant_include, uint32_t sample_ct, uint32_t variant_ct, uintptr_t bytes_avail, uintptr_t pgr_alloc_cacheline_ct, uintptr_t thread_xalloc_cacheline_ct, uintptr_t per_variant_xalloc_byte_ct, uintptr_t per_alt_allele_xalloc_byte_ct, PgenFileInfo* pgfip, uint32_t* calc_thread_ct_ptr, uintptr_t*** genovecs_ptr, uintptr_t*** mhc_ptr, uintptr_t*** phasepresent_ptr, uintptr_t*** phaseinfo_ptr, uintptr_t*** dosage_present_ptr, Dosage*** dosage_mains_ptr, uintptr_t*** dphase_present_ptr, SDosage*** dphase_delta_ptr, uint32_t* read_block_size_ptr, uintptr_t* max_alt_allele_block_size_ptr, STD_ARRAY_REF(unsigned char*, 2) main_loadbufs, PgenReader*** pgr_pps, uint32_t** read_variant_uidx_starts_ptr);
 
+// --validate.  Variant records are checked on up to max_thread_ct threads,
+// one vblock range and PgenReader per thread.  With kfValidateChecksumWrite,
+// a per-vblock XXH64 checksum sidecar (<pgenname>.xxh64) is also written
+// after successful validation; with kfValidateChecksumCheck, the .pgen is
+// only compared against that sidecar, and every mismatching vblock is
+// reported.
+// pgfip->shared_ff may be open; it's temporarily set aside.
+PglErr ValidatePgen(const char* pgenname, ValidateFlags flags, uint32_t max_vrec_width, uintptr_t pgr_alloc_cacheline_ct, uint32_t max_thread_ct, PgenFileInfo* pgfip, PgenReader* simple_pgrp);
+
 // Returns number of variants in current block.  Increases read_block_idx as
 // necessary (to get to a nonempty block).
 uint32_t MultireadNonempty(const uintptr_t* variant_include, const ThreadGroup* tgp, uint32_t raw_variant_ct, uint32_t read_block_size, PgenFileInfo* pgfip, uint32_t* read_block_idxp, PglErr* reterrp);
@@ -1146,6 +1264,43 @@ HEADER_INLINE BoolErr CleanupPgr2(const char* file_descrip, PgenReader* pgrp, Pg
   return 0;
 }
 
+// Sample-major tile companion file (<.pgen filename>.smaj), written by
+// --make-[b]pgen 'smaj-tiles'.  Layout:
+//   3-byte magic "l\x1b\x40"
+//   uint32 sample_ct, variant_ct, tile sample count, tile variant count
+//   uint64 size of the .pgen file it was generated alongside
+//   uint64 tile_fpos[sblock_ct * vblock_ct + 1], sample-block-major
+//   Zstd-compressed tiles.
+// A decompressed tile is a sequence of sample rows, each
+// NypCtToWordCt(kSmajTileVariantCt) words long (shorter in the last variant
+// block), containing the sample's hardcalls in plink2 order with trailing
+// nyps zeroed.
+CONSTI32(kSmajTileSampleCt, 64);
+CONSTI32(kSmajTileVariantCt, 65536);
+CONSTI32(kSmajTileHeaderByteCt, 27);
+CONSTI32(kSmajTileVariantWordCt, kSmajTileVariantCt / kBitsPerWordD2);
+
+typedef struct SmajTileInfoStruct {
+  NONCOPYABLE(SmajTileInfoStruct);
+  FILE* ff;
+  uint32_t sample_ct;
+  uint32_t variant_ct;
+  uint32_t sblock_ct;
+  uint32_t vblock_ct;
+  uint64_t* tile_fpos;
+} SmajTileInfo;
+
+void PreinitSmajTiles(SmajTileInfo* stip);
+
+BoolErr GetFileSize(const char* fname, uint64_t* fsize_ptr);
+
+// Opens <pgenname>.smaj and loads its tile index onto the bigstack.  Returns
+// kPglRetSkipped (after printing a warning) if the file is absent, or doesn't
+// match raw_sample_ct/raw_variant_ct and the current .pgen's size.
+PglErr SmajTilesOpen(const char* pgenname, uint32_t raw_sample_ct, uint32_t raw_variant_ct, SmajTileInfo* stip);
+
+void CleanupSmajTiles(SmajTileInfo* stip);
+
 HEADER_INLINE void PgenErrPrintNEx(const char* file_descrip, PglErr reterr) {
   if (reterr == kPglRetReadFail) {
     logputs("\n");
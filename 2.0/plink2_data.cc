@@ -18,6 +18,7 @@
 #include "include/pgenlib_write.h"
 #include "plink2_compress_stream.h"
 #include "plink2_data.h"
+#include "plink2_filter.h"
 #include "plink2_pvar.h"
 
 #include <time.h>
@@ -1723,6 +1724,13 @@ typedef struct LoadAlleleAndGenoCountsCtxStruct {
   STD_ARRAY_PTR_DECL(uint32_t, 3, x_nosex_geno_cts);
   STD_ARRAY_PTR_DECL(uint32_t, 3, founder_x_nosex_geno_cts);
   double* imp_r2_vals;
+
+  // non-null iff --missing's sample counts are being collected in this pass
+  SampleMissingAcc* sample_missing_accs;
+  const uintptr_t* sample_missing_sex_male;
+  // (variant_uidx << 32) | reterr of the earliest record the sample-missing
+  // update failed on, as in LoadSampleMissingCts()
+  uint64_t sample_missing_err_info;
 } LoadAlleleAndGenoCountsCtx;
 
 THREAD_FUNC_DECL LoadAlleleAndGenoCountsThread(void* raw_arg) {
@@ -1762,11 +1770,27 @@ THREAD_FUNC_DECL LoadAlleleAndGenoCountsThread(void* raw_arg) {
     const uint32_t x_chr_fo_idx = cip->chr_idx_to_foidx[x_code];
     x_start = cip->chr_fo_vidx_start[x_chr_fo_idx];
   }
+  SampleMissingAcc* sample_missing_accp = nullptr;
+  if (ctx->sample_missing_accs) {
+    sample_missing_accp = &(ctx->sample_missing_accs[tidx]);
+    SampleMissingAccInit(raw_sample_ct, sample_missing_accp);
+  }
   uint32_t allele_ct = 2;
   do {
     const uintptr_t cur_block_size = ctx->cur_block_size;
     // no overflow danger since cur_block_size <= 2^16, tidx < (2^16 - 1)
     const uint32_t cur_idx_end = ((tidx + 1) * cur_block_size) / thread_ct;
+    if (sample_missing_accp) {
+      // same variants, same (already-loaded) records; raw sample indexes
+      const uint32_t cur_idx_ct = cur_idx_end - ((tidx * cur_block_size) / thread_ct);
+      uint32_t err_variant_uidx;
+      const PglErr reterr = SampleMissingAccUpdate(variant_include, cip, ctx->sample_missing_sex_male, raw_sample_ct, ctx->read_variant_uidx_starts[tidx], cur_idx_ct, pgrp, pgv.genovec, sample_missing_accp, &err_variant_uidx);
+      if (unlikely(reterr)) {
+        const uint64_t new_err_info = (S_CAST(uint64_t, err_variant_uidx) << 32) | S_CAST(uint32_t, reterr);
+        UpdateU64IfSmaller(new_err_info, &ctx->sample_missing_err_info);
+        continue;
+      }
+    }
     const uintptr_t* sample_include = ctx->sample_include;
     const uintptr_t* sample_include_interleaved_vec = ctx->sample_include_interleaved_vec;
     const uint32_t* sample_include_cumulative_popcounts = ctx->sample_include_cumulative_popcounts;
@@ -2313,10 +2337,13 @@ THREAD_FUNC_DECL LoadAlleleAndGenoCountsThread(void* raw_arg) {
       imp_r2_vals = nullptr;
     }
   } while (!THREAD_BLOCK_FINISH(arg));
+  if (sample_missing_accp) {
+    SampleMissingAccFinish(raw_sample_ct, sample_missing_accp);
+  }
   THREAD_RETURN;
 }
 
-PglErr LoadAlleleAndGenoCounts(const uintptr_t* sample_include, const uintptr_t* founder_info, const uintptr_t* sex_nm, const uintptr_t* sex_male, const uintptr_t* variant_include, const ChrInfo* cip, const uintptr_t* allele_idx_offsets, uint32_t raw_sample_ct, uint32_t sample_ct, uint32_t founder_ct, uint32_t male_ct, uint32_t nosex_ct, uint32_t raw_variant_ct, uint32_t variant_ct, uint32_t first_hap_uidx, uint32_t is_minimac3_r2, uint32_t max_thread_ct, uintptr_t pgr_alloc_cacheline_ct, PgenFileInfo* pgfip, uintptr_t* allele_presents, uint64_t* allele_ddosages, uint64_t* founder_allele_ddosages, uint32_t* variant_missing_hc_cts, uint32_t* variant_missing_dosage_cts, uint32_t* variant_hethap_cts, STD_ARRAY_PTR_DECL(uint32_t, 3, raw_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, founder_raw_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, x_male_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, founder_x_male_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, x_nosex_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, founder_x_nosex_geno_cts), double* imp_r2_vals) {
+PglErr LoadAlleleAndGenoCounts(const uintptr_t* sample_include, const uintptr_t* founder_info, const uintptr_t* sex_nm, const uintptr_t* sex_male, const uintptr_t* variant_include, const ChrInfo* cip, const uintptr_t* allele_idx_offsets, uint32_t raw_sample_ct, uint32_t sample_ct, uint32_t founder_ct, uint32_t male_ct, uint32_t nosex_ct, uint32_t raw_variant_ct, uint32_t variant_ct, uint32_t first_hap_uidx, uint32_t is_minimac3_r2, uint32_t max_thread_ct, uintptr_t pgr_alloc_cacheline_ct, PgenFileInfo* pgfip, uintptr_t* allele_presents, uint64_t* allele_ddosages, uint64_t* founder_allele_ddosages, uint32_t* variant_missing_hc_cts, uint32_t* variant_missing_dosage_cts, uint32_t* variant_hethap_cts, STD_ARRAY_PTR_DECL(uint32_t, 3, raw_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, founder_raw_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, x_male_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, founder_x_male_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, x_nosex_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, founder_x_nosex_geno_cts), double* imp_r2_vals, uint32_t* sample_missing_hc_cts, uint32_t* sample_missing_dosage_cts, uint32_t* sample_hethap_cts) {
   unsigned char* bigstack_mark = g_bigstack_base;
   unsigned char* bigstack_end_mark = g_bigstack_end;
   PglErr reterr = kPglRetSuccess;
@@ -2324,6 +2351,13 @@ PglErr LoadAlleleAndGenoCounts(const uintptr_t* sample_include, const uintptr_t*
   PreinitThreads(&tg);
   LoadAlleleAndGenoCountsCtx ctx;
   {
+    if (sample_missing_hc_cts && ((!variant_ct) || (!sample_ct))) {
+      ZeroU32Arr(raw_sample_ct, sample_missing_hc_cts);
+      if (sample_missing_dosage_cts) {
+        ZeroU32Arr(raw_sample_ct, sample_missing_dosage_cts);
+      }
+      ZeroU32Arr(raw_sample_ct, sample_hethap_cts);
+    }
     if (!variant_ct) {
       goto LoadAlleleAndGenoCounts_ret_1;
     }
@@ -2339,6 +2373,8 @@ PglErr LoadAlleleAndGenoCounts(const uintptr_t* sample_include, const uintptr_t*
     //    memory, ditto for founder_raw_geno_cts/raw_geno_cts.
     const uint32_t only_founder_cts_required = (!allele_presents) && (!allele_ddosages) && (!raw_geno_cts) && (!variant_missing_hc_cts) && (!variant_missing_dosage_cts);
     const uint32_t two_subsets_required = (founder_ct != sample_ct) && (!only_founder_cts_required) && (founder_allele_ddosages || founder_raw_geno_cts);
+    // sample missingness counts are only fused into the regular pass
+    assert((!sample_missing_hc_cts) || (!only_founder_cts_required));
     ctx.cip = cip;
     ctx.sample_include = only_founder_cts_required? founder_info : sample_include;
     ctx.raw_sample_ct = raw_sample_ct;
@@ -2528,15 +2564,31 @@ PglErr LoadAlleleAndGenoCounts(const uintptr_t* sample_include, const uintptr_t*
     } else {
       ctx.all_dosages = nullptr;
     }
+    ctx.sample_missing_accs = nullptr;
+    ctx.sample_missing_sex_male = sex_male;
+    ctx.sample_missing_err_info = (~0LLU) << 32;
+    uintptr_t thread_alloc_cacheline_ct = 0;
+    if (sample_missing_hc_cts) {
+      ctx.sample_missing_accs = S_CAST(SampleMissingAcc*, bigstack_alloc(calc_thread_ct * sizeof(SampleMissingAcc)));
+      if (unlikely(!ctx.sample_missing_accs)) {
+        goto LoadAlleleAndGenoCounts_ret_NOMEM;
+      }
+      thread_alloc_cacheline_ct = CountSampleMissingAccCachelines(raw_sample_ct, (sample_missing_dosage_cts != nullptr));
+    }
     STD_ARRAY_DECL(unsigned char*, 2, main_loadbufs);
     // defensive
     ctx.dosage_presents = nullptr;
     ctx.dosage_mains = nullptr;
     uint32_t read_block_size;
     // todo: check if raw_sample_ct should be replaced with sample_ct here
-    if (unlikely(PgenMtLoadInit(variant_include, raw_sample_ct, variant_ct, bigstack_left(), pgr_alloc_cacheline_ct, 0, 0, 0, pgfip, &calc_thread_ct, &ctx.genovecs, mhc_needed? (&ctx.thread_read_mhc) : nullptr, nullptr, nullptr, xy_dosages_needed? (&ctx.dosage_presents) : nullptr, xy_dosages_needed? (&ctx.dosage_mains) : nullptr, nullptr, nullptr, &read_block_size, nullptr, main_loadbufs, &ctx.pgr_ptrs, &ctx.read_variant_uidx_starts))) {
+    if (unlikely(PgenMtLoadInit(variant_include, raw_sample_ct, variant_ct, bigstack_left(), pgr_alloc_cacheline_ct, thread_alloc_cacheline_ct, 0, 0, pgfip, &calc_thread_ct, &ctx.genovecs, mhc_needed? (&ctx.thread_read_mhc) : nullptr, nullptr, nullptr, xy_dosages_needed? (&ctx.dosage_presents) : nullptr, xy_dosages_needed? (&ctx.dosage_mains) : nullptr, nullptr, nullptr, &read_block_size, nullptr, main_loadbufs, &ctx.pgr_ptrs, &ctx.read_variant_uidx_starts))) {
       goto LoadAlleleAndGenoCounts_ret_NOMEM;
     }
+    if (ctx.sample_missing_accs) {
+      for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
+        SampleMissingAccAlloc(raw_sample_ct, (sample_missing_dosage_cts != nullptr), &(ctx.sample_missing_accs[tidx]));
+      }
+    }
     if (unlikely(SetThreadCt(calc_thread_ct, &tg))) {
       goto LoadAlleleAndGenoCounts_ret_NOMEM;
     }
@@ -2545,7 +2597,7 @@ PglErr LoadAlleleAndGenoCounts(const uintptr_t* sample_include, const uintptr_t*
     ctx.reterr = kPglRetSuccess;
     SetThreadFuncAndData(LoadAlleleAndGenoCountsThread, &ctx, &tg);
 
-    logputs("Calculating allele frequencies... ");
+    logputs(ctx.sample_missing_accs? "Calculating allele frequencies and sample missingness rates... " : "Calculating allele frequencies... ");
     fputs("0%", stdout);
     fflush(stdout);
     uint32_t pct = 0;
@@ -2561,6 +2613,9 @@ PglErr LoadAlleleAndGenoCounts(const uintptr_t* sample_include, const uintptr_t*
       if (variant_idx) {
         JoinThreads(&tg);
         reterr = ctx.reterr;
+        if (!reterr) {
+          reterr = S_CAST(PglErr, ctx.sample_missing_err_info);
+        }
         if (unlikely(reterr)) {
           goto LoadAlleleAndGenoCounts_ret_PGR_FAIL;
         }
@@ -2621,6 +2676,9 @@ PglErr LoadAlleleAndGenoCounts(const uintptr_t* sample_include, const uintptr_t*
       }
 #endif
     }
+    if (ctx.sample_missing_accs) {
+      SampleMissingAccReduce(raw_sample_ct, calc_thread_ct, ctx.sample_missing_accs, sample_missing_hc_cts, sample_missing_dosage_cts, sample_hethap_cts);
+    }
     if (pct > 10) {
       putc_unlocked('\b', stdout);
     }
@@ -2645,6 +2703,305 @@ PglErr LoadAlleleAndGenoCounts(const uintptr_t* sample_include, const uintptr_t*
   return reterr;
 }
 
+uint32_t LoopCatsGenoCountsAreFusable(const uintptr_t* variant_include, const ChrInfo* cip, const uintptr_t* allele_idx_offsets, const PgenFileInfo* pgfip) {
+  if (allele_idx_offsets || (pgfip->gflags & kfPgenGlobalDosagePresent)) {
+    return 0;
+  }
+  const uint32_t x_code = cip->xymt_codes[kChrOffsetX];
+  const uint32_t y_code = cip->xymt_codes[kChrOffsetY];
+  for (uint32_t chr_fo_idx = 0; chr_fo_idx != cip->chr_ct; ++chr_fo_idx) {
+    const uint32_t chr_idx = cip->chr_file_order[chr_fo_idx];
+    if ((chr_idx == x_code) || (chr_idx == y_code) || IsSet(cip->haploid_mask, chr_idx)) {
+      if (!AllBitsAreZero(variant_include, cip->chr_fo_vidx_start[chr_fo_idx], cip->chr_fo_vidx_start[chr_fo_idx + 1])) {
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+typedef struct LoadLoopCatsGenoCountsCtxStruct {
+  const uintptr_t* variant_include;
+  const uintptr_t* subset_interleaved_vecs;
+  const uint32_t* subset_sizes;
+  uint32_t subset_ct;
+  uint32_t cat_ct;
+  uint32_t variant_ct;
+
+  PgenReader** pgr_ptrs;
+  uintptr_t** genovecs;
+  uint32_t* read_variant_uidx_starts;
+  // subset_ct entries per thread
+  STD_ARRAY_PTR_DECL(uint32_t, 4, thread_genocounts);
+
+  uint32_t cur_block_size;
+  uint32_t cur_block_variant_idx_start;
+
+  PglErr reterr;
+
+  STD_ARRAY_PTR_DECL(uint32_t, 3, geno_cts);
+  STD_ARRAY_PTR_DECL(uint32_t, 3, founder_geno_cts);
+} LoadLoopCatsGenoCountsCtx;
+
+THREAD_FUNC_DECL LoadLoopCatsGenoCountsThread(void* raw_arg) {
+  ThreadGroupFuncArg* arg = S_CAST(ThreadGroupFuncArg*, raw_arg);
+  const uintptr_t tidx = arg->tidx;
+  LoadLoopCatsGenoCountsCtx* ctx = S_CAST(LoadLoopCatsGenoCountsCtx*, arg->sharedp->context);
+
+  const uintptr_t* variant_include = ctx->variant_include;
+  const uintptr_t* subset_interleaved_vecs = ctx->subset_interleaved_vecs;
+  const uint32_t* subset_sizes = ctx->subset_sizes;
+  const uint32_t thread_ct = GetThreadCt(arg->sharedp);
+  const uint32_t subset_ct = ctx->subset_ct;
+  const uint32_t cat_ct = ctx->cat_ct;
+  const uintptr_t variant_ct = ctx->variant_ct;
+  PgenReader* pgrp = ctx->pgr_ptrs[tidx];
+  uintptr_t* genovec = ctx->genovecs[tidx];
+  STD_ARRAY_PTR_DECL(uint32_t, 4, genocounts) = &(ctx->thread_genocounts[tidx * subset_ct]);
+  STD_ARRAY_PTR_DECL(uint32_t, 3, geno_cts) = ctx->geno_cts;
+  STD_ARRAY_PTR_DECL(uint32_t, 3, founder_geno_cts) = ctx->founder_geno_cts;
+  do {
+    const uint32_t cur_block_size = ctx->cur_block_size;
+    const uint32_t cur_idx_end = ((tidx + 1) * cur_block_size) / thread_ct;
+    uint32_t cur_idx = (tidx * cur_block_size) / thread_ct;
+    uintptr_t variant_idx = ctx->cur_block_variant_idx_start + cur_idx;
+    uintptr_t variant_uidx_base;
+    uintptr_t variant_include_bits;
+    BitIter1Start(variant_include, ctx->read_variant_uidx_starts[tidx], &variant_uidx_base, &variant_include_bits);
+    for (; cur_idx != cur_idx_end; ++cur_idx, ++variant_idx) {
+      const uint32_t variant_uidx = BitIter1(variant_include, &variant_uidx_base, &variant_include_bits);
+      const PglErr reterr = PgrGetCountsMulti(subset_interleaved_vecs, subset_sizes, subset_ct, variant_uidx, pgrp, genovec, genocounts);
+      if (unlikely(reterr)) {
+        ctx->reterr = reterr;
+        break;
+      }
+      for (uint32_t cat_idx = 0; cat_idx != cat_ct; ++cat_idx) {
+        STD_ARRAY_REF(uint32_t, 3) cur_geno_cts = geno_cts[cat_idx * variant_ct + variant_idx];
+        cur_geno_cts[0] = genocounts[cat_idx][0];
+        cur_geno_cts[1] = genocounts[cat_idx][1];
+        cur_geno_cts[2] = genocounts[cat_idx][2];
+      }
+      if (founder_geno_cts) {
+        for (uint32_t cat_idx = 0; cat_idx != cat_ct; ++cat_idx) {
+          STD_ARRAY_REF(uint32_t, 3) cur_geno_cts = founder_geno_cts[cat_idx * variant_ct + variant_idx];
+          cur_geno_cts[0] = genocounts[cat_ct + cat_idx][0];
+          cur_geno_cts[1] = genocounts[cat_ct + cat_idx][1];
+          cur_geno_cts[2] = genocounts[cat_ct + cat_idx][2];
+        }
+      }
+    }
+  } while (!THREAD_BLOCK_FINISH(arg));
+  THREAD_RETURN;
+}
+
+PglErr LoadLoopCatsGenoCounts(const uintptr_t* sample_include, const uintptr_t* founder_info, const PhenoCol* cat_pheno_col, const uintptr_t* cat_include, const uintptr_t* variant_include, uint32_t raw_sample_ct, uint32_t sample_ct, uint32_t cat_ct, uint32_t raw_variant_ct, uint32_t variant_ct, uint32_t max_thread_ct, uintptr_t pgr_alloc_cacheline_ct, PgenFileInfo* pgfip, LoopCatsGenoCounts* lcgcp) {
+  lcgcp->geno_cts = nullptr;
+  lcgcp->founder_geno_cts = nullptr;
+  lcgcp->cat_ct = cat_ct;
+  lcgcp->variant_ct = variant_ct;
+  if (!variant_ct) {
+    return kPglRetSuccess;
+  }
+  const uint32_t raw_sample_ctl = BitCtToWordCt(raw_sample_ct);
+  const uint32_t founder_ct = PopcountWordsIntersect(sample_include, founder_info, raw_sample_ctl);
+  const uint32_t subset_ct = cat_ct * (1 + (founder_ct != sample_ct));
+  const uintptr_t cts_byte_ct = RoundUpPow2(S_CAST(uintptr_t, cat_ct) * variant_ct * (3 * sizeof(int32_t)), kCacheline);
+  if (cts_byte_ct * (subset_ct / cat_ct) > bigstack_left() / 2) {
+    return kPglRetSuccess;
+  }
+  STD_ARRAY_PTR_DECL(uint32_t, 3, geno_cts);
+  STD_ARRAY_PTR_DECL(uint32_t, 3, founder_geno_cts) = nullptr;
+  if (unlikely(BIGSTACK_ALLOC_STD_ARRAY(uint32_t, 3, S_CAST(uintptr_t, cat_ct) * variant_ct, &geno_cts))) {
+    return kPglRetNomem;
+  }
+  if (subset_ct != cat_ct) {
+    if (unlikely(BIGSTACK_ALLOC_STD_ARRAY(uint32_t, 3, S_CAST(uintptr_t, cat_ct) * variant_ct, &founder_geno_cts))) {
+      return kPglRetNomem;
+    }
+  }
+  unsigned char* bigstack_mark = g_bigstack_base;
+  unsigned char* bigstack_end_mark = g_bigstack_end;
+  PglErr reterr = kPglRetSuccess;
+  ThreadGroup tg;
+  PreinitThreads(&tg);
+  LoadLoopCatsGenoCountsCtx ctx;
+  {
+    const uint32_t raw_sample_ctv = BitCtToVecCt(raw_sample_ct);
+    const uintptr_t mask_word_ct = raw_sample_ctv * kWordsPerVec;
+    uintptr_t* subset_interleaved_vecs;
+    uint32_t* subset_sizes;
+    uintptr_t* cur_cat_samples;
+    if (unlikely(
+            bigstack_alloc_w(subset_ct * mask_word_ct, &subset_interleaved_vecs) ||
+            bigstack_alloc_u32(subset_ct, &subset_sizes) ||
+            bigstack_end_alloc_w(raw_sample_ctl, &cur_cat_samples))) {
+      goto LoadLoopCatsGenoCounts_ret_NOMEM;
+    }
+    // same category order as the main --loop-cats loop
+    uint32_t cat_uidx = 0;
+    for (uint32_t cat_idx = 0; cat_idx != cat_ct; ++cat_idx) {
+      cat_uidx = AdvTo1Bit(cat_include, cat_uidx + 1);
+      subset_sizes[cat_idx] = GetCatSamples(sample_include, cat_pheno_col, raw_sample_ctl, sample_ct, cat_uidx, cur_cat_samples);
+      FillInterleavedMaskVec(cur_cat_samples, raw_sample_ctv, &(subset_interleaved_vecs[cat_idx * mask_word_ct]));
+      if (founder_geno_cts) {
+        BitvecAnd(founder_info, raw_sample_ctl, cur_cat_samples);
+        subset_sizes[cat_ct + cat_idx] = PopcountWords(cur_cat_samples, raw_sample_ctl);
+        FillInterleavedMaskVec(cur_cat_samples, raw_sample_ctv, &(subset_interleaved_vecs[(cat_ct + cat_idx) * mask_word_ct]));
+      }
+    }
+    BigstackEndReset(bigstack_end_mark);
+
+    uint32_t calc_thread_ct = (max_thread_ct > 2)? (max_thread_ct - 1) : max_thread_ct;
+    if (unlikely(BIGSTACK_ALLOC_STD_ARRAY(uint32_t, 4, subset_ct * calc_thread_ct, &ctx.thread_genocounts))) {
+      goto LoadLoopCatsGenoCounts_ret_NOMEM;
+    }
+    STD_ARRAY_DECL(unsigned char*, 2, main_loadbufs);
+    uint32_t read_block_size;
+    if (unlikely(PgenMtLoadInit(variant_include, raw_sample_ct, variant_ct, bigstack_left(), pgr_alloc_cacheline_ct, 0, 0, 0, pgfip, &calc_thread_ct, &ctx.genovecs, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &read_block_size, nullptr, main_loadbufs, &ctx.pgr_ptrs, &ctx.read_variant_uidx_starts))) {
+      goto LoadLoopCatsGenoCounts_ret_NOMEM;
+    }
+    if (unlikely(SetThreadCt(calc_thread_ct, &tg))) {
+      goto LoadLoopCatsGenoCounts_ret_NOMEM;
+    }
+    ctx.variant_include = variant_include;
+    ctx.subset_interleaved_vecs = subset_interleaved_vecs;
+    ctx.subset_sizes = subset_sizes;
+    ctx.subset_ct = subset_ct;
+    ctx.cat_ct = cat_ct;
+    ctx.variant_ct = variant_ct;
+    ctx.geno_cts = geno_cts;
+    ctx.founder_geno_cts = founder_geno_cts;
+    ctx.reterr = kPglRetSuccess;
+    SetThreadFuncAndData(LoadLoopCatsGenoCountsThread, &ctx, &tg);
+
+    logprintf("--loop-cats: Counting genotypes for all %u categories... ", cat_ct);
+    fputs("0%", stdout);
+    fflush(stdout);
+    uint32_t pct = 0;
+
+    uint32_t parity = 0;
+    uint32_t read_block_idx = 0;
+    uint32_t next_print_variant_idx = variant_ct / 100;
+    for (uint32_t variant_idx = 0; ; ) {
+      const uint32_t cur_block_size = MultireadNonempty(variant_include, &tg, raw_variant_ct, read_block_size, pgfip, &read_block_idx, &reterr);
+      if (unlikely(reterr)) {
+        goto LoadLoopCatsGenoCounts_ret_PGR_FAIL;
+      }
+      if (variant_idx) {
+        JoinThreads(&tg);
+        reterr = ctx.reterr;
+        if (unlikely(reterr)) {
+          goto LoadLoopCatsGenoCounts_ret_PGR_FAIL;
+        }
+      }
+      if (!IsLastBlock(&tg)) {
+        ctx.cur_block_size = cur_block_size;
+        ctx.cur_block_variant_idx_start = variant_idx;
+        ComputeUidxStartPartition(variant_include, cur_block_size, calc_thread_ct, read_block_idx * read_block_size, ctx.read_variant_uidx_starts);
+        PgrCopyBaseAndOffset(pgfip, calc_thread_ct, ctx.pgr_ptrs);
+        if (variant_idx + cur_block_size == variant_ct) {
+          DeclareLastThreadBlock(&tg);
+        }
+        if (unlikely(SpawnThreads(&tg))) {
+          goto LoadLoopCatsGenoCounts_ret_THREAD_CREATE_FAIL;
+        }
+      }
+
+      parity = 1 - parity;
+      if (variant_idx == variant_ct) {
+        break;
+      }
+      if (variant_idx >= next_print_variant_idx) {
+        if (pct > 10) {
+          putc_unlocked('\b', stdout);
+        }
+        pct = (variant_idx * 100LLU) / variant_ct;
+        printf("\b\b%u%%", pct++);
+        fflush(stdout);
+        next_print_variant_idx = (pct * S_CAST(uint64_t, variant_ct)) / 100;
+      }
+
+      ++read_block_idx;
+      variant_idx += cur_block_size;
+      pgfip->block_base = main_loadbufs[parity];
+    }
+    if (pct > 10) {
+      putc_unlocked('\b', stdout);
+    }
+    fputs("\b\b", stdout);
+    logputs("done.\n");
+    lcgcp->geno_cts = geno_cts;
+    lcgcp->founder_geno_cts = founder_geno_cts;
+  }
+  while (0) {
+  LoadLoopCatsGenoCounts_ret_NOMEM:
+    reterr = kPglRetNomem;
+    break;
+  LoadLoopCatsGenoCounts_ret_PGR_FAIL:
+    PgenErrPrintN(reterr);
+    break;
+  LoadLoopCatsGenoCounts_ret_THREAD_CREATE_FAIL:
+    reterr = kPglRetThreadCreateFail;
+    break;
+  }
+  CleanupThreads(&tg);
+  // keep the count arrays
+  BigstackDoubleReset(bigstack_mark, bigstack_end_mark);
+  pgfip->block_base = nullptr;
+  return reterr;
+}
+
+void FillLoopCatGenoCounts(const uintptr_t* variant_include, const uintptr_t* subset_variant_include, const LoopCatsGenoCounts* lcgcp, uint32_t cat_idx, uint32_t sample_ct, uint32_t first_hap_uidx, uint64_t* allele_ddosages, uint64_t* founder_allele_ddosages, uint32_t* variant_missing_hc_cts, uint32_t* variant_missing_dosage_cts, uint32_t* variant_hethap_cts, STD_ARRAY_PTR_DECL(uint32_t, 3, raw_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, founder_raw_geno_cts)) {
+  // Mirrors the biallelic non-X/Y diploid branch of
+  // LoadAlleleAndGenoCountsThread().
+  const uintptr_t variant_ct = lcgcp->variant_ct;
+  STD_ARRAY_PTR_DECL(uint32_t, 3, cat_geno_cts) = &(lcgcp->geno_cts[cat_idx * variant_ct]);
+  STD_ARRAY_PTR_DECL(uint32_t, 3, cat_founder_geno_cts) = cat_geno_cts;
+  if (lcgcp->founder_geno_cts) {
+    cat_founder_geno_cts = &(lcgcp->founder_geno_cts[cat_idx * variant_ct]);
+  }
+  uintptr_t variant_uidx_base = 0;
+  uintptr_t cur_bits = variant_include[0];
+  for (uintptr_t variant_idx = 0; variant_idx != variant_ct; ++variant_idx) {
+    const uintptr_t variant_uidx = BitIter1(variant_include, &variant_uidx_base, &cur_bits);
+    if (!IsSet(subset_variant_include, variant_uidx)) {
+      continue;
+    }
+    STD_ARRAY_KREF(uint32_t, 3) cur_geno_cts = cat_geno_cts[variant_idx];
+    if (allele_ddosages) {
+      allele_ddosages[2 * variant_uidx] = (cur_geno_cts[0] * 2 + cur_geno_cts[1]) * S_CAST(uint64_t, kDosageMax);
+      allele_ddosages[2 * variant_uidx + 1] = (cur_geno_cts[2] * 2 + cur_geno_cts[1]) * S_CAST(uint64_t, kDosageMax);
+    }
+    if (raw_geno_cts) {
+      STD_ARRAY_REF(uint32_t, 3) cur_raw_geno_cts = raw_geno_cts[variant_uidx];
+      cur_raw_geno_cts[0] = cur_geno_cts[0];
+      cur_raw_geno_cts[1] = cur_geno_cts[1];
+      cur_raw_geno_cts[2] = cur_geno_cts[2];
+    }
+    const uint32_t missing_ct = sample_ct - cur_geno_cts[0] - cur_geno_cts[1] - cur_geno_cts[2];
+    if (variant_missing_dosage_cts) {
+      variant_missing_dosage_cts[variant_uidx] = missing_ct;
+    }
+    if (variant_missing_hc_cts) {
+      variant_missing_hc_cts[variant_uidx] = missing_ct;
+      if (variant_hethap_cts && (variant_uidx >= first_hap_uidx)) {
+        variant_hethap_cts[variant_uidx - first_hap_uidx] = 0;
+      }
+    }
+    STD_ARRAY_KREF(uint32_t, 3) cur_founder_geno_cts = cat_founder_geno_cts[variant_idx];
+    if (founder_allele_ddosages) {
+      founder_allele_ddosages[2 * variant_uidx] = (cur_founder_geno_cts[0] * 2 + cur_founder_geno_cts[1]) * S_CAST(uint64_t, kDosageMax);
+      founder_allele_ddosages[2 * variant_uidx + 1] = (cur_founder_geno_cts[2] * 2 + cur_founder_geno_cts[1]) * S_CAST(uint64_t, kDosageMax);
+    }
+    if (founder_raw_geno_cts) {
+      STD_ARRAY_REF(uint32_t, 3) cur_raw_geno_cts = founder_raw_geno_cts[variant_uidx];
+      cur_raw_geno_cts[0] = cur_founder_geno_cts[0];
+      cur_raw_geno_cts[1] = cur_founder_geno_cts[1];
+      cur_raw_geno_cts[2] = cur_founder_geno_cts[2];
+    }
+  }
+}
+
 void ApplyHardCallThresh(const uintptr_t* dosage_present, const Dosage* dosage_main, uint32_t dosage_ct, uint32_t hard_call_halfdist, uintptr_t* genovec) {
   uintptr_t sample_uidx_base = 0;
   uintptr_t cur_bits = dosage_present[0];
@@ -6017,6 +6374,15 @@ PglErr MakePgenRobust(const uintptr_t* sample_include, const uint32_t* new_sampl
       snprintf(outname_end, kMaxOutfnameExtBlen, ".pgen");
       uintptr_t spgw_alloc_cacheline_ct;
       uint32_t max_vrec_len;
+      if (make_plink2_flags & kfMakePgenPbwtPhase) {
+        write_gflags |= kfPgenGlobalPbwtHphase;
+      }
+      if (make_plink2_flags & kfMakePgenZstBlocks) {
+        write_gflags |= kfPgenGlobalZstdRecords;
+      }
+      if (make_plink2_flags & kfMakePgenDosageDelta) {
+        write_gflags |= kfPgenGlobalDosageDelta;
+      }
       reterr = SpgwInitPhase1(outname, write_allele_idx_offsets, nonref_flags_write, write_variant_ct, sample_ct, write_gflags, nonref_flags_storage, ctx.spgwp, &spgw_alloc_cacheline_ct, &max_vrec_len);
       if (unlikely(reterr)) {
         if (reterr == kPglRetOpenFail) {
@@ -6983,6 +7349,15 @@ PglErr MakePlink2NoVsort(const uintptr_t* sample_include, const PedigreeIdInfo*
         goto MakePlink2NoVsort_ret_1;
       }
       write_gflags &= ~kfPgenGlobalMultiallelicHardcallFound;
+      if (make_plink2_flags & kfMakePgenPbwtPhase) {
+        write_gflags |= kfPgenGlobalPbwtHphase;
+      }
+      if (make_plink2_flags & kfMakePgenZstBlocks) {
+        write_gflags |= kfPgenGlobalZstdRecords;
+      }
+      if (make_plink2_flags & kfMakePgenDosageDelta) {
+        write_gflags |= kfPgenGlobalDosageDelta;
+      }
       uintptr_t alloc_base_cacheline_ct;
       uint64_t mpgw_per_thread_cacheline_ct;
       uint32_t vrec_len_byte_ct;
@@ -55,7 +55,11 @@ FLAGSET_DEF_START()
   kfMakePgenFormatBase = (1 << 18), // two bits
   kfMakePgenErasePhase = (1 << 20),
   kfMakePgenEraseDosage = (1 << 21),
-  kfMakePgenFillMissingFromDosage = (1 << 22)
+  kfMakePgenFillMissingFromDosage = (1 << 22),
+  kfMakePgenPbwtPhase = (1 << 23),
+  kfMakePgenZstBlocks = (1 << 24),
+  kfMakePgenSmajTiles = (1 << 25),
+  kfMakePgenDosageDelta = (1 << 26)
 FLAGSET_DEF_END(MakePlink2Flags);
 
 CONSTI32(kMaxInfoKeySlen, kMaxIdSlen);
@@ -87,7 +91,34 @@ uint32_t DataParentalColsAreRequired(const uintptr_t* sample_include, const Pedi
 
 char* AppendPhenoStr(const PhenoCol* pheno_col, const char* output_missing_pheno, uint32_t omp_slen, uint32_t sample_uidx, char* write_iter);
 
-PglErr LoadAlleleAndGenoCounts(const uintptr_t* sample_include, const uintptr_t* founder_info, const uintptr_t* sex_nm, const uintptr_t* sex_male, const uintptr_t* variant_include, const ChrInfo* cip, const uintptr_t* allele_idx_offsets, uint32_t raw_sample_ct, uint32_t sample_ct, uint32_t founder_ct, uint32_t male_ct, uint32_t nosex_ct, uint32_t raw_variant_ct, uint32_t variant_ct, uint32_t first_hap_uidx, uint32_t is_minimac3_r2, uint32_t max_thread_ct, uintptr_t pgr_alloc_cacheline_ct, PgenFileInfo* pgfip, uintptr_t* allele_presents, uint64_t* allele_ddosages, uint64_t* founder_allele_ddosages, uint32_t* variant_missing_hc_cts, uint32_t* variant_missing_dosage_cts, uint32_t* variant_hethap_cts, STD_ARRAY_PTR_DECL(uint32_t, 3, raw_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, founder_raw_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, x_male_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, founder_x_male_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, x_nosex_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, founder_x_nosex_geno_cts), double* imp_r2_vals);
+PglErr LoadAlleleAndGenoCounts(const uintptr_t* sample_include, const uintptr_t* founder_info, const uintptr_t* sex_nm, const uintptr_t* sex_male, const uintptr_t* variant_include, const ChrInfo* cip, const uintptr_t* allele_idx_offsets, uint32_t raw_sample_ct, uint32_t sample_ct, uint32_t founder_ct, uint32_t male_ct, uint32_t nosex_ct, uint32_t raw_variant_ct, uint32_t variant_ct, uint32_t first_hap_uidx, uint32_t is_minimac3_r2, uint32_t max_thread_ct, uintptr_t pgr_alloc_cacheline_ct, PgenFileInfo* pgfip, uintptr_t* allele_presents, uint64_t* allele_ddosages, uint64_t* founder_allele_ddosages, uint32_t* variant_missing_hc_cts, uint32_t* variant_missing_dosage_cts, uint32_t* variant_hethap_cts, STD_ARRAY_PTR_DECL(uint32_t, 3, raw_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, founder_raw_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, x_male_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, founder_x_male_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, x_nosex_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, founder_x_nosex_geno_cts), double* imp_r2_vals, uint32_t* sample_missing_hc_cts, uint32_t* sample_missing_dosage_cts, uint32_t* sample_hethap_cts);
+
+// --loop-cats support.  When LoopCatsGenoCountsAreFusable() is true,
+// LoadLoopCatsGenoCounts() computes genotype counts for every category in a
+// single pass over the .pgen, and FillLoopCatGenoCounts() then fills the
+// arrays that LoadAlleleAndGenoCounts() would have filled for one category.
+typedef struct LoopCatsGenoCountsStruct {
+  // [cat_idx * variant_ct + variant_idx], variant_idx ranging over the
+  // variant_include passed to LoadLoopCatsGenoCounts()
+  STD_ARRAY_PTR_DECL(uint32_t, 3, geno_cts);
+  // nullptr if all samples are founders
+  STD_ARRAY_PTR_DECL(uint32_t, 3, founder_geno_cts);
+  uint32_t cat_ct;
+  uint32_t variant_ct;
+} LoopCatsGenoCounts;
+
+// Biallelic hardcall-only dataset, and all variants on regular diploid
+// chromosomes.
+uint32_t LoopCatsGenoCountsAreFusable(const uintptr_t* variant_include, const ChrInfo* cip, const uintptr_t* allele_idx_offsets, const PgenFileInfo* pgfip);
+
+// Allocates on bottom of bigstack.  Leaves lcgcp->geno_cts == nullptr if the
+// counts would take more than half of the remaining workspace; caller should
+// fall back on per-category LoadAlleleAndGenoCounts() calls in that case.
+PglErr LoadLoopCatsGenoCounts(const uintptr_t* sample_include, const uintptr_t* founder_info, const PhenoCol* cat_pheno_col, const uintptr_t* cat_include, const uintptr_t* variant_include, uint32_t raw_sample_ct, uint32_t sample_ct, uint32_t cat_ct, uint32_t raw_variant_ct, uint32_t variant_ct, uint32_t max_thread_ct, uintptr_t pgr_alloc_cacheline_ct, PgenFileInfo* pgfip, LoopCatsGenoCounts* lcgcp);
+
+// subset_variant_include must be a subset of the variant_include passed to
+// LoadLoopCatsGenoCounts().
+void FillLoopCatGenoCounts(const uintptr_t* variant_include, const uintptr_t* subset_variant_include, const LoopCatsGenoCounts* lcgcp, uint32_t cat_idx, uint32_t sample_ct, uint32_t first_hap_uidx, uint64_t* allele_ddosages, uint64_t* founder_allele_ddosages, uint32_t* variant_missing_hc_cts, uint32_t* variant_missing_dosage_cts, uint32_t* variant_hethap_cts, STD_ARRAY_PTR_DECL(uint32_t, 3, raw_geno_cts), STD_ARRAY_PTR_DECL(uint32_t, 3, founder_raw_geno_cts));
 
 void ApplyHardCallThresh(const uintptr_t* dosage_present, const Dosage* dosage_main, uint32_t dosage_ct, uint32_t hard_call_halfdist, uintptr_t* genovec);
 
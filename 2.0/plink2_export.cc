@@ -537,6 +537,8 @@ typedef struct TransposeToPlink1SmajWriteCtxStruct {
   VecW** thread_vecaligned_bufs;
 
   uint32_t sample_batch_size;
+  // if zero, plink2 genotype codes are left alone
+  uint32_t plink1_coding;
 
   uintptr_t* smaj_writebufs[2];
 } TransposeToPlink1SmajWriteCtx;
@@ -566,6 +568,7 @@ THREAD_FUNC_DECL TransposeToPlink1SmajWriteThread(void* raw_arg) {
   const uint32_t read_sample_ct = ctx->sample_ct;
   const uintptr_t read_sample_ctaw2 = NypCtToAlignedWordCt(read_sample_ct);
   const uintptr_t* vmaj_readbuf = ctx->vmaj_readbuf;
+  const uint32_t plink1_coding = ctx->plink1_coding;
   uint32_t sample_widx = 0;
   uint32_t parity = 0;
   do {
@@ -589,7 +592,9 @@ THREAD_FUNC_DECL TransposeToPlink1SmajWriteThread(void* raw_arg) {
     for (uint32_t sample_idx = 0; sample_idx != sample_batch_size; ++sample_idx) {
       // could fold this into TransposeNypblock(), but I won't bother,
       // we're already saturating at ~3 threads
-      PgrPlink2ToPlink1InplaceUnsafe(thread_variant_ct, smaj_writebuf_iter);
+      if (plink1_coding) {
+        PgrPlink2ToPlink1InplaceUnsafe(thread_variant_ct, smaj_writebuf_iter);
+      }
       ZeroTrailingNyps(thread_variant_ct, smaj_writebuf_iter);
       smaj_writebuf_iter = &(smaj_writebuf_iter[variant_batch_word_ct]);
     }
@@ -690,6 +695,7 @@ PglErr ExportIndMajorBed(const uintptr_t* orig_sample_include, const uintptr_t*
       write_ctx.variant_include = variant_include;
       write_ctx.variant_ct = variant_ct;
       write_ctx.vmaj_readbuf = vmaj_readbuf;
+      write_ctx.plink1_coding = 1;
       SetThreadFuncAndData(TransposeToPlink1SmajWriteThread, &write_ctx, &write_tg);
       uint32_t sample_uidx_start = AdvTo1Bit(orig_sample_include, 0);
       const uintptr_t variant_ct4 = NypCtToByteCt(variant_ct);
@@ -859,6 +865,313 @@ PglErr ExportIndMajorBed(const uintptr_t* orig_sample_include, const uintptr_t*
   return reterr;
 }
 
+PglErr WriteSmajTiles(const uintptr_t* orig_sample_include, const uintptr_t* variant_include, const STD_ARRAY_PTR_DECL(AlleleCode, 2, refalt1_select), uint32_t raw_sample_ct, uint32_t sample_ct, uint32_t raw_variant_ct, uint32_t variant_ct, uint32_t max_thread_ct, uintptr_t pgr_alloc_cacheline_ct, PgenFileInfo* pgfip, char* outname, char* outname_end) {
+  unsigned char* bigstack_mark = g_bigstack_base;
+  FILE* outfile = nullptr;
+  PglErr reterr = kPglRetSuccess;
+  ThreadGroup read_tg;
+  ThreadGroup write_tg;
+  PreinitThreads(&read_tg);
+  PreinitThreads(&write_tg);
+  TransposeToSmajReadCtx read_ctx;
+  TransposeToPlink1SmajWriteCtx write_ctx;
+  {
+    // Same transpose strategy as ExportIndMajorBed(), except that plink2
+    // genotype codes are kept and each flushed group of kSmajTileSampleCt
+    // rows is cut into kSmajTileVariantCt-variant tiles which are compressed
+    // independently.  Since passes and write batches are aligned to
+    // kSmajTileSampleCt samples, tiles come out in sample-block-major order.
+    uint64_t pgen_fsize;
+    snprintf(outname_end, kMaxOutfnameExtBlen, ".pgen");
+    if (unlikely(GetFileSize(outname, &pgen_fsize))) {
+      goto WriteSmajTiles_ret_OPEN_FAIL;
+    }
+    snprintf(outname_end, kMaxOutfnameExtBlen, ".pgen.smaj");
+    const uint32_t sblock_ct = DivUp(sample_ct, kSmajTileSampleCt);
+    const uint32_t vblock_ct = DivUp(variant_ct, kSmajTileVariantCt);
+    const uintptr_t tile_ct = S_CAST(uintptr_t, sblock_ct) * vblock_ct;
+    uint64_t* tile_fpos;
+    if (unlikely(bigstack_calloc_u64(tile_ct + 1, &tile_fpos))) {
+      goto WriteSmajTiles_ret_NOMEM;
+    }
+    if (unlikely(fopen_checked(outname, FOPEN_WB, &outfile))) {
+      goto WriteSmajTiles_ret_OPEN_FAIL;
+    }
+    unsigned char header[kSmajTileHeaderByteCt];
+    memcpy(header, "l\x1b\x40", 3);
+    const uint32_t tile_sample_ct = kSmajTileSampleCt;
+    const uint32_t tile_variant_ct = kSmajTileVariantCt;
+    memcpy(&(header[3]), &sample_ct, sizeof(int32_t));
+    memcpy(&(header[7]), &variant_ct, sizeof(int32_t));
+    memcpy(&(header[11]), &tile_sample_ct, sizeof(int32_t));
+    memcpy(&(header[15]), &tile_variant_ct, sizeof(int32_t));
+    memcpy(&(header[19]), &pgen_fsize, sizeof(int64_t));
+    if (unlikely(
+            fwrite_checked(header, kSmajTileHeaderByteCt, outfile) ||
+            fwrite_checked(tile_fpos, (tile_ct + 1) * sizeof(int64_t), outfile))) {
+      goto WriteSmajTiles_ret_WRITE_FAIL;
+    }
+    uint64_t cur_fpos = kSmajTileHeaderByteCt + (tile_ct + 1) * sizeof(int64_t);
+    tile_fpos[0] = cur_fpos;
+    if (tile_ct) {
+      const uint32_t raw_sample_ctl = BitCtToWordCt(raw_sample_ct);
+      uint32_t calc_thread_ct = (max_thread_ct > 2)? (max_thread_ct - 1) : max_thread_ct;
+      STD_ARRAY_DECL(unsigned char*, 2, main_loadbufs);
+      uint32_t read_block_size;
+      if (unlikely(PgenMtLoadInit(variant_include, sample_ct, variant_ct, bigstack_left() / 2, pgr_alloc_cacheline_ct, 0, 0, 0, pgfip, &calc_thread_ct, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &read_block_size, nullptr, main_loadbufs, &read_ctx.pgr_ptrs, &read_ctx.variant_uidx_starts))) {
+        goto WriteSmajTiles_ret_NOMEM;
+      }
+      if (unlikely(SetThreadCt(calc_thread_ct, &read_tg))) {
+        goto WriteSmajTiles_ret_NOMEM;
+      }
+      read_ctx.variant_include = variant_include;
+      read_ctx.refalt1_select = refalt1_select;
+      read_ctx.reterr = kPglRetSuccess;
+      SetThreadFuncAndData(TransposeToSmajReadThread, &read_ctx, &read_tg);
+
+      const uintptr_t variant_cacheline_ct = NypCtToCachelineCt(variant_ct);
+      uint32_t output_calc_thread_ct = MINV(calc_thread_ct, variant_cacheline_ct);
+      if (output_calc_thread_ct > 4) {
+        output_calc_thread_ct = 4;
+      }
+      const uintptr_t tile_word_ct = kSmajTileSampleCt * kSmajTileVariantWordCt;
+      const uintptr_t ctile_byte_bound = ZSTD_compressBound(tile_word_ct * kBytesPerWord);
+      uintptr_t* sample_include;
+      uint32_t* sample_include_cumulative_popcounts;
+      uintptr_t* tilebuf;
+      unsigned char* ctilebuf;
+      if (unlikely(
+              SetThreadCt(output_calc_thread_ct, &write_tg) ||
+              bigstack_alloc_w(raw_sample_ctl, &sample_include) ||
+              bigstack_alloc_u32(raw_sample_ctl, &sample_include_cumulative_popcounts) ||
+              bigstack_alloc_vp(output_calc_thread_ct, &write_ctx.thread_vecaligned_bufs) ||
+              bigstack_alloc_w(tile_word_ct, &tilebuf) ||
+              bigstack_alloc_uc(ctile_byte_bound, &ctilebuf))) {
+        goto WriteSmajTiles_ret_NOMEM;
+      }
+      for (uint32_t tidx = 0; tidx != output_calc_thread_ct; ++tidx) {
+        write_ctx.thread_vecaligned_bufs[tidx] = S_CAST(VecW*, bigstack_alloc_raw(kPglNypTransposeBufbytes));
+      }
+      const uintptr_t writebuf_cachelines_avail = bigstack_left() / (kCacheline * 8);
+      uint32_t sample_batch_size = kPglNypTransposeBatch;
+      if (variant_cacheline_ct * kPglNypTransposeBatch > writebuf_cachelines_avail) {
+        sample_batch_size = RoundDownPow2(writebuf_cachelines_avail / variant_cacheline_ct, kSmajTileSampleCt);
+        if (unlikely(!sample_batch_size)) {
+          goto WriteSmajTiles_ret_NOMEM;
+        }
+      }
+      write_ctx.smaj_writebufs[0] = S_CAST(uintptr_t*, bigstack_alloc_raw(variant_cacheline_ct * kCacheline * sample_batch_size));
+      write_ctx.smaj_writebufs[1] = S_CAST(uintptr_t*, bigstack_alloc_raw(variant_cacheline_ct * kCacheline * sample_batch_size));
+      const uintptr_t readbuf_vecs_avail = (bigstack_left() / kCacheline) * kVecsPerCacheline;
+      if (unlikely(readbuf_vecs_avail < variant_ct)) {
+        goto WriteSmajTiles_ret_NOMEM;
+      }
+      uintptr_t read_sample_ctv2 = readbuf_vecs_avail / variant_ct;
+      uint32_t read_sample_ct;
+      if (read_sample_ctv2 >= NypCtToVecCt(sample_ct)) {
+        read_sample_ct = sample_ct;
+      } else {
+        read_sample_ct = RoundDownPow2(read_sample_ctv2 * kNypsPerVec, kSmajTileSampleCt);
+        if (unlikely(!read_sample_ct)) {
+          goto WriteSmajTiles_ret_NOMEM;
+        }
+      }
+      uintptr_t read_sample_ctaw2 = NypCtToAlignedWordCt(read_sample_ct);
+      uintptr_t* vmaj_readbuf = S_CAST(uintptr_t*, bigstack_alloc_raw_rd(variant_ct * read_sample_ctaw2 * kBytesPerWord));
+      read_ctx.vmaj_readbuf = vmaj_readbuf;
+      write_ctx.variant_include = variant_include;
+      write_ctx.variant_ct = variant_ct;
+      write_ctx.vmaj_readbuf = vmaj_readbuf;
+      write_ctx.plink1_coding = 0;
+      SetThreadFuncAndData(TransposeToPlink1SmajWriteThread, &write_ctx, &write_tg);
+      uint32_t sample_uidx_start = AdvTo1Bit(orig_sample_include, 0);
+      const uintptr_t variant_ctaclw2 = variant_cacheline_ct * kWordsPerCacheline;
+      const uint32_t zst_level = g_zst_level;
+      const uint32_t pass_ct = 1 + (sample_ct - 1) / read_sample_ct;
+      uintptr_t tile_idx = 0;
+      for (uint32_t pass_idx = 0; pass_idx != pass_ct; ++pass_idx) {
+        memcpy(sample_include, orig_sample_include, raw_sample_ctl * sizeof(intptr_t));
+        if (sample_uidx_start) {
+          ClearBitsNz(0, sample_uidx_start, sample_include);
+        }
+        uint32_t sample_uidx_end;
+        if (pass_idx + 1 == pass_ct) {
+          read_sample_ct = sample_ct - pass_idx * read_sample_ct;
+          read_sample_ctaw2 = NypCtToAlignedWordCt(read_sample_ct);
+          sample_uidx_end = raw_sample_ct;
+        } else {
+          sample_uidx_end = FindNth1BitFrom(orig_sample_include, sample_uidx_start + 1, read_sample_ct);
+          ClearBitsNz(sample_uidx_end, raw_sample_ct, sample_include);
+        }
+        FillCumulativePopcounts(sample_include, raw_sample_ctl, sample_include_cumulative_popcounts);
+        read_ctx.sample_include = sample_include;
+        read_ctx.sample_include_cumulative_popcounts = sample_include_cumulative_popcounts;
+        read_ctx.sample_ct = read_sample_ct;
+        write_ctx.sample_ct = read_sample_ct;
+        if (pass_idx) {
+          pgfip->block_base = main_loadbufs[0];
+          PgrSetBaseAndOffset0(main_loadbufs[0], calc_thread_ct, read_ctx.pgr_ptrs);
+        }
+        uint32_t parity = 0;
+        uint32_t read_block_idx = 0;
+        ReinitThreads(&read_tg);
+        uint32_t pct = 0;
+        uint32_t next_print_idx = variant_ct / 100;
+        putc_unlocked('\r', stdout);
+        printf("--make-pgen smaj-tiles pass %u/%u: loading... 0%%", pass_idx + 1, pass_ct);
+        fflush(stdout);
+        for (uint32_t variant_idx = 0; ; ) {
+          const uint32_t cur_block_write_ct = MultireadNonempty(variant_include, &read_tg, raw_variant_ct, read_block_size, pgfip, &read_block_idx, &reterr);
+          if (unlikely(reterr)) {
+            goto WriteSmajTiles_ret_PGR_FAIL;
+          }
+          if (variant_idx) {
+            JoinThreads(&read_tg);
+            reterr = read_ctx.reterr;
+            if (unlikely(reterr)) {
+              goto WriteSmajTiles_ret_PGR_FAIL;
+            }
+          }
+          if (!IsLastBlock(&read_tg)) {
+            read_ctx.cur_block_write_ct = cur_block_write_ct;
+            ComputeUidxStartPartition(variant_include, cur_block_write_ct, calc_thread_ct, read_block_idx * read_block_size, read_ctx.variant_uidx_starts);
+            PgrCopyBaseAndOffset(pgfip, calc_thread_ct, read_ctx.pgr_ptrs);
+            if (variant_idx + cur_block_write_ct == variant_ct) {
+              DeclareLastThreadBlock(&read_tg);
+            }
+            if (unlikely(SpawnThreads(&read_tg))) {
+              goto WriteSmajTiles_ret_THREAD_CREATE_FAIL;
+            }
+          }
+          parity = 1 - parity;
+          if (variant_idx == variant_ct) {
+            break;
+          }
+          if (variant_idx >= next_print_idx) {
+            if (pct > 10) {
+              putc_unlocked('\b', stdout);
+            }
+            pct = (variant_idx * 100LLU) / variant_ct;
+            printf("\b\b%u%%", pct++);
+            fflush(stdout);
+            next_print_idx = (pct * S_CAST(uint64_t, variant_ct)) / 100;
+          }
+
+          ++read_block_idx;
+          variant_idx += cur_block_write_ct;
+          pgfip->block_base = main_loadbufs[parity];
+        }
+        ReinitThreads(&write_tg);
+        write_ctx.sample_batch_size = sample_batch_size;
+        parity = 0;
+        if (pct > 10) {
+          fputs("\b \b", stdout);
+        }
+        fputs("\b\b\b\b\b\b\b\b\b\b\b\b\bwriting... 0%", stdout);
+        fflush(stdout);
+        pct = 0;
+        uint32_t flush_sample_idx = 0;
+        next_print_idx = read_sample_ct / 100;
+        for (uint32_t flush_sample_idx_end = 0; ; ) {
+          if (!IsLastBlock(&write_tg)) {
+            if (flush_sample_idx_end + sample_batch_size >= read_sample_ct) {
+              DeclareLastThreadBlock(&write_tg);
+              write_ctx.sample_batch_size = read_sample_ct - flush_sample_idx_end;
+            }
+            if (unlikely(SpawnThreads(&write_tg))) {
+              goto WriteSmajTiles_ret_THREAD_CREATE_FAIL;
+            }
+          }
+          if (flush_sample_idx_end) {
+            const uintptr_t* smaj_writebuf = write_ctx.smaj_writebufs[1 - parity];
+            for (; flush_sample_idx < flush_sample_idx_end; flush_sample_idx += kSmajTileSampleCt) {
+              const uint32_t row_ct = MINV(flush_sample_idx_end - flush_sample_idx, kSmajTileSampleCt);
+              uint32_t variant_idx_base = 0;
+              for (uint32_t vblock_idx = 0; vblock_idx != vblock_ct; ++vblock_idx, variant_idx_base += kSmajTileVariantCt) {
+                const uint32_t cur_variant_ct = MINV(variant_ct - variant_idx_base, kSmajTileVariantCt);
+                const uint32_t row_word_ct = NypCtToWordCt(cur_variant_ct);
+                const uintptr_t* smaj_row_iter = &(smaj_writebuf[variant_idx_base / kBitsPerWordD2]);
+                uintptr_t* tilebuf_iter = tilebuf;
+                for (uint32_t row_idx = 0; row_idx != row_ct; ++row_idx) {
+                  memcpy(tilebuf_iter, smaj_row_iter, row_word_ct * kBytesPerWord);
+                  ZeroTrailingNyps(cur_variant_ct, tilebuf_iter);
+                  tilebuf_iter = &(tilebuf_iter[row_word_ct]);
+                  smaj_row_iter = &(smaj_row_iter[variant_ctaclw2]);
+                }
+                const uintptr_t ctile_byte_ct = ZSTD_compress(ctilebuf, ctile_byte_bound, tilebuf, row_ct * row_word_ct * kBytesPerWord, zst_level);
+                if (unlikely(ZSTD_isError(ctile_byte_ct))) {
+                  goto WriteSmajTiles_ret_NOMEM;
+                }
+                if (unlikely(fwrite_checked(ctilebuf, ctile_byte_ct, outfile))) {
+                  goto WriteSmajTiles_ret_WRITE_FAIL;
+                }
+                cur_fpos += ctile_byte_ct;
+                tile_fpos[++tile_idx] = cur_fpos;
+              }
+              smaj_writebuf = &(smaj_writebuf[kSmajTileSampleCt * variant_ctaclw2]);
+            }
+            flush_sample_idx = flush_sample_idx_end;
+            if (flush_sample_idx_end == read_sample_ct) {
+              break;
+            }
+            if (flush_sample_idx_end >= next_print_idx) {
+              if (pct > 10) {
+                putc_unlocked('\b', stdout);
+              }
+              pct = (flush_sample_idx_end * 100LLU) / read_sample_ct;
+              printf("\b\b%u%%", pct++);
+              fflush(stdout);
+              next_print_idx = (pct * S_CAST(uint64_t, read_sample_ct)) / 100;
+            }
+          }
+          JoinThreads(&write_tg);
+          parity = 1 - parity;
+          flush_sample_idx_end += sample_batch_size;
+          if (flush_sample_idx_end > read_sample_ct) {
+            flush_sample_idx_end = read_sample_ct;
+          }
+        }
+        if (pct > 10) {
+          fputs("\b \b", stdout);
+        }
+        sample_uidx_start = sample_uidx_end;
+      }
+      fputs("\b\bdone.\n", stdout);
+    }
+    if (unlikely(
+            fseeko(outfile, kSmajTileHeaderByteCt, SEEK_SET) ||
+            fwrite_checked(tile_fpos, (tile_ct + 1) * sizeof(int64_t), outfile) ||
+            fclose_null(&outfile))) {
+      goto WriteSmajTiles_ret_WRITE_FAIL;
+    }
+    logprintfww("Sample-major tiles written to %s .\n", outname);
+  }
+  while (0) {
+  WriteSmajTiles_ret_NOMEM:
+    reterr = kPglRetNomem;
+    break;
+  WriteSmajTiles_ret_OPEN_FAIL:
+    reterr = kPglRetOpenFail;
+    break;
+  WriteSmajTiles_ret_PGR_FAIL:
+    PgenErrPrintN(reterr);
+    break;
+  WriteSmajTiles_ret_WRITE_FAIL:
+    reterr = kPglRetWriteFail;
+    break;
+  WriteSmajTiles_ret_THREAD_CREATE_FAIL:
+    reterr = kPglRetThreadCreateFail;
+    break;
+  }
+  CleanupThreads(&write_tg);
+  CleanupThreads(&read_tg);
+  fclose_cond(outfile);
+  pgfip->block_base = nullptr;
+  *outname_end = '\0';
+  BigstackReset(bigstack_mark);
+  return reterr;
+}
+
 static_assert(kDosageMid == 16384, "PrintGenDosage() needs to be updated.");
 char* PrintGenDosage(uint32_t rawval, char* start) {
   // Similar to PrintSmallDosage(), but it's complicated by .gen import's
@@ -1198,7 +1198,7 @@ PglErr RandomThinCt(const char* flagname_p, const char* unitname, uint32_t thin_
 
 static const char kKeepRemoveFlagStrs[4][11] = {"keep", "remove", "keep-fam", "remove-fam"};
 
-PglErr KeepOrRemove(const char* fnames, const SampleIdInfo* siip, uint32_t raw_sample_ct, KeepFlags flags, uintptr_t* sample_include, uint32_t* sample_ct_ptr) {
+PglErr KeepOrRemove(const char* fnames, const SampleIdInfo* siip, const XidIndex* xidxp, uint32_t raw_sample_ct, KeepFlags flags, uint32_t max_thread_ct, uintptr_t* sample_include, uint32_t* sample_ct_ptr) {
   unsigned char* bigstack_mark = g_bigstack_base;
   const char* flag_name = kKeepRemoveFlagStrs[flags % 4];
   PglErr reterr = kPglRetSuccess;
@@ -1245,7 +1245,17 @@ PglErr KeepOrRemove(const char* fnames, const SampleIdInfo* siip, uint32_t raw_s
       if (unlikely(SortStrboxIndexed(orig_sample_ct, max_xid_blen, 0, sorted_xidbox, xid_map))) {
         goto KeepOrRemove_ret_NOMEM;
       }
+    } else {
+      const uintptr_t max_sid_blen = siip->sids? siip->max_sid_blen : 2;
+      if (unlikely(bigstack_alloc_c(max_sample_id_blen + max_sid_blen, &idbuf))) {
+        goto KeepOrRemove_ret_NOMEM;
+      }
     }
+    // Hash tables for exact FID/IID and FID/IID/SID matching, respectively.
+    // Built on first use, and then kept across --keep/--remove files.
+    XidHtable xid_htables[2];
+    xid_htables[0].xids = nullptr;
+    xid_htables[1].xids = nullptr;
     unsigned char* bigstack_mark2 = nullptr;
     const char* fnames_iter = fnames;
     uintptr_t duplicate_ct = 0;
@@ -1266,6 +1276,7 @@ PglErr KeepOrRemove(const char* fnames, const SampleIdInfo* siip, uint32_t raw_s
       }
       char* line_start;
       XidMode xid_mode;
+      XidHtable* xid_htablep = nullptr;
       line_idx = 0;
       uint32_t skip_header = 0;
       if (families_only) {
@@ -1279,13 +1290,15 @@ PglErr KeepOrRemove(const char* fnames, const SampleIdInfo* siip, uint32_t raw_s
           }
           goto KeepOrRemove_ret_TSTREAM_XID_FAIL;
         }
-        const uint32_t allow_dups = siip->sids && (!(xid_mode & kfXidModeFlagSid));
-        reterr = SortedXidboxInitAlloc(sample_include, siip, orig_sample_ct, allow_dups, xid_mode, 0, &sorted_xidbox, &xid_map, &max_xid_blen);
-        if (unlikely(reterr)) {
-          goto KeepOrRemove_ret_1;
-        }
-        if (unlikely(bigstack_alloc_c(max_xid_blen, &idbuf))) {
-          goto KeepOrRemove_ret_NOMEM;
+        const uint32_t sid_present = (xid_mode / kfXidModeFlagSid) & 1;
+        xid_htablep = &(xid_htables[sid_present]);
+        if (!xid_htablep->xids) {
+          const uint32_t allow_dups = siip->sids && (!sid_present);
+          reterr = XidHtableInitAlloc(sample_include, siip, xidxp, raw_sample_ct, orig_sample_ct, allow_dups, xid_mode, max_thread_ct, xid_htablep);
+          if (unlikely(reterr)) {
+            goto KeepOrRemove_ret_1;
+          }
+          bigstack_mark2 = g_bigstack_base;
         }
         if (*line_start == '#') {
           skip_header = 1;
@@ -1298,19 +1311,19 @@ PglErr KeepOrRemove(const char* fnames, const SampleIdInfo* siip, uint32_t raw_s
       for (; line_start; ++line_idx, line_start = TextGet(&txs)) {
         if (!families_only) {
           const char* linebuf_iter = line_start;
-          uint32_t xid_idx_start;
-          uint32_t xid_idx_end;
-          if (!SortedXidboxReadMultifind(sorted_xidbox, max_xid_blen, orig_sample_ct, 0, xid_mode, &linebuf_iter, &xid_idx_start, &xid_idx_end, idbuf)) {
-            uint32_t sample_uidx = xid_map[xid_idx_start];
+          uint32_t sample_uidx;
+          uint32_t cur_llidx;
+          if (!XidHtableReadFind(xid_htablep, 0, xid_mode, &linebuf_iter, &sample_uidx, &cur_llidx, idbuf)) {
             if (IsSet(seen_uidxs, sample_uidx)) {
               ++duplicate_ct;
             } else {
-              for (uint32_t xid_idx = xid_idx_start; ; ) {
+              const uint32_t* htable_dup_base = xid_htablep->htable_dup_base;
+              for (; ; cur_llidx = htable_dup_base[cur_llidx + 1]) {
                 SetBit(sample_uidx, seen_uidxs);
-                if (++xid_idx == xid_idx_end) {
+                if (cur_llidx == UINT32_MAX) {
                   break;
                 }
-                sample_uidx = xid_map[xid_idx];
+                sample_uidx = htable_dup_base[cur_llidx];
               }
             }
           } else if (unlikely(!linebuf_iter)) {
@@ -1354,7 +1367,9 @@ PglErr KeepOrRemove(const char* fnames, const SampleIdInfo* siip, uint32_t raw_s
     if (flags & kfKeepRemove) {
       BitvecInvmask(seen_uidxs, raw_sample_ctl, sample_include);
     } else {
-      memcpy(sample_include, seen_uidxs, raw_sample_ctl * sizeof(intptr_t));
+      // seen_uidxs may include previously-excluded samples when
+      // --sample-id-index is in effect
+      BitvecAnd(seen_uidxs, raw_sample_ctl, sample_include);
     }
     const uint32_t sample_ct = PopcountWords(sample_include, raw_sample_ctl);
     *sample_ct_ptr = sample_ct;
@@ -3244,162 +3259,243 @@ void ComputeMajAlleles(const uintptr_t* variant_include, const uintptr_t* allele
   }
 }
 
-typedef struct LoadSampleMissingCtsCtxStruct {
-  const uintptr_t* variant_include;
-  const ChrInfo* cip;
-  const uintptr_t* sex_male;
-  uint32_t raw_sample_ct;
-
-  PgenReader** pgr_ptrs;
-  uintptr_t** genovecs;
-  uint32_t* read_variant_uidx_starts;
-  uint32_t cur_block_size;
-
-  uintptr_t** missing_hc_acc1;
-  uintptr_t** missing_dosage_acc1;
-  uintptr_t** hethap_acc1;
+uintptr_t CountSampleMissingAccCachelines(uint32_t raw_sample_ct, uint32_t dosage_needed) {
+  const uintptr_t acc1_alloc_cacheline_ct = DivUp(BitCtToVecCt(raw_sample_ct) * (45 * k1LU * kBytesPerVec), kCacheline);
+  return (2 + dosage_needed) * acc1_alloc_cacheline_ct;
+}
 
-  uint64_t err_info;
-} LoadSampleMissingCtsCtx;
+void SampleMissingAccAlloc(uint32_t raw_sample_ct, uint32_t dosage_needed, SampleMissingAcc* accp) {
+  const uintptr_t acc1_alloc = DivUp(BitCtToVecCt(raw_sample_ct) * (45 * k1LU * kBytesPerVec), kCacheline) * kCacheline;
+  accp->missing_hc_acc1 = S_CAST(uintptr_t*, bigstack_alloc_raw(acc1_alloc));
+  accp->missing_dosage_acc1 = nullptr;
+  if (dosage_needed) {
+    accp->missing_dosage_acc1 = S_CAST(uintptr_t*, bigstack_alloc_raw(acc1_alloc));
+  }
+  accp->hethap_acc1 = S_CAST(uintptr_t*, bigstack_alloc_raw(acc1_alloc));
+}
 
-THREAD_FUNC_DECL LoadSampleMissingCtsThread(void* raw_arg) {
-  ThreadGroupFuncArg* arg = S_CAST(ThreadGroupFuncArg*, raw_arg);
-  const uintptr_t tidx = arg->tidx;
-  LoadSampleMissingCtsCtx* ctx = S_CAST(LoadSampleMissingCtsCtx*, arg->sharedp->context);
+void SampleMissingAccInit(uint32_t raw_sample_ct, SampleMissingAcc* accp) {
+  const uint32_t acc1_vec_ct = BitCtToVecCt(raw_sample_ct);
+  ZeroWArr(acc1_vec_ct * kWordsPerVec * 45, accp->missing_hc_acc1);
+  if (accp->missing_dosage_acc1) {
+    ZeroWArr(acc1_vec_ct * kWordsPerVec * 45, accp->missing_dosage_acc1);
+  }
+  ZeroWArr(acc1_vec_ct * kWordsPerVec * 45, accp->hethap_acc1);
+  accp->all_ct_rem15 = 15;
+  accp->all_ct_rem255d15 = 17;
+  accp->hap_ct_rem15 = 15;
+  accp->hap_ct_rem255d15 = 17;
+}
 
-  const uintptr_t* variant_include = ctx->variant_include;
-  const ChrInfo* cip = ctx->cip;
-  const uintptr_t* sex_male = ctx->sex_male;
-  const uint32_t raw_sample_ct = ctx->raw_sample_ct;
+PglErr SampleMissingAccUpdate(const uintptr_t* variant_include, const ChrInfo* cip, const uintptr_t* sex_male, uint32_t raw_sample_ct, uint32_t variant_uidx_start, uint32_t cur_variant_ct, PgenReader* pgrp, uintptr_t* genovec_buf, SampleMissingAcc* accp, uint32_t* err_variant_uidxp) {
   const uint32_t raw_sample_ctaw = BitCtToAlignedWordCt(raw_sample_ct);
   const uint32_t acc1_vec_ct = BitCtToVecCt(raw_sample_ct);
   const uint32_t acc4_vec_ct = acc1_vec_ct * 4;
   const uint32_t acc8_vec_ct = acc1_vec_ct * 8;
-  const uint32_t calc_thread_ct = GetThreadCt(arg->sharedp);
   const uint32_t x_code = cip->xymt_codes[kChrOffsetX];
   const uint32_t y_code = cip->xymt_codes[kChrOffsetY];
-  uintptr_t* genovec_buf = ctx->genovecs[tidx];
-  uintptr_t* missing_hc_acc1 = ctx->missing_hc_acc1[tidx];
-  ZeroWArr(acc1_vec_ct * kWordsPerVec * 45, missing_hc_acc1);
+  uintptr_t* missing_hc_acc1 = accp->missing_hc_acc1;
   VecW* missing_hc_acc4 = &(R_CAST(VecW*, missing_hc_acc1)[acc1_vec_ct]);
   VecW* missing_hc_acc8 = &(missing_hc_acc4[acc4_vec_ct]);
   VecW* missing_hc_acc32 = &(missing_hc_acc8[acc8_vec_ct]);
-  uintptr_t* missing_dosage_acc1 = nullptr;
+  uintptr_t* missing_dosage_acc1 = accp->missing_dosage_acc1;
   VecW* missing_dosage_acc4 = nullptr;
   VecW* missing_dosage_acc8 = nullptr;
   VecW* missing_dosage_acc32 = nullptr;
-  if (ctx->missing_dosage_acc1) {
-    missing_dosage_acc1 = ctx->missing_dosage_acc1[tidx];
-    ZeroWArr(acc1_vec_ct * kWordsPerVec * 45, missing_dosage_acc1);
+  if (missing_dosage_acc1) {
     missing_dosage_acc4 = &(R_CAST(VecW*, missing_dosage_acc1)[acc1_vec_ct]);
     missing_dosage_acc8 = &(missing_dosage_acc4[acc4_vec_ct]);
     missing_dosage_acc32 = &(missing_dosage_acc8[acc8_vec_ct]);
   }
   // could make this optional
   // (could technically make missing_hc optional too...)
-  uintptr_t* hethap_acc1 = ctx->hethap_acc1[tidx];
-  ZeroWArr(acc1_vec_ct * kWordsPerVec * 45, hethap_acc1);
+  uintptr_t* hethap_acc1 = accp->hethap_acc1;
   VecW* hethap_acc4 = &(R_CAST(VecW*, hethap_acc1)[acc1_vec_ct]);
   VecW* hethap_acc8 = &(hethap_acc4[acc4_vec_ct]);
   VecW* hethap_acc32 = &(hethap_acc8[acc8_vec_ct]);
-  uint32_t all_ct_rem15 = 15;
-  uint32_t all_ct_rem255d15 = 17;
-  uint32_t hap_ct_rem15 = 15;
-  uint32_t hap_ct_rem255d15 = 17;
-  uint64_t new_err_info = 0;
-  do {
-    PgenReader* pgrp = ctx->pgr_ptrs[tidx];
-    PgrSampleSubsetIndex null_pssi;
-    PgrClearSampleSubsetIndex(pgrp, &null_pssi);
-    const uint32_t cur_block_size = ctx->cur_block_size;
-    const uint32_t cur_idx_ct = (((tidx + 1) * cur_block_size) / calc_thread_ct) - ((tidx * cur_block_size) / calc_thread_ct);
-    uintptr_t variant_uidx_base;
-    uintptr_t cur_bits;
-    BitIter1Start(variant_include, ctx->read_variant_uidx_starts[tidx], &variant_uidx_base, &cur_bits);
-    uint32_t chr_end = 0;
-    uintptr_t* cur_hets = nullptr;
-    uint32_t is_diploid_x = 0;
-    uint32_t is_y = 0;
-    for (uint32_t cur_idx = 0; cur_idx != cur_idx_ct; ++cur_idx) {
-      const uint32_t variant_uidx = BitIter1(variant_include, &variant_uidx_base, &cur_bits);
-      if (variant_uidx >= chr_end) {
-        const uint32_t chr_fo_idx = GetVariantChrFoIdx(cip, variant_uidx);
-        const uint32_t chr_idx = cip->chr_file_order[chr_fo_idx];
-        chr_end = cip->chr_fo_vidx_start[chr_fo_idx + 1];
-        cur_hets = hethap_acc1;
-        is_diploid_x = 0;
-        is_y = 0;
-        if (chr_idx == x_code) {
-          is_diploid_x = !IsSet(cip->haploid_mask, 0);
-        } else if (chr_idx == y_code) {
-          is_y = 1;
-        } else {
-          if (!IsSet(cip->haploid_mask, chr_idx)) {
-            cur_hets = nullptr;
-          }
+  uint32_t all_ct_rem15 = accp->all_ct_rem15;
+  uint32_t all_ct_rem255d15 = accp->all_ct_rem255d15;
+  uint32_t hap_ct_rem15 = accp->hap_ct_rem15;
+  uint32_t hap_ct_rem255d15 = accp->hap_ct_rem255d15;
+  PglErr reterr = kPglRetSuccess;
+  PgrSampleSubsetIndex null_pssi;
+  PgrClearSampleSubsetIndex(pgrp, &null_pssi);
+  uintptr_t variant_uidx_base;
+  uintptr_t cur_bits;
+  BitIter1Start(variant_include, variant_uidx_start, &variant_uidx_base, &cur_bits);
+  uint32_t chr_end = 0;
+  uintptr_t* cur_hets = nullptr;
+  uint32_t is_diploid_x = 0;
+  uint32_t is_y = 0;
+  for (uint32_t cur_idx = 0; cur_idx != cur_variant_ct; ++cur_idx) {
+    const uint32_t variant_uidx = BitIter1(variant_include, &variant_uidx_base, &cur_bits);
+    if (variant_uidx >= chr_end) {
+      const uint32_t chr_fo_idx = GetVariantChrFoIdx(cip, variant_uidx);
+      const uint32_t chr_idx = cip->chr_file_order[chr_fo_idx];
+      chr_end = cip->chr_fo_vidx_start[chr_fo_idx + 1];
+      cur_hets = hethap_acc1;
+      is_diploid_x = 0;
+      is_y = 0;
+      if (chr_idx == x_code) {
+        is_diploid_x = !IsSet(cip->haploid_mask, 0);
+      } else if (chr_idx == y_code) {
+        is_y = 1;
+      } else {
+        if (!IsSet(cip->haploid_mask, chr_idx)) {
+          cur_hets = nullptr;
         }
       }
-      // could instead have missing_hc and (missing_hc - missing_dosage); that
-      // has the advantage of letting you skip one of the two increment
-      // operations when the variant is all hardcalls.
-      PglErr reterr = PgrGetMissingnessD(nullptr, null_pssi, raw_sample_ct, variant_uidx, pgrp, missing_hc_acc1, missing_dosage_acc1, cur_hets, genovec_buf);
-      if (unlikely(reterr)) {
-        new_err_info = (S_CAST(uint64_t, variant_uidx) << 32) | S_CAST(uint32_t, reterr);
-        goto LoadSampleMissingCtsThread_err;
-      }
-      if (is_y) {
-        BitvecAnd(sex_male, raw_sample_ctaw, missing_hc_acc1);
-        if (missing_dosage_acc1) {
-          BitvecAnd(sex_male, raw_sample_ctaw, missing_dosage_acc1);
-        }
+    }
+    // could instead have missing_hc and (missing_hc - missing_dosage); that
+    // has the advantage of letting you skip one of the two increment
+    // operations when the variant is all hardcalls.
+    reterr = PgrGetMissingnessD(nullptr, null_pssi, raw_sample_ct, variant_uidx, pgrp, missing_hc_acc1, missing_dosage_acc1, cur_hets, genovec_buf);
+    if (unlikely(reterr)) {
+      *err_variant_uidxp = variant_uidx;
+      break;
+    }
+    if (is_y) {
+      BitvecAnd(sex_male, raw_sample_ctaw, missing_hc_acc1);
+      if (missing_dosage_acc1) {
+        BitvecAnd(sex_male, raw_sample_ctaw, missing_dosage_acc1);
       }
-      VcountIncr1To4(missing_hc_acc1, acc1_vec_ct, missing_hc_acc4);
+    }
+    VcountIncr1To4(missing_hc_acc1, acc1_vec_ct, missing_hc_acc4);
+    if (missing_dosage_acc1) {
+      VcountIncr1To4(missing_dosage_acc1, acc1_vec_ct, missing_dosage_acc4);
+    }
+    if (!(--all_ct_rem15)) {
+      Vcount0Incr4To8(acc4_vec_ct, missing_hc_acc4, missing_hc_acc8);
       if (missing_dosage_acc1) {
-        VcountIncr1To4(missing_dosage_acc1, acc1_vec_ct, missing_dosage_acc4);
+        Vcount0Incr4To8(acc4_vec_ct, missing_dosage_acc4, missing_dosage_acc8);
       }
-      if (!(--all_ct_rem15)) {
-        Vcount0Incr4To8(acc4_vec_ct, missing_hc_acc4, missing_hc_acc8);
+      all_ct_rem15 = 15;
+      if (!(--all_ct_rem255d15)) {
+        Vcount0Incr8To32(acc8_vec_ct, missing_hc_acc8, missing_hc_acc32);
         if (missing_dosage_acc1) {
-          Vcount0Incr4To8(acc4_vec_ct, missing_dosage_acc4, missing_dosage_acc8);
-        }
-        all_ct_rem15 = 15;
-        if (!(--all_ct_rem255d15)) {
-          Vcount0Incr8To32(acc8_vec_ct, missing_hc_acc8, missing_hc_acc32);
-          if (missing_dosage_acc1) {
-            Vcount0Incr8To32(acc8_vec_ct, missing_dosage_acc8, missing_dosage_acc32);
-          }
-          all_ct_rem255d15 = 17;
+          Vcount0Incr8To32(acc8_vec_ct, missing_dosage_acc8, missing_dosage_acc32);
         }
+        all_ct_rem255d15 = 17;
       }
-      if (cur_hets) {
-        if (is_diploid_x) {
-          BitvecAnd(sex_male, raw_sample_ctaw, cur_hets);
-        }
-        VcountIncr1To4(cur_hets, acc1_vec_ct, hethap_acc4);
-        if (!(--hap_ct_rem15)) {
-          Vcount0Incr4To8(acc4_vec_ct, hethap_acc4, hethap_acc8);
-          hap_ct_rem15 = 15;
-          if (!(--hap_ct_rem255d15)) {
-            Vcount0Incr8To32(acc8_vec_ct, hethap_acc8, hethap_acc32);
-            hap_ct_rem255d15 = 17;
-          }
+    }
+    if (cur_hets) {
+      if (is_diploid_x) {
+        BitvecAnd(sex_male, raw_sample_ctaw, cur_hets);
+      }
+      VcountIncr1To4(cur_hets, acc1_vec_ct, hethap_acc4);
+      if (!(--hap_ct_rem15)) {
+        Vcount0Incr4To8(acc4_vec_ct, hethap_acc4, hethap_acc8);
+        hap_ct_rem15 = 15;
+        if (!(--hap_ct_rem255d15)) {
+          Vcount0Incr8To32(acc8_vec_ct, hethap_acc8, hethap_acc32);
+          hap_ct_rem255d15 = 17;
         }
       }
     }
-    while (0) {
-    LoadSampleMissingCtsThread_err:
-      UpdateU64IfSmaller(new_err_info, &ctx->err_info);
-      break;
-    }
-  } while (!THREAD_BLOCK_FINISH(arg));
+  }
+  accp->all_ct_rem15 = all_ct_rem15;
+  accp->all_ct_rem255d15 = all_ct_rem255d15;
+  accp->hap_ct_rem15 = hap_ct_rem15;
+  accp->hap_ct_rem255d15 = hap_ct_rem255d15;
+  return reterr;
+}
+
+void SampleMissingAccFinish(uint32_t raw_sample_ct, SampleMissingAcc* accp) {
+  const uint32_t acc1_vec_ct = BitCtToVecCt(raw_sample_ct);
+  const uint32_t acc4_vec_ct = acc1_vec_ct * 4;
+  const uint32_t acc8_vec_ct = acc1_vec_ct * 8;
+  VecW* missing_hc_acc4 = &(R_CAST(VecW*, accp->missing_hc_acc1)[acc1_vec_ct]);
+  VecW* missing_hc_acc8 = &(missing_hc_acc4[acc4_vec_ct]);
+  VecW* missing_hc_acc32 = &(missing_hc_acc8[acc8_vec_ct]);
   VcountIncr4To8(missing_hc_acc4, acc4_vec_ct, missing_hc_acc8);
   VcountIncr8To32(missing_hc_acc8, acc8_vec_ct, missing_hc_acc32);
-  if (missing_dosage_acc1) {
+  if (accp->missing_dosage_acc1) {
+    VecW* missing_dosage_acc4 = &(R_CAST(VecW*, accp->missing_dosage_acc1)[acc1_vec_ct]);
+    VecW* missing_dosage_acc8 = &(missing_dosage_acc4[acc4_vec_ct]);
+    VecW* missing_dosage_acc32 = &(missing_dosage_acc8[acc8_vec_ct]);
     VcountIncr4To8(missing_dosage_acc4, acc4_vec_ct, missing_dosage_acc8);
     VcountIncr8To32(missing_dosage_acc8, acc8_vec_ct, missing_dosage_acc32);
   }
+  VecW* hethap_acc4 = &(R_CAST(VecW*, accp->hethap_acc1)[acc1_vec_ct]);
+  VecW* hethap_acc8 = &(hethap_acc4[acc4_vec_ct]);
+  VecW* hethap_acc32 = &(hethap_acc8[acc8_vec_ct]);
   VcountIncr4To8(hethap_acc4, acc4_vec_ct, hethap_acc8);
   VcountIncr8To32(hethap_acc8, acc8_vec_ct, hethap_acc32);
+}
+
+void SampleMissingAccReduce(uint32_t raw_sample_ct, uint32_t thread_ct, SampleMissingAcc* accs, uint32_t* sample_missing_hc_cts, uint32_t* sample_missing_dosage_cts, uint32_t* sample_hethap_cts) {
+  const uint32_t acc1_vec_ct = BitCtToVecCt(raw_sample_ct);
+  const uint32_t sample_ctv = acc1_vec_ct * kBitsPerVec;
+  const uintptr_t acc32_offset = acc1_vec_ct * (13 * k1LU * kWordsPerVec);
+  uint32_t* scrambled_missing_hc_cts = R_CAST(uint32_t*, &(accs[0].missing_hc_acc1[acc32_offset]));
+  uint32_t* scrambled_missing_dosage_cts = nullptr;
+  if (sample_missing_dosage_cts) {
+    scrambled_missing_dosage_cts = R_CAST(uint32_t*, &(accs[0].missing_dosage_acc1[acc32_offset]));
+  }
+  uint32_t* scrambled_hethap_cts = R_CAST(uint32_t*, &(accs[0].hethap_acc1[acc32_offset]));
+  for (uint32_t tidx = 1; tidx != thread_ct; ++tidx) {
+    uint32_t* thread_scrambled_missing_hc_cts = R_CAST(uint32_t*, &(accs[tidx].missing_hc_acc1[acc32_offset]));
+    for (uint32_t uii = 0; uii != sample_ctv; ++uii) {
+      scrambled_missing_hc_cts[uii] += thread_scrambled_missing_hc_cts[uii];
+    }
+    if (scrambled_missing_dosage_cts) {
+      uint32_t* thread_scrambled_missing_dosage_cts = R_CAST(uint32_t*, &(accs[tidx].missing_dosage_acc1[acc32_offset]));
+      for (uint32_t uii = 0; uii != sample_ctv; ++uii) {
+        scrambled_missing_dosage_cts[uii] += thread_scrambled_missing_dosage_cts[uii];
+      }
+    }
+    uint32_t* thread_scrambled_hethap_cts = R_CAST(uint32_t*, &(accs[tidx].hethap_acc1[acc32_offset]));
+    for (uint32_t uii = 0; uii != sample_ctv; ++uii) {
+      scrambled_hethap_cts[uii] += thread_scrambled_hethap_cts[uii];
+    }
+  }
+  for (uint32_t sample_uidx = 0; sample_uidx != raw_sample_ct; ++sample_uidx) {
+    const uint32_t scrambled_idx = VcountScramble1(sample_uidx);
+    sample_missing_hc_cts[sample_uidx] = scrambled_missing_hc_cts[scrambled_idx];
+    if (sample_missing_dosage_cts) {
+      sample_missing_dosage_cts[sample_uidx] = scrambled_missing_dosage_cts[scrambled_idx];
+    }
+    sample_hethap_cts[sample_uidx] = scrambled_hethap_cts[scrambled_idx];
+  }
+}
+
+typedef struct LoadSampleMissingCtsCtxStruct {
+  const uintptr_t* variant_include;
+  const ChrInfo* cip;
+  const uintptr_t* sex_male;
+  uint32_t raw_sample_ct;
+
+  PgenReader** pgr_ptrs;
+  uintptr_t** genovecs;
+  uint32_t* read_variant_uidx_starts;
+  uint32_t cur_block_size;
+
+  SampleMissingAcc* accs;
+
+  uint64_t err_info;
+} LoadSampleMissingCtsCtx;
+
+THREAD_FUNC_DECL LoadSampleMissingCtsThread(void* raw_arg) {
+  ThreadGroupFuncArg* arg = S_CAST(ThreadGroupFuncArg*, raw_arg);
+  const uintptr_t tidx = arg->tidx;
+  LoadSampleMissingCtsCtx* ctx = S_CAST(LoadSampleMissingCtsCtx*, arg->sharedp->context);
+
+  const uint32_t raw_sample_ct = ctx->raw_sample_ct;
+  const uint32_t calc_thread_ct = GetThreadCt(arg->sharedp);
+  uintptr_t* genovec_buf = ctx->genovecs[tidx];
+  SampleMissingAcc* accp = &(ctx->accs[tidx]);
+  SampleMissingAccInit(raw_sample_ct, accp);
+  do {
+    const uint32_t cur_block_size = ctx->cur_block_size;
+    const uint32_t cur_idx_ct = (((tidx + 1) * cur_block_size) / calc_thread_ct) - ((tidx * cur_block_size) / calc_thread_ct);
+    uint32_t err_variant_uidx;
+    const PglErr reterr = SampleMissingAccUpdate(ctx->variant_include, ctx->cip, ctx->sex_male, raw_sample_ct, ctx->read_variant_uidx_starts[tidx], cur_idx_ct, ctx->pgr_ptrs[tidx], genovec_buf, accp, &err_variant_uidx);
+    if (unlikely(reterr)) {
+      const uint64_t new_err_info = (S_CAST(uint64_t, err_variant_uidx) << 32) | S_CAST(uint32_t, reterr);
+      UpdateU64IfSmaller(new_err_info, &ctx->err_info);
+    }
+  } while (!THREAD_BLOCK_FINISH(arg));
+  SampleMissingAccFinish(raw_sample_ct, accp);
   THREAD_RETURN;
 }
 
@@ -3421,20 +3517,11 @@ PglErr LoadSampleMissingCts(const uintptr_t* sex_male, const uintptr_t* variant_
     }
     // this doesn't seem to saturate below 35 threads
     uint32_t calc_thread_ct = (max_thread_ct > 2)? (max_thread_ct - 1) : max_thread_ct;
-    const uint32_t acc1_vec_ct = BitCtToVecCt(raw_sample_ct);
-    const uintptr_t acc1_alloc_cacheline_ct = DivUp(acc1_vec_ct * (45 * k1LU * kBytesPerVec), kCacheline);
     ctx.sex_male = sex_male;
-    uintptr_t thread_alloc_cacheline_ct = 2 * acc1_alloc_cacheline_ct;
-    ctx.missing_dosage_acc1 = nullptr;
-    if (sample_missing_dosage_cts) {
-      if (unlikely(bigstack_alloc_wp(calc_thread_ct, &ctx.missing_dosage_acc1))) {
-        goto LoadSampleMissingCts_ret_NOMEM;
-      }
-      thread_alloc_cacheline_ct += acc1_alloc_cacheline_ct;
-    }
-    if (unlikely(
-            bigstack_alloc_wp(calc_thread_ct, &ctx.missing_hc_acc1) ||
-            bigstack_alloc_wp(calc_thread_ct, &ctx.hethap_acc1))) {
+    const uint32_t dosage_needed = (sample_missing_dosage_cts != nullptr);
+    const uintptr_t thread_alloc_cacheline_ct = CountSampleMissingAccCachelines(raw_sample_ct, dosage_needed);
+    ctx.accs = S_CAST(SampleMissingAcc*, bigstack_alloc(calc_thread_ct * sizeof(SampleMissingAcc)));
+    if (unlikely(!ctx.accs)) {
       goto LoadSampleMissingCts_ret_NOMEM;
     }
     STD_ARRAY_DECL(unsigned char*, 2, main_loadbufs);
@@ -3442,13 +3529,8 @@ PglErr LoadSampleMissingCts(const uintptr_t* sex_male, const uintptr_t* variant_
     if (unlikely(PgenMtLoadInit(variant_include, raw_sample_ct, raw_variant_ct, bigstack_left(), pgr_alloc_cacheline_ct, thread_alloc_cacheline_ct, 0, 0, pgfip, &calc_thread_ct, &ctx.genovecs, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &read_block_size, nullptr, main_loadbufs, &ctx.pgr_ptrs, &ctx.read_variant_uidx_starts))) {
       goto LoadSampleMissingCts_ret_NOMEM;
     }
-    const uintptr_t acc1_alloc = acc1_alloc_cacheline_ct * kCacheline;
     for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
-      ctx.missing_hc_acc1[tidx] = S_CAST(uintptr_t*, bigstack_alloc_raw(acc1_alloc));
-      if (ctx.missing_dosage_acc1) {
-        ctx.missing_dosage_acc1[tidx] = S_CAST(uintptr_t*, bigstack_alloc_raw(acc1_alloc));
-      }
-      ctx.hethap_acc1[tidx] = S_CAST(uintptr_t*, bigstack_alloc_raw(acc1_alloc));
+      SampleMissingAccAlloc(raw_sample_ct, dosage_needed, &(ctx.accs[tidx]));
     }
     ctx.variant_include = variant_include;
     ctx.cip = cip;
@@ -3512,40 +3594,7 @@ PglErr LoadSampleMissingCts(const uintptr_t* sex_male, const uintptr_t* variant_
       // pointers
       pgfip->block_base = main_loadbufs[parity];
     }
-    const uint32_t sample_ctv = acc1_vec_ct * kBitsPerVec;
-    const uintptr_t acc32_offset = acc1_vec_ct * (13 * k1LU * kWordsPerVec);
-    uint32_t* scrambled_missing_hc_cts = nullptr;
-    uint32_t* scrambled_missing_dosage_cts = nullptr;
-    uint32_t* scrambled_hethap_cts = nullptr;
-    scrambled_missing_hc_cts = R_CAST(uint32_t*, &(ctx.missing_hc_acc1[0][acc32_offset]));
-    if (ctx.missing_dosage_acc1) {
-      scrambled_missing_dosage_cts = R_CAST(uint32_t*, &(ctx.missing_dosage_acc1[0][acc32_offset]));
-    }
-    scrambled_hethap_cts = R_CAST(uint32_t*, &(ctx.hethap_acc1[0][acc32_offset]));
-    for (uint32_t tidx = 1; tidx != calc_thread_ct; ++tidx) {
-      uint32_t* thread_scrambled_missing_hc_cts = R_CAST(uint32_t*, &(ctx.missing_hc_acc1[tidx][acc32_offset]));
-      for (uint32_t uii = 0; uii != sample_ctv; ++uii) {
-        scrambled_missing_hc_cts[uii] += thread_scrambled_missing_hc_cts[uii];
-      }
-      if (scrambled_missing_dosage_cts) {
-        uint32_t* thread_scrambled_missing_dosage_cts = R_CAST(uint32_t*, &(ctx.missing_dosage_acc1[tidx][acc32_offset]));
-        for (uint32_t uii = 0; uii != sample_ctv; ++uii) {
-          scrambled_missing_dosage_cts[uii] += thread_scrambled_missing_dosage_cts[uii];
-        }
-      }
-      uint32_t* thread_scrambled_hethap_cts = R_CAST(uint32_t*, &(ctx.hethap_acc1[tidx][acc32_offset]));
-      for (uint32_t uii = 0; uii != sample_ctv; ++uii) {
-        scrambled_hethap_cts[uii] += thread_scrambled_hethap_cts[uii];
-      }
-    }
-    for (uint32_t sample_uidx = 0; sample_uidx != raw_sample_ct; ++sample_uidx) {
-      const uint32_t scrambled_idx = VcountScramble1(sample_uidx);
-      sample_missing_hc_cts[sample_uidx] = scrambled_missing_hc_cts[scrambled_idx];
-      if (sample_missing_dosage_cts) {
-        sample_missing_dosage_cts[sample_uidx] = scrambled_missing_dosage_cts[scrambled_idx];
-      }
-      sample_hethap_cts[sample_uidx] = scrambled_hethap_cts[scrambled_idx];
-    }
+    SampleMissingAccReduce(raw_sample_ct, calc_thread_ct, ctx.accs, sample_missing_hc_cts, sample_missing_dosage_cts, sample_hethap_cts);
     if (pct > 10) {
       putc_unlocked('\b', stdout);
     }
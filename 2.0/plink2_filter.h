@@ -70,7 +70,7 @@ FLAGSET_DEF_START()
   kfKeepFam = (1 << 1)
 FLAGSET_DEF_END(KeepFlags);
 
-PglErr KeepOrRemove(const char* fnames, const SampleIdInfo* siip, uint32_t raw_sample_ct, KeepFlags flags, uintptr_t* sample_include, uint32_t* sample_ct_ptr);
+PglErr KeepOrRemove(const char* fnames, const SampleIdInfo* siip, const XidIndex* xidxp, uint32_t raw_sample_ct, KeepFlags flags, uint32_t max_thread_ct, uintptr_t* sample_include, uint32_t* sample_ct_ptr);
 
 PglErr KeepColMatch(const char* fname, const SampleIdInfo* siip, const char* strs_flattened, const char* col_name, uint32_t raw_sample_ct, uint32_t col_num, uintptr_t* sample_include, uint32_t* sample_ct_ptr);
 
@@ -86,6 +86,38 @@ PglErr ReadAlleleFreqs(const uintptr_t* variant_include, const char* const* vari
 
 void ComputeMajAlleles(const uintptr_t* variant_include, const uintptr_t* allele_idx_offsets, const double* allele_freqs, uint32_t variant_ct, AlleleCode* maj_alleles);
 
+// Per-thread sample missing-call/hethap accumulators.  These are shared by
+// LoadSampleMissingCts() and LoadAlleleAndGenoCounts(), so the latter can fill
+// the --missing sample report's counts during its own pass over the .pgen.
+typedef struct SampleMissingAccStruct {
+  uintptr_t* missing_hc_acc1;
+  uintptr_t* missing_dosage_acc1;
+  uintptr_t* hethap_acc1;
+  uint32_t all_ct_rem15;
+  uint32_t all_ct_rem255d15;
+  uint32_t hap_ct_rem15;
+  uint32_t hap_ct_rem255d15;
+} SampleMissingAcc;
+
+uintptr_t CountSampleMissingAccCachelines(uint32_t raw_sample_ct, uint32_t dosage_needed);
+
+// Caller is responsible for reserving CountSampleMissingAccCachelines() worth
+// of bigstack space.
+void SampleMissingAccAlloc(uint32_t raw_sample_ct, uint32_t dosage_needed, SampleMissingAcc* accp);
+
+// Must be called by the worker thread before its first update.
+void SampleMissingAccInit(uint32_t raw_sample_ct, SampleMissingAcc* accp);
+
+// Processes the cur_variant_ct variant_include entries starting at
+// variant_uidx_start.  On error, *err_variant_uidxp is set.
+PglErr SampleMissingAccUpdate(const uintptr_t* variant_include, const ChrInfo* cip, const uintptr_t* sex_male, uint32_t raw_sample_ct, uint32_t variant_uidx_start, uint32_t cur_variant_ct, PgenReader* pgrp, uintptr_t* genovec_buf, SampleMissingAcc* accp, uint32_t* err_variant_uidxp);
+
+// Must be called by the worker thread after its last update.
+void SampleMissingAccFinish(uint32_t raw_sample_ct, SampleMissingAcc* accp);
+
+// Clobbers accs[0].
+void SampleMissingAccReduce(uint32_t raw_sample_ct, uint32_t thread_ct, SampleMissingAcc* accs, uint32_t* sample_missing_hc_cts, uint32_t* sample_missing_dosage_cts, uint32_t* sample_hethap_cts);
+
 PglErr LoadSampleMissingCts(const uintptr_t* sex_male, const uintptr_t* variant_include, const ChrInfo* cip, uint32_t raw_variant_ct, uint32_t variant_ct, uint32_t raw_sample_ct, uint32_t max_thread_ct, uintptr_t pgr_alloc_cacheline_ct, PgenFileInfo* pgfip, uint32_t* sample_missing_hc_cts, uint32_t* sample_missing_dosage_cts, uint32_t* sample_hethap_cts);
 
 PglErr MindFilter(const uint32_t* sample_missing_cts, const uint32_t* sample_hethap_cts, const SampleIdInfo* siip, uint32_t raw_sample_ct, uint32_t variant_ct, uint32_t variant_ct_y, double mind_thresh, uintptr_t* sample_include, uintptr_t* sex_male, uint32_t* sample_ct_ptr, char* outname, char* outname_end);
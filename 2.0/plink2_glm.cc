@@ -3247,6 +3247,13 @@ typedef struct GlmCtxStruct {
 
   uint32_t cur_block_variant_ct;
 
+  // may be nullptr; subset IDs are UINT32_MAX when the corresponding
+  // sample_include is null
+  PgrDecodeCache* dcachep;
+  uint32_t dcache_subset_id;
+  uint32_t dcache_subset_id_x;
+  uint32_t dcache_subset_id_y;
+
   PgenReader** pgr_ptrs;
   uintptr_t** genovecs;
   uintptr_t** thread_mhc;
@@ -3383,6 +3390,7 @@ THREAD_FUNC_DECL GlmLogisticThread(void* raw_arg) {
       const uint32_t is_nonx_haploid = (!is_x) && IsSet(cip->haploid_mask, chr_idx);
       const uintptr_t* cur_sample_include;
       const uint32_t* cur_sample_include_cumulative_popcounts;
+      uint32_t cur_dcache_subset_id;
       const uintptr_t* cur_pheno_cc;
       const uintptr_t* cur_gcount_case_interleaved_vec;
       const float* cur_pheno;
@@ -3396,6 +3404,7 @@ THREAD_FUNC_DECL GlmLogisticThread(void* raw_arg) {
       uint32_t cur_is_always_firth;
       if (is_y && common->sample_include_y) {
         cur_sample_include = common->sample_include_y;
+        cur_dcache_subset_id = common->dcache_subset_id_y;
         cur_sample_include_cumulative_popcounts = common->sample_include_y_cumulative_popcounts;
         cur_pheno_cc = ctx->pheno_y_cc;
         cur_gcount_case_interleaved_vec = ctx->gcount_case_interleaved_vec_y;
@@ -3410,6 +3419,7 @@ THREAD_FUNC_DECL GlmLogisticThread(void* raw_arg) {
         cur_is_always_firth = is_always_firth || ctx->separation_found_y;
       } else if (is_x && common->sample_include_x) {
         cur_sample_include = common->sample_include_x;
+        cur_dcache_subset_id = common->dcache_subset_id_x;
         cur_sample_include_cumulative_popcounts = common->sample_include_x_cumulative_popcounts;
         cur_pheno_cc = ctx->pheno_x_cc;
         cur_gcount_case_interleaved_vec = ctx->gcount_case_interleaved_vec_x;
@@ -3424,6 +3434,7 @@ THREAD_FUNC_DECL GlmLogisticThread(void* raw_arg) {
         cur_is_always_firth = is_always_firth || ctx->separation_found_x;
       } else {
         cur_sample_include = common->sample_include;
+        cur_dcache_subset_id = common->dcache_subset_id;
         cur_sample_include_cumulative_popcounts = common->sample_include_cumulative_popcounts;
         cur_pheno_cc = ctx->pheno_cc;
         cur_gcount_case_interleaved_vec = ctx->gcount_case_interleaved_vec;
@@ -3574,7 +3585,7 @@ THREAD_FUNC_DECL GlmLogisticThread(void* raw_arg) {
         const uint32_t expected_predictor_ct = cur_biallelic_predictor_ct + allele_ct_m2;
         PglErr reterr;
         if (!allele_ct_m2) {
-          reterr = PgrGetD(cur_sample_include, pssi, cur_sample_ct, variant_uidx, pgrp, pgv.genovec, pgv.dosage_present, pgv.dosage_main, &(pgv.dosage_ct));
+          reterr = PgrGetDCached(cur_sample_include, pssi, cur_sample_ct, variant_uidx, cur_dcache_subset_id, common->dcachep, pgrp, pgv.genovec, pgv.dosage_present, pgv.dosage_main, &(pgv.dosage_ct));
         } else {
           reterr = PgrGetMD(cur_sample_include, pssi, cur_sample_ct, variant_uidx, pgrp, &pgv);
           // todo: proper multiallelic dosage support
@@ -6520,6 +6531,7 @@ THREAD_FUNC_DECL GlmLinearThread(void* raw_arg) {
       const uint32_t is_nonx_haploid = (!is_x) && IsSet(cip->haploid_mask, chr_idx);
       const uintptr_t* cur_sample_include;
       const uint32_t* cur_sample_include_cumulative_popcounts;
+      uint32_t cur_dcache_subset_id;
       const double* cur_pheno;
       const RegressionNmPrecomp* nm_precomp;
       const double* cur_covars_cmaj;
@@ -6530,6 +6542,7 @@ THREAD_FUNC_DECL GlmLinearThread(void* raw_arg) {
       uint32_t cur_constraint_ct;
       if (is_y && common->sample_include_y) {
         cur_sample_include = common->sample_include_y;
+        cur_dcache_subset_id = common->dcache_subset_id_y;
         cur_sample_include_cumulative_popcounts = common->sample_include_y_cumulative_popcounts;
         cur_pheno = ctx->pheno_y_d;
         nm_precomp = common->nm_precomp_y;
@@ -6541,6 +6554,7 @@ THREAD_FUNC_DECL GlmLinearThread(void* raw_arg) {
         cur_constraint_ct = common->constraint_ct_y;
       } else if (is_x && common->sample_include_x) {
         cur_sample_include = common->sample_include_x;
+        cur_dcache_subset_id = common->dcache_subset_id_x;
         cur_sample_include_cumulative_popcounts = common->sample_include_x_cumulative_popcounts;
         cur_pheno = ctx->pheno_x_d;
         nm_precomp = common->nm_precomp_x;
@@ -6552,6 +6566,7 @@ THREAD_FUNC_DECL GlmLinearThread(void* raw_arg) {
         cur_constraint_ct = common->constraint_ct_x;
       } else {
         cur_sample_include = common->sample_include;
+        cur_dcache_subset_id = common->dcache_subset_id;
         cur_sample_include_cumulative_popcounts = common->sample_include_cumulative_popcounts;
         cur_pheno = ctx->pheno_d;
         nm_precomp = common->nm_precomp;
@@ -6687,7 +6702,7 @@ THREAD_FUNC_DECL GlmLinearThread(void* raw_arg) {
         const uint32_t expected_predictor_ct = cur_biallelic_predictor_ct + allele_ct_m2;
         PglErr reterr;
         if (!allele_ct_m2) {
-          reterr = PgrGetD(cur_sample_include, pssi, cur_sample_ct, variant_uidx, pgrp, pgv.genovec, pgv.dosage_present, pgv.dosage_main, &(pgv.dosage_ct));
+          reterr = PgrGetDCached(cur_sample_include, pssi, cur_sample_ct, variant_uidx, cur_dcache_subset_id, common->dcachep, pgrp, pgv.genovec, pgv.dosage_present, pgv.dosage_main, &(pgv.dosage_ct));
         } else {
           reterr = PgrGetMD(cur_sample_include, pssi, cur_sample_ct, variant_uidx, pgrp, &pgv);
           // todo: proper multiallelic dosage support
@@ -8583,6 +8598,7 @@ THREAD_FUNC_DECL GlmLinearSubbatchThread(void* raw_arg) {
       const uint32_t is_nonx_haploid = (!is_x) && IsSet(cip->haploid_mask, chr_idx);
       const uintptr_t* cur_sample_include;
       const uint32_t* cur_sample_include_cumulative_popcounts;
+      uint32_t cur_dcache_subset_id;
       const double* cur_pheno_pmaj;
       const RegressionNmPrecomp* nm_precomp;
       const double* cur_covars_cmaj;
@@ -8593,6 +8609,7 @@ THREAD_FUNC_DECL GlmLinearSubbatchThread(void* raw_arg) {
       uint32_t cur_constraint_ct;
       if (is_y && common->sample_include_y) {
         cur_sample_include = common->sample_include_y;
+        cur_dcache_subset_id = common->dcache_subset_id_y;
         cur_sample_include_cumulative_popcounts = common->sample_include_y_cumulative_popcounts;
         cur_pheno_pmaj = ctx->pheno_y_d;
         nm_precomp = common->nm_precomp_y;
@@ -8604,6 +8621,7 @@ THREAD_FUNC_DECL GlmLinearSubbatchThread(void* raw_arg) {
         cur_constraint_ct = common->constraint_ct_y;
       } else if (is_x && common->sample_include_x) {
         cur_sample_include = common->sample_include_x;
+        cur_dcache_subset_id = common->dcache_subset_id_x;
         cur_sample_include_cumulative_popcounts = common->sample_include_x_cumulative_popcounts;
         cur_pheno_pmaj = ctx->pheno_x_d;
         nm_precomp = common->nm_precomp_x;
@@ -8615,6 +8633,7 @@ THREAD_FUNC_DECL GlmLinearSubbatchThread(void* raw_arg) {
         cur_constraint_ct = common->constraint_ct_x;
       } else {
         cur_sample_include = common->sample_include;
+        cur_dcache_subset_id = common->dcache_subset_id;
         cur_sample_include_cumulative_popcounts = common->sample_include_cumulative_popcounts;
         cur_pheno_pmaj = ctx->pheno_d;
         nm_precomp = common->nm_precomp;
@@ -8757,7 +8776,7 @@ THREAD_FUNC_DECL GlmLinearSubbatchThread(void* raw_arg) {
         const uint32_t expected_predictor_ct = cur_biallelic_predictor_ct + allele_ct_m2;
         PglErr reterr;
         if (!allele_ct_m2) {
-          reterr = PgrGetD(cur_sample_include, pssi, cur_sample_ct, variant_uidx, pgrp, pgv.genovec, pgv.dosage_present, pgv.dosage_main, &(pgv.dosage_ct));
+          reterr = PgrGetDCached(cur_sample_include, pssi, cur_sample_ct, variant_uidx, cur_dcache_subset_id, common->dcachep, pgrp, pgv.genovec, pgv.dosage_present, pgv.dosage_main, &(pgv.dosage_ct));
         } else {
           reterr = PgrGetMD(cur_sample_include, pssi, cur_sample_ct, variant_uidx, pgrp, &pgv);
           // todo: proper multiallelic dosage support
@@ -10654,7 +10673,26 @@ void SexInteractionReshuffle(uint32_t first_interaction_pred_uidx, uint32_t raw_
   memcpy(parameters_or_tests, parameter_subset_reshuffle_buf, biallelic_raw_predictor_ctl * sizeof(intptr_t));
 }
 
-PglErr GlmMain(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, const uintptr_t* sex_nm, const uintptr_t* sex_male, const PhenoCol* pheno_cols, const char* pheno_names, const PhenoCol* covar_cols, const char* covar_names, const uintptr_t* orig_variant_include, const ChrInfo* cip, const uint32_t* variant_bps, const char* const* variant_ids, const uintptr_t* allele_idx_offsets, const AlleleCode* maj_alleles, const char* const* allele_storage, const GlmInfo* glm_info_ptr, const AdjustInfo* adjust_info_ptr, const APerm* aperm_ptr, const char* local_covar_fname, const char* local_pvar_fname, const char* local_psam_fname, uint32_t raw_sample_ct, uint32_t orig_sample_ct, uint32_t pheno_ct, uintptr_t max_pheno_name_blen, uint32_t orig_covar_ct, uintptr_t max_covar_name_blen, uint32_t raw_variant_ct, uint32_t orig_variant_ct, uint32_t max_variant_id_slen, uint32_t max_allele_slen, uint32_t xchr_model, double ci_size, double vif_thresh, double ln_pfilter, double output_min_ln, uint32_t max_thread_ct, uintptr_t pgr_alloc_cacheline_ct, PgenFileInfo* pgfip, PgenReader* simple_pgrp, char* outname, char* outname_end) {
+// Must be called after the common->sample_include{,_x,_y} updates for each
+// phenotype (or phenotype batch).  If no other phenotype pass shares this
+// sample set, the cache is bypassed: nothing would ever hit the entries.
+void GlmUpdateDecodeCacheSubsetIds(uint32_t sample_set_shared, GlmCtx* common) {
+  PgrDecodeCache* dcachep = common->dcachep;
+  if (!dcachep) {
+    return;
+  }
+  if (!sample_set_shared) {
+    common->dcache_subset_id = UINT32_MAX;
+    common->dcache_subset_id_x = UINT32_MAX;
+    common->dcache_subset_id_y = UINT32_MAX;
+    return;
+  }
+  common->dcache_subset_id = PgrDecodeCacheSubsetId(common->sample_include, common->sample_ct, dcachep);
+  common->dcache_subset_id_x = common->sample_include_x? PgrDecodeCacheSubsetId(common->sample_include_x, common->sample_ct_x, dcachep) : UINT32_MAX;
+  common->dcache_subset_id_y = common->sample_include_y? PgrDecodeCacheSubsetId(common->sample_include_y, common->sample_ct_y, dcachep) : UINT32_MAX;
+}
+
+PglErr GlmMain(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, const uintptr_t* sex_nm, const uintptr_t* sex_male, const PhenoCol* pheno_cols, const char* pheno_names, const PhenoCol* covar_cols, const char* covar_names, const uintptr_t* orig_variant_include, const ChrInfo* cip, const uint32_t* variant_bps, const char* const* variant_ids, const uintptr_t* allele_idx_offsets, const AlleleCode* maj_alleles, const char* const* allele_storage, const GlmInfo* glm_info_ptr, const AdjustInfo* adjust_info_ptr, const APerm* aperm_ptr, const char* local_covar_fname, const char* local_pvar_fname, const char* local_psam_fname, uint32_t raw_sample_ct, uint32_t orig_sample_ct, uint32_t pheno_ct, uintptr_t max_pheno_name_blen, uint32_t orig_covar_ct, uintptr_t max_covar_name_blen, uint32_t raw_variant_ct, uint32_t orig_variant_ct, uint32_t max_variant_id_slen, uint32_t max_allele_slen, uint32_t xchr_model, double ci_size, double vif_thresh, double ln_pfilter, double output_min_ln, uint32_t max_thread_ct, uintptr_t pgr_alloc_cacheline_ct, PgenFileInfo* pgfip, PgrDecodeCache* dcachep, PgenReader* simple_pgrp, char* outname, char* outname_end) {
   unsigned char* bigstack_mark = g_bigstack_base;
   unsigned char* bigstack_end_mark = g_bigstack_end;
   PglErr reterr = kPglRetSuccess;
@@ -10694,6 +10732,7 @@ PglErr GlmMain(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, c
     }
 
     common.glm_flags = glm_flags;
+    common.dcachep = dcachep;
     common.dosage_presents = nullptr;
     common.dosage_mains = nullptr;
     const uint32_t output_zst = (glm_flags / kfGlmZs) & 1;
@@ -10989,7 +11028,7 @@ PglErr GlmMain(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, c
               }
             }
             uint32_t dosage_ct;
-            reterr = PgrGetD(nullptr, null_pssi, raw_sample_ct, cur_variant_uidx, simple_pgrp, genovec, dosage_present, dosage_main, &dosage_ct);
+            reterr = PgrGetDCached(nullptr, null_pssi, raw_sample_ct, cur_variant_uidx, 0, dcachep, simple_pgrp, genovec, dosage_present, dosage_main, &dosage_ct);
             if (unlikely(reterr)) {
               goto GlmMain_ret_PGR_FAIL;
             }
@@ -11389,6 +11428,12 @@ PglErr GlmMain(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, c
 
     const uint32_t pheno_ctl = BitCtToWordCt(pheno_ct);
     uintptr_t* pheno_include;
+    uintptr_t* pheno_dcache_shared = nullptr;
+    if (dcachep && (pheno_ct > 1)) {
+      if (unlikely(bigstack_alloc_w(pheno_ctl, &pheno_dcache_shared))) {
+        goto GlmMain_ret_NOMEM;
+      }
+    }
     if (unlikely(bigstack_alloc_w(pheno_ctl, &pheno_include))) {
       goto GlmMain_ret_NOMEM;
     }
@@ -11871,6 +11916,8 @@ PglErr GlmMain(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, c
           common.sample_include_y_cumulative_popcounts = nullptr;
           common.covar_ct_y = 0;
         }
+        // Each batch is a single pass over its shared sample set.
+        GlmUpdateDecodeCacheSubsetIds(0, &common);
 
         if (unlikely(AllocAndFillSubsetChrFoVidxStart(cur_variant_include, cip, &common.subset_chr_fo_vidx_start))) {
           goto GlmMain_ret_NOMEM;
@@ -11924,6 +11971,43 @@ PglErr GlmMain(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, c
         }
       }
     }
+    if (pheno_dcache_shared) {
+      // --decode-cache only pays off for phenotypes below which share their
+      // missingness pattern with another; flag them.  (Covariate QC can still
+      // shrink a sample set differently, in which case we just miss.)
+      uint32_t* pheno_nm_hashes;
+      uintptr_t* pheno_nonmiss_tmp;
+      if (unlikely(
+              bigstack_alloc_u32(pheno_ct, &pheno_nm_hashes) ||
+              bigstack_alloc_w(raw_sample_ctl, &pheno_nonmiss_tmp))) {
+        goto GlmMain_ret_NOMEM;
+      }
+      ZeroWArr(pheno_ctl, pheno_dcache_shared);
+      for (uint32_t pheno_uidx = 0; pheno_uidx != pheno_ct; ++pheno_uidx) {
+        if (IsSet(pheno_include, pheno_uidx) && (pheno_cols[pheno_uidx].type_code != kPhenoDtypeCat)) {
+          BitvecAndCopy(orig_sample_include, pheno_cols[pheno_uidx].nonmiss, raw_sample_ctl, cur_sample_include);
+          pheno_nm_hashes[pheno_uidx] = Hash32(cur_sample_include, raw_sample_ctl * sizeof(intptr_t));
+        }
+      }
+      for (uint32_t pheno_uidx = 0; pheno_uidx != pheno_ct; ++pheno_uidx) {
+        if ((!IsSet(pheno_include, pheno_uidx)) || (pheno_cols[pheno_uidx].type_code == kPhenoDtypeCat) || IsSet(pheno_dcache_shared, pheno_uidx)) {
+          continue;
+        }
+        const uint32_t cur_hash = pheno_nm_hashes[pheno_uidx];
+        BitvecAndCopy(orig_sample_include, pheno_cols[pheno_uidx].nonmiss, raw_sample_ctl, cur_sample_include);
+        for (uint32_t pheno_uidx2 = pheno_uidx + 1; pheno_uidx2 != pheno_ct; ++pheno_uidx2) {
+          if ((!IsSet(pheno_include, pheno_uidx2)) || (pheno_cols[pheno_uidx2].type_code == kPhenoDtypeCat) || (cur_hash != pheno_nm_hashes[pheno_uidx2])) {
+            continue;
+          }
+          BitvecAndCopy(orig_sample_include, pheno_cols[pheno_uidx2].nonmiss, raw_sample_ctl, pheno_nonmiss_tmp);
+          if (memequal(cur_sample_include, pheno_nonmiss_tmp, raw_sample_ctl * sizeof(intptr_t))) {
+            SetBit(pheno_uidx, pheno_dcache_shared);
+            SetBit(pheno_uidx2, pheno_dcache_shared);
+          }
+        }
+      }
+      BigstackReset(pheno_nm_hashes);
+    }
 
     for (uint32_t pheno_uidx = 0; pheno_uidx != pheno_ct; ++pheno_uidx) {
       if (!IsSet(pheno_include, pheno_uidx)) {
@@ -12471,6 +12555,7 @@ PglErr GlmMain(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, c
         common.sample_include_y_cumulative_popcounts = nullptr;
         common.covar_ct_y = 0;
       }
+      GlmUpdateDecodeCacheSubsetIds(pheno_dcache_shared && IsSet(pheno_dcache_shared, pheno_uidx), &common);
 
       double* orig_ln_pvals = nullptr;
       double* orig_permstat = nullptr;
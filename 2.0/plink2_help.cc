@@ -121,6 +121,15 @@ PglErr DispHelp(const char* const* argvk, uint32_t param_ct) {
 "  --pfile <prefix> ['vzs']  : Specify .pgen + .pvar[.zst] + .psam prefix.\n"
 "  --pgen <filename>         : Specify full name of .pgen/.bed file.\n"
                );
+    HelpPrint("pfile\0pfile-list\0", &help_ctrl, 1,
+"  --pfile-list <list file> ['vzs'] :\n"
+"                              Treat the filesets named in the list file (one\n"
+"                              prefix per line) as a single fileset, with\n"
+"                              their variants concatenated in list order.\n"
+"                              .psam files must be identical, and commands\n"
+"                              which reload the .pvar INFO column aren't\n"
+"                              supported yet.\n"
+               );
     HelpPrint("pfile\0pgen\0pvar\0psam\0bfile\0bed\0bim\0fam\0dosage\0", &help_ctrl, 1,
 "  --pvar <filename>         : Specify full name of .pvar/.bim file.\n"
               );
@@ -162,7 +171,11 @@ PglErr DispHelp(const char* const* argvk, uint32_t param_ct) {
 "      In all of these cases, hardcalls are regenerated from scratch from the\n"
 "      dosages.  As a consequence, variants with no GT field can now be\n"
 "      imported; they will be assumed to contain only diploid calls when HDS is\n"
-"      also absent.\n\n"
+"      also absent.\n"
+"    * Named pipes (e.g. process substitution, or /dev/stdin) are accepted.\n"
+"      Since two passes are needed, the input is spooled to a temporary file\n"
+"      next to the output; --vcf-spool does the same for regular VCF files, so\n"
+"      that a .vcf.gz is only decompressed once.\n\n"
               );
     HelpPrint("data\0gen\0bgen\0sample\0haps\0legend\0", &help_ctrl, 1,
 "  --data <filename prefix> <REF/ALT mode> ['gzs']\n"
@@ -175,6 +188,8 @@ PglErr DispHelp(const char* const* argvk, uint32_t param_ct) {
 "      companion .sample file.\n"
 "    * With 'snpid-chr', chromosome codes are read from the 'SNP ID' field\n"
 "      instead of the usual chromosome field.\n"
+"    * When a chromosome filter is applied to a BGEN v1.2+ file, a bgenix index\n"
+"      (<filename>.bgi) is used to skip the excluded variants, if present.\n"
 "    * The following REF/ALT modes are supported:\n"
 "      'ref-first': The first allele for each variant is REF.\n"
 "      'ref-last': The last allele for each variant is REF.\n"
@@ -282,10 +297,12 @@ PglErr DispHelp(const char* const* argvk, uint32_t param_ct) {
               );
     HelpPrint("make-pgen\0make-bpgen\0make-bed\0make-just-pvar\0make-just-psam\0", &help_ctrl, 1,
 "  --make-pgen ['vzs'] ['format='<code>] ['trim-alts'] ['erase-phase']\n"
-"              ['erase-dosage'] ['fill-missing-from-dosage']\n"
+"              ['erase-dosage'] ['fill-missing-from-dosage'] ['pbwt-phase']\n"
+"              ['zst-blocks'] ['smaj-tiles'] ['dosage-delta']\n"
 "              ['pvar-cols='<col set desc>] ['psam-cols='<col set desc>]\n"
 "  --make-bpgen ['vzs'] ['format='<code>] ['trim-alts'] ['erase-phase']\n"
-"               ['erase-dosage'] ['fill-missing-from-dosage']\n"
+"               ['erase-dosage'] ['fill-missing-from-dosage'] ['pbwt-phase']\n"
+"               ['zst-blocks'] ['smaj-tiles'] ['dosage-delta']\n"
 "  --make-bed ['vzs'] ['trim-alts']\n"
                /*
 "  --make-pgen ['vzs'] ['format='<code>] [{trim-alts | erase-alt2+}]\n"
@@ -326,6 +343,26 @@ PglErr DispHelp(const char* const* argvk, uint32_t param_ct) {
 "    * When a hardcall is missing but the corresponding dosage is present,\n"
 "      'fill-missing-from-dosage' causes the (Euclidean-)nearest hardcall to be\n"
 "      filled in, with ties broken in favor of the lower-index allele.\n"
+"    * 'pbwt-phase' causes biallelic hardcall phase information to be stored in\n"
+"      positional Burrows-Wheeler transform order, in the records where that's\n"
+"      smaller.  Every other phased record gains a 1-byte marker, so datasets\n"
+"      with little haplotype sharing grow slightly (typically <1%).  This\n"
+"      usually shrinks large phased datasets, at the cost of slower random\n"
+"      access to phased variants.\n"
+"    * 'zst-blocks' causes variant records to be Zstd-compressed in groups of up\n"
+"      to 65536 variants.  This typically shrinks dense array data 2-3x, at the\n"
+"      cost of slower random access; the resulting .pgen can only be read by\n"
+"      builds with Zstd .pgen support.\n"
+"    * 'smaj-tiles' additionally writes a sample-major copy of the hardcalls to\n"
+"      <output prefix>.pgen.smaj, as Zstd-compressed tiles of 64 samples x 65536\n"
+"      variants.  With --smaj-tiles, some per-sample reports (currently --het)\n"
+"      then only read the tiles covering the samples they're run on.  This can't\n"
+"      be combined with sorting or genotype-altering modifiers.\n"
+"    * 'dosage-delta' causes biallelic dosages to be stored as variable-length\n"
+"      deltas from the nearest hardcall (entropy-coded when that helps), in\n"
+"      the records where that's smaller.  Every other dosage record gains a\n"
+"      1-byte marker.  This usually shrinks imputed datasets with many\n"
+"      near-integer dosages.\n"
                /*
 "    * The 'multiallelics=' modifier (alias: 'm=') specifies a join or split\n"
 "      mode.  The following modes are currently supported:\n"
@@ -987,6 +1024,15 @@ PglErr DispHelp(const char* const* argvk, uint32_t param_ct) {
 "    <output prefix>.king.cutoff.in.id + .king.cutoff.out.id.\n"
 "    If present, the .king.bin file must be triangular (either precision is ok).\n\n"
                );
+    HelpPrint("king-cutoff-table\0king-cutoff\0make-king-table\0", &help_ctrl, 1,
+"  --king-cutoff-table <.kin0 file> <threshold>\n"
+"    Like --king-cutoff, but the sample pairs exceeding the threshold are read\n"
+"    from a KING- or plink2-generated .kin0 file (e.g. the output of\n"
+"    --make-king-table + --king-table-filter).  Memory usage scales with the\n"
+"    number of listed pairs rather than the square of the sample count, and\n"
+"    separate connected components of the relatedness graph are pruned in\n"
+"    parallel.\n\n"
+               );
     HelpPrint("write-covar\0with-phenotype\0", &help_ctrl, 1,
 "  --write-covar ['cols='<column set descriptor>]\n"
 "    If covariates are defined, an updated version (with all filters applied) is\n"
@@ -1279,8 +1325,20 @@ PglErr DispHelp(const char* const* argvk, uint32_t param_ct) {
 "    Reports basic information about a .pgen file.\n\n"
                );
     HelpPrint("validate\0", &help_ctrl, 1,
-"  --validate\n"
-"    Validates all variant records in a .pgen file.\n\n"
+"  --validate ['write-checksums' | 'checksums']\n"
+"    Validates all variant records in a .pgen file.\n"
+"    * 'write-checksums' also writes an XXH64 checksum for the header and for\n"
+"      each 65536-variant block to <.pgen filename>.xxh64 .\n"
+"    * 'checksums' skips record validation, and instead compares the .pgen\n"
+"      against an existing .xxh64 file; every mismatching block is reported.\n\n"
+               );
+    HelpPrint("bcf-subset\0bcf\0", &help_ctrl, 1,
+"  --bcf-subset\n"
+"    Write a subset of the --bcf file to a new BCF file, without decoding\n"
+"    genotypes or generating .pgen/.pvar/.psam files.  Only --keep/--remove,\n"
+"    --extract/--exclude (variant ID mode), and chromosome filters are\n"
+"    supported; all other header lines, INFO, and FORMAT fields are passed\n"
+"    through unchanged.  Sample IDs are matched with FID 0.\n\n"
                );
     HelpPrint("zst-decompress\0zd\0", &help_ctrl, 1,
 "  --zst-decompress <.zst file> [output filename]\n"
@@ -1326,8 +1384,11 @@ PglErr DispHelp(const char* const* argvk, uint32_t param_ct) {
 "  --iid-sid           : Make --id-delim and --sample-diff interpret two-token\n"
 "                        sample IDs as IID-SID instead of FID-IID.\n"
               );
-    HelpPrint("vcf\0bcf\0vcf-half-call\0vcf-min-gq\0vcf-min-dp\0vcf-max-dp\0vcf-require-gt\0", &help_ctrl, 0,
+    HelpPrint("vcf\0bcf\0vcf-half-call\0vcf-min-gq\0vcf-min-dp\0vcf-max-dp\0vcf-require-gt\0vcf-spool\0", &help_ctrl, 0,
 "  --vcf-require-gt    : Skip variants with no GT field.\n"
+"  --vcf-spool         : Save the decompressed VCF text to a temporary .zst file\n"
+"                        during the first pass, and read it back during the\n"
+"                        second.  (Automatic when --vcf names a pipe.)\n"
 "  --vcf-min-gq <val>  : No-call genotypes when GQ is present and below the\n"
 "                        threshold.\n"
 "  --vcf-max-dp <val>  : No-call genotypes when DP is present and above/below\n"
@@ -1998,9 +2059,16 @@ PglErr DispHelp(const char* const* argvk, uint32_t param_ct) {
     // todo: add citation for 2018 KING update paper, which should discuss the
     // two-stage screen + refine workflow supported by --king-table-subset,
     // when it comes out
-    HelpPrint("make-king\0make-king-table\0king-table-filter\0king-table-subset\0", &help_ctrl, 0,
+    HelpPrint("make-king\0make-king-table\0king-table-filter\0king-table-prefilter\0king-table-subset\0", &help_ctrl, 0,
 "  --king-table-filter <min>      : Specify minimum kinship coefficient for\n"
 "                                   inclusion in --make-king-table report.\n"
+"  --king-table-prefilter [scan ct] [max carriers] [min shared] :\n"
+"    Restrict current --make-king-table run to sample pairs which share at least\n"
+"    [min shared] (default 2) rare alleles, where 'rare' means at most\n"
+"    [max carriers] (default 32) carriers, among [scan ct] (default 20000)\n"
+"    evenly-spaced variants.  This avoids the all-pairs computation in large\n"
+"    cohorts, but can miss distant relationships; combine with\n"
+"    --king-table-filter and check the reported candidate count.\n"
 "  --king-table-subset <f> [kmin] : Restrict current --make-king-table run to\n"
 "                                   sample pairs listed in the given .kin0 file.\n"
 "                                   If a second argument is provided, only\n"
@@ -2139,6 +2207,41 @@ PglErr DispHelp(const char* const* argvk, uint32_t param_ct) {
 "                               request size when the initial attempt fails, add\n"
 "                               the 'require' modifier.\n"
                );
+    HelpPrint("smaj-tiles\0make-pgen\0het\0", &help_ctrl, 0,
+"  --smaj-tiles       : Let --het read the .pgen.smaj sample-major tile file\n"
+"                       written by \"--make-pgen smaj-tiles\", when it matches the\n"
+"                       .pgen.  Only the tiles covering the current sample set\n"
+"                       are read, so this pays off when few samples are kept\n"
+"                       and they're clustered in sample order.\n"
+               );
+    HelpPrint("pheno-cache\0pheno\0covar\0", &help_ctrl, 0,
+"  --pheno-cache      : Save the parsed --pheno/--covar columns to\n"
+"                       <filename>.pheno.cache / <filename>.covar.cache, and\n"
+"                       load them from there in later runs.  The cache is only\n"
+"                       used when the source file's size and modification time,\n"
+"                       the sample IDs and sample filters, and the column\n"
+"                       selection/missing-value flags all match; otherwise\n"
+"                       the file is parsed and the cache rewritten.\n"
+               );
+    HelpPrint("sample-id-index\0keep\0remove\0pheno\0covar\0", &help_ctrl, 0,
+"  --sample-id-index  : Save the sample-ID hash tables used by --keep, --remove,\n"
+"                       --pheno, and --covar to <.psam/.fam name>.xidx, and\n"
+"                       reuse that file in later runs instead of rebuilding the\n"
+"                       tables.  The file is validated against the loaded\n"
+"                       sample IDs, and rebuilt when stale.\n"
+               );
+    HelpPrint("decode-cache\0memory\0glm\0", &help_ctrl, 0,
+"  --decode-cache <MiB> : Keep up to this much decoded genotype/dosage data in\n"
+"                         a cache shared by all threads.  Only the most recent\n"
+"                         sample subset is kept for each variant, so this\n"
+"                         currently only helps --glm logistic/Firth regression\n"
+"                         on several phenotypes with identical missingness\n"
+"                         patterns: later phenotypes reuse the first one's\n"
+"                         decoded variants when they still fit.  (Linear\n"
+"                         regression already decodes once per batch of such\n"
+"                         phenotypes.)  Capped at half of the workspace left\n"
+"                         when --glm starts.\n"
+               );
     HelpPrint("threads\0num_threads\0thread-num\0seed\0", &help_ctrl, 0,
 "  --threads <val>    : Set maximum number of compute threads.\n"
                );
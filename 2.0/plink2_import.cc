@@ -17,11 +17,14 @@
 
 #include "include/pgenlib_write.h"
 #include "plink2_compress_stream.h"
+#include "plink2_filter.h"
 #include "plink2_import.h"
 #include "plink2_psam.h"
 #include "plink2_pvar.h"
 #include "plink2_random.h"
 
+#include <unistd.h>  // unlink()
+
 #ifdef __cplusplus
 namespace plink2 {
 #endif
@@ -146,6 +149,13 @@ uint64_t GparseWriteByteCt(uint32_t sample_ct, uint32_t allele_ct, GparseFlags f
   return vec_ct * kBytesPerVec;
 }
 
+// line-based text formats where each line is parsed independently (.gen,
+// .haps, PLINK 1 dosage)
+typedef struct GparseReadTextMetadataStruct {
+  uintptr_t line_idx;  // for error reporting
+  uint32_t is_haploid;  // .haps only
+} GparseReadTextMetadata;
+
 typedef struct GparseWriteMetadataStruct {
   uint32_t patch_01_ct;
   uint32_t patch_10_ct;
@@ -160,6 +170,7 @@ union GparseMetadata {
   GparseReadVcfMetadata read_vcf;
   GparseReadBcfMetadata read_bcf;
   GparseReadBgenMetadata read_bgen;
+  GparseReadTextMetadata read_text;
   GparseWriteMetadata write;
 };
 
@@ -307,6 +318,95 @@ PglErr GparseFlush(const GparseRecord* grp, uint32_t write_block_size, STPgenWri
   return reterr;
 }
 
+// When a spare thread is available, .pgen record compression is moved off the
+// I/O thread: block n-1 is compressed and written by a dedicated flush thread
+// while the worker threads parse block n and the I/O thread loads block n+1.
+// This requires a third set of block buffers.
+//
+// (Record compression itself must remain sequential to keep the output
+// independent of block boundaries and thread count: LD-compression decisions
+// depend on the previous variant, and that dependency is only broken at
+// vblock boundaries, i.e. every 65536 variants.  MTPgenWriter exploits this,
+// but it would require each thread to hold a full vblock of parsed genotype
+// data, which is prohibitive for biobank-scale sample counts.)
+CONSTI32(kGparseMaxBufCt, 3);
+
+typedef struct GparseFlushCtxStruct {
+  STPgenWriter* spgwp;
+  const GparseRecord* gparse;
+  uint32_t write_block_size;
+  uint32_t is_background;
+  uint32_t is_unjoined;
+  PglErr reterr;
+} GparseFlushCtx;
+
+THREAD_FUNC_DECL GparseFlushThread(void* raw_arg) {
+  ThreadGroupFuncArg* arg = S_CAST(ThreadGroupFuncArg*, raw_arg);
+  GparseFlushCtx* ctx = S_CAST(GparseFlushCtx*, arg->sharedp->context);
+  do {
+    const PglErr reterr = GparseFlush(ctx->gparse, ctx->write_block_size, ctx->spgwp);
+    if (unlikely(reterr)) {
+      ctx->reterr = reterr;
+    }
+  } while (!THREAD_BLOCK_FINISH(arg));
+  THREAD_RETURN;
+}
+
+void InitGparseFlush(STPgenWriter* spgwp, GparseFlushCtx* fctxp) {
+  fctxp->spgwp = spgwp;
+  fctxp->gparse = nullptr;
+  fctxp->write_block_size = 0;
+  fctxp->is_background = 0;
+  fctxp->is_unjoined = 0;
+  fctxp->reterr = kPglRetSuccess;
+}
+
+// Returns number of block buffers the caller should allocate (2 for
+// synchronous flushing, kGparseMaxBufCt for background flushing).
+uint32_t GparseFlushSetBackground(uint32_t enable, GparseFlushCtx* fctxp, ThreadGroup* flush_tgp) {
+  if (enable) {
+    if (!SetThreadCt(1, flush_tgp)) {
+      SetThreadFuncAndData(GparseFlushThread, fctxp, flush_tgp);
+      fctxp->is_background = 1;
+      return kGparseMaxBufCt;
+    }
+    // not worth erroring out over
+  }
+  return 2;
+}
+
+PglErr GparseFlushJoin(GparseFlushCtx* fctxp, ThreadGroup* flush_tgp) {
+  if (fctxp->is_unjoined) {
+    JoinThreads(flush_tgp);
+    fctxp->is_unjoined = 0;
+  }
+  return fctxp->reterr;
+}
+
+// In background mode, waits for the previous block to finish writing, then
+// launches the flush thread on this block and returns immediately; grp[]
+// must not be touched until the next GparseFlushStart() or GparseFlushJoin()
+// call.
+PglErr GparseFlushStart(const GparseRecord* grp, uint32_t write_block_size, uint32_t is_last_block, GparseFlushCtx* fctxp, ThreadGroup* flush_tgp) {
+  if (!fctxp->is_background) {
+    return GparseFlush(grp, write_block_size, fctxp->spgwp);
+  }
+  const PglErr reterr = GparseFlushJoin(fctxp, flush_tgp);
+  if (unlikely(reterr)) {
+    return reterr;
+  }
+  fctxp->gparse = grp;
+  fctxp->write_block_size = write_block_size;
+  if (is_last_block) {
+    DeclareLastThreadBlock(flush_tgp);
+  }
+  if (unlikely(SpawnThreads(flush_tgp))) {
+    return kPglRetThreadCreateFail;
+  }
+  fctxp->is_unjoined = 1;
+  return kPglRetSuccess;
+}
+
 
 typedef struct ImportSampleIdContextStruct {
   const char* const_fid;
@@ -1395,6 +1495,51 @@ uintptr_t VcfScanShortallelicLine(const VcfImportBaseContext* vibcp, const char*
   return retval;
 }
 
+#ifdef __LP64__
+CONSTI32(kVcfGtVecSampleCt, kBytesPerVec / 4);
+
+// Fast path for the most common biallelic layout: GT is the only FORMAT
+// field, and the next kVcfGtVecSampleCt calls are all of the form [01][/|][01]
+// followed by a tab.  Returns 0 (and doesn't write anything) if the next
+// kBytesPerVec bytes don't fit this pattern, in which case the caller falls
+// back on the general parser.  Otherwise, *geno_bits_ptr is set to the
+// 2-bit-per-sample hardcalls, and *phased_hets_ptr/*phased_alt1_first_ptr to
+// 1-bit-per-sample masks of '|'-separated hets and of 1|0 calls.
+// Caller is responsible for ensuring kBytesPerVec bytes are readable.
+BoolErr VcfParseBiallelicGtVec(const char* gtext_iter, uint32_t* geno_bits_ptr, uint32_t* phased_hets_ptr, uint32_t* phased_alt1_first_ptr) {
+  // After xoring with "0/0\t", allele bytes must be 0 or 1, separator bytes
+  // must be 0 or ('/' ^ '|'), and the tab bytes must be 0.
+  const VecUc xored = vecuc_loadu(gtext_iter) ^ R_CAST(VecUc, vecw_set1(0x09302f3009302f30LLU));
+  const VecUc invalid_bits = R_CAST(VecUc, vecw_set1(0xfffe00fefffe00feLLU));
+  const VecUc sep_mask = R_CAST(VecUc, vecw_set1(0x0000ff000000ff00LLU));
+  const VecUc phased_sep = R_CAST(VecUc, vecw_set1(0x0000530000005300LLU));
+  const VecUc vzero = vecuc_setzero();
+  const VecUc seps = xored & sep_mask;
+  const VecUc phased_seps = (seps == phased_sep);
+  const VecUc valid = ((xored & invalid_bits) == vzero) & ((seps == vzero) | phased_seps);
+  if (vecuc_movemask(valid) != kVec8thUintMax) {
+    return 1;
+  }
+  // bit 4i = first allele of sample i, bit (4i + 2) = second allele
+  const uint32_t allele_bits = vecuc_movemask(R_CAST(VecUc, vecw_slli(R_CAST(VecW, xored & R_CAST(VecUc, vecw_set1(kMask0001))), 7)));
+  const uint32_t first_alleles = allele_bits & 0x11111111;
+  const uint32_t second_alleles = (allele_bits >> 2) & 0x11111111;
+  uint32_t geno_bits = first_alleles + second_alleles;
+  geno_bits = (geno_bits | (geno_bits >> 2)) & 0x0f0f0f0f;
+  geno_bits = (geno_bits | (geno_bits >> 4)) & 0x00ff00ff;
+  *geno_bits_ptr = (geno_bits | (geno_bits >> 8)) & 0xffff;
+  uint32_t phased_hets = (vecuc_movemask(phased_seps) >> 1) & (first_alleles ^ second_alleles);
+  uint32_t phased_alt1_first = phased_hets & first_alleles;
+  phased_hets = (phased_hets | (phased_hets >> 3)) & 0x03030303;
+  phased_hets = (phased_hets | (phased_hets >> 6)) & 0x000f000f;
+  *phased_hets_ptr = (phased_hets | (phased_hets >> 12)) & 0xff;
+  phased_alt1_first = (phased_alt1_first | (phased_alt1_first >> 3)) & 0x03030303;
+  phased_alt1_first = (phased_alt1_first | (phased_alt1_first >> 6)) & 0x000f000f;
+  *phased_alt1_first_ptr = (phased_alt1_first | (phased_alt1_first >> 12)) & 0xff;
+  return 0;
+}
+#endif
+
 VcfParseErr VcfConvertUnphasedBiallelicLine(const VcfImportBaseContext* vibcp, const char* linebuf_iter, uintptr_t* genovec) {
   const uint32_t sample_ct = vibcp->sample_ct;
   const uint32_t sample_ctl2_m1 = (sample_ct - 1) / kBitsPerWordD2;
@@ -1403,6 +1548,11 @@ VcfParseErr VcfConvertUnphasedBiallelicLine(const VcfImportBaseContext* vibcp, c
   STD_ARRAY_KREF(int32_t, 2) qual_line_mins = vibcp->qual_line_mins;
   STD_ARRAY_KREF(int32_t, 2) qual_line_maxs = vibcp->qual_line_maxs;
   const uint32_t qual_field_ct = vibcp->qual_field_ct;
+#ifdef __LP64__
+  // Each sample field is at least one byte long (including the delimiter), so
+  // this guarantees the vector load doesn't run past the end of the line.
+  const uint32_t vec_sample_idx_end = (qual_field_ct || (sample_ct <= kBytesPerVec))? 0 : (sample_ct - kBytesPerVec);
+#endif
 
   uint32_t inner_loop_last = kBitsPerWordD2 - 1;
   for (uint32_t widx = 0; ; ++widx) {
@@ -1414,6 +1564,19 @@ VcfParseErr VcfConvertUnphasedBiallelicLine(const VcfImportBaseContext* vibcp, c
     }
     uintptr_t genovec_word = 0;
     for (uint32_t sample_idx_lowbits = 0; sample_idx_lowbits <= inner_loop_last; ++sample_idx_lowbits) {
+#ifdef __LP64__
+      if ((!(sample_idx_lowbits % kVcfGtVecSampleCt)) && (widx * kBitsPerWordD2 + sample_idx_lowbits < vec_sample_idx_end)) {
+        uint32_t geno_bits;
+        uint32_t phased_hets;
+        uint32_t phased_alt1_first;
+        if (!VcfParseBiallelicGtVec(linebuf_iter, &geno_bits, &phased_hets, &phased_alt1_first)) {
+          genovec_word |= S_CAST(uintptr_t, geno_bits) << (2 * sample_idx_lowbits);
+          linebuf_iter = &(linebuf_iter[kBytesPerVec]);
+          sample_idx_lowbits += kVcfGtVecSampleCt - 1;
+          continue;
+        }
+      }
+#endif
       const char* cur_gtext_end = FirstPrespace(linebuf_iter);
       if (unlikely((*cur_gtext_end != '\t') && ((sample_idx_lowbits != inner_loop_last) || (widx != sample_ctl2_m1)))) {
         return kVcfParseMissingTokens;
@@ -1864,6 +2027,9 @@ VcfParseErr VcfConvertPhasedBiallelicLine(const VcfImportBaseContext* vibcp, con
   const uint32_t qual_field_ct = vibcp->qual_field_ct;
   Halfword* phasepresent_alias = R_CAST(Halfword*, phasepresent);
   Halfword* phaseinfo_alias = R_CAST(Halfword*, phaseinfo);
+#ifdef __LP64__
+  const uint32_t vec_sample_idx_end = (qual_field_ct || (sample_ct <= kBytesPerVec))? 0 : (sample_ct - kBytesPerVec);
+#endif
 
   uint32_t inner_loop_last = kBitsPerWordD2 - 1;
   for (uint32_t widx = 0; ; ++widx) {
@@ -1881,6 +2047,21 @@ VcfParseErr VcfConvertPhasedBiallelicLine(const VcfImportBaseContext* vibcp, con
     uint32_t phasepresent_hw = 0;
     uint32_t phaseinfo_hw = 0;
     for (uint32_t sample_idx_lowbits = 0; sample_idx_lowbits <= inner_loop_last; ++sample_idx_lowbits) {
+#ifdef __LP64__
+      if ((!(sample_idx_lowbits % kVcfGtVecSampleCt)) && (widx * kBitsPerWordD2 + sample_idx_lowbits < vec_sample_idx_end)) {
+        uint32_t geno_bits;
+        uint32_t phased_hets;
+        uint32_t phased_alt1_first;
+        if (!VcfParseBiallelicGtVec(linebuf_iter, &geno_bits, &phased_hets, &phased_alt1_first)) {
+          genovec_word |= S_CAST(uintptr_t, geno_bits) << (2 * sample_idx_lowbits);
+          phasepresent_hw |= phased_hets << sample_idx_lowbits;
+          phaseinfo_hw |= phased_alt1_first << sample_idx_lowbits;
+          linebuf_iter = &(linebuf_iter[kBytesPerVec]);
+          sample_idx_lowbits += kVcfGtVecSampleCt - 1;
+          continue;
+        }
+      }
+#endif
       const char* cur_gtext_end = FirstPrespace(linebuf_iter);
       if (unlikely((*cur_gtext_end != '\t') && ((sample_idx_lowbits != inner_loop_last) || (widx != sample_ctl2_m1)))) {
         return kVcfParseMissingTokens;
@@ -2477,9 +2658,11 @@ typedef struct VcfGenoToPgenCtxStruct {
 
   unsigned char** thread_wkspaces;
 
-  uint32_t* thread_bidxs[2];
-  GparseRecord* gparse[2];
-  const uintptr_t* block_allele_idx_offsets[2];
+  // gparse_buf_ct (2 or kGparseMaxBufCt) sets of these are cycled through
+  uint32_t* thread_bidxs[kGparseMaxBufCt];
+  GparseRecord* gparse[kGparseMaxBufCt];
+  const uintptr_t* block_allele_idx_offsets[kGparseMaxBufCt];
+  uint32_t gparse_buf_ct;
 
   // PglErr set by main thread
   VcfParseErr* vcf_parse_errs;
@@ -2530,15 +2713,15 @@ THREAD_FUNC_DECL VcfGenoToPgenThread(void* raw_arg) {
   uintptr_t* write_dphase_present = nullptr;
   SDosage* write_dphase_delta = nullptr;
   uint32_t cur_allele_ct = 2;
-  uint32_t parity = 0;
+  uint32_t buf_idx = 0;
   VcfParseErr vcf_parse_err = kVcfParseOk;
   uintptr_t line_idx = 0;
   do {
-    const uintptr_t* block_allele_idx_offsets = ctx->block_allele_idx_offsets[parity];
-    const uint32_t bidx_end = ctx->thread_bidxs[parity][tidx + 1];
-    GparseRecord* cur_gparse = ctx->gparse[parity];
+    const uintptr_t* block_allele_idx_offsets = ctx->block_allele_idx_offsets[buf_idx];
+    const uint32_t bidx_end = ctx->thread_bidxs[buf_idx][tidx + 1];
+    GparseRecord* cur_gparse = ctx->gparse[buf_idx];
 
-    for (uint32_t bidx = ctx->thread_bidxs[parity][tidx]; bidx != bidx_end; ++bidx) {
+    for (uint32_t bidx = ctx->thread_bidxs[buf_idx][tidx]; bidx != bidx_end; ++bidx) {
       GparseRecord* grp = &(cur_gparse[bidx]);
       uint32_t patch_01_ct = 0;
       uint32_t patch_10_ct = 0;
@@ -2638,11 +2821,504 @@ THREAD_FUNC_DECL VcfGenoToPgenThread(void* raw_arg) {
       ctx->parse_failed = 1;
       break;
     }
-    parity = 1 - parity;
+    if (++buf_idx == ctx->gparse_buf_ct) {
+      buf_idx = 0;
+    }
+  } while (!THREAD_BLOCK_FINISH(arg));
+  THREAD_RETURN;
+}
+
+// Parallel version of VcfToPgen()'s first pass, used when the input is a
+// large BGZF-compressed file and multiple threads are available.  The file is
+// split at BGZF block boundaries, and each thread decompresses and scans one
+// piece.  A thread is responsible for every line starting in its piece (plus
+// the line starting exactly at the end of its piece, if any), so a line
+// crossing a piece boundary is handled by the thread it starts in.
+// The threads only do line-local work.  Chromosome codes, and therefore the
+// chromosome filter, are resolved afterward by the main thread in file order,
+// from per-thread lists of same-chromosome runs.
+// If anything unusual happens (malformed line, line too long for the thread's
+// buffer, workspace exhausted, etc.), the thread just reports failure, and
+// VcfToPgen() falls back on the serial scan; that prints the appropriate
+// error message if the problem is real.
+CONSTI32(kVcfScanMinChunkSize, 1 << 22);
+
+typedef struct VcfScanRunStruct {
+  const char* chr_name;
+  uint32_t chr_name_slen;
+  uint32_t variant_ct;
+  uint32_t max_allele_slen;
+  uint32_t max_qualfilterinfo_slen;
+  uint32_t max_postformat_blen;
+  uint32_t phase_or_dosage_found;
+} VcfScanRun;
+
+typedef struct VcfScanChunkStruct {
+  // workspace
+  char* linebuf;
+  uintptr_t linebuf_size;
+  // low 15 bits = ALT allele count, top bit set iff INFO:PR is present
+  uint16_t* alt_cts;
+  uint32_t alt_ct_limit;
+  uint32_t run_limit;
+  VcfScanRun* runs;
+  char* chr_name_arena;
+  uintptr_t chr_name_arena_size;
+
+  // results
+  uintptr_t require_gt_skip_ct;
+  uint32_t variant_ct;
+  uint32_t run_ct;
+  uint32_t max_line_blen;
+  uint32_t max_alt_ct;
+  uint32_t failed;
+} VcfScanChunk;
+
+typedef struct VcfScanCtxStruct {
+  const char* vcfname;
+  const uint64_t* chunk_fposs;
+  uint64_t file_size;
+  uint64_t header_blen;
+  VcfImportContext vic;
+  const char* dosage_import_field;
+  uint32_t dosage_import_field_slen;
+  uint32_t format_dosage_relevant;
+  uint32_t format_hds_search;
+  uint32_t format_gq_or_dp_relevant;
+  int32_t vcf_min_gq;
+  int32_t vcf_min_dp;
+  int32_t vcf_max_dp;
+  STD_ARRAY_DECL(int32_t, 2, qual_mins);
+  STD_ARRAY_DECL(int32_t, 2, qual_maxs);
+  uint32_t require_gt;
+  uint32_t info_pr_present;
+
+  VcfScanChunk* chunks;
+} VcfScanCtx;
+
+// line_end must point to the line's terminating '\n'.
+BoolErr VcfScanChunkLine(const VcfScanCtx* ctx, char* line_start, char* line_end, VcfImportContext* vicp, VcfScanChunk* chunkp) {
+  if ((ctou32(*line_start) <= 32) || (*line_start == '#')) {
+    return 1;
+  }
+  char* chr_code_end = NextPrespace(line_start);
+  if (*chr_code_end != '\t') {
+    return 1;
+  }
+  char* pos_end = NextPrespace(chr_code_end);
+  if (*pos_end != '\t') {
+    return 1;
+  }
+  char* id_end = NextPrespace(pos_end);
+  if ((*id_end != '\t') || (S_CAST(uintptr_t, id_end - pos_end) > kMaxIdBlen)) {
+    return 1;
+  }
+  char* ref_allele_start = &(id_end[1]);
+  char* linebuf_iter = FirstPrespace(ref_allele_start);
+  if (*linebuf_iter != '\t') {
+    return 1;
+  }
+  uint32_t cur_max_allele_slen = linebuf_iter - ref_allele_start;
+  uint32_t alt_ct = 1;
+  unsigned char ucc;
+  for (; ; ++alt_ct) {
+    char* cur_allele_start = ++linebuf_iter;
+    ucc = *linebuf_iter;
+    if ((ucc <= ',') && (ucc != '*')) {
+      return 1;
+    }
+    do {
+      ucc = *(++linebuf_iter);
+    } while ((ucc > ',') || (ucc == '*'));
+    const uint32_t cur_allele_slen = linebuf_iter - cur_allele_start;
+    if (cur_allele_slen > cur_max_allele_slen) {
+      cur_max_allele_slen = cur_allele_slen;
+    }
+    if (ucc != ',') {
+      break;
+    }
+  }
+  if ((ucc != '\t') || (alt_ct > 0x7fff)) {
+    return 1;
+  }
+  if (alt_ct > chunkp->max_alt_ct) {
+    chunkp->max_alt_ct = alt_ct;
+  }
+  char* qual_start_m1 = linebuf_iter;
+  for (uint32_t uii = 0; uii != 2; ++uii) {
+    linebuf_iter = NextPrespace(linebuf_iter);
+    if (*linebuf_iter != '\t') {
+      return 1;
+    }
+  }
+  char* info_start = &(linebuf_iter[1]);
+  char* info_end = FirstPrespace(info_start);
+  const uint32_t sample_ct = vicp->vibc.sample_ct;
+  if (sample_ct) {
+    if (*info_end != '\t') {
+      return 1;
+    }
+    linebuf_iter = &(info_end[1]);
+    vicp->vibc.gt_present = memequal_k(linebuf_iter, "GT", 2) && ((linebuf_iter[2] == ':') || (linebuf_iter[2] == '\t'));
+    if (ctx->require_gt && (!vicp->vibc.gt_present)) {
+      chunkp->require_gt_skip_ct += 1;
+      return 0;
+    }
+  }
+  const uint32_t cur_qualfilterinfo_slen = info_end - qual_start_m1;
+
+  const uint32_t chr_name_slen = chr_code_end - line_start;
+  VcfScanRun* cur_run = nullptr;
+  if (chunkp->run_ct) {
+    cur_run = &(chunkp->runs[chunkp->run_ct - 1]);
+    if ((cur_run->chr_name_slen != chr_name_slen) || (!memequal(cur_run->chr_name, line_start, chr_name_slen))) {
+      cur_run = nullptr;
+    }
+  }
+  if (!cur_run) {
+    if ((chunkp->run_ct == chunkp->run_limit) || (chr_name_slen >= chunkp->chr_name_arena_size)) {
+      return 1;
+    }
+    cur_run = &(chunkp->runs[chunkp->run_ct]);
+    chunkp->run_ct += 1;
+    cur_run->chr_name = chunkp->chr_name_arena;
+    cur_run->chr_name_slen = chr_name_slen;
+    char* chr_name_end = memcpya(chunkp->chr_name_arena, line_start, chr_name_slen);
+    *chr_name_end++ = '\0';
+    chunkp->chr_name_arena = chr_name_end;
+    chunkp->chr_name_arena_size -= chr_name_slen + 1;
+    cur_run->variant_ct = 0;
+    cur_run->max_allele_slen = 1;
+    cur_run->max_qualfilterinfo_slen = 6;
+    cur_run->max_postformat_blen = 1;
+    cur_run->phase_or_dosage_found = 0;
+  }
+  const uint32_t variant_ct = chunkp->variant_ct;
+  if (variant_ct == chunkp->alt_ct_limit) {
+    return 1;
+  }
+  uint32_t alt_ct_entry = alt_ct;
+  if (ctx->info_pr_present && PrInInfoToken(info_end - info_start, info_start)) {
+    alt_ct_entry |= 0x8000;
+  }
+  chunkp->alt_cts[variant_ct] = alt_ct_entry;
+  chunkp->variant_ct = variant_ct + 1;
+  cur_run->variant_ct += 1;
+  if (cur_max_allele_slen > cur_run->max_allele_slen) {
+    cur_run->max_allele_slen = cur_max_allele_slen;
+  }
+  if (cur_qualfilterinfo_slen > cur_run->max_qualfilterinfo_slen) {
+    cur_run->max_qualfilterinfo_slen = cur_qualfilterinfo_slen;
+  }
+  if (sample_ct) {
+    const char* format_end = FirstPrespace(linebuf_iter);
+    if (*format_end != '\t') {
+      return 1;
+    }
+    // Since the chromosome filter hasn't been applied yet, phase/dosage
+    // presence must be tracked separately for each run.
+    if (!cur_run->phase_or_dosage_found) {
+      if (ctx->format_dosage_relevant) {
+        vicp->dosage_field_idx = GetVcfFormatPosition(ctx->dosage_import_field, linebuf_iter, format_end, ctx->dosage_import_field_slen);
+      }
+      if (ctx->format_hds_search) {
+        vicp->hds_field_idx = GetVcfFormatPosition("HDS", linebuf_iter, format_end, 3);
+      }
+      if (ctx->format_gq_or_dp_relevant) {
+        STD_ARRAY_DECL(uint32_t, 2, qual_field_idxs);
+        uint32_t qual_field_ct = VcfQualScanInit1(linebuf_iter, format_end, ctx->vcf_min_gq, ctx->vcf_min_dp, ctx->vcf_max_dp, qual_field_idxs);
+        vicp->vibc.qual_field_ct = 0;
+        if (qual_field_ct) {
+          vicp->vibc.qual_field_ct = VcfQualScanInit2(qual_field_idxs, ctx->qual_mins, ctx->qual_maxs, vicp->vibc.qual_field_skips, vicp->vibc.qual_line_mins, vicp->vibc.qual_line_maxs);
+        }
+      }
+      char* scan_iter = line_start;
+      if ((vicp->hds_field_idx != UINT32_MAX) || (vicp->dosage_field_idx != UINT32_MAX)) {
+        if ((alt_ct != 1) || VcfScanBiallelicHdsLine(vicp, format_end, &(cur_run->phase_or_dosage_found), &scan_iter)) {
+          return 1;
+        }
+      } else if (vicp->vibc.gt_present) {
+        if (alt_ct < 10) {
+          cur_run->phase_or_dosage_found = VcfScanShortallelicLine(&(vicp->vibc), format_end, &scan_iter);
+        } else {
+          cur_run->phase_or_dosage_found = VcfScanLongallelicLine(&(vicp->vibc), format_end, &scan_iter);
+        }
+      }
+    }
+    const uint32_t cur_postformat_slen = line_end - format_end;
+    if (cur_postformat_slen >= cur_run->max_postformat_blen) {
+      cur_run->max_postformat_blen = cur_postformat_slen + 1;
+    }
+  }
+  return 0;
+}
+
+// Appends the next BGZF block to [*line_startp, *data_endp), first moving the
+// unprocessed bytes to the front of linebuf if necessary.  *own_endp is set
+// when the first block past the thread's piece is about to be loaded.
+PglErr VcfScanChunkLoad(uint64_t own_fpos_end, VcfScanChunk* chunkp, BgzfBlockReader* bbrp, char** line_startp, char** data_endp, char** own_endp) {
+  char* data_end = *data_endp;
+  if ((!(*own_endp)) && (bbrp->fpos >= own_fpos_end)) {
+    *own_endp = data_end;
+  }
+  char* linebuf = chunkp->linebuf;
+  const uintptr_t linebuf_size = chunkp->linebuf_size;
+  // reserve one extra byte for a final '\n'
+  if (S_CAST(uintptr_t, &(linebuf[linebuf_size]) - data_end) <= kMaxBgzfDecompressedBlockSize) {
+    char* line_start = *line_startp;
+    const uintptr_t shift = line_start - linebuf;
+    if (linebuf_size - S_CAST(uintptr_t, data_end - line_start) <= kMaxBgzfDecompressedBlockSize) {
+      return kPglRetNomem;
+    }
+    memmove(linebuf, line_start, data_end - line_start);
+    data_end -= shift;
+    *line_startp = linebuf;
+    if (*own_endp) {
+      *own_endp -= shift;
+    }
+  }
+  uint32_t out_size;
+  PglErr reterr = BgzfBlockReaderNext(bbrp, R_CAST(unsigned char*, data_end), &out_size);
+  if (reterr) {
+    if ((reterr == kPglRetEof) && (!(*own_endp))) {
+      *own_endp = data_end;
+    }
+    *data_endp = data_end;
+    return reterr;
+  }
+  *data_endp = &(data_end[out_size]);
+  return kPglRetSuccess;
+}
+
+BoolErr VcfScanChunkMain(const VcfScanCtx* ctx, uint32_t tidx, VcfImportContext* vicp, BgzfBlockReader* bbrp, VcfScanChunk* chunkp) {
+  const uint64_t own_fpos_end = ctx->chunk_fposs[tidx + 1];
+  if (BgzfBlockReaderOpen(ctx->vcfname, ctx->chunk_fposs[tidx], ctx->file_size, bbrp)) {
+    return 1;
+  }
+  char* line_start = chunkp->linebuf;
+  char* data_end = line_start;
+  char* own_end = nullptr;
+  PglErr reterr;
+  if (!tidx) {
+    // skip the header
+    uint64_t bytes_left = ctx->header_blen;
+    while (bytes_left) {
+      if (line_start == data_end) {
+        if (VcfScanChunkLoad(own_fpos_end, chunkp, bbrp, &line_start, &data_end, &own_end)) {
+          return 1;
+        }
+        continue;
+      }
+      uintptr_t cur_skip = data_end - line_start;
+      if (cur_skip > bytes_left) {
+        cur_skip = bytes_left;
+      }
+      line_start = &(line_start[cur_skip]);
+      bytes_left -= cur_skip;
+    }
+    if (line_start[-1] != '\n') {
+      return 1;
+    }
+  } else {
+    // skip the partial line (or, at the very beginning, the entire line)
+    // belonging to the previous thread
+    while (1) {
+      if (line_start == data_end) {
+        reterr = VcfScanChunkLoad(own_fpos_end, chunkp, bbrp, &line_start, &data_end, &own_end);
+        if (reterr) {
+          return (reterr != kPglRetEof);
+        }
+        continue;
+      }
+      char* first_lf = S_CAST(char*, memchr(line_start, '\n', data_end - line_start));
+      if (first_lf) {
+        line_start = &(first_lf[1]);
+        break;
+      }
+      line_start = data_end;
+    }
+  }
+  uint32_t max_line_blen = 0;
+  while (1) {
+    if (line_start == data_end) {
+      reterr = VcfScanChunkLoad(own_fpos_end, chunkp, bbrp, &line_start, &data_end, &own_end);
+      if (reterr) {
+        if (reterr == kPglRetEof) {
+          break;
+        }
+        return 1;
+      }
+      continue;
+    }
+    if (own_end && (line_start > own_end)) {
+      break;
+    }
+    uintptr_t searched_blen = 0;
+    char* line_end;
+    while (1) {
+      line_end = S_CAST(char*, memchr(&(line_start[searched_blen]), '\n', data_end - line_start - searched_blen));
+      if (line_end) {
+        break;
+      }
+      searched_blen = data_end - line_start;
+      reterr = VcfScanChunkLoad(own_fpos_end, chunkp, bbrp, &line_start, &data_end, &own_end);
+      if (reterr) {
+        if (reterr != kPglRetEof) {
+          return 1;
+        }
+        // last line not terminated
+        line_end = data_end;
+        *data_end++ = '\n';
+        break;
+      }
+    }
+    const uint32_t line_blen = &(line_end[1]) - line_start;
+    if (line_blen > max_line_blen) {
+      max_line_blen = line_blen;
+    }
+    if (VcfScanChunkLine(ctx, line_start, line_end, vicp, chunkp)) {
+      return 1;
+    }
+    line_start = &(line_end[1]);
+  }
+  chunkp->max_line_blen = max_line_blen;
+  return 0;
+}
+
+THREAD_FUNC_DECL VcfScanThread(void* raw_arg) {
+  ThreadGroupFuncArg* arg = S_CAST(ThreadGroupFuncArg*, raw_arg);
+  const uint32_t tidx = arg->tidx;
+  VcfScanCtx* ctx = S_CAST(VcfScanCtx*, arg->sharedp->context);
+  VcfScanChunk* chunkp = &(ctx->chunks[tidx]);
+  do {
+    VcfImportContext vic = ctx->vic;
+    BgzfBlockReader bbr;
+    PreinitBgzfBlockReader(&bbr);
+    if (!VcfScanChunkMain(ctx, tidx, &vic, &bbr, chunkp)) {
+      chunkp->failed = 0;
+    }
+    CleanupBgzfBlockReader(&bbr);
   } while (!THREAD_BLOCK_FINISH(arg));
   THREAD_RETURN;
 }
 
+// Sets *chunk_ct_ptr to zero if the parallel scan isn't applicable.
+// Otherwise, workspace is allocated from the end of bigstack, and on return,
+// ctx->chunks[] contains the per-thread results (check the failed fields).
+PglErr VcfScanBgzfChunks(uint32_t max_thread_ct, VcfScanCtx* ctx, uint32_t* chunk_ct_ptr) {
+  *chunk_ct_ptr = 0;
+  if (max_thread_ct < 2) {
+    return kPglRetSuccess;
+  }
+  PglErr reterr = kPglRetSuccess;
+  FILE* ff = fopen(ctx->vcfname, FOPEN_RB);
+  ThreadGroup tg;
+  PreinitThreads(&tg);
+  {
+    if (!ff) {
+      goto VcfScanBgzfChunks_ret_1;
+    }
+    unsigned char header[16];
+    if ((!fread_unlocked(header, 16, 1, ff)) || (!IsBgzfHeader(header))) {
+      goto VcfScanBgzfChunks_ret_1;
+    }
+    if (unlikely(fseeko(ff, 0, SEEK_END))) {
+      goto VcfScanBgzfChunks_ret_READ_FAIL;
+    }
+    const uint64_t file_size = ftello(ff);
+    uint32_t chunk_ct = MINV(max_thread_ct, file_size / kVcfScanMinChunkSize);
+    if (chunk_ct < 2) {
+      goto VcfScanBgzfChunks_ret_1;
+    }
+    uint64_t* chunk_fposs;
+    if (bigstack_end_alloc_u64(chunk_ct + 1, &chunk_fposs)) {
+      goto VcfScanBgzfChunks_ret_1;
+    }
+    chunk_fposs[0] = 0;
+    uint32_t chunk_idx = 1;
+    for (uint32_t uii = 1; uii != chunk_ct; ++uii) {
+      uint64_t cur_fpos;
+      if (BgzfFindBlockStart(ff, (file_size * uii) / chunk_ct, file_size, &cur_fpos)) {
+        // let the serial scan deal with it
+        goto VcfScanBgzfChunks_ret_1;
+      }
+      if ((cur_fpos > chunk_fposs[chunk_idx - 1]) && (cur_fpos < file_size)) {
+        chunk_fposs[chunk_idx++] = cur_fpos;
+      }
+    }
+    chunk_ct = chunk_idx;
+    if (chunk_ct < 2) {
+      goto VcfScanBgzfChunks_ret_1;
+    }
+    chunk_fposs[chunk_ct] = file_size;
+    fclose(ff);
+    ff = nullptr;
+    ctx->chunk_fposs = chunk_fposs;
+    ctx->file_size = file_size;
+
+    if (bigstack_end_alloc_uc(chunk_ct * sizeof(VcfScanChunk), R_CAST(unsigned char**, &ctx->chunks))) {
+      goto VcfScanBgzfChunks_ret_1;
+    }
+    // leave plenty of room for allele_idx_offsets, etc.
+    const uintptr_t chunk_wkspace_size = RoundDownPow2(bigstack_left() / (4 * chunk_ct), kCacheline);
+    const uintptr_t linebuf_size = RoundDownPow2(chunk_wkspace_size / 4, kCacheline);
+    if (linebuf_size < 4 * kMaxBgzfDecompressedBlockSize) {
+      goto VcfScanBgzfChunks_ret_1;
+    }
+    const uintptr_t run_limit = chunk_wkspace_size / (32 * sizeof(VcfScanRun));
+    const uintptr_t chr_name_arena_size = RoundDownPow2(chunk_wkspace_size / 32, kCacheline);
+    const uintptr_t alt_cts_size = chunk_wkspace_size - linebuf_size - RoundUpPow2(run_limit * sizeof(VcfScanRun), kCacheline) - chr_name_arena_size;
+    for (uint32_t tidx = 0; tidx != chunk_ct; ++tidx) {
+      VcfScanChunk* chunkp = &(ctx->chunks[tidx]);
+      unsigned char* wkspace = S_CAST(unsigned char*, bigstack_end_alloc_raw(chunk_wkspace_size));
+      chunkp->linebuf = R_CAST(char*, wkspace);
+      chunkp->linebuf_size = linebuf_size;
+      wkspace = &(wkspace[linebuf_size]);
+      chunkp->runs = R_CAST(VcfScanRun*, wkspace);
+      chunkp->run_limit = MINV(run_limit, 0x7fffffff);
+      wkspace = &(wkspace[RoundUpPow2(run_limit * sizeof(VcfScanRun), kCacheline)]);
+      chunkp->chr_name_arena = R_CAST(char*, wkspace);
+      chunkp->chr_name_arena_size = chr_name_arena_size;
+      wkspace = &(wkspace[chr_name_arena_size]);
+      chunkp->alt_cts = R_CAST(uint16_t*, wkspace);
+      chunkp->alt_ct_limit = MINV(alt_cts_size / sizeof(int16_t), 0x7ffffffd);
+      chunkp->require_gt_skip_ct = 0;
+      chunkp->variant_ct = 0;
+      chunkp->run_ct = 0;
+      chunkp->max_line_blen = 0;
+      chunkp->max_alt_ct = 1;
+      chunkp->failed = 1;
+    }
+    if (unlikely(SetThreadCt(chunk_ct, &tg))) {
+      goto VcfScanBgzfChunks_ret_NOMEM;
+    }
+    SetThreadFuncAndData(VcfScanThread, ctx, &tg);
+    DeclareLastThreadBlock(&tg);
+    if (unlikely(SpawnThreads(&tg))) {
+      goto VcfScanBgzfChunks_ret_THREAD_CREATE_FAIL;
+    }
+    JoinThreads(&tg);
+    *chunk_ct_ptr = chunk_ct;
+  }
+  while (0) {
+  VcfScanBgzfChunks_ret_NOMEM:
+    reterr = kPglRetNomem;
+    break;
+  VcfScanBgzfChunks_ret_READ_FAIL:
+    reterr = kPglRetReadFail;
+    break;
+  VcfScanBgzfChunks_ret_THREAD_CREATE_FAIL:
+    reterr = kPglRetThreadCreateFail;
+    break;
+  }
+ VcfScanBgzfChunks_ret_1:
+  CleanupThreads(&tg);
+  if (ff) {
+    fclose(ff);
+  }
+  return reterr;
+}
+
 static const char kGpText[] = "GP";
 
 static_assert(!kVcfHalfCallReference, "VcfToPgen() assumes kVcfHalfCallReference == 0.");
@@ -2652,16 +3328,24 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
   // it's necessary to use the Pgen_writer classes for now (since we need to
   // know upfront how many variants there are, and whether phase/dosage is
   // present).
+  // When the input is a named pipe, or --vcf-spool was specified, the first
+  // pass also writes the decompressed text to a temporary .zst spool file, and
+  // the second pass reads that instead.  This lets us accept non-seekable
+  // input, and the (cheaper) zstd decompression replaces a second bgzf pass.
   // preexisting_psamname should be nullptr if no such file was specified.
   unsigned char* bigstack_mark = g_bigstack_base;
   unsigned char* bigstack_end_mark = g_bigstack_end;
   char* pvar_cswritep = nullptr;
+  char* spoolname = nullptr;
+  char* spool_cswritep = nullptr;
   uintptr_t line_idx = 1;
   const uint32_t half_call_explicit_error = (halfcall_mode == kVcfHalfCallError);
   PglErr reterr = kPglRetSuccess;
   VcfParseErr vcf_parse_err = kVcfParseOk;
   CompressStreamState pvar_css;
   PreinitCstream(&pvar_css);
+  CompressStreamState spool_css;
+  PreinitCstream(&spool_css);
   ThreadGroup tg;
   PreinitThreads(&tg);
   VcfGenoToPgenCtx ctx;
@@ -2669,6 +3353,10 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
   STPgenWriter spgw;
   PreinitTextStream(&vcf_txs);
   PreinitSpgw(&spgw);
+  ThreadGroup flush_tg;
+  PreinitThreads(&flush_tg);
+  GparseFlushCtx flush_ctx;
+  InitGparseFlush(&spgw, &flush_ctx);
   {
     uint32_t max_line_blen;
     if (StandardizeMaxLineBlen(bigstack_left() / 4, &max_line_blen)) {
@@ -2679,9 +3367,10 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
     // reader can be very simple since *only* chromosome filters are supported
     // by import functions.)  Do the same for .bgen and .bcf files.
 
+    uint32_t spool_needed = (import_flags / kfImportVcfSpool) & 1;
     reterr = ForceNonFifo(vcfname);
-    if (unlikely(reterr)) {
-      if (reterr == kPglRetOpenFail) {
+    if (reterr) {
+      if (unlikely(reterr == kPglRetOpenFail)) {
         const uint32_t slen = strlen(vcfname);
         if ((!StrEndsWith(vcfname, ".vcf", slen)) &&
             (!StrEndsWith(vcfname, ".vcf.gz", slen))) {
@@ -2689,10 +3378,27 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
         } else {
           logerrprintfww(kErrprintfFopen, vcfname, strerror(errno));
         }
-      } else {
-        logerrprintfww(kErrprintfRewind, vcfname);
+        goto VcfToPgen_ret_1;
+      }
+      // named pipe
+      spool_needed = 1;
+      reterr = kPglRetSuccess;
+    }
+    if (spool_needed) {
+      const uint32_t outname_slen = outname_end - outname;
+      if (unlikely(bigstack_alloc_c(outname_slen + strlen(".spool.vcf.zst") + 1, &spoolname))) {
+        goto VcfToPgen_ret_NOMEM;
+      }
+      char* spoolname_end = memcpya(spoolname, outname, outname_slen);
+      strcpy_k(spoolname_end, ".spool.vcf.zst");
+      // this is only read back once, so favor speed over ratio
+      const uint32_t zst_level = g_zst_level;
+      g_zst_level = 1;
+      reterr = InitCstreamAlloc(spoolname, 0, 1, ClipU32(max_thread_ct - 1, 1, 4), 2 * kCompressStreamBlock, &spool_css, &spool_cswritep);
+      g_zst_level = zst_level;
+      if (unlikely(reterr)) {
+        goto VcfToPgen_ret_1;
       }
-      goto VcfToPgen_ret_1;
     }
     reterr = InitTextStreamEx(vcfname, 1, kMaxLongLine, max_line_blen, ClipU32(max_thread_ct - 1, 1, 4), &vcf_txs);
     if (unlikely(reterr)) {
@@ -2756,6 +3462,7 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
     uint32_t info_pr_nonflag_present = 0;
     uint32_t info_nonpr_present = 0;
     uint32_t chrset_present = 0;
+    uint64_t header_blen = 0;
     char* line_iter = TextLineEnd(&vcf_txs);
     char* prev_line_start;
     for (; ; ++line_idx) {
@@ -2769,6 +3476,13 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
         goto VcfToPgen_ret_TSTREAM_FAIL;
       }
       prev_line_start = line_iter;
+      if (spoolname) {
+        // must happen before the line is parsed, since parsing may modify it
+        const char* line_end = AdvPastDelim(line_iter, '\n');
+        if (unlikely(CsputsStd(line_iter, line_end - line_iter, &spool_css, &spool_cswritep) || Cswrite(&spool_css, &spool_cswritep))) {
+          goto VcfToPgen_ret_WRITE_FAIL;
+        }
+      }
       if (unlikely(*line_iter != '#')) {
         if ((line_idx == 1) && (memequal_k(line_iter, "BCF", 3))) {
           // this is more informative than "missing header line"...
@@ -2882,6 +3596,7 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
       if (prev_line_blen > max_line_blen) {
         max_line_blen = prev_line_blen;
       }
+      header_blen += prev_line_blen;
     }
     const uint32_t require_gt = (import_flags / kfImportVcfRequireGt) & 1;
     if (unlikely((!format_gt_present) && require_gt)) {
@@ -2969,6 +3684,134 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
     uint32_t max_qualfilterinfo_slen = 6;
     uint32_t phase_or_dosage_found = 0;
 
+    if (!spoolname) {
+      VcfScanCtx scan_ctx;
+      scan_ctx.vcfname = vcfname;
+      const uint32_t chrom_line_blen = AdvPastDelim(line_iter, '\n') - prev_line_start;
+      scan_ctx.header_blen = header_blen + chrom_line_blen;
+      scan_ctx.vic = vic;
+      scan_ctx.dosage_import_field = dosage_import_field;
+      scan_ctx.dosage_import_field_slen = dosage_import_field_slen;
+      scan_ctx.format_dosage_relevant = format_dosage_relevant;
+      scan_ctx.format_hds_search = format_hds_search;
+      scan_ctx.format_gq_or_dp_relevant = format_gq_or_dp_relevant;
+      scan_ctx.vcf_min_gq = vcf_min_gq;
+      scan_ctx.vcf_min_dp = vcf_min_dp;
+      scan_ctx.vcf_max_dp = vcf_max_dp;
+      STD_ARRAY_COPY(ctx.qual_mins, 2, scan_ctx.qual_mins);
+      STD_ARRAY_COPY(ctx.qual_maxs, 2, scan_ctx.qual_maxs);
+      scan_ctx.require_gt = require_gt;
+      scan_ctx.info_pr_present = info_pr_present;
+      unsigned char* scan_end_mark = g_bigstack_end;
+      uint32_t chunk_ct;
+      reterr = VcfScanBgzfChunks(max_thread_ct, &scan_ctx, &chunk_ct);
+      if (unlikely(reterr)) {
+        goto VcfToPgen_ret_1;
+      }
+      uint32_t scan_ok = (chunk_ct != 0);
+      for (uint32_t tidx = 0; tidx != chunk_ct; ++tidx) {
+        if (scan_ctx.chunks[tidx].failed) {
+          scan_ok = 0;
+          break;
+        }
+      }
+      if (scan_ok) {
+        // Merge in file order.  Results are only committed if nothing
+        // requires a fallback to the serial scan.
+        uintptr_t scan_base_chr_present[kChrExcludeWords];
+        ZeroWArr(kChrExcludeWords, scan_base_chr_present);
+        const uintptr_t variant_limit = MINV(max_variant_ct, S_CAST(uintptr_t, g_bigstack_end - g_bigstack_base) / sizeof(intptr_t));
+        uintptr_t* scan_nonref_flags_iter = nonref_flags;
+        uintptr_t scan_nonref_word = 0;
+        uintptr_t scan_max_postformat_blen = max_postformat_blen;
+        uintptr_t scan_variant_skip_ct = 0;
+        uintptr_t scan_allele_idx_end = 0;
+        uint32_t scan_variant_ct = 0;
+        uint32_t scan_max_alt_ct = max_alt_ct;
+        uint32_t scan_max_allele_slen = max_allele_slen;
+        uint32_t scan_max_qualfilterinfo_slen = max_qualfilterinfo_slen;
+        uint32_t scan_max_line_blen = MAXV(max_line_blen, chrom_line_blen);
+        uint32_t scan_phase_or_dosage_found = 0;
+        for (uint32_t tidx = 0; tidx != chunk_ct; ++tidx) {
+          const VcfScanChunk* chunkp = &(scan_ctx.chunks[tidx]);
+          scan_variant_skip_ct += chunkp->require_gt_skip_ct;
+          scan_max_line_blen = MAXV(scan_max_line_blen, chunkp->max_line_blen);
+          scan_max_alt_ct = MAXV(scan_max_alt_ct, chunkp->max_alt_ct);
+          const uint16_t* alt_cts_iter = chunkp->alt_cts;
+          const VcfScanRun* runs = chunkp->runs;
+          const uint32_t run_ct = chunkp->run_ct;
+          for (uint32_t run_idx = 0; run_idx != run_ct; ++run_idx) {
+            const VcfScanRun* runp = &(runs[run_idx]);
+            const char* chr_name = runp->chr_name;
+            const uint32_t run_variant_ct = runp->variant_ct;
+            uint32_t cur_chr_code = GetChrCode(chr_name, cip, runp->chr_name_slen);
+            if (IsI32Neg(cur_chr_code)) {
+              // Conditions under which TryToAddChrName() errors out; the
+              // serial scan reports the correct line number.
+              if ((!allow_extra_chrs) || (cur_chr_code == UINT32_MAXM1) || (chr_name[0] == '#') || (runp->chr_name_slen > kMaxIdSlen) || (cip->max_code + 1 + cip->name_ct == kMaxContigs)) {
+                scan_ok = 0;
+                break;
+              }
+              reterr = TryToAddChrName(chr_name, "--vcf file", 0, runp->chr_name_slen, allow_extra_chrs, &cur_chr_code, cip);
+              if (unlikely(reterr)) {
+                goto VcfToPgen_ret_1;
+              }
+            }
+            if (!IsSet(cip->chr_mask, cur_chr_code)) {
+              scan_variant_skip_ct += run_variant_ct;
+              alt_cts_iter = &(alt_cts_iter[run_variant_ct]);
+              continue;
+            }
+            if (run_variant_ct > variant_limit - scan_variant_ct - 1) {
+              scan_ok = 0;
+              break;
+            }
+            scan_max_allele_slen = MAXV(scan_max_allele_slen, runp->max_allele_slen);
+            scan_max_qualfilterinfo_slen = MAXV(scan_max_qualfilterinfo_slen, runp->max_qualfilterinfo_slen);
+            scan_max_postformat_blen = MAXV(scan_max_postformat_blen, runp->max_postformat_blen);
+            scan_phase_or_dosage_found |= runp->phase_or_dosage_found;
+            if (cur_chr_code <= cip->max_code) {
+              SetBit(cur_chr_code, scan_base_chr_present);
+            }
+            for (uint32_t uii = 0; uii != run_variant_ct; ++uii) {
+              const uint32_t alt_ct_entry = *alt_cts_iter++;
+              allele_idx_offsets[scan_variant_ct] = scan_allele_idx_end;
+              scan_allele_idx_end += (alt_ct_entry & 0x7fff) + 1;
+              const uint32_t variant_idx_lowbits = scan_variant_ct % kBitsPerWord;
+              if (info_pr_present) {
+                scan_nonref_word |= S_CAST(uintptr_t, alt_ct_entry >> 15) << variant_idx_lowbits;
+                if (variant_idx_lowbits == (kBitsPerWord - 1)) {
+                  *scan_nonref_flags_iter++ = scan_nonref_word;
+                  scan_nonref_word = 0;
+                }
+              }
+              ++scan_variant_ct;
+            }
+          }
+          if (!scan_ok) {
+            break;
+          }
+        }
+        if (scan_ok) {
+          memcpy(base_chr_present, scan_base_chr_present, kChrExcludeWords * sizeof(intptr_t));
+          nonref_flags_iter = scan_nonref_flags_iter;
+          nonref_word = scan_nonref_word;
+          max_postformat_blen = scan_max_postformat_blen;
+          variant_skip_ct = scan_variant_skip_ct;
+          allele_idx_end = scan_allele_idx_end;
+          variant_ct = scan_variant_ct;
+          max_alt_ct = scan_max_alt_ct;
+          max_allele_slen = scan_max_allele_slen;
+          max_qualfilterinfo_slen = scan_max_qualfilterinfo_slen;
+          max_line_blen = scan_max_line_blen;
+          phase_or_dosage_found = scan_phase_or_dosage_found;
+        }
+      }
+      BigstackEndReset(scan_end_mark);
+      if (scan_ok) {
+        goto VcfToPgen_scan_done;
+      }
+    }
     while (1) {
       ++line_idx;
       line_iter = AdvPastDelim(line_iter, '\n');
@@ -2985,6 +3828,12 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
         goto VcfToPgen_ret_TSTREAM_FAIL;
       }
       prev_line_start = line_iter;
+      if (spoolname) {
+        const char* line_end = AdvPastDelim(line_iter, '\n');
+        if (unlikely(CsputsStd(line_iter, line_end - line_iter, &spool_css, &spool_cswritep) || Cswrite(&spool_css, &spool_cswritep))) {
+          goto VcfToPgen_ret_WRITE_FAIL;
+        }
+      }
       // we were previously tolerating trailing newlines here, but there wasn't
       // a good reason for doing so.
       if (unlikely(ctou32(*line_iter) <= 32)) {
@@ -3197,6 +4046,7 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
         fflush(stdout);
       }
     }
+  VcfToPgen_scan_done:
     if (variant_ct % kBitsPerWord) {
       if (nonref_flags_iter) {
         *nonref_flags_iter = nonref_word;
@@ -3225,6 +4075,7 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
     // (no GQ/DP filter, no dosage), otherwise limit to 1.
     uint32_t decompress_thread_ct = 1;
     uint32_t calc_thread_ct;
+    uint32_t flush_thread_ct;
     {
       if ((vcf_min_gq != -1) || (vcf_min_dp != -1) || (phase_or_dosage_found && (format_dosage_relevant || format_hds_search))) {
         // "are lines expensive to parse?"  will add a multiallelic condition
@@ -3232,7 +4083,7 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
         // this is based on a bunch of DS-force measurements
         calc_thread_ct = 1 + (sample_ct > 5) + (sample_ct > 12) + (sample_ct > 32) + (sample_ct > 512);
       } else {
-        if (TextIsMt(&vcf_txs) && (max_thread_ct > 1)) {
+        if ((!spoolname) && TextIsMt(&vcf_txs) && (max_thread_ct > 1)) {
           decompress_thread_ct = 2;
         }
         // this seems to saturate around 3 threads.
@@ -3242,12 +4093,19 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
         goto VcfToPgen_ret_1;
       }
       BigstackEndReset(bigstack_end_mark);
-      reterr = InitTextStreamEx(vcfname, 1, kMaxLongLine, MAXV(max_line_blen, kTextStreamBlenFast), decompress_thread_ct, &vcf_txs);
+      if (spoolname) {
+        if (unlikely(CswriteCloseNull(&spool_css, spool_cswritep))) {
+          goto VcfToPgen_ret_WRITE_FAIL;
+        }
+      }
+      reterr = InitTextStreamEx(spoolname? spoolname : vcfname, 1, kMaxLongLine, MAXV(max_line_blen, kTextStreamBlenFast), decompress_thread_ct, &vcf_txs);
       if (unlikely(reterr)) {
         goto VcfToPgen_ret_TSTREAM_FAIL;
       }
-      if (calc_thread_ct + decompress_thread_ct > max_thread_ct) {
-        calc_thread_ct = MAXV(1, max_thread_ct - decompress_thread_ct);
+      // reserve a thread for background .pgen writing when possible
+      flush_thread_ct = (max_thread_ct > decompress_thread_ct + 1);
+      if (calc_thread_ct + decompress_thread_ct + flush_thread_ct > max_thread_ct) {
+        calc_thread_ct = MAXV(1, max_thread_ct - decompress_thread_ct - flush_thread_ct);
       }
     }
 
@@ -3400,10 +4258,8 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
     uint32_t per_thread_block_limit = main_block_size;
     uint32_t cur_thread_block_vidx_limit = 1;
     uintptr_t per_thread_byte_limit = 0;
-    unsigned char* geno_bufs[2];
-    // defensive
-    geno_bufs[0] = nullptr;
-    geno_bufs[1] = nullptr;
+    unsigned char* geno_bufs[kGparseMaxBufCt];
+    uint32_t gparse_buf_ct = 2;
     if (hard_call_thresh == UINT32_MAX) {
       hard_call_thresh = kDosageMid / 10;
     }
@@ -3425,13 +4281,18 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
       }
       SpgwInitPhase2(max_vrec_len, &spgw, spgw_alloc);
 
+      gparse_buf_ct = GparseFlushSetBackground(flush_thread_ct, &flush_ctx, &flush_tg);
+      ctx.gparse_buf_ct = gparse_buf_ct;
       if (unlikely(
               bigstack_alloc_ucp(calc_thread_ct, &ctx.thread_wkspaces) ||
-              bigstack_alloc_u32(calc_thread_ct + 1, &(ctx.thread_bidxs[0])) ||
-              bigstack_alloc_u32(calc_thread_ct + 1, &(ctx.thread_bidxs[1])) ||
               bigstack_calloc_w(calc_thread_ct, &ctx.err_line_idxs))) {
         goto VcfToPgen_ret_NOMEM;
       }
+      for (uint32_t buf_idx = 0; buf_idx != gparse_buf_ct; ++buf_idx) {
+        if (unlikely(bigstack_alloc_u32(calc_thread_ct + 1, &(ctx.thread_bidxs[buf_idx])))) {
+          goto VcfToPgen_ret_NOMEM;
+        }
+      }
       ctx.vcf_parse_errs = S_CAST(VcfParseErr*, bigstack_alloc_raw_rd(calc_thread_ct * sizeof(VcfParseErr)));
       if (unlikely(!ctx.vcf_parse_errs)) {
         goto VcfToPgen_ret_NOMEM;
@@ -3441,11 +4302,11 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
       ctx.dosage_erase_halfdist = vic.dosage_erase_halfdist;
       ctx.import_dosage_certainty = import_dosage_certainty;
       ctx.parse_failed = 0;
-      // defensive
-      ctx.gparse[0] = nullptr;
-      ctx.gparse[1] = nullptr;
-      ctx.block_allele_idx_offsets[0] = nullptr;
-      ctx.block_allele_idx_offsets[1] = nullptr;
+      for (uint32_t buf_idx = 0; buf_idx != kGparseMaxBufCt; ++buf_idx) {
+        // defensive
+        ctx.gparse[buf_idx] = nullptr;
+        ctx.block_allele_idx_offsets[buf_idx] = nullptr;
+      }
       // Finished with all other memory allocations, so all remaining workspace
       // can be spent on multithreaded parsing.  Spend up to 1/6 on
       // g_thread_wkspaces (tune this fraction later).
@@ -3469,12 +4330,12 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
       // be pessimistic re: rounding
       cachelines_avail = (bigstack_left() / kCacheline) - 4;
       const uint64_t max_bytes_req_per_variant = sizeof(GparseRecord) + MAXV(max_postformat_blen, max_write_byte_ct) + calc_thread_ct;
-      if (unlikely(cachelines_avail * kCacheline < 2 * max_bytes_req_per_variant)) {
+      if (unlikely(cachelines_avail * kCacheline < gparse_buf_ct * max_bytes_req_per_variant)) {
         goto VcfToPgen_ret_NOMEM;
       }
       // use worst-case gparse_flags since lines will usually be similar
       uintptr_t min_bytes_req_per_variant = sizeof(GparseRecord) + GparseWriteByteCt(sample_ct, 2, gparse_flags);
-      main_block_size = (cachelines_avail * kCacheline) / (min_bytes_req_per_variant * 2);
+      main_block_size = (cachelines_avail * kCacheline) / (min_bytes_req_per_variant * gparse_buf_ct);
       // this is arbitrary, there's no connection to kPglVblockSize
       if (main_block_size > 65536) {
         main_block_size = 65536;
@@ -3490,12 +4351,14 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
       if (unlikely(SetThreadCt(calc_thread_ct, &tg))) {
         goto VcfToPgen_ret_NOMEM;
       }
-      ctx.gparse[0] = S_CAST(GparseRecord*, bigstack_alloc_raw_rd(main_block_size * sizeof(GparseRecord)));
-      ctx.gparse[1] = S_CAST(GparseRecord*, bigstack_alloc_raw_rd(main_block_size * sizeof(GparseRecord)));
+      for (uint32_t buf_idx = 0; buf_idx != gparse_buf_ct; ++buf_idx) {
+        ctx.gparse[buf_idx] = S_CAST(GparseRecord*, bigstack_alloc_raw_rd(main_block_size * sizeof(GparseRecord)));
+      }
       SetThreadFuncAndData(VcfGenoToPgenThread, &ctx, &tg);
-      cachelines_avail = bigstack_left() / (kCacheline * 2);
-      geno_bufs[0] = S_CAST(unsigned char*, bigstack_alloc_raw(cachelines_avail * kCacheline));
-      geno_bufs[1] = S_CAST(unsigned char*, bigstack_alloc_raw(cachelines_avail * kCacheline));
+      cachelines_avail = bigstack_left() / (kCacheline * gparse_buf_ct);
+      for (uint32_t buf_idx = 0; buf_idx != gparse_buf_ct; ++buf_idx) {
+        geno_bufs[buf_idx] = S_CAST(unsigned char*, bigstack_alloc_raw(cachelines_avail * kCacheline));
+      }
       // This is only used for comparison purposes, so it is unnecessary to
       // round it down to a multiple of kBytesPerVec even though every actual
       // record will be vector-aligned.
@@ -3522,7 +4385,7 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
     GparseRecord* cur_gparse = nullptr;
     unsigned char* geno_buf_iter = nullptr;
     unsigned char* cur_thread_byte_stop = nullptr;
-    uint32_t parity = 0;
+    uint32_t buf_idx = 0;
     for (uint32_t vidx_start = 0; ; ) {
       uint32_t cur_block_write_ct = 0;
       if (!IsLastBlock(&tg)) {
@@ -3530,12 +4393,12 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
         cur_thread_block_vidx_limit = MINV(block_vidx_limit, per_thread_block_limit);
         uint32_t cur_thread_fill_idx = 0;
         if (sample_ct) {
-          thread_bidxs = ctx.thread_bidxs[parity];
-          cur_gparse = ctx.gparse[parity];
+          thread_bidxs = ctx.thread_bidxs[buf_idx];
+          cur_gparse = ctx.gparse[buf_idx];
           if (allele_idx_offsets) {
-            ctx.block_allele_idx_offsets[parity] = &(SpgwGetAlleleIdxOffsets(&spgw)[vidx_start]);
+            ctx.block_allele_idx_offsets[buf_idx] = &(SpgwGetAlleleIdxOffsets(&spgw)[vidx_start]);
           }
-          geno_buf_iter = geno_bufs[parity];
+          geno_buf_iter = geno_bufs[buf_idx];
           cur_thread_byte_stop = &(geno_buf_iter[per_thread_byte_limit]);
           thread_bidxs[0] = 0;
         }
@@ -3545,7 +4408,7 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
           goto VcfToPgen_load_start;
         }
         // we may stop before main_block_size due to insufficient space in
-        // geno_bufs[parity].  if so, we copy over the post-FORMAT part of the
+        // geno_bufs[buf_idx].  if so, we copy over the post-FORMAT part of the
         // current line before proceeding.
         while (1) {
           grp = &(cur_gparse[block_vidx]);
@@ -3738,10 +4601,14 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
             goto VcfToPgen_ret_THREAD_CREATE_FAIL;
           }
         }
-        parity = 1 - parity;
+        const uint32_t prev_buf_idx = (buf_idx? buf_idx : gparse_buf_ct) - 1;
+        if (++buf_idx == gparse_buf_ct) {
+          buf_idx = 0;
+        }
         if (vidx_start) {
-          // write *previous* block results
-          reterr = GparseFlush(ctx.gparse[parity], prev_block_write_ct, &spgw);
+          // write *previous* block results (in the background, if we have a
+          // flush thread)
+          reterr = GparseFlushStart(ctx.gparse[prev_buf_idx], prev_block_write_ct, (vidx_start == variant_ct), &flush_ctx, &flush_tg);
           if (unlikely(reterr)) {
             goto VcfToPgen_ret_1;
           }
@@ -3762,6 +4629,10 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
       vidx_start += cur_block_write_ct;
       prev_block_write_ct = cur_block_write_ct;
     }
+    reterr = GparseFlushJoin(&flush_ctx, &flush_tg);
+    if (unlikely(reterr)) {
+      goto VcfToPgen_ret_1;
+    }
     if (unlikely(CswriteCloseNull(&pvar_css, pvar_cswritep))) {
       goto VcfToPgen_ret_WRITE_FAIL;
     }
@@ -3869,10 +4740,15 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
     break;
   }
  VcfToPgen_ret_1:
+  CleanupThreads(&flush_tg);
   CleanupSpgw(&spgw, &reterr);
   CleanupThreads(&tg);
   CleanupTextStream2("--vcf file", &vcf_txs, &reterr);
   CswriteCloseCond(&pvar_css, pvar_cswritep);
+  if (spoolname) {
+    CswriteCloseCond(&spool_css, spool_cswritep);
+    unlink(spoolname);
+  }
   BigstackDoubleReset(bigstack_mark, bigstack_end_mark);
   return reterr;
 }
@@ -6817,9 +7693,11 @@ typedef struct BcfGenoToPgenCtxStruct {
 
   unsigned char** thread_wkspaces;
 
-  uint32_t* thread_bidxs[2];
-  GparseRecord* gparse[2];
-  const uintptr_t* block_allele_idx_offsets[2];
+  // gparse_buf_ct (2 or kGparseMaxBufCt) sets of these are cycled through
+  uint32_t* thread_bidxs[kGparseMaxBufCt];
+  GparseRecord* gparse[kGparseMaxBufCt];
+  const uintptr_t* block_allele_idx_offsets[kGparseMaxBufCt];
+  uint32_t gparse_buf_ct;
 
   // PglErr set by main thread
   BcfParseErr* bcf_parse_errs;
@@ -6862,15 +7740,15 @@ THREAD_FUNC_DECL BcfGenoToPgenThread(void* raw_arg) {
   uintptr_t* write_dphase_present = nullptr;
   SDosage* write_dphase_delta = nullptr;
   uint32_t cur_allele_ct = 2;
-  uint32_t parity = 0;
+  uint32_t buf_idx = 0;
   BcfParseErr bcf_parse_err = kBcfParseOk;
   uintptr_t vrec_idx = 0;
   do {
-    const uintptr_t* block_allele_idx_offsets = ctx->block_allele_idx_offsets[parity];
-    const uint32_t bidx_end = ctx->thread_bidxs[parity][tidx + 1];
-    GparseRecord* cur_gparse = ctx->gparse[parity];
+    const uintptr_t* block_allele_idx_offsets = ctx->block_allele_idx_offsets[buf_idx];
+    const uint32_t bidx_end = ctx->thread_bidxs[buf_idx][tidx + 1];
+    GparseRecord* cur_gparse = ctx->gparse[buf_idx];
 
-    for (uint32_t bidx = ctx->thread_bidxs[parity][tidx]; bidx != bidx_end; ++bidx) {
+    for (uint32_t bidx = ctx->thread_bidxs[buf_idx][tidx]; bidx != bidx_end; ++bidx) {
       GparseRecord* grp = &(cur_gparse[bidx]);
       uint32_t patch_01_ct = 0;
       uint32_t patch_10_ct = 0;
@@ -6962,11 +7840,63 @@ THREAD_FUNC_DECL BcfGenoToPgenThread(void* raw_arg) {
       ctx->parse_failed = 1;
       break;
     }
-    parity = 1 - parity;
+    if (++buf_idx == ctx->gparse_buf_ct) {
+      buf_idx = 0;
+    }
   } while (!THREAD_BLOCK_FINISH(arg));
   THREAD_RETURN;
 }
 
+// Copies the contents of a named pipe to a regular file, so that it can be
+// read more than once.
+PglErr SpoolFifo(const char* fifo_fname, const char* spool_fname) {
+  FILE* infile = nullptr;
+  FILE* outfile = nullptr;
+  PglErr reterr = kPglRetSuccess;
+  {
+    infile = fopen(fifo_fname, FOPEN_RB);
+    if (unlikely(!infile)) {
+      logerrprintfww(kErrprintfFopen, fifo_fname, strerror(errno));
+      goto SpoolFifo_ret_OPEN_FAIL;
+    }
+    if (unlikely(fopen_checked(spool_fname, FOPEN_WB, &outfile))) {
+      goto SpoolFifo_ret_OPEN_FAIL;
+    }
+    while (1) {
+      const uintptr_t byte_ct = fread_unlocked(g_textbuf, 1, kTextbufMainSize, infile);
+      if (byte_ct) {
+        if (unlikely(fwrite_checked(g_textbuf, byte_ct, outfile))) {
+          goto SpoolFifo_ret_WRITE_FAIL;
+        }
+      }
+      if (byte_ct < kTextbufMainSize) {
+        if (unlikely(ferror_unlocked(infile))) {
+          goto SpoolFifo_ret_READ_FAIL;
+        }
+        break;
+      }
+    }
+    if (unlikely(fclose_null(&outfile))) {
+      goto SpoolFifo_ret_WRITE_FAIL;
+    }
+  }
+  while (0) {
+  SpoolFifo_ret_OPEN_FAIL:
+    reterr = kPglRetOpenFail;
+    break;
+  SpoolFifo_ret_READ_FAIL:
+    logerrprintfww(kErrprintfFread, fifo_fname, strerror(errno));
+    reterr = kPglRetReadFail;
+    break;
+  SpoolFifo_ret_WRITE_FAIL:
+    reterr = kPglRetWriteFail;
+    break;
+  }
+  fclose_cond(infile);
+  fclose_cond(outfile);
+  return reterr;
+}
+
 PglErr BcfToPgen(const char* bcfname, const char* preexisting_psamname, const char* const_fid, const char* dosage_import_field, MiscFlags misc_flags, ImportFlags import_flags, uint32_t no_samples_ok, uint32_t hard_call_thresh, uint32_t dosage_erase_thresh, double import_dosage_certainty, char id_delim, char idspace_to, int32_t vcf_min_gq, int32_t vcf_min_dp, int32_t vcf_max_dp, VcfHalfCall halfcall_mode, FamCol fam_cols, uint32_t max_thread_ct, char* outname, char* outname_end, ChrInfo* cip, uint32_t* pgen_generated_ptr, uint32_t* psam_generated_ptr) {
   // Yes, lots of this is copied-and-pasted from VcfToPgen(), but there are
   // enough differences that I don't think trying to handle them with the same
@@ -6978,6 +7908,7 @@ PglErr BcfToPgen(const char* bcfname, const char* preexisting_psamname, const ch
   unsigned char* bigstack_mark = g_bigstack_base;
   unsigned char* bigstack_end_mark = g_bigstack_end;
   FILE* bcffile = nullptr;
+  char* spoolname = nullptr;
   const char* bgzf_errmsg = nullptr;
   char* pvar_cswritep = nullptr;
   uintptr_t vrec_idx = 0;
@@ -6993,9 +7924,28 @@ PglErr BcfToPgen(const char* bcfname, const char* preexisting_psamname, const ch
   PreinitBgzfRawMtStream(&bgzf);
   STPgenWriter spgw;
   PreinitSpgw(&spgw);
+  ThreadGroup flush_tg;
+  PreinitThreads(&flush_tg);
+  GparseFlushCtx flush_ctx;
+  InitGparseFlush(&spgw, &flush_ctx);
   {
+    // BgzfRawMtStreamRewind() can't be used on a named pipe, so we copy its
+    // contents to a temporary file first.  (Unlike the VCF case, there's no
+    // decompression to save by spooling a regular file.)
+    if (ForceNonFifo(bcfname) == kPglRetRewindFail) {
+      const uint32_t outname_slen = outname_end - outname;
+      if (unlikely(bigstack_alloc_c(outname_slen + strlen(".spool.bcf") + 1, &spoolname))) {
+        goto BcfToPgen_ret_NOMEM;
+      }
+      char* spoolname_end = memcpya(spoolname, outname, outname_slen);
+      strcpy_k(spoolname_end, ".spool.bcf");
+      reterr = SpoolFifo(bcfname, spoolname);
+      if (unlikely(reterr)) {
+        goto BcfToPgen_ret_1;
+      }
+    }
     // See TextFileOpenInternal().
-    bcffile = fopen(bcfname, FOPEN_RB);
+    bcffile = fopen(spoolname? spoolname : bcfname, FOPEN_RB);
     if (unlikely(!bcffile)) {
       const uint32_t slen = strlen(bcfname);
       if (!StrEndsWith(bcfname, ".bcf", slen)) {
@@ -8048,8 +8998,10 @@ PglErr BcfToPgen(const char* bcfname, const char* preexisting_psamname, const ch
     } else {
       calc_thread_ct = 1 + (sample_ct > 40) + (sample_ct > 320);
     }
-    if (calc_thread_ct + decompress_thread_ct > max_thread_ct) {
-      calc_thread_ct = MAXV(1, max_thread_ct - decompress_thread_ct);
+    // reserve a thread for background .pgen writing when possible
+    const uint32_t flush_thread_ct = (max_thread_ct > decompress_thread_ct + 1);
+    if (calc_thread_ct + decompress_thread_ct + flush_thread_ct > max_thread_ct) {
+      calc_thread_ct = MAXV(1, max_thread_ct - decompress_thread_ct - flush_thread_ct);
     }
 
     const uint32_t variant_ctl = BitCtToWordCt(variant_ct);
@@ -8189,10 +9141,8 @@ PglErr BcfToPgen(const char* bcfname, const char* preexisting_psamname, const ch
     uint32_t per_thread_block_limit = main_block_size;
     uint32_t cur_thread_block_vidx_limit = 1;
     uintptr_t per_thread_byte_limit = 0;
-    unsigned char* geno_bufs[2];
-    // defensive
-    geno_bufs[0] = nullptr;
-    geno_bufs[1] = nullptr;
+    unsigned char* geno_bufs[kGparseMaxBufCt];
+    uint32_t gparse_buf_ct = 2;
     if (hard_call_thresh == UINT32_MAX) {
       hard_call_thresh = kDosageMid / 10;
     }
@@ -8214,24 +9164,29 @@ PglErr BcfToPgen(const char* bcfname, const char* preexisting_psamname, const ch
       }
       SpgwInitPhase2(max_vrec_len, &spgw, spgw_alloc);
 
+      gparse_buf_ct = GparseFlushSetBackground(flush_thread_ct, &flush_ctx, &flush_tg);
+      ctx.gparse_buf_ct = gparse_buf_ct;
       if (unlikely(
               bigstack_alloc_ucp(calc_thread_ct, &ctx.thread_wkspaces) ||
-              bigstack_alloc_u32(calc_thread_ct + 1, &(ctx.thread_bidxs[0])) ||
-              bigstack_alloc_u32(calc_thread_ct + 1, &(ctx.thread_bidxs[1])) ||
               bigstack_calloc_w(calc_thread_ct, &ctx.err_vrec_idxs))) {
         goto BcfToPgen_ret_NOMEM;
       }
+      for (uint32_t buf_idx = 0; buf_idx != gparse_buf_ct; ++buf_idx) {
+        if (unlikely(bigstack_alloc_u32(calc_thread_ct + 1, &(ctx.thread_bidxs[buf_idx])))) {
+          goto BcfToPgen_ret_NOMEM;
+        }
+      }
       ctx.bcf_parse_errs = S_CAST(BcfParseErr*, bigstack_alloc_raw_rd(calc_thread_ct * sizeof(BcfParseErr)));
       if (unlikely(!ctx.bcf_parse_errs)) {
         goto BcfToPgen_ret_NOMEM;
       }
       ctx.hard_call_halfdist = hard_call_halfdist;
       ctx.parse_failed = 0;
-      // defensive
-      ctx.gparse[0] = nullptr;
-      ctx.gparse[1] = nullptr;
-      ctx.block_allele_idx_offsets[0] = nullptr;
-      ctx.block_allele_idx_offsets[1] = nullptr;
+      for (uint32_t buf_idx = 0; buf_idx != kGparseMaxBufCt; ++buf_idx) {
+        // defensive
+        ctx.gparse[buf_idx] = nullptr;
+        ctx.block_allele_idx_offsets[buf_idx] = nullptr;
+      }
       // Finished with all other memory allocations, so all remaining workspace
       // can be spent on multithreaded parsing.  Spend up to 1/6 on
       // g_thread_wkspaces (tune this fraction later).
@@ -8255,12 +9210,12 @@ PglErr BcfToPgen(const char* bcfname, const char* preexisting_psamname, const ch
       // be pessimistic re: rounding
       cachelines_avail = (bigstack_left() / kCacheline) - 4;
       const uint64_t max_bytes_req_per_variant = sizeof(GparseRecord) + MAXV(max_observed_rec_vecs * S_CAST(uintptr_t, kBytesPerVec), max_write_byte_ct) + calc_thread_ct;
-      if (unlikely(cachelines_avail * kCacheline < 2 * max_bytes_req_per_variant)) {
+      if (unlikely(cachelines_avail * kCacheline < gparse_buf_ct * max_bytes_req_per_variant)) {
         goto BcfToPgen_ret_NOMEM;
       }
       // use worst-case gparse_flags since lines will usually be similar
       uintptr_t min_bytes_req_per_variant = sizeof(GparseRecord) + GparseWriteByteCt(sample_ct, 2, gparse_flags);
-      main_block_size = (cachelines_avail * kCacheline) / (min_bytes_req_per_variant * 2);
+      main_block_size = (cachelines_avail * kCacheline) / (min_bytes_req_per_variant * gparse_buf_ct);
       // this is arbitrary, there's no connection to kPglVblockSize
       if (main_block_size > 65536) {
         main_block_size = 65536;
@@ -8276,12 +9231,14 @@ PglErr BcfToPgen(const char* bcfname, const char* preexisting_psamname, const ch
       if (unlikely(SetThreadCt(calc_thread_ct, &tg))) {
         goto BcfToPgen_ret_NOMEM;
       }
-      ctx.gparse[0] = S_CAST(GparseRecord*, bigstack_alloc_raw_rd(main_block_size * sizeof(GparseRecord)));
-      ctx.gparse[1] = S_CAST(GparseRecord*, bigstack_alloc_raw_rd(main_block_size * sizeof(GparseRecord)));
+      for (uint32_t buf_idx = 0; buf_idx != gparse_buf_ct; ++buf_idx) {
+        ctx.gparse[buf_idx] = S_CAST(GparseRecord*, bigstack_alloc_raw_rd(main_block_size * sizeof(GparseRecord)));
+      }
       SetThreadFuncAndData(BcfGenoToPgenThread, &ctx, &tg);
-      cachelines_avail = bigstack_left() / (kCacheline * 2);
-      geno_bufs[0] = S_CAST(unsigned char*, bigstack_alloc_raw(cachelines_avail * kCacheline));
-      geno_bufs[1] = S_CAST(unsigned char*, bigstack_alloc_raw(cachelines_avail * kCacheline));
+      cachelines_avail = bigstack_left() / (kCacheline * gparse_buf_ct);
+      for (uint32_t buf_idx = 0; buf_idx != gparse_buf_ct; ++buf_idx) {
+        geno_bufs[buf_idx] = S_CAST(unsigned char*, bigstack_alloc_raw(cachelines_avail * kCacheline));
+      }
       // This is only used for comparison purposes, so it is unnecessary to
       // round it down to a multiple of kBytesPerVec even though every actual
       // record will be vector-aligned.
@@ -8309,7 +9266,7 @@ PglErr BcfToPgen(const char* bcfname, const char* preexisting_psamname, const ch
     unsigned char* cur_thread_byte_stop = nullptr;
 
     // Placed here since these values need to persist to the next block
-    // iteration when we run out of geno_bufs[parity] space.
+    // iteration when we run out of geno_bufs[buf_idx] space.
     uint32_t chrom = 0;
     uint32_t pos = 0;
     uint32_t qual_bits = 0;
@@ -8338,7 +9295,7 @@ PglErr BcfToPgen(const char* bcfname, const char* preexisting_psamname, const ch
     uint32_t hds_main_blen = 0;
     uint32_t record_input_vec_ct = 0;
 
-    uint32_t parity = 0;
+    uint32_t buf_idx = 0;
     for (uint32_t vidx_start = 0; ; ) {
       uint32_t cur_block_write_ct = 0;
       if (!IsLastBlock(&tg)) {
@@ -8346,12 +9303,12 @@ PglErr BcfToPgen(const char* bcfname, const char* preexisting_psamname, const ch
         cur_thread_block_vidx_limit = MINV(block_vidx_limit, per_thread_block_limit);
         uint32_t cur_thread_fill_idx = 0;
         if (sample_ct) {
-          thread_bidxs = ctx.thread_bidxs[parity];
-          cur_gparse = ctx.gparse[parity];
+          thread_bidxs = ctx.thread_bidxs[buf_idx];
+          cur_gparse = ctx.gparse[buf_idx];
           if (allele_idx_offsets) {
-            ctx.block_allele_idx_offsets[parity] = &(SpgwGetAlleleIdxOffsets(&spgw)[vidx_start]);
+            ctx.block_allele_idx_offsets[buf_idx] = &(SpgwGetAlleleIdxOffsets(&spgw)[vidx_start]);
           }
-          geno_buf_iter = geno_bufs[parity];
+          geno_buf_iter = geno_bufs[buf_idx];
           cur_thread_byte_stop = &(geno_buf_iter[per_thread_byte_limit]);
           thread_bidxs[0] = 0;
         }
@@ -8360,7 +9317,7 @@ PglErr BcfToPgen(const char* bcfname, const char* preexisting_psamname, const ch
         GparseRecord* grp;
         if (record_input_vec_ct) {
           // If the last block iteration ended due to insufficient space in
-          // geno_bufs[parity], we haven't actually written the current .pvar
+          // geno_bufs[buf_idx], we haven't actually written the current .pvar
           // line or copied genotype/quality data over.
           goto BcfToPgen_load_keep;
         }
@@ -8804,10 +9761,14 @@ PglErr BcfToPgen(const char* bcfname, const char* preexisting_psamname, const ch
             goto BcfToPgen_ret_THREAD_CREATE_FAIL;
           }
         }
-        parity = 1 - parity;
+        const uint32_t prev_buf_idx = (buf_idx? buf_idx : gparse_buf_ct) - 1;
+        if (++buf_idx == gparse_buf_ct) {
+          buf_idx = 0;
+        }
         if (vidx_start) {
-          // write *previous* block results
-          reterr = GparseFlush(ctx.gparse[parity], prev_block_write_ct, &spgw);
+          // write *previous* block results (in the background, if we have a
+          // flush thread)
+          reterr = GparseFlushStart(ctx.gparse[prev_buf_idx], prev_block_write_ct, (vidx_start == variant_ct), &flush_ctx, &flush_tg);
           if (unlikely(reterr)) {
             goto BcfToPgen_ret_1;
           }
@@ -8828,6 +9789,10 @@ PglErr BcfToPgen(const char* bcfname, const char* preexisting_psamname, const ch
       vidx_start += cur_block_write_ct;
       prev_block_write_ct = cur_block_write_ct;
     }
+    reterr = GparseFlushJoin(&flush_ctx, &flush_tg);
+    if (unlikely(reterr)) {
+      goto BcfToPgen_ret_1;
+    }
     if (unlikely(CswriteCloseNull(&pvar_css, pvar_cswritep))) {
       goto BcfToPgen_ret_WRITE_FAIL;
     }
@@ -8968,201 +9933,915 @@ PglErr BcfToPgen(const char* bcfname, const char* preexisting_psamname, const ch
     break;
   }
  BcfToPgen_ret_1:
+  CleanupThreads(&flush_tg);
   CleanupSpgw(&spgw, &reterr);
   CleanupThreads(&tg);
   CswriteCloseCond(&pvar_css, pvar_cswritep);
   CleanupBgzfRawMtStream(&bgzf);
   fclose_cond(bcffile);
+  if (spoolname) {
+    unlink(spoolname);
+  }
   BigstackDoubleReset(bigstack_mark, bigstack_end_mark);
   return reterr;
 }
 
 
-PglErr OxSampleToPsam(const char* samplename, const char* ox_missing_code, ImportFlags import_flags, char* outname, char* outname_end, uint32_t* sample_ct_ptr) {
-  unsigned char* bigstack_mark = g_bigstack_base;
-  FILE* psamfile = nullptr;
+typedef struct BcfSubsetIdSetStruct {
+  const char** ids;
+  uint32_t* htable;
+  uint32_t id_ct;
+  uint32_t htable_size;
+  uint32_t max_slen;
+} BcfSubsetIdSet;
+
+// Loads the whitespace-delimited tokens in the given files.  The strings are
+// packed at the bottom of bigstack (with enough trailing space for
+// IdHtableFindNnt() overread), and ids[] and htable[] are allocated at the top.
+PglErr LoadBcfSubsetIdSet(const char* fnames, uint32_t max_thread_ct, BcfSubsetIdSet* idsp) {
+  unsigned char* bigstack_end_mark = g_bigstack_end;
+  const char* fname_tks = nullptr;
   PglErr reterr = kPglRetSuccess;
-  uintptr_t line_idx = 0;
-  TextStream sample_txs;
-  PreinitTextStream(&sample_txs);
+  TokenStream tks;
+  PreinitTokenStream(&tks);
   {
-    uint32_t omp_slen = 2;
-    char output_missing_pheno[kMaxMissingPhenostrBlen];
-    if (import_flags & kfImportKeepAutoconv) {
-      // must use --output-missing-phenotype parameter, which we've validated
-      // to be consistent with --input-missing-phenotype
-      omp_slen = strlen(g_output_missing_pheno);
-      memcpy(output_missing_pheno, g_output_missing_pheno, omp_slen);
-    } else {
-      // use "NA" since that's always safe
-      memcpy_k(output_missing_pheno, "NA", 2);
-    }
-    const char* missing_catname = g_missing_catname;
-    uint32_t missing_catname_slen = strlen(missing_catname);
-
-    uint32_t max_line_blen;
-    if (unlikely(StandardizeMaxLineBlen(bigstack_left() / 4, &max_line_blen))) {
-      goto OxSampleToPsam_ret_NOMEM;
-    }
-    reterr = InitTextStream(samplename, max_line_blen, 1, &sample_txs);
-    if (unlikely(reterr)) {
-      if (reterr == kPglRetOpenFail) {
-        const uint32_t slen = strlen(samplename);
-        if ((!StrEndsWith(samplename, ".sample", slen)) &&
-            (!StrEndsWith(samplename, ".sample.gz", slen))) {
-          logerrprintfww("Error: Failed to open %s : %s. (--sample expects a complete filename; did you forget '.sample' at the end?)\n", samplename, strerror(errno));
-          goto OxSampleToPsam_ret_1;
-        }
+    char* strings_start = R_CAST(char*, g_bigstack_base);
+    char* write_iter = strings_start;
+    uintptr_t id_ct = 0;
+    uint32_t max_slen = 0;
+    const char* fnames_iter = fnames;
+    do {
+      if (!fname_tks) {
+        // token buffer at the top, so the strings can grow from the bottom
+        reterr = InitTokenStreamEx(fnames_iter, 1, MAXV(max_thread_ct - 1, 1), &tks);
+      } else {
+        reterr = TokenStreamRetarget(fnames_iter, &tks);
       }
-      goto OxSampleToPsam_ret_TSTREAM_FAIL;
-    }
-    uint32_t mc_ct = 0;
-    uintptr_t max_mc_blen = 1;
-    char* sorted_mc = nullptr;
-    if (!ox_missing_code) {
-      if (unlikely(bigstack_alloc_c(3, &sorted_mc))) {
-        goto OxSampleToPsam_ret_NOMEM;
+      fname_tks = fnames_iter;
+      if (unlikely(reterr)) {
+        goto LoadBcfSubsetIdSet_ret_TKSTREAM_FAIL;
       }
-      strcpy_k(sorted_mc, "NA");
-      mc_ct = 1;
-      max_mc_blen = 3;
-    } else {
-      // er, this should use something like
-      // CountAndMeasureMultistrReverseAlloc()...
-      const char* missing_code_iter = ox_missing_code;
-      while (*missing_code_iter) {
-        while (*missing_code_iter == ',') {
-          ++missing_code_iter;
-        }
-        if (!(*missing_code_iter)) {
+      while (1) {
+        char* shard_boundaries[2];
+        reterr = TksNext(&tks, 1, shard_boundaries);
+        if (reterr) {
           break;
         }
-        ++mc_ct;
-        const char* token_end = strchrnul(missing_code_iter, ',');
-        uintptr_t token_slen = token_end - missing_code_iter;
-        if (token_slen >= max_mc_blen) {
-          max_mc_blen = token_slen + 1;
-        }
-        missing_code_iter = token_end;
-      }
-      if (mc_ct) {
-        if (unlikely(bigstack_alloc_c(mc_ct * max_mc_blen, &sorted_mc))) {
-          goto OxSampleToPsam_ret_NOMEM;
-        }
-        missing_code_iter = ox_missing_code;
-        for (uintptr_t mc_idx = 0; mc_idx != mc_ct; ++mc_idx) {
-          while (*missing_code_iter == ',') {
-            ++missing_code_iter;
+        const char* shard_iter = shard_boundaries[0];
+        const char* shard_end = shard_boundaries[1];
+        while (1) {
+          shard_iter = FirstPostspaceBounded(shard_iter, shard_end);
+          if (shard_iter == shard_end) {
+            break;
           }
-          const char* token_end = strchrnul(missing_code_iter, ',');
-          uintptr_t token_slen = token_end - missing_code_iter;
-          memcpyx(&(sorted_mc[mc_idx * max_mc_blen]), missing_code_iter, token_slen, '\0');
-          missing_code_iter = token_end;
+          const char* token_end = CurTokenEnd(shard_iter);
+          const uint32_t slen = token_end - shard_iter;
+          // need room for this string, the overread allowance, and eventually
+          // an ids[] entry
+          if (unlikely(S_CAST(uintptr_t, R_CAST(char*, g_bigstack_end) - write_iter) < 2 * (slen + 1) + (id_ct + 1) * sizeof(intptr_t) + kCacheline)) {
+            goto LoadBcfSubsetIdSet_ret_NOMEM;
+          }
+          write_iter = memcpyax(write_iter, shard_iter, slen, '\0');
+          if (slen > max_slen) {
+            max_slen = slen;
+          }
+          ++id_ct;
+          shard_iter = token_end;
         }
-        // this was temporarily broken in June 2018 due to first
-        // strcmp_overread() implementation returning 0 instead of -1 on
-        // less-than
-        qsort(sorted_mc, mc_ct, max_mc_blen, strcmp_overread_casted);
       }
+      if (unlikely(reterr != kPglRetEof)) {
+        goto LoadBcfSubsetIdSet_ret_TKSTREAM_FAIL;
+      }
+      fnames_iter = strnul(fnames_iter);
+      ++fnames_iter;
+    } while (*fnames_iter);
+    reterr = kPglRetSuccess;
+    if (unlikely(CleanupTokenStream2(fname_tks, &tks, &reterr))) {
+      fname_tks = nullptr;
+      goto LoadBcfSubsetIdSet_ret_1;
     }
-
-    // New first pass: check whether, from the third line on, all first tokens
-    // are '0'.  If yes, we omit FID from the output.
-    uint32_t write_fid = 0;
-    uint32_t header_lines_left = 2;
-    while (1) {
-      ++line_idx;
-      char* line_start = TextGet(&sample_txs);
-      if (!line_start) {
-        // bugfix (16 Feb 2018): don't check this if we break out of the loop
-        // on non-0 FID
-        if (unlikely(TextStreamErrcode2(&sample_txs, &reterr))) {
-          goto OxSampleToPsam_ret_TSTREAM_FAIL;
+    fname_tks = nullptr;
+    BigstackEndReset(bigstack_end_mark);
+    if (unlikely(id_ct > 0x7ffffffe)) {
+      goto LoadBcfSubsetIdSet_ret_NOMEM;
+    }
+    BigstackBaseSet(&(write_iter[max_slen]));
+    const uint32_t htable_size = MAXV(GetHtableFastSize(id_ct), 1);
+    const char** ids;
+    uint32_t* htable;
+    if (unlikely(
+            bigstack_end_alloc_kcp(id_ct, &ids) ||
+            bigstack_end_alloc_u32(htable_size, &htable))) {
+      goto LoadBcfSubsetIdSet_ret_NOMEM;
+    }
+    SetAllU32Arr(htable_size, htable);
+    const char* read_iter = strings_start;
+    uint32_t uniq_ct = 0;
+    for (uintptr_t token_idx = 0; token_idx != id_ct; ++token_idx) {
+      const uint32_t slen = strlen(read_iter);
+      for (uint32_t hashval = Hashceil(read_iter, slen, htable_size); ; ) {
+        const uint32_t cur_htable_entry = htable[hashval];
+        if (cur_htable_entry == UINT32_MAX) {
+          htable[hashval] = uniq_ct;
+          ids[uniq_ct++] = read_iter;
+          break;
         }
-        if (unlikely(header_lines_left)) {
-          logerrputs("Error: Empty .sample file.\n");
-          goto OxSampleToPsam_ret_MALFORMED_INPUT;
+        if (!strcmp(read_iter, ids[cur_htable_entry])) {
+          break;
+        }
+        if (++hashval == htable_size) {
+          hashval = 0;
         }
-        break;
-      }
-      if (header_lines_left) {
-        --header_lines_left;
-        continue;
-      }
-      if ((line_start[0] != '0') || (!IsSpaceOrEoln(line_start[1]))) {
-        write_fid = 1;
-        break;
       }
+      read_iter = &(read_iter[slen + 1]);
     }
-    reterr = TextRewind(&sample_txs);
-    if (unlikely(reterr)) {
-      goto OxSampleToPsam_ret_TSTREAM_FAIL;
+    idsp->ids = ids;
+    idsp->htable = htable;
+    idsp->id_ct = uniq_ct;
+    idsp->htable_size = htable_size;
+    idsp->max_slen = max_slen;
+  }
+  while (0) {
+  LoadBcfSubsetIdSet_ret_NOMEM:
+    reterr = kPglRetNomem;
+    break;
+  LoadBcfSubsetIdSet_ret_TKSTREAM_FAIL:
+    TokenStreamErrPrint(fname_tks, &tks);
+    break;
+  }
+ LoadBcfSubsetIdSet_ret_1:
+  if (fname_tks) {
+    CleanupTokenStream2(fname_tks, &tks, &reterr);
+    BigstackEndReset(bigstack_end_mark);
+  }
+  return reterr;
+}
+
+static inline uint32_t BcfSubsetIdSetContains(const BcfSubsetIdSet* idsp, const char* id, uint32_t id_slen) {
+  return (id_slen <= idsp->max_slen) && (IdHtableFindNnt(id, idsp->ids, idsp->htable, id_slen, idsp->htable_size) != UINT32_MAX);
+}
+
+// Copies the entries of one FORMAT vector belonging to the kept samples.
+// Long runs of kept samples are handled with memcpy; otherwise we gather
+// fixed-width entries directly.
+unsigned char* BcfSubsetGather(const unsigned char* src, const uint32_t* kept_sample_idxs, const uint32_t* run_starts, const uint32_t* run_lens, uint32_t kept_sample_ct, uint32_t run_ct, uint32_t entry_width, unsigned char* dst) {
+  if ((run_ct * 4 <= kept_sample_ct) || (entry_width > 8) || (entry_width & (entry_width - 1))) {
+    for (uint32_t run_idx = 0; run_idx != run_ct; ++run_idx) {
+      dst = memcpyua(dst, &(src[S_CAST(uintptr_t, run_starts[run_idx]) * entry_width]), S_CAST(uintptr_t, run_lens[run_idx]) * entry_width);
     }
-    line_idx = 1;
-    char* line_start = TextGet(&sample_txs);
-    if (unlikely(!line_start)) {
-      reterr = TextStreamRawErrcode(&sample_txs);
-      goto OxSampleToPsam_ret_TSTREAM_REWIND_FAIL;
+    return dst;
+  }
+  if (entry_width == 1) {
+    for (uint32_t uii = 0; uii != kept_sample_ct; ++uii) {
+      dst[uii] = src[kept_sample_idxs[uii]];
     }
-    char* token_end = CurTokenEnd(line_start);
-    // todo: allow arbitrary first column name, and ID_2/missing to be absent,
-    // to match SNPTEST 2.5.4's de facto change to the .sample file format.
-    // (Probably wait till 2.5.4 is a stable version, though.)
-    if (unlikely(!strequal_k(line_start, "ID_1", token_end - line_start))) {
-      goto OxSampleToPsam_ret_INVALID_SAMPLE_HEADER_1;
+  } else if (entry_width == 2) {
+    for (uint32_t uii = 0; uii != kept_sample_ct; ++uii) {
+      memcpy(&(dst[uii * 2]), &(src[kept_sample_idxs[uii] * k1LU * 2]), 2);
     }
-    // currently accepts tab as delimiter, though .sample spec technically
-    // prohibits that
-    char* linebuf_iter = FirstNonTspace(token_end);
-    uint32_t token_slen = strlen_se(linebuf_iter);
-    if (unlikely(!strequal_k(linebuf_iter, "ID_2", token_slen))) {
-      goto OxSampleToPsam_ret_INVALID_SAMPLE_HEADER_1;
+  } else if (entry_width == 4) {
+    for (uint32_t uii = 0; uii != kept_sample_ct; ++uii) {
+      memcpy(&(dst[uii * 4]), &(src[kept_sample_idxs[uii] * k1LU * 4]), 4);
     }
-    linebuf_iter = FirstNonTspace(&(linebuf_iter[token_slen]));
-    token_slen = strlen_se(linebuf_iter);
-    if (unlikely(!MatchUpperKLen(linebuf_iter, "MISSING", token_slen))) {
-      goto OxSampleToPsam_ret_INVALID_SAMPLE_HEADER_1;
+  } else {
+    for (uint32_t uii = 0; uii != kept_sample_ct; ++uii) {
+      memcpy(&(dst[uii * k1LU * 8]), &(src[kept_sample_idxs[uii] * k1LU * 8]), 8);
     }
-    linebuf_iter = FirstNonTspace(&(linebuf_iter[token_slen]));
+  }
+  return &(dst[S_CAST(uintptr_t, kept_sample_ct) * entry_width]);
+}
 
-    snprintf(outname_end, kMaxOutfnameExtBlen, ".psam");
-    if (unlikely(fopen_checked(outname, FOPEN_WB, &psamfile))) {
-      goto OxSampleToPsam_ret_OPEN_FAIL;
-    }
-    // categorical phenotypes are lengthened by 1 character ('C' added in
-    // front), so this needs to be 50% larger than maximum possible line length
-    // to handle worst case
-    uintptr_t linebuf_size = max_line_blen + kDecompressChunkSize;
-    linebuf_size += linebuf_size / 2;
-    // bugfix (19 Mar 2018): this needs to be min, not max...
-    linebuf_size = MINV(linebuf_size, kMaxLongLine);
-    char* writebuf;
-    if (unlikely(bigstack_alloc_c(linebuf_size, &writebuf))) {
-      goto OxSampleToPsam_ret_NOMEM;
-    }
-    char* write_iter = writebuf;
-    *write_iter++ = '#';
-    if (write_fid) {
-      write_iter = strcpya_k(write_iter, "FID\t");
+// Returns the dictionary index of a ##contig header line.  As in BcfToPgen(),
+// IDX= is assumed to be at the end of the line when present; otherwise the
+// index is implicit.
+BoolErr BcfSubsetContigIdx(const char* line_end, uint32_t* implicit_idx_ptr, uint32_t* contig_idx_ptr) {
+  const char* line_last_iter = &(line_end[-2]);
+  while (ctou32(*line_last_iter) <= 32) {
+    --line_last_iter;
+  }
+  if (unlikely(*line_last_iter != '>')) {
+    return 1;
+  }
+  --line_last_iter;
+  if (IsDigit(*line_last_iter)) {
+    do {
+      --line_last_iter;
+    } while (IsDigit(*line_last_iter));
+    if (StrStartsWithUnsafe(&(line_last_iter[-4]), ",IDX=")) {
+      return ScanUintDefcap(&(line_last_iter[1]), contig_idx_ptr);
     }
-    write_iter = strcpya_k(write_iter, "IID\tSEX");
-
-    // 0 = not present, otherwise zero-based index (this is fine since first
-    //     column has to be FID)
-    uint32_t sex_col = 0;
-
-    uint32_t col_ct = 3;
+  }
+  *contig_idx_ptr = *implicit_idx_ptr;
+  *implicit_idx_ptr += 1;
+  return 0;
+}
 
-    while (!IsEolnKns(*linebuf_iter)) {
-      token_end = CurTokenEnd(linebuf_iter);
-      token_slen = token_end - linebuf_iter;
-      if (MatchUpperKLen(linebuf_iter, "SEX", token_slen)) {
-        if (unlikely(sex_col)) {
-          logerrputs("Error: Multiple sex columns in .sample file.\n");
-          goto OxSampleToPsam_ret_MALFORMED_INPUT;
-        }
-        sex_col = col_ct;
-      }
+PglErr BcfSubset(const char* bcfname, const char* keep_fnames, const char* remove_fnames, const char* extract_fnames, const char* exclude_fnames, MiscFlags misc_flags, uint32_t max_thread_ct, char* outname, char* outname_end, ChrInfo* cip) {
+  unsigned char* bigstack_mark = g_bigstack_base;
+  unsigned char* bigstack_end_mark = g_bigstack_end;
+  FILE* bcffile = nullptr;
+  const char* bgzf_errmsg = nullptr;
+  uintptr_t vrec_idx = 0;
+  PglErr reterr = kPglRetSuccess;
+  BgzfRawMtDecompressStream bgzf;
+  PreinitBgzfRawMtStream(&bgzf);
+  BgzfCompressStream bgzf_out;
+  PreinitBgzfCompressStream(&bgzf_out);
+  {
+    // No rewind is needed, so named pipes are fine.
+    bcffile = fopen(bcfname, FOPEN_RB);
+    if (unlikely(!bcffile)) {
+      logerrprintfww(kErrprintfFopen, bcfname, strerror(errno));
+      goto BcfSubset_ret_OPEN_FAIL;
+    }
+    // Recompression is far more expensive than decompression, so most
+    // threads go to the writer.
+    const uint32_t decompress_thread_ct = ClipU32((max_thread_ct - 1) / 3, 1, 4);
+    uint32_t header_size;
+    unsigned char prefix_buf[9];
+    {
+      char bgzf_header[16];
+      uint32_t nbytes = fread_unlocked(bgzf_header, 1, 16, bcffile);
+      if (unlikely(ferror(bcffile))) {
+        reterr = kPglRetReadFail;
+        goto BcfSubset_ret_BGZF_FAIL;
+      }
+      if (unlikely((nbytes != 16) || (!IsBgzfHeader(bgzf_header)))) {
+        snprintf(g_logbuf, kLogbufSize, "Error: %s is not a BCF2 file.\n", bcfname);
+        goto BcfSubset_ret_MALFORMED_INPUT_WW;
+      }
+      reterr = BgzfRawMtStreamInit(bgzf_header, decompress_thread_ct, bcffile, nullptr, &bgzf, &bgzf_errmsg);
+      if (unlikely(reterr)) {
+        goto BcfSubset_ret_BGZF_FAIL;
+      }
+      unsigned char* prefix_end = &(prefix_buf[9]);
+      unsigned char* dummy = prefix_buf;
+      reterr = BgzfRawMtStreamRead(prefix_end, &bgzf, &dummy, &bgzf_errmsg);
+      if (unlikely(reterr)) {
+        goto BcfSubset_ret_BGZF_FAIL;
+      }
+      if (unlikely((dummy != prefix_end) || (!memequal_k(prefix_buf, "BCF\2", 4)) || (prefix_buf[4] > 2))) {
+        snprintf(g_logbuf, kLogbufSize, "Error: %s is not a BCF v2.0-2.2 file.\n", bcfname);
+        goto BcfSubset_ret_MALFORMED_INPUT_WW;
+      }
+      memcpy(&header_size, &(prefix_buf[5]), sizeof(int32_t));
+      if (unlikely(header_size < 59)) {
+        goto BcfSubset_ret_MALFORMED_INPUT_GENERIC;
+      }
+    }
+    char* vcf_header;
+    if (unlikely(bigstack_alloc_c(header_size, &vcf_header))) {
+      goto BcfSubset_ret_NOMEM;
+    }
+    {
+      unsigned char* header_load_iter = R_CAST(unsigned char*, vcf_header);
+      unsigned char* header_load_end = &(header_load_iter[header_size]);
+      reterr = BgzfRawMtStreamRead(header_load_end, &bgzf, &header_load_iter, &bgzf_errmsg);
+      if (unlikely(reterr)) {
+        goto BcfSubset_ret_BGZF_FAIL;
+      }
+      if (unlikely(header_load_iter != header_load_end)) {
+        goto BcfSubset_ret_MALFORMED_INPUT_GENERIC;
+      }
+    }
+    if (unlikely(!memequal_k(&(vcf_header[header_size - 2]), "\n", 2))) {
+      goto BcfSubset_ret_MALFORMED_TEXT_HEADER;
+    }
+    char* vcf_header_end = &(vcf_header[header_size - 1]);
+
+    // Only the contig dictionary and the sample IDs matter here; everything
+    // else in the header is passed through unchanged.
+    uint32_t contig_ct = 0;
+    uint32_t implicit_contig_idx = 0;
+    uint32_t chrset_present = 0;
+    uint32_t header_line_idx = 1;
+    char* line_iter = vcf_header;
+    for (; ; ++header_line_idx) {
+      if (unlikely(line_iter == vcf_header_end)) {
+        logerrputs("Error: No #CHROM header line in BCF text header block.\n");
+        goto BcfSubset_ret_MALFORMED_INPUT;
+      }
+      if (unlikely(*line_iter != '#')) {
+        snprintf(g_logbuf, kLogbufSize, "Error: Line %u in BCF text header block does not start with '#'.\n", header_line_idx);
+        goto BcfSubset_ret_MALFORMED_INPUT_WW;
+      }
+      if (line_iter[1] != '#') {
+        break;
+      }
+      char* line_main = &(line_iter[2]);
+      char* line_end = AdvPastDelim(line_main, '\n');
+      line_iter = line_end;
+      if (StrStartsWithUnsafe(line_main, "chrSet=<")) {
+        if (unlikely(chrset_present)) {
+          logerrputs("Error: Multiple ##chrSet header lines in BCF text header block.\n");
+          goto BcfSubset_ret_MALFORMED_INPUT;
+        }
+        chrset_present = 1;
+        reterr = ReadChrsetHeaderLine(&(line_main[8]), "--bcf file", misc_flags, header_line_idx, cip);
+        if (unlikely(reterr)) {
+          goto BcfSubset_ret_1;
+        }
+        continue;
+      }
+      if (!StrStartsWithUnsafe(line_main, "contig=<ID=")) {
+        continue;
+      }
+      uint32_t cur_contig_idx;
+      if (BcfSubsetContigIdx(line_end, &implicit_contig_idx, &cur_contig_idx)) {
+        snprintf(g_logbuf, kLogbufSize, "Error: Line %u in BCF text header block is malformed.\n", header_line_idx);
+        goto BcfSubset_ret_MALFORMED_INPUT_WW;
+      }
+      if (cur_contig_idx >= contig_ct) {
+        contig_ct = cur_contig_idx + 1;
+      }
+    }
+    FinalizeChrset(misc_flags, cip);
+    char* chrom_line_start = line_iter;
+    if (unlikely(!StrStartsWithUnsafe(chrom_line_start, "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO"))) {
+      snprintf(g_logbuf, kLogbufSize, "Error: Header line %u of BCF text header block does not have expected field sequence after #CHROM.\n", header_line_idx);
+      goto BcfSubset_ret_MALFORMED_INPUT_WW;
+    }
+    char* chrom_line_end = AdvToDelim(chrom_line_start, '\n');
+    const char** contig_names;
+    uint32_t* contig_slens;
+    uintptr_t* contig_seen;
+    uintptr_t* contig_keep;
+    if (unlikely(
+            bigstack_calloc_kcp(contig_ct, &contig_names) ||
+            bigstack_calloc_u32(contig_ct, &contig_slens) ||
+            bigstack_calloc_w(BitCtToWordCt(contig_ct), &contig_seen) ||
+            bigstack_calloc_w(BitCtToWordCt(contig_ct), &contig_keep))) {
+      goto BcfSubset_ret_NOMEM;
+    }
+    unsigned char* tmp_alloc_end = g_bigstack_end;
+    implicit_contig_idx = 0;
+    for (line_iter = vcf_header; line_iter != chrom_line_start; ) {
+      char* line_main = &(line_iter[2]);
+      char* line_end = AdvPastDelim(line_main, '\n');
+      line_iter = line_end;
+      if (!StrStartsWithUnsafe(line_main, "contig=<ID=")) {
+        continue;
+      }
+      uint32_t cur_contig_idx;
+      BcfSubsetContigIdx(line_end, &implicit_contig_idx, &cur_contig_idx);
+      char* id_start = &(line_main[strlen("contig=<ID=")]);
+      char* id_end = S_CAST(char*, rawmemchr2(id_start, ',', '>'));
+      const uint32_t id_slen = id_end - id_start;
+      if (contig_names[cur_contig_idx]) {
+        if (unlikely((id_slen != contig_slens[cur_contig_idx]) || (!memequal(id_start, contig_names[cur_contig_idx], id_slen)))) {
+          snprintf(g_logbuf, kLogbufSize, "Error: Multiple contig IDs in BCF text header block have IDX=%u.\n", cur_contig_idx);
+          goto BcfSubset_ret_MALFORMED_INPUT_WW;
+        }
+        continue;
+      }
+      if (unlikely(StoreStringAtEndK(g_bigstack_base, id_start, id_slen, &tmp_alloc_end, &(contig_names[cur_contig_idx])))) {
+        goto BcfSubset_ret_NOMEM;
+      }
+      contig_slens[cur_contig_idx] = id_slen;
+    }
+    BigstackEndSet(tmp_alloc_end);
+
+    // Sample IDs.  Without --double-id/--const-fid/--id-delim, each VCF
+    // sample ID is imported as an IID with FID 0, so that's what --keep and
+    // --remove are matched against.
+    uint32_t raw_sample_ct = 0;
+    char* sample_names_start = &(chrom_line_start[strlen("#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO")]);
+    uintptr_t max_sample_name_blen = 0;
+    if (StrStartsWithUnsafe(sample_names_start, "\tFORMAT\t")) {
+      sample_names_start = &(sample_names_start[strlen("\tFORMAT\t")]);
+      const char* name_iter = sample_names_start;
+      while (1) {
+        const char* name_end = AdvToDelimOrEnd(name_iter, chrom_line_end, '\t');
+        const uintptr_t name_blen = 1 + S_CAST(uintptr_t, name_end - name_iter);
+        if (name_blen > max_sample_name_blen) {
+          max_sample_name_blen = name_blen;
+        }
+        ++raw_sample_ct;
+        if (name_end == chrom_line_end) {
+          break;
+        }
+        name_iter = &(name_end[1]);
+      }
+    }
+    if (unlikely(raw_sample_ct >= (1 << 24))) {
+      snprintf(g_logbuf, kLogbufSize, "Error: BCF text header block has %u sample IDs, which is larger than the BCF limit of 2^24 - 1.\n", raw_sample_ct);
+      goto BcfSubset_ret_MALFORMED_INPUT_WW;
+    }
+    const uint32_t raw_sample_ctl = BitCtToWordCt(raw_sample_ct);
+    uintptr_t* sample_include;
+    if (unlikely(bigstack_alloc_w(raw_sample_ctl, &sample_include))) {
+      goto BcfSubset_ret_NOMEM;
+    }
+    SetAllBits(raw_sample_ct, sample_include);
+    uint32_t sample_ct = raw_sample_ct;
+    if (keep_fnames || remove_fnames) {
+      SampleIdInfo sii;
+      sii.sids = nullptr;
+      sii.max_sid_blen = 0;
+      sii.flags = kfSampleId0;
+      sii.max_sample_id_blen = 2 + max_sample_name_blen;
+      unsigned char* bigstack_mark2 = g_bigstack_base;
+      if (unlikely(bigstack_alloc_c(raw_sample_ct * sii.max_sample_id_blen, &sii.sample_ids))) {
+        goto BcfSubset_ret_NOMEM;
+      }
+      const char* name_iter = sample_names_start;
+      for (uint32_t sample_uidx = 0; sample_uidx != raw_sample_ct; ++sample_uidx) {
+        const char* name_end = AdvToDelimOrEnd(name_iter, chrom_line_end, '\t');
+        char* sample_id_write_iter = strcpya_k(&(sii.sample_ids[sample_uidx * sii.max_sample_id_blen]), "0\t");
+        memcpyx(sample_id_write_iter, name_iter, name_end - name_iter, '\0');
+        name_iter = &(name_end[1]);
+      }
+      if (keep_fnames) {
+        reterr = KeepOrRemove(keep_fnames, &sii, nullptr, raw_sample_ct, kfKeep0, max_thread_ct, sample_include, &sample_ct);
+        if (unlikely(reterr)) {
+          goto BcfSubset_ret_1;
+        }
+      }
+      if (remove_fnames) {
+        reterr = KeepOrRemove(remove_fnames, &sii, nullptr, raw_sample_ct, kfKeepRemove, max_thread_ct, sample_include, &sample_ct);
+        if (unlikely(reterr)) {
+          goto BcfSubset_ret_1;
+        }
+      }
+      BigstackReset(bigstack_mark2);
+    }
+    uint32_t* kept_sample_idxs;
+    uint32_t* run_starts;
+    uint32_t* run_lens;
+    if (unlikely(
+            bigstack_alloc_u32(sample_ct, &kept_sample_idxs) ||
+            bigstack_alloc_u32(sample_ct, &run_starts) ||
+            bigstack_alloc_u32(sample_ct, &run_lens))) {
+      goto BcfSubset_ret_NOMEM;
+    }
+    uint32_t run_ct = 0;
+    {
+      uintptr_t sample_uidx_base = 0;
+      uintptr_t cur_bits = sample_include[0];
+      for (uint32_t sample_idx = 0; sample_idx != sample_ct; ++sample_idx) {
+        const uint32_t sample_uidx = BitIter1(sample_include, &sample_uidx_base, &cur_bits);
+        kept_sample_idxs[sample_idx] = sample_uidx;
+        if (run_ct && (run_starts[run_ct - 1] + run_lens[run_ct - 1] == sample_uidx)) {
+          run_lens[run_ct - 1] += 1;
+        } else {
+          run_starts[run_ct] = sample_uidx;
+          run_lens[run_ct] = 1;
+          ++run_ct;
+        }
+      }
+    }
+    const uint32_t all_samples_kept = (sample_ct == raw_sample_ct);
+
+    BcfSubsetIdSet extract_set;
+    BcfSubsetIdSet exclude_set;
+    if (extract_fnames) {
+      reterr = LoadBcfSubsetIdSet(extract_fnames, max_thread_ct, &extract_set);
+      if (unlikely(reterr)) {
+        goto BcfSubset_ret_1;
+      }
+    }
+    if (exclude_fnames) {
+      reterr = LoadBcfSubsetIdSet(exclude_fnames, max_thread_ct, &exclude_set);
+      if (unlikely(reterr)) {
+        goto BcfSubset_ret_1;
+      }
+    }
+
+    snprintf(outname_end, kMaxOutfnameExtBlen, ".bcf");
+    reterr = InitBgzfCompressStreamEx(outname, 0, kBgzfDefaultClvl, max_thread_ct, &bgzf_out);
+    if (unlikely(reterr)) {
+      if (reterr == kPglRetOpenFail) {
+        logerrprintfww(kErrprintfFopen, outname, strerror(errno));
+      }
+      goto BcfSubset_ret_1;
+    }
+    {
+      unsigned char* bigstack_end_mark2 = g_bigstack_end;
+      // Rewrite the #CHROM line with just the kept sample IDs.
+      const uintptr_t main_header_blen = S_CAST(uintptr_t, sample_names_start - vcf_header);
+      char* new_header;
+      if (unlikely(bigstack_end_alloc_c(header_size + 9, &new_header))) {
+        goto BcfSubset_ret_NOMEM;
+      }
+      char* header_write_iter = &(new_header[9]);
+      if (sample_ct) {
+        header_write_iter = memcpya(header_write_iter, vcf_header, main_header_blen);
+        const char* name_iter = sample_names_start;
+        uintptr_t sample_uidx_base = 0;
+        uintptr_t cur_bits = sample_include[0];
+        uint32_t prev_sample_uidx = 0;
+        for (uint32_t sample_idx = 0; sample_idx != sample_ct; ++sample_idx) {
+          const uint32_t sample_uidx = BitIter1(sample_include, &sample_uidx_base, &cur_bits);
+          for (; prev_sample_uidx != sample_uidx; ++prev_sample_uidx) {
+            name_iter = &(AdvToDelim(name_iter, '\t')[1]);
+          }
+          const char* name_end = AdvToDelimOrEnd(name_iter, chrom_line_end, '\t');
+          header_write_iter = memcpya(header_write_iter, name_iter, name_end - name_iter);
+          *header_write_iter++ = '\t';
+        }
+        --header_write_iter;
+      } else {
+        // No FORMAT column when there are no samples.
+        header_write_iter = memcpya(header_write_iter, vcf_header, &(chrom_line_start[strlen("#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO")]) - vcf_header);
+      }
+      header_write_iter = strcpya_k(header_write_iter, "\n");
+      *header_write_iter++ = '\0';
+      const uint32_t new_header_size = header_write_iter - (&(new_header[9]));
+      memcpy(new_header, prefix_buf, 5);
+      memcpy(&(new_header[5]), &new_header_size, sizeof(int32_t));
+      if (unlikely(BgzfWrite(new_header, header_write_iter - new_header, &bgzf_out))) {
+        goto BcfSubset_ret_WRITE_FAIL;
+      }
+      BigstackEndReset(bigstack_end_mark2);
+    }
+
+    // Output records are never larger than input records, so split the
+    // remaining workspace evenly.
+    uintptr_t loadbuf_size = bigstack_left();
+    if (unlikely(loadbuf_size < kMaxMediumLine + 2 * kCacheline)) {
+      goto BcfSubset_ret_NOMEM;
+    }
+    loadbuf_size = RoundDownPow2((loadbuf_size - kMaxMediumLine) / 2 - kCacheline, kCacheline);
+#ifdef __LP64__
+    if (loadbuf_size > kMaxLongLine) {
+      loadbuf_size = kMaxLongLine;
+    }
+#endif
+    if (loadbuf_size < (1 << 18)) {
+      goto BcfSubset_ret_NOMEM;
+    }
+    unsigned char* loadbuf = S_CAST(unsigned char*, bigstack_alloc_raw(loadbuf_size));
+    const uintptr_t writebuf_size = loadbuf_size + kMaxMediumLine;
+    unsigned char* writebuf;
+    if (unlikely(bigstack_alloc_uc(writebuf_size, &writebuf))) {
+      goto BcfSubset_ret_NOMEM;
+    }
+    unsigned char* writebuf_flush = &(writebuf[kMaxMediumLine]);
+    unsigned char* write_iter = writebuf;
+    const uint32_t allow_extra_chrs = (misc_flags / kfMiscAllowExtraChrs) & 1;
+    uintptr_t variant_ct = 0;
+    fputs("--bcf-subset: 0 variant records scanned.", stdout);
+    fflush(stdout);
+    while (1) {
+      ++vrec_idx;
+      unsigned char* loadbuf_read_iter = loadbuf;
+      reterr = BgzfRawMtStreamRead(&(loadbuf[32]), &bgzf, &loadbuf_read_iter, &bgzf_errmsg);
+      if (unlikely(reterr)) {
+        goto BcfSubset_ret_BGZF_FAIL_N;
+      }
+      if (&(loadbuf[32]) != loadbuf_read_iter) {
+        if (likely(loadbuf_read_iter == loadbuf)) {
+          --vrec_idx;
+          break;
+        }
+        goto BcfSubset_ret_VREC_GENERIC;
+      }
+      uint32_t* vrec_header = R_CAST(uint32_t*, loadbuf);
+      // See BcfToPgen() regarding field order.
+      const uint32_t l_shared = vrec_header[0];
+      const uint32_t l_indiv = vrec_header[1];
+      const uint32_t chrom = vrec_header[2];
+      const uint32_t n_sample = vrec_header[7] & 0xffffff;
+      const uint32_t n_fmt = vrec_header[7] >> 24;
+      if (unlikely((l_shared < 24) || (chrom >= contig_ct) || (!contig_slens[chrom]) || (n_sample != raw_sample_ct))) {
+        goto BcfSubset_ret_VREC_GENERIC;
+      }
+      const uint64_t second_load_size = l_shared + S_CAST(uint64_t, l_indiv) - 24;
+      if (unlikely(second_load_size + 32 > loadbuf_size)) {
+        goto BcfSubset_ret_NOMEM;
+      }
+      unsigned char* vrec_end = &(loadbuf[32 + second_load_size]);
+      reterr = BgzfRawMtStreamRead(vrec_end, &bgzf, &loadbuf_read_iter, &bgzf_errmsg);
+      if (unlikely(reterr)) {
+        goto BcfSubset_ret_BGZF_FAIL_N;
+      }
+      if (unlikely(loadbuf_read_iter != vrec_end)) {
+        goto BcfSubset_ret_VREC_GENERIC;
+      }
+      if (!(vrec_idx % 1000)) {
+        printf("\r--bcf-subset: %" PRIuPTR "k variant records scanned.", vrec_idx / 1000);
+        fflush(stdout);
+      }
+      if (!IsSet(contig_seen, chrom)) {
+        uint32_t cur_chr_code;
+        reterr = GetOrAddChrCode(contig_names[chrom], "--bcf file", 0, contig_slens[chrom], allow_extra_chrs, cip, &cur_chr_code);
+        if (unlikely(reterr)) {
+          goto BcfSubset_ret_1;
+        }
+        SetBit(chrom, contig_seen);
+        if (IsSet(cip->chr_mask, cur_chr_code)) {
+          SetBit(chrom, contig_keep);
+        }
+      }
+      if (!IsSet(contig_keep, chrom)) {
+        continue;
+      }
+      unsigned char* shared_end = &(loadbuf[8 + l_shared]);
+      if (extract_fnames || exclude_fnames) {
+        const unsigned char* id_iter = &(loadbuf[32]);
+        const char* id_start;
+        uint32_t id_slen;
+        if (unlikely(ScanBcfTypedString(shared_end, &id_iter, &id_start, &id_slen))) {
+          goto BcfSubset_ret_VREC_GENERIC;
+        }
+        if (!id_slen) {
+          id_start = ".";
+          id_slen = 1;
+        }
+        if (extract_fnames && (!BcfSubsetIdSetContains(&extract_set, id_start, id_slen))) {
+          continue;
+        }
+        if (exclude_fnames && BcfSubsetIdSetContains(&exclude_set, id_start, id_slen)) {
+          continue;
+        }
+      }
+      if (write_iter >= writebuf_flush) {
+        if (unlikely(BgzfWrite(R_CAST(char*, writebuf), write_iter - writebuf, &bgzf_out))) {
+          goto BcfSubset_ret_WRITE_FAIL;
+        }
+        write_iter = writebuf;
+      }
+      ++variant_ct;
+      if (all_samples_kept) {
+        write_iter = memcpyua(write_iter, loadbuf, vrec_end - loadbuf);
+        continue;
+      }
+      unsigned char* record_start = write_iter;
+      write_iter = memcpyua(write_iter, loadbuf, shared_end - loadbuf);
+      unsigned char* indiv_start = write_iter;
+      uint32_t new_n_fmt = 0;
+      if (sample_ct) {
+        const unsigned char* parse_iter = shared_end;
+        for (uint32_t fmt_idx = 0; fmt_idx != n_fmt; ++fmt_idx) {
+          const unsigned char* key_start = parse_iter;
+          uint32_t sidx;
+          uint32_t value_type;
+          uint32_t value_ct;
+          if (unlikely(
+                  ScanBcfTypedInt(&parse_iter, &sidx) ||
+                  (parse_iter >= vrec_end) ||
+                  ScanBcfType(&parse_iter, &value_type, &value_ct) ||
+                  (parse_iter > vrec_end))) {
+            goto BcfSubset_ret_VREC_GENERIC;
+          }
+          const uint32_t bytes_per_elem = kBcfBytesPerElem[value_type];
+          const uint64_t entry_width = bytes_per_elem * S_CAST(uint64_t, value_ct);
+          if (unlikely((value_ct && (!bytes_per_elem)) || (entry_width * n_sample > S_CAST(uintptr_t, vrec_end - parse_iter)))) {
+            goto BcfSubset_ret_VREC_GENERIC;
+          }
+          write_iter = memcpyua(write_iter, key_start, parse_iter - key_start);
+          write_iter = BcfSubsetGather(parse_iter, kept_sample_idxs, run_starts, run_lens, sample_ct, run_ct, entry_width, write_iter);
+          parse_iter = &(parse_iter[entry_width * n_sample]);
+        }
+        new_n_fmt = n_fmt;
+      }
+      uint32_t* new_vrec_header = R_CAST(uint32_t*, record_start);
+      new_vrec_header[1] = write_iter - indiv_start;
+      new_vrec_header[7] = sample_ct | (new_n_fmt << 24);
+    }
+    if (unlikely(BgzfWrite(R_CAST(char*, writebuf), write_iter - writebuf, &bgzf_out))) {
+      goto BcfSubset_ret_WRITE_FAIL;
+    }
+    if (unlikely(CleanupBgzfCompressStream(&bgzf_out, &reterr))) {
+      goto BcfSubset_ret_WRITE_FAIL;
+    }
+    putc_unlocked('\r', stdout);
+    logprintfww("--bcf-subset: %u/%u sample%s and %" PRIuPTR "/%" PRIuPTR " variant%s written to %s .\n", sample_ct, raw_sample_ct, (raw_sample_ct == 1)? "" : "s", variant_ct, vrec_idx, (vrec_idx == 1)? "" : "s", outname);
+  }
+  while (0) {
+  BcfSubset_ret_NOMEM:
+    reterr = kPglRetNomem;
+    break;
+  BcfSubset_ret_OPEN_FAIL:
+    reterr = kPglRetOpenFail;
+    break;
+  BcfSubset_ret_WRITE_FAIL:
+    reterr = kPglRetWriteFail;
+    break;
+  BcfSubset_ret_BGZF_FAIL_N:
+    putc_unlocked('\n', stdout);
+  BcfSubset_ret_BGZF_FAIL:
+    if (reterr == kPglRetReadFail) {
+      logerrprintfww(kErrprintfFread, bcfname, rstrerror(errno));
+    } else if (reterr == kPglRetDecompressFail) {
+      logerrprintfww(kErrprintfDecompress, bcfname, bgzf_errmsg);
+    }
+    break;
+  BcfSubset_ret_VREC_GENERIC:
+    putc_unlocked('\n', stdout);
+    logerrprintf("Error: Variant record #%" PRIuPTR " of --bcf file is malformed.\n", vrec_idx);
+    reterr = kPglRetMalformedInput;
+    break;
+  BcfSubset_ret_MALFORMED_INPUT:
+    reterr = kPglRetMalformedInput;
+    break;
+  BcfSubset_ret_MALFORMED_INPUT_WW:
+    WordWrapB(0);
+    logerrputsb();
+    reterr = kPglRetMalformedInput;
+    break;
+  BcfSubset_ret_MALFORMED_INPUT_GENERIC:
+    logerrputs("Error: Malformed BCF file.\n");
+    reterr = kPglRetMalformedInput;
+    break;
+  BcfSubset_ret_MALFORMED_TEXT_HEADER:
+    logerrputs("Error: Malformed BCF text header block.\n");
+    reterr = kPglRetMalformedInput;
+    break;
+  }
+ BcfSubset_ret_1:
+  CleanupBgzfCompressStream(&bgzf_out, &reterr);
+  CleanupBgzfRawMtStream(&bgzf);
+  fclose_cond(bcffile);
+  BigstackDoubleReset(bigstack_mark, bigstack_end_mark);
+  return reterr;
+}
+
+PglErr OxSampleToPsam(const char* samplename, const char* ox_missing_code, ImportFlags import_flags, char* outname, char* outname_end, uint32_t* sample_ct_ptr) {
+  unsigned char* bigstack_mark = g_bigstack_base;
+  FILE* psamfile = nullptr;
+  PglErr reterr = kPglRetSuccess;
+  uintptr_t line_idx = 0;
+  TextStream sample_txs;
+  PreinitTextStream(&sample_txs);
+  {
+    uint32_t omp_slen = 2;
+    char output_missing_pheno[kMaxMissingPhenostrBlen];
+    if (import_flags & kfImportKeepAutoconv) {
+      // must use --output-missing-phenotype parameter, which we've validated
+      // to be consistent with --input-missing-phenotype
+      omp_slen = strlen(g_output_missing_pheno);
+      memcpy(output_missing_pheno, g_output_missing_pheno, omp_slen);
+    } else {
+      // use "NA" since that's always safe
+      memcpy_k(output_missing_pheno, "NA", 2);
+    }
+    const char* missing_catname = g_missing_catname;
+    uint32_t missing_catname_slen = strlen(missing_catname);
+
+    uint32_t max_line_blen;
+    if (unlikely(StandardizeMaxLineBlen(bigstack_left() / 4, &max_line_blen))) {
+      goto OxSampleToPsam_ret_NOMEM;
+    }
+    reterr = InitTextStream(samplename, max_line_blen, 1, &sample_txs);
+    if (unlikely(reterr)) {
+      if (reterr == kPglRetOpenFail) {
+        const uint32_t slen = strlen(samplename);
+        if ((!StrEndsWith(samplename, ".sample", slen)) &&
+            (!StrEndsWith(samplename, ".sample.gz", slen))) {
+          logerrprintfww("Error: Failed to open %s : %s. (--sample expects a complete filename; did you forget '.sample' at the end?)\n", samplename, strerror(errno));
+          goto OxSampleToPsam_ret_1;
+        }
+      }
+      goto OxSampleToPsam_ret_TSTREAM_FAIL;
+    }
+    uint32_t mc_ct = 0;
+    uintptr_t max_mc_blen = 1;
+    char* sorted_mc = nullptr;
+    if (!ox_missing_code) {
+      if (unlikely(bigstack_alloc_c(3, &sorted_mc))) {
+        goto OxSampleToPsam_ret_NOMEM;
+      }
+      strcpy_k(sorted_mc, "NA");
+      mc_ct = 1;
+      max_mc_blen = 3;
+    } else {
+      // er, this should use something like
+      // CountAndMeasureMultistrReverseAlloc()...
+      const char* missing_code_iter = ox_missing_code;
+      while (*missing_code_iter) {
+        while (*missing_code_iter == ',') {
+          ++missing_code_iter;
+        }
+        if (!(*missing_code_iter)) {
+          break;
+        }
+        ++mc_ct;
+        const char* token_end = strchrnul(missing_code_iter, ',');
+        uintptr_t token_slen = token_end - missing_code_iter;
+        if (token_slen >= max_mc_blen) {
+          max_mc_blen = token_slen + 1;
+        }
+        missing_code_iter = token_end;
+      }
+      if (mc_ct) {
+        if (unlikely(bigstack_alloc_c(mc_ct * max_mc_blen, &sorted_mc))) {
+          goto OxSampleToPsam_ret_NOMEM;
+        }
+        missing_code_iter = ox_missing_code;
+        for (uintptr_t mc_idx = 0; mc_idx != mc_ct; ++mc_idx) {
+          while (*missing_code_iter == ',') {
+            ++missing_code_iter;
+          }
+          const char* token_end = strchrnul(missing_code_iter, ',');
+          uintptr_t token_slen = token_end - missing_code_iter;
+          memcpyx(&(sorted_mc[mc_idx * max_mc_blen]), missing_code_iter, token_slen, '\0');
+          missing_code_iter = token_end;
+        }
+        // this was temporarily broken in June 2018 due to first
+        // strcmp_overread() implementation returning 0 instead of -1 on
+        // less-than
+        qsort(sorted_mc, mc_ct, max_mc_blen, strcmp_overread_casted);
+      }
+    }
+
+    // New first pass: check whether, from the third line on, all first tokens
+    // are '0'.  If yes, we omit FID from the output.
+    uint32_t write_fid = 0;
+    uint32_t header_lines_left = 2;
+    while (1) {
+      ++line_idx;
+      char* line_start = TextGet(&sample_txs);
+      if (!line_start) {
+        // bugfix (16 Feb 2018): don't check this if we break out of the loop
+        // on non-0 FID
+        if (unlikely(TextStreamErrcode2(&sample_txs, &reterr))) {
+          goto OxSampleToPsam_ret_TSTREAM_FAIL;
+        }
+        if (unlikely(header_lines_left)) {
+          logerrputs("Error: Empty .sample file.\n");
+          goto OxSampleToPsam_ret_MALFORMED_INPUT;
+        }
+        break;
+      }
+      if (header_lines_left) {
+        --header_lines_left;
+        continue;
+      }
+      if ((line_start[0] != '0') || (!IsSpaceOrEoln(line_start[1]))) {
+        write_fid = 1;
+        break;
+      }
+    }
+    reterr = TextRewind(&sample_txs);
+    if (unlikely(reterr)) {
+      goto OxSampleToPsam_ret_TSTREAM_FAIL;
+    }
+    line_idx = 1;
+    char* line_start = TextGet(&sample_txs);
+    if (unlikely(!line_start)) {
+      reterr = TextStreamRawErrcode(&sample_txs);
+      goto OxSampleToPsam_ret_TSTREAM_REWIND_FAIL;
+    }
+    char* token_end = CurTokenEnd(line_start);
+    // todo: allow arbitrary first column name, and ID_2/missing to be absent,
+    // to match SNPTEST 2.5.4's de facto change to the .sample file format.
+    // (Probably wait till 2.5.4 is a stable version, though.)
+    if (unlikely(!strequal_k(line_start, "ID_1", token_end - line_start))) {
+      goto OxSampleToPsam_ret_INVALID_SAMPLE_HEADER_1;
+    }
+    // currently accepts tab as delimiter, though .sample spec technically
+    // prohibits that
+    char* linebuf_iter = FirstNonTspace(token_end);
+    uint32_t token_slen = strlen_se(linebuf_iter);
+    if (unlikely(!strequal_k(linebuf_iter, "ID_2", token_slen))) {
+      goto OxSampleToPsam_ret_INVALID_SAMPLE_HEADER_1;
+    }
+    linebuf_iter = FirstNonTspace(&(linebuf_iter[token_slen]));
+    token_slen = strlen_se(linebuf_iter);
+    if (unlikely(!MatchUpperKLen(linebuf_iter, "MISSING", token_slen))) {
+      goto OxSampleToPsam_ret_INVALID_SAMPLE_HEADER_1;
+    }
+    linebuf_iter = FirstNonTspace(&(linebuf_iter[token_slen]));
+
+    snprintf(outname_end, kMaxOutfnameExtBlen, ".psam");
+    if (unlikely(fopen_checked(outname, FOPEN_WB, &psamfile))) {
+      goto OxSampleToPsam_ret_OPEN_FAIL;
+    }
+    // categorical phenotypes are lengthened by 1 character ('C' added in
+    // front), so this needs to be 50% larger than maximum possible line length
+    // to handle worst case
+    uintptr_t linebuf_size = max_line_blen + kDecompressChunkSize;
+    linebuf_size += linebuf_size / 2;
+    // bugfix (19 Mar 2018): this needs to be min, not max...
+    linebuf_size = MINV(linebuf_size, kMaxLongLine);
+    char* writebuf;
+    if (unlikely(bigstack_alloc_c(linebuf_size, &writebuf))) {
+      goto OxSampleToPsam_ret_NOMEM;
+    }
+    char* write_iter = writebuf;
+    *write_iter++ = '#';
+    if (write_fid) {
+      write_iter = strcpya_k(write_iter, "FID\t");
+    }
+    write_iter = strcpya_k(write_iter, "IID\tSEX");
+
+    // 0 = not present, otherwise zero-based index (this is fine since first
+    //     column has to be FID)
+    uint32_t sex_col = 0;
+
+    uint32_t col_ct = 3;
+
+    while (!IsEolnKns(*linebuf_iter)) {
+      token_end = CurTokenEnd(linebuf_iter);
+      token_slen = token_end - linebuf_iter;
+      if (MatchUpperKLen(linebuf_iter, "SEX", token_slen)) {
+        if (unlikely(sex_col)) {
+          logerrputs("Error: Multiple sex columns in .sample file.\n");
+          goto OxSampleToPsam_ret_MALFORMED_INPUT;
+        }
+        sex_col = col_ct;
+      }
       ++col_ct;
       linebuf_iter = FirstNonTspace(token_end);
     }
@@ -9587,6 +11266,194 @@ BoolErr InitOxfordSingleChr(const char* ox_single_chr_str, const char** single_c
   return 0;
 }
 
+ENUM_U31_DEF_START()
+  kOxGenParseOk,
+  kOxGenParseMissingTokens,
+  kOxGenParseInvalidDosage
+ENUM_U31_DEF_END(OxGenParseErr);
+
+// linebuf_iter must point to the beginning of the first genotype triplet.
+// Genotypes are saved in ALT-first order; caller is responsible for
+// inverting them if necessary.
+OxGenParseErr OxGenConvertLine(const char* linebuf_iter, uint32_t sample_ct, uint32_t dosage_int_sum_thresh, uint32_t import_dosage_certainty_int, uint32_t hard_call_halfdist, uint32_t dosage_erase_halfdist, uintptr_t* genovec, uintptr_t* dosage_present, Dosage* dosage_main, uint32_t* dosage_ct_ptr) {
+  const uint32_t sample_ctl2_m1 = NypCtToWordCt(sample_ct) - 1;
+  uint32_t inner_loop_last = kBitsPerWordD2 - 1;
+  Dosage* dosage_main_iter = dosage_main;
+  for (uint32_t widx = 0; ; ++widx) {
+    if (widx >= sample_ctl2_m1) {
+      if (widx > sample_ctl2_m1) {
+        break;
+      }
+      inner_loop_last = (sample_ct - 1) % kBitsPerWordD2;
+    }
+    uintptr_t genovec_word = 0;
+    uint32_t dosage_present_hw = 0;
+    for (uint32_t sample_idx_lowbits = 0; sample_idx_lowbits <= inner_loop_last; ++sample_idx_lowbits) {
+      linebuf_iter = FirstNonTspace(linebuf_iter);
+      const char cc = *linebuf_iter;
+      if (unlikely(IsEolnKns(cc))) {
+        return kOxGenParseMissingTokens;
+      }
+      char cc2 = linebuf_iter[1];
+      if ((cc2 == ' ') || (cc2 == '\t')) {
+        cc2 = linebuf_iter[3];
+        if (((cc2 == ' ') || (cc2 == '\t')) && (ctou32(linebuf_iter[5]) <= 32)) {
+          const uint32_t uii = ctou32(cc) - 48;
+          const uint32_t ujj = ctou32(linebuf_iter[2]) - 48;
+          const uint32_t ukk = ctou32(linebuf_iter[4]) - 48;
+          const uint32_t all_or = uii | ujj | ukk;
+          if (all_or < 2) {
+            if (!all_or) {
+              genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
+              linebuf_iter = &(linebuf_iter[5]);
+              continue;
+            }
+            if (uii + ujj + ukk == 1) {
+              uintptr_t cur_geno = ukk * 2 + ujj;
+              genovec_word |= cur_geno << (2 * sample_idx_lowbits);
+              linebuf_iter = &(linebuf_iter[5]);
+              continue;
+            }
+          }
+        }
+      }
+      double prob_0alt;
+      const char* first_dosage_str_end = ScanadvDouble(linebuf_iter, &prob_0alt);
+      if (!first_dosage_str_end) {
+        // ignore next two tokens if first token in triplet is not numeric,
+        // since we treat this as missing regardless
+        linebuf_iter = NextTokenMult(linebuf_iter, 2);
+        if (unlikely(!linebuf_iter)) {
+          return kOxGenParseMissingTokens;
+        }
+        genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
+        linebuf_iter = CurTokenEnd(linebuf_iter);
+        continue;
+      }
+      if (unlikely(ctou32(*first_dosage_str_end) > ' ')) {
+        return kOxGenParseInvalidDosage;
+      }
+      linebuf_iter = FirstNonTspace(first_dosage_str_end);
+      if (unlikely(IsEolnKns(*linebuf_iter))) {
+        return kOxGenParseMissingTokens;
+      }
+      double prob_1alt;
+      linebuf_iter = ScantokDouble(linebuf_iter, &prob_1alt);
+      if (unlikely(!linebuf_iter)) {
+        return kOxGenParseInvalidDosage;
+      }
+      linebuf_iter = FirstNonTspace(linebuf_iter);
+      if (unlikely(IsEolnKns(*linebuf_iter))) {
+        return kOxGenParseMissingTokens;
+      }
+      double prob_2alt;
+      linebuf_iter = ScantokDouble(linebuf_iter, &prob_2alt);
+      if (unlikely(!linebuf_iter)) {
+        return kOxGenParseInvalidDosage;
+      }
+      // bugfix
+      prob_0alt *= 32768;
+      prob_1alt *= 32768;
+      prob_2alt *= 32768;
+
+      if (unlikely((prob_0alt < 0.0) || (prob_0alt >= 65535.4999999999) || (prob_1alt < 0.0) || (prob_1alt >= 65535.4999999999) || (prob_2alt < 0.0) || (prob_2alt >= 65535.4999999999))) {
+        return kOxGenParseInvalidDosage;
+      }
+      const uint32_t dosage_int0 = S_CAST(int32_t, prob_0alt + 0.5);
+      const uint32_t dosage_int1 = S_CAST(int32_t, prob_1alt + 0.5);
+      const uint32_t dosage_int2 = S_CAST(int32_t, prob_2alt + 0.5);
+      Bgen11DosageImportUpdate(dosage_int_sum_thresh, import_dosage_certainty_int, hard_call_halfdist, dosage_erase_halfdist, sample_idx_lowbits, dosage_int0, dosage_int1, dosage_int2, &genovec_word, &dosage_present_hw, &dosage_main_iter);
+    }
+    genovec[widx] = genovec_word;
+    R_CAST(Halfword*, dosage_present)[widx] = dosage_present_hw;
+  }
+  *dosage_ct_ptr = dosage_main_iter - dosage_main;
+  return kOxGenParseOk;
+}
+
+typedef struct OxGenToPgenCtxStruct {
+  uint32_t sample_ct;
+  uint32_t dosage_int_sum_thresh;
+  uint32_t import_dosage_certainty_int;
+  uint32_t hard_call_halfdist;
+  uint32_t dosage_erase_halfdist;
+  uint32_t prov_ref_allele_second;
+
+  unsigned char** thread_wkspaces;
+
+  // gparse_buf_ct (2 or kGparseMaxBufCt) sets of these are cycled through
+  uint32_t* thread_bidxs[kGparseMaxBufCt];
+  GparseRecord* gparse[kGparseMaxBufCt];
+  uint32_t gparse_buf_ct;
+
+  OxGenParseErr* ox_gen_parse_errs;
+  uintptr_t* err_line_idxs;
+  uint32_t parse_failed;
+} OxGenToPgenCtx;
+
+THREAD_FUNC_DECL OxGenToPgenThread(void* raw_arg) {
+  ThreadGroupFuncArg* arg = S_CAST(ThreadGroupFuncArg*, raw_arg);
+  const uintptr_t tidx = arg->tidx;
+  OxGenToPgenCtx* ctx = S_CAST(OxGenToPgenCtx*, arg->sharedp->context);
+
+  const uint32_t sample_ct = ctx->sample_ct;
+  const uint32_t dosage_int_sum_thresh = ctx->dosage_int_sum_thresh;
+  const uint32_t import_dosage_certainty_int = ctx->import_dosage_certainty_int;
+  const uint32_t hard_call_halfdist = ctx->hard_call_halfdist;
+  const uint32_t dosage_erase_halfdist = ctx->dosage_erase_halfdist;
+  const uint32_t prov_ref_allele_second = ctx->prov_ref_allele_second;
+  const uintptr_t genovec_byte_ct = NypCtToVecCt(sample_ct) * kBytesPerVec;
+  // The thread workspace always has room for the dosage track, since
+  // OxGenConvertLine() unconditionally fills dosage_present.  (dosage_main is
+  // only written to if the first pass found a dosage to keep.)
+  unsigned char* thread_wkspace = ctx->thread_wkspaces[tidx];
+  uintptr_t* genovec = R_CAST(uintptr_t*, thread_wkspace);
+  uintptr_t* dosage_present = R_CAST(uintptr_t*, &(thread_wkspace[genovec_byte_ct]));
+  Dosage* dosage_main = R_CAST(Dosage*, &(dosage_present[BitCtToAlignedWordCt(sample_ct)]));
+  uint32_t buf_idx = 0;
+  OxGenParseErr ox_gen_parse_err = kOxGenParseOk;
+  uintptr_t line_idx = 0;
+  // OxGenConvertLine() writes dosage_present one halfword at a time
+  dosage_present[BitCtToWordCt(sample_ct) - 1] = 0;
+  do {
+    const uint32_t bidx_end = ctx->thread_bidxs[buf_idx][tidx + 1];
+    GparseRecord* cur_gparse = ctx->gparse[buf_idx];
+    for (uint32_t bidx = ctx->thread_bidxs[buf_idx][tidx]; bidx != bidx_end; ++bidx) {
+      GparseRecord* grp = &(cur_gparse[bidx]);
+      unsigned char* record_start = grp->record_start;
+      line_idx = grp->metadata.read_text.line_idx;
+      uint32_t dosage_ct;
+      ox_gen_parse_err = OxGenConvertLine(R_CAST(char*, record_start), sample_ct, dosage_int_sum_thresh, import_dosage_certainty_int, hard_call_halfdist, dosage_erase_halfdist, genovec, dosage_present, dosage_main, &dosage_ct);
+      if (unlikely(ox_gen_parse_err)) {
+        goto OxGenToPgenThread_malformed;
+      }
+      if (prov_ref_allele_second) {
+        GenovecInvertUnsafe(sample_ct, genovec);
+        ZeroTrailingNyps(sample_ct, genovec);
+        if (dosage_ct) {
+          BiallelicDosage16Invert(dosage_ct, dosage_main);
+        }
+      }
+      memcpy(record_start, thread_wkspace, GparseWriteByteCt(sample_ct, 2, grp->flags));
+      GparseWriteMetadata* gwmp = &(grp->metadata.write);
+      gwmp->phasepresent_exists = 0;
+      gwmp->dosage_ct = dosage_ct;
+      gwmp->dphase_ct = 0;
+    }
+    while (0) {
+    OxGenToPgenThread_malformed:
+      ctx->ox_gen_parse_errs[tidx] = ox_gen_parse_err;
+      ctx->err_line_idxs[tidx] = line_idx;
+      ctx->parse_failed = 1;
+      break;
+    }
+    if (++buf_idx == ctx->gparse_buf_ct) {
+      buf_idx = 0;
+    }
+  } while (!THREAD_BLOCK_FINISH(arg));
+  THREAD_RETURN;
+}
+
 static_assert(sizeof(Dosage) == 2, "OxGenToPgen() needs to be updated.");
 PglErr OxGenToPgen(const char* genname, const char* samplename, const char* ox_single_chr_str, const char* ox_missing_code, MiscFlags misc_flags, ImportFlags import_flags, OxfordImportFlags oxford_import_flags, uint32_t hard_call_thresh, uint32_t dosage_erase_thresh, double import_dosage_certainty, uint32_t max_thread_ct, char* outname, char* outname_end, ChrInfo* cip) {
   unsigned char* bigstack_mark = g_bigstack_base;
@@ -9599,6 +11466,13 @@ PglErr OxGenToPgen(const char* genname, const char* samplename, const char* ox_s
   STPgenWriter spgw;
   PreinitTextStream(&gen_txs);
   PreinitSpgw(&spgw);
+  ThreadGroup tg;
+  PreinitThreads(&tg);
+  OxGenToPgenCtx ctx;
+  ThreadGroup flush_tg;
+  PreinitThreads(&flush_tg);
+  GparseFlushCtx flush_ctx;
+  InitGparseFlush(&spgw, &flush_ctx);
   {
     uint32_t sample_ct;
     reterr = OxSampleToPsam(samplename, ox_missing_code, import_flags, outname, outname_end, &sample_ct);
@@ -9679,6 +11553,7 @@ PglErr OxGenToPgen(const char* genname, const char* samplename, const char* ox_s
     const uint32_t prov_ref_allele_second = !(oxford_import_flags & kfOxfordImportRefFirst);
     uint32_t dosage_is_present = 0;
     uint32_t variant_ct = 0;
+    uintptr_t max_genotext_blen = 0;
     uintptr_t variant_skip_ct = 0;
     char* line_iter = TextLineEnd(&gen_txs);
     ++line_idx;
@@ -9749,6 +11624,7 @@ PglErr OxGenToPgen(const char* genname, const char* samplename, const char* ox_s
         goto OxGenToPgen_ret_MISSING_TOKENS;
       }
       const char* linebuf_iter = CurTokenEnd(second_allele_str);
+      const char* genotext_start = linebuf_iter;
       if (!prov_ref_allele_second) {
         pvar_cswritep = memcpyax(pvar_cswritep, first_allele_str, first_allele_end - first_allele_str, '\t');
         pvar_cswritep = memcpya(pvar_cswritep, second_allele_str, linebuf_iter - second_allele_str);
@@ -9840,6 +11716,10 @@ PglErr OxGenToPgen(const char* genname, const char* samplename, const char* ox_s
         fflush(stdout);
       }
       line_iter = AdvPastDelim(K_CAST(char*, linebuf_iter), '\n');
+      const uintptr_t genotext_blen = line_iter - genotext_start;
+      if (genotext_blen > max_genotext_blen) {
+        max_genotext_blen = genotext_blen;
+      }
     }
     if (unlikely(TextStreamErrcode2(&gen_txs, &reterr))) {
       goto OxGenToPgen_ret_TSTREAM_FAIL;
@@ -9878,6 +11758,14 @@ PglErr OxGenToPgen(const char* genname, const char* samplename, const char* ox_s
       }
     }
 
+    // .gen triplet parsing is about as expensive as VCF DS parsing
+    uint32_t calc_thread_ct = 1 + (sample_ct > 5) + (sample_ct > 12) + (sample_ct > 32) + (sample_ct > 512);
+    // reserve a thread for background .pgen writing when possible
+    const uint32_t flush_thread_ct = (max_thread_ct > 2);
+    if (calc_thread_ct + 1 + flush_thread_ct > max_thread_ct) {
+      calc_thread_ct = MAXV(1, max_thread_ct - 1 - flush_thread_ct);
+    }
+
     snprintf(outname_end, kMaxOutfnameExtBlen, ".pgen");
     uintptr_t spgw_alloc_cacheline_ct;
     uint32_t max_vrec_len;
@@ -9894,160 +11782,202 @@ PglErr OxGenToPgen(const char* genname, const char* samplename, const char* ox_s
     }
     SpgwInitPhase2(max_vrec_len, &spgw, spgw_alloc);
 
-    const uint32_t sample_ctl2 = NypCtToWordCt(sample_ct);
-    const uint32_t sample_ctl = BitCtToWordCt(sample_ct);
-    uintptr_t* genovec;
-    uintptr_t* dosage_present;
-    // if we weren't using bigstack_alloc, this would need to be sample_ctaw2
+    const uint32_t gparse_buf_ct = GparseFlushSetBackground(flush_thread_ct, &flush_ctx, &flush_tg);
+    ctx.gparse_buf_ct = gparse_buf_ct;
     if (unlikely(
-            bigstack_alloc_w(sample_ctl2, &genovec) ||
-            bigstack_alloc_w(sample_ctl, &dosage_present))) {
+            bigstack_alloc_ucp(calc_thread_ct, &ctx.thread_wkspaces) ||
+            bigstack_calloc_w(calc_thread_ct, &ctx.err_line_idxs))) {
       goto OxGenToPgen_ret_NOMEM;
     }
-    Dosage* dosage_main = nullptr;
-    if (dosage_is_present) {
-      if (unlikely(bigstack_alloc_dosage(sample_ct, &dosage_main))) {
+    for (uint32_t buf_idx = 0; buf_idx != gparse_buf_ct; ++buf_idx) {
+      if (unlikely(bigstack_alloc_u32(calc_thread_ct + 1, &(ctx.thread_bidxs[buf_idx])))) {
         goto OxGenToPgen_ret_NOMEM;
       }
     }
+    ctx.ox_gen_parse_errs = S_CAST(OxGenParseErr*, bigstack_alloc_raw_rd(calc_thread_ct * sizeof(OxGenParseErr)));
+    if (unlikely(!ctx.ox_gen_parse_errs)) {
+      goto OxGenToPgen_ret_NOMEM;
+    }
     if (hard_call_thresh == UINT32_MAX) {
       hard_call_thresh = kDosageMid / 10;
     }
-    const uint32_t hard_call_halfdist = kDosage4th - hard_call_thresh;
-    const uint32_t sample_ctl2_m1 = sample_ctl2 - 1;
-    const uintptr_t line_ct = line_idx - 1;
-    uint32_t vidx = 0;
-    line_iter = TextLineEnd(&gen_txs);
-    for (line_idx = 1; line_idx <= line_ct; ++line_idx) {
-      reterr = TextGetUnsafe(&gen_txs, &line_iter);
-      if (unlikely(reterr)) {
-        goto OxGenToPgen_ret_TSTREAM_FAIL;
-      }
-      char* chr_code_str = line_iter;
-      char* chr_code_end = CurTokenEnd(chr_code_str);
-      if (variant_skip_ct) {
-        *chr_code_end = '\0';
-        const uint32_t chr_code = GetChrCode(chr_code_str, cip, chr_code_end - chr_code_str);
-        if (!IsSet(cip->chr_mask, chr_code)) {
-          line_iter = AdvPastDelim(chr_code_end, '\n');
-          continue;
-        }
+    ctx.sample_ct = sample_ct;
+    ctx.dosage_int_sum_thresh = dosage_int_sum_thresh;
+    ctx.import_dosage_certainty_int = import_dosage_certainty_int;
+    ctx.hard_call_halfdist = kDosage4th - hard_call_thresh;
+    ctx.dosage_erase_halfdist = dosage_erase_halfdist;
+    ctx.prov_ref_allele_second = prov_ref_allele_second;
+    ctx.parse_failed = 0;
+    for (uint32_t buf_idx = 0; buf_idx != kGparseMaxBufCt; ++buf_idx) {
+      // defensive
+      ctx.gparse[buf_idx] = nullptr;
+    }
+    const GparseFlags gparse_flags = dosage_is_present? kfGparseDosage : kfGparse0;
+    // Thread workspaces always have room for dosage_present/dosage_main, see
+    // OxGenToPgenThread().
+    const uintptr_t write_byte_ct = GparseWriteByteCt(sample_ct, 2, gparse_flags);
+    const uintptr_t thread_wkspace_cl_ct = DivUp(GparseWriteByteCt(sample_ct, 2, kfGparseDosage), kCacheline);
+    uintptr_t cachelines_avail = bigstack_left() / (6 * kCacheline);
+    if (calc_thread_ct * thread_wkspace_cl_ct > cachelines_avail) {
+      if (unlikely(thread_wkspace_cl_ct > cachelines_avail)) {
+        goto OxGenToPgen_ret_NOMEM;
       }
-      const char* linebuf_iter = NextTokenMult(FirstNonTspace(&(chr_code_end[1])), 4);
-      uint32_t inner_loop_last = kBitsPerWordD2 - 1;
-      Dosage* dosage_main_iter = dosage_main;
-      for (uint32_t widx = 0; ; ++widx) {
-        if (widx >= sample_ctl2_m1) {
-          if (widx > sample_ctl2_m1) {
-            break;
-          }
-          inner_loop_last = (sample_ct - 1) % kBitsPerWordD2;
+      calc_thread_ct = cachelines_avail / thread_wkspace_cl_ct;
+    }
+    for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
+      ctx.thread_wkspaces[tidx] = S_CAST(unsigned char*, bigstack_alloc_raw(thread_wkspace_cl_ct * kCacheline));
+      ctx.ox_gen_parse_errs[tidx] = kOxGenParseOk;
+    }
+
+    // be pessimistic re: rounding
+    cachelines_avail = (bigstack_left() / kCacheline) - 4;
+    const uint64_t max_bytes_req_per_variant = sizeof(GparseRecord) + MAXV(max_genotext_blen + kBytesPerVec, write_byte_ct) + calc_thread_ct;
+    if (unlikely(cachelines_avail * kCacheline < gparse_buf_ct * max_bytes_req_per_variant)) {
+      goto OxGenToPgen_ret_NOMEM;
+    }
+    // Each genotype triplet occupies at least 6 bytes of text.
+    const uintptr_t min_bytes_req_per_variant = sizeof(GparseRecord) + MAXV(write_byte_ct, 6 * sample_ct);
+    uint32_t main_block_size = (cachelines_avail * kCacheline) / (min_bytes_req_per_variant * gparse_buf_ct);
+    if (main_block_size > 65536) {
+      main_block_size = 65536;
+    }
+    // divide by 2 for better parallelism in small-variant-count case
+    if (main_block_size > DivUp(variant_ct, 2)) {
+      main_block_size = DivUp(variant_ct, 2) + calc_thread_ct - 1;
+    }
+    const uint32_t per_thread_block_limit = main_block_size / calc_thread_ct;
+    main_block_size = per_thread_block_limit * calc_thread_ct;
+    if (unlikely(SetThreadCt(calc_thread_ct, &tg))) {
+      goto OxGenToPgen_ret_NOMEM;
+    }
+    for (uint32_t buf_idx = 0; buf_idx != gparse_buf_ct; ++buf_idx) {
+      ctx.gparse[buf_idx] = S_CAST(GparseRecord*, bigstack_alloc_raw_rd(main_block_size * sizeof(GparseRecord)));
+    }
+    SetThreadFuncAndData(OxGenToPgenThread, &ctx, &tg);
+    unsigned char* geno_bufs[kGparseMaxBufCt];
+    cachelines_avail = bigstack_left() / (kCacheline * gparse_buf_ct);
+    for (uint32_t buf_idx = 0; buf_idx != gparse_buf_ct; ++buf_idx) {
+      geno_bufs[buf_idx] = S_CAST(unsigned char*, bigstack_alloc_raw(cachelines_avail * kCacheline));
+    }
+    const uintptr_t per_thread_byte_limit = (cachelines_avail * kCacheline) / calc_thread_ct;
+
+    // Same block pipeline as VcfToPgen(): while the worker threads convert
+    // block n, we load block (n+1) and write block (n-1).
+    uint32_t prev_block_write_ct = 0;
+    const char* genotext_start = nullptr;
+    uintptr_t genotext_byte_ct = 0;
+    uintptr_t record_byte_ct = 0;
+    uint32_t buf_idx = 0;
+    line_iter = TextLineEnd(&gen_txs);
+    line_idx = 0;
+    for (uint32_t vidx_start = 0; ; ) {
+      uint32_t cur_block_write_ct = 0;
+      if (!IsLastBlock(&tg)) {
+        const uint32_t block_vidx_limit = variant_ct - vidx_start;
+        uint32_t cur_thread_block_vidx_limit = MINV(block_vidx_limit, per_thread_block_limit);
+        uint32_t cur_thread_fill_idx = 0;
+        uint32_t* thread_bidxs = ctx.thread_bidxs[buf_idx];
+        GparseRecord* cur_gparse = ctx.gparse[buf_idx];
+        unsigned char* geno_buf_iter = geno_bufs[buf_idx];
+        unsigned char* cur_thread_byte_stop = &(geno_buf_iter[per_thread_byte_limit]);
+        thread_bidxs[0] = 0;
+        uint32_t block_vidx = 0;
+        if (!genotext_byte_ct) {
+          goto OxGenToPgen_load_start;
         }
-        uintptr_t genovec_word = 0;
-        uint32_t dosage_present_hw = 0;
-        for (uint32_t sample_idx_lowbits = 0; sample_idx_lowbits <= inner_loop_last; ++sample_idx_lowbits) {
-          linebuf_iter = FirstNonTspace(linebuf_iter);
-          const char cc = *linebuf_iter;
-          if (unlikely(IsEolnKns(cc))) {
-            goto OxGenToPgen_ret_MISSING_TOKENS;
-          }
-          char cc2 = linebuf_iter[1];
-          if ((cc2 == ' ') || (cc2 == '\t')) {
-            cc2 = linebuf_iter[3];
-            if (((cc2 == ' ') || (cc2 == '\t')) && (ctou32(linebuf_iter[5]) <= 32)) {
-              const uint32_t uii = ctou32(cc) - 48;
-              const uint32_t ujj = ctou32(linebuf_iter[2]) - 48;
-              const uint32_t ukk = ctou32(linebuf_iter[4]) - 48;
-              const uint32_t all_or = uii | ujj | ukk;
-              if (all_or < 2) {
-                if (!all_or) {
-                  genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
-                  linebuf_iter = &(linebuf_iter[5]);
-                  continue;
-                }
-                if (uii + ujj + ukk == 1) {
-                  uintptr_t cur_geno = ukk * 2 + ujj;
-                  genovec_word |= cur_geno << (2 * sample_idx_lowbits);
-                  linebuf_iter = &(linebuf_iter[5]);
-                  continue;
-                }
+        // we may stop before main_block_size due to insufficient space in
+        // geno_bufs[buf_idx].  if so, we copy over the genotype part of the
+        // current line before proceeding.
+        while (1) {
+          {
+            GparseRecord* grp = &(cur_gparse[block_vidx]);
+            grp->record_start = geno_buf_iter;
+            grp->flags = gparse_flags;
+            grp->metadata.read_text.line_idx = line_idx;
+            memcpy(geno_buf_iter, genotext_start, genotext_byte_ct);
+            geno_buf_iter = &(geno_buf_iter[record_byte_ct]);
+            ++block_vidx;
+            if (block_vidx == block_vidx_limit) {
+              for (; cur_thread_fill_idx != calc_thread_ct; ) {
+                thread_bidxs[++cur_thread_fill_idx] = block_vidx;
               }
+              break;
             }
           }
-          double prob_0alt;
-          const char* first_dosage_str_end = ScanadvDouble(linebuf_iter, &prob_0alt);
-          if (!first_dosage_str_end) {
-            // ignore next two tokens if first token in triplet is not numeric,
-            // since we treat this as missing regardless
-            linebuf_iter = NextTokenMult(linebuf_iter, 2);
-            if (unlikely(!linebuf_iter)) {
+        OxGenToPgen_load_start:
+          do {
+            ++line_idx;
+            reterr = TextGetUnsafe(&gen_txs, &line_iter);
+            if (unlikely(reterr)) {
+              goto OxGenToPgen_ret_TSTREAM_FAIL;
+            }
+            char* chr_code_str = line_iter;
+            char* chr_code_end = CurTokenEnd(chr_code_str);
+            if (variant_skip_ct) {
+              *chr_code_end = '\0';
+              const uint32_t chr_code = GetChrCode(chr_code_str, cip, chr_code_end - chr_code_str);
+              if (!IsSet(cip->chr_mask, chr_code)) {
+                line_iter = AdvPastDelim(chr_code_end, '\n');
+                continue;
+              }
+            }
+            genotext_start = NextTokenMult(FirstNonTspace(&(chr_code_end[1])), 4);
+            if (unlikely(!genotext_start)) {
               goto OxGenToPgen_ret_MISSING_TOKENS;
             }
-            genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
-            linebuf_iter = CurTokenEnd(linebuf_iter);
-            continue;
-          }
-          if (unlikely(ctou32(*first_dosage_str_end) > ' ')) {
-            goto OxGenToPgen_ret_INVALID_DOSAGE;
-          }
-          linebuf_iter = FirstNonTspace(first_dosage_str_end);
-          if (unlikely(IsEolnKns(*linebuf_iter))) {
-            goto OxGenToPgen_ret_MISSING_TOKENS;
-          }
-          double prob_1alt;
-          linebuf_iter = ScantokDouble(linebuf_iter, &prob_1alt);
-          if (unlikely(!linebuf_iter)) {
-            goto OxGenToPgen_ret_INVALID_DOSAGE;
-          }
-          linebuf_iter = FirstNonTspace(linebuf_iter);
-          if (unlikely(IsEolnKns(*linebuf_iter))) {
-            goto OxGenToPgen_ret_MISSING_TOKENS;
-          }
-          double prob_2alt;
-          linebuf_iter = ScantokDouble(linebuf_iter, &prob_2alt);
-          if (unlikely(!linebuf_iter)) {
-            goto OxGenToPgen_ret_INVALID_DOSAGE;
-          }
-          // bugfix
-          prob_0alt *= 32768;
-          prob_1alt *= 32768;
-          prob_2alt *= 32768;
-
-          if (unlikely((prob_0alt < 0.0) || (prob_0alt >= 65535.4999999999) || (prob_1alt < 0.0) || (prob_1alt >= 65535.4999999999) || (prob_2alt < 0.0) || (prob_2alt >= 65535.4999999999))) {
-            goto OxGenToPgen_ret_INVALID_DOSAGE;
+            line_iter = AdvPastDelim(K_CAST(char*, genotext_start), '\n');
+            break;
+          } while (1);
+          genotext_byte_ct = line_iter - genotext_start;
+          record_byte_ct = MAXV(RoundUpPow2(genotext_byte_ct, kBytesPerVec), write_byte_ct);
+          if ((block_vidx == cur_thread_block_vidx_limit) || (S_CAST(uintptr_t, cur_thread_byte_stop - geno_buf_iter) < record_byte_ct)) {
+            thread_bidxs[++cur_thread_fill_idx] = block_vidx;
+            if (cur_thread_fill_idx == calc_thread_ct) {
+              break;
+            }
+            cur_thread_byte_stop = &(cur_thread_byte_stop[per_thread_byte_limit]);
+            cur_thread_block_vidx_limit = MINV(cur_thread_block_vidx_limit + per_thread_block_limit, block_vidx_limit);
           }
-          const uint32_t dosage_int0 = S_CAST(int32_t, prob_0alt + 0.5);
-          const uint32_t dosage_int1 = S_CAST(int32_t, prob_1alt + 0.5);
-          const uint32_t dosage_int2 = S_CAST(int32_t, prob_2alt + 0.5);
-          Bgen11DosageImportUpdate(dosage_int_sum_thresh, import_dosage_certainty_int, hard_call_halfdist, dosage_erase_halfdist, sample_idx_lowbits, dosage_int0, dosage_int1, dosage_int2, &genovec_word, &dosage_present_hw, &dosage_main_iter);
         }
-        genovec[widx] = genovec_word;
-        R_CAST(Halfword*, dosage_present)[widx] = dosage_present_hw;
+        cur_block_write_ct = block_vidx;
       }
-      if (prov_ref_allele_second) {
-        GenovecInvertUnsafe(sample_ct, genovec);
-        ZeroTrailingNyps(sample_ct, genovec);
+      if (vidx_start) {
+        JoinThreads(&tg);
+        if (unlikely(ctx.parse_failed)) {
+          goto OxGenToPgen_ret_THREAD_PARSE;
+        }
       }
-      if (dosage_main_iter != dosage_main) {
-        const uint32_t dosage_ct = dosage_main_iter - dosage_main;
-        if (prov_ref_allele_second) {
-          BiallelicDosage16Invert(dosage_ct, dosage_main);
+      if (!IsLastBlock(&tg)) {
+        if (vidx_start + cur_block_write_ct == variant_ct) {
+          DeclareLastThreadBlock(&tg);
+        }
+        if (unlikely(SpawnThreads(&tg))) {
+          goto OxGenToPgen_ret_THREAD_CREATE_FAIL;
         }
-        reterr = SpgwAppendBiallelicGenovecDosage16(genovec, dosage_present, dosage_main, dosage_ct, &spgw);
+      }
+      const uint32_t prev_buf_idx = (buf_idx? buf_idx : gparse_buf_ct) - 1;
+      if (++buf_idx == gparse_buf_ct) {
+        buf_idx = 0;
+      }
+      if (vidx_start) {
+        reterr = GparseFlushStart(ctx.gparse[prev_buf_idx], prev_block_write_ct, (vidx_start == variant_ct), &flush_ctx, &flush_tg);
         if (unlikely(reterr)) {
           goto OxGenToPgen_ret_1;
         }
-      } else {
-        if (unlikely(SpgwAppendBiallelicGenovec(genovec, &spgw))) {
-          goto OxGenToPgen_ret_WRITE_FAIL;
-        }
       }
-      ++vidx;
-      if (!(vidx % 1000)) {
-        printf("\r--data/--gen: %uk variants converted.", vidx / 1000);
+      if (vidx_start == variant_ct) {
+        break;
+      }
+      if (vidx_start) {
+        printf("\r--data/--gen: %uk variants converted.", vidx_start / 1000);
         fflush(stdout);
       }
-      line_iter = AdvPastDelim(K_CAST(char*, linebuf_iter), '\n');
+      vidx_start += cur_block_write_ct;
+      prev_block_write_ct = cur_block_write_ct;
+    }
+    reterr = GparseFlushJoin(&flush_ctx, &flush_tg);
+    if (unlikely(reterr)) {
+      goto OxGenToPgen_ret_1;
     }
     SpgwFinish(&spgw);
     putc_unlocked('\r', stdout);
@@ -10077,6 +12007,20 @@ PglErr OxGenToPgen(const char* genname, const char* samplename, const char* ox_s
   OxGenToPgen_ret_INVALID_CMDLINE:
     reterr = kPglRetInvalidCmdline;
     break;
+  OxGenToPgen_ret_THREAD_PARSE:
+    {
+      OxGenParseErr ox_gen_parse_err = kOxGenParseOk;
+      for (uint32_t tidx = 0; ; ++tidx) {
+        ox_gen_parse_err = ctx.ox_gen_parse_errs[tidx];
+        if (ox_gen_parse_err) {
+          line_idx = ctx.err_line_idxs[tidx];
+          break;
+        }
+      }
+      if (ox_gen_parse_err == kOxGenParseMissingTokens) {
+        goto OxGenToPgen_ret_MISSING_TOKENS;
+      }
+    }
   OxGenToPgen_ret_INVALID_DOSAGE:
     putc_unlocked('\n', stdout);
     logerrprintf("Error: Line %" PRIuPTR " of .gen file has an invalid dosage value.\n", line_idx);
@@ -10096,9 +12040,14 @@ PglErr OxGenToPgen(const char* genname, const char* samplename, const char* ox_s
   OxGenToPgen_ret_INCONSISTENT_INPUT:
     reterr = kPglRetInconsistentInput;
     break;
+  OxGenToPgen_ret_THREAD_CREATE_FAIL:
+    reterr = kPglRetThreadCreateFail;
+    break;
   }
  OxGenToPgen_ret_1:
+  CleanupThreads(&flush_tg);
   CleanupSpgw(&spgw, &reterr);
+  CleanupThreads(&tg);
   CleanupTextStream2(".gen file", &gen_txs, &reterr);
   CswriteCloseCond(&pvar_css, pvar_cswritep);
   BigstackReset(bigstack_mark);
@@ -11045,9 +12994,11 @@ typedef struct Bgen13GenoToPgenCtxStruct {
   uint32_t prov_ref_allele_second;
 
   unsigned char** thread_wkspaces;
-  uint32_t* thread_bidxs[2];
-  GparseRecord* gparse[2];
-  const uintptr_t* block_allele_idx_offsets[2];
+  // gparse_buf_ct (2 or kGparseMaxBufCt) sets of these are cycled through
+  uint32_t* thread_bidxs[kGparseMaxBufCt];
+  GparseRecord* gparse[kGparseMaxBufCt];
+  const uintptr_t* block_allele_idx_offsets[kGparseMaxBufCt];
+  uint32_t gparse_buf_ct;
 
   uint64_t err_info;
 } Bgen13GenoToPgenCtx;
@@ -11080,13 +13031,13 @@ THREAD_FUNC_DECL Bgen13GenoToPgenThread(void* raw_arg) {
   uintptr_t* dphase_present = nullptr;
   SDosage* dphase_delta = nullptr;
   uint32_t cur_allele_ct = 2;
-  uint32_t parity = 0;
+  uint32_t buf_idx = 0;
   do {
     {
-      const uintptr_t* block_allele_idx_offsets = ctx->block_allele_idx_offsets[parity];
-      const uint32_t bidx_end = ctx->thread_bidxs[parity][tidx + 1];
-      uint32_t bidx = ctx->thread_bidxs[parity][tidx];
-      GparseRecord* cur_gparse = ctx->gparse[parity];
+      const uintptr_t* block_allele_idx_offsets = ctx->block_allele_idx_offsets[buf_idx];
+      const uint32_t bidx_end = ctx->thread_bidxs[buf_idx][tidx + 1];
+      uint32_t bidx = ctx->thread_bidxs[buf_idx][tidx];
+      GparseRecord* cur_gparse = ctx->gparse[buf_idx];
 
       for (; bidx != bidx_end; ++bidx) {
         GparseRecord* grp = &(cur_gparse[bidx]);
@@ -11491,50 +13442,800 @@ THREAD_FUNC_DECL Bgen13GenoToPgenThread(void* raw_arg) {
             cur_phasepresent_exists = !AllWordsAreZero(phasepresent, sample_ctl);
           }
         }
-        if (!(sample_ctl2_m1 % 2)) {
-          // do we actually need this?  well, play it safe for now
-          R_CAST(Halfword*, dosage_present)[sample_ctl2_m1 + 1] = 0;
-          R_CAST(Halfword*, dphase_present)[sample_ctl2_m1 + 1] = 0;
+        if (!(sample_ctl2_m1 % 2)) {
+          // do we actually need this?  well, play it safe for now
+          R_CAST(Halfword*, dosage_present)[sample_ctl2_m1 + 1] = 0;
+          R_CAST(Halfword*, dphase_present)[sample_ctl2_m1 + 1] = 0;
+        }
+        const uint32_t dosage_ct = dosage_main_iter - dosage_main;
+        uint32_t dphase_ct = dphase_delta_iter - dphase_delta;
+        // note that this is inverted from bgen-1.1
+        if (!prov_ref_allele_second) {
+          GenovecInvertUnsafe(sample_ct, genovec);
+          ZeroTrailingNyps(sample_ct, genovec);
+          if (dosage_ct) {
+            BiallelicDosage16Invert(dosage_ct, dosage_main);
+            if (dphase_ct) {
+              BiallelicDphase16Invert(dphase_ct, dphase_delta);
+            }
+          }
+        }
+        grp->metadata.write.patch_01_ct = 0;
+        grp->metadata.write.patch_10_ct = 0;
+        grp->metadata.write.phasepresent_exists = cur_phasepresent_exists;
+        grp->metadata.write.dosage_ct = dosage_ct;
+        grp->metadata.write.multiallelic_dosage_ct = 0;
+        grp->metadata.write.dphase_ct = dphase_ct;
+        grp->metadata.write.multiallelic_dphase_ct = 0;
+      }
+    }
+    while (0) {
+    Bgen13GenoToPgenThread_malformed:
+      {
+        const uint64_t new_err_info = (S_CAST(uint64_t, tidx) << 32) | S_CAST(uint32_t, kPglRetMalformedInput);
+        UpdateU64IfSmaller(new_err_info, &ctx->err_info);
+      }
+      break;
+    Bgen13GenoToPgenThread_not_yet_supported:
+      {
+        const uint64_t new_err_info = (S_CAST(uint64_t, tidx) << 32) | S_CAST(uint32_t, kPglRetNotYetSupported);
+        UpdateU64IfSmaller(new_err_info, &ctx->err_info);
+      }
+      break;
+    }
+    if (++buf_idx == ctx->gparse_buf_ct) {
+      buf_idx = 0;
+    }
+  } while (!THREAD_BLOCK_FINISH(arg));
+  THREAD_RETURN;
+}
+
+// Minimal read-only SQLite reader, just sufficient for pulling the variant
+// file offsets out of a bgenix .bgi index.  Only table b-trees and index
+// b-trees (the latter for WITHOUT ROWID tables) are traversed; we never look
+// at the freelist, pointer-map pages, or the WAL.
+typedef struct BgiReaderStruct {
+  FILE* ff;
+  unsigned char* page;
+  unsigned char* overflow_page;
+  unsigned char* payload_buf;
+  uint32_t* page_stack;
+  uint32_t page_size;
+  uint32_t usable_size;
+  uint32_t page_ct;
+  uint32_t payload_buf_size;
+} BgiReader;
+
+static inline uint32_t BgiBe16(const unsigned char* src) {
+  return (S_CAST(uint32_t, src[0]) << 8) | src[1];
+}
+
+static inline uint32_t BgiBe32(const unsigned char* src) {
+  return (S_CAST(uint32_t, src[0]) << 24) | (S_CAST(uint32_t, src[1]) << 16) | (S_CAST(uint32_t, src[2]) << 8) | src[3];
+}
+
+// Returns nullptr if the varint runs past end.
+const unsigned char* BgiGetVarint(const unsigned char* iter, const unsigned char* end, uint64_t* val_ptr) {
+  uint64_t val = 0;
+  for (uint32_t byte_idx = 0; byte_idx != 8; ++byte_idx) {
+    if (iter == end) {
+      return nullptr;
+    }
+    const uint32_t cur_byte = *iter++;
+    val = (val << 7) | (cur_byte & 127);
+    if (cur_byte < 128) {
+      *val_ptr = val;
+      return iter;
+    }
+  }
+  if (iter == end) {
+    return nullptr;
+  }
+  *val_ptr = (val << 8) | (*iter);
+  return &(iter[1]);
+}
+
+BoolErr BgiLoadPage(uint32_t page_num, BgiReader* brp, unsigned char* dst) {
+  if ((!page_num) || (page_num > brp->page_ct)) {
+    return 1;
+  }
+  if (fseeko(brp->ff, S_CAST(uint64_t, page_num - 1) * brp->page_size, SEEK_SET)) {
+    return 1;
+  }
+  return !fread_unlocked(dst, brp->page_size, 1, brp->ff);
+}
+
+// Returns a pointer to the full cell payload (either within brp->page, or
+// reassembled in brp->payload_buf from the overflow chain), or nullptr on
+// failure.
+const unsigned char* BgiGetPayload(const unsigned char* local_start, uint64_t payload_size, uint32_t max_local, BgiReader* brp) {
+  const unsigned char* page_end = &(brp->page[brp->usable_size]);
+  if (payload_size <= max_local) {
+    if (payload_size > S_CAST(uintptr_t, page_end - local_start)) {
+      return nullptr;
+    }
+    return local_start;
+  }
+  const uint32_t usable_size = brp->usable_size;
+  const uint32_t min_local = ((usable_size - 12) * 32 / 255) - 23;
+  uint32_t local_size = min_local + ((payload_size - min_local) % (usable_size - 4));
+  if (local_size > max_local) {
+    local_size = min_local;
+  }
+  if ((payload_size > brp->payload_buf_size) || (local_size + 4 > S_CAST(uintptr_t, page_end - local_start))) {
+    return nullptr;
+  }
+  unsigned char* write_iter = memcpyua(brp->payload_buf, local_start, local_size);
+  uint32_t overflow_page_num = BgiBe32(&(local_start[local_size]));
+  uint64_t remaining_byte_ct = payload_size - local_size;
+  do {
+    if (BgiLoadPage(overflow_page_num, brp, brp->overflow_page)) {
+      return nullptr;
+    }
+    overflow_page_num = BgiBe32(brp->overflow_page);
+    const uint32_t cur_byte_ct = MINV(remaining_byte_ct, usable_size - 4);
+    write_iter = memcpyua(write_iter, &(brp->overflow_page[4]), cur_byte_ct);
+    remaining_byte_ct -= cur_byte_ct;
+  } while (remaining_byte_ct);
+  return brp->payload_buf;
+}
+
+uint64_t BgiSerialTypeByteCt(uint64_t serial_type) {
+  if (serial_type >= 12) {
+    return (serial_type - 12) / 2;
+  }
+  static const unsigned char kBgiSerialTypeByteCts[12] = {0, 1, 2, 3, 4, 6, 8, 8, 0, 0, 0, 0};
+  return kBgiSerialTypeByteCts[serial_type];
+}
+
+// Locates the first col_ct columns of a record.  Columns past the end of the
+// record header are NULL.
+BoolErr BgiParseRecord(const unsigned char* payload, uint64_t payload_size, uint32_t col_ct, const unsigned char** col_starts, uint64_t* col_serial_types) {
+  const unsigned char* payload_end = &(payload[payload_size]);
+  uint64_t header_size;
+  const unsigned char* header_iter = BgiGetVarint(payload, payload_end, &header_size);
+  if ((!header_iter) || (header_size > payload_size)) {
+    return 1;
+  }
+  const unsigned char* header_end = &(payload[header_size]);
+  const unsigned char* body_iter = header_end;
+  for (uint32_t col_idx = 0; col_idx != col_ct; ++col_idx) {
+    uint64_t serial_type = 0;
+    if (header_iter < header_end) {
+      header_iter = BgiGetVarint(header_iter, header_end, &serial_type);
+      if ((!header_iter) || (serial_type == 10) || (serial_type == 11)) {
+        return 1;
+      }
+    }
+    const uint64_t byte_ct = BgiSerialTypeByteCt(serial_type);
+    if (byte_ct > S_CAST(uintptr_t, payload_end - body_iter)) {
+      return 1;
+    }
+    col_starts[col_idx] = body_iter;
+    col_serial_types[col_idx] = serial_type;
+    body_iter = &(body_iter[byte_ct]);
+  }
+  return 0;
+}
+
+BoolErr BgiGetInt(const unsigned char* col_start, uint64_t serial_type, int64_t* val_ptr) {
+  if ((serial_type == 8) || (serial_type == 9)) {
+    *val_ptr = serial_type - 8;
+    return 0;
+  }
+  if ((!serial_type) || (serial_type > 6)) {
+    return 1;
+  }
+  const uint32_t byte_ct = BgiSerialTypeByteCt(serial_type);
+  // big-endian two's complement
+  uint64_t val = (col_start[0] & 128)? (~0LLU) : 0;
+  for (uint32_t byte_idx = 0; byte_idx != byte_ct; ++byte_idx) {
+    val = (val << 8) | col_start[byte_idx];
+  }
+  *val_ptr = S_CAST(int64_t, val);
+  return 0;
+}
+
+BoolErr BgiGetText(const unsigned char* col_start, uint64_t serial_type, const char** text_ptr, uint32_t* slen_ptr) {
+  if ((serial_type < 13) || (!(serial_type & 1))) {
+    return 1;
+  }
+  *text_ptr = R_CAST(const char*, col_start);
+  *slen_ptr = (serial_type - 13) / 2;
+  return 0;
+}
+
+typedef BoolErr(* BgiRowFunc)(const unsigned char* payload, uint64_t payload_size, uint64_t rowid, void* row_ctx);
+
+// Calls row_func() on every row of the b-tree rooted at root_page_num, in no
+// particular order.  rowid is zero for index b-trees.
+BoolErr BgiScanBtree(uint32_t root_page_num, BgiRowFunc row_func, void* row_ctx, BgiReader* brp) {
+  const uint32_t usable_size = brp->usable_size;
+  const uint32_t page_ct = brp->page_ct;
+  const uint32_t table_max_local = usable_size - 35;
+  const uint32_t index_max_local = ((usable_size - 12) * 64 / 255) - 23;
+  unsigned char* page = brp->page;
+  const unsigned char* page_end = &(page[usable_size]);
+  uint32_t* page_stack = brp->page_stack;
+  page_stack[0] = root_page_num;
+  uint32_t stack_size = 1;
+  uint32_t visit_ct = 0;
+  do {
+    const uint32_t page_num = page_stack[--stack_size];
+    // a well-formed b-tree can't visit a page twice
+    if ((++visit_ct > page_ct) || BgiLoadPage(page_num, brp, page)) {
+      return 1;
+    }
+    const unsigned char* page_header = &(page[(page_num == 1)? 100 : 0]);
+    const uint32_t page_type = page_header[0];
+    const uint32_t is_interior = (page_type == 2) || (page_type == 5);
+    const uint32_t is_table = (page_type == 5) || (page_type == 13);
+    if ((!is_interior) && (page_type != 10) && (page_type != 13)) {
+      return 1;
+    }
+    const uint32_t cell_ct = BgiBe16(&(page_header[3]));
+    const unsigned char* cell_ptrs = &(page_header[is_interior? 12 : 8]);
+    if (2 * cell_ct > S_CAST(uintptr_t, page_end - cell_ptrs)) {
+      return 1;
+    }
+    if (is_interior) {
+      if (stack_size + cell_ct >= page_ct) {
+        return 1;
+      }
+      page_stack[stack_size++] = BgiBe32(&(page_header[8]));
+    }
+    for (uint32_t cell_idx = 0; cell_idx != cell_ct; ++cell_idx) {
+      const uint32_t cell_offset = BgiBe16(&(cell_ptrs[2 * cell_idx]));
+      if (cell_offset + 4 > usable_size) {
+        return 1;
+      }
+      const unsigned char* cell_iter = &(page[cell_offset]);
+      if (is_interior) {
+        page_stack[stack_size++] = BgiBe32(cell_iter);
+        if (is_table) {
+          continue;
+        }
+        cell_iter = &(cell_iter[4]);
+      }
+      uint64_t payload_size;
+      cell_iter = BgiGetVarint(cell_iter, page_end, &payload_size);
+      if (!cell_iter) {
+        return 1;
+      }
+      uint64_t rowid = 0;
+      if (is_table) {
+        cell_iter = BgiGetVarint(cell_iter, page_end, &rowid);
+        if (!cell_iter) {
+          return 1;
+        }
+      }
+      const unsigned char* payload = BgiGetPayload(cell_iter, payload_size, is_table? table_max_local : index_max_local, brp);
+      if ((!payload) || row_func(payload, payload_size, rowid, row_ctx)) {
+        return 1;
+      }
+    }
+  } while (stack_size);
+  return 0;
+}
+
+static inline uint32_t BgiAsciiLower(unsigned char ucc) {
+  return ((ucc >= 'A') && (ucc <= 'Z'))? (ucc + 32) : ucc;
+}
+
+uint32_t BgiNameMatch(const char* name, uint32_t name_slen, const char* target) {
+  for (uint32_t pos = 0; pos != name_slen; ++pos) {
+    if (BgiAsciiLower(name[pos]) != BgiAsciiLower(target[pos])) {
+      return 0;
+    }
+  }
+  return !target[name_slen];
+}
+
+// Returns pointer to the first case-insensitive occurrence of keyword in
+// [str_iter, str_end), or nullptr if there is none.
+const char* BgiFindKeyword(const char* str_iter, const char* str_end, const char* keyword) {
+  const uint32_t keyword_slen = strlen(keyword);
+  for (; S_CAST(uintptr_t, str_end - str_iter) >= keyword_slen; ++str_iter) {
+    if (BgiNameMatch(str_iter, keyword_slen, keyword)) {
+      return str_iter;
+    }
+  }
+  return nullptr;
+}
+
+// Sets *name_start_ptr/*name_slen_ptr to the (unquoted) identifier starting
+// at str_iter, and returns a pointer past it.
+const char* BgiScanIdentifier(const char* str_iter, const char* str_end, const char** name_start_ptr, uint32_t* name_slen_ptr) {
+  while ((str_iter != str_end) && (ctou32(*str_iter) <= ' ')) {
+    ++str_iter;
+  }
+  if (str_iter == str_end) {
+    *name_start_ptr = str_iter;
+    *name_slen_ptr = 0;
+    return str_iter;
+  }
+  char close_char = '\0';
+  const char cc = *str_iter;
+  if ((cc == '"') || (cc == '`') || (cc == '\'')) {
+    close_char = cc;
+  } else if (cc == '[') {
+    close_char = ']';
+  }
+  if (close_char) {
+    ++str_iter;
+    const char* name_end = S_CAST(const char*, memchr(str_iter, close_char, str_end - str_iter));
+    if (!name_end) {
+      name_end = str_end;
+    }
+    *name_start_ptr = str_iter;
+    *name_slen_ptr = name_end - str_iter;
+    return (name_end == str_end)? str_end : (&(name_end[1]));
+  }
+  const char* name_end = str_iter;
+  while ((name_end != str_end) && (ctou32(*name_end) > ' ') && (*name_end != '(') && (*name_end != ',') && (*name_end != ')')) {
+    ++name_end;
+  }
+  *name_start_ptr = str_iter;
+  *name_slen_ptr = name_end - str_iter;
+  return name_end;
+}
+
+CONSTI32(kBgiMaxColCt, 64);
+
+// Determines where each of the wanted columns is stored in a record of the
+// table defined by the given CREATE TABLE statement.  Set to UINT32_MAX for a
+// column which is an alias of the rowid.
+BoolErr BgiLocateColumns(const char* sql, uint32_t sql_slen, uint32_t wanted_ct, const char* const* wanted_names, uint32_t* record_col_idxs) {
+  const char* sql_end = &(sql[sql_slen]);
+  const char* sql_iter = S_CAST(const char*, memchr(sql, '(', sql_slen));
+  if (!sql_iter) {
+    return 1;
+  }
+  ++sql_iter;
+  // First split the column list on top-level commas.
+  const char* item_starts[kBgiMaxColCt + 1];
+  const char* item_ends[kBgiMaxColCt + 1];
+  uint32_t item_ct = 0;
+  item_starts[0] = sql_iter;
+  uint32_t depth = 0;
+  char quote_char = '\0';
+  for (; ; ++sql_iter) {
+    if (sql_iter == sql_end) {
+      return 1;
+    }
+    const char cc = *sql_iter;
+    if (quote_char) {
+      if (cc == quote_char) {
+        quote_char = '\0';
+      }
+      continue;
+    }
+    if ((cc == '"') || (cc == '`') || (cc == '\'')) {
+      quote_char = cc;
+    } else if (cc == '[') {
+      quote_char = ']';
+    } else if (cc == '(') {
+      ++depth;
+    } else if ((cc == ',') || (cc == ')')) {
+      if (depth) {
+        if (cc == ')') {
+          --depth;
+        }
+        continue;
+      }
+      if (item_ct == kBgiMaxColCt) {
+        return 1;
+      }
+      item_ends[item_ct++] = sql_iter;
+      if (cc == ')') {
+        break;
+      }
+      item_starts[item_ct] = &(sql_iter[1]);
+    }
+  }
+  const uint32_t without_rowid = (BgiFindKeyword(&(sql_iter[1]), sql_end, "rowid") != nullptr);
+  const char* col_names[kBgiMaxColCt];
+  uint32_t col_name_slens[kBgiMaxColCt];
+  uint32_t col_ct = 0;
+  uint32_t rowid_alias_col_idx = UINT32_MAX;
+  const char* pk_list_start = nullptr;
+  const char* pk_list_end = nullptr;
+  uint32_t inline_pk_col_idx = UINT32_MAX;
+  for (uint32_t item_idx = 0; item_idx != item_ct; ++item_idx) {
+    const char* item_end = item_ends[item_idx];
+    const char* name_start;
+    uint32_t name_slen;
+    const char* after_name = BgiScanIdentifier(item_starts[item_idx], item_end, &name_start, &name_slen);
+    if (BgiNameMatch(name_start, name_slen, "primary") || BgiNameMatch(name_start, name_slen, "constraint") || BgiNameMatch(name_start, name_slen, "unique") || BgiNameMatch(name_start, name_slen, "check") || BgiNameMatch(name_start, name_slen, "foreign")) {
+      const char* pk_keyword = BgiFindKeyword(item_starts[item_idx], item_end, "primary");
+      if (pk_keyword) {
+        pk_list_start = S_CAST(const char*, memchr(pk_keyword, '(', item_end - pk_keyword));
+        if (!pk_list_start) {
+          return 1;
+        }
+        ++pk_list_start;
+        pk_list_end = item_end;
+      }
+      continue;
+    }
+    if (!name_slen) {
+      return 1;
+    }
+    if (BgiFindKeyword(after_name, item_end, "primary")) {
+      inline_pk_col_idx = col_ct;
+      const char* type_start;
+      uint32_t type_slen;
+      BgiScanIdentifier(after_name, item_end, &type_start, &type_slen);
+      if ((!without_rowid) && BgiNameMatch(type_start, type_slen, "integer")) {
+        rowid_alias_col_idx = col_ct;
+      }
+    }
+    col_names[col_ct] = name_start;
+    col_name_slens[col_ct] = name_slen;
+    ++col_ct;
+  }
+  // storage_order[k] = declared index of the k-th column in each record
+  uint32_t storage_order[kBgiMaxColCt];
+  uint32_t storage_ct = 0;
+  if (without_rowid) {
+    uintptr_t is_pk_col[BitCtToWordCt(kBgiMaxColCt)];
+    ZeroWArr(BitCtToWordCt(kBgiMaxColCt), is_pk_col);
+    if (pk_list_start) {
+      const char* pk_iter = pk_list_start;
+      while (pk_iter < pk_list_end) {
+        const char* name_start;
+        uint32_t name_slen;
+        BgiScanIdentifier(pk_iter, pk_list_end, &name_start, &name_slen);
+        uint32_t col_idx = 0;
+        for (; col_idx != col_ct; ++col_idx) {
+          if ((col_name_slens[col_idx] == name_slen) && (!memcmp(col_names[col_idx], name_start, name_slen))) {
+            break;
+          }
+        }
+        if ((col_idx == col_ct) || IsSet(is_pk_col, col_idx)) {
+          return 1;
         }
-        const uint32_t dosage_ct = dosage_main_iter - dosage_main;
-        uint32_t dphase_ct = dphase_delta_iter - dphase_delta;
-        // note that this is inverted from bgen-1.1
-        if (!prov_ref_allele_second) {
-          GenovecInvertUnsafe(sample_ct, genovec);
-          ZeroTrailingNyps(sample_ct, genovec);
-          if (dosage_ct) {
-            BiallelicDosage16Invert(dosage_ct, dosage_main);
-            if (dphase_ct) {
-              BiallelicDphase16Invert(dphase_ct, dphase_delta);
-            }
-          }
+        SetBit(col_idx, is_pk_col);
+        storage_order[storage_ct++] = col_idx;
+        pk_iter = S_CAST(const char*, memchr(name_start, ',', pk_list_end - name_start));
+        if (!pk_iter) {
+          break;
         }
-        grp->metadata.write.patch_01_ct = 0;
-        grp->metadata.write.patch_10_ct = 0;
-        grp->metadata.write.phasepresent_exists = cur_phasepresent_exists;
-        grp->metadata.write.dosage_ct = dosage_ct;
-        grp->metadata.write.multiallelic_dosage_ct = 0;
-        grp->metadata.write.dphase_ct = dphase_ct;
-        grp->metadata.write.multiallelic_dphase_ct = 0;
+        ++pk_iter;
+      }
+    } else {
+      if (inline_pk_col_idx == UINT32_MAX) {
+        return 1;
       }
+      SetBit(inline_pk_col_idx, is_pk_col);
+      storage_order[storage_ct++] = inline_pk_col_idx;
     }
-    while (0) {
-    Bgen13GenoToPgenThread_malformed:
-      {
-        const uint64_t new_err_info = (S_CAST(uint64_t, tidx) << 32) | S_CAST(uint32_t, kPglRetMalformedInput);
-        UpdateU64IfSmaller(new_err_info, &ctx->err_info);
+    for (uint32_t col_idx = 0; col_idx != col_ct; ++col_idx) {
+      if (!IsSet(is_pk_col, col_idx)) {
+        storage_order[storage_ct++] = col_idx;
       }
-      break;
-    Bgen13GenoToPgenThread_not_yet_supported:
-      {
-        const uint64_t new_err_info = (S_CAST(uint64_t, tidx) << 32) | S_CAST(uint32_t, kPglRetNotYetSupported);
-        UpdateU64IfSmaller(new_err_info, &ctx->err_info);
+    }
+  } else {
+    for (uint32_t col_idx = 0; col_idx != col_ct; ++col_idx) {
+      storage_order[col_idx] = col_idx;
+    }
+    storage_ct = col_ct;
+  }
+  for (uint32_t wanted_idx = 0; wanted_idx != wanted_ct; ++wanted_idx) {
+    const char* wanted_name = wanted_names[wanted_idx];
+    uint32_t storage_idx = 0;
+    for (; storage_idx != storage_ct; ++storage_idx) {
+      const uint32_t col_idx = storage_order[storage_idx];
+      if (BgiNameMatch(col_names[col_idx], col_name_slens[col_idx], wanted_name)) {
+        break;
       }
-      break;
     }
-    parity = 1 - parity;
-  } while (!THREAD_BLOCK_FINISH(arg));
-  THREAD_RETURN;
+    if (storage_idx == storage_ct) {
+      return 1;
+    }
+    record_col_idxs[wanted_idx] = (storage_order[storage_idx] == rowid_alias_col_idx)? UINT32_MAX : storage_idx;
+  }
+  return 0;
+}
+
+typedef struct BgiSchemaScanCtxStruct {
+  char* variant_sql;
+  char* metadata_sql;
+  uint32_t sql_capacity;
+  uint32_t variant_sql_slen;
+  uint32_t metadata_sql_slen;
+  uint32_t variant_root_page_num;
+  uint32_t metadata_root_page_num;
+} BgiSchemaScanCtx;
+
+BoolErr BgiSchemaScanRow(const unsigned char* payload, uint64_t payload_size, __maybe_unused uint64_t rowid, void* row_ctx) {
+  BgiSchemaScanCtx* ctxp = S_CAST(BgiSchemaScanCtx*, row_ctx);
+  // type, name, tbl_name, rootpage, sql
+  const unsigned char* col_starts[5];
+  uint64_t col_serial_types[5];
+  if (BgiParseRecord(payload, payload_size, 5, col_starts, col_serial_types)) {
+    return 1;
+  }
+  const char* type_str;
+  uint32_t type_slen;
+  const char* name;
+  uint32_t name_slen;
+  if (BgiGetText(col_starts[0], col_serial_types[0], &type_str, &type_slen) || BgiGetText(col_starts[1], col_serial_types[1], &name, &name_slen)) {
+    return 1;
+  }
+  if (!BgiNameMatch(type_str, type_slen, "table")) {
+    return 0;
+  }
+  char* sql_dst;
+  uint32_t* sql_slen_ptr;
+  uint32_t* root_page_num_ptr;
+  if (BgiNameMatch(name, name_slen, "variant")) {
+    sql_dst = ctxp->variant_sql;
+    sql_slen_ptr = &ctxp->variant_sql_slen;
+    root_page_num_ptr = &ctxp->variant_root_page_num;
+  } else if (BgiNameMatch(name, name_slen, "metadata")) {
+    sql_dst = ctxp->metadata_sql;
+    sql_slen_ptr = &ctxp->metadata_sql_slen;
+    root_page_num_ptr = &ctxp->metadata_root_page_num;
+  } else {
+    return 0;
+  }
+  int64_t root_page_num;
+  const char* sql;
+  uint32_t sql_slen;
+  if (BgiGetInt(col_starts[3], col_serial_types[3], &root_page_num) || (root_page_num <= 0) || (root_page_num > UINT32_MAX) || BgiGetText(col_starts[4], col_serial_types[4], &sql, &sql_slen) || (sql_slen > ctxp->sql_capacity)) {
+    return 1;
+  }
+  memcpy(sql_dst, sql, sql_slen);
+  *sql_slen_ptr = sql_slen;
+  *root_page_num_ptr = root_page_num;
+  return 0;
+}
+
+typedef struct BgiMetadataScanCtxStruct {
+  uint32_t file_size_col_idx;
+  uint32_t row_ct;
+  int64_t file_size;
+} BgiMetadataScanCtx;
+
+BoolErr BgiMetadataScanRow(const unsigned char* payload, uint64_t payload_size, uint64_t rowid, void* row_ctx) {
+  BgiMetadataScanCtx* ctxp = S_CAST(BgiMetadataScanCtx*, row_ctx);
+  ctxp->row_ct += 1;
+  const uint32_t col_idx = ctxp->file_size_col_idx;
+  if (col_idx == UINT32_MAX) {
+    ctxp->file_size = rowid;
+    return 0;
+  }
+  const unsigned char* col_starts[kBgiMaxColCt];
+  uint64_t col_serial_types[kBgiMaxColCt];
+  return BgiParseRecord(payload, payload_size, col_idx + 1, col_starts, col_serial_types) || BgiGetInt(col_starts[col_idx], col_serial_types[col_idx], &ctxp->file_size);
+}
+
+typedef struct BgiVariantLocStruct {
+  uint64_t fpos;
+  uint64_t byte_ct;
+#ifdef __cplusplus
+  bool operator<(const struct BgiVariantLocStruct& rhs) const {
+    return fpos < rhs.fpos;
+  }
+#endif
+} BgiVariantLoc;
+
+typedef struct BgiVariantScanCtxStruct {
+  const ChrInfo* cip;
+  // chromosome, file_start_position, size_in_bytes
+  uint32_t col_idxs[3];
+  uint32_t parse_col_ct;
+  BgiVariantLoc* locs;
+  uintptr_t loc_capacity;
+  uintptr_t loc_ct;
+  uintptr_t row_ct;
+} BgiVariantScanCtx;
+
+BoolErr BgiVariantScanRow(const unsigned char* payload, uint64_t payload_size, uint64_t rowid, void* row_ctx) {
+  BgiVariantScanCtx* ctxp = S_CAST(BgiVariantScanCtx*, row_ctx);
+  ctxp->row_ct += 1;
+  const unsigned char* col_starts[kBgiMaxColCt];
+  uint64_t col_serial_types[kBgiMaxColCt];
+  if (BgiParseRecord(payload, payload_size, ctxp->parse_col_ct, col_starts, col_serial_types)) {
+    return 1;
+  }
+  int64_t col_vals[2];
+  for (uint32_t uii = 0; uii != 2; ++uii) {
+    const uint32_t col_idx = ctxp->col_idxs[uii + 1];
+    if (col_idx == UINT32_MAX) {
+      col_vals[uii] = rowid;
+    } else if (BgiGetInt(col_starts[col_idx], col_serial_types[col_idx], &(col_vals[uii])) || (col_vals[uii] < 0)) {
+      return 1;
+    }
+  }
+  const uint32_t chr_col_idx = ctxp->col_idxs[0];
+  if (chr_col_idx != UINT32_MAX) {
+    const char* chr_name;
+    uint32_t chr_name_slen;
+    if (BgiGetText(col_starts[chr_col_idx], col_serial_types[chr_col_idx], &chr_name, &chr_name_slen)) {
+      return 1;
+    }
+    // Only drop variants we're certain to skip; anything we can't classify
+    // here (e.g. a contig name which hasn't been seen yet) is left to the
+    // main loop.
+    if (chr_name_slen && (chr_name_slen <= kMaxIdSlen)) {
+      char chr_buf[kMaxIdSlen + 1];
+      if (strequal_k(chr_name, "NA", chr_name_slen)) {
+        strcpy_k(chr_buf, "0");
+        chr_name_slen = 1;
+      } else {
+        memcpyx(chr_buf, chr_name, chr_name_slen, '\0');
+      }
+      const ChrInfo* cip = ctxp->cip;
+      const uint32_t chr_code = GetChrCode(chr_buf, cip, chr_name_slen);
+      if ((!IsI32Neg(chr_code)) && (!IsSet(cip->chr_mask, chr_code))) {
+        return 0;
+      }
+    }
+  }
+  if (ctxp->loc_ct == ctxp->loc_capacity) {
+    return 1;
+  }
+  BgiVariantLoc* cur_loc = &(ctxp->locs[ctxp->loc_ct]);
+  cur_loc->fpos = col_vals[0];
+  cur_loc->byte_ct = col_vals[1];
+  ctxp->loc_ct += 1;
+  return 0;
+}
+
+// Loads a bgenix .bgi index, and determines which .bgen variant records could
+// pass the chromosome filter.  On success, *fpos_ct_ptr is set to the number
+// of such records, and (*seek_fposs_ptr)[] (allocated at the bottom of
+// bigstack) contains their file offsets in increasing order, with UINT64_MAX
+// in place of offsets that immediately follow the previous record.
+// Returns kPglRetOpenFail if the index doesn't exist, and kPglRetMalformedInput
+// (with *errmsg_ptr set) if it can't be used.
+// Only the chromosome column of the Variant table is consulted.  --extract,
+// --from-bp/--to-bp, etc. are applied after import, so every variant on a
+// selected chromosome is still converted; the index's position/rsid columns
+// could be used to narrow this further, but aren't yet.
+PglErr LoadBgi(const char* bginame, uint64_t bgen_fsize, uint32_t raw_variant_ct, const ChrInfo* cip, uint64_t** seek_fposs_ptr, uint32_t* fpos_ct_ptr, const char** errmsg_ptr) {
+  unsigned char* bigstack_end_mark = g_bigstack_end;
+  BgiReader br;
+  br.ff = nullptr;
+  PglErr reterr = kPglRetSuccess;
+  {
+    br.ff = fopen(bginame, FOPEN_RB);
+    if (!br.ff) {
+      reterr = kPglRetOpenFail;
+      goto LoadBgi_ret_1;
+    }
+    unsigned char db_header[100];
+    if (!fread_unlocked(db_header, 100, 1, br.ff)) {
+      goto LoadBgi_ret_MALFORMED;
+    }
+    if (!memequal_k(db_header, "SQLite format 3", 16)) {
+      *errmsg_ptr = "not an SQLite database";
+      goto LoadBgi_ret_MALFORMED_MSG;
+    }
+    br.page_size = BgiBe16(&(db_header[16]));
+    if (br.page_size == 1) {
+      br.page_size = 65536;
+    }
+    if ((br.page_size < 512) || (br.page_size & (br.page_size - 1)) || (db_header[20] > 32) || (BgiBe32(&(db_header[56])) > 1)) {
+      goto LoadBgi_ret_MALFORMED;
+    }
+    br.usable_size = br.page_size - db_header[20];
+    if (fseeko(br.ff, 0, SEEK_END)) {
+      goto LoadBgi_ret_MALFORMED;
+    }
+    const uint64_t bgi_fsize = ftello(br.ff);
+    if ((bgi_fsize / br.page_size) > 0x7fffffff) {
+      goto LoadBgi_ret_MALFORMED;
+    }
+    br.page_ct = bgi_fsize / br.page_size;
+    br.payload_buf_size = 1 << 20;
+    const uint32_t sql_capacity = 65536;
+    char* variant_sql;
+    char* metadata_sql;
+    if (unlikely(
+            bigstack_end_alloc_uc(br.page_size, &br.page) ||
+            bigstack_end_alloc_uc(br.page_size, &br.overflow_page) ||
+            bigstack_end_alloc_uc(br.payload_buf_size, &br.payload_buf) ||
+            bigstack_end_alloc_u32(br.page_ct + 1, &br.page_stack) ||
+            bigstack_end_alloc_c(sql_capacity, &variant_sql) ||
+            bigstack_end_alloc_c(sql_capacity, &metadata_sql))) {
+      goto LoadBgi_ret_NOMEM;
+    }
+    BgiSchemaScanCtx schema_ctx;
+    schema_ctx.variant_sql = variant_sql;
+    schema_ctx.metadata_sql = metadata_sql;
+    schema_ctx.sql_capacity = sql_capacity;
+    schema_ctx.variant_root_page_num = 0;
+    schema_ctx.metadata_root_page_num = 0;
+    if (BgiScanBtree(1, BgiSchemaScanRow, &schema_ctx, &br)) {
+      goto LoadBgi_ret_MALFORMED;
+    }
+    if (!schema_ctx.variant_root_page_num) {
+      *errmsg_ptr = "no Variant table";
+      goto LoadBgi_ret_MALFORMED_MSG;
+    }
+    if (schema_ctx.metadata_root_page_num) {
+      // bgenix records the .bgen file size; use it to catch stale indexes.
+      const char* metadata_col_names[1] = {"file_size"};
+      BgiMetadataScanCtx metadata_ctx;
+      metadata_ctx.row_ct = 0;
+      metadata_ctx.file_size = 0;
+      if (BgiLocateColumns(metadata_sql, schema_ctx.metadata_sql_slen, 1, metadata_col_names, &metadata_ctx.file_size_col_idx) || BgiScanBtree(schema_ctx.metadata_root_page_num, BgiMetadataScanRow, &metadata_ctx, &br)) {
+        goto LoadBgi_ret_MALFORMED;
+      }
+      if (metadata_ctx.row_ct && (S_CAST(uint64_t, metadata_ctx.file_size) != bgen_fsize)) {
+        *errmsg_ptr = "file size recorded in index does not match .bgen";
+        goto LoadBgi_ret_MALFORMED_MSG;
+      }
+    }
+    const char* variant_col_names[3] = {"chromosome", "file_start_position", "size_in_bytes"};
+    BgiVariantScanCtx variant_ctx;
+    if (BgiLocateColumns(variant_sql, schema_ctx.variant_sql_slen, 3, variant_col_names, variant_ctx.col_idxs)) {
+      goto LoadBgi_ret_MALFORMED;
+    }
+    variant_ctx.parse_col_ct = 0;
+    for (uint32_t uii = 0; uii != 3; ++uii) {
+      const uint32_t col_idx = variant_ctx.col_idxs[uii];
+      if ((col_idx != UINT32_MAX) && (col_idx >= variant_ctx.parse_col_ct)) {
+        variant_ctx.parse_col_ct = col_idx + 1;
+      }
+    }
+    variant_ctx.cip = cip;
+    variant_ctx.locs = R_CAST(BgiVariantLoc*, g_bigstack_base);
+    variant_ctx.loc_capacity = MINV(bigstack_left() / sizeof(BgiVariantLoc), raw_variant_ct);
+    variant_ctx.loc_ct = 0;
+    variant_ctx.row_ct = 0;
+    if (BgiScanBtree(schema_ctx.variant_root_page_num, BgiVariantScanRow, &variant_ctx, &br)) {
+      // could also be out-of-memory, but that isn't worth distinguishing
+      goto LoadBgi_ret_MALFORMED;
+    }
+    if (variant_ctx.row_ct != raw_variant_ct) {
+      *errmsg_ptr = "variant count does not match .bgen";
+      goto LoadBgi_ret_MALFORMED_MSG;
+    }
+    const uintptr_t loc_ct = variant_ctx.loc_ct;
+    BgiVariantLoc* locs = variant_ctx.locs;
+    STD_SORT(loc_ct, u64cmp, locs);
+    // Convert to seek positions in place.  Safe since the 8-byte write to
+    // seek_fposs[loc_idx] never clobbers locs[loc_idx + 1].
+    uint64_t* seek_fposs = R_CAST(uint64_t*, locs);
+    uint64_t prev_fpos_end = UINT64_MAX;
+    for (uintptr_t loc_idx = 0; loc_idx != loc_ct; ++loc_idx) {
+      const uint64_t cur_fpos = locs[loc_idx].fpos;
+      const uint64_t cur_fpos_end = cur_fpos + locs[loc_idx].byte_ct;
+      if ((cur_fpos < prev_fpos_end) && (prev_fpos_end != UINT64_MAX)) {
+        *errmsg_ptr = "overlapping variant records";
+        goto LoadBgi_ret_MALFORMED_MSG;
+      }
+      if (cur_fpos_end > bgen_fsize) {
+        *errmsg_ptr = "variant record extends past end of .bgen";
+        goto LoadBgi_ret_MALFORMED_MSG;
+      }
+      seek_fposs[loc_idx] = (cur_fpos == prev_fpos_end)? UINT64_MAX : cur_fpos;
+      prev_fpos_end = cur_fpos_end;
+    }
+    BigstackFinalizeU64(seek_fposs, loc_ct);
+    *seek_fposs_ptr = seek_fposs;
+    *fpos_ct_ptr = loc_ct;
+  }
+  while (0) {
+  LoadBgi_ret_NOMEM:
+    reterr = kPglRetNomem;
+    break;
+  LoadBgi_ret_MALFORMED:
+    *errmsg_ptr = "malformed or unsupported index";
+  LoadBgi_ret_MALFORMED_MSG:
+    reterr = kPglRetMalformedInput;
+    break;
+  }
+ LoadBgi_ret_1:
+  if (br.ff) {
+    fclose(br.ff);
+  }
+  BigstackEndReset(bigstack_end_mark);
+  return reterr;
 }
 
 static_assert(sizeof(Dosage) == 2, "OxBgenToPgen() needs to be updated.");
@@ -11555,6 +14256,10 @@ PglErr OxBgenToPgen(const char* bgenname, const char* samplename, const char* co
   STPgenWriter spgw;
   PglErr reterr = kPglRetSuccess;
   PreinitSpgw(&spgw);
+  ThreadGroup flush_tg;
+  PreinitThreads(&flush_tg);
+  GparseFlushCtx flush_ctx;
+  InitGparseFlush(&spgw, &flush_ctx);
   BgenImportCommon common;
   common.libdeflate_decompressors = nullptr;
   {
@@ -12508,6 +15213,40 @@ PglErr OxBgenToPgen(const char* bgenname, const char* samplename, const char* co
       }
     } else {
       // v1.2-1.3
+      // If a bgenix index is present and a chromosome filter was specified,
+      // only visit the variant records which may pass the filter.  (Other
+      // variant filters don't reach this point, see LoadBgi().)
+      uint64_t* bgi_seek_fposs = nullptr;
+      uint32_t scan_variant_ct = raw_variant_ct;
+      if (chr_filter_present && (!ox_single_chr_str) && (!snpid_chr)) {
+        const uint32_t bgenname_slen = strlen(bgenname);
+        char* bginame;
+        if (unlikely(bigstack_end_alloc_c(bgenname_slen + 5, &bginame))) {
+          goto OxBgenToPgen_ret_NOMEM;
+        }
+        snprintf(memcpya(bginame, bgenname, bgenname_slen), 5, ".bgi");
+        if (unlikely(fseeko(bgenfile, 0, SEEK_END))) {
+          goto OxBgenToPgen_ret_READ_FAIL;
+        }
+        const uint64_t bgen_fsize = ftello(bgenfile);
+        if (unlikely(fseeko(bgenfile, initial_uints[0] + 4, SEEK_SET))) {
+          goto OxBgenToPgen_ret_READ_FAIL;
+        }
+        const char* bgi_errmsg = nullptr;
+        reterr = LoadBgi(bginame, bgen_fsize, raw_variant_ct, cip, &bgi_seek_fposs, &scan_variant_ct, &bgi_errmsg);
+        if (reterr == kPglRetSuccess) {
+          logprintfww("--bgen: %u variant%s selected by %s .\n", scan_variant_ct, (scan_variant_ct == 1)? "" : "s", bginame);
+        } else if (reterr == kPglRetNomem) {
+          goto OxBgenToPgen_ret_1;
+        } else {
+          if (reterr != kPglRetOpenFail) {
+            logerrprintfww("Warning: Ignoring %s (%s).\n", bginame, bgi_errmsg);
+          }
+          reterr = kPglRetSuccess;
+          scan_variant_ct = raw_variant_ct;
+        }
+        BigstackEndReset(bigstack_end_mark);
+      }
       uintptr_t* allele_idx_offsets;
       if (unlikely(bigstack_end_alloc_w(raw_variant_ct + 1, &allele_idx_offsets))) {
         goto OxBgenToPgen_ret_NOMEM;
@@ -12642,7 +15381,7 @@ PglErr OxBgenToPgen(const char* bgenname, const char* samplename, const char* co
           }
         }
       }
-      unsigned char* compressed_geno_bufs[2];
+      unsigned char* compressed_geno_bufs[kGparseMaxBufCt];
       compressed_geno_bufs[0] = S_CAST(unsigned char*, bigstack_alloc_raw(mainbuf_size));
       compressed_geno_bufs[1] = S_CAST(unsigned char*, bigstack_alloc_raw(mainbuf_size));
       for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
@@ -12682,7 +15421,12 @@ PglErr OxBgenToPgen(const char* bgenname, const char* samplename, const char* co
       // temporary kludge
       uint32_t multiallelic_skip_ct = 0;
 
-      for (uint32_t variant_uidx = 0; variant_uidx != raw_variant_ct; ) {
+      for (uint32_t variant_uidx = 0; variant_uidx != scan_variant_ct; ) {
+        if (bgi_seek_fposs && (bgi_seek_fposs[variant_uidx] != UINT64_MAX)) {
+          if (unlikely(fseeko(bgenfile, bgi_seek_fposs[variant_uidx], SEEK_SET))) {
+            goto OxBgenToPgen_ret_READ_FAIL;
+          }
+        }
         // format is mostly identical to bgen 1.1; but there's no sample count,
         // and there is an allele count
         // logic is more similar to the second bgen 1.1 pass since we write the
@@ -13050,7 +15794,7 @@ PglErr OxBgenToPgen(const char* bgenname, const char* samplename, const char* co
         }
         block_vidx = 0;
       }
-      chr_filter_present = (variant_ct + multiallelic_skip_ct != raw_variant_ct);
+      chr_filter_present = (variant_ct + multiallelic_skip_ct != scan_variant_ct);
       if (ThreadsAreActive(&tg)) {
         JoinThreads(&tg);
         reterr = S_CAST(PglErr, scan_ctx.err_info);
@@ -13116,6 +15860,11 @@ PglErr OxBgenToPgen(const char* bgenname, const char* samplename, const char* co
       // compressed_geno_bufs[] in next step).
       // Additional *6 in denominator since we want to limit these allocations
       // to 1/6 of remaining workspace.
+      // reserve a thread for background .pgen writing when possible
+      const uint32_t flush_thread_ct = (max_thread_ct > 2);
+      if (flush_thread_ct && (calc_thread_ct_limit + 2 > max_thread_ct)) {
+        calc_thread_ct_limit = max_thread_ct - 2;
+      }
       thread_wkspace_size = RoundUpPow2(max_uncompressed_geno_blen, kCacheline);
       // bugfix (16 Jul 2017): was computing cachelines_avail, not bytes_avail
       uintptr_t bytes_avail = RoundDownPow2(bigstack_left() / 6, kCacheline);
@@ -13142,6 +15891,13 @@ PglErr OxBgenToPgen(const char* bgenname, const char* samplename, const char* co
       }
       ctx.thread_bidxs[0] = scan_ctx.thread_bidxs[0];
       ctx.thread_bidxs[1] = scan_ctx.thread_bidxs[1];
+      const uint32_t gparse_buf_ct = GparseFlushSetBackground(flush_thread_ct, &flush_ctx, &flush_tg);
+      ctx.gparse_buf_ct = gparse_buf_ct;
+      for (uint32_t buf_idx = 2; buf_idx < gparse_buf_ct; ++buf_idx) {
+        if (unlikely(bigstack_alloc_u32(calc_thread_ct + 1, &(ctx.thread_bidxs[buf_idx])))) {
+          goto OxBgenToPgen_ret_NOMEM;
+        }
+      }
       if (compression_mode == 1) {
         for (uint32_t tidx = old_calc_thread_ct; tidx < calc_thread_ct; ++tidx) {
           common.libdeflate_decompressors[tidx] = libdeflate_alloc_decompressor();
@@ -13165,11 +15921,11 @@ PglErr OxBgenToPgen(const char* bgenname, const char* samplename, const char* co
       // may as well include calc_thread_ct thanks to potential
       // per_thread_byte_limit adverse rounding
       const uint64_t max_bytes_req_per_variant = sizeof(GparseRecord) + MAXV(max_compressed_geno_blen, max_write_byte_ct) + calc_thread_ct;
-      if (unlikely(cachelines_avail * kCacheline < 2 * max_bytes_req_per_variant)) {
+      if (unlikely(cachelines_avail * kCacheline < gparse_buf_ct * max_bytes_req_per_variant)) {
         goto OxBgenToPgen_ret_NOMEM;
       }
       uintptr_t min_bytes_req_per_variant = sizeof(GparseRecord) + GparseWriteByteCt(sample_ct, 2, gparse_flags);
-      main_block_size = (cachelines_avail * kCacheline) / (min_bytes_req_per_variant * 2);
+      main_block_size = (cachelines_avail * kCacheline) / (min_bytes_req_per_variant * gparse_buf_ct);
       // this is arbitrary, there's no connection to kPglVblockSize
       if (main_block_size > 65536) {
         main_block_size = 65536;
@@ -13182,18 +15938,18 @@ PglErr OxBgenToPgen(const char* bgenname, const char* samplename, const char* co
       // may as well guarantee divisibility
       per_thread_block_limit = main_block_size / calc_thread_ct;
       main_block_size = per_thread_block_limit * calc_thread_ct;
-      ctx.gparse[0] = S_CAST(GparseRecord*, bigstack_alloc_raw_rd(main_block_size * sizeof(GparseRecord)));
-      ctx.gparse[1] = S_CAST(GparseRecord*, bigstack_alloc_raw_rd(main_block_size * sizeof(GparseRecord)));
-      ctx.block_allele_idx_offsets[0] = nullptr;  // defensive
-      ctx.block_allele_idx_offsets[1] = nullptr;
+      for (uint32_t buf_idx = 0; buf_idx != gparse_buf_ct; ++buf_idx) {
+        ctx.gparse[buf_idx] = S_CAST(GparseRecord*, bigstack_alloc_raw_rd(main_block_size * sizeof(GparseRecord)));
+        ctx.block_allele_idx_offsets[buf_idx] = nullptr;  // defensive
+      }
       ctx.err_info = (~0LLU) << 32;
       SetThreadFuncAndData(Bgen13GenoToPgenThread, &ctx, &tg);
-      cachelines_avail = bigstack_left() / (kCacheline * 2);
-      if (unlikely(
-              bigstack_alloc_uc(cachelines_avail * kCacheline, &(compressed_geno_bufs[0])) ||
-              bigstack_alloc_uc(cachelines_avail * kCacheline, &(compressed_geno_bufs[1])))) {
-        assert(0);
-        goto OxBgenToPgen_ret_NOMEM;
+      cachelines_avail = bigstack_left() / (kCacheline * gparse_buf_ct);
+      for (uint32_t buf_idx = 0; buf_idx != gparse_buf_ct; ++buf_idx) {
+        if (unlikely(bigstack_alloc_uc(cachelines_avail * kCacheline, &(compressed_geno_bufs[buf_idx])))) {
+          assert(0);
+          goto OxBgenToPgen_ret_NOMEM;
+        }
       }
       const uintptr_t per_thread_byte_limit = (cachelines_avail * kCacheline) / calc_thread_ct;
 
@@ -13215,19 +15971,20 @@ PglErr OxBgenToPgen(const char* bgenname, const char* samplename, const char* co
       uint32_t prev_genodata_byte_ct = 0;
       uintptr_t prev_record_byte_ct = 0;
       uint32_t prev_allele_ct = 0;
-      parity = 0;
+      uint32_t buf_idx = 0;
+      uint32_t bgi_idx = 0;
       for (uint32_t vidx_start = 0; ; ) {
         uint32_t cur_block_write_ct = 0;
         if (!IsLastBlock(&tg)) {
           const uint32_t block_vidx_limit = variant_ct - vidx_start;
           cur_thread_block_vidx_limit = MINV(block_vidx_limit, per_thread_block_limit);
           cur_thread_fill_idx = 0;
-          thread_bidxs = ctx.thread_bidxs[parity];
-          GparseRecord* cur_gparse = ctx.gparse[parity];
+          thread_bidxs = ctx.thread_bidxs[buf_idx];
+          GparseRecord* cur_gparse = ctx.gparse[buf_idx];
           if (allele_idx_offsets) {
-            ctx.block_allele_idx_offsets[parity] = &(SpgwGetAlleleIdxOffsets(&spgw)[vidx_start]);
+            ctx.block_allele_idx_offsets[buf_idx] = &(SpgwGetAlleleIdxOffsets(&spgw)[vidx_start]);
           }
-          bgen_geno_iter = compressed_geno_bufs[parity];
+          bgen_geno_iter = compressed_geno_bufs[buf_idx];
           unsigned char* cur_thread_byte_stop = &(bgen_geno_iter[per_thread_byte_limit]);
           thread_bidxs[0] = 0;
           block_vidx = 0;
@@ -13271,6 +16028,14 @@ PglErr OxBgenToPgen(const char* bgenname, const char* samplename, const char* co
               break;
             }
           OxBgenToPgen_load13_start:
+            if (bgi_seek_fposs) {
+              const uint64_t cur_seek_fpos = bgi_seek_fposs[bgi_idx++];
+              if (cur_seek_fpos != UINT64_MAX) {
+                if (unlikely(fseeko(bgenfile, cur_seek_fpos, SEEK_SET))) {
+                  goto OxBgenToPgen_ret_READ_FAIL;
+                }
+              }
+            }
             if (unlikely(!fread_unlocked(&snpid_slen, 2, 1, bgenfile))) {
               goto OxBgenToPgen_ret_READ_FAIL;
             }
@@ -13394,10 +16159,14 @@ PglErr OxBgenToPgen(const char* bgenname, const char* samplename, const char* co
             goto OxBgenToPgen_ret_THREAD_CREATE_FAIL;
           }
         }
-        parity = 1 - parity;
+        const uint32_t prev_buf_idx = (buf_idx? buf_idx : gparse_buf_ct) - 1;
+        if (++buf_idx == gparse_buf_ct) {
+          buf_idx = 0;
+        }
         if (vidx_start) {
-          // write *previous* block results
-          reterr = GparseFlush(ctx.gparse[parity], prev_block_write_ct, &spgw);
+          // write *previous* block results (in the background, if we have a
+          // flush thread)
+          reterr = GparseFlushStart(ctx.gparse[prev_buf_idx], prev_block_write_ct, (vidx_start == variant_ct), &flush_ctx, &flush_tg);
           if (unlikely(reterr)) {
             goto OxBgenToPgen_ret_1;
           }
@@ -13416,6 +16185,10 @@ PglErr OxBgenToPgen(const char* bgenname, const char* samplename, const char* co
         prev_block_write_ct = cur_block_write_ct;
       }
     }
+    reterr = GparseFlushJoin(&flush_ctx, &flush_tg);
+    if (unlikely(reterr)) {
+      goto OxBgenToPgen_ret_1;
+    }
     if (unlikely(CswriteCloseNull(&pvar_css, pvar_cswritep))) {
       goto OxBgenToPgen_ret_WRITE_FAIL;
     }
@@ -13483,6 +16256,7 @@ PglErr OxBgenToPgen(const char* bgenname, const char* samplename, const char* co
     // note that nomem is also possible here
   }
  OxBgenToPgen_ret_1:
+  CleanupThreads(&flush_tg);
   if (common.libdeflate_decompressors) {
     for (uint32_t tidx = 0; tidx != max_thread_ct; ++tidx) {
       if (!common.libdeflate_decompressors[tidx]) {
@@ -13613,9 +16387,269 @@ PglErr ScanHapsForHet(const char* loadbuf_iter, const char* hapsname, uint32_t s
   return reterr;
 }
 
+ENUM_U31_DEF_START()
+  kOxHapsParseOk,
+  kOxHapsParseMissingTokens,
+  kOxHapsParseInvalidToken,
+  kOxHapsParseHaploidToken
+ENUM_U31_DEF_END(OxHapsParseErr);
+
 #ifdef __arm__
-#  error "Unaligned accesses in OxHapslegendToPgen()."
+#  error "Unaligned accesses in OxHapsConvertLine()."
 #endif
+// linebuf_iter must point to the beginning of the first haplotype token, and
+// at least (4 * sample_ct) bytes starting there must be readable; the last of
+// them may be overwritten.  Genotypes are saved in first-haplotype-column =
+// ALT order; caller is responsible for inverting them if necessary.
+// *het_exists_ptr is set iff at least one heterozygous call was seen.
+OxHapsParseErr OxHapsConvertLine(char* linebuf_iter, uint32_t sample_ct, uint32_t is_haploid, uint32_t prov_ref_allele_second, uintptr_t* genovec, uintptr_t* phaseinfo, uint32_t* het_exists_ptr) {
+  const uint32_t sample_ctl2_m1 = NypCtToWordCt(sample_ct) - 1;
+  const uint32_t phaseinfo_match_4char = prov_ref_allele_second? 0x20312030 : 0x20302031;
+  const uint32_t phaseinfo_match = 1 + prov_ref_allele_second;
+  uintptr_t genovec_word_or = 0;
+  uint32_t inner_loop_last = kBitsPerWordD2 - 1;
+  // optimize common case: autosomal diploid, always exactly one space
+  // this loop is time-critical; all my attemps to merge in the haploid
+  // case have caused >10% slowdowns
+  if ((!is_haploid) && (ctou32(linebuf_iter[sample_ct * 4 - 1]) < 32)) {
+    linebuf_iter[sample_ct * 4 - 1] = ' ';
+#ifdef __LP64__
+    const VecU16* linebuf_viter = R_CAST(const VecU16*, linebuf_iter);
+    const VecU16 all0 = vecu16_set1(0x2030);
+    const VecU16 all1 = vecu16_set1(0x2031);
+    const uint32_t fullword_ct = sample_ct / kBitsPerWordD2;
+    Halfword* phaseinfo_alias = R_CAST(Halfword*, phaseinfo);
+    for (uint32_t widx = 0; widx != fullword_ct; ++widx) {
+      uintptr_t geno_first = 0;
+      for (uint32_t uii = 0; uii != 2; ++uii) {
+        VecU16 cur_chars = vecu16_loadu(linebuf_viter);
+        ++linebuf_viter;
+        uintptr_t zero_mm = vecu16_movemask(cur_chars == all0);
+        uintptr_t one_mm = vecu16_movemask(cur_chars == all1);
+        cur_chars = vecu16_loadu(linebuf_viter);
+        ++linebuf_viter;
+        zero_mm |= S_CAST(uintptr_t, vecu16_movemask(cur_chars == all0)) << kBytesPerVec;
+        one_mm |= S_CAST(uintptr_t, vecu16_movemask(cur_chars == all1)) << kBytesPerVec;
+#  ifndef USE_AVX2
+        cur_chars = vecu16_loadu(linebuf_viter);
+        ++linebuf_viter;
+        zero_mm |= S_CAST(uintptr_t, vecu16_movemask(cur_chars == all0)) << 32;
+        one_mm |= S_CAST(uintptr_t, vecu16_movemask(cur_chars == all1)) << 32;
+        cur_chars = vecu16_loadu(linebuf_viter);
+        ++linebuf_viter;
+        zero_mm |= S_CAST(uintptr_t, vecu16_movemask(cur_chars == all0)) << 48;
+        one_mm |= S_CAST(uintptr_t, vecu16_movemask(cur_chars == all1)) << 48;
+#  endif
+        if (unlikely(~(zero_mm | one_mm))) {
+          // todo: other error messages
+          return kOxHapsParseInvalidToken;
+        }
+        geno_first |= S_CAST(uintptr_t, PackWordToHalfwordMask5555(one_mm)) << (uii * 32);
+      }
+      const uintptr_t geno_second = (geno_first >> 1) & kMask5555;
+      geno_first &= kMask5555;
+      const uintptr_t geno_sum = geno_first + geno_second;
+      genovec[widx] = geno_sum;
+      genovec_word_or |= geno_sum;
+      uintptr_t phaseinfo_hw = geno_second & (~geno_first);
+      if (!prov_ref_allele_second) {
+        phaseinfo_hw = geno_first & (~geno_second);
+      }
+      phaseinfo_hw = PackWordToHalfword(phaseinfo_hw);
+      phaseinfo_alias[widx] = phaseinfo_hw;
+    }
+    const uint32_t remainder = sample_ct % kBitsPerWordD2;
+    if (remainder) {
+      const uint32_t* linebuf_alias32_iter = R_CAST(const uint32_t*, linebuf_viter);
+      uintptr_t genovec_word = 0;
+      Halfword phaseinfo_hw = 0;
+      for (uint32_t sample_idx_lowbits = 0; sample_idx_lowbits != remainder; ++sample_idx_lowbits) {
+        uint32_t cur_hap_4char = *linebuf_alias32_iter++;
+        if (unlikely((cur_hap_4char & 0xfffefffeU) != 0x20302030)) {
+          // todo: other error messages
+          return kOxHapsParseInvalidToken;
+        }
+        // bugfix (28 Apr 2019): this needs to be uintptr_t for the next
+        // left-shift to work
+        const uintptr_t new_geno = (cur_hap_4char + (cur_hap_4char >> 16)) & 3;
+        genovec_word |= new_geno << (2 * sample_idx_lowbits);
+        if (cur_hap_4char == phaseinfo_match_4char) {
+          phaseinfo_hw |= 1U << sample_idx_lowbits;
+        }
+      }
+      genovec[fullword_ct] = genovec_word;
+      genovec_word_or |= genovec_word;
+      phaseinfo_alias[fullword_ct] = phaseinfo_hw;
+    }
+#else  // !__LP64__
+    const uint32_t* linebuf_alias32_iter = R_CAST(const uint32_t*, linebuf_iter);
+    for (uint32_t widx = 0; ; ++widx) {
+      if (widx >= sample_ctl2_m1) {
+        if (widx > sample_ctl2_m1) {
+          break;
+        }
+        inner_loop_last = (sample_ct - 1) % kBitsPerWordD2;
+      }
+      uintptr_t genovec_word = 0;
+      uint32_t phaseinfo_hw = 0;
+      for (uint32_t sample_idx_lowbits = 0; sample_idx_lowbits <= inner_loop_last; ++sample_idx_lowbits) {
+        // assumes little-endian
+        uint32_t cur_hap_4char = *linebuf_alias32_iter++;
+        if (unlikely((cur_hap_4char & 0xfffefffeU) != 0x20302030)) {
+          if ((cur_hap_4char & 0xfffffffeU) == 0x202d2030) {
+            // "0 - ", "1 - "
+            return kOxHapsParseHaploidToken;
+          }
+          // any character < 32?
+          if ((((cur_hap_4char & 0xe0e0e0e0U) * 7) & 0x80808080U) != 0x80808080U) {
+            return kOxHapsParseMissingTokens;
+          }
+          return kOxHapsParseInvalidToken;
+        }
+        const uintptr_t new_geno = (cur_hap_4char + (cur_hap_4char >> 16)) & 3;
+        genovec_word |= new_geno << (2 * sample_idx_lowbits);
+        if (cur_hap_4char == phaseinfo_match_4char) {
+          phaseinfo_hw |= 1U << sample_idx_lowbits;
+        }
+      }
+      genovec[widx] = genovec_word;
+      genovec_word_or |= genovec_word;
+      R_CAST(Halfword*, phaseinfo)[widx] = phaseinfo_hw;
+    }
+#endif  // !__LP64__
+  } else {
+    for (uint32_t widx = 0; ; ++widx) {
+      if (widx >= sample_ctl2_m1) {
+        if (widx > sample_ctl2_m1) {
+          break;
+        }
+        inner_loop_last = (sample_ct - 1) % kBitsPerWordD2;
+      }
+      uintptr_t genovec_word = 0;
+      uint32_t phaseinfo_hw = 0;
+      for (uint32_t sample_idx_lowbits = 0; sample_idx_lowbits <= inner_loop_last; ++sample_idx_lowbits) {
+        const uint32_t first_hap_char_code = ctou32(*linebuf_iter);
+        const uint32_t first_hap_int = first_hap_char_code - 48;
+        char* post_first_hap = &(linebuf_iter[1]);
+        if (unlikely((first_hap_int >= 2) || (*post_first_hap != ' '))) {
+          if ((first_hap_char_code <= 32) || (ctou32(*post_first_hap) < 32)) {
+            return kOxHapsParseMissingTokens;
+          }
+          return kOxHapsParseInvalidToken;
+        }
+        char* second_hap = post_first_hap;
+        uint32_t second_hap_char_code;
+        do {
+          second_hap_char_code = ctou32(*(++second_hap));
+        } while (second_hap_char_code == 32);
+        char* post_second_hap = &(second_hap[1]);
+        const uint32_t post_second_hap_char_code = ctou32(*post_second_hap);
+        uint32_t second_hap_int = second_hap_char_code - 48;
+        if ((second_hap_int >= 2) || (post_second_hap_char_code > 32)) {
+          if (likely(is_haploid && (second_hap_char_code == 45))) {
+            // could require --sample, and require this sample to be male
+            // in this case?
+            second_hap_int = first_hap_int;
+          } else {
+            if (second_hap_char_code <= 32) {
+              return kOxHapsParseMissingTokens;
+            }
+            if ((second_hap_char_code == 45) && (post_second_hap_char_code <= 32)) {
+              return kOxHapsParseHaploidToken;
+            }
+            return kOxHapsParseInvalidToken;
+          }
+        }
+        genovec_word |= S_CAST(uintptr_t, first_hap_int + second_hap_int) << (2 * sample_idx_lowbits);
+        if (first_hap_int + 2 * second_hap_int == phaseinfo_match) {
+          phaseinfo_hw |= 1U << sample_idx_lowbits;
+        }
+        linebuf_iter = FirstNonChar(post_second_hap, ' ');
+      }
+      genovec[widx] = genovec_word;
+      genovec_word_or |= genovec_word;
+      R_CAST(Halfword*, phaseinfo)[widx] = phaseinfo_hw;
+    }
+  }
+  *het_exists_ptr = (genovec_word_or & kMask5555) != 0;
+  return kOxHapsParseOk;
+}
+
+typedef struct OxHapsToPgenCtxStruct {
+  uint32_t sample_ct;
+  uint32_t prov_ref_allele_second;
+
+  unsigned char** thread_wkspaces;
+
+  // gparse_buf_ct (2 or kGparseMaxBufCt) sets of these are cycled through
+  uint32_t* thread_bidxs[kGparseMaxBufCt];
+  GparseRecord* gparse[kGparseMaxBufCt];
+  uint32_t gparse_buf_ct;
+
+  OxHapsParseErr* ox_haps_parse_errs;
+  uintptr_t* err_line_idxs;
+  uint32_t parse_failed;
+} OxHapsToPgenCtx;
+
+THREAD_FUNC_DECL OxHapsToPgenThread(void* raw_arg) {
+  ThreadGroupFuncArg* arg = S_CAST(ThreadGroupFuncArg*, raw_arg);
+  const uintptr_t tidx = arg->tidx;
+  OxHapsToPgenCtx* ctx = S_CAST(OxHapsToPgenCtx*, arg->sharedp->context);
+
+  const uint32_t sample_ct = ctx->sample_ct;
+  const uint32_t prov_ref_allele_second = ctx->prov_ref_allele_second;
+  const uintptr_t genovec_byte_ct = NypCtToVecCt(sample_ct) * kBytesPerVec;
+  const uint32_t sample_ctaw = BitCtToAlignedWordCt(sample_ct);
+  // Same layout as a kfGparseHphase record.
+  unsigned char* thread_wkspace = ctx->thread_wkspaces[tidx];
+  uintptr_t* genovec = R_CAST(uintptr_t*, thread_wkspace);
+  uintptr_t* phasepresent = R_CAST(uintptr_t*, &(thread_wkspace[genovec_byte_ct]));
+  uintptr_t* phaseinfo = &(phasepresent[sample_ctaw]);
+  uint32_t buf_idx = 0;
+  OxHapsParseErr ox_haps_parse_err = kOxHapsParseOk;
+  uintptr_t line_idx = 0;
+  // OxHapsConvertLine() writes phaseinfo one halfword at a time
+  phaseinfo[BitCtToWordCt(sample_ct) - 1] = 0;
+  do {
+    const uint32_t bidx_end = ctx->thread_bidxs[buf_idx][tidx + 1];
+    GparseRecord* cur_gparse = ctx->gparse[buf_idx];
+    for (uint32_t bidx = ctx->thread_bidxs[buf_idx][tidx]; bidx != bidx_end; ++bidx) {
+      GparseRecord* grp = &(cur_gparse[bidx]);
+      unsigned char* record_start = grp->record_start;
+      line_idx = grp->metadata.read_text.line_idx;
+      uint32_t het_exists;
+      ox_haps_parse_err = OxHapsConvertLine(R_CAST(char*, record_start), sample_ct, grp->metadata.read_text.is_haploid, prov_ref_allele_second, genovec, phaseinfo, &het_exists);
+      if (unlikely(ox_haps_parse_err)) {
+        goto OxHapsToPgenThread_malformed;
+      }
+      if (prov_ref_allele_second) {
+        GenovecInvertUnsafe(sample_ct, genovec);
+        ZeroTrailingNyps(sample_ct, genovec);
+      }
+      // all heterozygous calls are phased
+      if (het_exists) {
+        PgrDetectGenoarrHets(genovec, sample_ct, phasepresent);
+      }
+      memcpy(record_start, thread_wkspace, GparseWriteByteCt(sample_ct, 2, grp->flags));
+      GparseWriteMetadata* gwmp = &(grp->metadata.write);
+      gwmp->phasepresent_exists = het_exists;
+      gwmp->dosage_ct = 0;
+      gwmp->dphase_ct = 0;
+    }
+    while (0) {
+    OxHapsToPgenThread_malformed:
+      ctx->ox_haps_parse_errs[tidx] = ox_haps_parse_err;
+      ctx->err_line_idxs[tidx] = line_idx;
+      ctx->parse_failed = 1;
+      break;
+    }
+    if (++buf_idx == ctx->gparse_buf_ct) {
+      buf_idx = 0;
+    }
+  } while (!THREAD_BLOCK_FINISH(arg));
+  THREAD_RETURN;
+}
+
 PglErr OxHapslegendToPgen(const char* hapsname, const char* legendname, const char* samplename, const char* ox_single_chr_str, const char* ox_missing_code, MiscFlags misc_flags, ImportFlags import_flags, OxfordImportFlags oxford_import_flags, uint32_t max_thread_ct, char* outname, char* outname_end, ChrInfo* cip) {
   unsigned char* bigstack_mark = g_bigstack_base;
   FILE* psamfile = nullptr;
@@ -13631,6 +16665,13 @@ PglErr OxHapslegendToPgen(const char* hapsname, const char* legendname, const ch
   PreinitTextStream(&haps_txs);
   PreinitTextStream(&legend_txs);
   PreinitSpgw(&spgw);
+  ThreadGroup tg;
+  PreinitThreads(&tg);
+  OxHapsToPgenCtx ctx;
+  ThreadGroup flush_tg;
+  PreinitThreads(&flush_tg);
+  GparseFlushCtx flush_ctx;
+  InitGparseFlush(&spgw, &flush_ctx);
   {
     uint32_t sfile_sample_ct = 0;
     if (samplename[0]) {
@@ -13891,240 +16932,227 @@ PglErr OxHapslegendToPgen(const char* hapsname, const char* legendname, const ch
       if (reterr == kPglRetOpenFail) {
         logerrprintfww(kErrprintfFopen, outname, strerror(errno));
       }
-      goto OxHapslegendToPgen_ret_1;
+      goto OxHapslegendToPgen_ret_1;
+    }
+    unsigned char* spgw_alloc;
+    if (unlikely(bigstack_alloc_uc(spgw_alloc_cacheline_ct * kCacheline, &spgw_alloc))) {
+      goto OxHapslegendToPgen_ret_NOMEM;
+    }
+    SpgwInitPhase2(max_vrec_len, &spgw, spgw_alloc);
+    const uint32_t phase_is_present = at_least_one_het;
+    // .haps parsing is much cheaper than .gen parsing, so the flush thread
+    // usually becomes the bottleneck sooner.
+    uint32_t calc_thread_ct = 1 + (sample_ct > 64) + (sample_ct > 512) + (sample_ct > 4096);
+    // reserve a thread for background .pgen writing when possible
+    const uint32_t flush_thread_ct = (max_thread_ct > 2);
+    if (calc_thread_ct + 1 + flush_thread_ct > max_thread_ct) {
+      calc_thread_ct = MAXV(1, max_thread_ct - 1 - flush_thread_ct);
+    }
+    const uint32_t gparse_buf_ct = GparseFlushSetBackground(flush_thread_ct, &flush_ctx, &flush_tg);
+    ctx.gparse_buf_ct = gparse_buf_ct;
+    if (unlikely(
+            bigstack_alloc_ucp(calc_thread_ct, &ctx.thread_wkspaces) ||
+            bigstack_calloc_w(calc_thread_ct, &ctx.err_line_idxs))) {
+      goto OxHapslegendToPgen_ret_NOMEM;
+    }
+    for (uint32_t buf_idx = 0; buf_idx != gparse_buf_ct; ++buf_idx) {
+      if (unlikely(bigstack_alloc_u32(calc_thread_ct + 1, &(ctx.thread_bidxs[buf_idx])))) {
+        goto OxHapslegendToPgen_ret_NOMEM;
+      }
+    }
+    ctx.ox_haps_parse_errs = S_CAST(OxHapsParseErr*, bigstack_alloc_raw_rd(calc_thread_ct * sizeof(OxHapsParseErr)));
+    if (unlikely(!ctx.ox_haps_parse_errs)) {
+      goto OxHapslegendToPgen_ret_NOMEM;
+    }
+    ctx.sample_ct = sample_ct;
+    ctx.prov_ref_allele_second = prov_ref_allele_second;
+    ctx.parse_failed = 0;
+    for (uint32_t buf_idx = 0; buf_idx != kGparseMaxBufCt; ++buf_idx) {
+      // defensive
+      ctx.gparse[buf_idx] = nullptr;
+    }
+    const GparseFlags gparse_flags = phase_is_present? kfGparseHphase : kfGparse0;
+    // Thread workspaces always have room for phasepresent/phaseinfo, see
+    // OxHapsToPgenThread().
+    const uintptr_t write_byte_ct = GparseWriteByteCt(sample_ct, 2, gparse_flags);
+    const uintptr_t thread_wkspace_cl_ct = DivUp(GparseWriteByteCt(sample_ct, 2, kfGparseHphase), kCacheline);
+    uintptr_t cachelines_avail = bigstack_left() / (6 * kCacheline);
+    if (calc_thread_ct * thread_wkspace_cl_ct > cachelines_avail) {
+      if (unlikely(thread_wkspace_cl_ct > cachelines_avail)) {
+        goto OxHapslegendToPgen_ret_NOMEM;
+      }
+      calc_thread_ct = cachelines_avail / thread_wkspace_cl_ct;
     }
-    unsigned char* spgw_alloc;
-    if (unlikely(bigstack_alloc_uc(spgw_alloc_cacheline_ct * kCacheline, &spgw_alloc))) {
+    for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
+      ctx.thread_wkspaces[tidx] = S_CAST(unsigned char*, bigstack_alloc_raw(thread_wkspace_cl_ct * kCacheline));
+      ctx.ox_haps_parse_errs[tidx] = kOxHapsParseOk;
+    }
+
+    // The first pass doesn't necessarily look at every .haps line, so record
+    // sizes aren't known in advance; a well-formed diploid line occupies
+    // 4 bytes per sample, and we error out below if a single line is too long
+    // for a thread's share of the buffer.
+    const uint32_t min_genotext_blen = 4 * sample_ct;
+    const uintptr_t min_bytes_req_per_variant = sizeof(GparseRecord) + MAXV(write_byte_ct, RoundUpPow2(min_genotext_blen, kBytesPerVec));
+    // be pessimistic re: rounding
+    cachelines_avail = (bigstack_left() / kCacheline) - 4;
+    if (unlikely(cachelines_avail * kCacheline < gparse_buf_ct * (min_bytes_req_per_variant + calc_thread_ct))) {
       goto OxHapslegendToPgen_ret_NOMEM;
     }
-    SpgwInitPhase2(max_vrec_len, &spgw, spgw_alloc);
-    const uint32_t sample_ctl2 = NypCtToWordCt(sample_ct);
-    const uint32_t sample_ctl2_m1 = sample_ctl2 - 1;
-    const uint32_t sample_ctl = BitCtToWordCt(sample_ct);
-    const uint32_t phaseinfo_match_4char = prov_ref_allele_second? 0x20312030 : 0x20302031;
-    const uint32_t phaseinfo_match = 1 + prov_ref_allele_second;
-    uintptr_t* genovec;
-    uintptr_t* phaseinfo;
-    if (unlikely(
-            bigstack_alloc_w(sample_ctl2, &genovec) ||
-            bigstack_alloc_w(sample_ctl, &phaseinfo))) {
+    uint32_t main_block_size = (cachelines_avail * kCacheline) / (min_bytes_req_per_variant * gparse_buf_ct);
+    if (main_block_size > 65536) {
+      main_block_size = 65536;
+    }
+    // divide by 2 for better parallelism in small-variant-count case
+    if (main_block_size > DivUp(variant_ct, 2)) {
+      main_block_size = DivUp(variant_ct, 2) + calc_thread_ct - 1;
+    }
+    const uint32_t per_thread_block_limit = main_block_size / calc_thread_ct;
+    main_block_size = per_thread_block_limit * calc_thread_ct;
+    if (unlikely(SetThreadCt(calc_thread_ct, &tg))) {
       goto OxHapslegendToPgen_ret_NOMEM;
     }
+    for (uint32_t buf_idx = 0; buf_idx != gparse_buf_ct; ++buf_idx) {
+      ctx.gparse[buf_idx] = S_CAST(GparseRecord*, bigstack_alloc_raw_rd(main_block_size * sizeof(GparseRecord)));
+    }
+    SetThreadFuncAndData(OxHapsToPgenThread, &ctx, &tg);
+    unsigned char* geno_bufs[kGparseMaxBufCt];
+    cachelines_avail = bigstack_left() / (kCacheline * gparse_buf_ct);
+    for (uint32_t buf_idx = 0; buf_idx != gparse_buf_ct; ++buf_idx) {
+      geno_bufs[buf_idx] = S_CAST(unsigned char*, bigstack_alloc_raw(cachelines_avail * kCacheline));
+    }
+    const uintptr_t per_thread_byte_limit = (cachelines_avail * kCacheline) / calc_thread_ct;
 
+    // Same block pipeline as OxGenToPgen().
+    uint32_t prev_block_write_ct = 0;
+    const char* genotext_start = nullptr;
+    uintptr_t genotext_byte_ct = 0;
+    uintptr_t record_byte_ct = 0;
+    uintptr_t genotext_line_idx = 0;
+    uint32_t genotext_is_haploid = is_haploid;
+    uint32_t buf_idx = 0;
     char* haps_line_iter = TextLineEnd(&haps_txs);
-    for (uint32_t vidx = 0; vidx != variant_ct; ) {
-      ++line_idx_haps;
-      reterr = TextGetUnsafe(&haps_txs, &haps_line_iter);
-      if (unlikely(reterr)) {
-        if ((reterr == kPglRetEof) && (line_idx_haps > 1) && (legendname[0])) {
-          snprintf(g_logbuf, kLogbufSize, "Error: %s has fewer nonheader lines than %s.\n", hapsname, legendname);
-          goto OxHapslegendToPgen_ret_INCONSISTENT_INPUT_WW;
-        }
-        goto OxHapslegendToPgen_ret_TSTREAM_REWIND_FAIL_HAPS;
-      }
-      char* linebuf_iter = haps_line_iter;
-      if (!legendname[0]) {
-        char* chr_code_end = CurTokenEnd(haps_line_iter);
-        const uint32_t cur_chr_code = GetChrCodeCounted(cip, chr_code_end - haps_line_iter, haps_line_iter);
-        if (!IsSet(cip->chr_mask, cur_chr_code)) {
-          haps_line_iter = AdvPastDelim(haps_line_iter, '\n');
-          continue;
-        }
-        is_haploid = IsSet(cip->haploid_mask, cur_chr_code);
-        linebuf_iter = NextTokenMult(FirstNonTspace(chr_code_end), 4);
-        if (unlikely(!linebuf_iter)) {
-          goto OxHapslegendToPgen_ret_MISSING_TOKENS_HAPS;
-        }
-      }
-      uintptr_t genovec_word_or = 0;
-      uint32_t inner_loop_last = kBitsPerWordD2 - 1;
-      // optimize common case: autosomal diploid, always exactly one space
-      // this loop is time-critical; all my attemps to merge in the haploid
-      // case have caused >10% slowdowns
-      if ((!is_haploid) && (ctou32(linebuf_iter[sample_ct * 4 - 1]) < 32)) {
-        haps_line_iter = AdvPastDelim(&(linebuf_iter[sample_ct * 4 - 1]), '\n');
-        linebuf_iter[sample_ct * 4 - 1] = ' ';
-#ifdef __LP64__
-        const VecU16* linebuf_viter = R_CAST(const VecU16*, linebuf_iter);
-        const VecU16 all0 = vecu16_set1(0x2030);
-        const VecU16 all1 = vecu16_set1(0x2031);
-        const uint32_t fullword_ct = sample_ct / kBitsPerWordD2;
-        Halfword* phaseinfo_alias = R_CAST(Halfword*, phaseinfo);
-        for (uint32_t widx = 0; widx != fullword_ct; ++widx) {
-          uintptr_t geno_first = 0;
-          for (uint32_t uii = 0; uii != 2; ++uii) {
-            VecU16 cur_chars = vecu16_loadu(linebuf_viter);
-            ++linebuf_viter;
-            uintptr_t zero_mm = vecu16_movemask(cur_chars == all0);
-            uintptr_t one_mm = vecu16_movemask(cur_chars == all1);
-            cur_chars = vecu16_loadu(linebuf_viter);
-            ++linebuf_viter;
-            zero_mm |= S_CAST(uintptr_t, vecu16_movemask(cur_chars == all0)) << kBytesPerVec;
-            one_mm |= S_CAST(uintptr_t, vecu16_movemask(cur_chars == all1)) << kBytesPerVec;
-#  ifndef USE_AVX2
-            cur_chars = vecu16_loadu(linebuf_viter);
-            ++linebuf_viter;
-            zero_mm |= S_CAST(uintptr_t, vecu16_movemask(cur_chars == all0)) << 32;
-            one_mm |= S_CAST(uintptr_t, vecu16_movemask(cur_chars == all1)) << 32;
-            cur_chars = vecu16_loadu(linebuf_viter);
-            ++linebuf_viter;
-            zero_mm |= S_CAST(uintptr_t, vecu16_movemask(cur_chars == all0)) << 48;
-            one_mm |= S_CAST(uintptr_t, vecu16_movemask(cur_chars == all1)) << 48;
-#  endif
-            if (unlikely(~(zero_mm | one_mm))) {
-              // todo: other error messages
-              snprintf(g_logbuf, kLogbufSize, "Error: Invalid token on line %" PRIuPTR " of %s.\n", line_idx_haps, hapsname);
-              goto OxHapslegendToPgen_ret_MALFORMED_INPUT_WW;
-            }
-            geno_first |= S_CAST(uintptr_t, PackWordToHalfwordMask5555(one_mm)) << (uii * 32);
-          }
-          const uintptr_t geno_second = (geno_first >> 1) & kMask5555;
-          geno_first &= kMask5555;
-          const uintptr_t geno_sum = geno_first + geno_second;
-          genovec[widx] = geno_sum;
-          genovec_word_or |= geno_sum;
-          uintptr_t phaseinfo_hw = geno_second & (~geno_first);
-          if (!prov_ref_allele_second) {
-            phaseinfo_hw = geno_first & (~geno_second);
-          }
-          phaseinfo_hw = PackWordToHalfword(phaseinfo_hw);
-          phaseinfo_alias[widx] = phaseinfo_hw;
-        }
-        const uint32_t remainder = sample_ct % kBitsPerWordD2;
-        if (remainder) {
-          const uint32_t* linebuf_alias32_iter = R_CAST(const uint32_t*, linebuf_viter);
-          uintptr_t genovec_word = 0;
-          Halfword phaseinfo_hw = 0;
-          for (uint32_t sample_idx_lowbits = 0; sample_idx_lowbits != remainder; ++sample_idx_lowbits) {
-            uint32_t cur_hap_4char = *linebuf_alias32_iter++;
-            if (unlikely((cur_hap_4char & 0xfffefffeU) != 0x20302030)) {
-              // todo: other error messages
-              snprintf(g_logbuf, kLogbufSize, "Error: Invalid token on line %" PRIuPTR " of %s.\n", line_idx_haps, hapsname);
-              goto OxHapslegendToPgen_ret_MALFORMED_INPUT_WW;
-            }
-            // bugfix (28 Apr 2019): this needs to be uintptr_t for the next
-            // left-shift to work
-            const uintptr_t new_geno = (cur_hap_4char + (cur_hap_4char >> 16)) & 3;
-            genovec_word |= new_geno << (2 * sample_idx_lowbits);
-            if (cur_hap_4char == phaseinfo_match_4char) {
-              phaseinfo_hw |= 1U << sample_idx_lowbits;
-            }
-          }
-          genovec[fullword_ct] = genovec_word;
-          genovec_word_or |= genovec_word;
-          phaseinfo_alias[fullword_ct] = phaseinfo_hw;
+    for (uint32_t vidx_start = 0; ; ) {
+      uint32_t cur_block_write_ct = 0;
+      if (!IsLastBlock(&tg)) {
+        const uint32_t block_vidx_limit = variant_ct - vidx_start;
+        uint32_t cur_thread_block_vidx_limit = MINV(block_vidx_limit, per_thread_block_limit);
+        uint32_t cur_thread_fill_idx = 0;
+        uint32_t* thread_bidxs = ctx.thread_bidxs[buf_idx];
+        GparseRecord* cur_gparse = ctx.gparse[buf_idx];
+        unsigned char* geno_buf_iter = geno_bufs[buf_idx];
+        unsigned char* cur_thread_byte_stop = &(geno_buf_iter[per_thread_byte_limit]);
+        thread_bidxs[0] = 0;
+        uint32_t block_vidx = 0;
+        if (!genotext_byte_ct) {
+          goto OxHapslegendToPgen_load_start;
         }
-#else  // !__LP64__
-        const uint32_t* linebuf_alias32_iter = R_CAST(const uint32_t*, linebuf_iter);
-        for (uint32_t widx = 0; ; ++widx) {
-          if (widx >= sample_ctl2_m1) {
-            if (widx > sample_ctl2_m1) {
-              break;
+        // we may stop before main_block_size due to insufficient space in
+        // geno_bufs[buf_idx].  if so, we copy over the genotype part of the
+        // current line before proceeding.
+        while (1) {
+          {
+            GparseRecord* grp = &(cur_gparse[block_vidx]);
+            grp->record_start = geno_buf_iter;
+            grp->flags = gparse_flags;
+            grp->metadata.read_text.line_idx = genotext_line_idx;
+            grp->metadata.read_text.is_haploid = genotext_is_haploid;
+            memcpy(geno_buf_iter, genotext_start, genotext_byte_ct);
+            if (genotext_byte_ct < min_genotext_blen) {
+              // keep OxHapsConvertLine() off its fixed-width fast path
+              geno_buf_iter[min_genotext_blen - 1] = ' ';
             }
-            inner_loop_last = (sample_ct - 1) % kBitsPerWordD2;
-          }
-          uintptr_t genovec_word = 0;
-          uint32_t phaseinfo_hw = 0;
-          for (uint32_t sample_idx_lowbits = 0; sample_idx_lowbits <= inner_loop_last; ++sample_idx_lowbits) {
-            // assumes little-endian
-            uint32_t cur_hap_4char = *linebuf_alias32_iter++;
-            if (unlikely((cur_hap_4char & 0xfffefffeU) != 0x20302030)) {
-              if ((cur_hap_4char & 0xfffffffeU) == 0x202d2030) {
-                // "0 - ", "1 - "
-                goto OxHapslegendToPgen_ret_HAPLOID_TOKEN;
-              }
-              // any character < 32?
-              if ((((cur_hap_4char & 0xe0e0e0e0U) * 7) & 0x80808080U) != 0x80808080U) {
-                goto OxHapslegendToPgen_ret_MISSING_TOKENS_HAPS;
+            geno_buf_iter = &(geno_buf_iter[record_byte_ct]);
+            ++block_vidx;
+            if (block_vidx == block_vidx_limit) {
+              for (; cur_thread_fill_idx != calc_thread_ct; ) {
+                thread_bidxs[++cur_thread_fill_idx] = block_vidx;
               }
-              snprintf(g_logbuf, kLogbufSize, "Error: Invalid token on line %" PRIuPTR " of %s.\n", line_idx_haps, hapsname);
-              goto OxHapslegendToPgen_ret_MALFORMED_INPUT_WW;
-            }
-            const uintptr_t new_geno = (cur_hap_4char + (cur_hap_4char >> 16)) & 3;
-            genovec_word |= new_geno << (2 * sample_idx_lowbits);
-            if (cur_hap_4char == phaseinfo_match_4char) {
-              phaseinfo_hw |= 1U << sample_idx_lowbits;
-            }
-          }
-          genovec[widx] = genovec_word;
-          genovec_word_or |= genovec_word;
-          R_CAST(Halfword*, phaseinfo)[widx] = phaseinfo_hw;
-        }
-#endif  // !__LP64__
-      } else {
-        for (uint32_t widx = 0; ; ++widx) {
-          if (widx >= sample_ctl2_m1) {
-            if (widx > sample_ctl2_m1) {
               break;
             }
-            inner_loop_last = (sample_ct - 1) % kBitsPerWordD2;
           }
-          uintptr_t genovec_word = 0;
-          uint32_t phaseinfo_hw = 0;
-          for (uint32_t sample_idx_lowbits = 0; sample_idx_lowbits <= inner_loop_last; ++sample_idx_lowbits) {
-            const uint32_t first_hap_char_code = ctou32(*linebuf_iter);
-            const uint32_t first_hap_int = first_hap_char_code - 48;
-            char* post_first_hap = &(linebuf_iter[1]);
-            if (unlikely((first_hap_int >= 2) || (*post_first_hap != ' '))) {
-              if ((first_hap_char_code <= 32) || (ctou32(*post_first_hap) < 32)) {
-                goto OxHapslegendToPgen_ret_MISSING_TOKENS_HAPS;
+        OxHapslegendToPgen_load_start:
+          do {
+            ++line_idx_haps;
+            reterr = TextGetUnsafe(&haps_txs, &haps_line_iter);
+            if (unlikely(reterr)) {
+              if ((reterr == kPglRetEof) && (line_idx_haps > 1) && (legendname[0])) {
+                snprintf(g_logbuf, kLogbufSize, "Error: %s has fewer nonheader lines than %s.\n", hapsname, legendname);
+                goto OxHapslegendToPgen_ret_INCONSISTENT_INPUT_WW;
               }
-              snprintf(g_logbuf, kLogbufSize, "Error: Invalid token on line %" PRIuPTR " of %s.\n", line_idx_haps, hapsname);
-              goto OxHapslegendToPgen_ret_MALFORMED_INPUT_WW;
+              goto OxHapslegendToPgen_ret_TSTREAM_REWIND_FAIL_HAPS;
             }
-            char* second_hap = post_first_hap;
-            uint32_t second_hap_char_code;
-            do {
-              second_hap_char_code = ctou32(*(++second_hap));
-            } while (second_hap_char_code == 32);
-            char* post_second_hap = &(second_hap[1]);
-            const uint32_t post_second_hap_char_code = ctou32(*post_second_hap);
-            uint32_t second_hap_int = second_hap_char_code - 48;
-            if ((second_hap_int >= 2) || (post_second_hap_char_code > 32)) {
-              if (likely(is_haploid && (second_hap_char_code == 45))) {
-                // could require --sample, and require this sample to be male
-                // in this case?
-                second_hap_int = first_hap_int;
-              } else {
-                if (second_hap_char_code <= 32) {
-                  goto OxHapslegendToPgen_ret_MISSING_TOKENS_HAPS;
-                }
-                if ((second_hap_char_code == 45) && (post_second_hap_char_code <= 32)) {
-                  goto OxHapslegendToPgen_ret_HAPLOID_TOKEN;
-                }
-                snprintf(g_logbuf, kLogbufSize, "Error: Invalid token on line %" PRIuPTR " of %s.\n", line_idx_haps, hapsname);
-                goto OxHapslegendToPgen_ret_MALFORMED_INPUT_WW;
+            genotext_start = haps_line_iter;
+            if (!legendname[0]) {
+              char* chr_code_end = CurTokenEnd(haps_line_iter);
+              const uint32_t cur_chr_code = GetChrCodeCounted(cip, chr_code_end - haps_line_iter, haps_line_iter);
+              if (!IsSet(cip->chr_mask, cur_chr_code)) {
+                haps_line_iter = AdvPastDelim(haps_line_iter, '\n');
+                continue;
+              }
+              genotext_is_haploid = IsSet(cip->haploid_mask, cur_chr_code);
+              genotext_start = NextTokenMult(FirstNonTspace(chr_code_end), 4);
+              if (unlikely(!genotext_start)) {
+                goto OxHapslegendToPgen_ret_MISSING_TOKENS_HAPS;
               }
             }
-            genovec_word |= S_CAST(uintptr_t, first_hap_int + second_hap_int) << (2 * sample_idx_lowbits);
-            if (first_hap_int + 2 * second_hap_int == phaseinfo_match) {
-              phaseinfo_hw |= 1U << sample_idx_lowbits;
+            haps_line_iter = AdvPastDelim(K_CAST(char*, genotext_start), '\n');
+            break;
+          } while (1);
+          genotext_line_idx = line_idx_haps;
+          genotext_byte_ct = haps_line_iter - genotext_start;
+          record_byte_ct = MAXV(RoundUpPow2(MAXV(genotext_byte_ct, min_genotext_blen), kBytesPerVec), write_byte_ct);
+          if (unlikely(record_byte_ct > per_thread_byte_limit)) {
+            goto OxHapslegendToPgen_ret_NOMEM;
+          }
+          if ((block_vidx == cur_thread_block_vidx_limit) || (S_CAST(uintptr_t, cur_thread_byte_stop - geno_buf_iter) < record_byte_ct)) {
+            thread_bidxs[++cur_thread_fill_idx] = block_vidx;
+            if (cur_thread_fill_idx == calc_thread_ct) {
+              break;
             }
-            linebuf_iter = FirstNonChar(post_second_hap, ' ');
+            cur_thread_byte_stop = &(cur_thread_byte_stop[per_thread_byte_limit]);
+            cur_thread_block_vidx_limit = MINV(cur_thread_block_vidx_limit + per_thread_block_limit, block_vidx_limit);
           }
-          genovec[widx] = genovec_word;
-          genovec_word_or |= genovec_word;
-          R_CAST(Halfword*, phaseinfo)[widx] = phaseinfo_hw;
         }
-        haps_line_iter = AdvPastDelim(linebuf_iter, '\n');
+        cur_block_write_ct = block_vidx;
       }
-      if (prov_ref_allele_second) {
-        GenovecInvertUnsafe(sample_ct, genovec);
-        ZeroTrailingNyps(sample_ct, genovec);
+      if (vidx_start) {
+        JoinThreads(&tg);
+        if (unlikely(ctx.parse_failed)) {
+          goto OxHapslegendToPgen_ret_THREAD_PARSE;
+        }
       }
-      if (genovec_word_or & kMask5555) {
-        if (unlikely(SpgwAppendBiallelicGenovecHphase(genovec, nullptr, phaseinfo, &spgw))) {
-          goto OxHapslegendToPgen_ret_WRITE_FAIL;
+      if (!IsLastBlock(&tg)) {
+        if (vidx_start + cur_block_write_ct == variant_ct) {
+          DeclareLastThreadBlock(&tg);
         }
-      } else {
-        if (unlikely(SpgwAppendBiallelicGenovec(genovec, &spgw))) {
-          goto OxHapslegendToPgen_ret_WRITE_FAIL;
+        if (unlikely(SpawnThreads(&tg))) {
+          goto OxHapslegendToPgen_ret_THREAD_CREATE_FAIL;
+        }
+      }
+      const uint32_t prev_buf_idx = (buf_idx? buf_idx : gparse_buf_ct) - 1;
+      if (++buf_idx == gparse_buf_ct) {
+        buf_idx = 0;
+      }
+      if (vidx_start) {
+        reterr = GparseFlushStart(ctx.gparse[prev_buf_idx], prev_block_write_ct, (vidx_start == variant_ct), &flush_ctx, &flush_tg);
+        if (unlikely(reterr)) {
+          goto OxHapslegendToPgen_ret_1;
         }
       }
-      if (!(++vidx % 1000)) {
-        printf("\r--haps%s: %uk variants converted.", legendname[0]? " + --legend" : "", vidx / 1000);
+      if (vidx_start == variant_ct) {
+        break;
+      }
+      if (vidx_start) {
+        printf("\r--haps%s: %uk variants converted.", legendname[0]? " + --legend" : "", vidx_start / 1000);
         fflush(stdout);
       }
+      vidx_start += cur_block_write_ct;
+      prev_block_write_ct = cur_block_write_ct;
+    }
+    reterr = GparseFlushJoin(&flush_ctx, &flush_tg);
+    if (unlikely(reterr)) {
+      goto OxHapslegendToPgen_ret_1;
     }
     SpgwFinish(&spgw);
     putc_unlocked('\r', stdout);
@@ -14173,6 +17201,28 @@ PglErr OxHapslegendToPgen(const char* hapsname, const char* legendname, const ch
   OxHapslegendToPgen_ret_INVALID_CMDLINE:
     reterr = kPglRetInvalidCmdline;
     break;
+  OxHapslegendToPgen_ret_THREAD_CREATE_FAIL:
+    reterr = kPglRetThreadCreateFail;
+    break;
+  OxHapslegendToPgen_ret_THREAD_PARSE:
+    {
+      OxHapsParseErr ox_haps_parse_err = kOxHapsParseOk;
+      for (uint32_t tidx = 0; ; ++tidx) {
+        ox_haps_parse_err = ctx.ox_haps_parse_errs[tidx];
+        if (ox_haps_parse_err) {
+          line_idx_haps = ctx.err_line_idxs[tidx];
+          break;
+        }
+      }
+      if (ox_haps_parse_err == kOxHapsParseHaploidToken) {
+        goto OxHapslegendToPgen_ret_HAPLOID_TOKEN;
+      }
+      if (ox_haps_parse_err == kOxHapsParseMissingTokens) {
+        goto OxHapslegendToPgen_ret_MISSING_TOKENS_HAPS;
+      }
+      snprintf(g_logbuf, kLogbufSize, "Error: Invalid token on line %" PRIuPTR " of %s.\n", line_idx_haps, hapsname);
+      goto OxHapslegendToPgen_ret_MALFORMED_INPUT_WW;
+    }
   OxHapslegendToPgen_ret_MISSING_TOKENS_HAPS:
     snprintf(g_logbuf, kLogbufSize, "Error: Line %" PRIuPTR " of %s has fewer tokens than expected.\n", line_idx_haps, hapsname);
   OxHapslegendToPgen_ret_MALFORMED_INPUT_WW:
@@ -14204,7 +17254,9 @@ PglErr OxHapslegendToPgen(const char* hapsname, const char* legendname, const ch
     break;
   }
  OxHapslegendToPgen_ret_1:
+  CleanupThreads(&flush_tg);
   CleanupSpgw(&spgw, &reterr);
+  CleanupThreads(&tg);
   CleanupTextStream2(legendname, &legend_txs, &reterr);
   CleanupTextStream2(hapsname, &haps_txs, &reterr);
   fclose_cond(psamfile);
@@ -14465,8 +17517,224 @@ PglErr LoadMap(const char* mapname, MiscFlags misc_flags, ChrInfo* cip, uint32_t
   return reterr;
 }
 
-// probable todo: use the VCF/BGEN-import parallelization strategy to speed
-// this up.
+ENUM_U31_DEF_START()
+  kPlink1DosageParseOk,
+  kPlink1DosageParseMissingTokens,
+  kPlink1DosageParseInvalidNumeric
+ENUM_U31_DEF_END(Plink1DosageParseErr);
+
+typedef struct Plink1DosageToPgenCtxStruct {
+  uint32_t sample_ct;
+  uint32_t format_single;
+  uint32_t format_triple;
+  uint32_t prov_ref_allele_second;
+  double dosage_multiplier;
+  double dosage_ceil;
+  double import_dosage_certainty;
+  uint32_t hard_call_halfdist;
+  uint32_t dosage_erase_halfdist;
+  uint32_t force_missing_halfdist_p1;
+
+  unsigned char** thread_wkspaces;
+
+  // gparse_buf_ct (2 or kGparseMaxBufCt) sets of these are cycled through
+  uint32_t* thread_bidxs[kGparseMaxBufCt];
+  GparseRecord* gparse[kGparseMaxBufCt];
+  uint32_t gparse_buf_ct;
+
+  Plink1DosageParseErr* plink1_dosage_parse_errs;
+  uintptr_t* err_line_idxs;
+  // null-terminated in-place, for kPlink1DosageParseInvalidNumeric
+  char** err_tokens;
+  uint32_t parse_failed;
+} Plink1DosageToPgenCtx;
+
+THREAD_FUNC_DECL Plink1DosageToPgenThread(void* raw_arg) {
+  ThreadGroupFuncArg* arg = S_CAST(ThreadGroupFuncArg*, raw_arg);
+  const uintptr_t tidx = arg->tidx;
+  Plink1DosageToPgenCtx* ctx = S_CAST(Plink1DosageToPgenCtx*, arg->sharedp->context);
+
+  const uint32_t sample_ct = ctx->sample_ct;
+  const uint32_t format_single = ctx->format_single;
+  const uint32_t format_triple = ctx->format_triple;
+  const uint32_t prov_ref_allele_second = ctx->prov_ref_allele_second;
+  const double dosage_multiplier = ctx->dosage_multiplier;
+  const double dosage_ceil = ctx->dosage_ceil;
+  const double import_dosage_certainty = ctx->import_dosage_certainty;
+  const uint32_t hard_call_halfdist = ctx->hard_call_halfdist;
+  const uint32_t dosage_erase_halfdist = ctx->dosage_erase_halfdist;
+  const uint32_t force_missing_halfdist_p1 = ctx->force_missing_halfdist_p1;
+  const uint32_t sample_ctl2_m1 = NypCtToWordCt(sample_ct) - 1;
+  const uintptr_t genovec_byte_ct = NypCtToVecCt(sample_ct) * kBytesPerVec;
+  // As in OxGenToPgenThread(), the workspace always has room for the dosage
+  // track.
+  unsigned char* thread_wkspace = ctx->thread_wkspaces[tidx];
+  uintptr_t* genovec = R_CAST(uintptr_t*, thread_wkspace);
+  uintptr_t* dosage_present = R_CAST(uintptr_t*, &(thread_wkspace[genovec_byte_ct]));
+  Dosage* dosage_main = R_CAST(Dosage*, &(dosage_present[BitCtToAlignedWordCt(sample_ct)]));
+  uint32_t buf_idx = 0;
+  Plink1DosageParseErr parse_err = kPlink1DosageParseOk;
+  uintptr_t line_idx = 0;
+  char* linebuf_iter = nullptr;
+  // dosage_present is written one halfword at a time
+  dosage_present[BitCtToWordCt(sample_ct) - 1] = 0;
+  do {
+    const uint32_t bidx_end = ctx->thread_bidxs[buf_idx][tidx + 1];
+    GparseRecord* cur_gparse = ctx->gparse[buf_idx];
+    for (uint32_t bidx = ctx->thread_bidxs[buf_idx][tidx]; bidx != bidx_end; ++bidx) {
+      GparseRecord* grp = &(cur_gparse[bidx]);
+      unsigned char* record_start = grp->record_start;
+      line_idx = grp->metadata.read_text.line_idx;
+      linebuf_iter = R_CAST(char*, record_start);
+      uint32_t inner_loop_last = kBitsPerWordD2 - 1;
+      Dosage* dosage_main_iter = dosage_main;
+      for (uint32_t widx = 0; ; ++widx) {
+        if (widx >= sample_ctl2_m1) {
+          if (widx > sample_ctl2_m1) {
+            break;
+          }
+          inner_loop_last = (sample_ct - 1) % kBitsPerWordD2;
+        }
+        uintptr_t genovec_word = 0;
+        uint32_t dosage_present_hw = 0;
+        if (format_single) {
+          for (uint32_t sample_idx_lowbits = 0; sample_idx_lowbits <= inner_loop_last; ++sample_idx_lowbits) {
+            if (unlikely(IsEolnKns(*linebuf_iter))) {
+              goto Plink1DosageToPgenThread_missing_tokens;
+            }
+            double a1_dosage;
+            char* str_end = ScanadvDouble(linebuf_iter, &a1_dosage);
+            if ((!str_end) || (a1_dosage < 0.0) || (a1_dosage > dosage_ceil)) {
+              genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
+              linebuf_iter = FirstNonTspace(CurTokenEnd(linebuf_iter));
+              continue;
+            }
+            if (unlikely(!IsSpaceOrEoln(*str_end))) {
+              goto Plink1DosageToPgenThread_invalid_numeric;
+            }
+            linebuf_iter = FirstNonTspace(str_end);
+            uint32_t dosage_int = S_CAST(int32_t, a1_dosage * dosage_multiplier + 0.5);
+            if (dosage_int > kDosageMax) {
+              dosage_int = kDosageMax;
+            }
+            const uint32_t cur_halfdist = BiallelicDosageHalfdist(dosage_int);
+            if (cur_halfdist < hard_call_halfdist) {
+              genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
+              if (cur_halfdist < force_missing_halfdist_p1) {
+                continue;
+              }
+            } else {
+              genovec_word |= ((dosage_int + (kDosage4th * k1LU)) / kDosageMid) << (2 * sample_idx_lowbits);
+              if (cur_halfdist >= dosage_erase_halfdist) {
+                continue;
+              }
+            }
+            dosage_present_hw |= 1U << sample_idx_lowbits;
+            *dosage_main_iter++ = dosage_int;
+          }
+        } else {
+          for (uint32_t sample_idx_lowbits = 0; sample_idx_lowbits <= inner_loop_last; ++sample_idx_lowbits) {
+            if (unlikely(!linebuf_iter)) {
+              goto Plink1DosageToPgenThread_missing_tokens;
+            }
+            double prob_2a1;
+            char* str_end = ScanadvDouble(linebuf_iter, &prob_2a1);
+            if (!str_end) {
+              genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
+              linebuf_iter = NextTokenMult(linebuf_iter, 2 + format_triple);
+              continue;
+            }
+            if (unlikely(!IsSpaceOrEoln(*str_end))) {
+              goto Plink1DosageToPgenThread_invalid_numeric;
+            }
+            linebuf_iter = FirstNonTspace(str_end);
+            if (unlikely(IsEolnKns(*linebuf_iter))) {
+              goto Plink1DosageToPgenThread_missing_tokens;
+            }
+            double prob_1a1;
+            str_end = ScanadvDouble(linebuf_iter, &prob_1a1);
+            if (!str_end) {
+              genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
+              linebuf_iter = NextTokenMult(linebuf_iter, 1 + format_triple);
+              continue;
+            }
+            if (unlikely(!IsSpaceOrEoln(*str_end))) {
+              goto Plink1DosageToPgenThread_invalid_numeric;
+            }
+            linebuf_iter = NextTokenMult(str_end, 1 + format_triple);
+            double prob_one_or_two_a1 = prob_2a1 + prob_1a1;
+            if ((prob_2a1 < 0.0) || (prob_1a1 < 0.0) || (prob_one_or_two_a1 > 1.01 * (1 + kSmallEpsilon))) {
+              genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
+              continue;
+            }
+            if (prob_one_or_two_a1 > 1.0) {
+              const double rescale = 1.0 / prob_one_or_two_a1;
+              prob_2a1 *= rescale;
+              prob_1a1 *= rescale;
+              prob_one_or_two_a1 = 1.0;
+            }
+            if ((prob_2a1 < import_dosage_certainty) && (prob_1a1 < import_dosage_certainty) && (prob_one_or_two_a1 > 1.0 - import_dosage_certainty)) {
+              genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
+            }
+            const uint32_t dosage_int = S_CAST(int32_t, prob_2a1 * 32768 + prob_1a1 * 16384 + 0.5);
+            const uint32_t cur_halfdist = BiallelicDosageHalfdist(dosage_int);
+            if (cur_halfdist < hard_call_halfdist) {
+              genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
+            } else {
+              genovec_word |= ((dosage_int + (kDosage4th * k1LU)) / kDosageMid) << (2 * sample_idx_lowbits);
+              if (cur_halfdist >= dosage_erase_halfdist) {
+                continue;
+              }
+            }
+            dosage_present_hw |= 1U << sample_idx_lowbits;
+            *dosage_main_iter++ = dosage_int;
+          }
+        }
+        genovec[widx] = genovec_word;
+        R_CAST(Halfword*, dosage_present)[widx] = dosage_present_hw;
+      }
+      uint32_t dosage_ct = dosage_main_iter - dosage_main;
+      if (!prov_ref_allele_second) {
+        GenovecInvertUnsafe(sample_ct, genovec);
+        ZeroTrailingNyps(sample_ct, genovec);
+        if (dosage_ct) {
+          BiallelicDosage16Invert(dosage_ct, dosage_main);
+        }
+      }
+      if (!(grp->flags & kfGparseDosage)) {
+        // first pass determined that no dosages need to be saved
+        dosage_ct = 0;
+      }
+      memcpy(record_start, thread_wkspace, GparseWriteByteCt(sample_ct, 2, grp->flags));
+      GparseWriteMetadata* gwmp = &(grp->metadata.write);
+      gwmp->phasepresent_exists = 0;
+      gwmp->dosage_ct = dosage_ct;
+      gwmp->dphase_ct = 0;
+    }
+    while (0) {
+    Plink1DosageToPgenThread_invalid_numeric:
+      {
+        char* token_end = CurTokenEnd(linebuf_iter);
+        *token_end = '\0';
+        ctx->err_tokens[tidx] = linebuf_iter;
+        parse_err = kPlink1DosageParseInvalidNumeric;
+        goto Plink1DosageToPgenThread_malformed;
+      }
+    Plink1DosageToPgenThread_missing_tokens:
+      parse_err = kPlink1DosageParseMissingTokens;
+    Plink1DosageToPgenThread_malformed:
+      ctx->plink1_dosage_parse_errs[tidx] = parse_err;
+      ctx->err_line_idxs[tidx] = line_idx;
+      ctx->parse_failed = 1;
+      break;
+    }
+    if (++buf_idx == ctx->gparse_buf_ct) {
+      buf_idx = 0;
+    }
+  } while (!THREAD_BLOCK_FINISH(arg));
+  THREAD_RETURN;
+}
+
 static_assert(sizeof(Dosage) == 2, "Plink1DosageToPgen() needs to be updated.");
 PglErr Plink1DosageToPgen(const char* dosagename, const char* famname, const char* mapname, const char* import_single_chr_str, const Plink1DosageInfo* pdip, MiscFlags misc_flags, ImportFlags import_flags, FamCol fam_cols, int32_t missing_pheno, uint32_t hard_call_thresh, uint32_t dosage_erase_thresh, double import_dosage_certainty, uint32_t max_thread_ct, char* outname, char* outname_end, ChrInfo* cip) {
   unsigned char* bigstack_mark = g_bigstack_base;
@@ -14490,6 +17758,13 @@ PglErr Plink1DosageToPgen(const char* dosagename, const char* famname, const cha
   PreinitTextFile(&dosage_txf);
   PreinitTextStream(&dosage_txs);
   PreinitSpgw(&spgw);
+  ThreadGroup tg;
+  PreinitThreads(&tg);
+  Plink1DosageToPgenCtx ctx;
+  ThreadGroup flush_tg;
+  PreinitThreads(&flush_tg);
+  GparseFlushCtx flush_ctx;
+  InitGparseFlush(&spgw, &flush_ctx);
   {
     // 1. Read .fam file.  (May as well support most .psam files too, since
     //    it's the same driver function.  However, unless 'noheader' modifier
@@ -15098,7 +18373,6 @@ PglErr Plink1DosageToPgen(const char* dosagename, const char* famname, const cha
       goto Plink1DosageToPgen_ret_TSTREAM_REWIND1_FAIL;
     }
     line_iter = TextLineEnd(&dosage_txs);
-    const uintptr_t line_ct = line_idx - 1;
     line_idx = 0;
     if (!(flags & kfPlink1DosageNoheader)) {
       // skip header line again
@@ -15125,21 +18399,6 @@ PglErr Plink1DosageToPgen(const char* dosagename, const char* famname, const cha
     }
     SpgwInitPhase2(max_vrec_len, &spgw, spgw_alloc);
 
-    const uint32_t sample_ctl2 = NypCtToWordCt(sample_ct);
-    const uint32_t sample_ctl = BitCtToWordCt(sample_ct);
-    uintptr_t* genovec;
-    uintptr_t* dosage_present;
-    if (unlikely(
-            bigstack_alloc_w(sample_ctl2, &genovec) ||
-            bigstack_alloc_w(sample_ctl, &dosage_present))) {
-      goto Plink1DosageToPgen_ret_NOMEM;
-    }
-    Dosage* dosage_main = nullptr;
-    if (dosage_is_present) {
-      if (unlikely(bigstack_alloc_dosage(sample_ct, &dosage_main))) {
-        goto Plink1DosageToPgen_ret_NOMEM;
-      }
-    }
     if (hard_call_thresh == UINT32_MAX) {
       hard_call_thresh = kDosageMid / 10;
     }
@@ -15147,179 +18406,226 @@ PglErr Plink1DosageToPgen(const char* dosagename, const char* famname, const cha
     if (flags & kfPlink1DosageFormatSingle01) {
       dosage_ceil = 1.01 * (1 + kSmallEpsilon);
     }
-    const uint32_t hard_call_halfdist = kDosage4th - hard_call_thresh;
-    const uint32_t sample_ctl2_m1 = sample_ctl2 - 1;
-    uint32_t vidx = 0;
-    for (; line_idx < line_ct; line_iter = AdvPastDelim(line_iter, '\n')) {
-      ++line_idx;
-      reterr = TextGetUnsafe(&dosage_txs, &line_iter);
-      if (unlikely(reterr)) {
-        goto Plink1DosageToPgen_ret_TSTREAM_REWIND2_FAIL;
-      }
-      if (variant_skip_ct) {
-        if (map_variant_ct) {
-          char* variant_id = NextTokenMult0(line_iter, id_col_idx);
-          const uint32_t variant_id_slen = strlen_se(variant_id);
-          if (VariantIdDupflagHtableFind(variant_id, TO_CONSTCPCONSTP(variant_ids), variant_id_htable, variant_id_slen, variant_id_htable_size, max_variant_id_slen) == UINT32_MAX) {
-            continue;
-          }
-          line_iter = NextTokenMult(variant_id, first_data_col_idx - id_col_idx);
-        } else {
-          char* chr_code_str = NextTokenMult0(line_iter, chr_col_idx);
-          char* chr_code_end = CurTokenEnd(chr_code_str);
-          line_iter = NextTokenMult(chr_code_end, first_data_col_idx - chr_col_idx);
-          *chr_code_end = '\0';
-          const uint32_t chr_code = GetChrCode(chr_code_str, cip, chr_code_end - chr_code_str);
-          if (!IsSet(cip->chr_mask, chr_code)) {
-            continue;
-          }
-        }
-      } else {
-        line_iter = NextTokenMult(line_iter, first_data_col_idx);
+    // Parsing cost is similar to .gen.
+    uint32_t calc_thread_ct = 1 + (sample_ct > 40) + (sample_ct > 160) + (sample_ct > 640) + (sample_ct > 2560) + (sample_ct > 10240);
+    // reserve a thread for background .pgen writing when possible
+    const uint32_t flush_thread_ct = (max_thread_ct > 2);
+    if (calc_thread_ct + 1 + flush_thread_ct > max_thread_ct) {
+      calc_thread_ct = MAXV(1, max_thread_ct - 1 - flush_thread_ct);
+    }
+    const uint32_t gparse_buf_ct = GparseFlushSetBackground(flush_thread_ct, &flush_ctx, &flush_tg);
+    ctx.gparse_buf_ct = gparse_buf_ct;
+    if (unlikely(
+            bigstack_alloc_ucp(calc_thread_ct, &ctx.thread_wkspaces) ||
+            bigstack_calloc_w(calc_thread_ct, &ctx.err_line_idxs) ||
+            bigstack_alloc_cp(calc_thread_ct, &ctx.err_tokens))) {
+      goto Plink1DosageToPgen_ret_NOMEM;
+    }
+    for (uint32_t buf_idx = 0; buf_idx != gparse_buf_ct; ++buf_idx) {
+      if (unlikely(bigstack_alloc_u32(calc_thread_ct + 1, &(ctx.thread_bidxs[buf_idx])))) {
+        goto Plink1DosageToPgen_ret_NOMEM;
       }
-      if (!line_iter) {
-        goto Plink1DosageToPgen_ret_MISSING_TOKENS;
+    }
+    ctx.plink1_dosage_parse_errs = S_CAST(Plink1DosageParseErr*, bigstack_alloc_raw_rd(calc_thread_ct * sizeof(Plink1DosageParseErr)));
+    if (unlikely(!ctx.plink1_dosage_parse_errs)) {
+      goto Plink1DosageToPgen_ret_NOMEM;
+    }
+    ctx.sample_ct = sample_ct;
+    ctx.format_single = (flags / kfPlink1DosageFormatSingle) & 1;
+    ctx.format_triple = format_triple;
+    ctx.prov_ref_allele_second = prov_ref_allele_second;
+    ctx.dosage_multiplier = dosage_multiplier;
+    ctx.dosage_ceil = dosage_ceil;
+    ctx.import_dosage_certainty = import_dosage_certainty;
+    ctx.hard_call_halfdist = kDosage4th - hard_call_thresh;
+    ctx.dosage_erase_halfdist = dosage_erase_halfdist;
+    ctx.force_missing_halfdist_p1 = force_missing_halfdist_p1;
+    ctx.parse_failed = 0;
+    for (uint32_t buf_idx = 0; buf_idx != kGparseMaxBufCt; ++buf_idx) {
+      // defensive
+      ctx.gparse[buf_idx] = nullptr;
+    }
+    const GparseFlags gparse_flags = dosage_is_present? kfGparseDosage : kfGparse0;
+    const uintptr_t write_byte_ct = GparseWriteByteCt(sample_ct, 2, gparse_flags);
+    const uintptr_t thread_wkspace_cl_ct = DivUp(GparseWriteByteCt(sample_ct, 2, kfGparseDosage), kCacheline);
+    uintptr_t cachelines_avail = bigstack_left() / (6 * kCacheline);
+    if (calc_thread_ct * thread_wkspace_cl_ct > cachelines_avail) {
+      if (unlikely(thread_wkspace_cl_ct > cachelines_avail)) {
+        goto Plink1DosageToPgen_ret_NOMEM;
       }
-      uint32_t inner_loop_last = kBitsPerWordD2 - 1;
-      Dosage* dosage_main_iter = dosage_main;
-      char* linebuf_iter = line_iter;
-      for (uint32_t widx = 0; ; ++widx) {
-        if (widx >= sample_ctl2_m1) {
-          if (widx > sample_ctl2_m1) {
-            break;
-          }
-          inner_loop_last = (sample_ct - 1) % kBitsPerWordD2;
+      calc_thread_ct = cachelines_avail / thread_wkspace_cl_ct;
+    }
+    for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
+      ctx.thread_wkspaces[tidx] = S_CAST(unsigned char*, bigstack_alloc_raw(thread_wkspace_cl_ct * kCacheline));
+      ctx.plink1_dosage_parse_errs[tidx] = kPlink1DosageParseOk;
+    }
+
+    // Line lengths weren't tracked during the first pass, so block sizes are
+    // based on the shortest possible well-formed line (one byte per value plus
+    // a delimiter); we error out below if a single line is too long for a
+    // thread's share of the buffer.
+    const uintptr_t min_genotext_blen = S_CAST(uintptr_t, sample_ct) * 2 * (ctx.format_single? 1 : (2 + format_triple));
+    const uintptr_t min_bytes_req_per_variant = sizeof(GparseRecord) + MAXV(write_byte_ct, RoundUpPow2(min_genotext_blen, kBytesPerVec));
+    // be pessimistic re: rounding
+    cachelines_avail = (bigstack_left() / kCacheline) - 4;
+    if (unlikely(cachelines_avail * kCacheline < gparse_buf_ct * (min_bytes_req_per_variant + calc_thread_ct))) {
+      goto Plink1DosageToPgen_ret_NOMEM;
+    }
+    uint32_t main_block_size = (cachelines_avail * kCacheline) / (min_bytes_req_per_variant * gparse_buf_ct);
+    if (main_block_size > 65536) {
+      main_block_size = 65536;
+    }
+    // divide by 2 for better parallelism in small-variant-count case
+    if (main_block_size > DivUp(variant_ct, 2)) {
+      main_block_size = DivUp(variant_ct, 2) + calc_thread_ct - 1;
+    }
+    const uint32_t per_thread_block_limit = main_block_size / calc_thread_ct;
+    main_block_size = per_thread_block_limit * calc_thread_ct;
+    if (unlikely(SetThreadCt(calc_thread_ct, &tg))) {
+      goto Plink1DosageToPgen_ret_NOMEM;
+    }
+    for (uint32_t buf_idx = 0; buf_idx != gparse_buf_ct; ++buf_idx) {
+      ctx.gparse[buf_idx] = S_CAST(GparseRecord*, bigstack_alloc_raw_rd(main_block_size * sizeof(GparseRecord)));
+    }
+    SetThreadFuncAndData(Plink1DosageToPgenThread, &ctx, &tg);
+    unsigned char* geno_bufs[kGparseMaxBufCt];
+    cachelines_avail = bigstack_left() / (kCacheline * gparse_buf_ct);
+    for (uint32_t buf_idx = 0; buf_idx != gparse_buf_ct; ++buf_idx) {
+      geno_bufs[buf_idx] = S_CAST(unsigned char*, bigstack_alloc_raw(cachelines_avail * kCacheline));
+    }
+    const uintptr_t per_thread_byte_limit = (cachelines_avail * kCacheline) / calc_thread_ct;
+
+    // Same block pipeline as OxGenToPgen().
+    uint32_t prev_block_write_ct = 0;
+    char* genotext_start = nullptr;
+    uintptr_t genotext_byte_ct = 0;
+    uintptr_t record_byte_ct = 0;
+    uintptr_t genotext_line_idx = 0;
+    uint32_t buf_idx = 0;
+    for (uint32_t vidx_start = 0; ; ) {
+      uint32_t cur_block_write_ct = 0;
+      if (!IsLastBlock(&tg)) {
+        const uint32_t block_vidx_limit = variant_ct - vidx_start;
+        uint32_t cur_thread_block_vidx_limit = MINV(block_vidx_limit, per_thread_block_limit);
+        uint32_t cur_thread_fill_idx = 0;
+        uint32_t* thread_bidxs = ctx.thread_bidxs[buf_idx];
+        GparseRecord* cur_gparse = ctx.gparse[buf_idx];
+        unsigned char* geno_buf_iter = geno_bufs[buf_idx];
+        unsigned char* cur_thread_byte_stop = &(geno_buf_iter[per_thread_byte_limit]);
+        thread_bidxs[0] = 0;
+        uint32_t block_vidx = 0;
+        if (!genotext_byte_ct) {
+          goto Plink1DosageToPgen_load_start;
         }
-        uintptr_t genovec_word = 0;
-        uint32_t dosage_present_hw = 0;
-        if (flags & kfPlink1DosageFormatSingle) {
-          for (uint32_t sample_idx_lowbits = 0; sample_idx_lowbits <= inner_loop_last; ++sample_idx_lowbits) {
-            if (unlikely(IsEolnKns(*linebuf_iter))) {
-              goto Plink1DosageToPgen_ret_MISSING_TOKENS;
-            }
-            double a1_dosage;
-            char* str_end = ScanadvDouble(linebuf_iter, &a1_dosage);
-            if ((!str_end) || (a1_dosage < 0.0) || (a1_dosage > dosage_ceil)) {
-              genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
-              linebuf_iter = FirstNonTspace(CurTokenEnd(linebuf_iter));
-              continue;
-            }
-            if (unlikely(!IsSpaceOrEoln(*str_end))) {
-              str_end = CurTokenEnd(str_end);
-              *str_end = '\0';
-              snprintf(g_logbuf, kLogbufSize, "Error: Invalid numeric token '%s' on line %" PRIuPTR " of --import-dosage file.\n", linebuf_iter, line_idx);
-              goto Plink1DosageToPgen_ret_MALFORMED_INPUT_WW;
-            }
-            linebuf_iter = FirstNonTspace(str_end);
-            uint32_t dosage_int = S_CAST(int32_t, a1_dosage * dosage_multiplier + 0.5);
-            if (dosage_int > kDosageMax) {
-              dosage_int = kDosageMax;
-            }
-            const uint32_t cur_halfdist = BiallelicDosageHalfdist(dosage_int);
-            if (cur_halfdist < hard_call_halfdist) {
-              genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
-              if (cur_halfdist < force_missing_halfdist_p1) {
-                continue;
-              }
-            } else {
-              genovec_word |= ((dosage_int + (kDosage4th * k1LU)) / kDosageMid) << (2 * sample_idx_lowbits);
-              if (cur_halfdist >= dosage_erase_halfdist) {
-                continue;
+        // we may stop before main_block_size due to insufficient space in
+        // geno_bufs[buf_idx].  if so, we copy over the genotype part of the
+        // current line before proceeding.
+        while (1) {
+          {
+            GparseRecord* grp = &(cur_gparse[block_vidx]);
+            grp->record_start = geno_buf_iter;
+            grp->flags = gparse_flags;
+            grp->metadata.read_text.line_idx = genotext_line_idx;
+            memcpy(geno_buf_iter, genotext_start, genotext_byte_ct);
+            geno_buf_iter = &(geno_buf_iter[record_byte_ct]);
+            ++block_vidx;
+            if (block_vidx == block_vidx_limit) {
+              for (; cur_thread_fill_idx != calc_thread_ct; ) {
+                thread_bidxs[++cur_thread_fill_idx] = block_vidx;
               }
+              break;
             }
-            dosage_present_hw |= 1U << sample_idx_lowbits;
-            *dosage_main_iter++ = dosage_int;
           }
-        } else {
-          for (uint32_t sample_idx_lowbits = 0; sample_idx_lowbits <= inner_loop_last; ++sample_idx_lowbits) {
-            if (unlikely(!linebuf_iter)) {
-              goto Plink1DosageToPgen_ret_MISSING_TOKENS;
-            }
-            double prob_2a1;
-            char* str_end = ScanadvDouble(linebuf_iter, &prob_2a1);
-            if (!str_end) {
-              genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
-              linebuf_iter = NextTokenMult(linebuf_iter, 2 + format_triple);
-              continue;
+        Plink1DosageToPgen_load_start:
+          do {
+            ++line_idx;
+            reterr = TextGetUnsafe(&dosage_txs, &line_iter);
+            if (unlikely(reterr)) {
+              goto Plink1DosageToPgen_ret_TSTREAM_REWIND2_FAIL;
             }
-            if (unlikely(!IsSpaceOrEoln(*str_end))) {
-              str_end = CurTokenEnd(str_end);
-              *str_end = '\0';
-              snprintf(g_logbuf, kLogbufSize, "Error: Invalid numeric token '%s' on line %" PRIuPTR " of --import-dosage file.\n", linebuf_iter, line_idx);
-              goto Plink1DosageToPgen_ret_MALFORMED_INPUT_WW;
+            if (variant_skip_ct) {
+              if (map_variant_ct) {
+                char* variant_id = NextTokenMult0(line_iter, id_col_idx);
+                const uint32_t variant_id_slen = strlen_se(variant_id);
+                if (VariantIdDupflagHtableFind(variant_id, TO_CONSTCPCONSTP(variant_ids), variant_id_htable, variant_id_slen, variant_id_htable_size, max_variant_id_slen) == UINT32_MAX) {
+                  line_iter = AdvPastDelim(line_iter, '\n');
+                  continue;
+                }
+                genotext_start = NextTokenMult(variant_id, first_data_col_idx - id_col_idx);
+              } else {
+                char* chr_code_str = NextTokenMult0(line_iter, chr_col_idx);
+                char* chr_code_end = CurTokenEnd(chr_code_str);
+                genotext_start = NextTokenMult(chr_code_end, first_data_col_idx - chr_col_idx);
+                *chr_code_end = '\0';
+                const uint32_t chr_code = GetChrCode(chr_code_str, cip, chr_code_end - chr_code_str);
+                if (!IsSet(cip->chr_mask, chr_code)) {
+                  line_iter = AdvPastDelim(&(chr_code_end[1]), '\n');
+                  continue;
+                }
+              }
+            } else {
+              genotext_start = NextTokenMult(line_iter, first_data_col_idx);
             }
-            linebuf_iter = FirstNonTspace(str_end);
-            if (unlikely(IsEolnKns(*linebuf_iter))) {
+            if (unlikely(!genotext_start)) {
               goto Plink1DosageToPgen_ret_MISSING_TOKENS;
             }
-            double prob_1a1;
-            str_end = ScanadvDouble(linebuf_iter, &prob_1a1);
-            if (!str_end) {
-              genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
-              linebuf_iter = NextTokenMult(linebuf_iter, 1 + format_triple);
-              continue;
-            }
-            if (unlikely(!IsSpaceOrEoln(*str_end))) {
-              str_end = CurTokenEnd(str_end);
-              *str_end = '\0';
-              snprintf(g_logbuf, kLogbufSize, "Error: Invalid numeric token '%s' on line %" PRIuPTR " of --import-dosage file.\n", linebuf_iter, line_idx);
-              goto Plink1DosageToPgen_ret_MALFORMED_INPUT_WW;
-            }
-            linebuf_iter = NextTokenMult(str_end, 1 + format_triple);
-            double prob_one_or_two_a1 = prob_2a1 + prob_1a1;
-            if ((prob_2a1 < 0.0) || (prob_1a1 < 0.0) || (prob_one_or_two_a1 > 1.01 * (1 + kSmallEpsilon))) {
-              genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
-              continue;
-            }
-            if (prob_one_or_two_a1 > 1.0) {
-              const double rescale = 1.0 / prob_one_or_two_a1;
-              prob_2a1 *= rescale;
-              prob_1a1 *= rescale;
-              prob_one_or_two_a1 = 1.0;
-            }
-            if ((prob_2a1 < import_dosage_certainty) && (prob_1a1 < import_dosage_certainty) && (prob_one_or_two_a1 > 1.0 - import_dosage_certainty)) {
-              genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
-            }
-            const uint32_t dosage_int = S_CAST(int32_t, prob_2a1 * 32768 + prob_1a1 * 16384 + 0.5);
-            const uint32_t cur_halfdist = BiallelicDosageHalfdist(dosage_int);
-            if (cur_halfdist < hard_call_halfdist) {
-              genovec_word |= (3 * k1LU) << (2 * sample_idx_lowbits);
-            } else {
-              genovec_word |= ((dosage_int + (kDosage4th * k1LU)) / kDosageMid) << (2 * sample_idx_lowbits);
-              if (cur_halfdist >= dosage_erase_halfdist) {
-                continue;
-              }
+            line_iter = AdvPastDelim(genotext_start, '\n');
+            break;
+          } while (1);
+          genotext_line_idx = line_idx;
+          genotext_byte_ct = line_iter - genotext_start;
+          record_byte_ct = MAXV(RoundUpPow2(genotext_byte_ct, kBytesPerVec), write_byte_ct);
+          if (unlikely(record_byte_ct > per_thread_byte_limit)) {
+            goto Plink1DosageToPgen_ret_NOMEM;
+          }
+          if ((block_vidx == cur_thread_block_vidx_limit) || (S_CAST(uintptr_t, cur_thread_byte_stop - geno_buf_iter) < record_byte_ct)) {
+            thread_bidxs[++cur_thread_fill_idx] = block_vidx;
+            if (cur_thread_fill_idx == calc_thread_ct) {
+              break;
             }
-            dosage_present_hw |= 1U << sample_idx_lowbits;
-            *dosage_main_iter++ = dosage_int;
+            cur_thread_byte_stop = &(cur_thread_byte_stop[per_thread_byte_limit]);
+            cur_thread_block_vidx_limit = MINV(cur_thread_block_vidx_limit + per_thread_block_limit, block_vidx_limit);
           }
         }
-        genovec[widx] = genovec_word;
-        R_CAST(Halfword*, dosage_present)[widx] = dosage_present_hw;
+        cur_block_write_ct = block_vidx;
       }
-      if (!prov_ref_allele_second) {
-        GenovecInvertUnsafe(sample_ct, genovec);
-        ZeroTrailingNyps(sample_ct, genovec);
+      if (vidx_start) {
+        JoinThreads(&tg);
+        if (unlikely(ctx.parse_failed)) {
+          goto Plink1DosageToPgen_ret_THREAD_PARSE;
+        }
       }
-      if (dosage_main_iter != dosage_main) {
-        const uint32_t dosage_ct = dosage_main_iter - dosage_main;
-        if (!prov_ref_allele_second) {
-          BiallelicDosage16Invert(dosage_ct, dosage_main);
+      if (!IsLastBlock(&tg)) {
+        if (vidx_start + cur_block_write_ct == variant_ct) {
+          DeclareLastThreadBlock(&tg);
         }
-        reterr = SpgwAppendBiallelicGenovecDosage16(genovec, dosage_present, dosage_main, dosage_ct, &spgw);
+        if (unlikely(SpawnThreads(&tg))) {
+          goto Plink1DosageToPgen_ret_THREAD_CREATE_FAIL;
+        }
+      }
+      const uint32_t prev_buf_idx = (buf_idx? buf_idx : gparse_buf_ct) - 1;
+      if (++buf_idx == gparse_buf_ct) {
+        buf_idx = 0;
+      }
+      if (vidx_start) {
+        reterr = GparseFlushStart(ctx.gparse[prev_buf_idx], prev_block_write_ct, (vidx_start == variant_ct), &flush_ctx, &flush_tg);
         if (unlikely(reterr)) {
           goto Plink1DosageToPgen_ret_1;
         }
-      } else {
-        if (unlikely(SpgwAppendBiallelicGenovec(genovec, &spgw))) {
-          goto Plink1DosageToPgen_ret_WRITE_FAIL;
-        }
       }
-      ++vidx;
-      if (!(vidx % 1000)) {
-        printf("\r--import-dosage: %uk variants converted.", vidx / 1000);
+      if (vidx_start == variant_ct) {
+        break;
+      }
+      if (vidx_start) {
+        printf("\r--import-dosage: %uk variants converted.", vidx_start / 1000);
         fflush(stdout);
       }
+      vidx_start += cur_block_write_ct;
+      prev_block_write_ct = cur_block_write_ct;
+    }
+    reterr = GparseFlushJoin(&flush_ctx, &flush_tg);
+    if (unlikely(reterr)) {
+      goto Plink1DosageToPgen_ret_1;
     }
     SpgwFinish(&spgw);
     putc_unlocked('\r', stdout);
@@ -15368,6 +18674,26 @@ PglErr Plink1DosageToPgen(const char* dosagename, const char* famname, const cha
   Plink1DosageToPgen_ret_INVALID_CMDLINE:
     reterr = kPglRetInvalidCmdline;
     break;
+  Plink1DosageToPgen_ret_THREAD_CREATE_FAIL:
+    reterr = kPglRetThreadCreateFail;
+    break;
+  Plink1DosageToPgen_ret_THREAD_PARSE:
+    {
+      Plink1DosageParseErr parse_err = kPlink1DosageParseOk;
+      uint32_t tidx = 0;
+      for (; ; ++tidx) {
+        parse_err = ctx.plink1_dosage_parse_errs[tidx];
+        if (parse_err) {
+          line_idx = ctx.err_line_idxs[tidx];
+          break;
+        }
+      }
+      if (parse_err == kPlink1DosageParseMissingTokens) {
+        goto Plink1DosageToPgen_ret_MISSING_TOKENS;
+      }
+      snprintf(g_logbuf, kLogbufSize, "Error: Invalid numeric token '%s' on line %" PRIuPTR " of --import-dosage file.\n", ctx.err_tokens[tidx], line_idx);
+      goto Plink1DosageToPgen_ret_MALFORMED_INPUT_WW;
+    }
   Plink1DosageToPgen_ret_MISSING_TOKENS:
     snprintf(g_logbuf, kLogbufSize, "Error: Line %" PRIuPTR " of %s has fewer tokens than expected.\n", line_idx, dosagename);
   Plink1DosageToPgen_ret_MALFORMED_INPUT_WW:
@@ -15386,7 +18712,9 @@ PglErr Plink1DosageToPgen(const char* dosagename, const char* famname, const cha
     break;
   }
  Plink1DosageToPgen_ret_1:
+  CleanupThreads(&flush_tg);
   CleanupSpgw(&spgw, &reterr);
+  CleanupThreads(&tg);
   ForgetExtraChrNames(1, cip);
   fclose_cond(psamfile);
   CswriteCloseCond(&pvar_css, pvar_cswritep);
@@ -30,7 +30,8 @@ FLAGSET_DEF_START()
   kfImportKeepAutoconv = (1 << 0),
   kfImportKeepAutoconvVzs = (1 << 1),
   kfImportDoubleId = (1 << 2),
-  kfImportVcfRequireGt = (1 << 3)
+  kfImportVcfRequireGt = (1 << 3),
+  kfImportVcfSpool = (1 << 4)
 FLAGSET_DEF_END(ImportFlags);
 
 ENUM_U31_DEF_START()
@@ -96,6 +97,10 @@ PglErr VcfToPgen(const char* vcfname, const char* preexisting_psamname, const ch
 
 PglErr BcfToPgen(const char* bcfname, const char* preexisting_psamname, const char* const_fid, const char* dosage_import_field, MiscFlags misc_flags, ImportFlags import_flags, uint32_t no_samples_ok, uint32_t hard_call_thresh, uint32_t dosage_erase_thresh, double import_dosage_certainty, char id_delim, char idspace_to, int32_t vcf_min_gq, int32_t vcf_min_dp, int32_t vcf_max_dp, VcfHalfCall halfcall_mode, FamCol fam_cols, uint32_t max_thread_ct, char* outname, char* outname_end, ChrInfo* cip, uint32_t* pgen_generated_ptr, uint32_t* psam_generated_ptr);
 
+// Streams a BCF subset (--extract/--exclude ID lists, --keep/--remove,
+// chromosome filters) directly to <outname>.bcf without decoding genotypes.
+PglErr BcfSubset(const char* bcfname, const char* keep_fnames, const char* remove_fnames, const char* extract_fnames, const char* exclude_fnames, MiscFlags misc_flags, uint32_t max_thread_ct, char* outname, char* outname_end, ChrInfo* cip);
+
 PglErr OxGenToPgen(const char* genname, const char* samplename, const char* ox_single_chr_str, const char* ox_missing_code, MiscFlags misc_flags, ImportFlags import_flags, OxfordImportFlags oxford_import_flags, uint32_t hard_call_thresh, uint32_t dosage_erase_thresh, double import_dosage_certainty, uint32_t max_thread_ct, char* outname, char* outname_end, ChrInfo* cip);
 
 PglErr OxBgenToPgen(const char* bgenname, const char* samplename, const char* const_fid, const char* ox_single_chr_str, const char* ox_missing_code, MiscFlags misc_flags, ImportFlags import_flags, OxfordImportFlags oxford_import_flags, uint32_t hard_call_thresh, uint32_t dosage_erase_thresh, double import_dosage_certainty, char id_delim, char idspace_to, uint32_t max_thread_ct, char* outname, char* outname_end, ChrInfo* cip);
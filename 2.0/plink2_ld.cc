@@ -17,6 +17,7 @@
 
 #include "include/plink2_stats.h"
 #include "plink2_ld.h"
+#include "plink2_simd.h"
 
 #ifdef __cplusplus
 #  include <functional>  // std::greater
@@ -41,422 +42,6 @@ void CleanupLd(LdInfo* ldip) {
   free_cond(ldip->ld_console_varids[1]);
 }
 
-
-#ifdef USE_AVX2
-// todo: see if either approach in avx_jaccard_index.c in
-// github.com/CountOnes/hamming_weight helps here.
-
-static inline int32_t DotprodAvx2(const VecW* __restrict hom1_iter, const VecW* __restrict ref2het1_iter, const VecW* __restrict hom2_iter, const VecW* __restrict ref2het2_iter, uintptr_t vec_ct) {
-  // popcount(hom1 & hom2) - 2 * popcount(hom1 & hom2 & (ref2het1 ^ ref2het2))
-  // ct must be a multiple of 4.
-  VecW cnt = vecw_setzero();
-  VecW ones_both = vecw_setzero();
-  VecW ones_neg = vecw_setzero();
-  VecW twos_both = vecw_setzero();
-  VecW twos_neg = vecw_setzero();
-  for (uintptr_t vec_idx = 0; vec_idx < vec_ct; vec_idx += 4) {
-    VecW count1_both = hom1_iter[vec_idx] & hom2_iter[vec_idx];
-    VecW cur_xor = ref2het1_iter[vec_idx] ^ ref2het2_iter[vec_idx];
-    VecW count1_neg = count1_both & cur_xor;
-
-    VecW count2_both = hom1_iter[vec_idx + 1] & hom2_iter[vec_idx + 1];
-    cur_xor = ref2het1_iter[vec_idx + 1] ^ ref2het2_iter[vec_idx + 1];
-    VecW count2_neg = count2_both & cur_xor;
-    const VecW twos_both_a = Csa256(count1_both, count2_both, &ones_both);
-    const VecW twos_neg_a = Csa256(count1_neg, count2_neg, &ones_neg);
-
-    count1_both = hom1_iter[vec_idx + 2] & hom2_iter[vec_idx + 2];
-    cur_xor = ref2het1_iter[vec_idx + 2] ^ ref2het2_iter[vec_idx + 2];
-    count1_neg = count1_both & cur_xor;
-
-    count2_both = hom1_iter[vec_idx + 3] & hom2_iter[vec_idx + 3];
-    cur_xor = ref2het1_iter[vec_idx + 3] ^ ref2het2_iter[vec_idx + 3];
-    count2_neg = count2_both & cur_xor;
-    const VecW twos_both_b = Csa256(count1_both, count2_both, &ones_both);
-    const VecW twos_neg_b = Csa256(count1_neg, count2_neg, &ones_neg);
-    const VecW fours_both = Csa256(twos_both_a, twos_both_b, &twos_both);
-    const VecW fours_neg = Csa256(twos_neg_a, twos_neg_b, &twos_neg);
-    // tried continuing to eights, not worth it
-    // deliberate unsigned-int64 overflow here
-    cnt = cnt + PopcountVecAvx2(fours_both) - vecw_slli(PopcountVecAvx2(fours_neg), 1);
-  }
-  cnt = cnt - PopcountVecAvx2(twos_neg);
-  cnt = vecw_slli(cnt, 2);
-  const VecW twos_sum = PopcountVecAvx2(twos_both) - PopcountVecAvx2(ones_neg);
-  cnt = cnt + vecw_slli(twos_sum, 1);
-  cnt = cnt + PopcountVecAvx2(ones_both);
-  return HsumW(cnt);
-}
-
-int32_t DotprodWords(const uintptr_t* __restrict hom1, const uintptr_t* __restrict ref2het1, const uintptr_t* __restrict hom2, const uintptr_t* __restrict ref2het2, uintptr_t word_ct) {
-  int32_t tot_both = 0;
-  uint32_t widx = 0;
-  if (word_ct >= 16) { // this already pays off with a single block
-    const uintptr_t block_ct = word_ct / (kWordsPerVec * 4);
-    tot_both = DotprodAvx2(R_CAST(const VecW*, hom1), R_CAST(const VecW*, ref2het1), R_CAST(const VecW*, hom2), R_CAST(const VecW*, ref2het2), block_ct * 4);
-    widx = block_ct * (4 * kWordsPerVec);
-  }
-  uint32_t tot_neg = 0;
-  for (; widx != word_ct; ++widx) {
-    const uintptr_t hom_word = hom1[widx] & hom2[widx];
-    const uintptr_t xor_word = ref2het1[widx] ^ ref2het2[widx];
-    tot_both += PopcountWord(hom_word);
-    tot_neg += PopcountWord(hom_word & xor_word);
-  }
-  return tot_both - 2 * tot_neg;
-}
-
-static inline void SumSsqAvx2(const VecW* __restrict hom1_iter, const VecW* __restrict ref2het1_iter, const VecW* __restrict hom2_iter, const VecW* __restrict ref2het2_iter, uintptr_t vec_ct, uint32_t* __restrict ssq2_ptr, uint32_t* __restrict plus2_ptr) {
-  // popcounts (nm1 & hom2) and (nm1 & hom2 & ref2het2).  ct is multiple of 8.
-  VecW cnt_ssq = vecw_setzero();
-  VecW cnt_plus = vecw_setzero();
-  VecW ones_ssq = vecw_setzero();
-  VecW ones_plus = vecw_setzero();
-  VecW twos_ssq = vecw_setzero();
-  VecW twos_plus = vecw_setzero();
-  VecW fours_ssq = vecw_setzero();
-  VecW fours_plus = vecw_setzero();
-  for (uintptr_t vec_idx = 0; vec_idx < vec_ct; vec_idx += 8) {
-    VecW count1_ssq = (hom1_iter[vec_idx] | ref2het1_iter[vec_idx]) & hom2_iter[vec_idx];
-    VecW count1_plus = count1_ssq & ref2het2_iter[vec_idx];
-
-    VecW count2_ssq = (hom1_iter[vec_idx + 1] | ref2het1_iter[vec_idx + 1]) & hom2_iter[vec_idx + 1];
-    VecW count2_plus = count2_ssq & ref2het2_iter[vec_idx + 1];
-    VecW twos_ssq_a = Csa256(count1_ssq, count2_ssq, &ones_ssq);
-    VecW twos_plus_a = Csa256(count1_plus, count2_plus, &ones_plus);
-
-    count1_ssq = (hom1_iter[vec_idx + 2] | ref2het1_iter[vec_idx + 2]) & hom2_iter[vec_idx + 2];
-    count1_plus = count1_ssq & ref2het2_iter[vec_idx + 2];
-
-    count2_ssq = (hom1_iter[vec_idx + 3] | ref2het1_iter[vec_idx + 3]) & hom2_iter[vec_idx + 3];
-    count2_plus = count2_ssq & ref2het2_iter[vec_idx + 3];
-    VecW twos_ssq_b = Csa256(count1_ssq, count2_ssq, &ones_ssq);
-    VecW twos_plus_b = Csa256(count1_plus, count2_plus, &ones_plus);
-    const VecW fours_ssq_a = Csa256(twos_ssq_a, twos_ssq_b, &twos_ssq);
-    const VecW fours_plus_a = Csa256(twos_plus_a, twos_plus_b, &twos_plus);
-
-    count1_ssq = (hom1_iter[vec_idx + 4] | ref2het1_iter[vec_idx + 4]) & hom2_iter[vec_idx + 4];
-    count1_plus = count1_ssq & ref2het2_iter[vec_idx + 4];
-
-    count2_ssq = (hom1_iter[vec_idx + 5] | ref2het1_iter[vec_idx + 5]) & hom2_iter[vec_idx + 5];
-    count2_plus = count2_ssq & ref2het2_iter[vec_idx + 5];
-    twos_ssq_a = Csa256(count1_ssq, count2_ssq, &ones_ssq);
-    twos_plus_a = Csa256(count1_plus, count2_plus, &ones_plus);
-
-    count1_ssq = (hom1_iter[vec_idx + 6] | ref2het1_iter[vec_idx + 6]) & hom2_iter[vec_idx + 6];
-    count1_plus = count1_ssq & ref2het2_iter[vec_idx + 6];
-
-    count2_ssq = (hom1_iter[vec_idx + 7] | ref2het1_iter[vec_idx + 7]) & hom2_iter[vec_idx + 7];
-    count2_plus = count2_ssq & ref2het2_iter[vec_idx + 7];
-    twos_ssq_b = Csa256(count1_ssq, count2_ssq, &ones_ssq);
-    twos_plus_b = Csa256(count1_plus, count2_plus, &ones_plus);
-    const VecW fours_ssq_b = Csa256(twos_ssq_a, twos_ssq_b, &twos_ssq);
-    const VecW fours_plus_b = Csa256(twos_plus_a, twos_plus_b, &twos_plus);
-    const VecW eights_ssq = Csa256(fours_ssq_a, fours_ssq_b, &fours_ssq);
-    const VecW eights_plus = Csa256(fours_plus_a, fours_plus_b, &fours_plus);
-    // negligible benefit from going to sixteens here
-    cnt_ssq = cnt_ssq + PopcountVecAvx2(eights_ssq);
-    cnt_plus = cnt_plus + PopcountVecAvx2(eights_plus);
-  }
-  cnt_ssq = vecw_slli(cnt_ssq, 3);
-  cnt_plus = vecw_slli(cnt_plus, 3);
-  cnt_ssq = cnt_ssq + vecw_slli(PopcountVecAvx2(fours_ssq), 2);
-  cnt_plus = cnt_plus + vecw_slli(PopcountVecAvx2(fours_plus), 2);
-  cnt_ssq = cnt_ssq + vecw_slli(PopcountVecAvx2(twos_ssq), 1);
-  cnt_plus = cnt_plus + vecw_slli(PopcountVecAvx2(twos_plus), 1);
-  cnt_ssq = cnt_ssq + PopcountVecAvx2(ones_ssq);
-  cnt_plus = cnt_plus + PopcountVecAvx2(ones_plus);
-  *ssq2_ptr = HsumW(cnt_ssq);
-  *plus2_ptr = HsumW(cnt_plus);
-}
-
-void SumSsqWords(const uintptr_t* hom1, const uintptr_t* ref2het1, const uintptr_t* hom2, const uintptr_t* ref2het2, uint32_t word_ct, int32_t* sum2_ptr, uint32_t* ssq2_ptr) {
-  uint32_t ssq2 = 0;
-  uint32_t plus2 = 0;
-  uint32_t widx = 0;
-  // this has high constant overhead at the end; may want to require more than
-  // one block?
-  if (word_ct >= 32) {
-    const uintptr_t block_ct = word_ct / (8 * kWordsPerVec);
-    SumSsqAvx2(R_CAST(const VecW*, hom1), R_CAST(const VecW*, ref2het1), R_CAST(const VecW*, hom2), R_CAST(const VecW*, ref2het2), block_ct * 8, &ssq2, &plus2);
-    widx = block_ct * (8 * kWordsPerVec);
-  }
-  for (; widx != word_ct; ++widx) {
-    const uintptr_t ssq2_word = (hom1[widx] | ref2het1[widx]) & hom2[widx];
-    ssq2 += PopcountWord(ssq2_word);
-    plus2 += PopcountWord(ssq2_word & ref2het2[widx]);
-  }
-  *sum2_ptr = S_CAST(int32_t, 2 * plus2 - ssq2);  // deliberate overflow
-  *ssq2_ptr = ssq2;
-}
-#else  // !USE_AVX2
-static inline int32_t DotprodVecsNm(const VecW* __restrict hom1_iter, const VecW* __restrict ref2het1_iter, const VecW* __restrict hom2_iter, const VecW* __restrict ref2het2_iter, uintptr_t vec_ct) {
-  // popcount(hom1 & hom2) - 2 * popcount(hom1 & hom2 & (ref2het1 ^ ref2het2))
-  // ct must be a multiple of 3.
-  assert(!(vec_ct % 3));
-  const VecW m1 = VCONST_W(kMask5555);
-  const VecW m2 = VCONST_W(kMask3333);
-  const VecW m4 = VCONST_W(kMask0F0F);
-  VecW acc_both = vecw_setzero();
-  VecW acc_neg = vecw_setzero();
-  uintptr_t cur_incr = 30;
-  for (; ; vec_ct -= cur_incr) {
-    if (vec_ct < 30) {
-      if (!vec_ct) {
-        return HsumW(acc_both) - 2 * HsumW(acc_neg);
-      }
-      cur_incr = vec_ct;
-    }
-    VecW inner_acc_both = vecw_setzero();
-    VecW inner_acc_neg = vecw_setzero();
-    const VecW* hom1_stop = &(hom1_iter[cur_incr]);
-    do {
-      VecW count1_both = (*hom1_iter++) & (*hom2_iter++);
-      VecW cur_xor = (*ref2het1_iter++) ^ (*ref2het2_iter++);
-      VecW count1_neg = count1_both & cur_xor;
-
-      VecW count2_both = (*hom1_iter++) & (*hom2_iter++);
-      cur_xor = (*ref2het1_iter++) ^ (*ref2het2_iter++);
-      VecW count2_neg = count2_both & cur_xor;
-
-      VecW cur_hom = (*hom1_iter++) & (*hom2_iter++);
-      cur_xor = (*ref2het1_iter++) ^ (*ref2het2_iter++);
-      VecW half1_neg = cur_hom & cur_xor;
-      const VecW half2_both = vecw_srli(cur_hom, 1) & m1;
-      const VecW half2_neg = vecw_srli(half1_neg, 1) & m1;
-      const VecW half1_both = cur_hom & m1;
-      half1_neg = half1_neg & m1;
-      count1_both = count1_both - (vecw_srli(count1_both, 1) & m1);
-      count1_neg = count1_neg - (vecw_srli(count1_neg, 1) & m1);
-      count2_both = count2_both - (vecw_srli(count2_both, 1) & m1);
-      count2_neg = count2_neg - (vecw_srli(count2_neg, 1) & m1);
-      count1_both = count1_both + half1_both;
-      count1_neg = count1_neg + half1_neg;
-      count2_both = count2_both + half2_both;
-      count2_neg = count2_neg + half2_neg;
-      count1_both = (count1_both & m2) + (vecw_srli(count1_both, 2) & m2);
-      count1_neg = (count1_neg & m2) + (vecw_srli(count1_neg, 2) & m2);
-      count1_both = count1_both + (count2_both & m2) + (vecw_srli(count2_both, 2) & m2);
-      count1_neg = count1_neg + (count2_neg & m2) + (vecw_srli(count2_neg, 2) & m2);
-      inner_acc_both = inner_acc_both + (count1_both & m4) + (vecw_srli(count1_both, 4) & m4);
-      inner_acc_neg = inner_acc_neg + (count1_neg & m4) + (vecw_srli(count1_neg, 4) & m4);
-    } while (hom1_iter < hom1_stop);
-    const VecW m0 = vecw_setzero();
-    acc_both = acc_both + vecw_bytesum(inner_acc_both, m0);
-    acc_neg = acc_neg + vecw_bytesum(inner_acc_neg, m0);
-  }
-}
-
-int32_t DotprodWords(const uintptr_t* __restrict hom1, const uintptr_t* __restrict ref2het1, const uintptr_t* __restrict hom2, const uintptr_t* __restrict ref2het2, uintptr_t word_ct) {
-  int32_t tot_both = 0;
-  uint32_t widx = 0;
-  if (word_ct >= kWordsPerVec * 3) {
-    const uintptr_t block_ct = word_ct / (kWordsPerVec * 3);
-    tot_both = DotprodVecsNm(R_CAST(const VecW*, hom1), R_CAST(const VecW*, ref2het1), R_CAST(const VecW*, hom2), R_CAST(const VecW*, ref2het2), block_ct * 3);
-    widx = block_ct * (3 * kWordsPerVec);
-  }
-  uint32_t tot_neg = 0;
-  for (; widx != word_ct; ++widx) {
-    const uintptr_t hom_word = hom1[widx] & hom2[widx];
-    const uintptr_t xor_word = ref2het1[widx] ^ ref2het2[widx];
-    tot_both += PopcountWord(hom_word);
-    tot_neg += PopcountWord(hom_word & xor_word);
-  }
-  return tot_both - 2 * tot_neg;
-}
-
-#ifndef USE_SSE42
-static inline void SumSsqVecs(const VecW* __restrict hom1_iter, const VecW* __restrict ref2het1_iter, const VecW* __restrict hom2_iter, const VecW* __restrict ref2het2_iter, uintptr_t vec_ct, uint32_t* __restrict ssq2_ptr, uint32_t* __restrict plus2_ptr) {
-  // popcounts (nm1 & hom2) and (nm1 & hom2 & ref2het2).  ct is multiple of 3.
-  assert(!(vec_ct % 3));
-  const VecW m1 = VCONST_W(kMask5555);
-  const VecW m2 = VCONST_W(kMask3333);
-  const VecW m4 = VCONST_W(kMask0F0F);
-  VecW acc_ssq2 = vecw_setzero();
-  VecW acc_plus2 = vecw_setzero();
-  uint32_t cur_incr = 30;
-  for (; ; vec_ct -= cur_incr) {
-    if (vec_ct < 30) {
-      if (!vec_ct) {
-        *ssq2_ptr = HsumW(acc_ssq2);
-        *plus2_ptr = HsumW(acc_plus2);
-        return;
-      }
-      cur_incr = vec_ct;
-    }
-    VecW inner_acc_ssq = vecw_setzero();
-    VecW inner_acc_plus = vecw_setzero();
-    for (uint32_t vec_idx = 0; vec_idx < cur_incr; vec_idx += 3) {
-      VecW count1_ssq = (hom1_iter[vec_idx] | ref2het1_iter[vec_idx]) & hom2_iter[vec_idx];
-      VecW count1_plus = count1_ssq & ref2het2_iter[vec_idx];
-
-      VecW count2_ssq = (hom1_iter[vec_idx + 1] | ref2het1_iter[vec_idx + 1]) & hom2_iter[vec_idx + 1];
-      VecW count2_plus = count2_ssq & ref2het2_iter[vec_idx + 1];
-
-      VecW half1_ssq = (hom1_iter[vec_idx + 2] | ref2het1_iter[vec_idx + 2]) & hom2_iter[vec_idx + 2];
-      VecW half1_plus = half1_ssq & ref2het2_iter[vec_idx + 2];
-      VecW half2_ssq = vecw_srli(half1_ssq, 1) & m1;
-      VecW half2_plus = vecw_srli(half1_plus, 1) & m1;
-      half1_ssq = half1_ssq & m1;
-      half1_plus = half1_plus & m1;
-      count1_ssq = count1_ssq - (vecw_srli(count1_ssq, 1) & m1);
-      count1_plus = count1_plus - (vecw_srli(count1_plus, 1) & m1);
-      count2_ssq = count2_ssq - (vecw_srli(count2_ssq, 1) & m1);
-      count2_plus = count2_plus - (vecw_srli(count2_plus, 1) & m1);
-      count1_ssq = count1_ssq + half1_ssq;
-      count1_plus = count1_plus + half1_plus;
-      count2_ssq = count2_ssq + half2_ssq;
-      count2_plus = count2_plus + half2_plus;
-      count1_ssq = (count1_ssq & m2) + (vecw_srli(count1_ssq, 2) & m2);
-      count1_plus = (count1_plus & m2) + (vecw_srli(count1_plus, 2) & m2);
-      count1_ssq = count1_ssq + (count2_ssq & m2) + (vecw_srli(count2_ssq, 2) & m2);
-      count1_plus = count1_plus + (count2_plus & m2) + (vecw_srli(count2_plus, 2) & m2);
-      inner_acc_ssq = inner_acc_ssq + (count1_ssq & m4) + (vecw_srli(count1_ssq, 4) & m4);
-      inner_acc_plus = inner_acc_plus + (count1_plus & m4) + (vecw_srli(count1_plus, 4) & m4);
-    }
-    hom1_iter = &(hom1_iter[cur_incr]);
-    ref2het1_iter = &(ref2het1_iter[cur_incr]);
-    hom2_iter = &(hom2_iter[cur_incr]);
-    ref2het2_iter = &(ref2het2_iter[cur_incr]);
-    const VecW m0 = vecw_setzero();
-    acc_ssq2 = acc_ssq2 + vecw_bytesum(inner_acc_ssq, m0);
-    acc_plus2 = acc_plus2 + vecw_bytesum(inner_acc_plus, m0);
-  }
-}
-#endif
-
-void SumSsqWords(const uintptr_t* hom1, const uintptr_t* ref2het1, const uintptr_t* hom2, const uintptr_t* ref2het2, uint32_t word_ct, int32_t* sum2_ptr, uint32_t* ssq2_ptr) {
-  uint32_t ssq2 = 0;
-  uint32_t plus2 = 0;
-  uint32_t widx = 0;
-#ifndef USE_SSE42
-  if (word_ct >= kWordsPerVec * 3) {
-    const uintptr_t block_ct = word_ct / (kWordsPerVec * 3);
-    SumSsqVecs(R_CAST(const VecW*, hom1), R_CAST(const VecW*, ref2het1), R_CAST(const VecW*, hom2), R_CAST(const VecW*, ref2het2), block_ct * 3, &ssq2, &plus2);
-    widx = block_ct * (3 * kWordsPerVec);
-  }
-#endif
-  for (; widx != word_ct; ++widx) {
-    const uintptr_t ssq2_word = (hom1[widx] | ref2het1[widx]) & hom2[widx];
-    ssq2 += PopcountWord(ssq2_word);
-    plus2 += PopcountWord(ssq2_word & ref2het2[widx]);
-  }
-  *sum2_ptr = S_CAST(int32_t, 2 * plus2 - ssq2);  // deliberate overflow
-  *ssq2_ptr = ssq2;
-}
-#endif  // !USE_AVX2
-
-#if defined(USE_AVX2) || !defined(USE_SSE42)
-static inline void SumSsqNmVecs(const VecW* __restrict hom1_iter, const VecW* __restrict ref2het1_iter, const VecW* __restrict hom2_iter, const VecW* __restrict ref2het2_iter, uintptr_t vec_ct, uint32_t* __restrict nm_ptr, uint32_t* __restrict ssq2_ptr, uint32_t* __restrict plus2_ptr) {
-  // vec_ct must be a multiple of 3.
-  assert(!(vec_ct % 3));
-  const VecW m1 = VCONST_W(kMask5555);
-  const VecW m2 = VCONST_W(kMask3333);
-  const VecW m4 = VCONST_W(kMask0F0F);
-  VecW acc_nm = vecw_setzero();
-  VecW acc_ssq2 = vecw_setzero();
-  VecW acc_plus2 = vecw_setzero();
-  uint32_t cur_incr = 30;
-  for (; ; vec_ct -= cur_incr) {
-    if (vec_ct < 30) {
-      if (!vec_ct) {
-        *nm_ptr = HsumW(acc_nm);
-        *ssq2_ptr = HsumW(acc_ssq2);
-        *plus2_ptr = HsumW(acc_plus2);
-        return;
-      }
-      cur_incr = vec_ct;
-    }
-    VecW inner_acc_nm = vecw_setzero();
-    VecW inner_acc_ssq = vecw_setzero();
-    VecW inner_acc_plus = vecw_setzero();
-    for (uint32_t vec_idx = 0; vec_idx < cur_incr; vec_idx += 3) {
-      VecW nm1 = hom1_iter[vec_idx] | ref2het1_iter[vec_idx];
-      VecW hom2 = hom2_iter[vec_idx];
-      VecW ref2het2 = ref2het2_iter[vec_idx];
-      VecW count1_ssq = nm1 & hom2;
-      VecW count1_nm = nm1 & (hom2 | ref2het2);
-      VecW count1_plus = count1_ssq & ref2het2;
-
-      nm1 = hom1_iter[vec_idx + 1] | ref2het1_iter[vec_idx + 1];
-      hom2 = hom2_iter[vec_idx + 1];
-      ref2het2 = ref2het2_iter[vec_idx + 1];
-      VecW count2_ssq = nm1 & hom2;
-      VecW count2_nm = nm1 & (hom2 | ref2het2);
-      VecW count2_plus = count2_ssq & ref2het2;
-
-      nm1 = hom1_iter[vec_idx + 2] | ref2het1_iter[vec_idx + 2];
-      hom2 = hom2_iter[vec_idx + 2];
-      ref2het2 = ref2het2_iter[vec_idx + 2];
-      VecW half_a_ssq = nm1 & hom2;
-      VecW half_a_nm = nm1 & (hom2 | ref2het2);
-      VecW half_a_plus = half_a_ssq & ref2het2;
-      const VecW half_b_ssq = vecw_srli(half_a_ssq, 1) & m1;
-      const VecW half_b_nm = vecw_srli(half_a_nm, 1) & m1;
-      const VecW half_b_plus = vecw_srli(half_a_plus, 1) & m1;
-      half_a_ssq = half_a_ssq & m1;
-      half_a_nm = half_a_nm & m1;
-      half_a_plus = half_a_plus & m1;
-      count1_ssq = count1_ssq - (vecw_srli(count1_ssq, 1) & m1);
-      count1_nm = count1_nm - (vecw_srli(count1_nm, 1) & m1);
-      count1_plus = count1_plus - (vecw_srli(count1_plus, 1) & m1);
-      count2_ssq = count2_ssq - (vecw_srli(count2_ssq, 1) & m1);
-      count2_nm = count2_nm - (vecw_srli(count2_nm, 1) & m1);
-      count2_plus = count2_plus - (vecw_srli(count2_plus, 1) & m1);
-      count1_ssq = count1_ssq + half_a_ssq;
-      count1_nm = count1_nm + half_a_nm;
-      count1_plus = count1_plus + half_a_plus;
-      count2_ssq = count2_ssq + half_b_ssq;
-      count2_nm = count2_nm + half_b_nm;
-      count2_plus = count2_plus + half_b_plus;
-      count1_ssq = (count1_ssq & m2) + (vecw_srli(count1_ssq, 2) & m2);
-      count1_nm = (count1_nm & m2) + (vecw_srli(count1_nm, 2) & m2);
-      count1_plus = (count1_plus & m2) + (vecw_srli(count1_plus, 2) & m2);
-      count1_ssq = count1_ssq + (count2_ssq & m2) + (vecw_srli(count2_ssq, 2) & m2);
-      count1_nm = count1_nm + (count2_nm & m2) + (vecw_srli(count2_nm, 2) & m2);
-      count1_plus = count1_plus + (count2_plus & m2) + (vecw_srli(count2_plus, 2) & m2);
-      inner_acc_nm = inner_acc_nm + (count1_nm & m4) + (vecw_srli(count1_nm, 4) & m4);
-      inner_acc_ssq = inner_acc_ssq + (count1_ssq & m4) + (vecw_srli(count1_ssq, 4) & m4);
-      inner_acc_plus = inner_acc_plus + (count1_plus & m4) + (vecw_srli(count1_plus, 4) & m4);
-    }
-    hom1_iter = &(hom1_iter[cur_incr]);
-    ref2het1_iter = &(ref2het1_iter[cur_incr]);
-    hom2_iter = &(hom2_iter[cur_incr]);
-    ref2het2_iter = &(ref2het2_iter[cur_incr]);
-    const VecW m0 = vecw_setzero();
-    acc_nm = acc_nm + vecw_bytesum(inner_acc_nm, m0);
-    acc_ssq2 = acc_ssq2 + vecw_bytesum(inner_acc_ssq, m0);
-    acc_plus2 = acc_plus2 + vecw_bytesum(inner_acc_plus, m0);
-  }
-}
-#endif  // __LP64__
-
-void SumSsqNmWords(const uintptr_t* hom1, const uintptr_t* ref2het1, const uintptr_t* hom2, const uintptr_t* ref2het2, uint32_t word_ct, uint32_t* __restrict nm_ptr, int32_t* sum2_ptr, uint32_t* __restrict ssq2_ptr) {
-  uint32_t nm = 0;
-  uint32_t ssq2 = 0;
-  uint32_t plus2 = 0;
-  uint32_t widx = 0;
-#if defined(USE_AVX2) || !defined(USE_SSE42)
-  if (word_ct >= 3 * kWordsPerVec) {
-    const uintptr_t block_ct = word_ct / (3 * kWordsPerVec);
-    SumSsqNmVecs(R_CAST(const VecW*, hom1), R_CAST(const VecW*, ref2het1), R_CAST(const VecW*, hom2), R_CAST(const VecW*, ref2het2), block_ct * 3, &nm, &ssq2, &plus2);
-    widx = block_ct * (3 * kWordsPerVec);
-  }
-#endif
-  for (; widx != word_ct; ++widx) {
-    const uintptr_t nm1_word = hom1[widx] | ref2het1[widx];
-    const uintptr_t hom2_word = hom2[widx];
-    const uintptr_t ref2het2_word = ref2het2[widx];
-    nm += PopcountWord(nm1_word & (hom2_word | ref2het2_word));
-    const uintptr_t ssq2_word = nm1_word & hom2_word;
-    ssq2 += PopcountWord(ssq2_word);
-    plus2 += PopcountWord(ssq2_word & ref2het2_word);
-  }
-  *nm_ptr = nm;
-  *sum2_ptr = S_CAST(int32_t, 2 * plus2 - ssq2);  // deliberate overflow
-  *ssq2_ptr = ssq2;
-}
-
 // er, subcontig_info probably deserves its own type...
 void LdPruneNextSubcontig(const uintptr_t* variant_include, const uint32_t* variant_bps, const uint32_t* subcontig_info, const uint32_t* subcontig_thread_assignments, uint32_t x_start, uint32_t x_len, uint32_t y_start, uint32_t y_len, uint32_t founder_ct, uint32_t founder_male_ct, uint32_t prune_window_size, uint32_t thread_idx, uint32_t* subcontig_idx_ptr, uint32_t* subcontig_end_tvidx_ptr, uint32_t* next_window_end_tvidx_ptr, uint32_t* is_x_ptr, uint32_t* is_y_ptr, uint32_t* cur_founder_ct_ptr, uint32_t* cur_founder_ctaw_ptr, uint32_t* cur_founder_ctl_ptr, uintptr_t* entire_variant_buf_word_ct_ptr, uint32_t* variant_uidx_winstart_ptr, uint32_t* variant_uidx_winend_ptr) {
   uint32_t subcontig_idx = *subcontig_idx_ptr;
@@ -573,9 +158,9 @@ void ComputeIndepPairwiseR2Components(const uintptr_t* __restrict first_genobufs
   // 1. Just need dot product.
   // 2. Also need {first_sum, first_ssq} xor {second_sum, second_ssq}.
   // 3. Need all six variables.
-  *cur_dotprod_ptr = DotprodWords(first_genobufs, &(first_genobufs[founder_ctaw]), second_genobufs, &(second_genobufs[founder_ctaw]), founder_ctl);
+  *cur_dotprod_ptr = g_simd_kernels.dotprod_words(first_genobufs, &(first_genobufs[founder_ctaw]), second_genobufs, &(second_genobufs[founder_ctaw]), founder_ctl);
   if (*cur_nm_ct_ptr != founder_ct) {
-    SumSsqWords(first_genobufs, &(first_genobufs[founder_ctaw]), second_genobufs, &(second_genobufs[founder_ctaw]), founder_ctl, second_sum_ptr, second_ssq_ptr);
+    g_simd_kernels.sum_ssq_words(first_genobufs, &(first_genobufs[founder_ctaw]), second_genobufs, &(second_genobufs[founder_ctaw]), founder_ctl, second_sum_ptr, second_ssq_ptr);
   } else {
     *second_sum_ptr = second_vaggs->sum;
     *second_ssq_ptr = second_vaggs->ssq;
@@ -587,9 +172,9 @@ void ComputeIndepPairwiseR2Components(const uintptr_t* __restrict first_genobufs
     return;
   }
   if (*cur_nm_ct_ptr != founder_ct) {
-    SumSsqNmWords(second_genobufs, &(second_genobufs[founder_ctaw]), first_genobufs, &(first_genobufs[founder_ctaw]), founder_ctl, cur_nm_ct_ptr, cur_first_sum_ptr, cur_first_ssq_ptr);
+    g_simd_kernels.sum_ssq_nm_words(second_genobufs, &(second_genobufs[founder_ctaw]), first_genobufs, &(first_genobufs[founder_ctaw]), founder_ctl, cur_nm_ct_ptr, cur_first_sum_ptr, cur_first_ssq_ptr);
   } else {
-    SumSsqWords(second_genobufs, &(second_genobufs[founder_ctaw]), first_genobufs, &(first_genobufs[founder_ctaw]), founder_ctl, cur_first_sum_ptr, cur_first_ssq_ptr);
+    g_simd_kernels.sum_ssq_words(second_genobufs, &(second_genobufs[founder_ctaw]), first_genobufs, &(first_genobufs[founder_ctaw]), founder_ctl, cur_first_sum_ptr, cur_first_ssq_ptr);
     *cur_nm_ct_ptr = second_nm_ct;
   }
 }
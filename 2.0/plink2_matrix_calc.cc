@@ -19,6 +19,7 @@
 #include "plink2_matrix.h"
 #include "plink2_matrix_calc.h"
 #include "plink2_random.h"
+#include "plink2_simd.h"
 
 #ifdef USE_CUDA
 #  include "cuda/plink2_matrix_cuda.h"
@@ -539,6 +540,541 @@ PglErr KingCutoffBatch(const SampleIdInfo* siip, uint32_t raw_sample_ct, double
   return reterr;
 }
 
+// Parses the header line of a KING- or plink2-generated .kin0 file.  If
+// kinship_skip_ptr is non-null, the kinship-coefficient column is also
+// located.
+PglErr Kin0HeaderParse(const SampleIdInfo* siip, const char* file_descrip, TextStream* txsp, XidMode* xid_mode_ptr, uint32_t* skip_sid_ptr, uint32_t* kinship_skip_ptr) {
+  PglErr reterr = kPglRetSuccess;
+  {
+    const char* linebuf_iter = TextGet(txsp);
+    if (unlikely(!linebuf_iter)) {
+      if (!TextStreamErrcode2(txsp, &reterr)) {
+        logerrprintf("Error: Empty %s.\n", file_descrip);
+        goto Kin0HeaderParse_ret_MALFORMED_INPUT;
+      }
+      TextStreamErrPrint(file_descrip, txsp);
+      goto Kin0HeaderParse_ret_1;
+    }
+    XidMode xid_mode = siip->sids? kfXidModeFidIidSid : kfXidModeIidSid;
+    uint32_t skip_sid = 0;
+    const char* token_end = CurTokenEnd(linebuf_iter);
+    uint32_t token_slen = token_end - linebuf_iter;
+    // Make this work with both KING- and plink2-generated .kin0 files.
+    uint32_t fid_present = strequal_k(linebuf_iter, "#FID1", token_slen) || strequal_k(linebuf_iter, "FID", token_slen);
+    if (fid_present) {
+      linebuf_iter = FirstNonTspace(token_end);
+      token_end = CurTokenEnd(linebuf_iter);
+      token_slen = token_end - linebuf_iter;
+      xid_mode = kfXidModeFidIid;
+    } else {
+      if (unlikely(*linebuf_iter != '#')) {
+        goto Kin0HeaderParse_ret_INVALID_HEADER;
+      }
+      ++linebuf_iter;
+      --token_slen;
+      xid_mode = kfXidModeIid;
+    }
+    if (unlikely((!strequal_k(linebuf_iter, "ID1", token_slen)) && (!strequal_k(linebuf_iter, "IID1", token_slen)))) {
+      goto Kin0HeaderParse_ret_INVALID_HEADER;
+    }
+    linebuf_iter = FirstNonTspace(token_end);
+    token_end = CurTokenEnd(linebuf_iter);
+    token_slen = token_end - linebuf_iter;
+    if (strequal_k(linebuf_iter, "SID1", token_slen)) {
+      if (siip->sids) {
+        xid_mode = fid_present? kfXidModeFidIidSid : kfXidModeIidSid;
+      } else {
+        skip_sid = 1;
+      }
+      linebuf_iter = FirstNonTspace(token_end);
+      token_end = CurTokenEnd(linebuf_iter);
+      token_slen = token_end - linebuf_iter;
+    }
+    if (fid_present) {
+      if (unlikely(!strequal_k(linebuf_iter, "FID2", token_slen))) {
+        goto Kin0HeaderParse_ret_INVALID_HEADER;
+      }
+      linebuf_iter = FirstNonTspace(token_end);
+      token_end = CurTokenEnd(linebuf_iter);
+      token_slen = token_end - linebuf_iter;
+    }
+    if (unlikely((!strequal_k(linebuf_iter, "ID2", token_slen)) && (!strequal_k(linebuf_iter, "IID2", token_slen)))) {
+      goto Kin0HeaderParse_ret_INVALID_HEADER;
+    }
+    if (xid_mode == kfXidModeFidIidSid) {
+      // technically don't need to check this in skip_sid case
+      linebuf_iter = FirstNonTspace(token_end);
+      token_end = CurTokenEnd(linebuf_iter);
+      token_slen = token_end - linebuf_iter;
+      if (unlikely(!strequal_k(linebuf_iter, "SID2", token_slen))) {
+        goto Kin0HeaderParse_ret_INVALID_HEADER;
+      }
+    }
+    if (kinship_skip_ptr) {
+      uint32_t kinship_skip = 0;
+      while (1) {
+        linebuf_iter = FirstNonTspace(token_end);
+        token_end = CurTokenEnd(linebuf_iter);
+        token_slen = token_end - linebuf_iter;
+        if (unlikely(!token_slen)) {
+          logerrprintf("Error: No kinship-coefficient column in %s.\n", file_descrip);
+          goto Kin0HeaderParse_ret_INCONSISTENT_INPUT;
+        }
+        if (strequal_k(linebuf_iter, "KINSHIP", token_slen) || strequal_k(linebuf_iter, "Kinship", token_slen)) {
+          break;
+        }
+        ++kinship_skip;
+      }
+      *kinship_skip_ptr = kinship_skip;
+    }
+    *xid_mode_ptr = xid_mode;
+    *skip_sid_ptr = skip_sid;
+  }
+  while (0) {
+  Kin0HeaderParse_ret_INVALID_HEADER:
+    logerrprintf("Error: Invalid header line in %s.\n", file_descrip);
+  Kin0HeaderParse_ret_MALFORMED_INPUT:
+    reterr = kPglRetMalformedInput;
+    break;
+  Kin0HeaderParse_ret_INCONSISTENT_INPUT:
+    reterr = kPglRetInconsistentInput;
+    break;
+  }
+ Kin0HeaderParse_ret_1:
+  return reterr;
+}
+
+typedef struct KinshipPruneSparseCtxStruct {
+  // compressed sparse row representation of the kinship graph
+  const uintptr_t* adj_offsets;
+  const uint32_t* adj_sample_idxs;
+  // component vertex lists (ascending sample_idx within each component)
+  const uint32_t* component_vertex_starts;
+  const uint32_t* component_vertices;
+  uint32_t* thread_component_starts;
+  uint32_t** thread_degree_cts;
+
+  // Doubles as removal marker (UINT32_MAX).  Components are disjoint, so
+  // threads never touch the same entries.
+  uint32_t* vertex_degree;
+} KinshipPruneSparseCtx;
+
+void KinshipPruneSparseMain(uintptr_t tidx, KinshipPruneSparseCtx* ctx) {
+  const uintptr_t* adj_offsets = ctx->adj_offsets;
+  const uint32_t* adj_sample_idxs = ctx->adj_sample_idxs;
+  const uint32_t* component_vertex_starts = ctx->component_vertex_starts;
+  const uint32_t* component_vertices = ctx->component_vertices;
+  const uint32_t component_idx_end = ctx->thread_component_starts[tidx + 1];
+  uint32_t* degree_cts = ctx->thread_degree_cts[tidx];
+  uint32_t* vertex_degree = ctx->vertex_degree;
+  for (uint32_t component_idx = ctx->thread_component_starts[tidx]; component_idx != component_idx_end; ++component_idx) {
+    // Same greedy rule as KinshipPruneDestructive(), applied to one connected
+    // component at a time; since components don't interact, the end result
+    // is identical.
+    const uint32_t* cur_vertices = &(component_vertices[component_vertex_starts[component_idx]]);
+    const uint32_t cur_vertex_ct = component_vertex_starts[component_idx + 1] - component_vertex_starts[component_idx];
+    uint32_t max_degree = 0;
+    for (uint32_t vertex_idx = 0; vertex_idx != cur_vertex_ct; ++vertex_idx) {
+      const uint32_t cur_degree = vertex_degree[cur_vertices[vertex_idx]];
+      if (cur_degree > max_degree) {
+        max_degree = cur_degree;
+      }
+    }
+    ZeroU32Arr(max_degree + 1, degree_cts);
+    for (uint32_t vertex_idx = 0; vertex_idx != cur_vertex_ct; ++vertex_idx) {
+      degree_cts[vertex_degree[cur_vertices[vertex_idx]]] += 1;
+    }
+    uint32_t live_ct = cur_vertex_ct;
+    // vertices before this position are all removed or isolated
+    uint32_t first_live_idx = 0;
+    while (live_ct) {
+      // degree + 1 is 0 for removed vertices, 1 for isolated ones
+      while (vertex_degree[cur_vertices[first_live_idx]] + 1 < 2) {
+        ++first_live_idx;
+      }
+      uint32_t prune_sample_idx;
+      if (degree_cts[1]) {
+        uint32_t vertex_idx = first_live_idx;
+        while (vertex_degree[cur_vertices[vertex_idx]] != 1) {
+          ++vertex_idx;
+        }
+        // find partner
+        const uint32_t degree_1_sample_idx = cur_vertices[vertex_idx];
+        const uint32_t* adj_iter = &(adj_sample_idxs[adj_offsets[degree_1_sample_idx]]);
+        while (!(vertex_degree[*adj_iter] + 1)) {
+          ++adj_iter;
+        }
+        prune_sample_idx = *adj_iter;
+      } else {
+        while (!degree_cts[max_degree]) {
+          --max_degree;
+        }
+        uint32_t vertex_idx = first_live_idx;
+        while (vertex_degree[cur_vertices[vertex_idx]] != max_degree) {
+          ++vertex_idx;
+        }
+        prune_sample_idx = cur_vertices[vertex_idx];
+      }
+      const uintptr_t adj_end = adj_offsets[prune_sample_idx + 1];
+      for (uintptr_t adj_idx = adj_offsets[prune_sample_idx]; adj_idx != adj_end; ++adj_idx) {
+        const uint32_t neighbor_sample_idx = adj_sample_idxs[adj_idx];
+        const uint32_t old_degree = vertex_degree[neighbor_sample_idx];
+        if (old_degree + 1) {
+          degree_cts[old_degree] -= 1;
+          degree_cts[old_degree - 1] += 1;
+          vertex_degree[neighbor_sample_idx] = old_degree - 1;
+          live_ct -= (old_degree == 1);
+        }
+      }
+      degree_cts[vertex_degree[prune_sample_idx]] -= 1;
+      vertex_degree[prune_sample_idx] = UINT32_MAX;
+      --live_ct;
+    }
+  }
+}
+
+THREAD_FUNC_DECL KinshipPruneSparseThread(void* raw_arg) {
+  ThreadGroupFuncArg* arg = S_CAST(ThreadGroupFuncArg*, raw_arg);
+  KinshipPruneSparseCtx* ctx = S_CAST(KinshipPruneSparseCtx*, arg->sharedp->context);
+  KinshipPruneSparseMain(arg->tidx, ctx);
+  THREAD_RETURN;
+}
+
+PglErr KingCutoffTable(const SampleIdInfo* siip, const char* kin0_fname, uint32_t raw_sample_ct, double king_cutoff, uint32_t max_thread_ct, uintptr_t* sample_include, uint32_t* sample_ct_ptr) {
+  // Memory requirement is linear in (sample_ct + related pair count), instead
+  // of quadratic in sample_ct like KingCutoffBatch().
+  unsigned char* bigstack_mark = g_bigstack_base;
+  uintptr_t line_idx = 1;
+  PglErr reterr = kPglRetSuccess;
+  TextStream txs;
+  ThreadGroup tg;
+  PreinitTextStream(&txs);
+  PreinitThreads(&tg);
+  {
+    const uint32_t orig_sample_ct = *sample_ct_ptr;
+    const uint32_t raw_sample_ctl = BitCtToWordCt(raw_sample_ct);
+    uint32_t* sample_include_cumulative_popcounts;
+    if (unlikely(bigstack_alloc_u32(raw_sample_ctl, &sample_include_cumulative_popcounts))) {
+      goto KingCutoffTable_ret_NOMEM;
+    }
+    FillCumulativePopcounts(sample_include, raw_sample_ctl, sample_include_cumulative_popcounts);
+    reterr = InitTextStream(kin0_fname, kTextStreamBlenFast, 1, &txs);
+    if (unlikely(reterr)) {
+      if (reterr == kPglRetEof) {
+        logerrputs("Error: Empty --king-cutoff-table file.\n");
+        goto KingCutoffTable_ret_MALFORMED_INPUT;
+      }
+      goto KingCutoffTable_ret_TSTREAM_FAIL;
+    }
+    XidMode xid_mode;
+    uint32_t skip_sid;
+    uint32_t kinship_skip;
+    reterr = Kin0HeaderParse(siip, "--king-cutoff-table file", &txs, &xid_mode, &skip_sid, &kinship_skip);
+    if (unlikely(reterr)) {
+      goto KingCutoffTable_ret_1;
+    }
+    uint32_t* xid_map;  // IDs not collapsed
+    char* sorted_xidbox;
+    uintptr_t max_xid_blen;
+    reterr = SortedXidboxInitAlloc(sample_include, siip, orig_sample_ct, 0, xid_mode, 0, &sorted_xidbox, &xid_map, &max_xid_blen);
+    if (unlikely(reterr)) {
+      goto KingCutoffTable_ret_1;
+    }
+    char* idbuf;
+    if (unlikely(bigstack_alloc_c(max_xid_blen, &idbuf))) {
+      goto KingCutoffTable_ret_NOMEM;
+    }
+
+    // Load edges as (larger sample_idx << 32) | smaller sample_idx, so sorting
+    // makes duplicate removal trivial.
+    uint64_t* edges = R_CAST(uint64_t*, g_bigstack_base);
+    // leave room for the adjacency lists
+    const uintptr_t edge_capacity = bigstack_left() / (2 * sizeof(int64_t));
+    uintptr_t edge_ct = 0;
+    ++line_idx;
+    for (char* line_iter = TextLineEnd(&txs); TextGetUnsafe2(&txs, &line_iter); line_iter = AdvPastDelim(line_iter, '\n'), ++line_idx) {
+      const char* linebuf_iter = line_iter;
+      uint32_t sample_uidx1;
+      if (SortedXidboxReadFind(sorted_xidbox, xid_map, max_xid_blen, orig_sample_ct, 0, xid_mode, &linebuf_iter, &sample_uidx1, idbuf)) {
+        if (unlikely(!linebuf_iter)) {
+          goto KingCutoffTable_ret_MISSING_TOKENS;
+        }
+        line_iter = K_CAST(char*, linebuf_iter);
+        continue;
+      }
+      linebuf_iter = FirstNonTspace(linebuf_iter);
+      if (skip_sid) {
+        if (unlikely(IsEolnKns(*linebuf_iter))) {
+          goto KingCutoffTable_ret_MISSING_TOKENS;
+        }
+        linebuf_iter = FirstNonTspace(CurTokenEnd(linebuf_iter));
+      }
+      uint32_t sample_uidx2;
+      if (SortedXidboxReadFind(sorted_xidbox, xid_map, max_xid_blen, orig_sample_ct, 0, xid_mode, &linebuf_iter, &sample_uidx2, idbuf)) {
+        if (unlikely(!linebuf_iter)) {
+          goto KingCutoffTable_ret_MISSING_TOKENS;
+        }
+        line_iter = K_CAST(char*, linebuf_iter);
+        continue;
+      }
+      if (unlikely(sample_uidx1 == sample_uidx2)) {
+        snprintf(g_logbuf, kLogbufSize, "Error: Identical sample IDs on line %" PRIuPTR " of --king-cutoff-table file.\n", line_idx);
+        goto KingCutoffTable_ret_INCONSISTENT_INPUT_WW;
+      }
+      linebuf_iter = FirstNonTspace(linebuf_iter);
+      linebuf_iter = NextTokenMult0(linebuf_iter, kinship_skip);
+      if (unlikely(!linebuf_iter)) {
+        goto KingCutoffTable_ret_MISSING_TOKENS;
+      }
+      double cur_kinship;
+      const char* kinship_end = ScanadvDouble(linebuf_iter, &cur_kinship);
+      if (!kinship_end) {
+        line_iter = K_CAST(char*, linebuf_iter);
+        continue;
+      }
+      if (unlikely(!IsSpaceOrEoln(*kinship_end))) {
+        kinship_end = CurTokenEnd(kinship_end);
+        *K_CAST(char*, kinship_end) = '\0';
+        logerrprintfww("Error: Invalid numeric token '%s' on line %" PRIuPTR " of --king-cutoff-table file.\n", linebuf_iter, line_idx);
+        goto KingCutoffTable_ret_MALFORMED_INPUT;
+      }
+      line_iter = K_CAST(char*, kinship_end);
+      if (cur_kinship > king_cutoff) {
+        if (unlikely(edge_ct == edge_capacity)) {
+          goto KingCutoffTable_ret_NOMEM;
+        }
+        uint32_t sample_idx1 = RawToSubsettedPos(sample_include, sample_include_cumulative_popcounts, sample_uidx1);
+        uint32_t sample_idx2 = RawToSubsettedPos(sample_include, sample_include_cumulative_popcounts, sample_uidx2);
+        if (sample_idx1 < sample_idx2) {
+          const uint32_t uii = sample_idx1;
+          sample_idx1 = sample_idx2;
+          sample_idx2 = uii;
+        }
+        edges[edge_ct++] = (S_CAST(uint64_t, sample_idx1) << 32) | sample_idx2;
+      }
+    }
+    if (unlikely(TextStreamErrcode2(&txs, &reterr))) {
+      goto KingCutoffTable_ret_TSTREAM_FAIL;
+    }
+    STD_SORT(edge_ct, u64cmp, edges);
+    {
+      uintptr_t write_idx = 0;
+      uint64_t prev_edge = ~0LLU;
+      for (uintptr_t read_idx = 0; read_idx != edge_ct; ++read_idx) {
+        const uint64_t cur_edge = edges[read_idx];
+        if (cur_edge != prev_edge) {
+          edges[write_idx++] = cur_edge;
+          prev_edge = cur_edge;
+        }
+      }
+      edge_ct = write_idx;
+    }
+    BigstackFinalizeU64(edges, edge_ct);
+    logprintf("--king-cutoff-table: %" PRIuPTR " constraint%s loaded.\n", edge_ct, (edge_ct == 1)? "" : "s");
+
+    // Build adjacency lists.
+    uint32_t* vertex_degree;
+    uintptr_t* adj_offsets;
+    uint32_t* adj_sample_idxs;
+    if (unlikely(
+            bigstack_calloc_u32(orig_sample_ct, &vertex_degree) ||
+            bigstack_alloc_w(orig_sample_ct + 1, &adj_offsets) ||
+            bigstack_alloc_u32(2 * edge_ct, &adj_sample_idxs))) {
+      goto KingCutoffTable_ret_NOMEM;
+    }
+    for (uintptr_t edge_idx = 0; edge_idx != edge_ct; ++edge_idx) {
+      const uint64_t cur_edge = edges[edge_idx];
+      vertex_degree[cur_edge >> 32] += 1;
+      vertex_degree[S_CAST(uint32_t, cur_edge)] += 1;
+    }
+    adj_offsets[0] = 0;
+    for (uint32_t sample_idx = 0; sample_idx != orig_sample_ct; ++sample_idx) {
+      adj_offsets[sample_idx + 1] = adj_offsets[sample_idx] + vertex_degree[sample_idx];
+    }
+    {
+      // Temporarily use adj_offsets[1..] as write cursors; since edges are
+      // sorted, each adjacency list ends up sorted as well.
+      // (Lower neighbors are written in order during the first pass since
+      // the high index is the major sort key; upper neighbors in the second.)
+      uintptr_t* adj_cursors;
+      if (unlikely(bigstack_end_alloc_w(orig_sample_ct, &adj_cursors))) {
+        goto KingCutoffTable_ret_NOMEM;
+      }
+      memcpy(adj_cursors, adj_offsets, orig_sample_ct * sizeof(intptr_t));
+      for (uintptr_t edge_idx = 0; edge_idx != edge_ct; ++edge_idx) {
+        const uint64_t cur_edge = edges[edge_idx];
+        const uint32_t sample_idx_hi = cur_edge >> 32;
+        adj_sample_idxs[adj_cursors[sample_idx_hi]++] = S_CAST(uint32_t, cur_edge);
+      }
+      for (uintptr_t edge_idx = 0; edge_idx != edge_ct; ++edge_idx) {
+        const uint64_t cur_edge = edges[edge_idx];
+        const uint32_t sample_idx_lo = S_CAST(uint32_t, cur_edge);
+        adj_sample_idxs[adj_cursors[sample_idx_lo]++] = cur_edge >> 32;
+      }
+      BigstackEndReset(adj_cursors);
+    }
+
+    // Connected components, via breadth-first search.
+    uint32_t* component_ids;
+    uint32_t* bfs_queue;
+    if (unlikely(
+            bigstack_alloc_u32(orig_sample_ct, &component_ids) ||
+            bigstack_alloc_u32(orig_sample_ct, &bfs_queue))) {
+      goto KingCutoffTable_ret_NOMEM;
+    }
+    SetAllU32Arr(orig_sample_ct, component_ids);
+    uint32_t component_ct = 0;
+    uint32_t nonisolated_ct = 0;
+    uint32_t max_degree = 0;
+    for (uint32_t sample_idx = 0; sample_idx != orig_sample_ct; ++sample_idx) {
+      const uint32_t cur_degree = vertex_degree[sample_idx];
+      if (cur_degree > max_degree) {
+        max_degree = cur_degree;
+      }
+      if ((!cur_degree) || (component_ids[sample_idx] != UINT32_MAX)) {
+        continue;
+      }
+      component_ids[sample_idx] = component_ct;
+      bfs_queue[0] = sample_idx;
+      uint32_t queue_read_idx = 0;
+      uint32_t queue_write_idx = 1;
+      do {
+        const uint32_t cur_sample_idx = bfs_queue[queue_read_idx++];
+        const uintptr_t adj_end = adj_offsets[cur_sample_idx + 1];
+        for (uintptr_t adj_idx = adj_offsets[cur_sample_idx]; adj_idx != adj_end; ++adj_idx) {
+          const uint32_t neighbor_sample_idx = adj_sample_idxs[adj_idx];
+          if (component_ids[neighbor_sample_idx] == UINT32_MAX) {
+            component_ids[neighbor_sample_idx] = component_ct;
+            bfs_queue[queue_write_idx++] = neighbor_sample_idx;
+          }
+        }
+      } while (queue_read_idx != queue_write_idx);
+      nonisolated_ct += queue_write_idx;
+      ++component_ct;
+    }
+    BigstackReset(bfs_queue);
+    KinshipPruneSparseCtx ctx;
+    uint32_t* component_vertex_starts;
+    uint32_t* component_vertices;
+    if (unlikely(
+            bigstack_calloc_u32(component_ct + 1, &component_vertex_starts) ||
+            bigstack_alloc_u32(nonisolated_ct, &component_vertices))) {
+      goto KingCutoffTable_ret_NOMEM;
+    }
+    for (uint32_t sample_idx = 0; sample_idx != orig_sample_ct; ++sample_idx) {
+      const uint32_t component_idx = component_ids[sample_idx];
+      if (component_idx != UINT32_MAX) {
+        component_vertex_starts[component_idx + 1] += 1;
+      }
+    }
+    for (uint32_t component_idx = 0; component_idx != component_ct; ++component_idx) {
+      component_vertex_starts[component_idx + 1] += component_vertex_starts[component_idx];
+    }
+    {
+      uint32_t* component_cursors;
+      if (unlikely(bigstack_end_alloc_u32(component_ct, &component_cursors))) {
+        goto KingCutoffTable_ret_NOMEM;
+      }
+      memcpy(component_cursors, component_vertex_starts, component_ct * sizeof(int32_t));
+      for (uint32_t sample_idx = 0; sample_idx != orig_sample_ct; ++sample_idx) {
+        const uint32_t component_idx = component_ids[sample_idx];
+        if (component_idx != UINT32_MAX) {
+          component_vertices[component_cursors[component_idx]++] = sample_idx;
+        }
+      }
+      BigstackEndReset(component_cursors);
+    }
+    if (component_ct) {
+      logprintf("--king-cutoff-table: %u sample%s in %u connected component%s.\n", nonisolated_ct, (nonisolated_ct == 1)? "" : "s", component_ct, (component_ct == 1)? "" : "s");
+    }
+
+    // Greedy removal, one thread per group of components.  Components are
+    // assigned contiguously, balanced by vertex count.
+    uint32_t calc_thread_ct = max_thread_ct;
+    if (calc_thread_ct > component_ct) {
+      calc_thread_ct = component_ct;
+    }
+    if (!calc_thread_ct) {
+      calc_thread_ct = 1;
+    }
+    if (unlikely(
+            SetThreadCt0(calc_thread_ct - 1, &tg) ||
+            bigstack_alloc_u32(calc_thread_ct + 1, &ctx.thread_component_starts) ||
+            bigstack_alloc_u32p(calc_thread_ct, &ctx.thread_degree_cts))) {
+      goto KingCutoffTable_ret_NOMEM;
+    }
+    for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
+      if (unlikely(bigstack_alloc_u32(max_degree + 1, &(ctx.thread_degree_cts[tidx])))) {
+        goto KingCutoffTable_ret_NOMEM;
+      }
+    }
+    ctx.thread_component_starts[0] = 0;
+    {
+      uint32_t component_idx = 0;
+      for (uint32_t tidx = 1; tidx != calc_thread_ct; ++tidx) {
+        const uint32_t vertex_target = (S_CAST(uint64_t, tidx) * nonisolated_ct) / calc_thread_ct;
+        while ((component_idx != component_ct) && (component_vertex_starts[component_idx] < vertex_target)) {
+          ++component_idx;
+        }
+        ctx.thread_component_starts[tidx] = component_idx;
+      }
+    }
+    ctx.thread_component_starts[calc_thread_ct] = component_ct;
+    ctx.adj_offsets = adj_offsets;
+    ctx.adj_sample_idxs = adj_sample_idxs;
+    ctx.component_vertex_starts = component_vertex_starts;
+    ctx.component_vertices = component_vertices;
+    ctx.vertex_degree = vertex_degree;
+    if (calc_thread_ct > 1) {
+      SetThreadFuncAndData(KinshipPruneSparseThread, &ctx, &tg);
+      DeclareLastThreadBlock(&tg);
+      if (unlikely(SpawnThreads(&tg))) {
+        goto KingCutoffTable_ret_THREAD_CREATE_FAIL;
+      }
+    }
+    KinshipPruneSparseMain(calc_thread_ct - 1, &ctx);
+    JoinThreads0(&tg);
+
+    uint32_t sample_ct = orig_sample_ct;
+    uintptr_t sample_widx = 0;
+    uintptr_t cur_bits = sample_include[0];
+    for (uint32_t sample_idx = 0; sample_idx != orig_sample_ct; ++sample_idx) {
+      const uintptr_t lowbit = BitIter1y(sample_include, &sample_widx, &cur_bits);
+      if (vertex_degree[sample_idx] == UINT32_MAX) {
+        sample_include[sample_widx] ^= lowbit;
+        --sample_ct;
+      }
+    }
+    *sample_ct_ptr = sample_ct;
+  }
+  while (0) {
+  KingCutoffTable_ret_NOMEM:
+    reterr = kPglRetNomem;
+    break;
+  KingCutoffTable_ret_TSTREAM_FAIL:
+    TextStreamErrPrint("--king-cutoff-table file", &txs);
+    break;
+  KingCutoffTable_ret_MALFORMED_INPUT:
+    reterr = kPglRetMalformedInput;
+    break;
+  KingCutoffTable_ret_MISSING_TOKENS:
+    snprintf(g_logbuf, kLogbufSize, "Error: Line %" PRIuPTR " of --king-cutoff-table file has fewer tokens than expected.\n", line_idx);
+  KingCutoffTable_ret_INCONSISTENT_INPUT_WW:
+    WordWrapB(0);
+    logerrputsb();
+    reterr = kPglRetInconsistentInput;
+    break;
+  KingCutoffTable_ret_THREAD_CREATE_FAIL:
+    reterr = kPglRetThreadCreateFail;
+    break;
+  }
+ KingCutoffTable_ret_1:
+  CleanupThreads(&tg);
+  CleanupTextStream2("--king-cutoff-table file", &txs, &reterr);
+  BigstackReset(bigstack_mark);
+  return reterr;
+}
+
 CONSTI32(kKingOffsetIbs0, 0);
 CONSTI32(kKingOffsetHethet, 1);
 CONSTI32(kKingOffsetHet2Hom1, 2);
@@ -919,275 +1455,8 @@ THREAD_FUNC_DECL CalcKingSparseThread(void* raw_arg) {
   THREAD_RETURN;
 }
 
-#ifdef USE_SSE42
-CONSTI32(kKingMultiplex, 1024);
-CONSTI32(kKingMultiplexWords, kKingMultiplex / kBitsPerWord);
-void IncrKing(const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts_iter) {
-  // Tried adding another level of blocking, but couldn't get it to make a
-  // difference.
-  for (uint32_t second_idx = start_idx; second_idx != end_idx; ++second_idx) {
-    // technically overflows for huge sample_ct
-    const uint32_t second_offset = second_idx * kKingMultiplexWords;
-    const uintptr_t* second_hom = &(smaj_hom[second_offset]);
-    const uintptr_t* second_ref2het = &(smaj_ref2het[second_offset]);
-    const uintptr_t* first_hom_iter = smaj_hom;
-    const uintptr_t* first_ref2het_iter = smaj_ref2het;
-    while (first_hom_iter < second_hom) {
-      uint32_t acc_ibs0 = 0;
-      uint32_t acc_hethet = 0;
-      uint32_t acc_het2hom1 = 0;
-      uint32_t acc_het1hom2 = 0;
-      for (uint32_t widx = 0; widx != kKingMultiplexWords; ++widx) {
-        const uintptr_t hom1 = first_hom_iter[widx];
-        const uintptr_t hom2 = second_hom[widx];
-        const uintptr_t ref2het1 = first_ref2het_iter[widx];
-        const uintptr_t ref2het2 = second_ref2het[widx];
-        const uintptr_t homhom = hom1 & hom2;
-        const uintptr_t het1 = ref2het1 & (~hom1);
-        const uintptr_t het2 = ref2het2 & (~hom2);
-        acc_ibs0 += PopcountWord((ref2het1 ^ ref2het2) & homhom);
-        acc_hethet += PopcountWord(het1 & het2);
-        acc_het2hom1 += PopcountWord(hom1 & het2);
-        acc_het1hom2 += PopcountWord(hom2 & het1);
-      }
-      king_counts_iter[kKingOffsetIbs0] += acc_ibs0;
-      king_counts_iter[kKingOffsetHethet] += acc_hethet;
-      king_counts_iter[kKingOffsetHet2Hom1] += acc_het2hom1;
-      king_counts_iter[kKingOffsetHet1Hom2] += acc_het1hom2;
-      king_counts_iter = &(king_counts_iter[4]);
-
-      first_hom_iter = &(first_hom_iter[kKingMultiplexWords]);
-      first_ref2het_iter = &(first_ref2het_iter[kKingMultiplexWords]);
-    }
-  }
-}
-
-void IncrKingHomhom(const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts_iter) {
-  for (uint32_t second_idx = start_idx; second_idx != end_idx; ++second_idx) {
-    // technically overflows for huge sample_ct
-    const uint32_t second_offset = second_idx * kKingMultiplexWords;
-    const uintptr_t* second_hom = &(smaj_hom[second_offset]);
-    const uintptr_t* second_ref2het = &(smaj_ref2het[second_offset]);
-    const uintptr_t* first_hom_iter = smaj_hom;
-    const uintptr_t* first_ref2het_iter = smaj_ref2het;
-    while (first_hom_iter < second_hom) {
-      uint32_t acc_homhom = 0;
-      uint32_t acc_ibs0 = 0;
-      uint32_t acc_hethet = 0;
-      uint32_t acc_het2hom1 = 0;
-      uint32_t acc_het1hom2 = 0;
-      for (uint32_t widx = 0; widx != kKingMultiplexWords; ++widx) {
-        const uintptr_t hom1 = first_hom_iter[widx];
-        const uintptr_t hom2 = second_hom[widx];
-        const uintptr_t ref2het1 = first_ref2het_iter[widx];
-        const uintptr_t ref2het2 = second_ref2het[widx];
-        const uintptr_t homhom = hom1 & hom2;
-        const uintptr_t het1 = ref2het1 & (~hom1);
-        const uintptr_t het2 = ref2het2 & (~hom2);
-        acc_homhom += PopcountWord(homhom);
-        acc_ibs0 += PopcountWord((ref2het1 ^ ref2het2) & homhom);
-        acc_hethet += PopcountWord(het1 & het2);
-        acc_het2hom1 += PopcountWord(hom1 & het2);
-        acc_het1hom2 += PopcountWord(hom2 & het1);
-      }
-      king_counts_iter[kKingOffsetIbs0] += acc_ibs0;
-      king_counts_iter[kKingOffsetHethet] += acc_hethet;
-      king_counts_iter[kKingOffsetHet2Hom1] += acc_het2hom1;
-      king_counts_iter[kKingOffsetHet1Hom2] += acc_het1hom2;
-      king_counts_iter[kKingOffsetHomhom] += acc_homhom;
-      king_counts_iter = &(king_counts_iter[5]);
-
-      first_hom_iter = &(first_hom_iter[kKingMultiplexWords]);
-      first_ref2het_iter = &(first_ref2het_iter[kKingMultiplexWords]);
-    }
-  }
-}
-#else  // !USE_SSE42
-#  ifdef __LP64__
-CONSTI32(kKingMultiplex, 1536);
-#  else
-CONSTI32(kKingMultiplex, 960);
-#  endif
-static_assert(kKingMultiplex % (3 * kBitsPerVec) == 0, "Invalid kKingMultiplex value.");
+CONSTI32(kKingMultiplex, PLINK2_KING_MULTIPLEX);
 CONSTI32(kKingMultiplexWords, kKingMultiplex / kBitsPerWord);
-CONSTI32(kKingMultiplexVecs, kKingMultiplex / kBitsPerVec);
-// expensive PopcountWord().  Use Lauradoux/Walisch accumulators, since
-// Harley-Seal requires too many variables.
-void IncrKing(const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts_iter) {
-  const VecW m1 = VCONST_W(kMask5555);
-  const VecW m2 = VCONST_W(kMask3333);
-  const VecW m4 = VCONST_W(kMask0F0F);
-  for (uint32_t second_idx = start_idx; second_idx != end_idx; ++second_idx) {
-    // technically overflows for huge sample_ct
-    const uint32_t second_offset = second_idx * kKingMultiplexWords;
-    const VecW* second_hom = R_CAST(const VecW*, &(smaj_hom[second_offset]));
-    const VecW* second_ref2het = R_CAST(const VecW*, &(smaj_ref2het[second_offset]));
-    const VecW* first_hom_iter = R_CAST(const VecW*, smaj_hom);
-    const VecW* first_ref2het_iter = R_CAST(const VecW*, smaj_ref2het);
-    while (first_hom_iter < second_hom) {
-      UniVec acc_ibs0;
-      UniVec acc_hethet;
-      UniVec acc_het2hom1;
-      UniVec acc_het1hom2;
-      acc_ibs0.vw = vecw_setzero();
-      acc_hethet.vw = vecw_setzero();
-      acc_het2hom1.vw = vecw_setzero();
-      acc_het1hom2.vw = vecw_setzero();
-      for (uint32_t vec_idx = 0; vec_idx < kKingMultiplexVecs; vec_idx += 3) {
-        VecW hom1 = first_hom_iter[vec_idx];
-        VecW hom2 = second_hom[vec_idx];
-        VecW ref2het1 = first_ref2het_iter[vec_idx];
-        VecW ref2het2 = second_ref2het[vec_idx];
-        VecW het1 = vecw_and_notfirst(hom1, ref2het1);
-        VecW het2 = vecw_and_notfirst(hom2, ref2het2);
-        VecW agg_ibs0 = (ref2het1 ^ ref2het2) & (hom1 & hom2);
-        VecW agg_hethet = het1 & het2;
-        VecW agg_het2hom1 = hom1 & het2;
-        VecW agg_het1hom2 = hom2 & het1;
-        agg_ibs0 = agg_ibs0 - (vecw_srli(agg_ibs0, 1) & m1);
-        agg_hethet = agg_hethet - (vecw_srli(agg_hethet, 1) & m1);
-        agg_het2hom1 = agg_het2hom1 - (vecw_srli(agg_het2hom1, 1) & m1);
-        agg_het1hom2 = agg_het1hom2 - (vecw_srli(agg_het1hom2, 1) & m1);
-        agg_ibs0 = (agg_ibs0 & m2) + (vecw_srli(agg_ibs0, 2) & m2);
-        agg_hethet = (agg_hethet & m2) + (vecw_srli(agg_hethet, 2) & m2);
-        agg_het2hom1 = (agg_het2hom1 & m2) + (vecw_srli(agg_het2hom1, 2) & m2);
-        agg_het1hom2 = (agg_het1hom2 & m2) + (vecw_srli(agg_het1hom2, 2) & m2);
-
-        for (uint32_t offset = 1; offset != 3; ++offset) {
-          hom1 = first_hom_iter[vec_idx + offset];
-          hom2 = second_hom[vec_idx + offset];
-          ref2het1 = first_ref2het_iter[vec_idx + offset];
-          ref2het2 = second_ref2het[vec_idx + offset];
-          het1 = vecw_and_notfirst(hom1, ref2het1);
-          het2 = vecw_and_notfirst(hom2, ref2het2);
-          VecW cur_ibs0 = (ref2het1 ^ ref2het2) & (hom1 & hom2);
-          VecW cur_hethet = het1 & het2;
-          VecW cur_het2hom1 = hom1 & het2;
-          VecW cur_het1hom2 = hom2 & het1;
-          cur_ibs0 = cur_ibs0 - (vecw_srli(cur_ibs0, 1) & m1);
-          cur_hethet = cur_hethet - (vecw_srli(cur_hethet, 1) & m1);
-          cur_het2hom1 = cur_het2hom1 - (vecw_srli(cur_het2hom1, 1) & m1);
-          cur_het1hom2 = cur_het1hom2 - (vecw_srli(cur_het1hom2, 1) & m1);
-          agg_ibs0 += (cur_ibs0 & m2) + (vecw_srli(cur_ibs0, 2) & m2);
-          agg_hethet += (cur_hethet & m2) + (vecw_srli(cur_hethet, 2) & m2);
-          agg_het2hom1 += (cur_het2hom1 & m2) + (vecw_srli(cur_het2hom1, 2) & m2);
-          agg_het1hom2 += (cur_het1hom2 & m2) + (vecw_srli(cur_het1hom2, 2) & m2);
-        }
-        acc_ibs0.vw = acc_ibs0.vw + (agg_ibs0 & m4) + (vecw_srli(agg_ibs0, 4) & m4);
-        acc_hethet.vw = acc_hethet.vw + (agg_hethet & m4) + (vecw_srli(agg_hethet, 4) & m4);
-        acc_het2hom1.vw = acc_het2hom1.vw + (agg_het2hom1 & m4) + (vecw_srli(agg_het2hom1, 4) & m4);
-        acc_het1hom2.vw = acc_het1hom2.vw + (agg_het1hom2 & m4) + (vecw_srli(agg_het1hom2, 4) & m4);
-      }
-      const VecW m8 = VCONST_W(kMask00FF);
-      acc_ibs0.vw = (acc_ibs0.vw & m8) + (vecw_srli(acc_ibs0.vw, 8) & m8);
-      acc_hethet.vw = (acc_hethet.vw & m8) + (vecw_srli(acc_hethet.vw, 8) & m8);
-      acc_het2hom1.vw = (acc_het2hom1.vw & m8) + (vecw_srli(acc_het2hom1.vw, 8) & m8);
-      acc_het1hom2.vw = (acc_het1hom2.vw & m8) + (vecw_srli(acc_het1hom2.vw, 8) & m8);
-      king_counts_iter[kKingOffsetIbs0] += UniVecHsum16(acc_ibs0);
-      king_counts_iter[kKingOffsetHethet] += UniVecHsum16(acc_hethet);
-      king_counts_iter[kKingOffsetHet2Hom1] += UniVecHsum16(acc_het2hom1);
-      king_counts_iter[kKingOffsetHet1Hom2] += UniVecHsum16(acc_het1hom2);
-      king_counts_iter = &(king_counts_iter[4]);
-
-      first_hom_iter = &(first_hom_iter[kKingMultiplexVecs]);
-      first_ref2het_iter = &(first_ref2het_iter[kKingMultiplexVecs]);
-    }
-  }
-}
-
-void IncrKingHomhom(const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts_iter) {
-  const VecW m1 = VCONST_W(kMask5555);
-  const VecW m2 = VCONST_W(kMask3333);
-  const VecW m4 = VCONST_W(kMask0F0F);
-  for (uint32_t second_idx = start_idx; second_idx != end_idx; ++second_idx) {
-    // technically overflows for huge sample_ct
-    const uint32_t second_offset = second_idx * kKingMultiplexWords;
-    const VecW* second_hom = R_CAST(const VecW*, &(smaj_hom[second_offset]));
-    const VecW* second_ref2het = R_CAST(const VecW*, &(smaj_ref2het[second_offset]));
-    const VecW* first_hom_iter = R_CAST(const VecW*, smaj_hom);
-    const VecW* first_ref2het_iter = R_CAST(const VecW*, smaj_ref2het);
-    while (first_hom_iter < second_hom) {
-      UniVec acc_homhom;
-      UniVec acc_ibs0;
-      UniVec acc_hethet;
-      UniVec acc_het2hom1;
-      UniVec acc_het1hom2;
-      acc_homhom.vw = vecw_setzero();
-      acc_ibs0.vw = vecw_setzero();
-      acc_hethet.vw = vecw_setzero();
-      acc_het2hom1.vw = vecw_setzero();
-      acc_het1hom2.vw = vecw_setzero();
-      for (uint32_t vec_idx = 0; vec_idx < kKingMultiplexVecs; vec_idx += 3) {
-        VecW hom1 = first_hom_iter[vec_idx];
-        VecW hom2 = second_hom[vec_idx];
-        VecW ref2het1 = first_ref2het_iter[vec_idx];
-        VecW ref2het2 = second_ref2het[vec_idx];
-        VecW agg_homhom = hom1 & hom2;
-        VecW het1 = vecw_and_notfirst(hom1, ref2het1);
-        VecW het2 = vecw_and_notfirst(hom2, ref2het2);
-        VecW agg_ibs0 = (ref2het1 ^ ref2het2) & agg_homhom;
-        VecW agg_hethet = het1 & het2;
-        VecW agg_het2hom1 = hom1 & het2;
-        VecW agg_het1hom2 = hom2 & het1;
-        agg_homhom = agg_homhom - (vecw_srli(agg_homhom, 1) & m1);
-        agg_ibs0 = agg_ibs0 - (vecw_srli(agg_ibs0, 1) & m1);
-        agg_hethet = agg_hethet - (vecw_srli(agg_hethet, 1) & m1);
-        agg_het2hom1 = agg_het2hom1 - (vecw_srli(agg_het2hom1, 1) & m1);
-        agg_het1hom2 = agg_het1hom2 - (vecw_srli(agg_het1hom2, 1) & m1);
-        agg_homhom = (agg_homhom & m2) + (vecw_srli(agg_homhom, 2) & m2);
-        agg_ibs0 = (agg_ibs0 & m2) + (vecw_srli(agg_ibs0, 2) & m2);
-        agg_hethet = (agg_hethet & m2) + (vecw_srli(agg_hethet, 2) & m2);
-        agg_het2hom1 = (agg_het2hom1 & m2) + (vecw_srli(agg_het2hom1, 2) & m2);
-        agg_het1hom2 = (agg_het1hom2 & m2) + (vecw_srli(agg_het1hom2, 2) & m2);
-
-        for (uint32_t offset = 1; offset != 3; ++offset) {
-          hom1 = first_hom_iter[vec_idx + offset];
-          hom2 = second_hom[vec_idx + offset];
-          ref2het1 = first_ref2het_iter[vec_idx + offset];
-          ref2het2 = second_ref2het[vec_idx + offset];
-          VecW cur_homhom = hom1 & hom2;
-          het1 = vecw_and_notfirst(hom1, ref2het1);
-          het2 = vecw_and_notfirst(hom2, ref2het2);
-          VecW cur_ibs0 = (ref2het1 ^ ref2het2) & cur_homhom;
-          VecW cur_hethet = het1 & het2;
-          VecW cur_het2hom1 = hom1 & het2;
-          VecW cur_het1hom2 = hom2 & het1;
-          cur_homhom = cur_homhom - (vecw_srli(cur_homhom, 1) & m1);
-          cur_ibs0 = cur_ibs0 - (vecw_srli(cur_ibs0, 1) & m1);
-          cur_hethet = cur_hethet - (vecw_srli(cur_hethet, 1) & m1);
-          cur_het2hom1 = cur_het2hom1 - (vecw_srli(cur_het2hom1, 1) & m1);
-          cur_het1hom2 = cur_het1hom2 - (vecw_srli(cur_het1hom2, 1) & m1);
-          agg_homhom += (cur_homhom & m2) + (vecw_srli(cur_homhom, 2) & m2);
-          agg_ibs0 += (cur_ibs0 & m2) + (vecw_srli(cur_ibs0, 2) & m2);
-          agg_hethet += (cur_hethet & m2) + (vecw_srli(cur_hethet, 2) & m2);
-          agg_het2hom1 += (cur_het2hom1 & m2) + (vecw_srli(cur_het2hom1, 2) & m2);
-          agg_het1hom2 += (cur_het1hom2 & m2) + (vecw_srli(cur_het1hom2, 2) & m2);
-        }
-        acc_homhom.vw = acc_homhom.vw + (agg_homhom & m4) + (vecw_srli(agg_homhom, 4) & m4);
-        acc_ibs0.vw = acc_ibs0.vw + (agg_ibs0 & m4) + (vecw_srli(agg_ibs0, 4) & m4);
-        acc_hethet.vw = acc_hethet.vw + (agg_hethet & m4) + (vecw_srli(agg_hethet, 4) & m4);
-        acc_het2hom1.vw = acc_het2hom1.vw + (agg_het2hom1 & m4) + (vecw_srli(agg_het2hom1, 4) & m4);
-        acc_het1hom2.vw = acc_het1hom2.vw + (agg_het1hom2 & m4) + (vecw_srli(agg_het1hom2, 4) & m4);
-      }
-      const VecW m8 = VCONST_W(kMask00FF);
-      acc_homhom.vw = (acc_homhom.vw & m8) + (vecw_srli(acc_homhom.vw, 8) & m8);
-      acc_ibs0.vw = (acc_ibs0.vw & m8) + (vecw_srli(acc_ibs0.vw, 8) & m8);
-      acc_hethet.vw = (acc_hethet.vw & m8) + (vecw_srli(acc_hethet.vw, 8) & m8);
-      acc_het2hom1.vw = (acc_het2hom1.vw & m8) + (vecw_srli(acc_het2hom1.vw, 8) & m8);
-      acc_het1hom2.vw = (acc_het1hom2.vw & m8) + (vecw_srli(acc_het1hom2.vw, 8) & m8);
-      king_counts_iter[kKingOffsetIbs0] += UniVecHsum16(acc_ibs0);
-      king_counts_iter[kKingOffsetHethet] += UniVecHsum16(acc_hethet);
-      king_counts_iter[kKingOffsetHet2Hom1] += UniVecHsum16(acc_het2hom1);
-      king_counts_iter[kKingOffsetHet1Hom2] += UniVecHsum16(acc_het1hom2);
-      king_counts_iter[kKingOffsetHomhom] += UniVecHsum16(acc_homhom);
-      king_counts_iter = &(king_counts_iter[5]);
-
-      first_hom_iter = &(first_hom_iter[kKingMultiplexVecs]);
-      first_ref2het_iter = &(first_ref2het_iter[kKingMultiplexVecs]);
-    }
-  }
-}
-#endif
 static_assert(!(kKingMultiplexWords % 2), "kKingMultiplexWords must be even for safe bit-transpose.");
 
 typedef struct CalcKingDenseCtxStruct {
@@ -1212,9 +1481,9 @@ THREAD_FUNC_DECL CalcKingDenseThread(void* raw_arg) {
   uint32_t parity = 0;
   do {
     if (homhom_needed) {
-      IncrKingHomhom(ctx->smaj_hom[parity], ctx->smaj_ref2het[parity], start_idx, end_idx, &(ctx->king_counts[((start_idx * (start_idx - 1) - mem_start_idx * (mem_start_idx - 1)) / 2) * 5]));
+      g_simd_kernels.incr_king_homhom(ctx->smaj_hom[parity], ctx->smaj_ref2het[parity], start_idx, end_idx, &(ctx->king_counts[((start_idx * (start_idx - 1) - mem_start_idx * (mem_start_idx - 1)) / 2) * 5]));
     } else {
-      IncrKing(ctx->smaj_hom[parity], ctx->smaj_ref2het[parity], start_idx, end_idx, &(ctx->king_counts[(start_idx * (start_idx - 1) - mem_start_idx * (mem_start_idx - 1)) * 2]));
+      g_simd_kernels.incr_king(ctx->smaj_hom[parity], ctx->smaj_ref2het[parity], start_idx, end_idx, &(ctx->king_counts[(start_idx * (start_idx - 1) - mem_start_idx * (mem_start_idx - 1)) * 2]));
     }
     parity = 1 - parity;
   } while (!THREAD_BLOCK_FINISH(arg));
@@ -2154,254 +2423,6 @@ PglErr CalcKing(const SampleIdInfo* siip, const uintptr_t* variant_include_orig,
   return reterr;
 }
 
-#ifdef USE_SSE42
-void IncrKingSubset(const uint32_t* loaded_sample_idx_pairs, const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts) {
-  const uint32_t* sample_idx_pair_iter = &(loaded_sample_idx_pairs[(2 * k1LU) * start_idx]);
-  const uint32_t* sample_idx_pair_stop = &(loaded_sample_idx_pairs[(2 * k1LU) * end_idx]);
-  uint32_t* king_counts_iter = &(king_counts[(4 * k1LU) * start_idx]);
-  while (sample_idx_pair_iter != sample_idx_pair_stop) {
-    // technically overflows for huge sample_ct
-    const uint32_t first_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
-    const uint32_t second_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
-    const uintptr_t* first_hom = &(smaj_hom[first_offset]);
-    const uintptr_t* first_ref2het = &(smaj_ref2het[first_offset]);
-    const uintptr_t* second_hom = &(smaj_hom[second_offset]);
-    const uintptr_t* second_ref2het = &(smaj_ref2het[second_offset]);
-    uint32_t acc_ibs0 = 0;
-    uint32_t acc_hethet = 0;
-    uint32_t acc_het2hom1 = 0;
-    uint32_t acc_het1hom2 = 0;
-    for (uint32_t widx = 0; widx != kKingMultiplexWords; ++widx) {
-      const uintptr_t hom1 = first_hom[widx];
-      const uintptr_t hom2 = second_hom[widx];
-      const uintptr_t ref2het1 = first_ref2het[widx];
-      const uintptr_t ref2het2 = second_ref2het[widx];
-      const uintptr_t homhom = hom1 & hom2;
-      const uintptr_t het1 = ref2het1 & (~hom1);
-      const uintptr_t het2 = ref2het2 & (~hom2);
-      acc_ibs0 += PopcountWord((ref2het1 ^ ref2het2) & homhom);
-      acc_hethet += PopcountWord(het1 & het2);
-      acc_het2hom1 += PopcountWord(hom1 & het2);
-      acc_het1hom2 += PopcountWord(hom2 & het1);
-    }
-    *king_counts_iter++ += acc_ibs0;
-    *king_counts_iter++ += acc_hethet;
-    *king_counts_iter++ += acc_het2hom1;
-    *king_counts_iter++ += acc_het1hom2;
-  }
-}
-
-void IncrKingSubsetHomhom(const uint32_t* loaded_sample_idx_pairs, const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts) {
-  const uint32_t* sample_idx_pair_iter = &(loaded_sample_idx_pairs[(2 * k1LU) * start_idx]);
-  const uint32_t* sample_idx_pair_stop = &(loaded_sample_idx_pairs[(2 * k1LU) * end_idx]);
-  uint32_t* king_counts_iter = &(king_counts[(5 * k1LU) * start_idx]);
-  while (sample_idx_pair_iter != sample_idx_pair_stop) {
-    // technically overflows for huge sample_ct
-    const uint32_t first_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
-    const uint32_t second_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
-    const uintptr_t* first_hom = &(smaj_hom[first_offset]);
-    const uintptr_t* first_ref2het = &(smaj_ref2het[first_offset]);
-    const uintptr_t* second_hom = &(smaj_hom[second_offset]);
-    const uintptr_t* second_ref2het = &(smaj_ref2het[second_offset]);
-    uint32_t acc_homhom = 0;
-    uint32_t acc_ibs0 = 0;
-    uint32_t acc_hethet = 0;
-    uint32_t acc_het2hom1 = 0;
-    uint32_t acc_het1hom2 = 0;
-    for (uint32_t widx = 0; widx != kKingMultiplexWords; ++widx) {
-      const uintptr_t hom1 = first_hom[widx];
-      const uintptr_t hom2 = second_hom[widx];
-      const uintptr_t ref2het1 = first_ref2het[widx];
-      const uintptr_t ref2het2 = second_ref2het[widx];
-      const uintptr_t homhom = hom1 & hom2;
-      const uintptr_t het1 = ref2het1 & (~hom1);
-      const uintptr_t het2 = ref2het2 & (~hom2);
-      acc_homhom += PopcountWord(homhom);
-      acc_ibs0 += PopcountWord((ref2het1 ^ ref2het2) & homhom);
-      acc_hethet += PopcountWord(het1 & het2);
-      acc_het2hom1 += PopcountWord(hom1 & het2);
-      acc_het1hom2 += PopcountWord(hom2 & het1);
-    }
-    *king_counts_iter++ += acc_ibs0;
-    *king_counts_iter++ += acc_hethet;
-    *king_counts_iter++ += acc_het2hom1;
-    *king_counts_iter++ += acc_het1hom2;
-    *king_counts_iter++ += acc_homhom;
-  }
-}
-#else
-void IncrKingSubset(const uint32_t* loaded_sample_idx_pairs, const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts) {
-  const VecW m1 = VCONST_W(kMask5555);
-  const VecW m2 = VCONST_W(kMask3333);
-  const VecW m4 = VCONST_W(kMask0F0F);
-  const uint32_t* sample_idx_pair_iter = &(loaded_sample_idx_pairs[(2 * k1LU) * start_idx]);
-  const uint32_t* sample_idx_pair_stop = &(loaded_sample_idx_pairs[(2 * k1LU) * end_idx]);
-  uint32_t* king_counts_iter = &(king_counts[(4 * k1LU) * start_idx]);
-  while (sample_idx_pair_iter != sample_idx_pair_stop) {
-    // technically overflows for huge sample_ct
-    const uint32_t first_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
-    const uint32_t second_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
-    const VecW* first_hom = R_CAST(const VecW*, &(smaj_hom[first_offset]));
-    const VecW* first_ref2het = R_CAST(const VecW*, &(smaj_ref2het[first_offset]));
-    const VecW* second_hom = R_CAST(const VecW*, &(smaj_hom[second_offset]));
-    const VecW* second_ref2het = R_CAST(const VecW*, &(smaj_ref2het[second_offset]));
-    UniVec acc_ibs0;
-    UniVec acc_hethet;
-    UniVec acc_het2hom1;
-    UniVec acc_het1hom2;
-    acc_ibs0.vw = vecw_setzero();
-    acc_hethet.vw = vecw_setzero();
-    acc_het2hom1.vw = vecw_setzero();
-    acc_het1hom2.vw = vecw_setzero();
-    for (uint32_t vec_idx = 0; vec_idx < kKingMultiplexVecs; vec_idx += 3) {
-      VecW hom1 = first_hom[vec_idx];
-      VecW hom2 = second_hom[vec_idx];
-      VecW ref2het1 = first_ref2het[vec_idx];
-      VecW ref2het2 = second_ref2het[vec_idx];
-      VecW het1 = vecw_and_notfirst(hom1, ref2het1);
-      VecW het2 = vecw_and_notfirst(hom2, ref2het2);
-      VecW agg_ibs0 = (ref2het1 ^ ref2het2) & (hom1 & hom2);
-      VecW agg_hethet = het1 & het2;
-      VecW agg_het2hom1 = hom1 & het2;
-      VecW agg_het1hom2 = hom2 & het1;
-      agg_ibs0 = agg_ibs0 - (vecw_srli(agg_ibs0, 1) & m1);
-      agg_hethet = agg_hethet - (vecw_srli(agg_hethet, 1) & m1);
-      agg_het2hom1 = agg_het2hom1 - (vecw_srli(agg_het2hom1, 1) & m1);
-      agg_het1hom2 = agg_het1hom2 - (vecw_srli(agg_het1hom2, 1) & m1);
-      agg_ibs0 = (agg_ibs0 & m2) + (vecw_srli(agg_ibs0, 2) & m2);
-      agg_hethet = (agg_hethet & m2) + (vecw_srli(agg_hethet, 2) & m2);
-      agg_het2hom1 = (agg_het2hom1 & m2) + (vecw_srli(agg_het2hom1, 2) & m2);
-      agg_het1hom2 = (agg_het1hom2 & m2) + (vecw_srli(agg_het1hom2, 2) & m2);
-
-      for (uint32_t offset = 1; offset != 3; ++offset) {
-        hom1 = first_hom[vec_idx + offset];
-        hom2 = second_hom[vec_idx + offset];
-        ref2het1 = first_ref2het[vec_idx + offset];
-        ref2het2 = second_ref2het[vec_idx + offset];
-        het1 = vecw_and_notfirst(hom1, ref2het1);
-        het2 = vecw_and_notfirst(hom2, ref2het2);
-        VecW cur_ibs0 = (ref2het1 ^ ref2het2) & (hom1 & hom2);
-        VecW cur_hethet = het1 & het2;
-        VecW cur_het2hom1 = hom1 & het2;
-        VecW cur_het1hom2 = hom2 & het1;
-        cur_ibs0 = cur_ibs0 - (vecw_srli(cur_ibs0, 1) & m1);
-        cur_hethet = cur_hethet - (vecw_srli(cur_hethet, 1) & m1);
-        cur_het2hom1 = cur_het2hom1 - (vecw_srli(cur_het2hom1, 1) & m1);
-        cur_het1hom2 = cur_het1hom2 - (vecw_srli(cur_het1hom2, 1) & m1);
-        agg_ibs0 += (cur_ibs0 & m2) + (vecw_srli(cur_ibs0, 2) & m2);
-        agg_hethet += (cur_hethet & m2) + (vecw_srli(cur_hethet, 2) & m2);
-        agg_het2hom1 += (cur_het2hom1 & m2) + (vecw_srli(cur_het2hom1, 2) & m2);
-        agg_het1hom2 += (cur_het1hom2 & m2) + (vecw_srli(cur_het1hom2, 2) & m2);
-      }
-      acc_ibs0.vw = acc_ibs0.vw + (agg_ibs0 & m4) + (vecw_srli(agg_ibs0, 4) & m4);
-      acc_hethet.vw = acc_hethet.vw + (agg_hethet & m4) + (vecw_srli(agg_hethet, 4) & m4);
-      acc_het2hom1.vw = acc_het2hom1.vw + (agg_het2hom1 & m4) + (vecw_srli(agg_het2hom1, 4) & m4);
-      acc_het1hom2.vw = acc_het1hom2.vw + (agg_het1hom2 & m4) + (vecw_srli(agg_het1hom2, 4) & m4);
-    }
-    const VecW m8 = VCONST_W(kMask00FF);
-    acc_ibs0.vw = (acc_ibs0.vw & m8) + (vecw_srli(acc_ibs0.vw, 8) & m8);
-    acc_hethet.vw = (acc_hethet.vw & m8) + (vecw_srli(acc_hethet.vw, 8) & m8);
-    acc_het2hom1.vw = (acc_het2hom1.vw & m8) + (vecw_srli(acc_het2hom1.vw, 8) & m8);
-    acc_het1hom2.vw = (acc_het1hom2.vw & m8) + (vecw_srli(acc_het1hom2.vw, 8) & m8);
-    *king_counts_iter++ += UniVecHsum16(acc_ibs0);
-    *king_counts_iter++ += UniVecHsum16(acc_hethet);
-    *king_counts_iter++ += UniVecHsum16(acc_het2hom1);
-    *king_counts_iter++ += UniVecHsum16(acc_het1hom2);
-  }
-}
-
-void IncrKingSubsetHomhom(const uint32_t* loaded_sample_idx_pairs, const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts) {
-  const VecW m1 = VCONST_W(kMask5555);
-  const VecW m2 = VCONST_W(kMask3333);
-  const VecW m4 = VCONST_W(kMask0F0F);
-  const uint32_t* sample_idx_pair_iter = &(loaded_sample_idx_pairs[(2 * k1LU) * start_idx]);
-  const uint32_t* sample_idx_pair_stop = &(loaded_sample_idx_pairs[(2 * k1LU) * end_idx]);
-  uint32_t* king_counts_iter = &(king_counts[(5 * k1LU) * start_idx]);
-  while (sample_idx_pair_iter != sample_idx_pair_stop) {
-    // technically overflows for huge sample_ct
-    const uint32_t first_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
-    const uint32_t second_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
-    const VecW* first_hom = R_CAST(const VecW*, &(smaj_hom[first_offset]));
-    const VecW* first_ref2het = R_CAST(const VecW*, &(smaj_ref2het[first_offset]));
-    const VecW* second_hom = R_CAST(const VecW*, &(smaj_hom[second_offset]));
-    const VecW* second_ref2het = R_CAST(const VecW*, &(smaj_ref2het[second_offset]));
-    UniVec acc_homhom;
-    UniVec acc_ibs0;
-    UniVec acc_hethet;
-    UniVec acc_het2hom1;
-    UniVec acc_het1hom2;
-    acc_homhom.vw = vecw_setzero();
-    acc_ibs0.vw = vecw_setzero();
-    acc_hethet.vw = vecw_setzero();
-    acc_het2hom1.vw = vecw_setzero();
-    acc_het1hom2.vw = vecw_setzero();
-    for (uint32_t vec_idx = 0; vec_idx < kKingMultiplexVecs; vec_idx += 3) {
-      VecW hom1 = first_hom[vec_idx];
-      VecW hom2 = second_hom[vec_idx];
-      VecW ref2het1 = first_ref2het[vec_idx];
-      VecW ref2het2 = second_ref2het[vec_idx];
-      VecW agg_homhom = hom1 & hom2;
-      VecW het1 = vecw_and_notfirst(hom1, ref2het1);
-      VecW het2 = vecw_and_notfirst(hom2, ref2het2);
-      VecW agg_ibs0 = (ref2het1 ^ ref2het2) & agg_homhom;
-      VecW agg_hethet = het1 & het2;
-      VecW agg_het2hom1 = hom1 & het2;
-      VecW agg_het1hom2 = hom2 & het1;
-      agg_homhom = agg_homhom - (vecw_srli(agg_homhom, 1) & m1);
-      agg_ibs0 = agg_ibs0 - (vecw_srli(agg_ibs0, 1) & m1);
-      agg_hethet = agg_hethet - (vecw_srli(agg_hethet, 1) & m1);
-      agg_het2hom1 = agg_het2hom1 - (vecw_srli(agg_het2hom1, 1) & m1);
-      agg_het1hom2 = agg_het1hom2 - (vecw_srli(agg_het1hom2, 1) & m1);
-      agg_homhom = (agg_homhom & m2) + (vecw_srli(agg_homhom, 2) & m2);
-      agg_ibs0 = (agg_ibs0 & m2) + (vecw_srli(agg_ibs0, 2) & m2);
-      agg_hethet = (agg_hethet & m2) + (vecw_srli(agg_hethet, 2) & m2);
-      agg_het2hom1 = (agg_het2hom1 & m2) + (vecw_srli(agg_het2hom1, 2) & m2);
-      agg_het1hom2 = (agg_het1hom2 & m2) + (vecw_srli(agg_het1hom2, 2) & m2);
-
-      for (uint32_t offset = 1; offset != 3; ++offset) {
-        hom1 = first_hom[vec_idx + offset];
-        hom2 = second_hom[vec_idx + offset];
-        ref2het1 = first_ref2het[vec_idx + offset];
-        ref2het2 = second_ref2het[vec_idx + offset];
-        VecW cur_homhom = hom1 & hom2;
-        het1 = vecw_and_notfirst(hom1, ref2het1);
-        het2 = vecw_and_notfirst(hom2, ref2het2);
-        VecW cur_ibs0 = (ref2het1 ^ ref2het2) & cur_homhom;
-        VecW cur_hethet = het1 & het2;
-        VecW cur_het2hom1 = hom1 & het2;
-        VecW cur_het1hom2 = hom2 & het1;
-        cur_homhom = cur_homhom - (vecw_srli(cur_homhom, 1) & m1);
-        cur_ibs0 = cur_ibs0 - (vecw_srli(cur_ibs0, 1) & m1);
-        cur_hethet = cur_hethet - (vecw_srli(cur_hethet, 1) & m1);
-        cur_het2hom1 = cur_het2hom1 - (vecw_srli(cur_het2hom1, 1) & m1);
-        cur_het1hom2 = cur_het1hom2 - (vecw_srli(cur_het1hom2, 1) & m1);
-        agg_homhom += (cur_homhom & m2) + (vecw_srli(cur_homhom, 2) & m2);
-        agg_ibs0 += (cur_ibs0 & m2) + (vecw_srli(cur_ibs0, 2) & m2);
-        agg_hethet += (cur_hethet & m2) + (vecw_srli(cur_hethet, 2) & m2);
-        agg_het2hom1 += (cur_het2hom1 & m2) + (vecw_srli(cur_het2hom1, 2) & m2);
-        agg_het1hom2 += (cur_het1hom2 & m2) + (vecw_srli(cur_het1hom2, 2) & m2);
-      }
-      acc_homhom.vw = acc_homhom.vw + (agg_homhom & m4) + (vecw_srli(agg_homhom, 4) & m4);
-      acc_ibs0.vw = acc_ibs0.vw + (agg_ibs0 & m4) + (vecw_srli(agg_ibs0, 4) & m4);
-      acc_hethet.vw = acc_hethet.vw + (agg_hethet & m4) + (vecw_srli(agg_hethet, 4) & m4);
-      acc_het2hom1.vw = acc_het2hom1.vw + (agg_het2hom1 & m4) + (vecw_srli(agg_het2hom1, 4) & m4);
-      acc_het1hom2.vw = acc_het1hom2.vw + (agg_het1hom2 & m4) + (vecw_srli(agg_het1hom2, 4) & m4);
-    }
-    const VecW m8 = VCONST_W(kMask00FF);
-    acc_homhom.vw = (acc_homhom.vw & m8) + (vecw_srli(acc_homhom.vw, 8) & m8);
-    acc_ibs0.vw = (acc_ibs0.vw & m8) + (vecw_srli(acc_ibs0.vw, 8) & m8);
-    acc_hethet.vw = (acc_hethet.vw & m8) + (vecw_srli(acc_hethet.vw, 8) & m8);
-    acc_het2hom1.vw = (acc_het2hom1.vw & m8) + (vecw_srli(acc_het2hom1.vw, 8) & m8);
-    acc_het1hom2.vw = (acc_het1hom2.vw & m8) + (vecw_srli(acc_het1hom2.vw, 8) & m8);
-    *king_counts_iter++ += UniVecHsum16(acc_ibs0);
-    *king_counts_iter++ += UniVecHsum16(acc_hethet);
-    *king_counts_iter++ += UniVecHsum16(acc_het2hom1);
-    *king_counts_iter++ += UniVecHsum16(acc_het1hom2);
-    *king_counts_iter++ += UniVecHsum16(acc_homhom);
-  }
-}
-#endif
-
 typedef struct CalcKingTableSubsetCtxStruct {
   uintptr_t* smaj_hom[2];
   uintptr_t* smaj_ref2het[2];
@@ -2424,9 +2445,9 @@ THREAD_FUNC_DECL CalcKingTableSubsetThread(void* raw_arg) {
   uint32_t parity = 0;
   do {
     if (homhom_needed) {
-      IncrKingSubsetHomhom(ctx->loaded_sample_idx_pairs, ctx->smaj_hom[parity], ctx->smaj_ref2het[parity], start_idx, end_idx, ctx->king_counts);
+      g_simd_kernels.incr_king_subset_homhom(ctx->loaded_sample_idx_pairs, ctx->smaj_hom[parity], ctx->smaj_ref2het[parity], start_idx, end_idx, ctx->king_counts);
     } else {
-      IncrKingSubset(ctx->loaded_sample_idx_pairs, ctx->smaj_hom[parity], ctx->smaj_ref2het[parity], start_idx, end_idx, ctx->king_counts);
+      g_simd_kernels.incr_king_subset(ctx->loaded_sample_idx_pairs, ctx->smaj_hom[parity], ctx->smaj_ref2het[parity], start_idx, end_idx, ctx->king_counts);
     }
     parity = 1 - parity;
   } while (!THREAD_BLOCK_FINISH(arg));
@@ -2639,8 +2660,187 @@ void GetRelCheckPairs(const char* nsorted_xidbox, const uint32_t* xid_map, uintp
   fpip->idx2 = idx2;
 }
 
-PglErr CalcKingTableSubset(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, const uintptr_t* variant_include, const ChrInfo* cip, const char* subset_fname, uint32_t raw_sample_ct, uint32_t orig_sample_ct, uint32_t raw_variant_ct, uint32_t variant_ct, double king_table_filter, double king_table_subset_thresh, uint32_t rel_check, KingFlags king_flags, uint32_t parallel_idx, uint32_t parallel_tot, uint32_t max_thread_ct, PgenReader* simple_pgrp, char* outname, char* outname_end) {
-  // subset_fname permitted to be nullptr when rel_check is true.
+// --king-table-prefilter screen.  Relatives share far more rare alleles than
+// unrelated pairs do, so we decode a small evenly-spaced sample of variants,
+// and for each one with at most max_carrier_ct minor-allele carriers, count
+// the carrier pairs.  Pairs with at least min_shared_ct shared rare alleles
+// are returned in candidate_pairs (larger sample_uidx in the high 32 bits,
+// sorted), and get the exact KING-robust computation afterward.
+// Allocates candidate_pairs at the bottom of bigstack; everything else is
+// temporary.
+PglErr KingPrefilterCandidates(const uintptr_t* orig_sample_include, const uint32_t* sample_include_cumulative_popcounts, const uintptr_t* variant_include, uint32_t orig_sample_ct, uint32_t variant_ct, uint32_t scan_variant_ct, uint32_t max_carrier_ct, uint32_t min_shared_ct, PgenReader* simple_pgrp, uintptr_t* genovec, uint64_t** candidate_pairs_ptr, uintptr_t* candidate_ct_ptr) {
+  unsigned char* bigstack_end_mark = g_bigstack_end;
+  PglErr reterr = kPglRetSuccess;
+  {
+    uint32_t* sample_idx_to_uidx;
+    uint32_t* carrier_idxs;
+    if (unlikely(
+            bigstack_end_alloc_u32(orig_sample_ct, &sample_idx_to_uidx) ||
+            bigstack_end_alloc_u32(max_carrier_ct, &carrier_idxs))) {
+      goto KingPrefilterCandidates_ret_NOMEM;
+    }
+    uintptr_t sample_uidx_base = 0;
+    uintptr_t cur_bits = orig_sample_include[0];
+    for (uint32_t sample_idx = 0; sample_idx != orig_sample_ct; ++sample_idx) {
+      sample_idx_to_uidx[sample_idx] = BitIter1(orig_sample_include, &sample_uidx_base, &cur_bits);
+    }
+    // Open-addressing table of (pair, shared-ct), at most half full.  Final
+    // candidate list takes at most 8 bytes per occupied slot, so it's safe to
+    // give the table half of the remaining workspace.
+    uintptr_t htable_size = (bigstack_left() / 2) / (sizeof(int64_t) + sizeof(int32_t));
+    if (htable_size > 0x7fffffff) {
+      htable_size = 0x7fffffff;
+    }
+    if (unlikely(htable_size < 2 * kCacheline)) {
+      goto KingPrefilterCandidates_ret_NOMEM;
+    }
+    uint64_t* htable_keys;
+    uint32_t* htable_cts;
+    if (unlikely(
+            bigstack_end_alloc_u64(htable_size, &htable_keys) ||
+            bigstack_end_alloc_u32(htable_size, &htable_cts))) {
+      goto KingPrefilterCandidates_ret_NOMEM;
+    }
+    SetAllU64Arr(htable_size, htable_keys);
+    const uintptr_t htable_entry_limit = htable_size / 2;
+    uintptr_t htable_entry_ct = 0;
+
+    if (scan_variant_ct > variant_ct) {
+      scan_variant_ct = variant_ct;
+    }
+    const uint32_t sample_ctl2 = NypCtToWordCt(orig_sample_ct);
+    PgrSampleSubsetIndex pssi;
+    PgrSetSampleSubsetIndex(sample_include_cumulative_popcounts, simple_pgrp, &pssi);
+    uint32_t rare_variant_ct = 0;
+    uint32_t variant_uidx = 0;
+    uint32_t prev_variant_idx = 0;
+    uint32_t scan_idx = 0;
+    for (; scan_idx != scan_variant_ct; ++scan_idx) {
+      // Spread the scan evenly across the genome, so that we aren't at the
+      // mercy of IBD-sharing variance on a single chromosome.
+      const uint32_t variant_idx = (S_CAST(uint64_t, scan_idx) * variant_ct) / scan_variant_ct;
+      if (!scan_idx) {
+        variant_uidx = AdvTo1Bit(variant_include, 0);
+      } else if (variant_idx != prev_variant_idx) {
+        variant_uidx = FindNth1BitFrom(variant_include, variant_uidx + 1, variant_idx - prev_variant_idx);
+      }
+      prev_variant_idx = variant_idx;
+      reterr = PgrGet(orig_sample_include, pssi, orig_sample_ct, variant_uidx, simple_pgrp, genovec);
+      if (unlikely(reterr)) {
+        PgenErrPrintN(reterr);
+        goto KingPrefilterCandidates_ret_1;
+      }
+      STD_ARRAY_DECL(uint32_t, 4, genocounts);
+      ZeroTrailingNyps(orig_sample_ct, genovec);
+      GenoarrCountFreqsUnsafe(genovec, orig_sample_ct, genocounts);
+      const uint32_t alt_carrier_ct = genocounts[1] + genocounts[2];
+      const uint32_t ref_carrier_ct = genocounts[0] + genocounts[1];
+      const uint32_t alt_is_minor = (alt_carrier_ct <= ref_carrier_ct);
+      const uint32_t carrier_ct = alt_is_minor? alt_carrier_ct : ref_carrier_ct;
+      if ((carrier_ct < 2) || (carrier_ct > max_carrier_ct)) {
+        continue;
+      }
+      const uintptr_t cur_pair_ct = (S_CAST(uint64_t, carrier_ct) * (carrier_ct - 1)) / 2;
+      if (htable_entry_ct + cur_pair_ct > htable_entry_limit) {
+        logerrprintf("Warning: --king-table-prefilter workspace filled up after %u/%u scanned\nvariants.\n", scan_idx, scan_variant_ct);
+        break;
+      }
+      ++rare_variant_ct;
+      // trailing nyps must be missing here so they're never treated as carriers
+      SetTrailingNyps(orig_sample_ct, genovec);
+      uint32_t* carrier_idxs_iter = carrier_idxs;
+      for (uint32_t widx = 0; widx != sample_ctl2; ++widx) {
+        const uintptr_t geno_word = genovec[widx];
+        // alt carrier: genotype 1 or 2; ref carrier: genotype 0 or 1
+        uintptr_t carrier_word = alt_is_minor? ((geno_word ^ (geno_word >> 1)) & kMask5555) : ((~geno_word) >> 1) & kMask5555;
+        if (carrier_word) {
+          const uint32_t offset_base = widx * kBitsPerWordD2;
+          do {
+            *carrier_idxs_iter++ = offset_base + ctzw(carrier_word) / 2;
+            carrier_word &= carrier_word - 1;
+          } while (carrier_word);
+        }
+      }
+      for (uint32_t carrier_idx_hi = 1; carrier_idx_hi != carrier_ct; ++carrier_idx_hi) {
+        const uint64_t key_hi = S_CAST(uint64_t, sample_idx_to_uidx[carrier_idxs[carrier_idx_hi]]) << 32;
+        for (uint32_t carrier_idx_lo = 0; carrier_idx_lo != carrier_idx_hi; ++carrier_idx_lo) {
+          const uint64_t key = key_hi | sample_idx_to_uidx[carrier_idxs[carrier_idx_lo]];
+          for (uintptr_t hashval = Hashceil(R_CAST(const char*, &key), sizeof(int64_t), htable_size); ; ) {
+            const uint64_t cur_key = htable_keys[hashval];
+            if (cur_key == key) {
+              htable_cts[hashval] += 1;
+              break;
+            }
+            if (cur_key == ~0LLU) {
+              htable_keys[hashval] = key;
+              htable_cts[hashval] = 1;
+              ++htable_entry_ct;
+              break;
+            }
+            if (++hashval == htable_size) {
+              hashval = 0;
+            }
+          }
+        }
+      }
+    }
+    logprintf("--king-table-prefilter: %u/%u scanned variant%s had 2..%u minor allele carriers.\n", rare_variant_ct, scan_idx, (scan_idx == 1)? "" : "s", max_carrier_ct);
+    if (unlikely(!rare_variant_ct)) {
+      logerrputs("Error: No sufficiently rare variants for --king-table-prefilter.  (Try raising\nthe carrier-count limit, or the number of variants to scan.)\n");
+      goto KingPrefilterCandidates_ret_DEGENERATE_DATA;
+    }
+    uintptr_t candidate_ct = 0;
+    for (uintptr_t hashval = 0; hashval != htable_size; ++hashval) {
+      candidate_ct += (htable_keys[hashval] != ~0LLU) && (htable_cts[hashval] >= min_shared_ct);
+    }
+    uint64_t* candidate_pairs;
+    if (unlikely(bigstack_alloc_u64(candidate_ct, &candidate_pairs))) {
+      goto KingPrefilterCandidates_ret_NOMEM;
+    }
+    uint64_t* candidate_pairs_iter = candidate_pairs;
+    for (uintptr_t hashval = 0; hashval != htable_size; ++hashval) {
+      if ((htable_keys[hashval] != ~0LLU) && (htable_cts[hashval] >= min_shared_ct)) {
+        *candidate_pairs_iter++ = htable_keys[hashval];
+      }
+    }
+    // Hash table order depends on table size, which depends on --memory.
+    // Sort so results are reproducible (and --parallel works).
+    STD_SORT(candidate_ct, u64cmp, candidate_pairs);
+    logprintf("--king-table-prefilter: %" PRIuPTR " candidate pair%s (of %" PRIuPTR " with any shared rare allele).\n", candidate_ct, (candidate_ct == 1)? "" : "s", htable_entry_ct);
+    *candidate_pairs_ptr = candidate_pairs;
+    *candidate_ct_ptr = candidate_ct;
+  }
+  while (0) {
+  KingPrefilterCandidates_ret_NOMEM:
+    reterr = kPglRetNomem;
+    break;
+  KingPrefilterCandidates_ret_DEGENERATE_DATA:
+    reterr = kPglRetDegenerateData;
+    break;
+  }
+ KingPrefilterCandidates_ret_1:
+  BigstackEndReset(bigstack_end_mark);
+  return reterr;
+}
+
+void GetKingPrefilterPairs(const uint64_t* candidate_pairs, uint64_t candidate_ct, uint32_t is_first_parallel_scan, uint64_t pair_idx_start, uint64_t pair_idx_stop, uint64_t* pair_idx_ptr, uint32_t* loaded_sample_idx_pairs) {
+  uint64_t pair_idx = MAXV(*pair_idx_ptr, pair_idx_start);
+  const uint64_t pair_idx_end = MINV(pair_idx_stop, candidate_ct);
+  uint32_t* loaded_sample_idx_pairs_iter = loaded_sample_idx_pairs;
+  for (; pair_idx < pair_idx_end; ++pair_idx) {
+    const uint64_t cur_pair = candidate_pairs[pair_idx];
+    *loaded_sample_idx_pairs_iter++ = cur_pair >> 32;
+    *loaded_sample_idx_pairs_iter++ = S_CAST(uint32_t, cur_pair);
+  }
+  if (is_first_parallel_scan) {
+    pair_idx = candidate_ct;
+  }
+  *pair_idx_ptr = pair_idx;
+}
+
+PglErr CalcKingTableSubset(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, const uintptr_t* variant_include, const ChrInfo* cip, const char* subset_fname, uint32_t raw_sample_ct, uint32_t orig_sample_ct, uint32_t raw_variant_ct, uint32_t variant_ct, double king_table_filter, double king_table_subset_thresh, uint32_t rel_check, uint32_t prefilter_variant_ct, uint32_t prefilter_max_carrier_ct, uint32_t prefilter_min_shared_ct, KingFlags king_flags, uint32_t parallel_idx, uint32_t parallel_tot, uint32_t max_thread_ct, PgenReader* simple_pgrp, char* outname, char* outname_end) {
+  // subset_fname permitted to be nullptr when rel_check is true, or when
+  // prefilter_variant_ct is nonzero.
   unsigned char* bigstack_mark = g_bigstack_base;
   FILE* outfile = nullptr;
   char* cswritep = nullptr;
@@ -2775,82 +2975,12 @@ PglErr CalcKingTableSubset(const uintptr_t* orig_sample_include, const SampleIdI
         goto CalcKingTableSubset_ret_TSTREAM_FAIL;
       }
       ++line_idx;
-      const char* linebuf_iter = TextGet(&txs);
-      if (unlikely(!linebuf_iter)) {
-        if (!TextStreamErrcode2(&txs, &reterr)) {
-          logerrputs("Error: Empty --king-table-subset file.\n");
-          goto CalcKingTableSubset_ret_MALFORMED_INPUT;
-        }
-        goto CalcKingTableSubset_ret_TSTREAM_FAIL;
-      }
-      const char* token_end = CurTokenEnd(linebuf_iter);
-      uint32_t token_slen = token_end - linebuf_iter;
-      // Make this work with both KING- and plink2-generated .kin0 files.
-      uint32_t fid_present = strequal_k(linebuf_iter, "#FID1", token_slen) || strequal_k(linebuf_iter, "FID", token_slen);
-      if (fid_present) {
-        linebuf_iter = FirstNonTspace(token_end);
-        token_end = CurTokenEnd(linebuf_iter);
-        token_slen = token_end - linebuf_iter;
-        xid_mode = kfXidModeFidIid;
-      } else {
-        if (unlikely(*linebuf_iter != '#')) {
-          goto CalcKingTableSubset_ret_INVALID_HEADER;
-        }
-        ++linebuf_iter;
-        --token_slen;
-        xid_mode = kfXidModeIid;
-      }
-      if (unlikely((!strequal_k(linebuf_iter, "ID1", token_slen)) && (!strequal_k(linebuf_iter, "IID1", token_slen)))) {
-        goto CalcKingTableSubset_ret_INVALID_HEADER;
-      }
-      linebuf_iter = FirstNonTspace(token_end);
-      token_end = CurTokenEnd(linebuf_iter);
-      token_slen = token_end - linebuf_iter;
-      if (strequal_k(linebuf_iter, "SID1", token_slen)) {
-        if (siip->sids) {
-          xid_mode = fid_present? kfXidModeFidIidSid : kfXidModeIidSid;
-        } else {
-          skip_sid = 1;
-        }
-        linebuf_iter = FirstNonTspace(token_end);
-        token_end = CurTokenEnd(linebuf_iter);
-        token_slen = token_end - linebuf_iter;
-      }
-      if (fid_present) {
-        if (unlikely(!strequal_k(linebuf_iter, "FID2", token_slen))) {
-          goto CalcKingTableSubset_ret_INVALID_HEADER;
-        }
-        linebuf_iter = FirstNonTspace(token_end);
-        token_end = CurTokenEnd(linebuf_iter);
-        token_slen = token_end - linebuf_iter;
-      }
-      if (unlikely((!strequal_k(linebuf_iter, "ID2", token_slen)) && (!strequal_k(linebuf_iter, "IID2", token_slen)))) {
-        goto CalcKingTableSubset_ret_INVALID_HEADER;
-      }
-      if (xid_mode == kfXidModeFidIidSid) {
-        // technically don't need to check this in skip_sid case
-        linebuf_iter = FirstNonTspace(token_end);
-        token_end = CurTokenEnd(linebuf_iter);
-        token_slen = token_end - linebuf_iter;
-        if (unlikely(!strequal_k(linebuf_iter, "SID2", token_slen))) {
-          goto CalcKingTableSubset_ret_INVALID_HEADER;
-        }
+      reterr = Kin0HeaderParse(siip, "--king-table-subset file", &txs, &xid_mode, &skip_sid, (king_table_subset_thresh != -DBL_MAX)? (&kinship_skip) : nullptr);
+      if (unlikely(reterr)) {
+        goto CalcKingTableSubset_ret_1;
       }
       if (king_table_subset_thresh != -DBL_MAX) {
         king_table_subset_thresh *= 1.0 - kSmallEpsilon;
-        while (1) {
-          linebuf_iter = FirstNonTspace(token_end);
-          token_end = CurTokenEnd(linebuf_iter);
-          token_slen = token_end - linebuf_iter;
-          if (unlikely(!token_slen)) {
-            logerrputs("Error: No kinship-coefficient column in --king-table-subset file.\n");
-            goto CalcKingTableSubset_ret_INCONSISTENT_INPUT;
-          }
-          if (strequal_k(linebuf_iter, "KINSHIP", token_slen) || strequal_k(linebuf_iter, "Kinship", token_slen)) {
-            break;
-          }
-          ++kinship_skip;
-        }
       }
     }
 
@@ -2867,6 +2997,16 @@ PglErr CalcKingTableSubset(const uintptr_t* orig_sample_include, const SampleIdI
       goto CalcKingTableSubset_ret_NOMEM;
     }
 
+    uint64_t* prefilter_pairs = nullptr;
+    uintptr_t prefilter_pair_ct = 0;
+    if (prefilter_variant_ct) {
+      FillCumulativePopcounts(orig_sample_include, raw_sample_ctl, sample_include_cumulative_popcounts);
+      reterr = KingPrefilterCandidates(orig_sample_include, sample_include_cumulative_popcounts, variant_include, orig_sample_ct, variant_ct, prefilter_variant_ct, prefilter_max_carrier_ct, prefilter_min_shared_ct, simple_pgrp, loadbuf, &prefilter_pairs, &prefilter_pair_ct);
+      if (unlikely(reterr)) {
+        goto CalcKingTableSubset_ret_1;
+      }
+    }
+
     ctx.homhom_needed = (king_flags & kfKingColNsnp) || ((!(king_flags & kfKingCounts)) && (king_flags & (kfKingColHethet | kfKingColIbs0 | kfKingColIbs1)));
     const uint32_t homhom_needed_p4 = ctx.homhom_needed + 4;
     // if homhom_needed, 8 + 20 bytes per pair, otherwise 8 + 16
@@ -2888,7 +3028,9 @@ PglErr CalcKingTableSubset(const uintptr_t* orig_sample_include, const SampleIdI
     InitFidPairIterator(&fpi);
 
     uint64_t pair_idx = 0;
-    if (!subset_fname) {
+    if (prefilter_pairs) {
+      GetKingPrefilterPairs(prefilter_pairs, prefilter_pair_ct, (parallel_tot != 1), 0, pair_buf_capacity, &pair_idx, ctx.loaded_sample_idx_pairs);
+    } else if (!subset_fname) {
       GetRelCheckPairs(sorted_xidbox, xid_map, max_xid_blen, orig_sample_ct, (parallel_tot != 1), 0, pair_buf_capacity, &fpi, &pair_idx, ctx.loaded_sample_idx_pairs, idbuf);
     } else {
       fputs("Scanning --king-table-subset file...", stdout);
@@ -2919,7 +3061,9 @@ PglErr CalcKingTableSubset(const uintptr_t* orig_sample_include, const SampleIdI
         if (pair_idx_global_stop > pair_buf_capacity) {
           // large --parallel job
           pair_idx = 0;
-          if (!subset_fname) {
+          if (prefilter_pairs) {
+            GetKingPrefilterPairs(prefilter_pairs, prefilter_pair_ct, 0, pair_idx_global_start, MINV(pair_idx_global_stop, pair_idx_global_start + pair_buf_capacity), &pair_idx, ctx.loaded_sample_idx_pairs);
+          } else if (!subset_fname) {
             InitFidPairIterator(&fpi);
             GetRelCheckPairs(sorted_xidbox, xid_map, max_xid_blen, orig_sample_ct, 0, pair_idx_global_start, MINV(pair_idx_global_stop, pair_idx_global_start + pair_buf_capacity), &fpi, &pair_idx, ctx.loaded_sample_idx_pairs, idbuf);
           } else {
@@ -3160,12 +3304,14 @@ PglErr CalcKingTableSubset(const uintptr_t* orig_sample_include, const SampleIdI
       putc_unlocked('\r', stdout);
       const uint64_t pair_complete_ct = pair_idx - pair_idx_global_start;
       logprintf("Subsetted --make-king-table: %" PRIu64 " pair%s complete.\n", pair_complete_ct, (pair_complete_ct == 1)? "" : "s");
-      if (TextEof(&txs) || (pair_idx == pair_idx_global_stop)) {
+      if ((subset_fname && TextEof(&txs)) || (pair_idx == pair_idx_global_stop) || (prefilter_pairs && (pair_idx == prefilter_pair_ct))) {
         break;
       }
       pair_idx_cur_start = pair_idx;
-      if (!subset_fname) {
-        GetRelCheckPairs(sorted_xidbox, xid_map, max_xid_blen, orig_sample_ct, 0, pair_idx_global_start, MINV(pair_idx_global_stop, pair_idx_global_start + pair_buf_capacity), &fpi, &pair_idx, ctx.loaded_sample_idx_pairs, idbuf);
+      if (prefilter_pairs) {
+        GetKingPrefilterPairs(prefilter_pairs, prefilter_pair_ct, 0, pair_idx_cur_start, MINV(pair_idx_global_stop, pair_idx_cur_start + pair_buf_capacity), &pair_idx, ctx.loaded_sample_idx_pairs);
+      } else if (!subset_fname) {
+        GetRelCheckPairs(sorted_xidbox, xid_map, max_xid_blen, orig_sample_ct, 0, pair_idx_cur_start, MINV(pair_idx_global_stop, pair_idx_cur_start + pair_buf_capacity), &fpi, &pair_idx, ctx.loaded_sample_idx_pairs, idbuf);
       } else {
         fputs("Scanning --king-table-subset file...", stdout);
         fflush(stdout);
@@ -3204,8 +3350,6 @@ PglErr CalcKingTableSubset(const uintptr_t* orig_sample_include, const SampleIdI
   CalcKingTableSubset_ret_WRITE_FAIL:
     reterr = kPglRetWriteFail;
     break;
-  CalcKingTableSubset_ret_INVALID_HEADER:
-    logerrputs("Error: Invalid header line in --king-table-subset file.\n");
   CalcKingTableSubset_ret_MALFORMED_INPUT:
     reterr = kPglRetMalformedInput;
     break;
@@ -3277,7 +3421,9 @@ PglErr ExpandCenteredVarmaj(const uintptr_t* genovec, const uintptr_t* dosage_pr
 
 // This breaks the "don't pass pssi between functions" rule since it's a thin
 // wrapper around PgrGetInv1D().
-PglErr LoadBiallelicCenteredVarmaj(const uintptr_t* sample_include, PgrSampleSubsetIndex pssi, uint32_t variance_standardize, uint32_t is_haploid, uint32_t sample_ct, uint32_t variant_uidx, double ref_freq, PgenReader* simple_pgrp, uint32_t* missing_presentp, double* normed_dosages, uintptr_t* genovec_buf, uintptr_t* dosage_present_buf, Dosage* dosage_main_buf) {
+// If missing_presentp is non-null, *missing_presentp is set iff any sample's
+// genotype/dosage is missing, and in that case missingness[] is filled.
+PglErr LoadBiallelicCenteredVarmaj(const uintptr_t* sample_include, PgrSampleSubsetIndex pssi, uint32_t variance_standardize, uint32_t is_haploid, uint32_t sample_ct, uint32_t variant_uidx, double ref_freq, PgenReader* simple_pgrp, uint32_t* missing_presentp, uintptr_t* missingness, double* normed_dosages, uintptr_t* genovec_buf, uintptr_t* dosage_present_buf, Dosage* dosage_main_buf) {
   uint32_t dosage_ct;
   PglErr reterr = PgrGetD(sample_include, pssi, sample_ct, variant_uidx, simple_pgrp, genovec_buf, dosage_present_buf, dosage_main_buf, &dosage_ct);
   if (unlikely(reterr)) {
@@ -3310,6 +3456,12 @@ PglErr LoadBiallelicCenteredVarmaj(const uintptr_t* sample_include, PgrSampleSub
         }
       }
     }
+    if (*missing_presentp) {
+      GenoarrToMissingnessUnsafe(genovec_buf, sample_ct, missingness);
+      if (dosage_ct) {
+        BitvecInvmask(dosage_present_buf, BitCtToWordCt(sample_ct), missingness);
+      }
+    }
   }
   return ExpandCenteredVarmaj(genovec_buf, dosage_present_buf, dosage_main_buf, variance_standardize, is_haploid, sample_ct, dosage_ct, ref_freq, normed_dosages);
 }
@@ -3372,7 +3524,7 @@ BoolErr CheckMultiallelicDegenVariance(const PgenVariant* pgvp, const double* cu
   return !AllBytesAreX(pgvp->patch_10_vals, mono_allele_idx, 2 * nm_sample_ct);
 }
 
-PglErr LoadMultiallelicCenteredVarmaj(const uintptr_t* sample_include, PgrSampleSubsetIndex pssi, const double* cur_allele_freqs, uint32_t variance_standardize, uint32_t is_haploid, uint32_t sample_ct, uint32_t variant_uidx, uint32_t cur_allele_ct, uint32_t allele_idx_start, uint32_t allele_idx_end, PgenReader* simple_pgrp, uint32_t* missing_presentp, double* normed_dosages, PgenVariant* pgvp, double* allele_1copy_buf) {
+PglErr LoadMultiallelicCenteredVarmaj(const uintptr_t* sample_include, PgrSampleSubsetIndex pssi, const double* cur_allele_freqs, uint32_t variance_standardize, uint32_t is_haploid, uint32_t sample_ct, uint32_t variant_uidx, uint32_t cur_allele_ct, uint32_t allele_idx_start, uint32_t allele_idx_end, PgenReader* simple_pgrp, uint32_t* missing_presentp, uintptr_t* missingness, double* normed_dosages, PgenVariant* pgvp, double* allele_1copy_buf) {
   // This handles cur_allele_ct == 2 correctly.  But we typically don't use it
   // in that case since it does ~2x as much work as necessary: the two
   // normed_dosages[] rows are identical except for opposite sign, so it's best
@@ -3406,6 +3558,12 @@ PglErr LoadMultiallelicCenteredVarmaj(const uintptr_t* sample_include, PgrSample
         }
       }
     }
+    if (*missing_presentp) {
+      GenoarrToMissingnessUnsafe(genovec_buf, sample_ct, missingness);
+      if (pgvp->dosage_ct) {
+        BitvecInvmask(pgvp->dosage_present, BitCtToWordCt(sample_ct), missingness);
+      }
+    }
   }
   const uint32_t cur_allele_ct_m1 = cur_allele_ct - 1;
   double freq_sum = cur_allele_freqs[0];
@@ -3582,18 +3740,23 @@ PglErr LoadMultiallelicCenteredVarmaj(const uintptr_t* sample_include, PgrSample
   return kPglRetSuccess;
 }
 
-PglErr LoadCenteredVarmajBlock(const uintptr_t* sample_include, PgrSampleSubsetIndex pssi, const uintptr_t* variant_include, const uintptr_t* allele_idx_offsets, const double* allele_freqs, uint32_t variance_standardize, uint32_t is_haploid, uint32_t sample_ct, uint32_t variant_ct, PgenReader* simple_pgrp, double* normed_vmaj_iter, uintptr_t* variant_include_has_missing, uint32_t* cur_batch_sizep, uint32_t* variant_idxp, uintptr_t* variant_uidxp, uintptr_t* allele_idx_basep, uint32_t* cur_allele_ctp, uint32_t* incomplete_allele_idxp, PgenVariant* pgvp, double* allele_1copy_buf) {
+PglErr LoadCenteredVarmajBlock(const uintptr_t* sample_include, PgrSampleSubsetIndex pssi, const uintptr_t* variant_include, const uintptr_t* allele_idx_offsets, const double* allele_freqs, uint32_t variance_standardize, uint32_t is_haploid, uint32_t sample_ct, uint32_t variant_ct, PgenReader* simple_pgrp, double* normed_vmaj_iter, uintptr_t* missing_vmaj_iter, uint32_t* missing_variant_ctp, uint32_t* cur_batch_sizep, uint32_t* variant_idxp, uintptr_t* variant_uidxp, uintptr_t* allele_idx_basep, uint32_t* cur_allele_ctp, uint32_t* incomplete_allele_idxp, PgenVariant* pgvp, double* allele_1copy_buf) {
   const uint32_t std_batch_size = *cur_batch_sizep;
   uint32_t variant_idx = *variant_idxp;
   uintptr_t variant_uidx = *variant_uidxp;
   uintptr_t allele_idx_base = *allele_idx_basep;
   uint32_t cur_allele_ct = *cur_allele_ctp;
   uint32_t incomplete_allele_idx = *incomplete_allele_idxp;
+  const uintptr_t sample_ctaw = BitCtToAlignedWordCt(sample_ct);
+  uint32_t missing_variant_ct = 0;
   uintptr_t variant_uidx_base;
   uintptr_t cur_bits;
   BitIter1Start(variant_include, variant_uidx + (incomplete_allele_idx != 0), &variant_uidx_base, &cur_bits);
   for (uint32_t allele_bidx = 0; allele_bidx != std_batch_size; ) {
     uint32_t missing_present = 0;
+    // multiallelic variants may be split across blocks; only check
+    // missingness on the first load
+    uint32_t* missing_presentp = (missing_vmaj_iter && (!incomplete_allele_idx))? (&missing_present) : nullptr;
     if (!incomplete_allele_idx) {
       variant_uidx = BitIter1(variant_include, &variant_uidx_base, &cur_bits);
       if (!allele_idx_offsets) {
@@ -3610,14 +3773,14 @@ PglErr LoadCenteredVarmajBlock(const uintptr_t* sample_include, PgrSampleSubsetI
     if (cur_allele_ct == 2) {
       allele_idx_stop = 1;
       allele_idx_end = 1;
-      reterr = LoadBiallelicCenteredVarmaj(sample_include, pssi, variance_standardize, is_haploid, sample_ct, variant_uidx, allele_freqs[allele_idx_base], simple_pgrp, variant_include_has_missing? (&missing_present) : nullptr, normed_vmaj_iter, pgvp->genovec, pgvp->dosage_present, pgvp->dosage_main);
+      reterr = LoadBiallelicCenteredVarmaj(sample_include, pssi, variance_standardize, is_haploid, sample_ct, variant_uidx, allele_freqs[allele_idx_base], simple_pgrp, missing_presentp, missing_vmaj_iter, normed_vmaj_iter, pgvp->genovec, pgvp->dosage_present, pgvp->dosage_main);
     } else {
       allele_idx_end = cur_allele_ct;
       allele_idx_stop = std_batch_size + incomplete_allele_idx - allele_bidx;
       if (allele_idx_stop > allele_idx_end) {
         allele_idx_stop = allele_idx_end;
       }
-      reterr = LoadMultiallelicCenteredVarmaj(sample_include, pssi, &(allele_freqs[allele_idx_base]), variance_standardize, is_haploid, sample_ct, variant_uidx, cur_allele_ct, incomplete_allele_idx, allele_idx_stop, simple_pgrp, variant_include_has_missing? (&missing_present) : nullptr, normed_vmaj_iter, pgvp, allele_1copy_buf);
+      reterr = LoadMultiallelicCenteredVarmaj(sample_include, pssi, &(allele_freqs[allele_idx_base]), variance_standardize, is_haploid, sample_ct, variant_uidx, cur_allele_ct, incomplete_allele_idx, allele_idx_stop, simple_pgrp, missing_presentp, missing_vmaj_iter, normed_vmaj_iter, pgvp, allele_1copy_buf);
     }
     if (unlikely(reterr)) {
       if (reterr == kPglRetDegenerateData) {
@@ -3627,7 +3790,8 @@ PglErr LoadCenteredVarmajBlock(const uintptr_t* sample_include, PgrSampleSubsetI
       return reterr;
     }
     if (missing_present) {
-      SetBit(variant_uidx, variant_include_has_missing);
+      missing_vmaj_iter = &(missing_vmaj_iter[sample_ctaw]);
+      ++missing_variant_ct;
     }
     const uintptr_t incr = allele_idx_stop - incomplete_allele_idx;
     normed_vmaj_iter = &(normed_vmaj_iter[incr * sample_ct]);
@@ -3642,6 +3806,7 @@ PglErr LoadCenteredVarmajBlock(const uintptr_t* sample_include, PgrSampleSubsetI
       incomplete_allele_idx = allele_idx_stop;
     }
   }
+  *missing_variant_ctp = missing_variant_ct;
   *variant_idxp = variant_idx;
   *variant_uidxp = variant_uidx + (incomplete_allele_idx == 0);
   *allele_idx_basep = allele_idx_base;
@@ -3706,13 +3871,27 @@ THREAD_FUNC_DECL CalcGrmPartThread(void* raw_arg) {
   THREAD_RETURN;
 }
 
-CONSTI32(kDblMissingBlockWordCt, 2);
+CONSTI32(kDblMissingBlockWordCt, PLINK2_DBL_MISSING_BLOCK_WORD_CT);
 CONSTI32(kDblMissingBlockSize, kDblMissingBlockWordCt * kBitsPerWord);
 
+// Missingness correction is accumulated in the same pass as the GRM itself.
+// Each GRM variant block appends the missingness bitvectors of its variants
+// with at least one missing call to a variant-major buffer; whenever
+// kDblMissingBlockSize rows have accumulated, they're transposed into a
+// sample-major block for CalcDblMissingThread().  Up to this many blocks can
+// be completed per GRM variant block (the last one may be partial), and
+// missing_vmaj must have room for all of them since the final partial block
+// is zero-padded in place.
+CONSTI32(kDblMissingMaxBlockCt, (kGrmVariantBlockSize + 2 * kDblMissingBlockSize - 2) / kDblMissingBlockSize);
+
 typedef struct CalcDblMissingCtxStruct {
   uint32_t* thread_start;
+  uintptr_t nz_block_word_ct;
+  uintptr_t smaj_block_word_ct;
+
+  uint32_t cur_block_ct;
   // missing_nz bit is set iff that sample has at least one missing entry in
-  // current block
+  // the corresponding block
   uintptr_t* missing_nz[2];
   uintptr_t* missing_smaj[2];
   uint32_t* missing_dbl_exclude_cts;
@@ -3727,210 +3906,74 @@ THREAD_FUNC_DECL CalcDblMissingThread(void* raw_arg) {
   const uint64_t dbl_exclude_offset = (first_thread_row_start_idx * (first_thread_row_start_idx - 1)) / 2;
   const uint32_t row_start_idx = ctx->thread_start[tidx];
   const uintptr_t row_end_idx = ctx->thread_start[tidx + 1];
-  uint32_t* missing_dbl_exclude_cts = ctx->missing_dbl_exclude_cts;
+  const uintptr_t nz_block_word_ct = ctx->nz_block_word_ct;
+  const uintptr_t smaj_block_word_ct = ctx->smaj_block_word_ct;
   uint32_t parity = 0;
   do {
-    const uintptr_t* missing_nz = ctx->missing_nz[parity];
-    const uintptr_t* missing_smaj = ctx->missing_smaj[parity];
-    const uint32_t first_idx = AdvBoundedTo1Bit(missing_nz, 0, row_end_idx);
-    uint32_t sample_idx = first_idx;
-    uint32_t prev_missing_nz_ct = 0;
-    if (sample_idx < row_start_idx) {
-      sample_idx = AdvBoundedTo1Bit(missing_nz, row_start_idx, row_end_idx);
-      if (sample_idx != row_end_idx) {
-        prev_missing_nz_ct = PopcountBitRange(missing_nz, 0, row_start_idx);
-      }
-    }
-    while (sample_idx < row_end_idx) {
-      // todo: compare this explicit unroll with ordinary iteration over a
-      // cur_words[] array
-      // todo: try 1 word at a time, and 30 words at a time
-      const uintptr_t cur_word0 = missing_smaj[sample_idx * kDblMissingBlockWordCt];
-      const uintptr_t cur_word1 = missing_smaj[sample_idx * kDblMissingBlockWordCt + 1];
-#ifndef __LP64__
-      const uintptr_t cur_word2 = missing_smaj[sample_idx * kDblMissingBlockWordCt + 2];
-      const uintptr_t cur_word3 = missing_smaj[sample_idx * kDblMissingBlockWordCt + 3];
-#endif
-      uintptr_t sample_idx2_base;
-      uintptr_t cur_bits;
-      BitIter1Start(missing_nz, first_idx, &sample_idx2_base, &cur_bits);
-      // (sample_idx - 1) underflow ok
-      uint32_t* write_base = &(missing_dbl_exclude_cts[((S_CAST(uint64_t, sample_idx) * (sample_idx - 1)) / 2) - dbl_exclude_offset]);
-      for (uint32_t uii = 0; uii != prev_missing_nz_ct; ++uii) {
-        const uint32_t sample_idx2 = BitIter1(missing_nz, &sample_idx2_base, &cur_bits);
-        const uintptr_t* cur_missing_smaj_base = &(missing_smaj[sample_idx2 * kDblMissingBlockWordCt]);
-        const uintptr_t cur_and0 = cur_word0 & cur_missing_smaj_base[0];
-        const uintptr_t cur_and1 = cur_word1 & cur_missing_smaj_base[1];
-#ifdef __LP64__
-        if (cur_and0 || cur_and1) {
-          write_base[sample_idx2] += Popcount2Words(cur_and0, cur_and1);
-        }
-#else
-        const uintptr_t cur_and2 = cur_word2 & cur_missing_smaj_base[2];
-        const uintptr_t cur_and3 = cur_word3 & cur_missing_smaj_base[3];
-        if (cur_and0 || cur_and1 || cur_and2 || cur_and3) {
-          write_base[sample_idx2] += Popcount4Words(cur_and0, cur_and1, cur_and2, cur_and3);
-        }
-#endif
+    const uint32_t cur_block_ct = ctx->cur_block_ct;
+    uint32_t* missing_dbl_exclude_cts = ctx->missing_dbl_exclude_cts;
+    for (uint32_t block_idx = 0; block_idx != cur_block_ct; ++block_idx) {
+      const uintptr_t* missing_nz = &(ctx->missing_nz[parity][block_idx * nz_block_word_ct]);
+      const uintptr_t* missing_smaj = &(ctx->missing_smaj[parity][block_idx * smaj_block_word_ct]);
+      const uint32_t first_idx = AdvBoundedTo1Bit(missing_nz, 0, row_end_idx);
+      uint32_t sample_idx = first_idx;
+      uint32_t prev_missing_nz_ct = 0;
+      if (sample_idx < row_start_idx) {
+        sample_idx = AdvBoundedTo1Bit(missing_nz, row_start_idx, row_end_idx);
+        if (sample_idx != row_end_idx) {
+          prev_missing_nz_ct = PopcountBitRange(missing_nz, 0, row_start_idx);
+        }
+      }
+      while (sample_idx < row_end_idx) {
+        // (sample_idx - 1) underflow ok
+        uint32_t* write_base = &(missing_dbl_exclude_cts[((S_CAST(uint64_t, sample_idx) * (sample_idx - 1)) / 2) - dbl_exclude_offset]);
+        g_simd_kernels.incr_dbl_missing(missing_nz, missing_smaj, first_idx, sample_idx, prev_missing_nz_ct, write_base);
+        ++prev_missing_nz_ct;
+        sample_idx = AdvBoundedTo1Bit(missing_nz, sample_idx + 1, row_end_idx);
       }
-      ++prev_missing_nz_ct;
-      sample_idx = AdvBoundedTo1Bit(missing_nz, sample_idx + 1, row_end_idx);
     }
     parity = 1 - parity;
   } while (!THREAD_BLOCK_FINISH(arg));
   THREAD_RETURN;
 }
 
-PglErr CalcMissingMatrix(const uintptr_t* sample_include, const uint32_t* sample_include_cumulative_popcounts, const uintptr_t* variant_include, uint32_t sample_ct, uint32_t variant_ct, uint32_t parallel_idx, uint32_t parallel_tot, uint32_t row_start_idx, uintptr_t row_end_idx, uint32_t max_thread_ct, PgenReader* simple_pgrp, uint32_t** missing_cts_ptr, uint32_t** missing_dbl_exclude_cts_ptr) {
-  unsigned char* bigstack_mark = g_bigstack_base;
-  ThreadGroup tg;
-  PreinitThreads(&tg);
-  PglErr reterr = kPglRetSuccess;
-  {
-    const uintptr_t row_end_idxl = BitCtToWordCt(row_end_idx);
-    // bugfix (1 Oct 2017): missing_vmaj rows must be vector-aligned
-    const uintptr_t row_end_idxaw = BitCtToAlignedWordCt(row_end_idx);
-    uintptr_t* missing_vmaj = nullptr;
-    uintptr_t* genovec_buf = nullptr;
-    CalcDblMissingCtx ctx;
-    if (bigstack_calloc_u32(row_end_idx, missing_cts_ptr) ||
-        bigstack_calloc_u32((S_CAST(uint64_t, row_end_idx) * (row_end_idx - 1) - S_CAST(uint64_t, row_start_idx) * (row_start_idx - 1)) / 2, missing_dbl_exclude_cts_ptr) ||
-        bigstack_calloc_w(row_end_idxl, &ctx.missing_nz[0]) ||
-        bigstack_calloc_w(row_end_idxl, &ctx.missing_nz[1]) ||
-        bigstack_alloc_w(NypCtToWordCt(row_end_idx), &genovec_buf) ||
-        bigstack_alloc_w(row_end_idxaw * (k1LU * kDblMissingBlockSize), &missing_vmaj) ||
-        bigstack_alloc_w(RoundUpPow2(row_end_idx, 2) * kDblMissingBlockWordCt, &ctx.missing_smaj[0]) ||
-        bigstack_alloc_w(RoundUpPow2(row_end_idx, 2) * kDblMissingBlockWordCt, &ctx.missing_smaj[1])) {
-      goto CalcMissingMatrix_ret_NOMEM;
-    }
-    uint32_t* missing_cts = *missing_cts_ptr;
-    uint32_t* missing_dbl_exclude_cts = *missing_dbl_exclude_cts_ptr;
-    ctx.missing_dbl_exclude_cts = missing_dbl_exclude_cts;
-    VecW* transpose_bitblock_wkspace = S_CAST(VecW*, bigstack_alloc_raw(kPglBitTransposeBufbytes));
-    uint32_t calc_thread_ct = (max_thread_ct > 8)? (max_thread_ct - 1) : max_thread_ct;
-    if (unlikely(
-            SetThreadCt(calc_thread_ct, &tg) ||
-            bigstack_alloc_u32(calc_thread_ct + 1, &ctx.thread_start))) {
-      goto CalcMissingMatrix_ret_NOMEM;
-    }
-    // note that this ctx.thread_start[] may have different values than the one
-    // computed by CalcGrm(), since calc_thread_ct changes in the MTBLAS and
-    // OS X cases.
-    TriangleFill(sample_ct, calc_thread_ct, parallel_idx, parallel_tot, 0, 1, ctx.thread_start);
-    assert(ctx.thread_start[0] == row_start_idx);
-    assert(ctx.thread_start[calc_thread_ct] == row_end_idx);
-    SetThreadFuncAndData(CalcDblMissingThread, &ctx, &tg);
-    const uint32_t sample_transpose_batch_ct_m1 = (row_end_idx - 1) / kPglBitTransposeBatch;
-
-    uintptr_t variant_uidx_base = 0;
-    uintptr_t cur_bits = variant_include[0];
-    uint32_t parity = 0;
-    uint32_t pct = 0;
-    uint32_t next_print_variant_idx = variant_ct / 100;
-    // caller's responsibility to print this
-    // logputs("Correcting for missingness: ");
-    fputs("0%", stdout);
-    fflush(stdout);
-    PgrSampleSubsetIndex pssi;
-    PgrSetSampleSubsetIndex(sample_include_cumulative_popcounts, simple_pgrp, &pssi);
-    for (uint32_t cur_variant_idx_start = 0; ; ) {
-      uint32_t cur_batch_size = 0;
-      if (!IsLastBlock(&tg)) {
-        cur_batch_size = kDblMissingBlockSize;
-        uint32_t cur_variant_idx_end = cur_variant_idx_start + cur_batch_size;
-        if (cur_variant_idx_end > variant_ct) {
-          cur_batch_size = variant_ct - cur_variant_idx_start;
-          cur_variant_idx_end = variant_ct;
-          ZeroWArr((kDblMissingBlockSize - cur_batch_size) * row_end_idxaw, &(missing_vmaj[cur_batch_size * row_end_idxaw]));
-        }
-        uintptr_t* missing_vmaj_iter = missing_vmaj;
-        for (uint32_t variant_idx = cur_variant_idx_start; variant_idx != cur_variant_idx_end; ++variant_idx) {
-          const uintptr_t variant_uidx = BitIter1(variant_include, &variant_uidx_base, &cur_bits);
-          reterr = PgrGetMissingnessD(sample_include, pssi, row_end_idx, variant_uidx, simple_pgrp, nullptr, missing_vmaj_iter, nullptr, genovec_buf);
-          if (unlikely(reterr)) {
-            goto CalcMissingMatrix_ret_PGR_FAIL;
-          }
-          missing_vmaj_iter = &(missing_vmaj_iter[row_end_idxaw]);
-        }
-        uintptr_t* cur_missing_smaj_iter = ctx.missing_smaj[parity];
-        uint32_t sample_batch_size = kPglBitTransposeBatch;
-        for (uint32_t sample_transpose_batch_idx = 0; ; ++sample_transpose_batch_idx) {
-          if (sample_transpose_batch_idx >= sample_transpose_batch_ct_m1) {
-            if (sample_transpose_batch_idx > sample_transpose_batch_ct_m1) {
-              break;
-            }
-            sample_batch_size = ModNz(row_end_idx, kPglBitTransposeBatch);
-          }
-          // missing_smaj offset needs to be 64-bit if kDblMissingBlockWordCt
-          // increases
-          TransposeBitblock(&(missing_vmaj[sample_transpose_batch_idx * kPglBitTransposeWords]), row_end_idxaw, kDblMissingBlockWordCt, kDblMissingBlockSize, sample_batch_size, &(cur_missing_smaj_iter[sample_transpose_batch_idx * kPglBitTransposeBatch * kDblMissingBlockWordCt]), transpose_bitblock_wkspace);
-        }
-        uintptr_t* cur_missing_nz = ctx.missing_nz[parity];
-        ZeroWArr(row_end_idxl, cur_missing_nz);
-        for (uint32_t sample_idx = 0; sample_idx != row_end_idx; ++sample_idx) {
-          const uintptr_t cur_word0 = *cur_missing_smaj_iter++;
-          const uintptr_t cur_word1 = *cur_missing_smaj_iter++;
-#ifdef __LP64__
-          if (cur_word0 || cur_word1) {
-            SetBit(sample_idx, cur_missing_nz);
-            missing_cts[sample_idx] += Popcount2Words(cur_word0, cur_word1);
-          }
-#else
-          const uintptr_t cur_word2 = *cur_missing_smaj_iter++;
-          const uintptr_t cur_word3 = *cur_missing_smaj_iter++;
-          if (cur_word0 || cur_word1 || cur_word2 || cur_word3) {
-            SetBit(sample_idx, cur_missing_nz);
-            missing_cts[sample_idx] += Popcount4Words(cur_word0, cur_word1, cur_word2, cur_word3);
-          }
-#endif
-        }
-      }
-      if (cur_variant_idx_start) {
-        JoinThreads(&tg);
-        // CalcDblMissingThread() never errors out
-        if (IsLastBlock(&tg)) {
-          break;
-        }
-        if (cur_variant_idx_start >= next_print_variant_idx) {
-          if (pct > 10) {
-            putc_unlocked('\b', stdout);
-          }
-          pct = (cur_variant_idx_start * 100LLU) / variant_ct;
-          printf("\b\b%u%%", pct++);
-          fflush(stdout);
-          next_print_variant_idx = (pct * S_CAST(uint64_t, variant_ct)) / 100;
-        }
-      }
-      if (cur_variant_idx_start + cur_batch_size == variant_ct) {
-        DeclareLastThreadBlock(&tg);
-      }
-      if (unlikely(SpawnThreads(&tg))) {
-        goto CalcMissingMatrix_ret_THREAD_CREATE_FAIL;
+// Transposes kDblMissingBlockSize rows of missing_vmaj (row stride
+// BitCtToAlignedWordCt(row_end_idx)) into a sample-major block, fills the
+// block's missing_nz, and updates missing_cts[].
+void TransposeDblMissingBlock(const uintptr_t* missing_vmaj, uint32_t row_end_idx, uintptr_t* missing_smaj, uintptr_t* missing_nz, uint32_t* missing_cts, VecW* transpose_bitblock_wkspace) {
+  const uintptr_t row_end_idxaw = BitCtToAlignedWordCt(row_end_idx);
+  const uint32_t sample_transpose_batch_ct_m1 = (row_end_idx - 1) / kPglBitTransposeBatch;
+  uint32_t sample_batch_size = kPglBitTransposeBatch;
+  for (uint32_t sample_transpose_batch_idx = 0; ; ++sample_transpose_batch_idx) {
+    if (sample_transpose_batch_idx >= sample_transpose_batch_ct_m1) {
+      if (sample_transpose_batch_idx > sample_transpose_batch_ct_m1) {
+        break;
       }
-      cur_variant_idx_start += cur_batch_size;
-      parity = 1 - parity;
+      sample_batch_size = ModNz(row_end_idx, kPglBitTransposeBatch);
     }
-    if (pct > 10) {
-      putc_unlocked('\b', stdout);
-    }
-    fputs("\b\b", stdout);
-    logputs("done.\n");
-    bigstack_mark = R_CAST(unsigned char*, ctx.missing_nz[0]);
+    // missing_smaj offset needs to be 64-bit if kDblMissingBlockWordCt
+    // increases
+    TransposeBitblock(&(missing_vmaj[sample_transpose_batch_idx * kPglBitTransposeWords]), row_end_idxaw, kDblMissingBlockWordCt, kDblMissingBlockSize, sample_batch_size, &(missing_smaj[sample_transpose_batch_idx * kPglBitTransposeBatch * kDblMissingBlockWordCt]), transpose_bitblock_wkspace);
   }
-  while (0) {
-  CalcMissingMatrix_ret_NOMEM:
-    reterr = kPglRetNomem;
-    break;
-  CalcMissingMatrix_ret_PGR_FAIL:
-    PgenErrPrintN(reterr);
-    break;
-  CalcMissingMatrix_ret_THREAD_CREATE_FAIL:
-    reterr = kPglRetThreadCreateFail;
-    break;
+  ZeroWArr(BitCtToWordCt(row_end_idx), missing_nz);
+  const uintptr_t* missing_smaj_iter = missing_smaj;
+  for (uint32_t sample_idx = 0; sample_idx != row_end_idx; ++sample_idx) {
+    const uintptr_t cur_word0 = *missing_smaj_iter++;
+    const uintptr_t cur_word1 = *missing_smaj_iter++;
+#ifdef __LP64__
+    if (cur_word0 || cur_word1) {
+      SetBit(sample_idx, missing_nz);
+      missing_cts[sample_idx] += Popcount2Words(cur_word0, cur_word1);
+    }
+#else
+    const uintptr_t cur_word2 = *missing_smaj_iter++;
+    const uintptr_t cur_word3 = *missing_smaj_iter++;
+    if (cur_word0 || cur_word1 || cur_word2 || cur_word3) {
+      SetBit(sample_idx, missing_nz);
+      missing_cts[sample_idx] += Popcount4Words(cur_word0, cur_word1, cur_word2, cur_word3);
+    }
+#endif
   }
-  CleanupThreads(&tg);
-  BigstackReset(bigstack_mark);
-  return reterr;
 }
 
 PglErr CalcGrm(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, const uintptr_t* variant_include, const ChrInfo* cip, const uintptr_t* allele_idx_offsets, const double* allele_freqs, uint32_t raw_sample_ct, uint32_t sample_ct, uint32_t raw_variant_ct, uint32_t variant_ct, uint32_t max_allele_ct, GrmFlags grm_flags, uint32_t parallel_idx, uint32_t parallel_tot, uint32_t max_thread_ct, PgenReader* simple_pgrp, char* outname, char* outname_end, double** grm_ptr) {
@@ -3940,9 +3983,11 @@ PglErr CalcGrm(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, c
   char* cswritep = nullptr;
   CompressStreamState css;
   ThreadGroup tg;
+  ThreadGroup missing_tg;
   PglErr reterr = kPglRetSuccess;
   PreinitCstream(&css);
   PreinitThreads(&tg);
+  PreinitThreads(&missing_tg);
   {
     assert(variant_ct);
 #if defined(__APPLE__) || defined(USE_MTBLAS)
@@ -4044,12 +4089,45 @@ PglErr CalcGrm(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, c
             bigstack_alloc_d(row_end_idx * kGrmVariantBlockSize, &ctx.normed_dosage_vmaj_bufs[1]))) {
       goto CalcGrm_ret_NOMEM;
     }
-    const uint32_t raw_variant_ctl = BitCtToWordCt(raw_variant_ct);
-    uintptr_t* variant_include_has_missing = nullptr;
+    // missing_vmaj stays null iff meanimpute
+    uintptr_t* missing_vmaj = nullptr;
+    uint32_t* missing_cts = nullptr;
+    uint32_t* missing_dbl_exclude_cts = nullptr;
+    VecW* transpose_bitblock_wkspace = nullptr;
+    CalcDblMissingCtx missing_ctx;
+    // bugfix (1 Oct 2017): missing_vmaj rows must be vector-aligned
+    const uintptr_t row_end_idxaw = BitCtToAlignedWordCt(row_end_idx);
     if (!(grm_flags & kfGrmMeanimpute)) {
-      if (unlikely(bigstack_calloc_w(raw_variant_ctl, &variant_include_has_missing))) {
+      const uintptr_t row_end_idxl = BitCtToWordCt(row_end_idx);
+      missing_ctx.nz_block_word_ct = row_end_idxl;
+      missing_ctx.smaj_block_word_ct = RoundUpPow2(row_end_idx, 2) * kDblMissingBlockWordCt;
+      if (unlikely(
+              bigstack_calloc_u32(row_end_idx, &missing_cts) ||
+              bigstack_alloc_w(row_end_idxaw * kDblMissingMaxBlockCt * kDblMissingBlockSize, &missing_vmaj) ||
+              bigstack_alloc_w(kDblMissingMaxBlockCt * row_end_idxl, &missing_ctx.missing_nz[0]) ||
+              bigstack_alloc_w(kDblMissingMaxBlockCt * row_end_idxl, &missing_ctx.missing_nz[1]) ||
+              bigstack_alloc_w(kDblMissingMaxBlockCt * missing_ctx.smaj_block_word_ct, &missing_ctx.missing_smaj[0]) ||
+              bigstack_alloc_w(kDblMissingMaxBlockCt * missing_ctx.smaj_block_word_ct, &missing_ctx.missing_smaj[1]))) {
         goto CalcGrm_ret_NOMEM;
       }
+      transpose_bitblock_wkspace = S_CAST(VecW*, bigstack_alloc_raw(kPglBitTransposeBufbytes));
+      const uint32_t missing_calc_thread_ct = (max_thread_ct > 8)? (max_thread_ct - 1) : max_thread_ct;
+      if (unlikely(
+              SetThreadCt(missing_calc_thread_ct, &missing_tg) ||
+              bigstack_alloc_u32(missing_calc_thread_ct + 1, &missing_ctx.thread_start))) {
+        goto CalcGrm_ret_NOMEM;
+      }
+      // note that this missing_ctx.thread_start[] may have different values
+      // than thread_start[], since calc_thread_ct changes in the MTBLAS and OS
+      // X cases.
+      TriangleFill(sample_ct, missing_calc_thread_ct, parallel_idx, parallel_tot, 0, 1, missing_ctx.thread_start);
+      assert(missing_ctx.thread_start[0] == row_start_idx);
+      assert(missing_ctx.thread_start[missing_calc_thread_ct] == row_end_idx);
+      missing_ctx.cur_block_ct = 0;
+      // allocated when the first block is ready, since it isn't needed at all
+      // if there are no missing calls
+      missing_ctx.missing_dbl_exclude_cts = nullptr;
+      SetThreadFuncAndData(CalcDblMissingThread, &missing_ctx, &missing_tg);
     }
     if (thread_start) {
       if (unlikely(
@@ -4076,6 +4154,9 @@ PglErr CalcGrm(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, c
     // 4. Load batch n unless eof
     // 5. Join threads
     // 6. Goto step 2 unless eof
+    //
+    // The missingness-correction threads follow the same schedule, processing
+    // the (0 or more) double-missing blocks completed while loading batch n.
     const uint32_t variance_standardize = !(grm_flags & kfGrmCov);
     const uint32_t is_haploid = cip->haploid_mask[0] & 1;
     uint32_t cur_batch_size = kGrmVariantBlockSize;
@@ -4085,6 +4166,8 @@ PglErr CalcGrm(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, c
     uintptr_t allele_idx_base = 0;
     uint32_t cur_allele_ct = 2;
     uint32_t incomplete_allele_idx = 0;
+    uint32_t missing_vmaj_row_ct = 0;
+    uint32_t cur_missing_block_ct = 0;
     uint32_t parity = 0;
     uint32_t is_not_first_block = 0;
     uint32_t pct = 0;
@@ -4097,17 +4180,40 @@ PglErr CalcGrm(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, c
     while (1) {
       if (!IsLastBlock(&tg)) {
         double* normed_vmaj = ctx.normed_dosage_vmaj_bufs[parity];
-        reterr = LoadCenteredVarmajBlock(sample_include, pssi, variant_include, allele_idx_offsets, allele_freqs, variance_standardize, is_haploid, row_end_idx, variant_ct, simple_pgrp, normed_vmaj, variant_include_has_missing, &cur_batch_size, &variant_idx, &variant_uidx, &allele_idx_base, &cur_allele_ct, &incomplete_allele_idx, &pgv, allele_1copy_buf);
+        uintptr_t* missing_vmaj_iter = missing_vmaj? (&(missing_vmaj[missing_vmaj_row_ct * row_end_idxaw])) : nullptr;
+        uint32_t new_missing_variant_ct;
+        reterr = LoadCenteredVarmajBlock(sample_include, pssi, variant_include, allele_idx_offsets, allele_freqs, variance_standardize, is_haploid, row_end_idx, variant_ct, simple_pgrp, normed_vmaj, missing_vmaj_iter, &new_missing_variant_ct, &cur_batch_size, &variant_idx, &variant_uidx, &allele_idx_base, &cur_allele_ct, &incomplete_allele_idx, &pgv, allele_1copy_buf);
         if (unlikely(reterr)) {
           goto CalcGrm_ret_PGR_FAIL;
         }
         if (thread_start) {
           MatrixTransposeCopy(normed_vmaj, cur_batch_size, row_end_idx, ctx.normed_dosage_smaj_bufs[parity]);
         }
+        if (missing_vmaj) {
+          missing_vmaj_row_ct += new_missing_variant_ct;
+          if ((variant_idx == variant_ct) && (missing_vmaj_row_ct % kDblMissingBlockSize)) {
+            // flush final partial block
+            const uint32_t padded_row_ct = RoundUpPow2(missing_vmaj_row_ct, kDblMissingBlockSize);
+            ZeroWArr((padded_row_ct - missing_vmaj_row_ct) * row_end_idxaw, &(missing_vmaj[missing_vmaj_row_ct * row_end_idxaw]));
+            missing_vmaj_row_ct = padded_row_ct;
+          }
+          cur_missing_block_ct = missing_vmaj_row_ct / kDblMissingBlockSize;
+          for (uint32_t block_idx = 0; block_idx != cur_missing_block_ct; ++block_idx) {
+            TransposeDblMissingBlock(&(missing_vmaj[block_idx * kDblMissingBlockSize * row_end_idxaw]), row_end_idx, &(missing_ctx.missing_smaj[parity][block_idx * missing_ctx.smaj_block_word_ct]), &(missing_ctx.missing_nz[parity][block_idx * missing_ctx.nz_block_word_ct]), missing_cts, transpose_bitblock_wkspace);
+          }
+          missing_vmaj_row_ct -= cur_missing_block_ct * kDblMissingBlockSize;
+          if (missing_vmaj_row_ct && cur_missing_block_ct) {
+            memcpy(missing_vmaj, &(missing_vmaj[cur_missing_block_ct * kDblMissingBlockSize * row_end_idxaw]), missing_vmaj_row_ct * row_end_idxaw * sizeof(intptr_t));
+          }
+        }
       }
       if (is_not_first_block) {
         JoinThreads(&tg);
-        // CalcGrmPartThread() and CalcGrmThread() never error out
+        // CalcGrmPartThread(), CalcGrmThread(), and CalcDblMissingThread()
+        // never error out
+        if (missing_vmaj) {
+          JoinThreads(&missing_tg);
+        }
         if (IsLastBlock(&tg)) {
           break;
         }
@@ -4122,13 +4228,30 @@ PglErr CalcGrm(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, c
         }
       }
       ctx.cur_batch_size = cur_batch_size;
+      if (missing_vmaj) {
+        if (cur_missing_block_ct && (!missing_dbl_exclude_cts)) {
+          if (unlikely(bigstack_end_calloc_u32((S_CAST(uint64_t, row_end_idx) * (row_end_idx - 1) - S_CAST(uint64_t, row_start_idx) * (row_start_idx - 1)) / 2, &missing_dbl_exclude_cts))) {
+            goto CalcGrm_ret_NOMEM;
+          }
+          missing_ctx.missing_dbl_exclude_cts = missing_dbl_exclude_cts;
+        }
+        missing_ctx.cur_block_ct = cur_missing_block_ct;
+      }
       if (variant_idx == variant_ct) {
         DeclareLastThreadBlock(&tg);
+        if (missing_vmaj) {
+          DeclareLastThreadBlock(&missing_tg);
+        }
         cur_batch_size = 0;
       }
       if (unlikely(SpawnThreads(&tg))) {
         goto CalcGrm_ret_THREAD_CREATE_FAIL;
       }
+      if (missing_vmaj) {
+        if (unlikely(SpawnThreads(&missing_tg))) {
+          goto CalcGrm_ret_THREAD_CREATE_FAIL;
+        }
+      }
       is_not_first_block = 1;
       variant_idx_start = variant_idx;
       parity = 1 - parity;
@@ -4139,18 +4262,9 @@ PglErr CalcGrm(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, c
     }
     fputs("\b\b", stdout);
     logputs("done.\n");
-    uint32_t* missing_cts = nullptr;  // stays null iff meanimpute
-    uint32_t* missing_dbl_exclude_cts = nullptr;
-    if (variant_include_has_missing) {
-      const uint32_t variant_ct_with_missing = PopcountWords(variant_include_has_missing, raw_variant_ctl);
+    if (!missing_dbl_exclude_cts) {
       // if no missing calls at all, act as if meanimpute was on
-      if (variant_ct_with_missing) {
-        logputs("Correcting for missingness... ");
-        reterr = CalcMissingMatrix(sample_include, sample_include_cumulative_popcounts, variant_include_has_missing, sample_ct, variant_ct_with_missing, parallel_idx, parallel_tot, row_start_idx, row_end_idx, max_thread_ct, simple_pgrp, &missing_cts, &missing_dbl_exclude_cts);
-        if (unlikely(reterr)) {
-          goto CalcGrm_ret_1;
-        }
-      }
+      missing_cts = nullptr;
     }
     if (missing_cts) {
       // could parallelize this loop if it ever matters
@@ -4547,6 +4661,7 @@ PglErr CalcGrm(const uintptr_t* orig_sample_include, const SampleIdInfo* siip, c
   CswriteCloseCond(&css, cswritep);
   fclose_cond(outfile);
   CleanupThreads(&tg);
+  CleanupThreads(&missing_tg);
   BLAS_SET_NUM_THREADS(1);
   BigstackDoubleReset(bigstack_mark, bigstack_end_mark);
   return reterr;
@@ -5174,7 +5289,7 @@ PglErr CalcPca(const uintptr_t* sample_include, const SampleIdInfo* siip, const
         uint32_t is_not_first_block = 0;
         while (1) {
           if (!IsLastBlock(&tg)) {
-            reterr = LoadCenteredVarmajBlock(pca_sample_include, pssi, variant_include, allele_idx_offsets, allele_freqs, 1, is_haploid, pca_sample_ct, variant_ct, simple_pgrp, ctx.yy_bufs[parity], nullptr, &cur_batch_size, &variant_idx, &variant_uidx, &allele_idx_base, &cur_allele_ct, &incomplete_allele_idx, &pgv, allele_1copy_buf);
+            reterr = LoadCenteredVarmajBlock(pca_sample_include, pssi, variant_include, allele_idx_offsets, allele_freqs, 1, is_haploid, pca_sample_ct, variant_ct, simple_pgrp, ctx.yy_bufs[parity], nullptr, nullptr, &cur_batch_size, &variant_idx, &variant_uidx, &allele_idx_base, &cur_allele_ct, &incomplete_allele_idx, &pgv, allele_1copy_buf);
             if (unlikely(reterr)) {
               goto CalcPca_ret_PGR_FAIL;
             }
@@ -5244,7 +5359,7 @@ PglErr CalcPca(const uintptr_t* sample_include, const SampleIdInfo* siip, const
       uint32_t is_not_first_block = 0;
       while (1) {
         if (!IsLastBlock(&tg)) {
-          reterr = LoadCenteredVarmajBlock(pca_sample_include, pssi, variant_include, allele_idx_offsets, allele_freqs, 1, is_haploid, pca_sample_ct, variant_ct, simple_pgrp, ctx.yy_bufs[parity], nullptr, &cur_batch_size, &variant_idx, &variant_uidx, &allele_idx_base, &cur_allele_ct, &incomplete_allele_idx, &pgv, allele_1copy_buf);
+          reterr = LoadCenteredVarmajBlock(pca_sample_include, pssi, variant_include, allele_idx_offsets, allele_freqs, 1, is_haploid, pca_sample_ct, variant_ct, simple_pgrp, ctx.yy_bufs[parity], nullptr, nullptr, &cur_batch_size, &variant_idx, &variant_uidx, &allele_idx_base, &cur_allele_ct, &incomplete_allele_idx, &pgv, allele_1copy_buf);
           if (unlikely(reterr)) {
             // this error *didn't* happen on an earlier pass, so assign blame
             // to I/O instead
@@ -5499,7 +5614,7 @@ PglErr CalcPca(const uintptr_t* sample_include, const SampleIdInfo* siip, const
       uint32_t is_not_first_block = 0;
       while (1) {
         if (!IsLastBlock(&tg)) {
-          reterr = LoadCenteredVarmajBlock(pca_sample_include, pssi, variant_include, allele_idx_offsets, allele_freqs, 1, is_haploid, pca_sample_ct, variant_ct, simple_pgrp, vwctx.yy_bufs[parity], nullptr, &cur_batch_size, &variant_idx_load, &variant_uidx_load, &allele_idx_base_load, &cur_allele_ct_load, &incomplete_allele_idx_load, &pgv, allele_1copy_buf);
+          reterr = LoadCenteredVarmajBlock(pca_sample_include, pssi, variant_include, allele_idx_offsets, allele_freqs, 1, is_haploid, pca_sample_ct, variant_ct, simple_pgrp, vwctx.yy_bufs[parity], nullptr, nullptr, &cur_batch_size, &variant_idx_load, &variant_uidx_load, &allele_idx_base_load, &cur_allele_ct_load, &incomplete_allele_idx_load, &pgv, allele_1copy_buf);
           if (unlikely(reterr)) {
             goto CalcPca_ret_PGR_FAIL;
           }
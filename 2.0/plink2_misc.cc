@@ -9591,7 +9591,301 @@ THREAD_FUNC_DECL HetThread(void* raw_arg) {
   THREAD_RETURN;
 }
 
-PglErr HetReport(const uintptr_t* sample_include, const SampleIdInfo* siip, const uintptr_t* orig_variant_include, const ChrInfo* cip, const uintptr_t* allele_idx_offsets, const double* allele_freqs, const uintptr_t* founder_info, uint32_t raw_sample_ct, uint32_t sample_ct, uint32_t founder_ct, uint32_t raw_variant_ct, uint32_t orig_variant_ct, uint32_t max_allele_ct, HetFlags flags, uint32_t max_thread_ct, uintptr_t pgr_alloc_cacheline_ct, PgenFileInfo* pgfip, char* outname, char* outname_end) {
+typedef struct HetSmajCtxStruct {
+  const uintptr_t* sample_include;
+  const uint32_t* sample_include_cumulative_popcounts;
+  // kMask5555 bit set for each counted (autosomal, polymorphic) variant
+  const uintptr_t* counted_nypmask;
+  const double* variant_ehets;
+  uint32_t raw_sample_ct;
+  uint32_t raw_variant_ct;
+
+  const uint32_t* tile_sblock_idxs;
+  const uint32_t* tile_vblock_idxs;
+  uint32_t cur_tile_idx_start;
+  uint32_t cur_tile_ct;
+  const unsigned char* cur_ctilebuf;
+  const uintptr_t* cur_ctile_offsets;
+  uintptr_t** thread_tilebufs;
+
+  // only kPglRetMalformedInput possible, no atomic ops needed
+  PglErr reterr;
+
+  uint32_t** thread_ohets;
+  double** thread_ehet_incrs;
+  int32_t** thread_nobs_incrs;
+} HetSmajCtx;
+
+THREAD_FUNC_DECL HetSmajThread(void* raw_arg) {
+  ThreadGroupFuncArg* arg = S_CAST(ThreadGroupFuncArg*, raw_arg);
+  const uintptr_t tidx = arg->tidx;
+  HetSmajCtx* ctx = S_CAST(HetSmajCtx*, arg->sharedp->context);
+
+  const uintptr_t* sample_include = ctx->sample_include;
+  const uint32_t* sample_include_cumulative_popcounts = ctx->sample_include_cumulative_popcounts;
+  const uintptr_t* counted_nypmask = ctx->counted_nypmask;
+  const double* variant_ehets = ctx->variant_ehets;
+  const uint32_t raw_sample_ct = ctx->raw_sample_ct;
+  const uint32_t raw_variant_ct = ctx->raw_variant_ct;
+  const uint32_t* tile_sblock_idxs = ctx->tile_sblock_idxs;
+  const uint32_t* tile_vblock_idxs = ctx->tile_vblock_idxs;
+  uintptr_t* tilebuf = ctx->thread_tilebufs[tidx];
+  uint32_t* ohets = ctx->thread_ohets[tidx];
+  double* ehet_incrs = ctx->thread_ehet_incrs[tidx];
+  int32_t* nobs_incrs = ctx->thread_nobs_incrs[tidx];
+  const uint32_t calc_thread_ct = GetThreadCt(arg->sharedp);
+  do {
+    const uint32_t cur_tile_ct = ctx->cur_tile_ct;
+    const uint32_t tile_idx_start = ctx->cur_tile_idx_start;
+    const unsigned char* ctilebuf = ctx->cur_ctilebuf;
+    const uintptr_t* ctile_offsets = ctx->cur_ctile_offsets;
+    const uint32_t tile_bidx_end = ((tidx + 1) * cur_tile_ct) / calc_thread_ct;
+    for (uint32_t tile_bidx = (tidx * cur_tile_ct) / calc_thread_ct; tile_bidx != tile_bidx_end; ++tile_bidx) {
+      const uint32_t tile_idx = tile_idx_start + tile_bidx;
+      const uint32_t sample_uidx_base = tile_sblock_idxs[tile_idx] * kSmajTileSampleCt;
+      const uint32_t variant_uidx_base = tile_vblock_idxs[tile_idx] * kSmajTileVariantCt;
+      const uint32_t row_ct = MINV(raw_sample_ct - sample_uidx_base, kSmajTileSampleCt);
+      const uint32_t row_word_ct = NypCtToWordCt(MINV(raw_variant_ct - variant_uidx_base, kSmajTileVariantCt));
+      const uintptr_t tile_byte_ct = S_CAST(uintptr_t, row_ct) * row_word_ct * kBytesPerWord;
+      const uintptr_t ctile_offset = ctile_offsets[tile_bidx];
+      const uintptr_t extracted_byte_ct = ZSTD_decompress(tilebuf, tile_byte_ct, &(ctilebuf[ctile_offset]), ctile_offsets[tile_bidx + 1] - ctile_offset);
+      if (unlikely(extracted_byte_ct != tile_byte_ct)) {
+        ctx->reterr = kPglRetMalformedInput;
+        break;
+      }
+      const uintptr_t* cur_counted_nypmask = &(counted_nypmask[variant_uidx_base / kBitsPerWordD2]);
+      const double* cur_variant_ehets = &(variant_ehets[variant_uidx_base]);
+      const uintptr_t* row_iter = tilebuf;
+      for (uint32_t row_idx = 0; row_idx != row_ct; ++row_idx, row_iter = &(row_iter[row_word_ct])) {
+        const uint32_t sample_uidx = sample_uidx_base + row_idx;
+        if (!IsSet(sample_include, sample_uidx)) {
+          continue;
+        }
+        uint32_t ohet_ct = 0;
+        uint32_t missing_ct = 0;
+        double ehet_decr = 0.0;
+        for (uint32_t widx = 0; widx != row_word_ct; ++widx) {
+          const uintptr_t geno_word = row_iter[widx];
+          const uintptr_t mask_word = cur_counted_nypmask[widx];
+          ohet_ct += PopcountWord(geno_word & (~(geno_word >> 1)) & mask_word);
+          uintptr_t missing_word = geno_word & (geno_word >> 1) & mask_word;
+          if (!missing_word) {
+            continue;
+          }
+          const double* cur_ehets = &(cur_variant_ehets[widx * kBitsPerWordD2]);
+          do {
+            ehet_decr += cur_ehets[ctzw(missing_word) / 2];
+            ++missing_ct;
+            missing_word &= missing_word - 1;
+          } while (missing_word);
+        }
+        const uint32_t sample_idx = RawToSubsettedPos(sample_include, sample_include_cumulative_popcounts, sample_uidx);
+        ohets[sample_idx] += ohet_ct;
+        ehet_incrs[sample_idx] -= ehet_decr;
+        nobs_incrs[sample_idx] -= missing_ct;
+      }
+    }
+  } while (!THREAD_BLOCK_FINISH(arg));
+  THREAD_RETURN;
+}
+
+// Alternative to the HetThread() loop when a sample-major tile file is
+// available: only tiles covering sample_include are read.  Requires
+// precomputed allele frequencies and biallelic variants.  Result arrays are
+// allocated on the bigstack.
+PglErr HetSmajCounts(const uintptr_t* sample_include, const uint32_t* sample_include_cumulative_popcounts, const uintptr_t* autosomal_variant_include, const double* allele_freqs, const uintptr_t* allele_idx_offsets, uint32_t raw_sample_ct, uint32_t sample_ct, uint32_t raw_variant_ct, uint32_t autosomal_variant_ct, uint32_t max_thread_ct, SmajTileInfo* stip, double* ehet_base_ptr, uint32_t* nobs_base_ptr, uint32_t** ohets_ptr, double** ehet_incrs_ptr, int32_t** nobs_incrs_ptr) {
+  PglErr reterr = kPglRetSuccess;
+  ThreadGroup tg;
+  PreinitThreads(&tg);
+  HetSmajCtx ctx;
+  {
+    double* variant_ehets;
+    uintptr_t* counted_nypmask;
+    if (unlikely(
+            bigstack_alloc_d(raw_variant_ct, &variant_ehets) ||
+            bigstack_calloc_w(NypCtToWordCt(raw_variant_ct), &counted_nypmask))) {
+      goto HetSmajCounts_ret_NOMEM;
+    }
+    double ehet_base = 0.0;
+    uint32_t nobs_base = 0;
+    uintptr_t variant_uidx_base = 0;
+    uintptr_t cur_bits = autosomal_variant_include[0];
+    for (uint32_t variant_idx = 0; variant_idx != autosomal_variant_ct; ++variant_idx) {
+      const uintptr_t variant_uidx = BitIter1(autosomal_variant_include, &variant_uidx_base, &cur_bits);
+      const uintptr_t allele_idx_offset_base = allele_idx_offsets? allele_idx_offsets[variant_uidx] : (variant_uidx * 2);
+      const double ref_freq = allele_freqs[allele_idx_offset_base - variant_uidx];
+      const double ehet = 2 * ref_freq * (1 - ref_freq);
+      if (ehet < kSmallishEpsilon) {
+        continue;
+      }
+      variant_ehets[variant_uidx] = ehet;
+      counted_nypmask[variant_uidx / kBitsPerWordD2] |= k1LU << (2 * (variant_uidx % kBitsPerWordD2));
+      ehet_base += ehet;
+      ++nobs_base;
+    }
+    *ehet_base_ptr = ehet_base;
+    *nobs_base_ptr = nobs_base;
+
+    const uint32_t sblock_ct = stip->sblock_ct;
+    const uint32_t vblock_ct = stip->vblock_ct;
+    uint32_t touched_sblock_ct = 0;
+    for (uint32_t sblock_idx = 0; sblock_idx != sblock_ct; ++sblock_idx) {
+      const uint32_t sample_uidx_start = sblock_idx * kSmajTileSampleCt;
+      touched_sblock_ct += !AllBitsAreZero(sample_include, sample_uidx_start, MINV(sample_uidx_start + kSmajTileSampleCt, raw_sample_ct));
+    }
+    const uint32_t work_tile_ct = touched_sblock_ct * vblock_ct;
+    uint32_t* tile_sblock_idxs;
+    uint32_t* tile_vblock_idxs;
+    if (unlikely(
+            bigstack_alloc_u32(work_tile_ct, &tile_sblock_idxs) ||
+            bigstack_alloc_u32(work_tile_ct, &tile_vblock_idxs))) {
+      goto HetSmajCounts_ret_NOMEM;
+    }
+    const uint64_t* tile_fpos = stip->tile_fpos;
+    uintptr_t max_ctile_byte_ct = 0;
+    uint32_t work_tile_idx = 0;
+    for (uint32_t sblock_idx = 0; sblock_idx != sblock_ct; ++sblock_idx) {
+      const uint32_t sample_uidx_start = sblock_idx * kSmajTileSampleCt;
+      if (AllBitsAreZero(sample_include, sample_uidx_start, MINV(sample_uidx_start + kSmajTileSampleCt, raw_sample_ct))) {
+        continue;
+      }
+      const uint64_t* cur_tile_fpos = &(tile_fpos[S_CAST(uintptr_t, sblock_idx) * vblock_ct]);
+      for (uint32_t vblock_idx = 0; vblock_idx != vblock_ct; ++vblock_idx) {
+        tile_sblock_idxs[work_tile_idx] = sblock_idx;
+        tile_vblock_idxs[work_tile_idx] = vblock_idx;
+        ++work_tile_idx;
+        const uintptr_t ctile_byte_ct = cur_tile_fpos[vblock_idx + 1] - cur_tile_fpos[vblock_idx];
+        if (ctile_byte_ct > max_ctile_byte_ct) {
+          max_ctile_byte_ct = ctile_byte_ct;
+        }
+      }
+    }
+    logprintf("--het: Reading %u/%u sample-major tile%s.\n", work_tile_ct, sblock_ct * vblock_ct, (sblock_ct * vblock_ct == 1)? "" : "s");
+
+    uint32_t calc_thread_ct = MINV(max_thread_ct, work_tile_ct);
+    if (!calc_thread_ct) {
+      calc_thread_ct = 1;
+    }
+    const uint32_t tiles_per_batch = calc_thread_ct * 2;
+    const uintptr_t sample_ct_i32v = DivUp(sample_ct, kInt32PerVec);
+    const uintptr_t sample_ct_dv = DivUp(sample_ct * sizeof(double), kBytesPerVec);
+    const uintptr_t tile_word_ct = kSmajTileSampleCt * kSmajTileVariantWordCt;
+    STD_ARRAY_DECL(unsigned char*, 2, ctilebufs);
+    STD_ARRAY_DECL(uintptr_t*, 2, ctile_offsets);
+    if (unlikely(
+            SetThreadCt(calc_thread_ct, &tg) ||
+            bigstack_alloc_wp(calc_thread_ct, &ctx.thread_tilebufs) ||
+            bigstack_alloc_u32p(calc_thread_ct, &ctx.thread_ohets) ||
+            bigstack_alloc_dp(calc_thread_ct, &ctx.thread_ehet_incrs) ||
+            bigstack_alloc_i32p(calc_thread_ct, &ctx.thread_nobs_incrs) ||
+            bigstack_alloc_w(tiles_per_batch + 1, &(ctile_offsets[0])) ||
+            bigstack_alloc_w(tiles_per_batch + 1, &(ctile_offsets[1])) ||
+            bigstack_alloc_uc(tiles_per_batch * max_ctile_byte_ct, &(ctilebufs[0])) ||
+            bigstack_alloc_uc(tiles_per_batch * max_ctile_byte_ct, &(ctilebufs[1])))) {
+      goto HetSmajCounts_ret_NOMEM;
+    }
+    for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
+      if (unlikely(
+              bigstack_alloc_w(tile_word_ct, &(ctx.thread_tilebufs[tidx])) ||
+              bigstack_calloc_u32(sample_ct_i32v * kInt32PerVec, &(ctx.thread_ohets[tidx])) ||
+              bigstack_calloc_d(sample_ct_dv * (kBytesPerVec / sizeof(double)), &(ctx.thread_ehet_incrs[tidx])) ||
+              bigstack_calloc_i32(sample_ct_i32v * kInt32PerVec, &(ctx.thread_nobs_incrs[tidx])))) {
+        goto HetSmajCounts_ret_NOMEM;
+      }
+    }
+    ctx.sample_include = sample_include;
+    ctx.sample_include_cumulative_popcounts = sample_include_cumulative_popcounts;
+    ctx.counted_nypmask = counted_nypmask;
+    ctx.variant_ehets = variant_ehets;
+    ctx.raw_sample_ct = raw_sample_ct;
+    ctx.raw_variant_ct = raw_variant_ct;
+    ctx.tile_sblock_idxs = tile_sblock_idxs;
+    ctx.tile_vblock_idxs = tile_vblock_idxs;
+    ctx.reterr = kPglRetSuccess;
+    SetThreadFuncAndData(HetSmajThread, &ctx, &tg);
+
+    FILE* ff = stip->ff;
+    uint64_t cur_fpos = UINT64_MAX;
+    uint32_t parity = 0;
+    uint32_t tile_idx_start = 0;
+    for (uint32_t batch_idx = 0; ; ++batch_idx) {
+      const uint32_t cur_tile_ct = MINV(tiles_per_batch, work_tile_ct - tile_idx_start);
+      uintptr_t* cur_ctile_offsets = ctile_offsets[parity];
+      cur_ctile_offsets[0] = 0;
+      for (uint32_t tile_bidx = 0; tile_bidx != cur_tile_ct; ++tile_bidx) {
+        const uint32_t cur_work_tile_idx = tile_idx_start + tile_bidx;
+        const uintptr_t tile_idx = S_CAST(uintptr_t, tile_sblock_idxs[cur_work_tile_idx]) * vblock_ct + tile_vblock_idxs[cur_work_tile_idx];
+        const uint64_t tile_start_fpos = tile_fpos[tile_idx];
+        const uintptr_t ctile_byte_ct = tile_fpos[tile_idx + 1] - tile_start_fpos;
+        if (tile_start_fpos != cur_fpos) {
+          if (unlikely(fseeko(ff, tile_start_fpos, SEEK_SET))) {
+            goto HetSmajCounts_ret_READ_FAIL;
+          }
+        }
+        if (unlikely(fread_checked(&(ctilebufs[parity][cur_ctile_offsets[tile_bidx]]), ctile_byte_ct, ff))) {
+          goto HetSmajCounts_ret_READ_FAIL;
+        }
+        cur_fpos = tile_start_fpos + ctile_byte_ct;
+        cur_ctile_offsets[tile_bidx + 1] = cur_ctile_offsets[tile_bidx] + ctile_byte_ct;
+      }
+      if (batch_idx) {
+        JoinThreads(&tg);
+        if (unlikely(ctx.reterr)) {
+          goto HetSmajCounts_ret_MALFORMED_INPUT;
+        }
+      }
+      if (!cur_tile_ct) {
+        break;
+      }
+      ctx.cur_tile_idx_start = tile_idx_start;
+      ctx.cur_tile_ct = cur_tile_ct;
+      ctx.cur_ctilebuf = ctilebufs[parity];
+      ctx.cur_ctile_offsets = cur_ctile_offsets;
+      tile_idx_start += cur_tile_ct;
+      if (tile_idx_start == work_tile_ct) {
+        DeclareLastThreadBlock(&tg);
+      }
+      if (unlikely(SpawnThreads(&tg))) {
+        goto HetSmajCounts_ret_THREAD_CREATE_FAIL;
+      }
+      parity = 1 - parity;
+    }
+    uint32_t* ohets = ctx.thread_ohets[0];
+    double* ehet_incrs = ctx.thread_ehet_incrs[0];
+    int32_t* nobs_incrs = ctx.thread_nobs_incrs[0];
+    for (uint32_t tidx = 1; tidx != calc_thread_ct; ++tidx) {
+      U32CastVecAdd(ctx.thread_ohets[tidx], sample_ct_i32v, ohets);
+      const double* src = ctx.thread_ehet_incrs[tidx];
+      for (uint32_t sample_idx = 0; sample_idx != sample_ct; ++sample_idx) {
+        ehet_incrs[sample_idx] += src[sample_idx];
+      }
+      I32CastVecAdd(ctx.thread_nobs_incrs[tidx], sample_ct_i32v, nobs_incrs);
+    }
+    *ohets_ptr = ohets;
+    *ehet_incrs_ptr = ehet_incrs;
+    *nobs_incrs_ptr = nobs_incrs;
+  }
+  while (0) {
+  HetSmajCounts_ret_NOMEM:
+    reterr = kPglRetNomem;
+    break;
+  HetSmajCounts_ret_READ_FAIL:
+    logerrprintfww(kErrprintfFread, ".smaj file", rstrerror(errno));
+    reterr = kPglRetReadFail;
+    break;
+  HetSmajCounts_ret_MALFORMED_INPUT:
+    logerrputs("Error: Malformed .smaj file.\n");
+    reterr = kPglRetMalformedInput;
+    break;
+  HetSmajCounts_ret_THREAD_CREATE_FAIL:
+    reterr = kPglRetThreadCreateFail;
+    break;
+  }
+  CleanupThreads(&tg);
+  return reterr;
+}
+
+PglErr HetReport(const uintptr_t* sample_include, const SampleIdInfo* siip, const uintptr_t* orig_variant_include, const ChrInfo* cip, const uintptr_t* allele_idx_offsets, const double* allele_freqs, const uintptr_t* founder_info, uint32_t raw_sample_ct, uint32_t sample_ct, uint32_t founder_ct, uint32_t raw_variant_ct, uint32_t orig_variant_ct, uint32_t max_allele_ct, HetFlags flags, uint32_t max_thread_ct, uintptr_t pgr_alloc_cacheline_ct, PgenFileInfo* pgfip, const char* smaj_pgenname, char* outname, char* outname_end) {
   unsigned char* bigstack_mark = g_bigstack_base;
   char* cswritep = nullptr;
   CompressStreamState css;
@@ -9600,6 +9894,8 @@ PglErr HetReport(const uintptr_t* sample_include, const SampleIdInfo* siip, cons
   ThreadGroup tg;
   PreinitThreads(&tg);
   HetCtx ctx;
+  SmajTileInfo smaj_tiles;
+  PreinitSmajTiles(&smaj_tiles);
   {
     if (IsSet(cip->haploid_mask, 0)) {
       logerrputs("Error: --het cannot be used on haploid genomes.\n");
@@ -9665,165 +9961,205 @@ PglErr HetReport(const uintptr_t* sample_include, const SampleIdInfo* siip, cons
     }
     FillCumulativePopcounts(sample_include, raw_sample_ctl, sample_include_cumulative_popcounts);
     ctx.sample_include_cumulative_popcounts = sample_include_cumulative_popcounts;
-    ctx.founder_info_collapsed = nullptr;
-    ctx.founder_info_interleaved_vec = nullptr;
-    ctx.allele_freqs = allele_freqs;
-    if (small_sample) {
-      const uint32_t sample_ctaw = BitCtToAlignedWordCt(sample_ct);
-      uintptr_t* founder_info_collapsed;
-      uintptr_t* founder_info_interleaved_vec;
-      if (unlikely(
-              bigstack_alloc_w(sample_ctaw, &founder_info_collapsed) ||
-              bigstack_alloc_w(sample_ctaw, &founder_info_interleaved_vec))) {
-        goto HetReport_ret_NOMEM;
+    double ehet_base;
+    uint32_t nobs_base;
+    uint32_t* ohets;
+    double* ehet_incrs;
+    int32_t* nobs_incrs;
+    uint32_t use_smaj = 0;
+    if (smaj_pgenname) {
+      uint32_t all_biallelic = 1;
+      if (max_allele_ct > 2) {
+        uintptr_t variant_uidx_base = 0;
+        uintptr_t cur_bits = ctx.autosomal_variant_include[0];
+        for (uint32_t variant_idx = 0; variant_idx != autosomal_variant_ct; ++variant_idx) {
+          const uintptr_t variant_uidx = BitIter1(ctx.autosomal_variant_include, &variant_uidx_base, &cur_bits);
+          if (allele_idx_offsets[variant_uidx + 1] - allele_idx_offsets[variant_uidx] != 2) {
+            all_biallelic = 0;
+            break;
+          }
+        }
+      }
+      if (small_sample) {
+        logerrputs("Warning: --smaj-tiles is ignored by '--het small-sample'.\n");
+      } else if (!all_biallelic) {
+        logerrputs("Warning: --smaj-tiles is ignored by --het when multiallelic variants are\npresent.\n");
+      } else {
+        reterr = SmajTilesOpen(smaj_pgenname, raw_sample_ct, raw_variant_ct, &smaj_tiles);
+        if (!reterr) {
+          use_smaj = 1;
+        } else if (unlikely(reterr != kPglRetSkipped)) {
+          goto HetReport_ret_1;
+        }
+        reterr = kPglRetSuccess;
       }
-      CopyBitarrSubset(founder_info, sample_include, sample_ct, founder_info_collapsed);
-      const uint32_t sample_ctl = BitCtToWordCt(sample_ct);
-      ZeroWArr(sample_ctaw - sample_ctl, &(founder_info_collapsed[sample_ctl]));
-      FillInterleavedMaskVec(founder_info_collapsed, sample_ctaw / kWordsPerVec, founder_info_interleaved_vec);
-      ctx.founder_info_collapsed = founder_info_collapsed;
-      ctx.founder_info_interleaved_vec = founder_info_interleaved_vec;
-      ctx.allele_freqs = nullptr;
-    }
-    ctx.sample_ct = sample_ct;
-    ctx.founder_ct = founder_ct;
-
-    uint32_t calc_thread_ct = max_thread_ct;
-    if (unlikely(
-            bigstack_alloc_wp(calc_thread_ct, &ctx.raregenos) ||
-            bigstack_alloc_u32p(calc_thread_ct, &ctx.difflist_sample_id_bufs) ||
-            bigstack_alloc_vp(calc_thread_ct, &ctx.scrambled_ohet_bufs) ||
-            bigstack_alloc_d(calc_thread_ct, &ctx.thread_ehet_base) ||
-            bigstack_alloc_u32(calc_thread_ct, &ctx.thread_nobs_base) ||
-            bigstack_alloc_u32p(calc_thread_ct, &ctx.thread_ohets) ||
-            bigstack_alloc_dp(calc_thread_ct, &ctx.thread_ehet_incrs) ||
-            bigstack_alloc_i32p(calc_thread_ct, &ctx.thread_nobs_incrs))) {
-      goto HetReport_ret_NOMEM;
     }
-    const uint32_t max_returned_difflist_len = 2 * (raw_sample_ct / kPglMaxDifflistLenDivisor);
-    const uintptr_t raregeno_vec_ct = DivUp(max_returned_difflist_len, kNypsPerVec);
-    const uintptr_t difflist_sample_id_vec_ct = DivUp(max_returned_difflist_len, kInt32PerVec);
-    const uint32_t mhc_needed = (max_allele_ct > 2);
-    uintptr_t allele_nobs_vec_ct = 0;
-    ctx.allele_nobs_bufs = nullptr;
-    if (mhc_needed) {
+    if (use_smaj) {
+      reterr = HetSmajCounts(sample_include, sample_include_cumulative_popcounts, ctx.autosomal_variant_include, allele_freqs, allele_idx_offsets, raw_sample_ct, sample_ct, raw_variant_ct, autosomal_variant_ct, max_thread_ct, &smaj_tiles, &ehet_base, &nobs_base, &ohets, &ehet_incrs, &nobs_incrs);
+      if (unlikely(reterr)) {
+        goto HetReport_ret_1;
+      }
+    } else {
+      ctx.founder_info_collapsed = nullptr;
+      ctx.founder_info_interleaved_vec = nullptr;
+      ctx.allele_freqs = allele_freqs;
+      if (small_sample) {
+        const uint32_t sample_ctaw = BitCtToAlignedWordCt(sample_ct);
+        uintptr_t* founder_info_collapsed;
+        uintptr_t* founder_info_interleaved_vec;
+        if (unlikely(
+                bigstack_alloc_w(sample_ctaw, &founder_info_collapsed) ||
+                bigstack_alloc_w(sample_ctaw, &founder_info_interleaved_vec))) {
+          goto HetReport_ret_NOMEM;
+        }
+        CopyBitarrSubset(founder_info, sample_include, sample_ct, founder_info_collapsed);
+        const uint32_t sample_ctl = BitCtToWordCt(sample_ct);
+        ZeroWArr(sample_ctaw - sample_ctl, &(founder_info_collapsed[sample_ctl]));
+        FillInterleavedMaskVec(founder_info_collapsed, sample_ctaw / kWordsPerVec, founder_info_interleaved_vec);
+        ctx.founder_info_collapsed = founder_info_collapsed;
+        ctx.founder_info_interleaved_vec = founder_info_interleaved_vec;
+        ctx.allele_freqs = nullptr;
+      }
+      ctx.sample_ct = sample_ct;
+      ctx.founder_ct = founder_ct;
+
+      uint32_t calc_thread_ct = max_thread_ct;
       if (unlikely(
-              bigstack_alloc_u32p(calc_thread_ct, &ctx.allele_nobs_bufs))) {
+              bigstack_alloc_wp(calc_thread_ct, &ctx.raregenos) ||
+              bigstack_alloc_u32p(calc_thread_ct, &ctx.difflist_sample_id_bufs) ||
+              bigstack_alloc_vp(calc_thread_ct, &ctx.scrambled_ohet_bufs) ||
+              bigstack_alloc_d(calc_thread_ct, &ctx.thread_ehet_base) ||
+              bigstack_alloc_u32(calc_thread_ct, &ctx.thread_nobs_base) ||
+              bigstack_alloc_u32p(calc_thread_ct, &ctx.thread_ohets) ||
+              bigstack_alloc_dp(calc_thread_ct, &ctx.thread_ehet_incrs) ||
+              bigstack_alloc_i32p(calc_thread_ct, &ctx.thread_nobs_incrs))) {
         goto HetReport_ret_NOMEM;
       }
-      allele_nobs_vec_ct = DivUp(max_allele_ct, kInt32PerVec);
-    }
-
-    const uintptr_t acc2_vec_ct = NypCtToVecCt(sample_ct);
-    const uintptr_t scrambled_ohet_vec_ct = acc2_vec_ct * 23;
-    const uintptr_t sample_ct_i32v = DivUp(sample_ct, kInt32PerVec);
-    const uintptr_t sample_ct_dv = DivUp(sample_ct * sizeof(double), kBytesPerVec);
-
-    const uintptr_t thread_xalloc_vec_ct = raregeno_vec_ct + difflist_sample_id_vec_ct + allele_nobs_vec_ct + scrambled_ohet_vec_ct + 2 * sample_ct_i32v + sample_ct_dv;
-    const uintptr_t thread_xalloc_cacheline_ct = DivUp(thread_xalloc_vec_ct, kVecsPerCacheline);
-    STD_ARRAY_DECL(unsigned char*, 2, main_loadbufs);
-    ctx.thread_read_mhc = nullptr;
-    uint32_t read_block_size;
-    if (unlikely(PgenMtLoadInit(ctx.autosomal_variant_include, raw_sample_ct, autosomal_variant_ct, bigstack_left(), pgr_alloc_cacheline_ct, thread_xalloc_cacheline_ct, 0, 0, pgfip, &calc_thread_ct, &ctx.genovecs, mhc_needed? (&ctx.thread_read_mhc) : nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &read_block_size, nullptr, main_loadbufs, &ctx.pgr_ptrs, &ctx.read_variant_uidx_starts))) {
-      goto HetReport_ret_NOMEM;
-    }
-    if (unlikely(SetThreadCt(calc_thread_ct, &tg))) {
-      goto HetReport_ret_NOMEM;
-    }
-    ctx.reterr = kPglRetSuccess;
-    // assert(bigstack_left() >= thread_xalloc_cacheline_ct * kCacheline * calc_thread_ct);
-    for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
-      unsigned char* cur_alloc = S_CAST(unsigned char*, bigstack_alloc_raw(thread_xalloc_cacheline_ct * kCacheline));
-      ctx.raregenos[tidx] = R_CAST(uintptr_t*, cur_alloc);
-      cur_alloc = &(cur_alloc[raregeno_vec_ct * kBytesPerVec]);
-      ctx.difflist_sample_id_bufs[tidx] = R_CAST(uint32_t*, cur_alloc);
-      cur_alloc = &(cur_alloc[difflist_sample_id_vec_ct * kBytesPerVec]);
+      const uint32_t max_returned_difflist_len = 2 * (raw_sample_ct / kPglMaxDifflistLenDivisor);
+      const uintptr_t raregeno_vec_ct = DivUp(max_returned_difflist_len, kNypsPerVec);
+      const uintptr_t difflist_sample_id_vec_ct = DivUp(max_returned_difflist_len, kInt32PerVec);
+      const uint32_t mhc_needed = (max_allele_ct > 2);
+      uintptr_t allele_nobs_vec_ct = 0;
+      ctx.allele_nobs_bufs = nullptr;
       if (mhc_needed) {
-        ctx.allele_nobs_bufs[tidx] = R_CAST(uint32_t*, cur_alloc);
-        cur_alloc = &(cur_alloc[allele_nobs_vec_ct * kBytesPerVec]);
+        if (unlikely(
+                bigstack_alloc_u32p(calc_thread_ct, &ctx.allele_nobs_bufs))) {
+          goto HetReport_ret_NOMEM;
+        }
+        allele_nobs_vec_ct = DivUp(max_allele_ct, kInt32PerVec);
       }
-      ctx.scrambled_ohet_bufs[tidx] = R_CAST(VecW*, cur_alloc);
-      cur_alloc = &(cur_alloc[scrambled_ohet_vec_ct * kBytesPerVec]);
-      ctx.thread_ohets[tidx] = R_CAST(uint32_t*, cur_alloc);
-      cur_alloc = &(cur_alloc[sample_ct_i32v * kBytesPerVec]);
-      ctx.thread_ehet_incrs[tidx] = R_CAST(double*, cur_alloc);
-      cur_alloc = &(cur_alloc[sample_ct_dv * kBytesPerVec]);
-      ctx.thread_nobs_incrs[tidx] = R_CAST(int32_t*, cur_alloc);
-      // cur_alloc = &(cur_alloc[sample_ct_i32v * kBytesPerVec]);
-    }
-    SetThreadFuncAndData(HetThread, &ctx, &tg);
 
-    logputs("--het: ");
-    fputs("0%", stdout);
-    fflush(stdout);
-    uint32_t pct = 0;
+      const uintptr_t acc2_vec_ct = NypCtToVecCt(sample_ct);
+      const uintptr_t scrambled_ohet_vec_ct = acc2_vec_ct * 23;
+      const uintptr_t sample_ct_i32v = DivUp(sample_ct, kInt32PerVec);
+      const uintptr_t sample_ct_dv = DivUp(sample_ct * sizeof(double), kBytesPerVec);
 
-    uint32_t parity = 0;
-    uint32_t read_block_idx = 0;
-    uint32_t next_print_variant_idx = autosomal_variant_ct / 100;
-    for (uint32_t variant_idx = 0; ; ) {
-      const uint32_t cur_block_size = MultireadNonempty(ctx.autosomal_variant_include, &tg, raw_variant_ct, read_block_size, pgfip, &read_block_idx, &reterr);
-      if (unlikely(reterr)) {
-        goto HetReport_ret_PGR_FAIL;
+      const uintptr_t thread_xalloc_vec_ct = raregeno_vec_ct + difflist_sample_id_vec_ct + allele_nobs_vec_ct + scrambled_ohet_vec_ct + 2 * sample_ct_i32v + sample_ct_dv;
+      const uintptr_t thread_xalloc_cacheline_ct = DivUp(thread_xalloc_vec_ct, kVecsPerCacheline);
+      STD_ARRAY_DECL(unsigned char*, 2, main_loadbufs);
+      ctx.thread_read_mhc = nullptr;
+      uint32_t read_block_size;
+      if (unlikely(PgenMtLoadInit(ctx.autosomal_variant_include, raw_sample_ct, autosomal_variant_ct, bigstack_left(), pgr_alloc_cacheline_ct, thread_xalloc_cacheline_ct, 0, 0, pgfip, &calc_thread_ct, &ctx.genovecs, mhc_needed? (&ctx.thread_read_mhc) : nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, &read_block_size, nullptr, main_loadbufs, &ctx.pgr_ptrs, &ctx.read_variant_uidx_starts))) {
+        goto HetReport_ret_NOMEM;
       }
-      if (variant_idx) {
-        JoinThreads(&tg);
-        reterr = ctx.reterr;
+      if (unlikely(SetThreadCt(calc_thread_ct, &tg))) {
+        goto HetReport_ret_NOMEM;
+      }
+      ctx.reterr = kPglRetSuccess;
+      // assert(bigstack_left() >= thread_xalloc_cacheline_ct * kCacheline * calc_thread_ct);
+      for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
+        unsigned char* cur_alloc = S_CAST(unsigned char*, bigstack_alloc_raw(thread_xalloc_cacheline_ct * kCacheline));
+        ctx.raregenos[tidx] = R_CAST(uintptr_t*, cur_alloc);
+        cur_alloc = &(cur_alloc[raregeno_vec_ct * kBytesPerVec]);
+        ctx.difflist_sample_id_bufs[tidx] = R_CAST(uint32_t*, cur_alloc);
+        cur_alloc = &(cur_alloc[difflist_sample_id_vec_ct * kBytesPerVec]);
+        if (mhc_needed) {
+          ctx.allele_nobs_bufs[tidx] = R_CAST(uint32_t*, cur_alloc);
+          cur_alloc = &(cur_alloc[allele_nobs_vec_ct * kBytesPerVec]);
+        }
+        ctx.scrambled_ohet_bufs[tidx] = R_CAST(VecW*, cur_alloc);
+        cur_alloc = &(cur_alloc[scrambled_ohet_vec_ct * kBytesPerVec]);
+        ctx.thread_ohets[tidx] = R_CAST(uint32_t*, cur_alloc);
+        cur_alloc = &(cur_alloc[sample_ct_i32v * kBytesPerVec]);
+        ctx.thread_ehet_incrs[tidx] = R_CAST(double*, cur_alloc);
+        cur_alloc = &(cur_alloc[sample_ct_dv * kBytesPerVec]);
+        ctx.thread_nobs_incrs[tidx] = R_CAST(int32_t*, cur_alloc);
+        // cur_alloc = &(cur_alloc[sample_ct_i32v * kBytesPerVec]);
+      }
+      SetThreadFuncAndData(HetThread, &ctx, &tg);
+
+      logputs("--het: ");
+      fputs("0%", stdout);
+      fflush(stdout);
+      uint32_t pct = 0;
+
+      uint32_t parity = 0;
+      uint32_t read_block_idx = 0;
+      uint32_t next_print_variant_idx = autosomal_variant_ct / 100;
+      for (uint32_t variant_idx = 0; ; ) {
+        const uint32_t cur_block_size = MultireadNonempty(ctx.autosomal_variant_include, &tg, raw_variant_ct, read_block_size, pgfip, &read_block_idx, &reterr);
         if (unlikely(reterr)) {
           goto HetReport_ret_PGR_FAIL;
         }
-      }
-      if (!IsLastBlock(&tg)) {
-        ctx.cur_block_size = cur_block_size;
-        ComputeUidxStartPartition(ctx.autosomal_variant_include, cur_block_size, calc_thread_ct, read_block_idx * read_block_size, ctx.read_variant_uidx_starts);
-        PgrCopyBaseAndOffset(pgfip, calc_thread_ct, ctx.pgr_ptrs);
-        if (variant_idx + cur_block_size == autosomal_variant_ct) {
-          DeclareLastThreadBlock(&tg);
+        if (variant_idx) {
+          JoinThreads(&tg);
+          reterr = ctx.reterr;
+          if (unlikely(reterr)) {
+            goto HetReport_ret_PGR_FAIL;
+          }
         }
-        if (unlikely(SpawnThreads(&tg))) {
-          goto HetReport_ret_THREAD_CREATE_FAIL;
+        if (!IsLastBlock(&tg)) {
+          ctx.cur_block_size = cur_block_size;
+          ComputeUidxStartPartition(ctx.autosomal_variant_include, cur_block_size, calc_thread_ct, read_block_idx * read_block_size, ctx.read_variant_uidx_starts);
+          PgrCopyBaseAndOffset(pgfip, calc_thread_ct, ctx.pgr_ptrs);
+          if (variant_idx + cur_block_size == autosomal_variant_ct) {
+            DeclareLastThreadBlock(&tg);
+          }
+          if (unlikely(SpawnThreads(&tg))) {
+            goto HetReport_ret_THREAD_CREATE_FAIL;
+          }
         }
-      }
 
-      parity = 1 - parity;
-      if (variant_idx == autosomal_variant_ct) {
-        break;
-      }
-      if (variant_idx >= next_print_variant_idx) {
-        if (pct > 10) {
-          putc_unlocked('\b', stdout);
+        parity = 1 - parity;
+        if (variant_idx == autosomal_variant_ct) {
+          break;
         }
-        pct = (variant_idx * 100LLU) / autosomal_variant_ct;
-        printf("\b\b%u%%", pct++);
-        fflush(stdout);
-        next_print_variant_idx = (pct * S_CAST(uint64_t, autosomal_variant_ct)) / 100;
+        if (variant_idx >= next_print_variant_idx) {
+          if (pct > 10) {
+            putc_unlocked('\b', stdout);
+          }
+          pct = (variant_idx * 100LLU) / autosomal_variant_ct;
+          printf("\b\b%u%%", pct++);
+          fflush(stdout);
+          next_print_variant_idx = (pct * S_CAST(uint64_t, autosomal_variant_ct)) / 100;
+        }
+
+        ++read_block_idx;
+        variant_idx += cur_block_size;
+        pgfip->block_base = main_loadbufs[parity];
+      }
+      ehet_base = ctx.thread_ehet_base[0];
+      nobs_base = ctx.thread_nobs_base[0];
+      ohets = ctx.thread_ohets[0];
+      ehet_incrs = ctx.thread_ehet_incrs[0];
+      nobs_incrs = ctx.thread_nobs_incrs[0];
+      for (uint32_t tidx = 1; tidx != calc_thread_ct; ++tidx) {
+        ehet_base += ctx.thread_ehet_base[tidx];
+        nobs_base += ctx.thread_nobs_base[tidx];
+        U32CastVecAdd(ctx.thread_ohets[tidx], sample_ct_i32v, ohets);
+        const double* src = ctx.thread_ehet_incrs[tidx];
+        for (uint32_t sample_idx = 0; sample_idx != sample_ct; ++sample_idx) {
+          ehet_incrs[sample_idx] += src[sample_idx];
+        }
+        I32CastVecAdd(ctx.thread_nobs_incrs[tidx], sample_ct_i32v, nobs_incrs);
       }
-
-      ++read_block_idx;
-      variant_idx += cur_block_size;
-      pgfip->block_base = main_loadbufs[parity];
-    }
-    double ehet_base = ctx.thread_ehet_base[0];
-    uint32_t nobs_base = ctx.thread_nobs_base[0];
-    uint32_t* ohets = ctx.thread_ohets[0];
-    double* ehet_incrs = ctx.thread_ehet_incrs[0];
-    int32_t* nobs_incrs = ctx.thread_nobs_incrs[0];
-    for (uint32_t tidx = 1; tidx != calc_thread_ct; ++tidx) {
-      ehet_base += ctx.thread_ehet_base[tidx];
-      nobs_base += ctx.thread_nobs_base[tidx];
-      U32CastVecAdd(ctx.thread_ohets[tidx], sample_ct_i32v, ohets);
-      const double* src = ctx.thread_ehet_incrs[tidx];
-      for (uint32_t sample_idx = 0; sample_idx != sample_ct; ++sample_idx) {
-        ehet_incrs[sample_idx] += src[sample_idx];
+      // Ready to write results.
+      if (pct > 10) {
+        putc_unlocked('\b', stdout);
       }
-      I32CastVecAdd(ctx.thread_nobs_incrs[tidx], sample_ct_i32v, nobs_incrs);
-    }
-    // Ready to write results.
-    if (pct > 10) {
-      putc_unlocked('\b', stdout);
+      fputs("\b\b", stdout);
+      logputs("done.\n");
     }
-    fputs("\b\b", stdout);
-    logputs("done.\n");
     const char* sample_ids = siip->sample_ids;
     const char* sids = siip->sids;
     const uintptr_t max_sample_id_blen = siip->max_sample_id_blen;
@@ -9898,6 +10234,7 @@ PglErr HetReport(const uintptr_t* sample_include, const SampleIdInfo* siip, cons
   }
  HetReport_ret_1:
   CleanupThreads(&tg);
+  CleanupSmajTiles(&smaj_tiles);
   CswriteCloseCond(&css, cswritep);
   BigstackReset(bigstack_mark);
   return reterr;
@@ -16,6 +16,12 @@
 
 #include "plink2_psam.h"
 
+#include <sys/types.h>  // stat()
+#include <sys/stat.h>  // stat()
+
+#define XXH_PRIVATE_API
+#include "zstd/lib/common/xxhash.h"
+
 #ifdef __cplusplus
 namespace plink2 {
 #endif
@@ -844,28 +850,557 @@ PglErr LoadPsam(const char* psamname, const RangeList* pheno_range_list_ptr, Fam
 }
 
 
-typedef struct PhenoInfoLlStruct {
-  NONCOPYABLE(PhenoInfoLlStruct);
-  // for categorical phenotypes, phenodata entry should be reinterpreted as
-  // uint32_t
-  struct PhenoInfoLlStruct* next;
-  uint32_t sample_uidx;
-  double phenodata[];
-} PhenoInfoLl;
+// Lines are parsed in batches: the main thread copies the post-ID remainder of
+// each relevant line into the batch buffer and performs the sample ID lookup,
+// then all threads lex and convert disjoint line ranges.  Numeric values are
+// written straight into the (double-typed) phenotype columns; categorical
+// tokens are saved so the main thread can assign category indexes in file
+// order afterward.
+CONSTI32(kLoadPhenosBatchLineCap, 16384);
+
+ENUM_U31_DEF_START()
+  kLoadPhenosErrNone,
+  kLoadPhenosErrMissingTokens,
+  kLoadPhenosErrInvalidNumeric,
+  kLoadPhenosErrUnexpectedCategorical,
+  kLoadPhenosErrUnexpectedNumeric,
+  kLoadPhenosErrHashLine,
+  kLoadPhenosErrDuplicateId,
+  kLoadPhenosErrTstream
+ENUM_U31_DEF_END(LoadPhenosErrType);
+
+typedef struct LoadPhenosErrStruct {
+  LoadPhenosErrType type;
+  uint32_t line_bidx;
+  uint32_t new_pheno_idx;
+  const char* token;
+} LoadPhenosErr;
+
+typedef struct LoadPhenosCtxStruct {
+  PhenoCol* new_pheno_cols;
+  const uint32_t* col_types;
+  const uint32_t* col_skips;
+  const uintptr_t* categorical_phenos;
+  uint32_t new_pheno_ct;
+  uint32_t categorical_pheno_ct;
+  uint32_t comma_delim;
+  double missing_phenod;
+  double pheno_ctrld;
+  double pheno_cased;
+
+  const char** line_starts;
+  uint32_t* sample_uidxs;
+  // categorical_pheno_ct entries per line
+  const char** cat_token_ptrs;
+  uint32_t* cat_token_slens;
+  uint32_t line_ct;
+
+  const char*** token_ptrs;
+  uint32_t** token_slens;
+  uintptr_t** quantitative_phenos;
+  LoadPhenosErr* errs;
+} LoadPhenosCtx;
+
+void LoadPhenosProcessLines(uint32_t tidx, uint32_t thread_ct, LoadPhenosCtx* ctx) {
+  LoadPhenosErr* errp = &(ctx->errs[tidx]);
+  if (errp->type) {
+    return;
+  }
+  PhenoCol* new_pheno_cols = ctx->new_pheno_cols;
+  const uint32_t* col_types = ctx->col_types;
+  const uint32_t* col_skips = ctx->col_skips;
+  const uintptr_t* categorical_phenos = ctx->categorical_phenos;
+  const uint32_t new_pheno_ct = ctx->new_pheno_ct;
+  const uint32_t categorical_pheno_ct = ctx->categorical_pheno_ct;
+  const uint32_t comma_delim = ctx->comma_delim;
+  const double missing_phenod = ctx->missing_phenod;
+  const double pheno_ctrld = ctx->pheno_ctrld;
+  const double pheno_cased = ctx->pheno_cased;
+  const char* const* line_starts = ctx->line_starts;
+  const uint32_t* sample_uidxs = ctx->sample_uidxs;
+  const char** token_ptrs = ctx->token_ptrs[tidx];
+  uint32_t* token_slens = ctx->token_slens[tidx];
+  uintptr_t* quantitative_phenos = ctx->quantitative_phenos[tidx];
+  const uint32_t line_ct = ctx->line_ct;
+  const uint32_t line_bidx_end = (S_CAST(uint64_t, line_ct) * (tidx + 1)) / thread_ct;
+  for (uint32_t line_bidx = (S_CAST(uint64_t, line_ct) * tidx) / thread_ct; line_bidx != line_bidx_end; ++line_bidx) {
+    const char* line_iter = line_starts[line_bidx];
+    if (!comma_delim) {
+      line_iter = TokenLexK(line_iter, col_types, col_skips, new_pheno_ct, token_ptrs, token_slens);
+    } else {
+      line_iter = CsvLexK(line_iter, col_types, col_skips, new_pheno_ct, token_ptrs, token_slens);
+    }
+    if (unlikely(!line_iter)) {
+      errp->type = kLoadPhenosErrMissingTokens;
+      errp->line_bidx = line_bidx;
+      return;
+    }
+    const uint32_t sample_uidx = sample_uidxs[line_bidx];
+    const char** cur_cat_token_ptrs = &(ctx->cat_token_ptrs[S_CAST(uintptr_t, line_bidx) * categorical_pheno_ct]);
+    uint32_t* cur_cat_token_slens = &(ctx->cat_token_slens[S_CAST(uintptr_t, line_bidx) * categorical_pheno_ct]);
+    uint32_t cat_pheno_idx = 0;
+    for (uint32_t new_pheno_idx = 0; new_pheno_idx != new_pheno_ct; ++new_pheno_idx) {
+      const char* cur_phenostr = token_ptrs[new_pheno_idx];
+      double dxx;
+      const char* cur_phenostr_end = ScanadvDouble(cur_phenostr, &dxx);
+      if (!cur_phenostr_end) {
+        const uint32_t slen = token_slens[new_pheno_idx];
+        if (IsNanStr(cur_phenostr, slen)) {
+          // note that, in CSVs, empty string is interpreted as a missing
+          // non-categorical phenotype; explicit "NONE" is needed to denote a
+          // missing category
+          dxx = missing_phenod;
+        } else {
+          if (unlikely(!IsSet(categorical_phenos, new_pheno_idx))) {
+            errp->type = kLoadPhenosErrUnexpectedCategorical;
+            errp->line_bidx = line_bidx;
+            errp->new_pheno_idx = new_pheno_idx;
+            return;
+          }
+          cur_cat_token_ptrs[cat_pheno_idx] = cur_phenostr;
+          cur_cat_token_slens[cat_pheno_idx] = slen;
+          ++cat_pheno_idx;
+          continue;
+        }
+      } else {
+        if (unlikely(!IsSpaceOrEoln(*cur_phenostr_end))) {
+          // safe to modify, since this is our own copy of the line
+          cur_phenostr_end = CurTokenEnd(cur_phenostr_end);
+          *K_CAST(char*, cur_phenostr_end) = '\0';
+          errp->type = kLoadPhenosErrInvalidNumeric;
+          errp->line_bidx = line_bidx;
+          errp->token = cur_phenostr;
+          return;
+        }
+      }
+      if (unlikely(IsSet(categorical_phenos, new_pheno_idx))) {
+        errp->type = kLoadPhenosErrUnexpectedNumeric;
+        errp->line_bidx = line_bidx;
+        errp->new_pheno_idx = new_pheno_idx;
+        return;
+      }
+      if (!IsSet(quantitative_phenos, new_pheno_idx)) {
+        if ((dxx != missing_phenod) && (dxx != pheno_ctrld) && (dxx != pheno_cased) && (dxx != 0.0)) {
+          SetBit(new_pheno_idx, quantitative_phenos);
+        }
+      }
+      new_pheno_cols[new_pheno_idx].data.qt[sample_uidx] = dxx;
+    }
+  }
+}
+
+THREAD_FUNC_DECL LoadPhenosThread(void* raw_arg) {
+  ThreadGroupFuncArg* arg = S_CAST(ThreadGroupFuncArg*, raw_arg);
+  const uint32_t tidx_p1 = arg->tidx + 1;
+  const uint32_t thread_ct = GetThreadCt(arg->sharedp) + 1;
+  LoadPhenosCtx* ctx = S_CAST(LoadPhenosCtx*, arg->sharedp->context);
+  do {
+    LoadPhenosProcessLines(tidx_p1, thread_ct, ctx);
+  } while (!THREAD_BLOCK_FINISH(arg));
+  THREAD_RETURN;
+}
+
+// --pheno-cache file layout (native byte order):
+//   header (kPhenoCacheHeaderByteCt bytes): 3-byte magic "l\x1b\x42", 1 byte
+//     sizeof(intptr_t), uint32 phenotype count, uint64 source file size,
+//     int64 source mtime, uint64 settings hash, uint64 name byte count
+//   null-terminated phenotype names
+//   for each phenotype: uint32 type code, uint32 nonnull_category_ct, uint64
+//     category-name byte count; the nonmiss bitarray (raw_sample_ctl words);
+//     then the case/control bitarray, raw_sample_ct doubles, or raw_sample_ct
+//     uint32 category codes followed by the null-terminated category names
+// The settings hash covers the sample IDs, sample_include, and every
+// LoadPhenos() parameter that affects the result.
+CONSTI32(kPhenoCacheHeaderByteCt, 64);
+
+typedef struct PhenoCacheKeyStruct {
+  uint64_t src_byte_ct;
+  int64_t src_mtime;
+  uint64_t settings_hash;
+} PhenoCacheKey;
+
+// Returns 1 if pheno_fname isn't a regular file, in which case there's nothing
+// to validate a cache against.
+BoolErr PhenoCacheKeyInit(const char* pheno_fname, const RangeList* pheno_range_list_ptr, const uintptr_t* sample_include, const SampleIdInfo* siip, uint32_t raw_sample_ct, uint32_t old_pheno_ct, int32_t missing_pheno, uint32_t affection_01, uint32_t iid_only, uint32_t numeric_ranges, PhenoCacheKey* keyp) {
+  struct stat statbuf;
+  if (stat(pheno_fname, &statbuf) || (!S_ISREG(statbuf.st_mode))) {
+    return 1;
+  }
+  keyp->src_byte_ct = statbuf.st_size;
+  keyp->src_mtime = statbuf.st_mtime;
+  const uint32_t settings[6] = {raw_sample_ct, old_pheno_ct, S_CAST(uint32_t, missing_pheno), affection_01, iid_only, numeric_ranges};
+  const uint64_t id_hash = SampleIdsXxh64(siip, raw_sample_ct);
+  XXH64_state_t xxh_state;
+  XXH64_reset(&xxh_state, 0);
+  XXH64_update(&xxh_state, settings, sizeof(settings));
+  XXH64_update(&xxh_state, &id_hash, sizeof(int64_t));
+  XXH64_update(&xxh_state, sample_include, BitCtToWordCt(raw_sample_ct) * sizeof(intptr_t));
+  XXH64_update(&xxh_state, g_missing_catname, strlen(g_missing_catname) + 1);
+  const char* range_names = pheno_range_list_ptr->names;
+  if (range_names) {
+    const uint32_t name_ct = pheno_range_list_ptr->name_ct;
+    const uintptr_t name_max_blen = pheno_range_list_ptr->name_max_blen;
+    for (uint32_t name_idx = 0; name_idx != name_ct; ++name_idx) {
+      const char* cur_name = &(range_names[name_idx * name_max_blen]);
+      XXH64_update(&xxh_state, cur_name, strlen(cur_name) + 1);
+    }
+    XXH64_update(&xxh_state, pheno_range_list_ptr->starts_range, name_ct);
+  }
+  keyp->settings_hash = XXH64_digest(&xxh_state);
+  return 0;
+}
+
+// Fills the old names into the front of pheno_names and checks for
+// duplicates.
+PglErr FinalizePhenoNames(const char* old_pheno_names, uint32_t old_pheno_ct, uintptr_t old_max_pheno_name_blen, uint32_t final_pheno_ct, uintptr_t max_pheno_name_blen, char* pheno_names) {
+  if (unlikely(final_pheno_ct > kMaxPhenoCt)) {
+    // yeah, yeah, this will never come up
+    logerrputs("Error: " PROG_NAME_STR " does not support more than " MAX_PHENO_CT_STR " phenotypes.\n");
+    return kPglRetInconsistentInput;
+  }
+  for (uint32_t old_pheno_idx = 0; old_pheno_idx != old_pheno_ct; ++old_pheno_idx) {
+    strcpy(&(pheno_names[old_pheno_idx * max_pheno_name_blen]), &(old_pheno_names[old_pheno_idx * old_max_pheno_name_blen]));
+  }
+
+  uint32_t tmp_htable_size;
+  uint32_t* htable_tmp;
+  if (unlikely(HtableGoodSizeAlloc(final_pheno_ct, bigstack_left(), &htable_tmp, &tmp_htable_size))) {
+    return kPglRetNomem;
+  }
+  // possible todo: implement something like --pheno-merge, allow conditional
+  // duplication in that case
+  const uint32_t duplicate_idx = PopulateStrboxHtable(pheno_names, final_pheno_ct, max_pheno_name_blen, tmp_htable_size, htable_tmp);
+  BigstackReset(htable_tmp);
+  if (unlikely(duplicate_idx)) {
+    const char* duplicate_pheno_name = &(pheno_names[duplicate_idx * max_pheno_name_blen]);
+    snprintf(g_logbuf, kLogbufSize, "Error: Duplicate phenotype/covariate ID '%s'.\n", duplicate_pheno_name);
+    WordWrapB(0);
+    logerrputsb();
+    return kPglRetMalformedInput;
+  }
+  return kPglRetSuccess;
+}
+
+// Returns the end of the null-terminated string list, or nullptr if it
+// doesn't contain exactly str_ct strings.  *max_blen_ptr must be initialized.
+const unsigned char* ScanStrList(const unsigned char* list_start, uintptr_t byte_ct, uint32_t str_ct, uintptr_t* max_blen_ptr) {
+  const unsigned char* list_iter = list_start;
+  const unsigned char* list_end = &(list_start[byte_ct]);
+  uintptr_t max_blen = *max_blen_ptr;
+  for (uint32_t str_idx = 0; str_idx != str_ct; ++str_idx) {
+    const unsigned char* str_end = S_CAST(const unsigned char*, memchr(list_iter, 0, list_end - list_iter));
+    if ((!str_end) || (str_end == list_iter)) {
+      return nullptr;
+    }
+    const uintptr_t blen = str_end - list_iter + 1;
+    if (blen > max_blen) {
+      max_blen = blen;
+    }
+    list_iter = &(str_end[1]);
+  }
+  if (list_iter != list_end) {
+    return nullptr;
+  }
+  *max_blen_ptr = max_blen;
+  return list_end;
+}
+
+// Returns kPglRetSkipped if there's no valid cache file.
+PglErr LoadPhenoCache(const char* cache_fname, const PhenoCacheKey* keyp, uint32_t raw_sample_ct, PhenoCol** pheno_cols_ptr, char** pheno_names_ptr, uint32_t* pheno_ct_ptr, uintptr_t* max_pheno_name_blen_ptr) {
+  unsigned char* base;
+  uintptr_t byte_ct;
+  uint32_t is_mmapped;
+  if (MapFileReadonly(cache_fname, &base, &byte_ct, &is_mmapped)) {
+    return kPglRetSkipped;
+  }
+  char* pheno_names = nullptr;
+  PglErr reterr = kPglRetSuccess;
+  {
+    const uintptr_t raw_sample_ctl = BitCtToWordCt(raw_sample_ct);
+    const uintptr_t bitarr_byte_ct = raw_sample_ctl * sizeof(intptr_t);
+    if (byte_ct < S_CAST(uintptr_t, kPhenoCacheHeaderByteCt)) {
+      goto LoadPhenoCache_ret_SKIPPED;
+    }
+    uint32_t new_pheno_ct;
+    PhenoCacheKey stored_key;
+    uint64_t names_byte_ct;
+    memcpy(&new_pheno_ct, &(base[4]), sizeof(int32_t));
+    memcpy(&stored_key.src_byte_ct, &(base[8]), sizeof(int64_t));
+    memcpy(&stored_key.src_mtime, &(base[16]), sizeof(int64_t));
+    memcpy(&stored_key.settings_hash, &(base[24]), sizeof(int64_t));
+    memcpy(&names_byte_ct, &(base[32]), sizeof(int64_t));
+    if ((!memequal_k(base, "l\x1b\x42", 3)) || (base[3] != sizeof(intptr_t)) || (!new_pheno_ct) || (stored_key.src_byte_ct != keyp->src_byte_ct) || (stored_key.src_mtime != keyp->src_mtime) || (stored_key.settings_hash != keyp->settings_hash) || (names_byte_ct > byte_ct - kPhenoCacheHeaderByteCt)) {
+      goto LoadPhenoCache_ret_SKIPPED;
+    }
+    // Validate the entire layout before allocating anything.
+    const unsigned char* new_names_start = &(base[kPhenoCacheHeaderByteCt]);
+    uintptr_t max_new_name_blen = 0;
+    const unsigned char* read_iter = ScanStrList(new_names_start, names_byte_ct, new_pheno_ct, &max_new_name_blen);
+    if (!read_iter) {
+      goto LoadPhenoCache_ret_SKIPPED;
+    }
+    const unsigned char* cols_start = read_iter;
+    const unsigned char* file_end = &(base[byte_ct]);
+    for (uint32_t new_pheno_idx = 0; new_pheno_idx != new_pheno_ct; ++new_pheno_idx) {
+      if (S_CAST(uintptr_t, file_end - read_iter) < 16) {
+        goto LoadPhenoCache_ret_SKIPPED;
+      }
+      uint32_t type_code;
+      uint32_t nonnull_category_ct;
+      uint64_t catname_byte_ct;
+      memcpy(&type_code, read_iter, sizeof(int32_t));
+      memcpy(&nonnull_category_ct, &(read_iter[4]), sizeof(int32_t));
+      memcpy(&catname_byte_ct, &(read_iter[8]), sizeof(int64_t));
+      read_iter = &(read_iter[16]);
+      uint64_t payload_byte_ct = bitarr_byte_ct;
+      if (type_code == kPhenoDtypeCc) {
+        payload_byte_ct += bitarr_byte_ct;
+      } else if (type_code == kPhenoDtypeQt) {
+        payload_byte_ct += raw_sample_ct * sizeof(double);
+      } else if (type_code == kPhenoDtypeCat) {
+        payload_byte_ct += raw_sample_ct * sizeof(int32_t);
+      } else {
+        goto LoadPhenoCache_ret_SKIPPED;
+      }
+      if ((type_code != kPhenoDtypeCat) && (nonnull_category_ct || catname_byte_ct)) {
+        goto LoadPhenoCache_ret_SKIPPED;
+      }
+      if (S_CAST(uint64_t, file_end - read_iter) < payload_byte_ct + catname_byte_ct) {
+        goto LoadPhenoCache_ret_SKIPPED;
+      }
+      if (type_code == kPhenoDtypeCat) {
+        // Category indexes are later used to index category_names[].
+        const unsigned char* cat_iter = &(read_iter[bitarr_byte_ct]);
+        for (uint32_t sample_uidx = 0; sample_uidx != raw_sample_ct; ++sample_uidx) {
+          uint32_t cur_cat;
+          memcpy(&cur_cat, &(cat_iter[sample_uidx * sizeof(int32_t)]), sizeof(int32_t));
+          if (cur_cat > nonnull_category_ct) {
+            goto LoadPhenoCache_ret_SKIPPED;
+          }
+        }
+      }
+      read_iter = &(read_iter[payload_byte_ct]);
+      if (type_code == kPhenoDtypeCat) {
+        uintptr_t max_catname_blen = 0;
+        if (!ScanStrList(read_iter, catname_byte_ct, nonnull_category_ct, &max_catname_blen)) {
+          goto LoadPhenoCache_ret_SKIPPED;
+        }
+        read_iter = &(read_iter[catname_byte_ct]);
+      }
+    }
+    if (read_iter != file_end) {
+      goto LoadPhenoCache_ret_SKIPPED;
+    }
+
+    const uint32_t old_pheno_ct = *pheno_ct_ptr;
+    const uintptr_t old_max_pheno_name_blen = *max_pheno_name_blen_ptr;
+    const uint32_t final_pheno_ct = old_pheno_ct + new_pheno_ct;
+    const uintptr_t max_pheno_name_blen = MAXV(old_max_pheno_name_blen, max_new_name_blen);
+    if (unlikely(pgl_malloc(final_pheno_ct * max_pheno_name_blen, &pheno_names))) {
+      goto LoadPhenoCache_ret_NOMEM;
+    }
+    const char* new_names_iter = R_CAST(const char*, new_names_start);
+    for (uint32_t new_pheno_idx = 0; new_pheno_idx != new_pheno_ct; ++new_pheno_idx) {
+      const uint32_t name_blen = strlen(new_names_iter) + 1;
+      memcpy(&(pheno_names[(old_pheno_ct + new_pheno_idx) * max_pheno_name_blen]), new_names_iter, name_blen);
+      new_names_iter = &(new_names_iter[name_blen]);
+    }
+    reterr = FinalizePhenoNames(*pheno_names_ptr, old_pheno_ct, old_max_pheno_name_blen, final_pheno_ct, max_pheno_name_blen, pheno_names);
+    if (unlikely(reterr)) {
+      goto LoadPhenoCache_ret_1;
+    }
+    PhenoCol* new_pheno_cols = S_CAST(PhenoCol*, realloc(*pheno_cols_ptr, final_pheno_ct * sizeof(PhenoCol)));
+    if (unlikely(!new_pheno_cols)) {
+      goto LoadPhenoCache_ret_NOMEM;
+    }
+    for (uint32_t pheno_idx = old_pheno_ct; pheno_idx != final_pheno_ct; ++pheno_idx) {
+      new_pheno_cols[pheno_idx].nonmiss = nullptr;
+    }
+    *pheno_ct_ptr = final_pheno_ct;
+    *pheno_cols_ptr = new_pheno_cols;
+
+    // Column layout matches what the text parser produces.
+    const uintptr_t nonmiss_vec_ct = BitCtToVecCt(raw_sample_ct);
+    read_iter = cols_start;
+    PhenoCol* pheno_cols_iter = &(new_pheno_cols[old_pheno_ct]);
+    for (uint32_t new_pheno_idx = 0; new_pheno_idx != new_pheno_ct; ++new_pheno_idx, ++pheno_cols_iter) {
+      uint32_t type_code;
+      uint32_t nonnull_category_ct;
+      uint64_t catname_byte_ct;
+      memcpy(&type_code, read_iter, sizeof(int32_t));
+      memcpy(&nonnull_category_ct, &(read_iter[4]), sizeof(int32_t));
+      memcpy(&catname_byte_ct, &(read_iter[8]), sizeof(int64_t));
+      read_iter = &(read_iter[16]);
+      uintptr_t data_vec_ct;
+      uintptr_t catname_vec_ct = 0;
+      uintptr_t catname_storage_vec_ct = 0;
+      uintptr_t data_byte_ct;
+      if (type_code == kPhenoDtypeCc) {
+        data_vec_ct = nonmiss_vec_ct;
+        data_byte_ct = bitarr_byte_ct;
+      } else if (type_code == kPhenoDtypeQt) {
+        data_vec_ct = DblCtToVecCt(raw_sample_ct);
+        data_byte_ct = raw_sample_ct * sizeof(double);
+      } else {
+        data_vec_ct = Int32CtToVecCt(raw_sample_ct);
+        data_byte_ct = raw_sample_ct * sizeof(int32_t);
+        catname_vec_ct = WordCtToVecCt(nonnull_category_ct + 1);
+        catname_storage_vec_ct = DivUp(catname_byte_ct, kBytesPerVec);
+      }
+      const uintptr_t alloc_vec_ct = nonmiss_vec_ct + data_vec_ct + catname_vec_ct + catname_storage_vec_ct;
+      uintptr_t* new_pheno_data_iter;
+      if (unlikely(vecaligned_malloc(alloc_vec_ct * kBytesPerVec, &new_pheno_data_iter))) {
+        goto LoadPhenoCache_ret_NOMEM;
+      }
+      ZeroWArr((nonmiss_vec_ct + data_vec_ct) * kWordsPerVec, new_pheno_data_iter);
+      pheno_cols_iter->nonmiss = new_pheno_data_iter;
+      pheno_cols_iter->category_names = nullptr;
+      pheno_cols_iter->type_code = S_CAST(PhenoDtype, type_code);
+      pheno_cols_iter->nonnull_category_ct = nonnull_category_ct;
+      memcpy(new_pheno_data_iter, read_iter, bitarr_byte_ct);
+      read_iter = &(read_iter[bitarr_byte_ct]);
+      new_pheno_data_iter = &(new_pheno_data_iter[nonmiss_vec_ct * kWordsPerVec]);
+      memcpy(new_pheno_data_iter, read_iter, data_byte_ct);
+      read_iter = &(read_iter[data_byte_ct]);
+      if (type_code == kPhenoDtypeCc) {
+        pheno_cols_iter->data.cc = new_pheno_data_iter;
+      } else if (type_code == kPhenoDtypeQt) {
+        pheno_cols_iter->data.qt = R_CAST(double*, new_pheno_data_iter);
+      } else {
+        pheno_cols_iter->data.cat = R_CAST(uint32_t*, new_pheno_data_iter);
+        new_pheno_data_iter = &(new_pheno_data_iter[data_vec_ct * kWordsPerVec]);
+        const char** cur_name_ptrs = R_CAST(const char**, new_pheno_data_iter);
+        pheno_cols_iter->category_names = cur_name_ptrs;
+        *cur_name_ptrs++ = g_missing_catname;
+        char* name_storage = R_CAST(char*, &(new_pheno_data_iter[catname_vec_ct * kWordsPerVec]));
+        memcpy(name_storage, read_iter, catname_byte_ct);
+        read_iter = &(read_iter[catname_byte_ct]);
+        for (uint32_t catname_idx = 0; catname_idx != nonnull_category_ct; ++catname_idx) {
+          *cur_name_ptrs++ = name_storage;
+          name_storage = strnul(name_storage);
+          ++name_storage;
+        }
+      }
+    }
+    free_cond(*pheno_names_ptr);
+    *pheno_names_ptr = pheno_names;
+    pheno_names = nullptr;
+    *max_pheno_name_blen_ptr = max_pheno_name_blen;
+  }
+  while (0) {
+  LoadPhenoCache_ret_NOMEM:
+    reterr = kPglRetNomem;
+    break;
+  LoadPhenoCache_ret_SKIPPED:
+    reterr = kPglRetSkipped;
+    break;
+  }
+ LoadPhenoCache_ret_1:
+  free_cond(pheno_names);
+  UnmapFileReadonly(base, byte_ct, is_mmapped);
+  return reterr;
+}
+
+BoolErr WritePhenoCache(const char* cache_fname, const PhenoCacheKey* keyp, const PhenoCol* new_pheno_cols, const char* new_pheno_names, uint32_t raw_sample_ct, uint32_t new_pheno_ct, uintptr_t max_pheno_name_blen) {
+  char tmp_fname[kPglFnamesize];
+  if (unlikely(TmpFnameInit(cache_fname, tmp_fname))) {
+    return 1;
+  }
+  FILE* outfile = fopen(tmp_fname, FOPEN_WB);
+  if (!outfile) {
+    return 1;
+  }
+  const uintptr_t bitarr_byte_ct = BitCtToWordCt(raw_sample_ct) * sizeof(intptr_t);
+  uint64_t names_byte_ct = 0;
+  for (uint32_t new_pheno_idx = 0; new_pheno_idx != new_pheno_ct; ++new_pheno_idx) {
+    names_byte_ct += strlen(&(new_pheno_names[new_pheno_idx * max_pheno_name_blen])) + 1;
+  }
+  unsigned char header[kPhenoCacheHeaderByteCt];
+  memset(header, 0, kPhenoCacheHeaderByteCt);
+  memcpy(header, "l\x1b\x42", 3);
+  header[3] = sizeof(intptr_t);
+  memcpy(&(header[4]), &new_pheno_ct, sizeof(int32_t));
+  memcpy(&(header[8]), &(keyp->src_byte_ct), sizeof(int64_t));
+  memcpy(&(header[16]), &(keyp->src_mtime), sizeof(int64_t));
+  memcpy(&(header[24]), &(keyp->settings_hash), sizeof(int64_t));
+  memcpy(&(header[32]), &names_byte_ct, sizeof(int64_t));
+  BoolErr write_err = fwrite_checked(header, kPhenoCacheHeaderByteCt, outfile);
+  for (uint32_t new_pheno_idx = 0; (!write_err) && (new_pheno_idx != new_pheno_ct); ++new_pheno_idx) {
+    const char* cur_name = &(new_pheno_names[new_pheno_idx * max_pheno_name_blen]);
+    write_err = fwrite_checked(cur_name, strlen(cur_name) + 1, outfile);
+  }
+  for (uint32_t new_pheno_idx = 0; (!write_err) && (new_pheno_idx != new_pheno_ct); ++new_pheno_idx) {
+    const PhenoCol* cur_pheno_col = &(new_pheno_cols[new_pheno_idx]);
+    const uint32_t type_code = cur_pheno_col->type_code;
+    const uint32_t nonnull_category_ct = cur_pheno_col->nonnull_category_ct;
+    const void* data_start;
+    uintptr_t data_byte_ct;
+    uint64_t catname_byte_ct = 0;
+    if (type_code == kPhenoDtypeCc) {
+      data_start = cur_pheno_col->data.cc;
+      data_byte_ct = bitarr_byte_ct;
+    } else if (type_code == kPhenoDtypeQt) {
+      data_start = cur_pheno_col->data.qt;
+      data_byte_ct = raw_sample_ct * sizeof(double);
+    } else {
+      data_start = cur_pheno_col->data.cat;
+      data_byte_ct = raw_sample_ct * sizeof(int32_t);
+      for (uint32_t catname_idx = 1; catname_idx <= nonnull_category_ct; ++catname_idx) {
+        catname_byte_ct += strlen(cur_pheno_col->category_names[catname_idx]) + 1;
+      }
+    }
+    unsigned char col_header[16];
+    memcpy(col_header, &type_code, sizeof(int32_t));
+    memcpy(&(col_header[4]), &nonnull_category_ct, sizeof(int32_t));
+    memcpy(&(col_header[8]), &catname_byte_ct, sizeof(int64_t));
+    write_err = fwrite_checked(col_header, 16, outfile) || fwrite_checked(cur_pheno_col->nonmiss, bitarr_byte_ct, outfile) || fwrite_checked(data_start, data_byte_ct, outfile);
+    for (uint32_t catname_idx = 1; (!write_err) && (catname_idx <= nonnull_category_ct); ++catname_idx) {
+      const char* cur_catname = cur_pheno_col->category_names[catname_idx];
+      write_err = fwrite_checked(cur_catname, strlen(cur_catname) + 1, outfile);
+    }
+  }
+  if (fclose_null(&outfile) || write_err || rename(tmp_fname, cache_fname)) {
+    fclose_cond(outfile);
+    remove(tmp_fname);
+    return 1;
+  }
+  return 0;
+}
 
 // also for loading covariates.  set affection_01 to 2 to prohibit case/control
 // and make unnamed variables start with "COVAR" instead of "PHENO"
-PglErr LoadPhenos(const char* pheno_fname, const RangeList* pheno_range_list_ptr, const uintptr_t* sample_include, const char* sample_ids, uint32_t raw_sample_ct, uint32_t sample_ct, uintptr_t max_sample_id_blen, int32_t missing_pheno, uint32_t affection_01, uint32_t iid_only, uint32_t numeric_ranges, uint32_t max_thread_ct, PhenoCol** pheno_cols_ptr, char** pheno_names_ptr, uint32_t* pheno_ct_ptr, uintptr_t* max_pheno_name_blen_ptr) {
+PglErr LoadPhenos(const char* pheno_fname, const RangeList* pheno_range_list_ptr, const uintptr_t* sample_include, const SampleIdInfo* siip, const XidIndex* xidxp, uint32_t raw_sample_ct, uint32_t sample_ct, int32_t missing_pheno, uint32_t affection_01, uint32_t iid_only, uint32_t numeric_ranges, uint32_t use_cache, uint32_t max_thread_ct, PhenoCol** pheno_cols_ptr, char** pheno_names_ptr, uint32_t* pheno_ct_ptr, uintptr_t* max_pheno_name_blen_ptr) {
   unsigned char* bigstack_mark = g_bigstack_base;
+  unsigned char* bigstack_end_mark = g_bigstack_end;
   char* pheno_names = nullptr;
   uintptr_t line_idx = 0;
   PglErr reterr = kPglRetSuccess;
   TextStream pheno_txs;
+  ThreadGroup tg;
   PreinitTextStream(&pheno_txs);
+  PreinitThreads(&tg);
+  LoadPhenosCtx ctx;
   {
     if (!sample_ct) {
       goto LoadPhenos_ret_1;
     }
+    PhenoCacheKey cache_key;
+    char cache_fname[kPglFnamesize];
+    cache_fname[0] = '\0';
+    if (use_cache && (!PhenoCacheKeyInit(pheno_fname, pheno_range_list_ptr, sample_include, siip, raw_sample_ct, *pheno_ct_ptr, missing_pheno, affection_01, iid_only, numeric_ranges, &cache_key))) {
+      const uint32_t fname_slen = strlen(pheno_fname);
+      if (fname_slen + 13 <= kPglFnamesize) {
+        snprintf(memcpya(cache_fname, pheno_fname, fname_slen), 13, "%s", (affection_01 == 2)? ".covar.cache" : ".pheno.cache");
+        reterr = LoadPhenoCache(cache_fname, &cache_key, raw_sample_ct, pheno_cols_ptr, pheno_names_ptr, pheno_ct_ptr, max_pheno_name_blen_ptr);
+        if (reterr != kPglRetSkipped) {
+          if (!reterr) {
+            logprintfww("--pheno-cache: Using %s .\n", cache_fname);
+          }
+          goto LoadPhenos_ret_1;
+        }
+        reterr = kPglRetSuccess;
+      }
+    }
     reterr = SizeAndInitTextStream(pheno_fname, bigstack_left() / 4, MAXV(max_thread_ct - 1, 1), &pheno_txs);
     if (unlikely(reterr)) {
       goto LoadPhenos_ret_TSTREAM_FAIL;
@@ -1077,29 +1612,10 @@ PglErr LoadPhenos(const char* pheno_fname, const RangeList* pheno_range_list_ptr
         *write_iter = '\0';
       }
     }
-    if (unlikely(final_pheno_ct > kMaxPhenoCt)) {
-      // yeah, yeah, this will never come up
-      logerrputs("Error: " PROG_NAME_STR " does not support more than " MAX_PHENO_CT_STR " phenotypes.\n");
-      goto LoadPhenos_ret_INCONSISTENT_INPUT;
-    }
-    for (uint32_t old_pheno_idx = 0; old_pheno_idx != old_pheno_ct; ++old_pheno_idx) {
-      strcpy(&(pheno_names[old_pheno_idx * max_pheno_name_blen]), &((*pheno_names_ptr)[old_pheno_idx * old_max_pheno_name_blen]));
-    }
-
-    uint32_t tmp_htable_size;
-    uint32_t* htable_tmp;
-    if (unlikely(HtableGoodSizeAlloc(final_pheno_ct, bigstack_left(), &htable_tmp, &tmp_htable_size))) {
-      goto LoadPhenos_ret_NOMEM;
-    }
-    // possible todo: implement something like --pheno-merge, allow conditional
-    // duplication in that case
-    const uint32_t duplicate_idx = PopulateStrboxHtable(pheno_names, final_pheno_ct, max_pheno_name_blen, tmp_htable_size, htable_tmp);
-    if (unlikely(duplicate_idx)) {
-      const char* duplicate_pheno_name = &(pheno_names[duplicate_idx * max_pheno_name_blen]);
-      snprintf(g_logbuf, kLogbufSize, "Error: Duplicate phenotype/covariate ID '%s'.\n", duplicate_pheno_name);
-      goto LoadPhenos_ret_MALFORMED_INPUT_WW;
+    reterr = FinalizePhenoNames(*pheno_names_ptr, old_pheno_ct, old_max_pheno_name_blen, final_pheno_ct, max_pheno_name_blen, pheno_names);
+    if (unlikely(reterr)) {
+      goto LoadPhenos_ret_1;
     }
-    BigstackReset(htable_tmp);
 
     PhenoCol* new_pheno_cols = S_CAST(PhenoCol*, realloc(*pheno_cols_ptr, final_pheno_ct * sizeof(PhenoCol)));
     if (unlikely(!new_pheno_cols)) {
@@ -1112,11 +1628,9 @@ PglErr LoadPhenos(const char* pheno_fname, const RangeList* pheno_range_list_ptr
     *pheno_ct_ptr = final_pheno_ct;
     *pheno_cols_ptr = new_pheno_cols;
 
-    // switch to hash table?
-    char* sorted_sample_ids;
-    uint32_t* sample_id_map;
     // todo: permit duplicates if SIDs are defined
-    reterr = CopySortStrboxSubset(sample_include, sample_ids, sample_ct, max_sample_id_blen, 0, 0, 0, &sorted_sample_ids, &sample_id_map);
+    XidHtable xid_htable;
+    reterr = XidHtableInitAlloc(sample_include, siip, xidxp, raw_sample_ct, sample_ct, 0, xid_mode, max_thread_ct, &xid_htable);
     if (unlikely(reterr)) {
       goto LoadPhenos_ret_1;
     }
@@ -1124,13 +1638,11 @@ PglErr LoadPhenos(const char* pheno_fname, const RangeList* pheno_range_list_ptr
     char* id_buf;
     uintptr_t* already_seen;
     if (unlikely(
-            bigstack_alloc_c(max_sample_id_blen, &id_buf) ||
+            bigstack_alloc_c(xid_htable.max_xid_blen, &id_buf) ||
             bigstack_calloc_w(raw_sample_ctl, &already_seen))) {
       goto LoadPhenos_ret_NOMEM;
     }
 
-    PhenoInfoLl* pheno_info_reverse_ll = nullptr;
-    const uint32_t pheno_info_alloc_byte_ct = sizeof(PhenoInfoLl) + new_pheno_ct * sizeof(double);
     const uint32_t new_pheno_ctl = BitCtToWordCt(new_pheno_ct);
     const double missing_phenod = missing_pheno? S_CAST(double, missing_pheno) : HUGE_VAL;
 
@@ -1152,113 +1664,298 @@ PglErr LoadPhenos(const char* pheno_fname, const RangeList* pheno_range_list_ptr
     const char* missing_catname = g_missing_catname;
     const uint32_t missing_catname_blen = strlen(missing_catname) + 1;
     const uint32_t missing_catname_hval = Hashceil(missing_catname, missing_catname_blen - 1, kCatHtableSize);
-    unsigned char* bigstack_base_copy = g_bigstack_base;
     unsigned char* tmp_bigstack_end = g_bigstack_end;
     CatnameLl2** catname_htable = nullptr;
     CatnameLl2** pheno_catname_last = nullptr;
     uintptr_t* total_catname_blens = nullptr;
-    for (; TextGetUnsafe2K(&pheno_txs, &line_iter); line_iter = AdvPastDelim(line_iter, '\n'), ++line_idx) {
+    uint32_t sample_uidx;
+    uint32_t cur_llidx;
+    for (; ; line_iter = AdvPastDelim(line_iter, '\n'), ++line_idx) {
+      if (!TextGetUnsafe2K(&pheno_txs, &line_iter)) {
+        if (unlikely(TextStreamErrcode2(&pheno_txs, &reterr))) {
+          goto LoadPhenos_ret_TSTREAM_FAIL;
+        }
+        if (line_idx == 1) {
+          snprintf(g_logbuf, kLogbufSize, "Error: %s is empty.\n", pheno_fname);
+          goto LoadPhenos_ret_MALFORMED_INPUT_WW;
+        }
+        // could make this a warning, and automatically delete phenotypes?
+        logerrprintf("Error: No entries in %s correspond to loaded sample IDs.\n", pheno_fname);
+        goto LoadPhenos_ret_INCONSISTENT_INPUT;
+      }
       if (unlikely(line_iter[0] == '#')) {
-        snprintf(g_logbuf, kLogbufSize, "Error: Line %" PRIuPTR " of %s starts with a '#'. (This is only permitted before the first nonheader line, and if a #FID/IID header line is present it must denote the end of the header block.)\n", line_idx, pheno_fname);
-        goto LoadPhenos_ret_MALFORMED_INPUT_WW;
+        goto LoadPhenos_ret_HASH_LINE;
       }
-      uint32_t sample_uidx;
-      if (SortedXidboxReadFind(sorted_sample_ids, sample_id_map, max_sample_id_blen, sample_ct, comma_delim, xid_mode, &line_iter, &sample_uidx, id_buf)) {
-        if (unlikely(!line_iter)) {
-          goto LoadPhenos_ret_MISSING_TOKENS;
-        }
-        continue;
+      if (!XidHtableReadFind(&xid_htable, comma_delim, xid_mode, &line_iter, &sample_uidx, &cur_llidx, id_buf)) {
+        break;
       }
-      if (unlikely(IsSet(already_seen, sample_uidx))) {
-        snprintf(g_logbuf, kLogbufSize, "Error: Duplicate sample ID in %s.\n", pheno_fname);
-        goto LoadPhenos_ret_MALFORMED_INPUT_WW;
+      if (unlikely(!line_iter)) {
+        goto LoadPhenos_ret_MISSING_TOKENS;
       }
-      SetBit(sample_uidx, already_seen);
+    }
+    // first relevant line, detect categorical phenotypes
+    SetBit(sample_uidx, already_seen);
+    {
+      const char* lex_end;
       if (!comma_delim) {
-        line_iter = TokenLexK(line_iter, col_types, col_skips, new_pheno_ct, token_ptrs, token_slens);
+        lex_end = TokenLexK(line_iter, col_types, col_skips, new_pheno_ct, token_ptrs, token_slens);
       } else {
-        line_iter = CsvLexK(line_iter, col_types, col_skips, new_pheno_ct, token_ptrs, token_slens);
+        lex_end = CsvLexK(line_iter, col_types, col_skips, new_pheno_ct, token_ptrs, token_slens);
       }
-      if (unlikely(!line_iter)) {
+      if (unlikely(!lex_end)) {
         goto LoadPhenos_ret_MISSING_TOKENS;
       }
-      if (!pheno_info_reverse_ll) {
-        // first relevant line, detect categorical phenotypes
-        for (uint32_t new_pheno_idx = 0; new_pheno_idx != new_pheno_ct; ++new_pheno_idx) {
-          if (IsCategoricalPhenostr(token_ptrs[new_pheno_idx])) {
-            SetBit(new_pheno_idx, categorical_phenos);
-          } else if (affection_01 == 2) {
-            SetBit(new_pheno_idx, quantitative_phenos);
-          }
-        }
-        categorical_pheno_ct = PopcountWords(categorical_phenos, new_pheno_ctl);
-        if (categorical_pheno_ct) {
-          // initialize hash table
-          const uint32_t cat_ul_byte_ct = categorical_pheno_ct * sizeof(intptr_t);
-          const uint32_t htable_byte_ct = kCatHtableSize * sizeof(uintptr_t);
-          const uintptr_t entry_byte_ct = RoundUpPow2(offsetof(CatnameLl2, str) + missing_catname_blen, sizeof(intptr_t));
+    }
+    for (uint32_t new_pheno_idx = 0; new_pheno_idx != new_pheno_ct; ++new_pheno_idx) {
+      if (IsCategoricalPhenostr(token_ptrs[new_pheno_idx])) {
+        SetBit(new_pheno_idx, categorical_phenos);
+      } else if (affection_01 == 2) {
+        SetBit(new_pheno_idx, quantitative_phenos);
+      }
+    }
+    categorical_pheno_ct = PopcountWords(categorical_phenos, new_pheno_ctl);
+    uint32_t* cat_pheno_new_idxs = nullptr;
+    if (categorical_pheno_ct) {
+      if (unlikely(bigstack_alloc_u32(categorical_pheno_ct, &cat_pheno_new_idxs))) {
+        goto LoadPhenos_ret_NOMEM;
+      }
+      uintptr_t new_pheno_idx_base = 0;
+      uintptr_t cur_bits = categorical_phenos[0];
+      for (uint32_t cat_pheno_idx = 0; cat_pheno_idx != categorical_pheno_ct; ++cat_pheno_idx) {
+        cat_pheno_new_idxs[cat_pheno_idx] = BitIter1(categorical_phenos, &new_pheno_idx_base, &cur_bits);
+      }
+      // initialize hash table
+      const uint32_t cat_ul_byte_ct = categorical_pheno_ct * sizeof(intptr_t);
+      const uint32_t htable_byte_ct = kCatHtableSize * sizeof(uintptr_t);
+      const uintptr_t entry_byte_ct = RoundUpPow2(offsetof(CatnameLl2, str) + missing_catname_blen, sizeof(intptr_t));
 
-          if (unlikely(S_CAST(uintptr_t, tmp_bigstack_end - bigstack_base_copy) < htable_byte_ct + categorical_pheno_ct * entry_byte_ct + 2 * cat_ul_byte_ct)) {
-            goto LoadPhenos_ret_NOMEM;
-          }
-          tmp_bigstack_end -= cat_ul_byte_ct;
-          total_catname_blens = R_CAST(uintptr_t*, tmp_bigstack_end);
-          tmp_bigstack_end -= cat_ul_byte_ct;
-          pheno_catname_last = R_CAST(CatnameLl2**, tmp_bigstack_end);
-          ZeroWArr(categorical_pheno_ct, total_catname_blens);
-          tmp_bigstack_end -= htable_byte_ct;
-          catname_htable = R_CAST(CatnameLl2**, tmp_bigstack_end);
-          ZeroPtrArr(kCatHtableSize, catname_htable);
-          uint32_t cur_hval = missing_catname_hval;
-          for (uint32_t cat_pheno_idx = 0; cat_pheno_idx != categorical_pheno_ct; ++cat_pheno_idx) {
-            tmp_bigstack_end -= entry_byte_ct;
-            CatnameLl2* new_entry = R_CAST(CatnameLl2*, tmp_bigstack_end);
-            pheno_catname_last[cat_pheno_idx] = new_entry;
-            new_entry->cat_idx = 0;
-            new_entry->htable_next = nullptr;
-            new_entry->pheno_next = nullptr;
-            memcpy(new_entry->str, missing_catname, missing_catname_blen);
-            catname_htable[cur_hval++] = new_entry;
-            if (cur_hval == kCatHtableSize) {
-              cur_hval = 0;
-            }
-          }
+      if (unlikely(S_CAST(uintptr_t, tmp_bigstack_end - g_bigstack_base) < htable_byte_ct + categorical_pheno_ct * entry_byte_ct + 2 * cat_ul_byte_ct)) {
+        goto LoadPhenos_ret_NOMEM;
+      }
+      tmp_bigstack_end -= cat_ul_byte_ct;
+      total_catname_blens = R_CAST(uintptr_t*, tmp_bigstack_end);
+      tmp_bigstack_end -= cat_ul_byte_ct;
+      pheno_catname_last = R_CAST(CatnameLl2**, tmp_bigstack_end);
+      ZeroWArr(categorical_pheno_ct, total_catname_blens);
+      tmp_bigstack_end -= htable_byte_ct;
+      catname_htable = R_CAST(CatnameLl2**, tmp_bigstack_end);
+      ZeroPtrArr(kCatHtableSize, catname_htable);
+      uint32_t cur_hval = missing_catname_hval;
+      for (uint32_t cat_pheno_idx = 0; cat_pheno_idx != categorical_pheno_ct; ++cat_pheno_idx) {
+        tmp_bigstack_end -= entry_byte_ct;
+        CatnameLl2* new_entry = R_CAST(CatnameLl2*, tmp_bigstack_end);
+        pheno_catname_last[cat_pheno_idx] = new_entry;
+        new_entry->cat_idx = 0;
+        new_entry->htable_next = nullptr;
+        new_entry->pheno_next = nullptr;
+        memcpy(new_entry->str, missing_catname, missing_catname_blen);
+        catname_htable[cur_hval++] = new_entry;
+        if (cur_hval == kCatHtableSize) {
+          cur_hval = 0;
         }
       }
-      if (unlikely(S_CAST(uintptr_t, tmp_bigstack_end - bigstack_base_copy) < pheno_info_alloc_byte_ct)) {
+    }
+
+    // Non-categorical values are written directly to double-precision
+    // columns; case/control columns are compacted at the end.
+    const uintptr_t nonmiss_vec_ct = BitCtToVecCt(raw_sample_ct);
+    PhenoCol* pheno_cols_iter = &(new_pheno_cols[old_pheno_ct]);
+    for (uint32_t new_pheno_idx = 0; new_pheno_idx != new_pheno_ct; ++new_pheno_idx) {
+      const uint32_t is_categorical = IsSet(categorical_phenos, new_pheno_idx);
+      const uintptr_t data_vec_ct = is_categorical? Int32CtToVecCt(raw_sample_ct) : DblCtToVecCt(raw_sample_ct);
+      uintptr_t* new_pheno_data_iter;
+      if (unlikely(vecaligned_malloc((nonmiss_vec_ct + data_vec_ct) * kBytesPerVec, &new_pheno_data_iter))) {
         goto LoadPhenos_ret_NOMEM;
       }
-      tmp_bigstack_end -= pheno_info_alloc_byte_ct;
+      pheno_cols_iter->nonmiss = new_pheno_data_iter;
+      pheno_cols_iter->category_names = nullptr;
+      pheno_cols_iter->nonnull_category_ct = 0;
+      // data is zeroed in the non-categorical case too, so that --pheno-cache
+      // files don't depend on uninitialized memory
+      ZeroWArr((nonmiss_vec_ct + data_vec_ct) * kWordsPerVec, new_pheno_data_iter);
+      new_pheno_data_iter = &(new_pheno_data_iter[nonmiss_vec_ct * kWordsPerVec]);
+      if (is_categorical) {
+        // allow nonmiss[] to be ignored in categorical case
+        pheno_cols_iter->type_code = kPhenoDtypeCat;
+        pheno_cols_iter->data.cat = R_CAST(uint32_t*, new_pheno_data_iter);
+      } else {
+        pheno_cols_iter->type_code = kPhenoDtypeQt;
+        pheno_cols_iter->data.qt = R_CAST(double*, new_pheno_data_iter);
+      }
+      ++pheno_cols_iter;
+    }
 
-      PhenoInfoLl* new_pheno_info = R_CAST(PhenoInfoLl*, tmp_bigstack_end);
-      new_pheno_info->next = pheno_info_reverse_ll;
-      new_pheno_info->sample_uidx = sample_uidx;
-      double* pheno_data = new_pheno_info->phenodata;
-      uint32_t cat_pheno_idx = 0;
-      for (uint32_t new_pheno_idx = 0; new_pheno_idx != new_pheno_ct; ++new_pheno_idx) {
-        const char* cur_phenostr = token_ptrs[new_pheno_idx];
-        double dxx;
-        const char* cur_phenostr_end = ScanadvDouble(cur_phenostr, &dxx);
-        if (!cur_phenostr_end) {
-          const uint32_t slen = token_slens[new_pheno_idx];
-          if (IsNanStr(cur_phenostr, slen)) {
-            // note that, in CSVs, empty string is interpreted as a missing
-            // non-categorical phenotype; explicit "NONE" is needed to denote
-            // a missing category
-            dxx = missing_phenod;
-          } else {
-            if (unlikely(!IsSet(categorical_phenos, new_pheno_idx))) {
-              assert(pheno_info_reverse_ll);
-              const uint32_t is_second_relevant_line = !(pheno_info_reverse_ll->next);
-              logerrprintfww("Error: '%s' entry on line %" PRIuPTR " of %s is categorical, while %s not.\n", &(pheno_names[(old_pheno_ct + new_pheno_idx) * max_pheno_name_blen]), line_idx, pheno_fname, is_second_relevant_line? "an earlier entry is" : "earlier entries are");
-              goto LoadPhenos_ret_INCOMPATIBLE_PHENOSTRS;
+    // Everything allocated from here on is released at the end of the
+    // function, so it's safe to hand the rest of the bottom of the stack to
+    // the batch buffers as long as the category-name entries can still grow
+    // downward from tmp_bigstack_end.
+    BigstackEndSet(tmp_bigstack_end);
+    const uint32_t calc_thread_ct = MAXV(1, MINV(max_thread_ct, DivUp(new_pheno_ct, 16)));
+    if (unlikely(
+            SetThreadCt0(calc_thread_ct - 1, &tg) ||
+            BIGSTACK_ALLOC_X(const char**, calc_thread_ct, &ctx.token_ptrs) ||
+            bigstack_alloc_u32p(calc_thread_ct, &ctx.token_slens) ||
+            bigstack_alloc_wp(calc_thread_ct, &ctx.quantitative_phenos) ||
+            BIGSTACK_ALLOC_X(LoadPhenosErr, calc_thread_ct, &ctx.errs))) {
+      goto LoadPhenos_ret_NOMEM;
+    }
+    ctx.token_ptrs[0] = token_ptrs;
+    ctx.token_slens[0] = token_slens;
+    ctx.quantitative_phenos[0] = quantitative_phenos;
+    for (uint32_t tidx = 1; tidx != calc_thread_ct; ++tidx) {
+      if (unlikely(
+              bigstack_alloc_kcp(new_pheno_ct, &(ctx.token_ptrs[tidx])) ||
+              bigstack_alloc_u32(new_pheno_ct, &(ctx.token_slens[tidx])) ||
+              bigstack_alloc_w(new_pheno_ctl, &(ctx.quantitative_phenos[tidx])))) {
+        goto LoadPhenos_ret_NOMEM;
+      }
+      memcpy(ctx.quantitative_phenos[tidx], quantitative_phenos, new_pheno_ctl * sizeof(intptr_t));
+    }
+    for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
+      ctx.errs[tidx].type = kLoadPhenosErrNone;
+    }
+    // Give the batch at most half of the remaining space, so the category
+    // name table has room to grow.
+    const uintptr_t batch_byte_budget = bigstack_left() / 2;
+    const uintptr_t line_meta_byte_ct = 2 * sizeof(intptr_t) + sizeof(int32_t) + categorical_pheno_ct * (sizeof(intptr_t) + sizeof(int32_t));
+    uint32_t line_cap = kLoadPhenosBatchLineCap;
+    if (line_cap * line_meta_byte_ct > batch_byte_budget / 2) {
+      line_cap = batch_byte_budget / (2 * line_meta_byte_ct);
+      if (unlikely(!line_cap)) {
+        goto LoadPhenos_ret_NOMEM;
+      }
+    }
+    uintptr_t* line_idxs;
+    char* batch_text;
+    if (unlikely(
+            bigstack_alloc_kcp(line_cap, &ctx.line_starts) ||
+            bigstack_alloc_u32(line_cap, &ctx.sample_uidxs) ||
+            bigstack_alloc_w(line_cap, &line_idxs) ||
+            bigstack_alloc_kcp(S_CAST(uintptr_t, line_cap) * categorical_pheno_ct, &ctx.cat_token_ptrs) ||
+            bigstack_alloc_u32(S_CAST(uintptr_t, line_cap) * categorical_pheno_ct, &ctx.cat_token_slens))) {
+      goto LoadPhenos_ret_NOMEM;
+    }
+    // TokenLexK() may read a full vector past the end of the last line.
+    const uintptr_t text_cap = RoundDownPow2(batch_byte_budget - line_cap * line_meta_byte_ct - 6 * kCacheline, kCacheline);
+    if (unlikely(bigstack_alloc_c(text_cap + kCacheline, &batch_text))) {
+      goto LoadPhenos_ret_NOMEM;
+    }
+    unsigned char* bigstack_base_copy = g_bigstack_base;
+    ctx.new_pheno_cols = &(new_pheno_cols[old_pheno_ct]);
+    ctx.col_types = col_types;
+    ctx.col_skips = col_skips;
+    ctx.categorical_phenos = categorical_phenos;
+    ctx.new_pheno_ct = new_pheno_ct;
+    ctx.categorical_pheno_ct = categorical_pheno_ct;
+    ctx.comma_delim = comma_delim;
+    ctx.missing_phenod = missing_phenod;
+    ctx.pheno_ctrld = pheno_ctrld;
+    ctx.pheno_cased = pheno_cased;
+    if (calc_thread_ct > 1) {
+      SetThreadFuncAndData(LoadPhenosThread, &ctx, &tg);
+    }
+
+    const char* line_end = AdvPastDelim(line_iter, '\n');
+    uint32_t line_ready = 1;
+    uint32_t is_eof = 0;
+    uintptr_t relevant_line_ct = 0;
+    LoadPhenosErrType read_err_type = kLoadPhenosErrNone;
+    do {
+      uint32_t line_ct = 0;
+      char* text_iter = batch_text;
+      const char* text_stop = &(batch_text[text_cap]);
+      while (1) {
+        if (!line_ready) {
+          if (!TextGetUnsafe2K(&pheno_txs, &line_iter)) {
+            if (unlikely(TextStreamErrcode2(&pheno_txs, &reterr))) {
+              read_err_type = kLoadPhenosErrTstream;
+            }
+            is_eof = 1;
+            break;
+          }
+          if (unlikely(line_iter[0] == '#')) {
+            read_err_type = kLoadPhenosErrHashLine;
+            break;
+          }
+          if (XidHtableReadFind(&xid_htable, comma_delim, xid_mode, &line_iter, &sample_uidx, &cur_llidx, id_buf)) {
+            if (unlikely(!line_iter)) {
+              read_err_type = kLoadPhenosErrMissingTokens;
+              break;
             }
-            uint32_t hashval;
-            hashval = Hashceil(cur_phenostr, slen, kCatHtableSize) + cat_pheno_idx;
+            line_iter = AdvPastDelim(line_iter, '\n');
+            ++line_idx;
+            continue;
+          }
+          if (unlikely(IsSet(already_seen, sample_uidx))) {
+            read_err_type = kLoadPhenosErrDuplicateId;
+            break;
+          }
+          SetBit(sample_uidx, already_seen);
+          line_end = AdvPastDelim(line_iter, '\n');
+          line_ready = 1;
+        }
+        const uintptr_t line_blen = line_end - line_iter;
+        if ((line_ct == line_cap) || (S_CAST(uintptr_t, text_stop - text_iter) < line_blen)) {
+          if (unlikely(!line_ct)) {
+            goto LoadPhenos_ret_NOMEM;
+          }
+          break;
+        }
+        ctx.line_starts[line_ct] = text_iter;
+        ctx.sample_uidxs[line_ct] = sample_uidx;
+        line_idxs[line_ct] = line_idx;
+        text_iter = memcpya(text_iter, line_iter, line_blen);
+        ++line_ct;
+        line_iter = line_end;
+        ++line_idx;
+        line_ready = 0;
+      }
+      if (line_ct) {
+        ctx.line_ct = line_ct;
+        if (calc_thread_ct > 1) {
+          if (unlikely(SpawnThreads(&tg))) {
+            goto LoadPhenos_ret_THREAD_CREATE_FAIL;
+          }
+        }
+        LoadPhenosProcessLines(0, calc_thread_ct, &ctx);
+        JoinThreads0(&tg);
+        // line ranges are assigned in thread order, so the lowest-index error
+        // is the earliest one
+        for (uint32_t tidx = 0; tidx != calc_thread_ct; ++tidx) {
+          const LoadPhenosErr* errp = &(ctx.errs[tidx]);
+          const LoadPhenosErrType err_type = errp->type;
+          if (err_type) {
+            line_idx = line_idxs[errp->line_bidx];
+            if (err_type == kLoadPhenosErrMissingTokens) {
+              goto LoadPhenos_ret_MISSING_TOKENS;
+            }
+            if (err_type == kLoadPhenosErrInvalidNumeric) {
+              snprintf(g_logbuf, kLogbufSize, "Error: Invalid numeric token '%s' on line %" PRIuPTR " of %s.\n", errp->token, line_idx, pheno_fname);
+              goto LoadPhenos_ret_MALFORMED_INPUT_WW;
+            }
+            const char* cur_pheno_name = &(pheno_names[(old_pheno_ct + errp->new_pheno_idx) * max_pheno_name_blen]);
+            const uint32_t is_second_relevant_line = (relevant_line_ct + errp->line_bidx == 1);
+            if (err_type == kLoadPhenosErrUnexpectedCategorical) {
+              logerrprintfww("Error: '%s' entry on line %" PRIuPTR " of %s is categorical, while %s not.\n", cur_pheno_name, line_idx, pheno_fname, is_second_relevant_line? "an earlier entry is" : "earlier entries are");
+            } else {
+              logerrprintfww("Error: '%s' entry on line %" PRIuPTR " of %s is numeric/'NA', while %s categorical.\n", cur_pheno_name, line_idx, pheno_fname, is_second_relevant_line? "an earlier entry is" : "earlier entries are");
+            }
+            goto LoadPhenos_ret_INCOMPATIBLE_PHENOSTRS;
+          }
+        }
+        // category indexes are assigned in order of first appearance
+        for (uint32_t line_bidx = 0; line_bidx != line_ct; ++line_bidx) {
+          const uint32_t cur_sample_uidx = ctx.sample_uidxs[line_bidx];
+          const char* const* cur_cat_token_ptrs = &(ctx.cat_token_ptrs[S_CAST(uintptr_t, line_bidx) * categorical_pheno_ct]);
+          const uint32_t* cur_cat_token_slens = &(ctx.cat_token_slens[S_CAST(uintptr_t, line_bidx) * categorical_pheno_ct]);
+          for (uint32_t cat_pheno_idx = 0; cat_pheno_idx != categorical_pheno_ct; ++cat_pheno_idx) {
+            const char* cur_phenostr = cur_cat_token_ptrs[cat_pheno_idx];
+            const uint32_t slen = cur_cat_token_slens[cat_pheno_idx];
+            uint32_t hashval = Hashceil(cur_phenostr, slen, kCatHtableSize) + cat_pheno_idx;
             if (hashval >= kCatHtableSize) {
               hashval -= kCatHtableSize;
             }
-            uintptr_t htable_idx = 0;
+            uint32_t htable_idx = 0;
             CatnameLl2** cur_entry_ptr = &(catname_htable[hashval]);
             while (1) {
               CatnameLl2* cur_entry = *cur_entry_ptr;
@@ -1287,152 +1984,121 @@ PglErr LoadPhenos(const char* pheno_fname, const RangeList* pheno_range_list_ptr
               }
               cur_entry_ptr = &(cur_entry->htable_next);
             }
-            // don't bother writing top 4 bytes in 32-bit build
-            memcpy(&(pheno_data[new_pheno_idx]), &htable_idx, sizeof(intptr_t));
-            ++cat_pheno_idx;
-            continue;
-          }
-        } else {
-          if (unlikely(!IsSpaceOrEoln(*cur_phenostr_end))) {
-            cur_phenostr_end = CurTokenEnd(cur_phenostr_end);
-            *K_CAST(char*, cur_phenostr_end) = '\0';
-            snprintf(g_logbuf, kLogbufSize, "Error: Invalid numeric token '%s' on line %" PRIuPTR " of %s.\n", cur_phenostr, line_idx, pheno_fname);
-            goto LoadPhenos_ret_MALFORMED_INPUT_WW;
+            if (htable_idx) {
+              PhenoCol* cur_pheno_col = &(new_pheno_cols[old_pheno_ct + cat_pheno_new_idxs[cat_pheno_idx]]);
+              cur_pheno_col->data.cat[cur_sample_uidx] = htable_idx;
+              SetBit(cur_sample_uidx, cur_pheno_col->nonmiss);
+            }
           }
         }
-        if (unlikely(IsSet(categorical_phenos, new_pheno_idx))) {
-          assert(pheno_info_reverse_ll);
-          const uint32_t is_second_relevant_line = !(pheno_info_reverse_ll->next);
-          logerrprintfww("Error: '%s' entry on line %" PRIuPTR " of %s is numeric/'NA', while %s categorical.\n", &(pheno_names[(old_pheno_ct + new_pheno_idx) * max_pheno_name_blen]), line_idx, pheno_fname, is_second_relevant_line? "an earlier entry is" : "earlier entries are");
-          goto LoadPhenos_ret_INCOMPATIBLE_PHENOSTRS;
-        }
-        if (!IsSet(quantitative_phenos, new_pheno_idx)) {
-          if ((dxx != missing_phenod) && (dxx != pheno_ctrld) && (dxx != pheno_cased) && (dxx != 0.0)) {
-            SetBit(new_pheno_idx, quantitative_phenos);
-          }
+        relevant_line_ct += line_ct;
+      }
+      if (read_err_type) {
+        switch (read_err_type) {
+        case kLoadPhenosErrTstream:
+          goto LoadPhenos_ret_TSTREAM_FAIL;
+        case kLoadPhenosErrHashLine:
+          goto LoadPhenos_ret_HASH_LINE;
+        case kLoadPhenosErrMissingTokens:
+          goto LoadPhenos_ret_MISSING_TOKENS;
+        default:
+          snprintf(g_logbuf, kLogbufSize, "Error: Duplicate sample ID in %s.\n", pheno_fname);
+          goto LoadPhenos_ret_MALFORMED_INPUT_WW;
         }
-        pheno_data[new_pheno_idx] = dxx;
       }
-      pheno_info_reverse_ll = new_pheno_info;
-    }
-    if (unlikely(TextStreamErrcode2(&pheno_txs, &reterr))) {
-      goto LoadPhenos_ret_TSTREAM_FAIL;
-    }
+    } while (!is_eof);
     reterr = kPglRetSuccess;
-    if (unlikely(!pheno_info_reverse_ll)) {
-      if (line_idx == 1) {
-        snprintf(g_logbuf, kLogbufSize, "Error: %s is empty.\n", pheno_fname);
-        goto LoadPhenos_ret_MALFORMED_INPUT_WW;
-      }
-      // could make this a warning, and automatically delete phenotypes?
-      logerrprintf("Error: No entries in %s correspond to loaded sample IDs.\n", pheno_fname);
-      goto LoadPhenos_ret_INCONSISTENT_INPUT;
+    for (uint32_t tidx = 1; tidx != calc_thread_ct; ++tidx) {
+      BitvecOr(ctx.quantitative_phenos[tidx], new_pheno_ctl, quantitative_phenos);
     }
-    if (new_pheno_ct) {
-      const uintptr_t nonmiss_vec_ct = BitCtToVecCt(raw_sample_ct);
-      uint32_t cat_pheno_idx = 0;
-      PhenoCol* pheno_cols_iter = &(new_pheno_cols[old_pheno_ct]);
-      for (uint32_t new_pheno_idx = 0; new_pheno_idx != new_pheno_ct; ++new_pheno_idx) {
-        const uint32_t is_categorical = IsSet(categorical_phenos, new_pheno_idx);
-        const uint32_t is_qt = IsSet(quantitative_phenos, new_pheno_idx);
-        uintptr_t data_vec_ct = 0;
-        uintptr_t catname_vec_ct = 0;
-        uintptr_t catname_storage_vec_ct = 0;
-        uint32_t nonnull_catname_ct = 0;
-        if (!is_categorical) {
-          pheno_cols_iter->category_names = nullptr;
-          pheno_cols_iter->type_code = S_CAST(PhenoDtype, is_qt);
-          pheno_cols_iter->nonnull_category_ct = 0;
-          if (is_qt) {
-            data_vec_ct = DblCtToVecCt(raw_sample_ct);
-          } else {
-            data_vec_ct = nonmiss_vec_ct;
-          }
-        } else {
-          nonnull_catname_ct = pheno_catname_last[cat_pheno_idx]->cat_idx;
-          data_vec_ct = Int32CtToVecCt(raw_sample_ct);
-          catname_vec_ct = WordCtToVecCt(nonnull_catname_ct + 1);
-          catname_storage_vec_ct = DivUp(total_catname_blens[cat_pheno_idx], kBytesPerVec);
-          pheno_cols_iter->type_code = kPhenoDtypeCat;
-          pheno_cols_iter->nonnull_category_ct = nonnull_catname_ct;
-        }
-        // pheno_cols_iter->nonmiss = nullptr;
+
+    uint32_t cat_pheno_idx = 0;
+    pheno_cols_iter = &(new_pheno_cols[old_pheno_ct]);
+    for (uint32_t new_pheno_idx = 0; new_pheno_idx != new_pheno_ct; ++new_pheno_idx, ++pheno_cols_iter) {
+      if (IsSet(categorical_phenos, new_pheno_idx)) {
+        // append the category names
+        const uint32_t nonnull_catname_ct = pheno_catname_last[cat_pheno_idx]->cat_idx;
+        const uintptr_t data_vec_ct = Int32CtToVecCt(raw_sample_ct);
+        const uintptr_t catname_vec_ct = WordCtToVecCt(nonnull_catname_ct + 1);
+        const uintptr_t catname_storage_vec_ct = DivUp(total_catname_blens[cat_pheno_idx], kBytesPerVec);
         uintptr_t* new_pheno_data_iter;
         if (unlikely(vecaligned_malloc((nonmiss_vec_ct + data_vec_ct + catname_vec_ct + catname_storage_vec_ct) * kBytesPerVec, &new_pheno_data_iter))) {
           goto LoadPhenos_ret_NOMEM;
         }
+        memcpy(new_pheno_data_iter, pheno_cols_iter->nonmiss, (nonmiss_vec_ct + data_vec_ct) * kBytesPerVec);
+        vecaligned_free(pheno_cols_iter->nonmiss);
         pheno_cols_iter->nonmiss = new_pheno_data_iter;
-        ZeroWArr(nonmiss_vec_ct * kWordsPerVec, new_pheno_data_iter);
+        pheno_cols_iter->nonnull_category_ct = nonnull_catname_ct;
         new_pheno_data_iter = &(new_pheno_data_iter[nonmiss_vec_ct * kWordsPerVec]);
-        if (is_categorical) {
-          // allow nonmiss[] to be ignored in categorical case
-          ZeroWArr(data_vec_ct, new_pheno_data_iter);
-          pheno_cols_iter->data.cat = R_CAST(uint32_t*, new_pheno_data_iter);
-          new_pheno_data_iter = &(new_pheno_data_iter[data_vec_ct * kWordsPerVec]);
-          const char** cur_name_ptrs = R_CAST(const char**, new_pheno_data_iter);
-          pheno_cols_iter->category_names = cur_name_ptrs;
-          *cur_name_ptrs++ = g_missing_catname;
-          char* name_storage_iter = R_CAST(char*, &(new_pheno_data_iter[catname_vec_ct * kWordsPerVec]));
-          uint32_t cur_hval = missing_catname_hval + cat_pheno_idx;
-          if (cur_hval >= kCatHtableSize) {
-            cur_hval -= kCatHtableSize;
-          }
-          // make this point to the "NONE" entry for the current phenotype,
-          // which starts the linked list
-          CatnameLl2* catname_entry_ptr = catname_htable[cur_hval];
+        pheno_cols_iter->data.cat = R_CAST(uint32_t*, new_pheno_data_iter);
+        new_pheno_data_iter = &(new_pheno_data_iter[data_vec_ct * kWordsPerVec]);
+        const char** cur_name_ptrs = R_CAST(const char**, new_pheno_data_iter);
+        pheno_cols_iter->category_names = cur_name_ptrs;
+        *cur_name_ptrs++ = g_missing_catname;
+        char* name_storage_iter = R_CAST(char*, &(new_pheno_data_iter[catname_vec_ct * kWordsPerVec]));
+        uint32_t cur_hval = missing_catname_hval + cat_pheno_idx;
+        if (cur_hval >= kCatHtableSize) {
+          cur_hval -= kCatHtableSize;
+        }
+        // make this point to the "NONE" entry for the current phenotype,
+        // which starts the linked list
+        CatnameLl2* catname_entry_ptr = catname_htable[cur_hval];
 
-          for (uint32_t catname_idx = 0; catname_idx != nonnull_catname_ct; ++catname_idx) {
-            catname_entry_ptr = catname_entry_ptr->pheno_next;
-            char* cur_name_start = name_storage_iter;
-            name_storage_iter = strcpyax(name_storage_iter, catname_entry_ptr->str, '\0');
-            *cur_name_ptrs++ = cur_name_start;
-          }
-          ++cat_pheno_idx;
-        } else if (!is_qt) {
-          pheno_cols_iter->data.cc = new_pheno_data_iter;
-          ZeroWArr(nonmiss_vec_ct * kWordsPerVec, new_pheno_data_iter);
-        } else {
-          pheno_cols_iter->data.qt = R_CAST(double*, new_pheno_data_iter);
+        for (uint32_t catname_idx = 0; catname_idx != nonnull_catname_ct; ++catname_idx) {
+          catname_entry_ptr = catname_entry_ptr->pheno_next;
+          char* cur_name_start = name_storage_iter;
+          name_storage_iter = strcpyax(name_storage_iter, catname_entry_ptr->str, '\0');
+          *cur_name_ptrs++ = cur_name_start;
         }
-        ++pheno_cols_iter;
+        ++cat_pheno_idx;
+        continue;
       }
-      while (pheno_info_reverse_ll) {
-        const uint32_t sample_uidx = pheno_info_reverse_ll->sample_uidx;
-        double* pheno_data = pheno_info_reverse_ll->phenodata;
-        pheno_cols_iter = &(new_pheno_cols[old_pheno_ct]);
-        for (uint32_t new_pheno_idx = 0; new_pheno_idx != new_pheno_ct; ++new_pheno_idx) {
-          if (IsSet(categorical_phenos, new_pheno_idx)) {
-            uint32_t cur_cat;
-            memcpy(&cur_cat, &(pheno_data[new_pheno_idx]), sizeof(int32_t));
-            pheno_cols_iter->data.cat[sample_uidx] = cur_cat;
-            if (cur_cat) {
-              SetBit(sample_uidx, pheno_cols_iter->nonmiss);
-            }
-          } else {
-            double dxx = pheno_data[new_pheno_idx];
-            // bugfix (6 May 2017): forgot to accept 0 as missing value for
-            // case/control
-            if (IsSet(quantitative_phenos, new_pheno_idx)) {
-              if (dxx != missing_phenod) {
-                SetBit(sample_uidx, pheno_cols_iter->nonmiss);
-                pheno_cols_iter->data.qt[sample_uidx] = dxx;
-              }
-            } else {
-              if (dxx == pheno_cased) {
-                SetBit(sample_uidx, pheno_cols_iter->data.cc);
-                SetBit(sample_uidx, pheno_cols_iter->nonmiss);
-              } else if (dxx == pheno_ctrld) {
-                SetBit(sample_uidx, pheno_cols_iter->nonmiss);
-              }
-            }
+      const double* pheno_qt = pheno_cols_iter->data.qt;
+      // bugfix (6 May 2017): forgot to accept 0 as missing value for
+      // case/control
+      uintptr_t sample_uidx_base = 0;
+      uintptr_t cur_bits = already_seen[0];
+      if (IsSet(quantitative_phenos, new_pheno_idx)) {
+        uintptr_t* nonmiss = pheno_cols_iter->nonmiss;
+        for (uintptr_t ulii = 0; ulii != relevant_line_ct; ++ulii) {
+          const uintptr_t cur_sample_uidx = BitIter1(already_seen, &sample_uidx_base, &cur_bits);
+          if (pheno_qt[cur_sample_uidx] != missing_phenod) {
+            SetBit(cur_sample_uidx, nonmiss);
           }
-          ++pheno_cols_iter;
         }
-        pheno_info_reverse_ll = pheno_info_reverse_ll->next;
+        continue;
       }
+      uintptr_t* new_pheno_data_iter;
+      if (unlikely(vecaligned_malloc(2 * nonmiss_vec_ct * kBytesPerVec, &new_pheno_data_iter))) {
+        goto LoadPhenos_ret_NOMEM;
+      }
+      ZeroWArr(2 * nonmiss_vec_ct * kWordsPerVec, new_pheno_data_iter);
+      uintptr_t* nonmiss = new_pheno_data_iter;
+      uintptr_t* pheno_cc = &(new_pheno_data_iter[nonmiss_vec_ct * kWordsPerVec]);
+      for (uintptr_t ulii = 0; ulii != relevant_line_ct; ++ulii) {
+        const uintptr_t cur_sample_uidx = BitIter1(already_seen, &sample_uidx_base, &cur_bits);
+        const double dxx = pheno_qt[cur_sample_uidx];
+        if (dxx == pheno_cased) {
+          SetBit(cur_sample_uidx, pheno_cc);
+          SetBit(cur_sample_uidx, nonmiss);
+        } else if (dxx == pheno_ctrld) {
+          SetBit(cur_sample_uidx, nonmiss);
+        }
+      }
+      vecaligned_free(pheno_cols_iter->nonmiss);
+      pheno_cols_iter->nonmiss = nonmiss;
+      pheno_cols_iter->type_code = kPhenoDtypeCc;
+      pheno_cols_iter->data.cc = pheno_cc;
     }
     *pheno_names_ptr = pheno_names;
     *max_pheno_name_blen_ptr = max_pheno_name_blen;
+    if (cache_fname[0]) {
+      if (WritePhenoCache(cache_fname, &cache_key, &(new_pheno_cols[old_pheno_ct]), &(pheno_names[old_pheno_ct * max_pheno_name_blen]), raw_sample_ct, new_pheno_ct, max_pheno_name_blen)) {
+        logerrprintfww("Warning: Failed to write %s .\n", cache_fname);
+      } else {
+        logprintfww("--pheno-cache: Cache written to %s .\n", cache_fname);
+      }
+    }
   }
   while (0) {
   LoadPhenos_ret_NOMEM:
@@ -1441,6 +2107,8 @@ PglErr LoadPhenos(const char* pheno_fname, const RangeList* pheno_range_list_ptr
   LoadPhenos_ret_TSTREAM_FAIL:
     TextStreamErrPrint(pheno_fname, &pheno_txs);
     break;
+  LoadPhenos_ret_HASH_LINE:
+    snprintf(g_logbuf, kLogbufSize, "Error: Line %" PRIuPTR " of %s starts with a '#'. (This is only permitted before the first nonheader line, and if a #FID/IID header line is present it must denote the end of the header block.)\n", line_idx, pheno_fname);
   LoadPhenos_ret_MALFORMED_INPUT_WW:
     WordWrapB(0);
   LoadPhenos_ret_MALFORMED_INPUT_2:
@@ -1463,10 +2131,14 @@ PglErr LoadPhenos(const char* pheno_fname, const RangeList* pheno_range_list_ptr
   LoadPhenos_ret_INCONSISTENT_INPUT:
     reterr = kPglRetInconsistentInput;
     break;
+  LoadPhenos_ret_THREAD_CREATE_FAIL:
+    reterr = kPglRetThreadCreateFail;
+    break;
   }
  LoadPhenos_ret_1:
+  CleanupThreads(&tg);
   CleanupTextStream2(pheno_fname, &pheno_txs, &reterr);
-  BigstackReset(bigstack_mark);
+  BigstackDoubleReset(bigstack_mark, bigstack_end_mark);
   if (reterr) {
     free_cond(pheno_names);
     if (*pheno_names_ptr) {
@@ -772,8 +772,67 @@ PglErr SplitPar(const uint32_t* variant_bps, UnsortedVar vpos_sortstatus, uint32
   return kPglRetSuccess;
 }
 
+// Called after TextGetUnsafe2() reports end-of-file on the current .pvar.
+// When there are more --pfile-list member .pvar files, this switches the
+// stream to the next one, skips its header, and returns 1 with *line_iterp
+// pointing to its first variant line.  Returns 0 when it's time to stop
+// iterating; *reterrp must be checked in that case.
+static uint32_t PvarMemberGetUnsafe2(const char* chrom_header, uint32_t chrom_header_slen, const char* const** next_pvarnames_ptr, const char** pvarname_ptr, uintptr_t* line_idx_ptr, TextStream* pvar_txsp, char** line_iterp, PglErr* reterrp) {
+  const char* const* next_pvarnames = *next_pvarnames_ptr;
+  if (!next_pvarnames) {
+    return 0;
+  }
+  while (*next_pvarnames) {
+    if (unlikely(TextStreamErrcode2(pvar_txsp, reterrp))) {
+      return 0;
+    }
+    const char* pvarname = *next_pvarnames++;
+    *next_pvarnames_ptr = next_pvarnames;
+    *pvarname_ptr = pvarname;
+    *reterrp = TextRetarget(pvarname, pvar_txsp);
+    if (unlikely(*reterrp)) {
+      return 0;
+    }
+    uintptr_t line_idx = 0;
+    char* line_iter = TextLineEnd(pvar_txsp);
+    uint32_t chrom_header_seen = 0;
+    while (1) {
+      ++line_idx;
+      if (!TextGetUnsafe2(pvar_txsp, &line_iter)) {
+        break;
+      }
+      if (*line_iter != '#') {
+        if (unlikely(chrom_header_slen && (!chrom_header_seen))) {
+          logerrprintfww("Error: %s has no #CHROM header line, unlike the first --pfile-list .pvar file.\n", pvarname);
+          *reterrp = kPglRetInconsistentInput;
+          return 0;
+        }
+        *line_iterp = line_iter;
+        *line_idx_ptr = line_idx;
+        return 1;
+      }
+      char* line_end = AdvToDelim(line_iter, '\n');
+      if (tokequal_k(line_iter, "#CHROM")) {
+        if (unlikely((S_CAST(uintptr_t, line_end - line_iter) != chrom_header_slen) || (!memequal(line_iter, chrom_header, chrom_header_slen)))) {
+          logerrprintfww("Error: #CHROM header line of %s does not match the first --pfile-list .pvar file's.\n", pvarname);
+          *reterrp = kPglRetInconsistentInput;
+          return 0;
+        }
+        chrom_header_seen = 1;
+      } else if (unlikely(chrom_header_seen)) {
+        logerrprintfww("Error: Line %" PRIuPTR " of %s starts with a '#'. (This is only permitted before the first nonheader line, and if a #CHROM header line is present it must denote the end of the header block.)\n", line_idx, pvarname);
+        *reterrp = kPglRetMalformedInput;
+        return 0;
+      }
+      line_iter = &(line_end[1]);
+    }
+    // no variants in this member; keep going
+  }
+  return 0;
+}
+
 static_assert((!(kMaxIdSlen % kCacheline)), "LoadPvar() must be updated.");
-PglErr LoadPvar(const char* pvarname, const char* var_filter_exceptions_flattened, const char* varid_template_str, const char* varid_multi_template_str, const char* varid_multi_nonsnp_template_str, const char* missing_varid_match, const char* require_info_flattened, const char* require_no_info_flattened, const CmpExpr* extract_if_info_exprp, const CmpExpr* exclude_if_info_exprp, MiscFlags misc_flags, PvarPsamFlags pvar_psam_flags, uint32_t xheader_needed, uint32_t qualfilter_needed, float var_min_qual, uint32_t splitpar_bound1, uint32_t splitpar_bound2, uint32_t new_variant_id_max_allele_slen, uint32_t snps_only, uint32_t split_chr_ok, uint32_t filter_min_allele_ct, uint32_t filter_max_allele_ct, uint32_t max_thread_ct, ChrInfo* cip, uint32_t* max_variant_id_slen_ptr, uint32_t* info_reload_slen_ptr, UnsortedVar* vpos_sortstatus_ptr, char** xheader_ptr, uintptr_t** variant_include_ptr, uint32_t** variant_bps_ptr, char*** variant_ids_ptr, uintptr_t** allele_idx_offsets_ptr, const char*** allele_storage_ptr, uintptr_t** qual_present_ptr, float** quals_ptr, uintptr_t** filter_present_ptr, uintptr_t** filter_npass_ptr, char*** filter_storage_ptr, uintptr_t** nonref_flags_ptr, double** variant_cms_ptr, ChrIdx** chr_idxs_ptr, uint32_t* raw_variant_ct_ptr, uint32_t* variant_ct_ptr, uint32_t* max_allele_ct_ptr, uint32_t* max_allele_slen_ptr, uintptr_t* xheader_blen_ptr, InfoFlags* info_flags_ptr, uint32_t* max_filter_slen_ptr) {
+PglErr LoadPvar(const char* pvarname, const char* const* next_pvarnames, const char* var_filter_exceptions_flattened, const char* varid_template_str, const char* varid_multi_template_str, const char* varid_multi_nonsnp_template_str, const char* missing_varid_match, const char* require_info_flattened, const char* require_no_info_flattened, const CmpExpr* extract_if_info_exprp, const CmpExpr* exclude_if_info_exprp, MiscFlags misc_flags, PvarPsamFlags pvar_psam_flags, uint32_t xheader_needed, uint32_t qualfilter_needed, float var_min_qual, uint32_t splitpar_bound1, uint32_t splitpar_bound2, uint32_t new_variant_id_max_allele_slen, uint32_t snps_only, uint32_t split_chr_ok, uint32_t filter_min_allele_ct, uint32_t filter_max_allele_ct, uint32_t max_thread_ct, ChrInfo* cip, uint32_t* max_variant_id_slen_ptr, uint32_t* info_reload_slen_ptr, UnsortedVar* vpos_sortstatus_ptr, char** xheader_ptr, uintptr_t** variant_include_ptr, uint32_t** variant_bps_ptr, char*** variant_ids_ptr, uintptr_t** allele_idx_offsets_ptr, const char*** allele_storage_ptr, uintptr_t** qual_present_ptr, float** quals_ptr, uintptr_t** filter_present_ptr, uintptr_t** filter_npass_ptr, char*** filter_storage_ptr, uintptr_t** nonref_flags_ptr, double** variant_cms_ptr, ChrIdx** chr_idxs_ptr, uint32_t* raw_variant_ct_ptr, uint32_t* variant_ct_ptr, uint32_t* max_allele_ct_ptr, uint32_t* max_allele_slen_ptr, uintptr_t* xheader_blen_ptr, InfoFlags* info_flags_ptr, uint32_t* max_filter_slen_ptr) {
   // chr_info, max_variant_id_slen, and info_reload_slen are in/out; just
   // outparameters after them.  (Due to its large size in some VCFs, INFO is
   // not kept in memory for now.  This has a speed penalty, of course; maybe
@@ -820,13 +879,9 @@ PglErr LoadPvar(const char* pvarname, const char* var_filter_exceptions_flattene
     // we're limited to 134M variants
     unsigned char* rlstream_start = &(bigstack_mark[quarter_left]);
     g_bigstack_base = rlstream_start;
-    uint32_t decompress_thread_ct = max_thread_ct - 1;
-    // 3 still seems best on a heavily multicore Linux test machine
-    if (decompress_thread_ct > 3) {
-      decompress_thread_ct = 3;
-    } else if (!decompress_thread_ct) {
-      decompress_thread_ct = 1;
-    }
+    // The BGZF reader stops handing work to decompressor threads that are
+    // outpacing this loop, so there's little cost to offering it more.
+    const uint32_t decompress_thread_ct = ClipU32(max_thread_ct - 1, 1, kMaxBgzfDecompressThreads);
     reterr = InitTextStream(pvarname, max_line_blen, decompress_thread_ct, &pvar_txs);
     if (unlikely(reterr)) {
       goto LoadPvar_ret_TSTREAM_FAIL;
@@ -926,7 +981,9 @@ PglErr LoadPvar(const char* pvarname, const char* var_filter_exceptions_flattene
     uint32_t load_filter_col = 0;
     uint32_t info_col_present = 0;
     uint32_t cm_col_present = 0;
+    const char* chrom_header_start = nullptr;
     if (line_start[0] == '#') {
+      chrom_header_start = line_start;
       *info_flags_ptr = S_CAST(InfoFlags, (info_pr_present * kfInfoPrFlagPresent) | (info_pr_nonflag_present * kfInfoPrNonflagPresent) | (info_nonpr_present * kfInfoNonprPresent));
       // parse header
       // [-1] = #CHROM (must be first column)
@@ -1101,6 +1158,20 @@ PglErr LoadPvar(const char* pvarname, const char* var_filter_exceptions_flattene
     // bugfix (2 Jun 2017): forgot to zero-initialize loaded_chr_mask
     ZeroWArr(kChrMaskWords, loaded_chr_mask);
 
+    // With --pfile-list, every later .pvar must have the same #CHROM line.
+    // Save a copy, since it'll be overwritten by the time we need it.
+    char* chrom_header = nullptr;
+    uint32_t chrom_header_slen = 0;
+    if (next_pvarnames && chrom_header_start) {
+      chrom_header_slen = line_start - chrom_header_start;
+      if (unlikely(S_CAST(uintptr_t, tmp_alloc_end - tmp_alloc_base) < RoundUpPow2(chrom_header_slen, kCacheline))) {
+        goto LoadPvar_ret_NOMEM;
+      }
+      chrom_header = R_CAST(char*, tmp_alloc_base);
+      memcpy(chrom_header, chrom_header_start, chrom_header_slen);
+      tmp_alloc_base = &(tmp_alloc_base[RoundUpPow2(chrom_header_slen, kCacheline)]);
+    }
+
     InfoExist* info_existp = nullptr;
     if (require_info_flattened) {
       reterr = InfoExistInit(tmp_alloc_end, require_info_flattened, "require-info", &tmp_alloc_base, &info_existp);
@@ -1282,7 +1353,8 @@ PglErr LoadPvar(const char* pvarname, const char* var_filter_exceptions_flattene
     } else {
       line_iter = line_start;
     }
-    for (; TextGetUnsafe2(&pvar_txs, &line_iter); ++line_iter, ++line_idx) {
+    PglErr member_reterr = kPglRetSuccess;
+    for (; TextGetUnsafe2(&pvar_txs, &line_iter) || PvarMemberGetUnsafe2(chrom_header, chrom_header_slen, &next_pvarnames, &pvarname, &line_idx, &pvar_txs, &line_iter, &member_reterr); ++line_iter, ++line_idx) {
       if (unlikely(line_iter[0] == '#')) {
         snprintf(g_logbuf, kLogbufSize, "Error: Line %" PRIuPTR " of %s starts with a '#'. (This is only permitted before the first nonheader line, and if a #CHROM header line is present it must denote the end of the header block.)\n", line_idx, pvarname);
         goto LoadPvar_ret_MALFORMED_INPUT_WW;
@@ -1775,6 +1847,13 @@ PglErr LoadPvar(const char* pvarname, const char* var_filter_exceptions_flattene
       }
       ++raw_variant_ct;
     }
+    if (unlikely(member_reterr)) {
+      reterr = member_reterr;
+      if (TextStreamErrcode(&pvar_txs)) {
+        goto LoadPvar_ret_TSTREAM_FAIL;
+      }
+      goto LoadPvar_ret_1;
+    }
     if (unlikely(TextStreamErrcode2(&pvar_txs, &reterr))) {
       goto LoadPvar_ret_TSTREAM_FAIL;
     }
@@ -2095,6 +2174,185 @@ PglErr LoadPvar(const char* pvarname, const char* var_filter_exceptions_flattene
   return reterr;
 }
 
+CONSTI32(kPsamCmpBlen, 65536);
+
+PglErr LoadPfileList(const char* list_fname, uint32_t pvar_zst, char* psamname, char* pvarname, uint32_t* member_ct_ptr, const char*** pgen_fnames_ptr, const char*** pvar_fnames_ptr) {
+  unsigned char* bigstack_mark = g_bigstack_base;
+  FILE* psam0_file = nullptr;
+  FILE* psam_file = nullptr;
+  const char* cur_psamname = nullptr;
+  uintptr_t line_idx = 0;
+  PglErr reterr = kPglRetSuccess;
+  textFILE list_txf;
+  PreinitTextFile(&list_txf);
+  {
+    reterr = TextFileOpen(list_fname, &list_txf);
+    if (unlikely(reterr)) {
+      goto LoadPfileList_ret_TFILE_FAIL;
+    }
+    // Fileset prefixes are flattened onto the bigstack first, since we don't
+    // know member_ct yet.
+    char* prefixes_start = R_CAST(char*, g_bigstack_base);
+    char* prefixes_end = prefixes_start;
+    const char* prefixes_limit = R_CAST(char*, g_bigstack_end);
+    uint32_t member_ct = 0;
+    while (1) {
+      ++line_idx;
+      char* line_start = TextFileGet(&list_txf);
+      if (!line_start) {
+        break;
+      }
+      const char* prefix_end = CurTokenEnd(line_start);
+      if (unlikely(!IsEolnKns(*FirstNonTspace(prefix_end)))) {
+        snprintf(g_logbuf, kLogbufSize, "Error: Line %" PRIuPTR " of %s has more than one token.\n", line_idx, list_fname);
+        goto LoadPfileList_ret_MALFORMED_INPUT_WW;
+      }
+      const uint32_t prefix_slen = prefix_end - line_start;
+      // leave room for ".pvar.zst"
+      if (unlikely(prefix_slen > (kPglFnamesize - 11))) {
+        snprintf(g_logbuf, kLogbufSize, "Error: Fileset prefix on line %" PRIuPTR " of %s is too long.\n", line_idx, list_fname);
+        goto LoadPfileList_ret_MALFORMED_INPUT_WW;
+      }
+      if (unlikely(S_CAST(uintptr_t, prefixes_limit - prefixes_end) <= prefix_slen)) {
+        goto LoadPfileList_ret_NOMEM;
+      }
+      prefixes_end = memcpyax(prefixes_end, line_start, prefix_slen, '\0');
+      ++member_ct;
+    }
+    if (unlikely(TextFileErrcode2(&list_txf, &reterr))) {
+      goto LoadPfileList_ret_TFILE_FAIL;
+    }
+    if (unlikely(CleanupTextFile(&list_txf, &reterr))) {
+      logerrprintfww(kErrprintfFread, list_fname, strerror(errno));
+      goto LoadPfileList_ret_1;
+    }
+    if (unlikely(!member_ct)) {
+      logerrprintfww("Error: %s is empty.\n", list_fname);
+      goto LoadPfileList_ret_INCONSISTENT_INPUT;
+    }
+    BigstackBaseSet(prefixes_end);
+    const char** pgen_fnames;
+    const char** pvar_fnames;
+    if (unlikely(
+            bigstack_alloc_kcp(member_ct, &pgen_fnames) ||
+            bigstack_alloc_kcp(member_ct + 1, &pvar_fnames))) {
+      goto LoadPfileList_ret_NOMEM;
+    }
+    const char* prefix_iter = prefixes_start;
+    for (uint32_t member_idx = 0; member_idx != member_ct; ++member_idx) {
+      const uint32_t prefix_slen = strlen(prefix_iter);
+      char* fname_iter;
+      if (unlikely(bigstack_alloc_c(2 * prefix_slen + 16, &fname_iter))) {
+        goto LoadPfileList_ret_NOMEM;
+      }
+      pgen_fnames[member_idx] = fname_iter;
+      fname_iter = memcpya(fname_iter, prefix_iter, prefix_slen);
+      fname_iter = strcpya_k(fname_iter, ".pgen");
+      *fname_iter++ = '\0';
+      pvar_fnames[member_idx] = fname_iter;
+      fname_iter = memcpya(fname_iter, prefix_iter, prefix_slen);
+      fname_iter = strcpya_k(fname_iter, ".pvar");
+      if (pvar_zst) {
+        fname_iter = strcpya_k(fname_iter, ".zst");
+      }
+      *fname_iter = '\0';
+      prefix_iter = &(prefix_iter[prefix_slen + 1]);
+    }
+    pvar_fnames[member_ct] = nullptr;
+    snprintf(memcpya(psamname, prefixes_start, strlen(prefixes_start)), 6, ".psam");
+    strcpy(pvarname, pvar_fnames[0]);
+
+    // Sample data is only loaded from the first member, so we insist on
+    // byte-identical .psam files.
+    if (member_ct > 1) {
+      unsigned char* bigstack_mark2 = g_bigstack_base;
+      char* psamname_buf;
+      unsigned char* psam0_buf;
+      unsigned char* psam_buf;
+      if (unlikely(
+              bigstack_alloc_c(kPglFnamesize, &psamname_buf) ||
+              bigstack_alloc_uc(kPsamCmpBlen, &psam0_buf) ||
+              bigstack_alloc_uc(kPsamCmpBlen, &psam_buf))) {
+        goto LoadPfileList_ret_NOMEM;
+      }
+      cur_psamname = psamname;
+      if (unlikely(fopen_checked(psamname, FOPEN_RB, &psam0_file))) {
+        goto LoadPfileList_ret_OPEN_FAIL;
+      }
+      prefix_iter = prefixes_start;
+      for (uint32_t member_idx = 1; member_idx != member_ct; ++member_idx) {
+        prefix_iter = &(prefix_iter[strlen(prefix_iter) + 1]);
+        snprintf(memcpya(psamname_buf, prefix_iter, strlen(prefix_iter)), 6, ".psam");
+        cur_psamname = psamname_buf;
+        if (unlikely(fopen_checked(psamname_buf, FOPEN_RB, &psam_file))) {
+          goto LoadPfileList_ret_OPEN_FAIL;
+        }
+        rewind(psam0_file);
+        while (1) {
+          const uintptr_t psam0_blen = fread_unlocked(psam0_buf, 1, kPsamCmpBlen, psam0_file);
+          if (unlikely(ferror_unlocked(psam0_file))) {
+            cur_psamname = psamname;
+            goto LoadPfileList_ret_READ_FAIL;
+          }
+          const uintptr_t cur_blen = fread_unlocked(psam_buf, 1, kPsamCmpBlen, psam_file);
+          if (unlikely(ferror_unlocked(psam_file))) {
+            goto LoadPfileList_ret_READ_FAIL;
+          }
+          if (unlikely((cur_blen != psam0_blen) || (!memequal(psam_buf, psam0_buf, cur_blen)))) {
+            logerrprintfww("Error: %s does not match %s. (All --pfile-list filesets must have identical .psam files.)\n", psamname_buf, psamname);
+            goto LoadPfileList_ret_INCONSISTENT_INPUT;
+          }
+          if (cur_blen < kPsamCmpBlen) {
+            break;
+          }
+        }
+        if (unlikely(fclose_null(&psam_file))) {
+          goto LoadPfileList_ret_READ_FAIL;
+        }
+      }
+      if (unlikely(fclose_null(&psam0_file))) {
+        cur_psamname = psamname;
+        goto LoadPfileList_ret_READ_FAIL;
+      }
+      BigstackReset(bigstack_mark2);
+    }
+    *member_ct_ptr = member_ct;
+    *pgen_fnames_ptr = pgen_fnames;
+    *pvar_fnames_ptr = pvar_fnames;
+  }
+  while (0) {
+  LoadPfileList_ret_NOMEM:
+    reterr = kPglRetNomem;
+    break;
+  LoadPfileList_ret_OPEN_FAIL:
+    reterr = kPglRetOpenFail;
+    break;
+  LoadPfileList_ret_READ_FAIL:
+    logerrprintfww(kErrprintfFread, cur_psamname, rstrerror(errno));
+    reterr = kPglRetReadFail;
+    break;
+  LoadPfileList_ret_TFILE_FAIL:
+    TextFileErrPrint(list_fname, &list_txf);
+    break;
+  LoadPfileList_ret_MALFORMED_INPUT_WW:
+    WordWrapB(0);
+    logerrputsb();
+    reterr = kPglRetMalformedInput;
+    break;
+  LoadPfileList_ret_INCONSISTENT_INPUT:
+    reterr = kPglRetInconsistentInput;
+    break;
+  }
+ LoadPfileList_ret_1:
+  CleanupTextFile(&list_txf, nullptr);
+  fclose_cond(psam0_file);
+  fclose_cond(psam_file);
+  if (reterr) {
+    BigstackReset(bigstack_mark);
+  }
+  return reterr;
+}
+
 #ifdef __cplusplus
 }  // namespace plink2
 #endif
@@ -0,0 +1,149 @@
+// This file is part of PLINK 2.00, copyright (C) 2005-2020 Shaun Purcell,
+// Christopher Chang.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "plink2_simd.h"
+#include "include/plink2_bits.h"
+#include "plink2_simd_kernels.h"
+
+namespace plink2 {
+
+SimdKernels g_simd_kernels = {IncrKing, IncrKingHomhom, IncrKingSubset, IncrKingSubsetHomhom, DotprodWords, SumSsqWords, SumSsqNmWords, IncrDblMissing};
+
+#ifdef USE_AVX2
+static const SimdTier kSimdTierBaseline = kSimdTierAvx2;
+#elif defined(USE_SSE42)
+static const SimdTier kSimdTierBaseline = kSimdTierSse42;
+#else
+static const SimdTier kSimdTierBaseline = kSimdTierGeneric;
+#endif
+
+#if defined(__LP64__) && !defined(NO_SIMD_DISPATCH)
+// See plink2_cpu.cc.
+#  if defined(__i386__) && defined(__PIC__)
+#    define EBX_CONSTRAINT "=r"
+#  else
+#    define EBX_CONSTRAINT "=b"
+#  endif
+
+static inline void Cpuid(uint32_t leaf, uint32_t subleaf, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d) {
+  __asm__(".ifnc %%ebx, %1; mov  %%ebx, %1; .endif\n"
+          "cpuid                                  \n"
+          ".ifnc %%ebx, %1; xchg %%ebx, %1; .endif\n"
+          : "=a" (*a), EBX_CONSTRAINT (*b), "=c" (*c), "=d" (*d)
+          : "a" (leaf), "c" (subleaf));
+}
+
+static inline uint64_t ReadXcr(uint32_t index) {
+  uint32_t edx;
+  uint32_t eax;
+  __asm__ (".byte 0x0f, 0x01, 0xd0" : "=d" (edx), "=a" (eax) : "c" (index));
+  return (S_CAST(uint64_t, edx) << 32) | eax;
+}
+
+static SimdTier DetectCpuSimdTier() {
+  uint32_t max_function;
+  uint32_t dummy1;
+  uint32_t dummy2;
+  uint32_t dummy3;
+  Cpuid(0, 0, &max_function, &dummy1, &dummy2, &dummy3);
+  if (max_function < 1) {
+    return kSimdTierGeneric;
+  }
+  uint32_t features_2;
+  Cpuid(1, 0, &dummy1, &dummy2, &features_2, &dummy3);
+  // bit 20 = SSE4.2, bit 23 = POPCNT
+  if ((features_2 & 0x900000) != 0x900000) {
+    return kSimdTierGeneric;
+  }
+  // bit 27 = OSXSAVE, bit 28 = AVX; OS must save ymm registers
+  if (((features_2 & 0x18000000) != 0x18000000) || (max_function < 7) || ((ReadXcr(0) & 6) != 6)) {
+    return kSimdTierSse42;
+  }
+  uint32_t features_3;
+  uint32_t features_4;
+  Cpuid(7, 0, &dummy1, &features_3, &features_4, &dummy3);
+  uint32_t ext_max_function;
+  Cpuid(0x80000000U, 0, &ext_max_function, &dummy1, &dummy2, &dummy3);
+  uint32_t ext_features_2 = 0;
+  if (ext_max_function >= 0x80000001U) {
+    Cpuid(0x80000001U, 0, &dummy1, &dummy2, &ext_features_2, &dummy3);
+  }
+  // BMI = bit 3, AVX2 = bit 5, BMI2 = bit 8; LZCNT = extended bit 5
+  if (((features_3 & 0x128) != 0x128) || (!(ext_features_2 & 0x20))) {
+    return kSimdTierSse42;
+  }
+  // AVX512F = bit 16, AVX512BW = bit 30, AVX512_VPOPCNTDQ = ecx bit 14; OS
+  // must also save opmask and zmm registers
+  if (((features_3 & 0x40010000) != 0x40010000) || (!(features_4 & 0x4000)) || ((ReadXcr(0) & 0xe6) != 0xe6)) {
+    return kSimdTierAvx2;
+  }
+  return kSimdTierAvx512;
+}
+#endif
+
+SimdTier DetectSimdTier() {
+#if defined(__LP64__) && !defined(NO_SIMD_DISPATCH)
+  const SimdTier cpu_tier = DetectCpuSimdTier();
+  return (cpu_tier > kSimdTierBaseline)? cpu_tier : kSimdTierBaseline;
+#else
+  return kSimdTierBaseline;
+#endif
+}
+
+void InitSimdKernels(SimdTier tier, SimdKernels* kernels_ptr) {
+#if defined(__LP64__) && !defined(NO_SIMD_DISPATCH)
+  if (tier > kSimdTierBaseline) {
+    if (tier == kSimdTierAvx512) {
+      InitSimdKernelsAvx512(kernels_ptr);
+    } else if (tier == kSimdTierAvx2) {
+      InitSimdKernelsAvx2(kernels_ptr);
+    } else {
+      InitSimdKernelsSse42(kernels_ptr);
+    }
+    return;
+  }
+#endif
+  kernels_ptr->incr_king = IncrKing;
+  kernels_ptr->incr_king_homhom = IncrKingHomhom;
+  kernels_ptr->incr_king_subset = IncrKingSubset;
+  kernels_ptr->incr_king_subset_homhom = IncrKingSubsetHomhom;
+  kernels_ptr->dotprod_words = DotprodWords;
+  kernels_ptr->sum_ssq_words = SumSsqWords;
+  kernels_ptr->sum_ssq_nm_words = SumSsqNmWords;
+  kernels_ptr->incr_dbl_missing = IncrDblMissing;
+}
+
+SimdTier InitSimdDispatch() {
+  const SimdTier tier = DetectSimdTier();
+  InitSimdKernels(tier, &g_simd_kernels);
+  return tier;
+}
+
+const char* SimdTierName(SimdTier tier) {
+  switch (tier) {
+  case kSimdTierSse42:
+    return "SSE4.2";
+  case kSimdTierAvx2:
+    return "AVX2";
+  case kSimdTierAvx512:
+    return "AVX-512";
+  default:
+    return "generic";
+  }
+}
+
+}  // namespace plink2
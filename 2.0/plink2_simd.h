@@ -0,0 +1,104 @@
+#ifndef __PLINK2_SIMD_H__
+#define __PLINK2_SIMD_H__
+
+// This file is part of PLINK 2.00, copyright (C) 2005-2020 Shaun Purcell,
+// Christopher Chang.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// Runtime CPU dispatch for the hottest popcount kernels (KING-robust and LD
+// r^2).  Everything else is compiled for the instruction set selected at
+// build time; these kernels are additionally compiled for each higher tier
+// (plink2_simd_{sse42,avx2,avx512}.cc), and InitSimdDispatch() points
+// g_simd_kernels at the best tier the current processor supports.
+//
+// This header must not depend on plink2_base.h, since the tier translation
+// units include it before pulling in plink2_base.h under a renamed namespace.
+
+#include <stdint.h>
+
+// Number of variants per KING-robust block.  Must be a multiple of
+// 3 * (bits per vector) for every tier, including AVX-512.
+#if defined(__LP64__) || defined(_WIN64)
+#  define PLINK2_KING_MULTIPLEX 1536
+#else
+#  define PLINK2_KING_MULTIPLEX 960
+#endif
+
+// Words per sample in each --make-rel/--make-grm missingness-correction block.
+#define PLINK2_DBL_MISSING_BLOCK_WORD_CT 2
+
+#ifdef __cplusplus
+namespace plink2 {
+#endif
+
+typedef enum {
+  kSimdTierGeneric,
+  kSimdTierSse42,
+  kSimdTierAvx2,
+  kSimdTierAvx512
+} SimdTier;
+
+typedef void(* IncrKingFunc)(const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts);
+
+typedef void(* IncrKingSubsetFunc)(const uint32_t* loaded_sample_idx_pairs, const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts);
+
+typedef int32_t(* DotprodWordsFunc)(const uintptr_t* __restrict hom1, const uintptr_t* __restrict ref2het1, const uintptr_t* __restrict hom2, const uintptr_t* __restrict ref2het2, uintptr_t word_ct);
+
+typedef void(* SumSsqWordsFunc)(const uintptr_t* hom1, const uintptr_t* ref2het1, const uintptr_t* hom2, const uintptr_t* ref2het2, uint32_t word_ct, int32_t* sum2_ptr, uint32_t* ssq2_ptr);
+
+typedef void(* SumSsqNmWordsFunc)(const uintptr_t* hom1, const uintptr_t* ref2het1, const uintptr_t* hom2, const uintptr_t* ref2het2, uint32_t word_ct, uint32_t* __restrict nm_ptr, int32_t* sum2_ptr, uint32_t* __restrict ssq2_ptr);
+
+typedef void(* IncrDblMissingFunc)(const uintptr_t* missing_nz, const uintptr_t* missing_smaj, uint32_t first_idx, uint32_t sample_idx, uint32_t prev_missing_nz_ct, uint32_t* write_base);
+
+typedef struct SimdKernelsStruct {
+  IncrKingFunc incr_king;
+  IncrKingFunc incr_king_homhom;
+  IncrKingSubsetFunc incr_king_subset;
+  IncrKingSubsetFunc incr_king_subset_homhom;
+  DotprodWordsFunc dotprod_words;
+  SumSsqWordsFunc sum_ssq_words;
+  SumSsqNmWordsFunc sum_ssq_nm_words;
+  IncrDblMissingFunc incr_dbl_missing;
+} SimdKernels;
+
+// Initialized to the baseline kernels, so it's always safe to call through
+// even if InitSimdDispatch() is never called.
+extern SimdKernels g_simd_kernels;
+
+// Highest tier supported by both this build and the current processor.
+SimdTier DetectSimdTier();
+
+// Fills *kernels_ptr with the given tier's kernels; tiers at or below the
+// build's baseline all map to the baseline kernels.  Caller is responsible
+// for tier <= DetectSimdTier().
+void InitSimdKernels(SimdTier tier, SimdKernels* kernels_ptr);
+
+// Returns the selected tier.  Must be called before any threads are launched.
+SimdTier InitSimdDispatch();
+
+const char* SimdTierName(SimdTier tier);
+
+void InitSimdKernelsSse42(SimdKernels* kernels_ptr);
+
+void InitSimdKernelsAvx2(SimdKernels* kernels_ptr);
+
+void InitSimdKernelsAvx512(SimdKernels* kernels_ptr);
+
+#ifdef __cplusplus
+}  // namespace plink2
+#endif
+
+#endif  // __PLINK2_SIMD_H__
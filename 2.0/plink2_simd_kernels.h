@@ -0,0 +1,1319 @@
+// This file is part of PLINK 2.00, copyright (C) 2005-2020 Shaun Purcell,
+// Christopher Chang.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// Kernel bodies shared by all runtime-dispatched SIMD tiers.  This is
+// deliberately not include-guarded: plink2_simd.cc includes it once for the
+// baseline kernels, and each plink2_simd_<tier>.cc includes it once with the
+// "plink2" namespace macro-renamed, so that inline helpers compiled with that
+// tier's instruction-set flags can't be merged with the baseline copies at
+// link time.  Everything defined here is static for the same reason.
+
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VPOPCNTDQ__)
+#  define USE_AVX512_POPCNT
+#  include <immintrin.h>
+#endif
+
+namespace plink2 {
+
+// KING counter layout; keep in sync with plink2_matrix_calc.cc.
+CONSTI32(kKingOffsetIbs0, 0);
+CONSTI32(kKingOffsetHethet, 1);
+CONSTI32(kKingOffsetHet2Hom1, 2);
+CONSTI32(kKingOffsetHet1Hom2, 3);
+CONSTI32(kKingOffsetHomhom, 4);
+
+CONSTI32(kKingMultiplex, PLINK2_KING_MULTIPLEX);
+CONSTI32(kKingMultiplexWords, kKingMultiplex / kBitsPerWord);
+
+#ifdef USE_AVX512_POPCNT
+// Horizontal sum of eight uint64s; 512-bit counterpart of HsumW() in
+// plink2_bits.h.  Equivalent to _mm512_reduce_add_epi64(), which provokes
+// spurious -Wuninitialized warnings from some gcc versions.
+static inline uint64_t ZmmHsum64(__m512i vv) {
+  alignas(64) uint64_t lanes[8];
+  _mm512_store_si512(R_CAST(__m512i*, lanes), vv);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+}
+#endif
+
+#ifdef USE_AVX512_POPCNT
+// One VPOPCNTQ per 512-bit word group removes the need for the
+// Lauradoux/Walisch accumulator tree, and the second sample's vectors are
+// loaded once per row.
+CONSTI32(kKingMultiplexZmms, kKingMultiplex / 512);
+static_assert(kKingMultiplex % 512 == 0, "Invalid kKingMultiplex value.");
+
+static inline __m512i KingPopcountAdd(__m512i acc, __m512i vv) {
+  return _mm512_add_epi64(acc, _mm512_popcnt_epi64(vv));
+}
+
+static void IncrKing(const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts_iter) {
+  for (uint32_t second_idx = start_idx; second_idx != end_idx; ++second_idx) {
+    // technically overflows for huge sample_ct
+    const uint32_t second_offset = second_idx * kKingMultiplexWords;
+    const uintptr_t* second_hom = &(smaj_hom[second_offset]);
+    const uintptr_t* second_ref2het = &(smaj_ref2het[second_offset]);
+    __m512i hom2[kKingMultiplexZmms];
+    __m512i ref2het2[kKingMultiplexZmms];
+    __m512i het2[kKingMultiplexZmms];
+    for (uint32_t zidx = 0; zidx != kKingMultiplexZmms; ++zidx) {
+      hom2[zidx] = _mm512_loadu_si512(&(second_hom[zidx * 8]));
+      ref2het2[zidx] = _mm512_loadu_si512(&(second_ref2het[zidx * 8]));
+      het2[zidx] = _mm512_xor_si512(ref2het2[zidx], _mm512_and_si512(hom2[zidx], ref2het2[zidx]));
+    }
+    const uintptr_t* first_hom_iter = smaj_hom;
+    const uintptr_t* first_ref2het_iter = smaj_ref2het;
+    while (first_hom_iter < second_hom) {
+      __m512i acc_ibs0 = _mm512_setzero_si512();
+      __m512i acc_hethet = _mm512_setzero_si512();
+      __m512i acc_het2hom1 = _mm512_setzero_si512();
+      __m512i acc_het1hom2 = _mm512_setzero_si512();
+      for (uint32_t zidx = 0; zidx != kKingMultiplexZmms; ++zidx) {
+        const __m512i hom1 = _mm512_loadu_si512(&(first_hom_iter[zidx * 8]));
+        const __m512i ref2het1 = _mm512_loadu_si512(&(first_ref2het_iter[zidx * 8]));
+        const __m512i het1 = _mm512_xor_si512(ref2het1, _mm512_and_si512(hom1, ref2het1));
+        acc_ibs0 = KingPopcountAdd(acc_ibs0, _mm512_and_si512(_mm512_xor_si512(ref2het1, ref2het2[zidx]), _mm512_and_si512(hom1, hom2[zidx])));
+        acc_hethet = KingPopcountAdd(acc_hethet, _mm512_and_si512(het1, het2[zidx]));
+        acc_het2hom1 = KingPopcountAdd(acc_het2hom1, _mm512_and_si512(hom1, het2[zidx]));
+        acc_het1hom2 = KingPopcountAdd(acc_het1hom2, _mm512_and_si512(hom2[zidx], het1));
+      }
+      king_counts_iter[kKingOffsetIbs0] += ZmmHsum64(acc_ibs0);
+      king_counts_iter[kKingOffsetHethet] += ZmmHsum64(acc_hethet);
+      king_counts_iter[kKingOffsetHet2Hom1] += ZmmHsum64(acc_het2hom1);
+      king_counts_iter[kKingOffsetHet1Hom2] += ZmmHsum64(acc_het1hom2);
+      king_counts_iter = &(king_counts_iter[4]);
+
+      first_hom_iter = &(first_hom_iter[kKingMultiplexWords]);
+      first_ref2het_iter = &(first_ref2het_iter[kKingMultiplexWords]);
+    }
+  }
+}
+
+static void IncrKingHomhom(const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts_iter) {
+  for (uint32_t second_idx = start_idx; second_idx != end_idx; ++second_idx) {
+    // technically overflows for huge sample_ct
+    const uint32_t second_offset = second_idx * kKingMultiplexWords;
+    const uintptr_t* second_hom = &(smaj_hom[second_offset]);
+    const uintptr_t* second_ref2het = &(smaj_ref2het[second_offset]);
+    __m512i hom2[kKingMultiplexZmms];
+    __m512i ref2het2[kKingMultiplexZmms];
+    __m512i het2[kKingMultiplexZmms];
+    for (uint32_t zidx = 0; zidx != kKingMultiplexZmms; ++zidx) {
+      hom2[zidx] = _mm512_loadu_si512(&(second_hom[zidx * 8]));
+      ref2het2[zidx] = _mm512_loadu_si512(&(second_ref2het[zidx * 8]));
+      het2[zidx] = _mm512_xor_si512(ref2het2[zidx], _mm512_and_si512(hom2[zidx], ref2het2[zidx]));
+    }
+    const uintptr_t* first_hom_iter = smaj_hom;
+    const uintptr_t* first_ref2het_iter = smaj_ref2het;
+    while (first_hom_iter < second_hom) {
+      __m512i acc_homhom = _mm512_setzero_si512();
+      __m512i acc_ibs0 = _mm512_setzero_si512();
+      __m512i acc_hethet = _mm512_setzero_si512();
+      __m512i acc_het2hom1 = _mm512_setzero_si512();
+      __m512i acc_het1hom2 = _mm512_setzero_si512();
+      for (uint32_t zidx = 0; zidx != kKingMultiplexZmms; ++zidx) {
+        const __m512i hom1 = _mm512_loadu_si512(&(first_hom_iter[zidx * 8]));
+        const __m512i ref2het1 = _mm512_loadu_si512(&(first_ref2het_iter[zidx * 8]));
+        const __m512i homhom = _mm512_and_si512(hom1, hom2[zidx]);
+        const __m512i het1 = _mm512_xor_si512(ref2het1, _mm512_and_si512(hom1, ref2het1));
+        acc_homhom = KingPopcountAdd(acc_homhom, homhom);
+        acc_ibs0 = KingPopcountAdd(acc_ibs0, _mm512_and_si512(_mm512_xor_si512(ref2het1, ref2het2[zidx]), homhom));
+        acc_hethet = KingPopcountAdd(acc_hethet, _mm512_and_si512(het1, het2[zidx]));
+        acc_het2hom1 = KingPopcountAdd(acc_het2hom1, _mm512_and_si512(hom1, het2[zidx]));
+        acc_het1hom2 = KingPopcountAdd(acc_het1hom2, _mm512_and_si512(hom2[zidx], het1));
+      }
+      king_counts_iter[kKingOffsetIbs0] += ZmmHsum64(acc_ibs0);
+      king_counts_iter[kKingOffsetHethet] += ZmmHsum64(acc_hethet);
+      king_counts_iter[kKingOffsetHet2Hom1] += ZmmHsum64(acc_het2hom1);
+      king_counts_iter[kKingOffsetHet1Hom2] += ZmmHsum64(acc_het1hom2);
+      king_counts_iter[kKingOffsetHomhom] += ZmmHsum64(acc_homhom);
+      king_counts_iter = &(king_counts_iter[5]);
+
+      first_hom_iter = &(first_hom_iter[kKingMultiplexWords]);
+      first_ref2het_iter = &(first_ref2het_iter[kKingMultiplexWords]);
+    }
+  }
+}
+#elif defined(USE_SSE42)
+static void IncrKing(const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts_iter) {
+  // Tried adding another level of blocking, but couldn't get it to make a
+  // difference.
+  for (uint32_t second_idx = start_idx; second_idx != end_idx; ++second_idx) {
+    // technically overflows for huge sample_ct
+    const uint32_t second_offset = second_idx * kKingMultiplexWords;
+    const uintptr_t* second_hom = &(smaj_hom[second_offset]);
+    const uintptr_t* second_ref2het = &(smaj_ref2het[second_offset]);
+    const uintptr_t* first_hom_iter = smaj_hom;
+    const uintptr_t* first_ref2het_iter = smaj_ref2het;
+    while (first_hom_iter < second_hom) {
+      uint32_t acc_ibs0 = 0;
+      uint32_t acc_hethet = 0;
+      uint32_t acc_het2hom1 = 0;
+      uint32_t acc_het1hom2 = 0;
+      for (uint32_t widx = 0; widx != kKingMultiplexWords; ++widx) {
+        const uintptr_t hom1 = first_hom_iter[widx];
+        const uintptr_t hom2 = second_hom[widx];
+        const uintptr_t ref2het1 = first_ref2het_iter[widx];
+        const uintptr_t ref2het2 = second_ref2het[widx];
+        const uintptr_t homhom = hom1 & hom2;
+        const uintptr_t het1 = ref2het1 & (~hom1);
+        const uintptr_t het2 = ref2het2 & (~hom2);
+        acc_ibs0 += PopcountWord((ref2het1 ^ ref2het2) & homhom);
+        acc_hethet += PopcountWord(het1 & het2);
+        acc_het2hom1 += PopcountWord(hom1 & het2);
+        acc_het1hom2 += PopcountWord(hom2 & het1);
+      }
+      king_counts_iter[kKingOffsetIbs0] += acc_ibs0;
+      king_counts_iter[kKingOffsetHethet] += acc_hethet;
+      king_counts_iter[kKingOffsetHet2Hom1] += acc_het2hom1;
+      king_counts_iter[kKingOffsetHet1Hom2] += acc_het1hom2;
+      king_counts_iter = &(king_counts_iter[4]);
+
+      first_hom_iter = &(first_hom_iter[kKingMultiplexWords]);
+      first_ref2het_iter = &(first_ref2het_iter[kKingMultiplexWords]);
+    }
+  }
+}
+
+static void IncrKingHomhom(const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts_iter) {
+  for (uint32_t second_idx = start_idx; second_idx != end_idx; ++second_idx) {
+    // technically overflows for huge sample_ct
+    const uint32_t second_offset = second_idx * kKingMultiplexWords;
+    const uintptr_t* second_hom = &(smaj_hom[second_offset]);
+    const uintptr_t* second_ref2het = &(smaj_ref2het[second_offset]);
+    const uintptr_t* first_hom_iter = smaj_hom;
+    const uintptr_t* first_ref2het_iter = smaj_ref2het;
+    while (first_hom_iter < second_hom) {
+      uint32_t acc_homhom = 0;
+      uint32_t acc_ibs0 = 0;
+      uint32_t acc_hethet = 0;
+      uint32_t acc_het2hom1 = 0;
+      uint32_t acc_het1hom2 = 0;
+      for (uint32_t widx = 0; widx != kKingMultiplexWords; ++widx) {
+        const uintptr_t hom1 = first_hom_iter[widx];
+        const uintptr_t hom2 = second_hom[widx];
+        const uintptr_t ref2het1 = first_ref2het_iter[widx];
+        const uintptr_t ref2het2 = second_ref2het[widx];
+        const uintptr_t homhom = hom1 & hom2;
+        const uintptr_t het1 = ref2het1 & (~hom1);
+        const uintptr_t het2 = ref2het2 & (~hom2);
+        acc_homhom += PopcountWord(homhom);
+        acc_ibs0 += PopcountWord((ref2het1 ^ ref2het2) & homhom);
+        acc_hethet += PopcountWord(het1 & het2);
+        acc_het2hom1 += PopcountWord(hom1 & het2);
+        acc_het1hom2 += PopcountWord(hom2 & het1);
+      }
+      king_counts_iter[kKingOffsetIbs0] += acc_ibs0;
+      king_counts_iter[kKingOffsetHethet] += acc_hethet;
+      king_counts_iter[kKingOffsetHet2Hom1] += acc_het2hom1;
+      king_counts_iter[kKingOffsetHet1Hom2] += acc_het1hom2;
+      king_counts_iter[kKingOffsetHomhom] += acc_homhom;
+      king_counts_iter = &(king_counts_iter[5]);
+
+      first_hom_iter = &(first_hom_iter[kKingMultiplexWords]);
+      first_ref2het_iter = &(first_ref2het_iter[kKingMultiplexWords]);
+    }
+  }
+}
+#else  // !USE_SSE42
+static_assert(kKingMultiplex % (3 * kBitsPerVec) == 0, "Invalid kKingMultiplex value.");
+CONSTI32(kKingMultiplexVecs, kKingMultiplex / kBitsPerVec);
+// expensive PopcountWord().  Use Lauradoux/Walisch accumulators, since
+// Harley-Seal requires too many variables.
+static void IncrKing(const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts_iter) {
+  const VecW m1 = VCONST_W(kMask5555);
+  const VecW m2 = VCONST_W(kMask3333);
+  const VecW m4 = VCONST_W(kMask0F0F);
+  for (uint32_t second_idx = start_idx; second_idx != end_idx; ++second_idx) {
+    // technically overflows for huge sample_ct
+    const uint32_t second_offset = second_idx * kKingMultiplexWords;
+    const VecW* second_hom = R_CAST(const VecW*, &(smaj_hom[second_offset]));
+    const VecW* second_ref2het = R_CAST(const VecW*, &(smaj_ref2het[second_offset]));
+    const VecW* first_hom_iter = R_CAST(const VecW*, smaj_hom);
+    const VecW* first_ref2het_iter = R_CAST(const VecW*, smaj_ref2het);
+    while (first_hom_iter < second_hom) {
+      UniVec acc_ibs0;
+      UniVec acc_hethet;
+      UniVec acc_het2hom1;
+      UniVec acc_het1hom2;
+      acc_ibs0.vw = vecw_setzero();
+      acc_hethet.vw = vecw_setzero();
+      acc_het2hom1.vw = vecw_setzero();
+      acc_het1hom2.vw = vecw_setzero();
+      for (uint32_t vec_idx = 0; vec_idx < kKingMultiplexVecs; vec_idx += 3) {
+        VecW hom1 = first_hom_iter[vec_idx];
+        VecW hom2 = second_hom[vec_idx];
+        VecW ref2het1 = first_ref2het_iter[vec_idx];
+        VecW ref2het2 = second_ref2het[vec_idx];
+        VecW het1 = vecw_and_notfirst(hom1, ref2het1);
+        VecW het2 = vecw_and_notfirst(hom2, ref2het2);
+        VecW agg_ibs0 = (ref2het1 ^ ref2het2) & (hom1 & hom2);
+        VecW agg_hethet = het1 & het2;
+        VecW agg_het2hom1 = hom1 & het2;
+        VecW agg_het1hom2 = hom2 & het1;
+        agg_ibs0 = agg_ibs0 - (vecw_srli(agg_ibs0, 1) & m1);
+        agg_hethet = agg_hethet - (vecw_srli(agg_hethet, 1) & m1);
+        agg_het2hom1 = agg_het2hom1 - (vecw_srli(agg_het2hom1, 1) & m1);
+        agg_het1hom2 = agg_het1hom2 - (vecw_srli(agg_het1hom2, 1) & m1);
+        agg_ibs0 = (agg_ibs0 & m2) + (vecw_srli(agg_ibs0, 2) & m2);
+        agg_hethet = (agg_hethet & m2) + (vecw_srli(agg_hethet, 2) & m2);
+        agg_het2hom1 = (agg_het2hom1 & m2) + (vecw_srli(agg_het2hom1, 2) & m2);
+        agg_het1hom2 = (agg_het1hom2 & m2) + (vecw_srli(agg_het1hom2, 2) & m2);
+
+        for (uint32_t offset = 1; offset != 3; ++offset) {
+          hom1 = first_hom_iter[vec_idx + offset];
+          hom2 = second_hom[vec_idx + offset];
+          ref2het1 = first_ref2het_iter[vec_idx + offset];
+          ref2het2 = second_ref2het[vec_idx + offset];
+          het1 = vecw_and_notfirst(hom1, ref2het1);
+          het2 = vecw_and_notfirst(hom2, ref2het2);
+          VecW cur_ibs0 = (ref2het1 ^ ref2het2) & (hom1 & hom2);
+          VecW cur_hethet = het1 & het2;
+          VecW cur_het2hom1 = hom1 & het2;
+          VecW cur_het1hom2 = hom2 & het1;
+          cur_ibs0 = cur_ibs0 - (vecw_srli(cur_ibs0, 1) & m1);
+          cur_hethet = cur_hethet - (vecw_srli(cur_hethet, 1) & m1);
+          cur_het2hom1 = cur_het2hom1 - (vecw_srli(cur_het2hom1, 1) & m1);
+          cur_het1hom2 = cur_het1hom2 - (vecw_srli(cur_het1hom2, 1) & m1);
+          agg_ibs0 += (cur_ibs0 & m2) + (vecw_srli(cur_ibs0, 2) & m2);
+          agg_hethet += (cur_hethet & m2) + (vecw_srli(cur_hethet, 2) & m2);
+          agg_het2hom1 += (cur_het2hom1 & m2) + (vecw_srli(cur_het2hom1, 2) & m2);
+          agg_het1hom2 += (cur_het1hom2 & m2) + (vecw_srli(cur_het1hom2, 2) & m2);
+        }
+        acc_ibs0.vw = acc_ibs0.vw + (agg_ibs0 & m4) + (vecw_srli(agg_ibs0, 4) & m4);
+        acc_hethet.vw = acc_hethet.vw + (agg_hethet & m4) + (vecw_srli(agg_hethet, 4) & m4);
+        acc_het2hom1.vw = acc_het2hom1.vw + (agg_het2hom1 & m4) + (vecw_srli(agg_het2hom1, 4) & m4);
+        acc_het1hom2.vw = acc_het1hom2.vw + (agg_het1hom2 & m4) + (vecw_srli(agg_het1hom2, 4) & m4);
+      }
+      const VecW m8 = VCONST_W(kMask00FF);
+      acc_ibs0.vw = (acc_ibs0.vw & m8) + (vecw_srli(acc_ibs0.vw, 8) & m8);
+      acc_hethet.vw = (acc_hethet.vw & m8) + (vecw_srli(acc_hethet.vw, 8) & m8);
+      acc_het2hom1.vw = (acc_het2hom1.vw & m8) + (vecw_srli(acc_het2hom1.vw, 8) & m8);
+      acc_het1hom2.vw = (acc_het1hom2.vw & m8) + (vecw_srli(acc_het1hom2.vw, 8) & m8);
+      king_counts_iter[kKingOffsetIbs0] += UniVecHsum16(acc_ibs0);
+      king_counts_iter[kKingOffsetHethet] += UniVecHsum16(acc_hethet);
+      king_counts_iter[kKingOffsetHet2Hom1] += UniVecHsum16(acc_het2hom1);
+      king_counts_iter[kKingOffsetHet1Hom2] += UniVecHsum16(acc_het1hom2);
+      king_counts_iter = &(king_counts_iter[4]);
+
+      first_hom_iter = &(first_hom_iter[kKingMultiplexVecs]);
+      first_ref2het_iter = &(first_ref2het_iter[kKingMultiplexVecs]);
+    }
+  }
+}
+
+static void IncrKingHomhom(const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts_iter) {
+  const VecW m1 = VCONST_W(kMask5555);
+  const VecW m2 = VCONST_W(kMask3333);
+  const VecW m4 = VCONST_W(kMask0F0F);
+  for (uint32_t second_idx = start_idx; second_idx != end_idx; ++second_idx) {
+    // technically overflows for huge sample_ct
+    const uint32_t second_offset = second_idx * kKingMultiplexWords;
+    const VecW* second_hom = R_CAST(const VecW*, &(smaj_hom[second_offset]));
+    const VecW* second_ref2het = R_CAST(const VecW*, &(smaj_ref2het[second_offset]));
+    const VecW* first_hom_iter = R_CAST(const VecW*, smaj_hom);
+    const VecW* first_ref2het_iter = R_CAST(const VecW*, smaj_ref2het);
+    while (first_hom_iter < second_hom) {
+      UniVec acc_homhom;
+      UniVec acc_ibs0;
+      UniVec acc_hethet;
+      UniVec acc_het2hom1;
+      UniVec acc_het1hom2;
+      acc_homhom.vw = vecw_setzero();
+      acc_ibs0.vw = vecw_setzero();
+      acc_hethet.vw = vecw_setzero();
+      acc_het2hom1.vw = vecw_setzero();
+      acc_het1hom2.vw = vecw_setzero();
+      for (uint32_t vec_idx = 0; vec_idx < kKingMultiplexVecs; vec_idx += 3) {
+        VecW hom1 = first_hom_iter[vec_idx];
+        VecW hom2 = second_hom[vec_idx];
+        VecW ref2het1 = first_ref2het_iter[vec_idx];
+        VecW ref2het2 = second_ref2het[vec_idx];
+        VecW agg_homhom = hom1 & hom2;
+        VecW het1 = vecw_and_notfirst(hom1, ref2het1);
+        VecW het2 = vecw_and_notfirst(hom2, ref2het2);
+        VecW agg_ibs0 = (ref2het1 ^ ref2het2) & agg_homhom;
+        VecW agg_hethet = het1 & het2;
+        VecW agg_het2hom1 = hom1 & het2;
+        VecW agg_het1hom2 = hom2 & het1;
+        agg_homhom = agg_homhom - (vecw_srli(agg_homhom, 1) & m1);
+        agg_ibs0 = agg_ibs0 - (vecw_srli(agg_ibs0, 1) & m1);
+        agg_hethet = agg_hethet - (vecw_srli(agg_hethet, 1) & m1);
+        agg_het2hom1 = agg_het2hom1 - (vecw_srli(agg_het2hom1, 1) & m1);
+        agg_het1hom2 = agg_het1hom2 - (vecw_srli(agg_het1hom2, 1) & m1);
+        agg_homhom = (agg_homhom & m2) + (vecw_srli(agg_homhom, 2) & m2);
+        agg_ibs0 = (agg_ibs0 & m2) + (vecw_srli(agg_ibs0, 2) & m2);
+        agg_hethet = (agg_hethet & m2) + (vecw_srli(agg_hethet, 2) & m2);
+        agg_het2hom1 = (agg_het2hom1 & m2) + (vecw_srli(agg_het2hom1, 2) & m2);
+        agg_het1hom2 = (agg_het1hom2 & m2) + (vecw_srli(agg_het1hom2, 2) & m2);
+
+        for (uint32_t offset = 1; offset != 3; ++offset) {
+          hom1 = first_hom_iter[vec_idx + offset];
+          hom2 = second_hom[vec_idx + offset];
+          ref2het1 = first_ref2het_iter[vec_idx + offset];
+          ref2het2 = second_ref2het[vec_idx + offset];
+          VecW cur_homhom = hom1 & hom2;
+          het1 = vecw_and_notfirst(hom1, ref2het1);
+          het2 = vecw_and_notfirst(hom2, ref2het2);
+          VecW cur_ibs0 = (ref2het1 ^ ref2het2) & cur_homhom;
+          VecW cur_hethet = het1 & het2;
+          VecW cur_het2hom1 = hom1 & het2;
+          VecW cur_het1hom2 = hom2 & het1;
+          cur_homhom = cur_homhom - (vecw_srli(cur_homhom, 1) & m1);
+          cur_ibs0 = cur_ibs0 - (vecw_srli(cur_ibs0, 1) & m1);
+          cur_hethet = cur_hethet - (vecw_srli(cur_hethet, 1) & m1);
+          cur_het2hom1 = cur_het2hom1 - (vecw_srli(cur_het2hom1, 1) & m1);
+          cur_het1hom2 = cur_het1hom2 - (vecw_srli(cur_het1hom2, 1) & m1);
+          agg_homhom += (cur_homhom & m2) + (vecw_srli(cur_homhom, 2) & m2);
+          agg_ibs0 += (cur_ibs0 & m2) + (vecw_srli(cur_ibs0, 2) & m2);
+          agg_hethet += (cur_hethet & m2) + (vecw_srli(cur_hethet, 2) & m2);
+          agg_het2hom1 += (cur_het2hom1 & m2) + (vecw_srli(cur_het2hom1, 2) & m2);
+          agg_het1hom2 += (cur_het1hom2 & m2) + (vecw_srli(cur_het1hom2, 2) & m2);
+        }
+        acc_homhom.vw = acc_homhom.vw + (agg_homhom & m4) + (vecw_srli(agg_homhom, 4) & m4);
+        acc_ibs0.vw = acc_ibs0.vw + (agg_ibs0 & m4) + (vecw_srli(agg_ibs0, 4) & m4);
+        acc_hethet.vw = acc_hethet.vw + (agg_hethet & m4) + (vecw_srli(agg_hethet, 4) & m4);
+        acc_het2hom1.vw = acc_het2hom1.vw + (agg_het2hom1 & m4) + (vecw_srli(agg_het2hom1, 4) & m4);
+        acc_het1hom2.vw = acc_het1hom2.vw + (agg_het1hom2 & m4) + (vecw_srli(agg_het1hom2, 4) & m4);
+      }
+      const VecW m8 = VCONST_W(kMask00FF);
+      acc_homhom.vw = (acc_homhom.vw & m8) + (vecw_srli(acc_homhom.vw, 8) & m8);
+      acc_ibs0.vw = (acc_ibs0.vw & m8) + (vecw_srli(acc_ibs0.vw, 8) & m8);
+      acc_hethet.vw = (acc_hethet.vw & m8) + (vecw_srli(acc_hethet.vw, 8) & m8);
+      acc_het2hom1.vw = (acc_het2hom1.vw & m8) + (vecw_srli(acc_het2hom1.vw, 8) & m8);
+      acc_het1hom2.vw = (acc_het1hom2.vw & m8) + (vecw_srli(acc_het1hom2.vw, 8) & m8);
+      king_counts_iter[kKingOffsetIbs0] += UniVecHsum16(acc_ibs0);
+      king_counts_iter[kKingOffsetHethet] += UniVecHsum16(acc_hethet);
+      king_counts_iter[kKingOffsetHet2Hom1] += UniVecHsum16(acc_het2hom1);
+      king_counts_iter[kKingOffsetHet1Hom2] += UniVecHsum16(acc_het1hom2);
+      king_counts_iter[kKingOffsetHomhom] += UniVecHsum16(acc_homhom);
+      king_counts_iter = &(king_counts_iter[5]);
+
+      first_hom_iter = &(first_hom_iter[kKingMultiplexVecs]);
+      first_ref2het_iter = &(first_ref2het_iter[kKingMultiplexVecs]);
+    }
+  }
+}
+#endif
+
+#ifdef USE_AVX512_POPCNT
+static void IncrKingSubset(const uint32_t* loaded_sample_idx_pairs, const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts) {
+  const uint32_t* sample_idx_pair_iter = &(loaded_sample_idx_pairs[(2 * k1LU) * start_idx]);
+  const uint32_t* sample_idx_pair_stop = &(loaded_sample_idx_pairs[(2 * k1LU) * end_idx]);
+  uint32_t* king_counts_iter = &(king_counts[(4 * k1LU) * start_idx]);
+  while (sample_idx_pair_iter != sample_idx_pair_stop) {
+    // technically overflows for huge sample_ct
+    const uint32_t first_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
+    const uint32_t second_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
+    const uintptr_t* first_hom = &(smaj_hom[first_offset]);
+    const uintptr_t* first_ref2het = &(smaj_ref2het[first_offset]);
+    const uintptr_t* second_hom = &(smaj_hom[second_offset]);
+    const uintptr_t* second_ref2het = &(smaj_ref2het[second_offset]);
+    __m512i acc_ibs0 = _mm512_setzero_si512();
+    __m512i acc_hethet = _mm512_setzero_si512();
+    __m512i acc_het2hom1 = _mm512_setzero_si512();
+    __m512i acc_het1hom2 = _mm512_setzero_si512();
+    for (uint32_t widx = 0; widx != kKingMultiplexWords; widx += 8) {
+      const __m512i hom1 = _mm512_loadu_si512(&(first_hom[widx]));
+      const __m512i hom2 = _mm512_loadu_si512(&(second_hom[widx]));
+      const __m512i ref2het1 = _mm512_loadu_si512(&(first_ref2het[widx]));
+      const __m512i ref2het2 = _mm512_loadu_si512(&(second_ref2het[widx]));
+      const __m512i het1 = _mm512_xor_si512(ref2het1, _mm512_and_si512(hom1, ref2het1));
+      const __m512i het2 = _mm512_xor_si512(ref2het2, _mm512_and_si512(hom2, ref2het2));
+      acc_ibs0 = KingPopcountAdd(acc_ibs0, _mm512_and_si512(_mm512_xor_si512(ref2het1, ref2het2), _mm512_and_si512(hom1, hom2)));
+      acc_hethet = KingPopcountAdd(acc_hethet, _mm512_and_si512(het1, het2));
+      acc_het2hom1 = KingPopcountAdd(acc_het2hom1, _mm512_and_si512(hom1, het2));
+      acc_het1hom2 = KingPopcountAdd(acc_het1hom2, _mm512_and_si512(hom2, het1));
+    }
+    *king_counts_iter++ += ZmmHsum64(acc_ibs0);
+    *king_counts_iter++ += ZmmHsum64(acc_hethet);
+    *king_counts_iter++ += ZmmHsum64(acc_het2hom1);
+    *king_counts_iter++ += ZmmHsum64(acc_het1hom2);
+  }
+}
+
+static void IncrKingSubsetHomhom(const uint32_t* loaded_sample_idx_pairs, const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts) {
+  const uint32_t* sample_idx_pair_iter = &(loaded_sample_idx_pairs[(2 * k1LU) * start_idx]);
+  const uint32_t* sample_idx_pair_stop = &(loaded_sample_idx_pairs[(2 * k1LU) * end_idx]);
+  uint32_t* king_counts_iter = &(king_counts[(5 * k1LU) * start_idx]);
+  while (sample_idx_pair_iter != sample_idx_pair_stop) {
+    // technically overflows for huge sample_ct
+    const uint32_t first_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
+    const uint32_t second_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
+    const uintptr_t* first_hom = &(smaj_hom[first_offset]);
+    const uintptr_t* first_ref2het = &(smaj_ref2het[first_offset]);
+    const uintptr_t* second_hom = &(smaj_hom[second_offset]);
+    const uintptr_t* second_ref2het = &(smaj_ref2het[second_offset]);
+    __m512i acc_homhom = _mm512_setzero_si512();
+    __m512i acc_ibs0 = _mm512_setzero_si512();
+    __m512i acc_hethet = _mm512_setzero_si512();
+    __m512i acc_het2hom1 = _mm512_setzero_si512();
+    __m512i acc_het1hom2 = _mm512_setzero_si512();
+    for (uint32_t widx = 0; widx != kKingMultiplexWords; widx += 8) {
+      const __m512i hom1 = _mm512_loadu_si512(&(first_hom[widx]));
+      const __m512i hom2 = _mm512_loadu_si512(&(second_hom[widx]));
+      const __m512i ref2het1 = _mm512_loadu_si512(&(first_ref2het[widx]));
+      const __m512i ref2het2 = _mm512_loadu_si512(&(second_ref2het[widx]));
+      const __m512i homhom = _mm512_and_si512(hom1, hom2);
+      const __m512i het1 = _mm512_xor_si512(ref2het1, _mm512_and_si512(hom1, ref2het1));
+      const __m512i het2 = _mm512_xor_si512(ref2het2, _mm512_and_si512(hom2, ref2het2));
+      acc_homhom = KingPopcountAdd(acc_homhom, homhom);
+      acc_ibs0 = KingPopcountAdd(acc_ibs0, _mm512_and_si512(_mm512_xor_si512(ref2het1, ref2het2), homhom));
+      acc_hethet = KingPopcountAdd(acc_hethet, _mm512_and_si512(het1, het2));
+      acc_het2hom1 = KingPopcountAdd(acc_het2hom1, _mm512_and_si512(hom1, het2));
+      acc_het1hom2 = KingPopcountAdd(acc_het1hom2, _mm512_and_si512(hom2, het1));
+    }
+    *king_counts_iter++ += ZmmHsum64(acc_ibs0);
+    *king_counts_iter++ += ZmmHsum64(acc_hethet);
+    *king_counts_iter++ += ZmmHsum64(acc_het2hom1);
+    *king_counts_iter++ += ZmmHsum64(acc_het1hom2);
+    *king_counts_iter++ += ZmmHsum64(acc_homhom);
+  }
+}
+#elif defined(USE_SSE42)
+static void IncrKingSubset(const uint32_t* loaded_sample_idx_pairs, const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts) {
+  const uint32_t* sample_idx_pair_iter = &(loaded_sample_idx_pairs[(2 * k1LU) * start_idx]);
+  const uint32_t* sample_idx_pair_stop = &(loaded_sample_idx_pairs[(2 * k1LU) * end_idx]);
+  uint32_t* king_counts_iter = &(king_counts[(4 * k1LU) * start_idx]);
+  while (sample_idx_pair_iter != sample_idx_pair_stop) {
+    // technically overflows for huge sample_ct
+    const uint32_t first_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
+    const uint32_t second_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
+    const uintptr_t* first_hom = &(smaj_hom[first_offset]);
+    const uintptr_t* first_ref2het = &(smaj_ref2het[first_offset]);
+    const uintptr_t* second_hom = &(smaj_hom[second_offset]);
+    const uintptr_t* second_ref2het = &(smaj_ref2het[second_offset]);
+    uint32_t acc_ibs0 = 0;
+    uint32_t acc_hethet = 0;
+    uint32_t acc_het2hom1 = 0;
+    uint32_t acc_het1hom2 = 0;
+    for (uint32_t widx = 0; widx != kKingMultiplexWords; ++widx) {
+      const uintptr_t hom1 = first_hom[widx];
+      const uintptr_t hom2 = second_hom[widx];
+      const uintptr_t ref2het1 = first_ref2het[widx];
+      const uintptr_t ref2het2 = second_ref2het[widx];
+      const uintptr_t homhom = hom1 & hom2;
+      const uintptr_t het1 = ref2het1 & (~hom1);
+      const uintptr_t het2 = ref2het2 & (~hom2);
+      acc_ibs0 += PopcountWord((ref2het1 ^ ref2het2) & homhom);
+      acc_hethet += PopcountWord(het1 & het2);
+      acc_het2hom1 += PopcountWord(hom1 & het2);
+      acc_het1hom2 += PopcountWord(hom2 & het1);
+    }
+    *king_counts_iter++ += acc_ibs0;
+    *king_counts_iter++ += acc_hethet;
+    *king_counts_iter++ += acc_het2hom1;
+    *king_counts_iter++ += acc_het1hom2;
+  }
+}
+
+static void IncrKingSubsetHomhom(const uint32_t* loaded_sample_idx_pairs, const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts) {
+  const uint32_t* sample_idx_pair_iter = &(loaded_sample_idx_pairs[(2 * k1LU) * start_idx]);
+  const uint32_t* sample_idx_pair_stop = &(loaded_sample_idx_pairs[(2 * k1LU) * end_idx]);
+  uint32_t* king_counts_iter = &(king_counts[(5 * k1LU) * start_idx]);
+  while (sample_idx_pair_iter != sample_idx_pair_stop) {
+    // technically overflows for huge sample_ct
+    const uint32_t first_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
+    const uint32_t second_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
+    const uintptr_t* first_hom = &(smaj_hom[first_offset]);
+    const uintptr_t* first_ref2het = &(smaj_ref2het[first_offset]);
+    const uintptr_t* second_hom = &(smaj_hom[second_offset]);
+    const uintptr_t* second_ref2het = &(smaj_ref2het[second_offset]);
+    uint32_t acc_homhom = 0;
+    uint32_t acc_ibs0 = 0;
+    uint32_t acc_hethet = 0;
+    uint32_t acc_het2hom1 = 0;
+    uint32_t acc_het1hom2 = 0;
+    for (uint32_t widx = 0; widx != kKingMultiplexWords; ++widx) {
+      const uintptr_t hom1 = first_hom[widx];
+      const uintptr_t hom2 = second_hom[widx];
+      const uintptr_t ref2het1 = first_ref2het[widx];
+      const uintptr_t ref2het2 = second_ref2het[widx];
+      const uintptr_t homhom = hom1 & hom2;
+      const uintptr_t het1 = ref2het1 & (~hom1);
+      const uintptr_t het2 = ref2het2 & (~hom2);
+      acc_homhom += PopcountWord(homhom);
+      acc_ibs0 += PopcountWord((ref2het1 ^ ref2het2) & homhom);
+      acc_hethet += PopcountWord(het1 & het2);
+      acc_het2hom1 += PopcountWord(hom1 & het2);
+      acc_het1hom2 += PopcountWord(hom2 & het1);
+    }
+    *king_counts_iter++ += acc_ibs0;
+    *king_counts_iter++ += acc_hethet;
+    *king_counts_iter++ += acc_het2hom1;
+    *king_counts_iter++ += acc_het1hom2;
+    *king_counts_iter++ += acc_homhom;
+  }
+}
+#else
+static void IncrKingSubset(const uint32_t* loaded_sample_idx_pairs, const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts) {
+  const VecW m1 = VCONST_W(kMask5555);
+  const VecW m2 = VCONST_W(kMask3333);
+  const VecW m4 = VCONST_W(kMask0F0F);
+  const uint32_t* sample_idx_pair_iter = &(loaded_sample_idx_pairs[(2 * k1LU) * start_idx]);
+  const uint32_t* sample_idx_pair_stop = &(loaded_sample_idx_pairs[(2 * k1LU) * end_idx]);
+  uint32_t* king_counts_iter = &(king_counts[(4 * k1LU) * start_idx]);
+  while (sample_idx_pair_iter != sample_idx_pair_stop) {
+    // technically overflows for huge sample_ct
+    const uint32_t first_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
+    const uint32_t second_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
+    const VecW* first_hom = R_CAST(const VecW*, &(smaj_hom[first_offset]));
+    const VecW* first_ref2het = R_CAST(const VecW*, &(smaj_ref2het[first_offset]));
+    const VecW* second_hom = R_CAST(const VecW*, &(smaj_hom[second_offset]));
+    const VecW* second_ref2het = R_CAST(const VecW*, &(smaj_ref2het[second_offset]));
+    UniVec acc_ibs0;
+    UniVec acc_hethet;
+    UniVec acc_het2hom1;
+    UniVec acc_het1hom2;
+    acc_ibs0.vw = vecw_setzero();
+    acc_hethet.vw = vecw_setzero();
+    acc_het2hom1.vw = vecw_setzero();
+    acc_het1hom2.vw = vecw_setzero();
+    for (uint32_t vec_idx = 0; vec_idx < kKingMultiplexVecs; vec_idx += 3) {
+      VecW hom1 = first_hom[vec_idx];
+      VecW hom2 = second_hom[vec_idx];
+      VecW ref2het1 = first_ref2het[vec_idx];
+      VecW ref2het2 = second_ref2het[vec_idx];
+      VecW het1 = vecw_and_notfirst(hom1, ref2het1);
+      VecW het2 = vecw_and_notfirst(hom2, ref2het2);
+      VecW agg_ibs0 = (ref2het1 ^ ref2het2) & (hom1 & hom2);
+      VecW agg_hethet = het1 & het2;
+      VecW agg_het2hom1 = hom1 & het2;
+      VecW agg_het1hom2 = hom2 & het1;
+      agg_ibs0 = agg_ibs0 - (vecw_srli(agg_ibs0, 1) & m1);
+      agg_hethet = agg_hethet - (vecw_srli(agg_hethet, 1) & m1);
+      agg_het2hom1 = agg_het2hom1 - (vecw_srli(agg_het2hom1, 1) & m1);
+      agg_het1hom2 = agg_het1hom2 - (vecw_srli(agg_het1hom2, 1) & m1);
+      agg_ibs0 = (agg_ibs0 & m2) + (vecw_srli(agg_ibs0, 2) & m2);
+      agg_hethet = (agg_hethet & m2) + (vecw_srli(agg_hethet, 2) & m2);
+      agg_het2hom1 = (agg_het2hom1 & m2) + (vecw_srli(agg_het2hom1, 2) & m2);
+      agg_het1hom2 = (agg_het1hom2 & m2) + (vecw_srli(agg_het1hom2, 2) & m2);
+
+      for (uint32_t offset = 1; offset != 3; ++offset) {
+        hom1 = first_hom[vec_idx + offset];
+        hom2 = second_hom[vec_idx + offset];
+        ref2het1 = first_ref2het[vec_idx + offset];
+        ref2het2 = second_ref2het[vec_idx + offset];
+        het1 = vecw_and_notfirst(hom1, ref2het1);
+        het2 = vecw_and_notfirst(hom2, ref2het2);
+        VecW cur_ibs0 = (ref2het1 ^ ref2het2) & (hom1 & hom2);
+        VecW cur_hethet = het1 & het2;
+        VecW cur_het2hom1 = hom1 & het2;
+        VecW cur_het1hom2 = hom2 & het1;
+        cur_ibs0 = cur_ibs0 - (vecw_srli(cur_ibs0, 1) & m1);
+        cur_hethet = cur_hethet - (vecw_srli(cur_hethet, 1) & m1);
+        cur_het2hom1 = cur_het2hom1 - (vecw_srli(cur_het2hom1, 1) & m1);
+        cur_het1hom2 = cur_het1hom2 - (vecw_srli(cur_het1hom2, 1) & m1);
+        agg_ibs0 += (cur_ibs0 & m2) + (vecw_srli(cur_ibs0, 2) & m2);
+        agg_hethet += (cur_hethet & m2) + (vecw_srli(cur_hethet, 2) & m2);
+        agg_het2hom1 += (cur_het2hom1 & m2) + (vecw_srli(cur_het2hom1, 2) & m2);
+        agg_het1hom2 += (cur_het1hom2 & m2) + (vecw_srli(cur_het1hom2, 2) & m2);
+      }
+      acc_ibs0.vw = acc_ibs0.vw + (agg_ibs0 & m4) + (vecw_srli(agg_ibs0, 4) & m4);
+      acc_hethet.vw = acc_hethet.vw + (agg_hethet & m4) + (vecw_srli(agg_hethet, 4) & m4);
+      acc_het2hom1.vw = acc_het2hom1.vw + (agg_het2hom1 & m4) + (vecw_srli(agg_het2hom1, 4) & m4);
+      acc_het1hom2.vw = acc_het1hom2.vw + (agg_het1hom2 & m4) + (vecw_srli(agg_het1hom2, 4) & m4);
+    }
+    const VecW m8 = VCONST_W(kMask00FF);
+    acc_ibs0.vw = (acc_ibs0.vw & m8) + (vecw_srli(acc_ibs0.vw, 8) & m8);
+    acc_hethet.vw = (acc_hethet.vw & m8) + (vecw_srli(acc_hethet.vw, 8) & m8);
+    acc_het2hom1.vw = (acc_het2hom1.vw & m8) + (vecw_srli(acc_het2hom1.vw, 8) & m8);
+    acc_het1hom2.vw = (acc_het1hom2.vw & m8) + (vecw_srli(acc_het1hom2.vw, 8) & m8);
+    *king_counts_iter++ += UniVecHsum16(acc_ibs0);
+    *king_counts_iter++ += UniVecHsum16(acc_hethet);
+    *king_counts_iter++ += UniVecHsum16(acc_het2hom1);
+    *king_counts_iter++ += UniVecHsum16(acc_het1hom2);
+  }
+}
+
+static void IncrKingSubsetHomhom(const uint32_t* loaded_sample_idx_pairs, const uintptr_t* smaj_hom, const uintptr_t* smaj_ref2het, uint32_t start_idx, uint32_t end_idx, uint32_t* king_counts) {
+  const VecW m1 = VCONST_W(kMask5555);
+  const VecW m2 = VCONST_W(kMask3333);
+  const VecW m4 = VCONST_W(kMask0F0F);
+  const uint32_t* sample_idx_pair_iter = &(loaded_sample_idx_pairs[(2 * k1LU) * start_idx]);
+  const uint32_t* sample_idx_pair_stop = &(loaded_sample_idx_pairs[(2 * k1LU) * end_idx]);
+  uint32_t* king_counts_iter = &(king_counts[(5 * k1LU) * start_idx]);
+  while (sample_idx_pair_iter != sample_idx_pair_stop) {
+    // technically overflows for huge sample_ct
+    const uint32_t first_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
+    const uint32_t second_offset = (*sample_idx_pair_iter++) * kKingMultiplexWords;
+    const VecW* first_hom = R_CAST(const VecW*, &(smaj_hom[first_offset]));
+    const VecW* first_ref2het = R_CAST(const VecW*, &(smaj_ref2het[first_offset]));
+    const VecW* second_hom = R_CAST(const VecW*, &(smaj_hom[second_offset]));
+    const VecW* second_ref2het = R_CAST(const VecW*, &(smaj_ref2het[second_offset]));
+    UniVec acc_homhom;
+    UniVec acc_ibs0;
+    UniVec acc_hethet;
+    UniVec acc_het2hom1;
+    UniVec acc_het1hom2;
+    acc_homhom.vw = vecw_setzero();
+    acc_ibs0.vw = vecw_setzero();
+    acc_hethet.vw = vecw_setzero();
+    acc_het2hom1.vw = vecw_setzero();
+    acc_het1hom2.vw = vecw_setzero();
+    for (uint32_t vec_idx = 0; vec_idx < kKingMultiplexVecs; vec_idx += 3) {
+      VecW hom1 = first_hom[vec_idx];
+      VecW hom2 = second_hom[vec_idx];
+      VecW ref2het1 = first_ref2het[vec_idx];
+      VecW ref2het2 = second_ref2het[vec_idx];
+      VecW agg_homhom = hom1 & hom2;
+      VecW het1 = vecw_and_notfirst(hom1, ref2het1);
+      VecW het2 = vecw_and_notfirst(hom2, ref2het2);
+      VecW agg_ibs0 = (ref2het1 ^ ref2het2) & agg_homhom;
+      VecW agg_hethet = het1 & het2;
+      VecW agg_het2hom1 = hom1 & het2;
+      VecW agg_het1hom2 = hom2 & het1;
+      agg_homhom = agg_homhom - (vecw_srli(agg_homhom, 1) & m1);
+      agg_ibs0 = agg_ibs0 - (vecw_srli(agg_ibs0, 1) & m1);
+      agg_hethet = agg_hethet - (vecw_srli(agg_hethet, 1) & m1);
+      agg_het2hom1 = agg_het2hom1 - (vecw_srli(agg_het2hom1, 1) & m1);
+      agg_het1hom2 = agg_het1hom2 - (vecw_srli(agg_het1hom2, 1) & m1);
+      agg_homhom = (agg_homhom & m2) + (vecw_srli(agg_homhom, 2) & m2);
+      agg_ibs0 = (agg_ibs0 & m2) + (vecw_srli(agg_ibs0, 2) & m2);
+      agg_hethet = (agg_hethet & m2) + (vecw_srli(agg_hethet, 2) & m2);
+      agg_het2hom1 = (agg_het2hom1 & m2) + (vecw_srli(agg_het2hom1, 2) & m2);
+      agg_het1hom2 = (agg_het1hom2 & m2) + (vecw_srli(agg_het1hom2, 2) & m2);
+
+      for (uint32_t offset = 1; offset != 3; ++offset) {
+        hom1 = first_hom[vec_idx + offset];
+        hom2 = second_hom[vec_idx + offset];
+        ref2het1 = first_ref2het[vec_idx + offset];
+        ref2het2 = second_ref2het[vec_idx + offset];
+        VecW cur_homhom = hom1 & hom2;
+        het1 = vecw_and_notfirst(hom1, ref2het1);
+        het2 = vecw_and_notfirst(hom2, ref2het2);
+        VecW cur_ibs0 = (ref2het1 ^ ref2het2) & cur_homhom;
+        VecW cur_hethet = het1 & het2;
+        VecW cur_het2hom1 = hom1 & het2;
+        VecW cur_het1hom2 = hom2 & het1;
+        cur_homhom = cur_homhom - (vecw_srli(cur_homhom, 1) & m1);
+        cur_ibs0 = cur_ibs0 - (vecw_srli(cur_ibs0, 1) & m1);
+        cur_hethet = cur_hethet - (vecw_srli(cur_hethet, 1) & m1);
+        cur_het2hom1 = cur_het2hom1 - (vecw_srli(cur_het2hom1, 1) & m1);
+        cur_het1hom2 = cur_het1hom2 - (vecw_srli(cur_het1hom2, 1) & m1);
+        agg_homhom += (cur_homhom & m2) + (vecw_srli(cur_homhom, 2) & m2);
+        agg_ibs0 += (cur_ibs0 & m2) + (vecw_srli(cur_ibs0, 2) & m2);
+        agg_hethet += (cur_hethet & m2) + (vecw_srli(cur_hethet, 2) & m2);
+        agg_het2hom1 += (cur_het2hom1 & m2) + (vecw_srli(cur_het2hom1, 2) & m2);
+        agg_het1hom2 += (cur_het1hom2 & m2) + (vecw_srli(cur_het1hom2, 2) & m2);
+      }
+      acc_homhom.vw = acc_homhom.vw + (agg_homhom & m4) + (vecw_srli(agg_homhom, 4) & m4);
+      acc_ibs0.vw = acc_ibs0.vw + (agg_ibs0 & m4) + (vecw_srli(agg_ibs0, 4) & m4);
+      acc_hethet.vw = acc_hethet.vw + (agg_hethet & m4) + (vecw_srli(agg_hethet, 4) & m4);
+      acc_het2hom1.vw = acc_het2hom1.vw + (agg_het2hom1 & m4) + (vecw_srli(agg_het2hom1, 4) & m4);
+      acc_het1hom2.vw = acc_het1hom2.vw + (agg_het1hom2 & m4) + (vecw_srli(agg_het1hom2, 4) & m4);
+    }
+    const VecW m8 = VCONST_W(kMask00FF);
+    acc_homhom.vw = (acc_homhom.vw & m8) + (vecw_srli(acc_homhom.vw, 8) & m8);
+    acc_ibs0.vw = (acc_ibs0.vw & m8) + (vecw_srli(acc_ibs0.vw, 8) & m8);
+    acc_hethet.vw = (acc_hethet.vw & m8) + (vecw_srli(acc_hethet.vw, 8) & m8);
+    acc_het2hom1.vw = (acc_het2hom1.vw & m8) + (vecw_srli(acc_het2hom1.vw, 8) & m8);
+    acc_het1hom2.vw = (acc_het1hom2.vw & m8) + (vecw_srli(acc_het1hom2.vw, 8) & m8);
+    *king_counts_iter++ += UniVecHsum16(acc_ibs0);
+    *king_counts_iter++ += UniVecHsum16(acc_hethet);
+    *king_counts_iter++ += UniVecHsum16(acc_het2hom1);
+    *king_counts_iter++ += UniVecHsum16(acc_het1hom2);
+    *king_counts_iter++ += UniVecHsum16(acc_homhom);
+  }
+}
+#endif
+
+#ifdef USE_AVX512_POPCNT
+// The trailing partial vector is handled with masked loads, which don't fault
+// on the masked-out words.
+static inline __mmask8 LdTailMask(uintptr_t word_ct) {
+  return S_CAST(__mmask8, (1U << (word_ct % 8)) - 1);
+}
+
+static int32_t DotprodWords(const uintptr_t* __restrict hom1, const uintptr_t* __restrict ref2het1, const uintptr_t* __restrict hom2, const uintptr_t* __restrict ref2het2, uintptr_t word_ct) {
+  // popcount(hom1 & hom2) - 2 * popcount(hom1 & hom2 & (ref2het1 ^ ref2het2))
+  __m512i acc_both = _mm512_setzero_si512();
+  __m512i acc_neg = _mm512_setzero_si512();
+  const uintptr_t fullvec_word_ct = RoundDownPow2(word_ct, 8);
+  for (uintptr_t widx = 0; widx != fullvec_word_ct; widx += 8) {
+    const __m512i hom_both = _mm512_and_si512(_mm512_loadu_si512(&(hom1[widx])), _mm512_loadu_si512(&(hom2[widx])));
+    const __m512i cur_xor = _mm512_xor_si512(_mm512_loadu_si512(&(ref2het1[widx])), _mm512_loadu_si512(&(ref2het2[widx])));
+    acc_both = _mm512_add_epi64(acc_both, _mm512_popcnt_epi64(hom_both));
+    acc_neg = _mm512_add_epi64(acc_neg, _mm512_popcnt_epi64(_mm512_and_si512(hom_both, cur_xor)));
+  }
+  if (fullvec_word_ct != word_ct) {
+    const __mmask8 tail_mask = LdTailMask(word_ct);
+    const __m512i hom_both = _mm512_and_si512(_mm512_maskz_loadu_epi64(tail_mask, &(hom1[fullvec_word_ct])), _mm512_maskz_loadu_epi64(tail_mask, &(hom2[fullvec_word_ct])));
+    const __m512i cur_xor = _mm512_xor_si512(_mm512_maskz_loadu_epi64(tail_mask, &(ref2het1[fullvec_word_ct])), _mm512_maskz_loadu_epi64(tail_mask, &(ref2het2[fullvec_word_ct])));
+    acc_both = _mm512_add_epi64(acc_both, _mm512_popcnt_epi64(hom_both));
+    acc_neg = _mm512_add_epi64(acc_neg, _mm512_popcnt_epi64(_mm512_and_si512(hom_both, cur_xor)));
+  }
+  return S_CAST(int32_t, ZmmHsum64(acc_both) - 2 * ZmmHsum64(acc_neg));
+}
+
+static void SumSsqWords(const uintptr_t* hom1, const uintptr_t* ref2het1, const uintptr_t* hom2, const uintptr_t* ref2het2, uint32_t word_ct, int32_t* sum2_ptr, uint32_t* ssq2_ptr) {
+  // popcounts (nm1 & hom2) and (nm1 & hom2 & ref2het2)
+  __m512i acc_ssq2 = _mm512_setzero_si512();
+  __m512i acc_plus2 = _mm512_setzero_si512();
+  const uint32_t fullvec_word_ct = RoundDownPow2(word_ct, 8);
+  for (uint32_t widx = 0; widx != fullvec_word_ct; widx += 8) {
+    const __m512i nm1 = _mm512_or_si512(_mm512_loadu_si512(&(hom1[widx])), _mm512_loadu_si512(&(ref2het1[widx])));
+    const __m512i cur_ssq2 = _mm512_and_si512(nm1, _mm512_loadu_si512(&(hom2[widx])));
+    acc_ssq2 = _mm512_add_epi64(acc_ssq2, _mm512_popcnt_epi64(cur_ssq2));
+    acc_plus2 = _mm512_add_epi64(acc_plus2, _mm512_popcnt_epi64(_mm512_and_si512(cur_ssq2, _mm512_loadu_si512(&(ref2het2[widx])))));
+  }
+  if (fullvec_word_ct != word_ct) {
+    const __mmask8 tail_mask = LdTailMask(word_ct);
+    const __m512i nm1 = _mm512_or_si512(_mm512_maskz_loadu_epi64(tail_mask, &(hom1[fullvec_word_ct])), _mm512_maskz_loadu_epi64(tail_mask, &(ref2het1[fullvec_word_ct])));
+    const __m512i cur_ssq2 = _mm512_and_si512(nm1, _mm512_maskz_loadu_epi64(tail_mask, &(hom2[fullvec_word_ct])));
+    acc_ssq2 = _mm512_add_epi64(acc_ssq2, _mm512_popcnt_epi64(cur_ssq2));
+    acc_plus2 = _mm512_add_epi64(acc_plus2, _mm512_popcnt_epi64(_mm512_and_si512(cur_ssq2, _mm512_maskz_loadu_epi64(tail_mask, &(ref2het2[fullvec_word_ct])))));
+  }
+  const uint32_t ssq2 = ZmmHsum64(acc_ssq2);
+  const uint32_t plus2 = ZmmHsum64(acc_plus2);
+  *sum2_ptr = S_CAST(int32_t, 2 * plus2 - ssq2);  // deliberate overflow
+  *ssq2_ptr = ssq2;
+}
+
+static void SumSsqNmWords(const uintptr_t* hom1, const uintptr_t* ref2het1, const uintptr_t* hom2, const uintptr_t* ref2het2, uint32_t word_ct, uint32_t* __restrict nm_ptr, int32_t* sum2_ptr, uint32_t* __restrict ssq2_ptr) {
+  __m512i acc_nm = _mm512_setzero_si512();
+  __m512i acc_ssq2 = _mm512_setzero_si512();
+  __m512i acc_plus2 = _mm512_setzero_si512();
+  const uint32_t fullvec_word_ct = RoundDownPow2(word_ct, 8);
+  for (uint32_t widx = 0; widx != fullvec_word_ct; widx += 8) {
+    const __m512i nm1 = _mm512_or_si512(_mm512_loadu_si512(&(hom1[widx])), _mm512_loadu_si512(&(ref2het1[widx])));
+    const __m512i cur_hom2 = _mm512_loadu_si512(&(hom2[widx]));
+    const __m512i cur_ref2het2 = _mm512_loadu_si512(&(ref2het2[widx]));
+    const __m512i cur_ssq2 = _mm512_and_si512(nm1, cur_hom2);
+    acc_nm = _mm512_add_epi64(acc_nm, _mm512_popcnt_epi64(_mm512_and_si512(nm1, _mm512_or_si512(cur_hom2, cur_ref2het2))));
+    acc_ssq2 = _mm512_add_epi64(acc_ssq2, _mm512_popcnt_epi64(cur_ssq2));
+    acc_plus2 = _mm512_add_epi64(acc_plus2, _mm512_popcnt_epi64(_mm512_and_si512(cur_ssq2, cur_ref2het2)));
+  }
+  if (fullvec_word_ct != word_ct) {
+    const __mmask8 tail_mask = LdTailMask(word_ct);
+    const __m512i nm1 = _mm512_or_si512(_mm512_maskz_loadu_epi64(tail_mask, &(hom1[fullvec_word_ct])), _mm512_maskz_loadu_epi64(tail_mask, &(ref2het1[fullvec_word_ct])));
+    const __m512i cur_hom2 = _mm512_maskz_loadu_epi64(tail_mask, &(hom2[fullvec_word_ct]));
+    const __m512i cur_ref2het2 = _mm512_maskz_loadu_epi64(tail_mask, &(ref2het2[fullvec_word_ct]));
+    const __m512i cur_ssq2 = _mm512_and_si512(nm1, cur_hom2);
+    acc_nm = _mm512_add_epi64(acc_nm, _mm512_popcnt_epi64(_mm512_and_si512(nm1, _mm512_or_si512(cur_hom2, cur_ref2het2))));
+    acc_ssq2 = _mm512_add_epi64(acc_ssq2, _mm512_popcnt_epi64(cur_ssq2));
+    acc_plus2 = _mm512_add_epi64(acc_plus2, _mm512_popcnt_epi64(_mm512_and_si512(cur_ssq2, cur_ref2het2)));
+  }
+  const uint32_t ssq2 = ZmmHsum64(acc_ssq2);
+  const uint32_t plus2 = ZmmHsum64(acc_plus2);
+  *nm_ptr = ZmmHsum64(acc_nm);
+  *sum2_ptr = S_CAST(int32_t, 2 * plus2 - ssq2);  // deliberate overflow
+  *ssq2_ptr = ssq2;
+}
+#else  // !USE_AVX512_POPCNT
+// LD buffers are only guaranteed to be aligned to the baseline build's vector
+// width, so the dispatched LD kernels use unaligned loads.
+static inline VecW LdVecLoad(const uintptr_t* word_iter, uintptr_t vec_idx) {
+  return vecw_loadu(&(word_iter[vec_idx * kWordsPerVec]));
+}
+
+#  ifdef USE_AVX2
+// todo: see if either approach in avx_jaccard_index.c in
+// github.com/CountOnes/hamming_weight helps here.
+
+static inline int32_t DotprodAvx2(const uintptr_t* __restrict hom1_iter, const uintptr_t* __restrict ref2het1_iter, const uintptr_t* __restrict hom2_iter, const uintptr_t* __restrict ref2het2_iter, uintptr_t vec_ct) {
+  // popcount(hom1 & hom2) - 2 * popcount(hom1 & hom2 & (ref2het1 ^ ref2het2))
+  // ct must be a multiple of 4.
+  VecW cnt = vecw_setzero();
+  VecW ones_both = vecw_setzero();
+  VecW ones_neg = vecw_setzero();
+  VecW twos_both = vecw_setzero();
+  VecW twos_neg = vecw_setzero();
+  for (uintptr_t vec_idx = 0; vec_idx < vec_ct; vec_idx += 4) {
+    VecW count1_both = LdVecLoad(hom1_iter, vec_idx) & LdVecLoad(hom2_iter, vec_idx);
+    VecW cur_xor = LdVecLoad(ref2het1_iter, vec_idx) ^ LdVecLoad(ref2het2_iter, vec_idx);
+    VecW count1_neg = count1_both & cur_xor;
+
+    VecW count2_both = LdVecLoad(hom1_iter, vec_idx + 1) & LdVecLoad(hom2_iter, vec_idx + 1);
+    cur_xor = LdVecLoad(ref2het1_iter, vec_idx + 1) ^ LdVecLoad(ref2het2_iter, vec_idx + 1);
+    VecW count2_neg = count2_both & cur_xor;
+    const VecW twos_both_a = Csa256(count1_both, count2_both, &ones_both);
+    const VecW twos_neg_a = Csa256(count1_neg, count2_neg, &ones_neg);
+
+    count1_both = LdVecLoad(hom1_iter, vec_idx + 2) & LdVecLoad(hom2_iter, vec_idx + 2);
+    cur_xor = LdVecLoad(ref2het1_iter, vec_idx + 2) ^ LdVecLoad(ref2het2_iter, vec_idx + 2);
+    count1_neg = count1_both & cur_xor;
+
+    count2_both = LdVecLoad(hom1_iter, vec_idx + 3) & LdVecLoad(hom2_iter, vec_idx + 3);
+    cur_xor = LdVecLoad(ref2het1_iter, vec_idx + 3) ^ LdVecLoad(ref2het2_iter, vec_idx + 3);
+    count2_neg = count2_both & cur_xor;
+    const VecW twos_both_b = Csa256(count1_both, count2_both, &ones_both);
+    const VecW twos_neg_b = Csa256(count1_neg, count2_neg, &ones_neg);
+    const VecW fours_both = Csa256(twos_both_a, twos_both_b, &twos_both);
+    const VecW fours_neg = Csa256(twos_neg_a, twos_neg_b, &twos_neg);
+    // tried continuing to eights, not worth it
+    // deliberate unsigned-int64 overflow here
+    cnt = cnt + PopcountVecAvx2(fours_both) - vecw_slli(PopcountVecAvx2(fours_neg), 1);
+  }
+  cnt = cnt - PopcountVecAvx2(twos_neg);
+  cnt = vecw_slli(cnt, 2);
+  const VecW twos_sum = PopcountVecAvx2(twos_both) - PopcountVecAvx2(ones_neg);
+  cnt = cnt + vecw_slli(twos_sum, 1);
+  cnt = cnt + PopcountVecAvx2(ones_both);
+  return HsumW(cnt);
+}
+
+static int32_t DotprodWords(const uintptr_t* __restrict hom1, const uintptr_t* __restrict ref2het1, const uintptr_t* __restrict hom2, const uintptr_t* __restrict ref2het2, uintptr_t word_ct) {
+  int32_t tot_both = 0;
+  uint32_t widx = 0;
+  if (word_ct >= 16) { // this already pays off with a single block
+    const uintptr_t block_ct = word_ct / (kWordsPerVec * 4);
+    tot_both = DotprodAvx2(hom1, ref2het1, hom2, ref2het2, block_ct * 4);
+    widx = block_ct * (4 * kWordsPerVec);
+  }
+  uint32_t tot_neg = 0;
+  for (; widx != word_ct; ++widx) {
+    const uintptr_t hom_word = hom1[widx] & hom2[widx];
+    const uintptr_t xor_word = ref2het1[widx] ^ ref2het2[widx];
+    tot_both += PopcountWord(hom_word);
+    tot_neg += PopcountWord(hom_word & xor_word);
+  }
+  return tot_both - 2 * tot_neg;
+}
+
+static inline void SumSsqAvx2(const uintptr_t* __restrict hom1_iter, const uintptr_t* __restrict ref2het1_iter, const uintptr_t* __restrict hom2_iter, const uintptr_t* __restrict ref2het2_iter, uintptr_t vec_ct, uint32_t* __restrict ssq2_ptr, uint32_t* __restrict plus2_ptr) {
+  // popcounts (nm1 & hom2) and (nm1 & hom2 & ref2het2).  ct is multiple of 8.
+  VecW cnt_ssq = vecw_setzero();
+  VecW cnt_plus = vecw_setzero();
+  VecW ones_ssq = vecw_setzero();
+  VecW ones_plus = vecw_setzero();
+  VecW twos_ssq = vecw_setzero();
+  VecW twos_plus = vecw_setzero();
+  VecW fours_ssq = vecw_setzero();
+  VecW fours_plus = vecw_setzero();
+  for (uintptr_t vec_idx = 0; vec_idx < vec_ct; vec_idx += 8) {
+    VecW count1_ssq = (LdVecLoad(hom1_iter, vec_idx) | LdVecLoad(ref2het1_iter, vec_idx)) & LdVecLoad(hom2_iter, vec_idx);
+    VecW count1_plus = count1_ssq & LdVecLoad(ref2het2_iter, vec_idx);
+
+    VecW count2_ssq = (LdVecLoad(hom1_iter, vec_idx + 1) | LdVecLoad(ref2het1_iter, vec_idx + 1)) & LdVecLoad(hom2_iter, vec_idx + 1);
+    VecW count2_plus = count2_ssq & LdVecLoad(ref2het2_iter, vec_idx + 1);
+    VecW twos_ssq_a = Csa256(count1_ssq, count2_ssq, &ones_ssq);
+    VecW twos_plus_a = Csa256(count1_plus, count2_plus, &ones_plus);
+
+    count1_ssq = (LdVecLoad(hom1_iter, vec_idx + 2) | LdVecLoad(ref2het1_iter, vec_idx + 2)) & LdVecLoad(hom2_iter, vec_idx + 2);
+    count1_plus = count1_ssq & LdVecLoad(ref2het2_iter, vec_idx + 2);
+
+    count2_ssq = (LdVecLoad(hom1_iter, vec_idx + 3) | LdVecLoad(ref2het1_iter, vec_idx + 3)) & LdVecLoad(hom2_iter, vec_idx + 3);
+    count2_plus = count2_ssq & LdVecLoad(ref2het2_iter, vec_idx + 3);
+    VecW twos_ssq_b = Csa256(count1_ssq, count2_ssq, &ones_ssq);
+    VecW twos_plus_b = Csa256(count1_plus, count2_plus, &ones_plus);
+    const VecW fours_ssq_a = Csa256(twos_ssq_a, twos_ssq_b, &twos_ssq);
+    const VecW fours_plus_a = Csa256(twos_plus_a, twos_plus_b, &twos_plus);
+
+    count1_ssq = (LdVecLoad(hom1_iter, vec_idx + 4) | LdVecLoad(ref2het1_iter, vec_idx + 4)) & LdVecLoad(hom2_iter, vec_idx + 4);
+    count1_plus = count1_ssq & LdVecLoad(ref2het2_iter, vec_idx + 4);
+
+    count2_ssq = (LdVecLoad(hom1_iter, vec_idx + 5) | LdVecLoad(ref2het1_iter, vec_idx + 5)) & LdVecLoad(hom2_iter, vec_idx + 5);
+    count2_plus = count2_ssq & LdVecLoad(ref2het2_iter, vec_idx + 5);
+    twos_ssq_a = Csa256(count1_ssq, count2_ssq, &ones_ssq);
+    twos_plus_a = Csa256(count1_plus, count2_plus, &ones_plus);
+
+    count1_ssq = (LdVecLoad(hom1_iter, vec_idx + 6) | LdVecLoad(ref2het1_iter, vec_idx + 6)) & LdVecLoad(hom2_iter, vec_idx + 6);
+    count1_plus = count1_ssq & LdVecLoad(ref2het2_iter, vec_idx + 6);
+
+    count2_ssq = (LdVecLoad(hom1_iter, vec_idx + 7) | LdVecLoad(ref2het1_iter, vec_idx + 7)) & LdVecLoad(hom2_iter, vec_idx + 7);
+    count2_plus = count2_ssq & LdVecLoad(ref2het2_iter, vec_idx + 7);
+    twos_ssq_b = Csa256(count1_ssq, count2_ssq, &ones_ssq);
+    twos_plus_b = Csa256(count1_plus, count2_plus, &ones_plus);
+    const VecW fours_ssq_b = Csa256(twos_ssq_a, twos_ssq_b, &twos_ssq);
+    const VecW fours_plus_b = Csa256(twos_plus_a, twos_plus_b, &twos_plus);
+    const VecW eights_ssq = Csa256(fours_ssq_a, fours_ssq_b, &fours_ssq);
+    const VecW eights_plus = Csa256(fours_plus_a, fours_plus_b, &fours_plus);
+    // negligible benefit from going to sixteens here
+    cnt_ssq = cnt_ssq + PopcountVecAvx2(eights_ssq);
+    cnt_plus = cnt_plus + PopcountVecAvx2(eights_plus);
+  }
+  cnt_ssq = vecw_slli(cnt_ssq, 3);
+  cnt_plus = vecw_slli(cnt_plus, 3);
+  cnt_ssq = cnt_ssq + vecw_slli(PopcountVecAvx2(fours_ssq), 2);
+  cnt_plus = cnt_plus + vecw_slli(PopcountVecAvx2(fours_plus), 2);
+  cnt_ssq = cnt_ssq + vecw_slli(PopcountVecAvx2(twos_ssq), 1);
+  cnt_plus = cnt_plus + vecw_slli(PopcountVecAvx2(twos_plus), 1);
+  cnt_ssq = cnt_ssq + PopcountVecAvx2(ones_ssq);
+  cnt_plus = cnt_plus + PopcountVecAvx2(ones_plus);
+  *ssq2_ptr = HsumW(cnt_ssq);
+  *plus2_ptr = HsumW(cnt_plus);
+}
+
+static void SumSsqWords(const uintptr_t* hom1, const uintptr_t* ref2het1, const uintptr_t* hom2, const uintptr_t* ref2het2, uint32_t word_ct, int32_t* sum2_ptr, uint32_t* ssq2_ptr) {
+  uint32_t ssq2 = 0;
+  uint32_t plus2 = 0;
+  uint32_t widx = 0;
+  // this has high constant overhead at the end; may want to require more than
+  // one block?
+  if (word_ct >= 32) {
+    const uintptr_t block_ct = word_ct / (8 * kWordsPerVec);
+    SumSsqAvx2(hom1, ref2het1, hom2, ref2het2, block_ct * 8, &ssq2, &plus2);
+    widx = block_ct * (8 * kWordsPerVec);
+  }
+  for (; widx != word_ct; ++widx) {
+    const uintptr_t ssq2_word = (hom1[widx] | ref2het1[widx]) & hom2[widx];
+    ssq2 += PopcountWord(ssq2_word);
+    plus2 += PopcountWord(ssq2_word & ref2het2[widx]);
+  }
+  *sum2_ptr = S_CAST(int32_t, 2 * plus2 - ssq2);  // deliberate overflow
+  *ssq2_ptr = ssq2;
+}
+#  else  // !USE_AVX2
+static inline int32_t DotprodVecsNm(const uintptr_t* __restrict hom1_iter, const uintptr_t* __restrict ref2het1_iter, const uintptr_t* __restrict hom2_iter, const uintptr_t* __restrict ref2het2_iter, uintptr_t vec_ct) {
+  // popcount(hom1 & hom2) - 2 * popcount(hom1 & hom2 & (ref2het1 ^ ref2het2))
+  // ct must be a multiple of 3.
+  assert(!(vec_ct % 3));
+  const VecW m1 = VCONST_W(kMask5555);
+  const VecW m2 = VCONST_W(kMask3333);
+  const VecW m4 = VCONST_W(kMask0F0F);
+  VecW acc_both = vecw_setzero();
+  VecW acc_neg = vecw_setzero();
+  uintptr_t cur_incr = 30;
+  for (; ; vec_ct -= cur_incr) {
+    if (vec_ct < 30) {
+      if (!vec_ct) {
+        return HsumW(acc_both) - 2 * HsumW(acc_neg);
+      }
+      cur_incr = vec_ct;
+    }
+    VecW inner_acc_both = vecw_setzero();
+    VecW inner_acc_neg = vecw_setzero();
+    for (uint32_t vec_idx = 0; vec_idx < cur_incr; vec_idx += 3) {
+      VecW count1_both = LdVecLoad(hom1_iter, vec_idx) & LdVecLoad(hom2_iter, vec_idx);
+      VecW cur_xor = LdVecLoad(ref2het1_iter, vec_idx) ^ LdVecLoad(ref2het2_iter, vec_idx);
+      VecW count1_neg = count1_both & cur_xor;
+
+      VecW count2_both = LdVecLoad(hom1_iter, vec_idx + 1) & LdVecLoad(hom2_iter, vec_idx + 1);
+      cur_xor = LdVecLoad(ref2het1_iter, vec_idx + 1) ^ LdVecLoad(ref2het2_iter, vec_idx + 1);
+      VecW count2_neg = count2_both & cur_xor;
+
+      VecW cur_hom = LdVecLoad(hom1_iter, vec_idx + 2) & LdVecLoad(hom2_iter, vec_idx + 2);
+      cur_xor = LdVecLoad(ref2het1_iter, vec_idx + 2) ^ LdVecLoad(ref2het2_iter, vec_idx + 2);
+      VecW half1_neg = cur_hom & cur_xor;
+      const VecW half2_both = vecw_srli(cur_hom, 1) & m1;
+      const VecW half2_neg = vecw_srli(half1_neg, 1) & m1;
+      const VecW half1_both = cur_hom & m1;
+      half1_neg = half1_neg & m1;
+      count1_both = count1_both - (vecw_srli(count1_both, 1) & m1);
+      count1_neg = count1_neg - (vecw_srli(count1_neg, 1) & m1);
+      count2_both = count2_both - (vecw_srli(count2_both, 1) & m1);
+      count2_neg = count2_neg - (vecw_srli(count2_neg, 1) & m1);
+      count1_both = count1_both + half1_both;
+      count1_neg = count1_neg + half1_neg;
+      count2_both = count2_both + half2_both;
+      count2_neg = count2_neg + half2_neg;
+      count1_both = (count1_both & m2) + (vecw_srli(count1_both, 2) & m2);
+      count1_neg = (count1_neg & m2) + (vecw_srli(count1_neg, 2) & m2);
+      count1_both = count1_both + (count2_both & m2) + (vecw_srli(count2_both, 2) & m2);
+      count1_neg = count1_neg + (count2_neg & m2) + (vecw_srli(count2_neg, 2) & m2);
+      inner_acc_both = inner_acc_both + (count1_both & m4) + (vecw_srli(count1_both, 4) & m4);
+      inner_acc_neg = inner_acc_neg + (count1_neg & m4) + (vecw_srli(count1_neg, 4) & m4);
+    }
+    hom1_iter = &(hom1_iter[cur_incr * kWordsPerVec]);
+    ref2het1_iter = &(ref2het1_iter[cur_incr * kWordsPerVec]);
+    hom2_iter = &(hom2_iter[cur_incr * kWordsPerVec]);
+    ref2het2_iter = &(ref2het2_iter[cur_incr * kWordsPerVec]);
+    const VecW m0 = vecw_setzero();
+    acc_both = acc_both + vecw_bytesum(inner_acc_both, m0);
+    acc_neg = acc_neg + vecw_bytesum(inner_acc_neg, m0);
+  }
+}
+
+static int32_t DotprodWords(const uintptr_t* __restrict hom1, const uintptr_t* __restrict ref2het1, const uintptr_t* __restrict hom2, const uintptr_t* __restrict ref2het2, uintptr_t word_ct) {
+  int32_t tot_both = 0;
+  uint32_t widx = 0;
+  if (word_ct >= kWordsPerVec * 3) {
+    const uintptr_t block_ct = word_ct / (kWordsPerVec * 3);
+    tot_both = DotprodVecsNm(hom1, ref2het1, hom2, ref2het2, block_ct * 3);
+    widx = block_ct * (3 * kWordsPerVec);
+  }
+  uint32_t tot_neg = 0;
+  for (; widx != word_ct; ++widx) {
+    const uintptr_t hom_word = hom1[widx] & hom2[widx];
+    const uintptr_t xor_word = ref2het1[widx] ^ ref2het2[widx];
+    tot_both += PopcountWord(hom_word);
+    tot_neg += PopcountWord(hom_word & xor_word);
+  }
+  return tot_both - 2 * tot_neg;
+}
+
+#  ifndef USE_SSE42
+static inline void SumSsqVecs(const uintptr_t* __restrict hom1_iter, const uintptr_t* __restrict ref2het1_iter, const uintptr_t* __restrict hom2_iter, const uintptr_t* __restrict ref2het2_iter, uintptr_t vec_ct, uint32_t* __restrict ssq2_ptr, uint32_t* __restrict plus2_ptr) {
+  // popcounts (nm1 & hom2) and (nm1 & hom2 & ref2het2).  ct is multiple of 3.
+  assert(!(vec_ct % 3));
+  const VecW m1 = VCONST_W(kMask5555);
+  const VecW m2 = VCONST_W(kMask3333);
+  const VecW m4 = VCONST_W(kMask0F0F);
+  VecW acc_ssq2 = vecw_setzero();
+  VecW acc_plus2 = vecw_setzero();
+  uint32_t cur_incr = 30;
+  for (; ; vec_ct -= cur_incr) {
+    if (vec_ct < 30) {
+      if (!vec_ct) {
+        *ssq2_ptr = HsumW(acc_ssq2);
+        *plus2_ptr = HsumW(acc_plus2);
+        return;
+      }
+      cur_incr = vec_ct;
+    }
+    VecW inner_acc_ssq = vecw_setzero();
+    VecW inner_acc_plus = vecw_setzero();
+    for (uint32_t vec_idx = 0; vec_idx < cur_incr; vec_idx += 3) {
+      VecW count1_ssq = (LdVecLoad(hom1_iter, vec_idx) | LdVecLoad(ref2het1_iter, vec_idx)) & LdVecLoad(hom2_iter, vec_idx);
+      VecW count1_plus = count1_ssq & LdVecLoad(ref2het2_iter, vec_idx);
+
+      VecW count2_ssq = (LdVecLoad(hom1_iter, vec_idx + 1) | LdVecLoad(ref2het1_iter, vec_idx + 1)) & LdVecLoad(hom2_iter, vec_idx + 1);
+      VecW count2_plus = count2_ssq & LdVecLoad(ref2het2_iter, vec_idx + 1);
+
+      VecW half1_ssq = (LdVecLoad(hom1_iter, vec_idx + 2) | LdVecLoad(ref2het1_iter, vec_idx + 2)) & LdVecLoad(hom2_iter, vec_idx + 2);
+      VecW half1_plus = half1_ssq & LdVecLoad(ref2het2_iter, vec_idx + 2);
+      VecW half2_ssq = vecw_srli(half1_ssq, 1) & m1;
+      VecW half2_plus = vecw_srli(half1_plus, 1) & m1;
+      half1_ssq = half1_ssq & m1;
+      half1_plus = half1_plus & m1;
+      count1_ssq = count1_ssq - (vecw_srli(count1_ssq, 1) & m1);
+      count1_plus = count1_plus - (vecw_srli(count1_plus, 1) & m1);
+      count2_ssq = count2_ssq - (vecw_srli(count2_ssq, 1) & m1);
+      count2_plus = count2_plus - (vecw_srli(count2_plus, 1) & m1);
+      count1_ssq = count1_ssq + half1_ssq;
+      count1_plus = count1_plus + half1_plus;
+      count2_ssq = count2_ssq + half2_ssq;
+      count2_plus = count2_plus + half2_plus;
+      count1_ssq = (count1_ssq & m2) + (vecw_srli(count1_ssq, 2) & m2);
+      count1_plus = (count1_plus & m2) + (vecw_srli(count1_plus, 2) & m2);
+      count1_ssq = count1_ssq + (count2_ssq & m2) + (vecw_srli(count2_ssq, 2) & m2);
+      count1_plus = count1_plus + (count2_plus & m2) + (vecw_srli(count2_plus, 2) & m2);
+      inner_acc_ssq = inner_acc_ssq + (count1_ssq & m4) + (vecw_srli(count1_ssq, 4) & m4);
+      inner_acc_plus = inner_acc_plus + (count1_plus & m4) + (vecw_srli(count1_plus, 4) & m4);
+    }
+    hom1_iter = &(hom1_iter[cur_incr * kWordsPerVec]);
+    ref2het1_iter = &(ref2het1_iter[cur_incr * kWordsPerVec]);
+    hom2_iter = &(hom2_iter[cur_incr * kWordsPerVec]);
+    ref2het2_iter = &(ref2het2_iter[cur_incr * kWordsPerVec]);
+    const VecW m0 = vecw_setzero();
+    acc_ssq2 = acc_ssq2 + vecw_bytesum(inner_acc_ssq, m0);
+    acc_plus2 = acc_plus2 + vecw_bytesum(inner_acc_plus, m0);
+  }
+}
+#  endif
+
+static void SumSsqWords(const uintptr_t* hom1, const uintptr_t* ref2het1, const uintptr_t* hom2, const uintptr_t* ref2het2, uint32_t word_ct, int32_t* sum2_ptr, uint32_t* ssq2_ptr) {
+  uint32_t ssq2 = 0;
+  uint32_t plus2 = 0;
+  uint32_t widx = 0;
+#  ifndef USE_SSE42
+  if (word_ct >= kWordsPerVec * 3) {
+    const uintptr_t block_ct = word_ct / (kWordsPerVec * 3);
+    SumSsqVecs(hom1, ref2het1, hom2, ref2het2, block_ct * 3, &ssq2, &plus2);
+    widx = block_ct * (3 * kWordsPerVec);
+  }
+#  endif
+  for (; widx != word_ct; ++widx) {
+    const uintptr_t ssq2_word = (hom1[widx] | ref2het1[widx]) & hom2[widx];
+    ssq2 += PopcountWord(ssq2_word);
+    plus2 += PopcountWord(ssq2_word & ref2het2[widx]);
+  }
+  *sum2_ptr = S_CAST(int32_t, 2 * plus2 - ssq2);  // deliberate overflow
+  *ssq2_ptr = ssq2;
+}
+#  endif  // !USE_AVX2
+
+#  if defined(USE_AVX2) || !defined(USE_SSE42)
+static inline void SumSsqNmVecs(const uintptr_t* __restrict hom1_iter, const uintptr_t* __restrict ref2het1_iter, const uintptr_t* __restrict hom2_iter, const uintptr_t* __restrict ref2het2_iter, uintptr_t vec_ct, uint32_t* __restrict nm_ptr, uint32_t* __restrict ssq2_ptr, uint32_t* __restrict plus2_ptr) {
+  // vec_ct must be a multiple of 3.
+  assert(!(vec_ct % 3));
+  const VecW m1 = VCONST_W(kMask5555);
+  const VecW m2 = VCONST_W(kMask3333);
+  const VecW m4 = VCONST_W(kMask0F0F);
+  VecW acc_nm = vecw_setzero();
+  VecW acc_ssq2 = vecw_setzero();
+  VecW acc_plus2 = vecw_setzero();
+  uint32_t cur_incr = 30;
+  for (; ; vec_ct -= cur_incr) {
+    if (vec_ct < 30) {
+      if (!vec_ct) {
+        *nm_ptr = HsumW(acc_nm);
+        *ssq2_ptr = HsumW(acc_ssq2);
+        *plus2_ptr = HsumW(acc_plus2);
+        return;
+      }
+      cur_incr = vec_ct;
+    }
+    VecW inner_acc_nm = vecw_setzero();
+    VecW inner_acc_ssq = vecw_setzero();
+    VecW inner_acc_plus = vecw_setzero();
+    for (uint32_t vec_idx = 0; vec_idx < cur_incr; vec_idx += 3) {
+      VecW nm1 = LdVecLoad(hom1_iter, vec_idx) | LdVecLoad(ref2het1_iter, vec_idx);
+      VecW hom2 = LdVecLoad(hom2_iter, vec_idx);
+      VecW ref2het2 = LdVecLoad(ref2het2_iter, vec_idx);
+      VecW count1_ssq = nm1 & hom2;
+      VecW count1_nm = nm1 & (hom2 | ref2het2);
+      VecW count1_plus = count1_ssq & ref2het2;
+
+      nm1 = LdVecLoad(hom1_iter, vec_idx + 1) | LdVecLoad(ref2het1_iter, vec_idx + 1);
+      hom2 = LdVecLoad(hom2_iter, vec_idx + 1);
+      ref2het2 = LdVecLoad(ref2het2_iter, vec_idx + 1);
+      VecW count2_ssq = nm1 & hom2;
+      VecW count2_nm = nm1 & (hom2 | ref2het2);
+      VecW count2_plus = count2_ssq & ref2het2;
+
+      nm1 = LdVecLoad(hom1_iter, vec_idx + 2) | LdVecLoad(ref2het1_iter, vec_idx + 2);
+      hom2 = LdVecLoad(hom2_iter, vec_idx + 2);
+      ref2het2 = LdVecLoad(ref2het2_iter, vec_idx + 2);
+      VecW half_a_ssq = nm1 & hom2;
+      VecW half_a_nm = nm1 & (hom2 | ref2het2);
+      VecW half_a_plus = half_a_ssq & ref2het2;
+      const VecW half_b_ssq = vecw_srli(half_a_ssq, 1) & m1;
+      const VecW half_b_nm = vecw_srli(half_a_nm, 1) & m1;
+      const VecW half_b_plus = vecw_srli(half_a_plus, 1) & m1;
+      half_a_ssq = half_a_ssq & m1;
+      half_a_nm = half_a_nm & m1;
+      half_a_plus = half_a_plus & m1;
+      count1_ssq = count1_ssq - (vecw_srli(count1_ssq, 1) & m1);
+      count1_nm = count1_nm - (vecw_srli(count1_nm, 1) & m1);
+      count1_plus = count1_plus - (vecw_srli(count1_plus, 1) & m1);
+      count2_ssq = count2_ssq - (vecw_srli(count2_ssq, 1) & m1);
+      count2_nm = count2_nm - (vecw_srli(count2_nm, 1) & m1);
+      count2_plus = count2_plus - (vecw_srli(count2_plus, 1) & m1);
+      count1_ssq = count1_ssq + half_a_ssq;
+      count1_nm = count1_nm + half_a_nm;
+      count1_plus = count1_plus + half_a_plus;
+      count2_ssq = count2_ssq + half_b_ssq;
+      count2_nm = count2_nm + half_b_nm;
+      count2_plus = count2_plus + half_b_plus;
+      count1_ssq = (count1_ssq & m2) + (vecw_srli(count1_ssq, 2) & m2);
+      count1_nm = (count1_nm & m2) + (vecw_srli(count1_nm, 2) & m2);
+      count1_plus = (count1_plus & m2) + (vecw_srli(count1_plus, 2) & m2);
+      count1_ssq = count1_ssq + (count2_ssq & m2) + (vecw_srli(count2_ssq, 2) & m2);
+      count1_nm = count1_nm + (count2_nm & m2) + (vecw_srli(count2_nm, 2) & m2);
+      count1_plus = count1_plus + (count2_plus & m2) + (vecw_srli(count2_plus, 2) & m2);
+      inner_acc_nm = inner_acc_nm + (count1_nm & m4) + (vecw_srli(count1_nm, 4) & m4);
+      inner_acc_ssq = inner_acc_ssq + (count1_ssq & m4) + (vecw_srli(count1_ssq, 4) & m4);
+      inner_acc_plus = inner_acc_plus + (count1_plus & m4) + (vecw_srli(count1_plus, 4) & m4);
+    }
+    hom1_iter = &(hom1_iter[cur_incr * kWordsPerVec]);
+    ref2het1_iter = &(ref2het1_iter[cur_incr * kWordsPerVec]);
+    hom2_iter = &(hom2_iter[cur_incr * kWordsPerVec]);
+    ref2het2_iter = &(ref2het2_iter[cur_incr * kWordsPerVec]);
+    const VecW m0 = vecw_setzero();
+    acc_nm = acc_nm + vecw_bytesum(inner_acc_nm, m0);
+    acc_ssq2 = acc_ssq2 + vecw_bytesum(inner_acc_ssq, m0);
+    acc_plus2 = acc_plus2 + vecw_bytesum(inner_acc_plus, m0);
+  }
+}
+#  endif  // __LP64__
+
+static void SumSsqNmWords(const uintptr_t* hom1, const uintptr_t* ref2het1, const uintptr_t* hom2, const uintptr_t* ref2het2, uint32_t word_ct, uint32_t* __restrict nm_ptr, int32_t* sum2_ptr, uint32_t* __restrict ssq2_ptr) {
+  uint32_t nm = 0;
+  uint32_t ssq2 = 0;
+  uint32_t plus2 = 0;
+  uint32_t widx = 0;
+#  if defined(USE_AVX2) || !defined(USE_SSE42)
+  if (word_ct >= 3 * kWordsPerVec) {
+    const uintptr_t block_ct = word_ct / (3 * kWordsPerVec);
+    SumSsqNmVecs(hom1, ref2het1, hom2, ref2het2, block_ct * 3, &nm, &ssq2, &plus2);
+    widx = block_ct * (3 * kWordsPerVec);
+  }
+#  endif
+  for (; widx != word_ct; ++widx) {
+    const uintptr_t nm1_word = hom1[widx] | ref2het1[widx];
+    const uintptr_t hom2_word = hom2[widx];
+    const uintptr_t ref2het2_word = ref2het2[widx];
+    nm += PopcountWord(nm1_word & (hom2_word | ref2het2_word));
+    const uintptr_t ssq2_word = nm1_word & hom2_word;
+    ssq2 += PopcountWord(ssq2_word);
+    plus2 += PopcountWord(ssq2_word & ref2het2_word);
+  }
+  *nm_ptr = nm;
+  *sum2_ptr = S_CAST(int32_t, 2 * plus2 - ssq2);  // deliberate overflow
+  *ssq2_ptr = ssq2;
+}
+#endif  // !USE_AVX512_POPCNT
+
+CONSTI32(kDblMissingBlockWordCt, PLINK2_DBL_MISSING_BLOCK_WORD_CT);
+
+// Adds popcount(missing(sample_idx) & missing(sample_idx2)) for the first
+// prev_missing_nz_ct set bits sample_idx2 of missing_nz (starting from
+// first_idx) to write_base[sample_idx2].
+#ifdef USE_AVX512_POPCNT
+static void IncrDblMissing(const uintptr_t* missing_nz, const uintptr_t* missing_smaj, uint32_t first_idx, uint32_t sample_idx, uint32_t prev_missing_nz_ct, uint32_t* write_base) {
+  static_assert(kDblMissingBlockWordCt == 2, "IncrDblMissing() assumes 128-bit blocks.");
+  // Four 128-bit partner blocks per 512-bit vector.
+  const uintptr_t* cur_block_ptr = &(missing_smaj[sample_idx * kDblMissingBlockWordCt]);
+  const __m512i cur_block = _mm512_set_epi64(cur_block_ptr[1], cur_block_ptr[0], cur_block_ptr[1], cur_block_ptr[0], cur_block_ptr[1], cur_block_ptr[0], cur_block_ptr[1], cur_block_ptr[0]);
+  uintptr_t sample_idx2_base;
+  uintptr_t cur_bits;
+  BitIter1Start(missing_nz, first_idx, &sample_idx2_base, &cur_bits);
+  uint32_t remaining_ct = prev_missing_nz_ct;
+  for (; remaining_ct >= 4; remaining_ct -= 4) {
+    const uint32_t sample_idx2_0 = BitIter1(missing_nz, &sample_idx2_base, &cur_bits);
+    const uint32_t sample_idx2_1 = BitIter1(missing_nz, &sample_idx2_base, &cur_bits);
+    const uint32_t sample_idx2_2 = BitIter1(missing_nz, &sample_idx2_base, &cur_bits);
+    const uint32_t sample_idx2_3 = BitIter1(missing_nz, &sample_idx2_base, &cur_bits);
+    __m512i partners = _mm512_castsi128_si512(_mm_loadu_si128(R_CAST(const __m128i*, &(missing_smaj[sample_idx2_0 * kDblMissingBlockWordCt]))));
+    partners = _mm512_inserti32x4(partners, _mm_loadu_si128(R_CAST(const __m128i*, &(missing_smaj[sample_idx2_1 * kDblMissingBlockWordCt]))), 1);
+    partners = _mm512_inserti32x4(partners, _mm_loadu_si128(R_CAST(const __m128i*, &(missing_smaj[sample_idx2_2 * kDblMissingBlockWordCt]))), 2);
+    partners = _mm512_inserti32x4(partners, _mm_loadu_si128(R_CAST(const __m128i*, &(missing_smaj[sample_idx2_3 * kDblMissingBlockWordCt]))), 3);
+    __m512i cts = _mm512_popcnt_epi64(_mm512_and_si512(cur_block, partners));
+    // sum the two halves of each 128-bit lane; only even lanes are read
+    cts = _mm512_add_epi64(cts, _mm512_bsrli_epi128(cts, 8));
+    alignas(64) uint64_t cts_buf[8];
+    _mm512_store_si512(cts_buf, cts);
+    write_base[sample_idx2_0] += cts_buf[0];
+    write_base[sample_idx2_1] += cts_buf[2];
+    write_base[sample_idx2_2] += cts_buf[4];
+    write_base[sample_idx2_3] += cts_buf[6];
+  }
+  const uintptr_t cur_word0 = missing_smaj[sample_idx * kDblMissingBlockWordCt];
+  const uintptr_t cur_word1 = missing_smaj[sample_idx * kDblMissingBlockWordCt + 1];
+  for (; remaining_ct; --remaining_ct) {
+    const uint32_t sample_idx2 = BitIter1(missing_nz, &sample_idx2_base, &cur_bits);
+    const uintptr_t* cur_missing_smaj_base = &(missing_smaj[sample_idx2 * kDblMissingBlockWordCt]);
+    write_base[sample_idx2] += Popcount2Words(cur_word0 & cur_missing_smaj_base[0], cur_word1 & cur_missing_smaj_base[1]);
+  }
+}
+#else
+static void IncrDblMissing(const uintptr_t* missing_nz, const uintptr_t* missing_smaj, uint32_t first_idx, uint32_t sample_idx, uint32_t prev_missing_nz_ct, uint32_t* write_base) {
+  // todo: compare this explicit unroll with ordinary iteration over a
+  // cur_words[] array
+  // todo: try 1 word at a time, and 30 words at a time
+  const uintptr_t cur_word0 = missing_smaj[sample_idx * kDblMissingBlockWordCt];
+  const uintptr_t cur_word1 = missing_smaj[sample_idx * kDblMissingBlockWordCt + 1];
+#  ifndef __LP64__
+  const uintptr_t cur_word2 = missing_smaj[sample_idx * kDblMissingBlockWordCt + 2];
+  const uintptr_t cur_word3 = missing_smaj[sample_idx * kDblMissingBlockWordCt + 3];
+#  endif
+  uintptr_t sample_idx2_base;
+  uintptr_t cur_bits;
+  BitIter1Start(missing_nz, first_idx, &sample_idx2_base, &cur_bits);
+  for (uint32_t uii = 0; uii != prev_missing_nz_ct; ++uii) {
+    const uint32_t sample_idx2 = BitIter1(missing_nz, &sample_idx2_base, &cur_bits);
+    const uintptr_t* cur_missing_smaj_base = &(missing_smaj[sample_idx2 * kDblMissingBlockWordCt]);
+    const uintptr_t cur_and0 = cur_word0 & cur_missing_smaj_base[0];
+    const uintptr_t cur_and1 = cur_word1 & cur_missing_smaj_base[1];
+#  ifdef __LP64__
+    if (cur_and0 || cur_and1) {
+      write_base[sample_idx2] += Popcount2Words(cur_and0, cur_and1);
+    }
+#  else
+    const uintptr_t cur_and2 = cur_word2 & cur_missing_smaj_base[2];
+    const uintptr_t cur_and3 = cur_word3 & cur_missing_smaj_base[3];
+    if (cur_and0 || cur_and1 || cur_and2 || cur_and3) {
+      write_base[sample_idx2] += Popcount4Words(cur_and0, cur_and1, cur_and2, cur_and3);
+    }
+#  endif
+  }
+}
+#endif
+
+}  // namespace plink2
@@ -0,0 +1,44 @@
+// This file is part of PLINK 2.00, copyright (C) 2005-2020 Shaun Purcell,
+// Christopher Chang.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "plink2_simd.h"
+
+#if (defined(__LP64__) || defined(_WIN64)) && !defined(NO_SIMD_DISPATCH)
+#  ifndef __SSE4_2__
+#    error "plink2_simd_sse42.cc must be compiled with $(SIMDFLAGS_SSE42)."
+#  endif
+
+#  define plink2 plink2_simd_sse42
+#  include "include/plink2_bits.h"
+#  include "plink2_simd_kernels.h"
+#  undef plink2
+
+namespace plink2 {
+
+void InitSimdKernelsSse42(SimdKernels* kernels_ptr) {
+  kernels_ptr->incr_king = plink2_simd_sse42::IncrKing;
+  kernels_ptr->incr_king_homhom = plink2_simd_sse42::IncrKingHomhom;
+  kernels_ptr->incr_king_subset = plink2_simd_sse42::IncrKingSubset;
+  kernels_ptr->incr_king_subset_homhom = plink2_simd_sse42::IncrKingSubsetHomhom;
+  kernels_ptr->dotprod_words = plink2_simd_sse42::DotprodWords;
+  kernels_ptr->sum_ssq_words = plink2_simd_sse42::SumSsqWords;
+  kernels_ptr->sum_ssq_nm_words = plink2_simd_sse42::SumSsqNmWords;
+  kernels_ptr->incr_dbl_missing = plink2_simd_sse42::IncrDblMissing;
+}
+
+}  // namespace plink2
+#endif
@@ -0,0 +1,244 @@
+// This file is part of PLINK 2.00, copyright (C) 2005-2020 Shaun Purcell,
+// Christopher Chang.
+//
+// This program is free software: you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// Microbenchmark for the runtime-dispatched popcount kernels in
+// plink2_simd_kernels.h.  Each tier supported by the current processor is run
+// on the same pseudorandom input; results are cross-checked, and timings are
+// reported relative to the AVX2 kernels when those are available.
+
+#include <chrono>
+#include <string.h>
+
+#include "include/plink2_bits.h"
+#include "plink2_simd.h"
+
+namespace plink2 {
+
+CONSTI32(kBenchKingMultiplexWords, PLINK2_KING_MULTIPLEX / kBitsPerWord);
+
+static inline uint64_t Xorshift64(uint64_t* state_ptr) {
+  uint64_t xx = *state_ptr;
+  xx ^= xx << 13;
+  xx ^= xx >> 7;
+  xx ^= xx << 17;
+  *state_ptr = xx;
+  return xx;
+}
+
+static void FillRandomWords(uintptr_t word_ct, uint64_t* state_ptr, uintptr_t* dst) {
+  for (uintptr_t widx = 0; widx != word_ct; ++widx) {
+    dst[widx] = Xorshift64(state_ptr);
+  }
+}
+
+static uint64_t ChecksumU32(const uint32_t* src, uintptr_t ct) {
+  uint64_t checksum = 0;
+  for (uintptr_t ulii = 0; ulii != ct; ++ulii) {
+    checksum = checksum * 0x100000001b3LLU + src[ulii];
+  }
+  return checksum;
+}
+
+ENUM_U31_DEF_START()
+  kBenchKing,
+  kBenchKingHomhom,
+  kBenchLd,
+  kBenchDblMissing,
+  kBenchCt
+ENUM_U31_DEF_END(BenchIdx);
+
+static const char kBenchNames[kBenchCt][16] = {"KING", "KING+homhom", "LD r^2", "dbl-missing"};
+
+typedef struct BenchBufsStruct {
+  uint32_t sample_ct;
+  uint32_t iter_ct;
+  uintptr_t ld_word_ct;
+  // sample-major, kBenchKingMultiplexWords words per sample
+  uintptr_t* smaj_hom;
+  uintptr_t* smaj_ref2het;
+  // variant-major, ld_word_ct words per variant, two variants
+  uintptr_t* ld_hom;
+  uintptr_t* ld_ref2het;
+  uintptr_t* missing_nz;
+  uintptr_t* missing_smaj;
+  uint32_t* king_counts;
+  uint32_t* dbl_missing_cts;
+} BenchBufs;
+
+// Returns elapsed time in seconds, and the output checksum in *checksum_ptr.
+static double RunBench(const SimdKernels* kernels_ptr, BenchIdx bench_idx, BenchBufs* bufs_ptr, uint64_t* checksum_ptr) {
+  const uint32_t sample_ct = bufs_ptr->sample_ct;
+  const uint32_t iter_ct = bufs_ptr->iter_ct;
+  const uintptr_t pair_ct = (S_CAST(uint64_t, sample_ct) * (sample_ct - 1)) / 2;
+  uint64_t checksum = 0;
+  const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+  if ((bench_idx == kBenchKing) || (bench_idx == kBenchKingHomhom)) {
+    const uint32_t homhom_needed = (bench_idx == kBenchKingHomhom);
+    const uintptr_t count_ct = pair_ct * (4 + homhom_needed);
+    IncrKingFunc incr_king = homhom_needed? kernels_ptr->incr_king_homhom : kernels_ptr->incr_king;
+    memset(bufs_ptr->king_counts, 0, count_ct * sizeof(int32_t));
+    for (uint32_t iter_idx = 0; iter_idx != iter_ct; ++iter_idx) {
+      incr_king(bufs_ptr->smaj_hom, bufs_ptr->smaj_ref2het, 0, sample_ct, bufs_ptr->king_counts);
+    }
+    checksum = ChecksumU32(bufs_ptr->king_counts, count_ct);
+  } else if (bench_idx == kBenchLd) {
+    const uintptr_t ld_word_ct = bufs_ptr->ld_word_ct;
+    const uintptr_t* hom1 = bufs_ptr->ld_hom;
+    const uintptr_t* ref2het1 = bufs_ptr->ld_ref2het;
+    const uintptr_t* hom2 = &(hom1[ld_word_ct]);
+    const uintptr_t* ref2het2 = &(ref2het1[ld_word_ct]);
+    const uintptr_t ld_iter_ct = S_CAST(uint64_t, iter_ct) * sample_ct * 64;
+    for (uintptr_t ulii = 0; ulii != ld_iter_ct; ++ulii) {
+      // vary word_ct a bit to exercise the tail handling
+      const uint32_t cur_word_ct = ld_word_ct - (ulii % 8);
+      const int32_t dotprod = kernels_ptr->dotprod_words(hom1, ref2het1, hom2, ref2het2, cur_word_ct);
+      uint32_t nm;
+      int32_t sum2;
+      uint32_t ssq2;
+      kernels_ptr->sum_ssq_nm_words(hom1, ref2het1, hom2, ref2het2, cur_word_ct, &nm, &sum2, &ssq2);
+      checksum = checksum * 0x100000001b3LLU + S_CAST(uint32_t, dotprod);
+      checksum = checksum * 0x100000001b3LLU + nm;
+      checksum = checksum * 0x100000001b3LLU + S_CAST(uint32_t, sum2);
+      checksum = checksum * 0x100000001b3LLU + ssq2;
+    }
+  } else {
+    memset(bufs_ptr->dbl_missing_cts, 0, sample_ct * sizeof(int32_t));
+    for (uint32_t iter_idx = 0; iter_idx != iter_ct; ++iter_idx) {
+      for (uint32_t sample_idx = 1; sample_idx != sample_ct; ++sample_idx) {
+        kernels_ptr->incr_dbl_missing(bufs_ptr->missing_nz, bufs_ptr->missing_smaj, 0, sample_idx, sample_idx, bufs_ptr->dbl_missing_cts);
+      }
+    }
+    checksum = ChecksumU32(bufs_ptr->dbl_missing_cts, sample_ct);
+  }
+  const std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
+  *checksum_ptr = checksum;
+  return std::chrono::duration<double>(end_time - start_time).count();
+}
+
+}  // namespace plink2
+
+int32_t main(int32_t argc, char** argv) {
+#ifdef __cplusplus
+  using namespace plink2;
+#endif
+  PglErr reterr = kPglRetSuccess;
+  BenchBufs bufs;
+  memset(&bufs, 0, sizeof(BenchBufs));
+  {
+    if (argc != 3) {
+      fputs(
+"Usage:\n"
+"simd_bench [sample ct] [iteration ct]\n"
+"Times each runtime-dispatched popcount kernel tier on the same pseudorandom\n"
+"input, and verifies that all tiers produce identical results.\n"
+            , stdout);
+      reterr = kPglRetSkipped;
+      goto main_ret_1;
+    }
+    uint32_t sample_ct;
+    uint32_t iter_ct;
+    if (ScanPosintDefcap(argv[1], &sample_ct) || (sample_ct < 2) || (sample_ct > 65536) || ScanPosintDefcap(argv[2], &iter_ct)) {
+      fputs("Error: Invalid simd_bench parameter.\n", stderr);
+      reterr = kPglRetInvalidCmdline;
+      goto main_ret_1;
+    }
+    bufs.sample_ct = sample_ct;
+    bufs.iter_ct = iter_ct;
+    bufs.ld_word_ct = BitCtToWordCt(sample_ct) + 8;
+    const uintptr_t pair_ct = (S_CAST(uint64_t, sample_ct) * (sample_ct - 1)) / 2;
+    const uintptr_t smaj_word_ct = S_CAST(uintptr_t, sample_ct) * kBenchKingMultiplexWords;
+    const uintptr_t dbl_missing_word_ct = S_CAST(uintptr_t, sample_ct) * PLINK2_DBL_MISSING_BLOCK_WORD_CT;
+    if (cachealigned_malloc(smaj_word_ct * sizeof(intptr_t), &bufs.smaj_hom) ||
+        cachealigned_malloc(smaj_word_ct * sizeof(intptr_t), &bufs.smaj_ref2het) ||
+        cachealigned_malloc(2 * bufs.ld_word_ct * sizeof(intptr_t), &bufs.ld_hom) ||
+        cachealigned_malloc(2 * bufs.ld_word_ct * sizeof(intptr_t), &bufs.ld_ref2het) ||
+        cachealigned_malloc(BitCtToWordCt(sample_ct) * sizeof(intptr_t), &bufs.missing_nz) ||
+        cachealigned_malloc(dbl_missing_word_ct * sizeof(intptr_t), &bufs.missing_smaj) ||
+        cachealigned_malloc(pair_ct * 5 * sizeof(int32_t), &bufs.king_counts) ||
+        cachealigned_malloc(sample_ct * sizeof(int32_t), &bufs.dbl_missing_cts)) {
+      goto main_ret_NOMEM;
+    }
+    uint64_t rng_state = 0x9e3779b97f4a7c15LLU;
+    FillRandomWords(smaj_word_ct, &rng_state, bufs.smaj_hom);
+    FillRandomWords(smaj_word_ct, &rng_state, bufs.smaj_ref2het);
+    FillRandomWords(2 * bufs.ld_word_ct, &rng_state, bufs.ld_hom);
+    FillRandomWords(2 * bufs.ld_word_ct, &rng_state, bufs.ld_ref2het);
+    FillRandomWords(dbl_missing_word_ct, &rng_state, bufs.missing_smaj);
+    SetAllBits(sample_ct, bufs.missing_nz);
+
+    const SimdTier max_tier = DetectSimdTier();
+    printf("simd_bench: %u samples, %u iteration%s, highest supported tier %s.\n", sample_ct, iter_ct, (iter_ct == 1)? "" : "s", SimdTierName(max_tier));
+    double avx2_times[kBenchCt];
+    uint64_t ref_checksums[kBenchCt];
+    uint32_t avx2_run = 0;
+    uint32_t ref_set = 0;
+    for (uint32_t tier_idx = kSimdTierGeneric; tier_idx <= S_CAST(uint32_t, max_tier); ++tier_idx) {
+      const SimdTier tier = S_CAST(SimdTier, tier_idx);
+      SimdKernels kernels;
+      InitSimdKernels(tier, &kernels);
+      if (tier != max_tier) {
+        // Tiers below the build baseline map to the baseline kernels; only
+        // run those under the baseline's name.
+        SimdKernels next_kernels;
+        InitSimdKernels(S_CAST(SimdTier, tier_idx + 1), &next_kernels);
+        if (!memcmp(&kernels, &next_kernels, sizeof(SimdKernels))) {
+          continue;
+        }
+      }
+      printf("%-8s", SimdTierName(tier));
+      for (uint32_t bench_idx = 0; bench_idx != kBenchCt; ++bench_idx) {
+        uint64_t checksum;
+        const double elapsed = RunBench(&kernels, S_CAST(BenchIdx, bench_idx), &bufs, &checksum);
+        printf("  %s %.4fs", kBenchNames[bench_idx], elapsed);
+        if (tier == kSimdTierAvx2) {
+          avx2_times[bench_idx] = elapsed;
+        } else if (avx2_run) {
+          printf(" (%.2fx)", avx2_times[bench_idx] / elapsed);
+        }
+        if (!ref_set) {
+          ref_checksums[bench_idx] = checksum;
+        } else if (checksum != ref_checksums[bench_idx]) {
+          printf("\n");
+          fprintf(stderr, "Error: %s kernel results differ between tiers.\n", kBenchNames[bench_idx]);
+          reterr = kPglRetInconsistentInput;
+          goto main_ret_1;
+        }
+      }
+      printf("\n");
+      ref_set = 1;
+      if (tier == kSimdTierAvx2) {
+        avx2_run = 1;
+      }
+    }
+  }
+  while (0) {
+  main_ret_NOMEM:
+    fputs("Error: Out of memory.\n", stderr);
+    reterr = kPglRetNomem;
+    break;
+  }
+ main_ret_1:
+  aligned_free_cond(bufs.smaj_hom);
+  aligned_free_cond(bufs.smaj_ref2het);
+  aligned_free_cond(bufs.ld_hom);
+  aligned_free_cond(bufs.ld_ref2het);
+  aligned_free_cond(bufs.missing_nz);
+  aligned_free_cond(bufs.missing_smaj);
+  aligned_free_cond(bufs.king_counts);
+  aligned_free_cond(bufs.dbl_missing_cts);
+  return S_CAST(int32_t, reterr);
+}